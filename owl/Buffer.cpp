@@ -72,6 +72,16 @@ namespace owl {
     return std::make_shared<Buffer::DeviceData>(device);
   }
 
+  std::vector<uint8_t> Buffer::download(const DeviceContext::SP &device) const
+  {
+    std::vector<uint8_t> bytes(sizeInBytes());
+    if (bytes.empty()) return bytes;
+    SetActiveGPU forLifeTime(device);
+    OWL_CUDA_CALL(Memcpy(bytes.data(),getPointer(device),
+                         bytes.size(),cudaMemcpyDefault));
+    return bytes;
+  }
+
   // ------------------------------------------------------------------
   // Device Buffer
   // ------------------------------------------------------------------
@@ -127,10 +137,57 @@ namespace owl {
   void DeviceBuffer::upload(const void *hostPtr, size_t offset, int64_t count)
   {
     assert(deviceData.size() == context->deviceCount());
+    if (type >= _OWL_BEGIN_COPYABLE_TYPES
+        && context->replicationPlan.numHostUploads() < (int)deviceData.size()) {
+      replicatedUpload(hostPtr, offset, count);
+      return;
+    }
     for (auto dd : deviceData)
       dd->as<DeviceBuffer::DeviceData>().uploadAsync(hostPtr, offset, count);
     OWL_CUDA_SYNC_CHECK();
   }
+
+  void DeviceBuffer::replicatedUpload(const void *hostPtr, size_t offset, int64_t count)
+  {
+    const ReplicationPlan &plan = context->replicationPlan;
+    const std::vector<DeviceContext::SP> &devices = context->getDevices();
+    const size_t numBytes = ((count == -1) ? elementCount : count)*sizeOf(type);
+
+    // each device's replicationEvent gets re-recorded after each
+    // chunk: all devices' copies of a chunk get issued before any of
+    // the next chunk, so waiting on a source's event always waits for
+    // the chunk that was just issued there
+    for (size_t begin=0;begin<numBytes;begin+=plan.chunkSize) {
+      const size_t size = std::min(plan.chunkSize,numBytes-begin);
+      for (int deviceID : plan.order) {
+        const DeviceContext::SP &device = devices[deviceID];
+        SetActiveGPU forLifeTime(device);
+        char *dst = (char*)getDD(device).d_pointer + offset + begin;
+        const int src = plan.source[deviceID];
+        if (src < 0) {
+          OWL_CUDA_CALL(MemcpyAsync(dst,(const char *)hostPtr + begin,size,
+                                    cudaMemcpyDefault,
+                                    device->getStream()));
+        } else {
+          const DeviceContext::SP &srcDevice = devices[src];
+          OWL_CUDA_CALL(StreamWaitEvent(device->getStream(),
+                                        srcDevice->replicationEvent,0));
+          OWL_CUDA_CALL(MemcpyPeerAsync(dst,device->getCudaDeviceID(),
+                                        (char*)getDD(srcDevice).d_pointer + offset + begin,
+                                        srcDevice->getCudaDeviceID(),
+                                        size,
+                                        device->getStream()));
+        }
+        OWL_CUDA_CALL(EventRecord(device->replicationEvent,device->getStream()));
+      }
+    }
+
+    for (auto device : devices) {
+      SetActiveGPU forLifeTime(device);
+      OWL_CUDA_CALL(StreamSynchronize(device->getStream()));
+    }
+    OWL_CUDA_SYNC_CHECK();
+  }
   
   void DeviceBuffer::upload(const int deviceID, const void *hostPtr, size_t offset, int64_t count) 
   {
@@ -151,6 +208,12 @@ namespace owl {
     for (auto device : context->getDevices()) 
       getDD(device).executeResize();
   }
+
+  size_t DeviceBuffer::getDeviceMemoryUsage(const DeviceContext::SP &device) const
+  {
+    const DeviceData &dd = getDD(device);
+    return dd.d_pointer ? elementCount*dd.elementSize() : 0;
+  }
   
   void DeviceBuffer::DeviceDataForTextures::executeResize() 
   {
@@ -160,7 +223,12 @@ namespace owl {
     }
 
     if (parent->elementCount)
-      OWL_CUDA_CALL(Malloc(&d_pointer,parent->elementCount*sizeof(cudaTextureObject_t)));
+      OWL_CUDA_CALL(Malloc(&d_pointer,parent->elementCount*elementSize()));
+  }
+
+  size_t DeviceBuffer::DeviceDataForTextures::elementSize() const
+  {
+    return sizeof(cudaTextureObject_t);
   }
 
   void DeviceBuffer::DeviceDataForTextures::clear() 
@@ -196,6 +264,11 @@ namespace owl {
     throw std::runtime_error("owlBufferClear() not implmemented for buffers of buffers");
   }
   
+  size_t DeviceBuffer::DeviceDataForBuffers::elementSize() const
+  {
+    return sizeof(device::Buffer);
+  }
+
   void DeviceBuffer::DeviceDataForBuffers::executeResize() 
   {
     SetActiveGPU forLifeTime(device);
@@ -205,7 +278,7 @@ namespace owl {
     }
 
     if (parent->elementCount) {
-      OWL_CUDA_CALL(Malloc(&d_pointer,parent->elementCount*sizeof(device::Buffer)));
+      OWL_CUDA_CALL(Malloc(&d_pointer,parent->elementCount*elementSize()));
     }
   }
   
@@ -248,6 +321,11 @@ namespace owl {
   }
   
 
+  size_t DeviceBuffer::DeviceDataForGroups::elementSize() const
+  {
+    return sizeof(OptixTraversableHandle);
+  }
+
   void DeviceBuffer::DeviceDataForGroups::executeResize() 
   {
     SetActiveGPU forLifeTime(device);
@@ -255,7 +333,7 @@ namespace owl {
     if (d_pointer) { OWL_CUDA_CALL(Free(d_pointer)); d_pointer = nullptr; }
 
     if (parent->elementCount)
-      OWL_CUDA_CALL(Malloc(&d_pointer,parent->elementCount*sizeof(OptixTraversableHandle)));
+      OWL_CUDA_CALL(Malloc(&d_pointer,parent->elementCount*elementSize()));
   }
   
   void DeviceBuffer::DeviceDataForGroups::uploadAsync(const void *hostDataPtr, size_t offset, int64_t count) 
@@ -300,6 +378,11 @@ namespace owl {
   
 
   
+  size_t DeviceBuffer::DeviceDataForCopyableData::elementSize() const
+  {
+    return sizeOf(parent->type);
+  }
+
   void DeviceBuffer::DeviceDataForCopyableData::executeResize() 
   {
     SetActiveGPU forLifeTime(device);
@@ -309,7 +392,7 @@ namespace owl {
     }
 
     if (parent->elementCount) {
-      OWL_CUDA_CALL(Malloc(&d_pointer,parent->elementCount*sizeOf(parent->type)));
+      OWL_CUDA_CALL(Malloc(&d_pointer,parent->elementCount*elementSize()));
     }
   }
   
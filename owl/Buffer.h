@@ -77,9 +77,19 @@ namespace owl {
     /*! upload data from host, to only given device ID */
     virtual void upload(const int deviceID, const void *hostPtr, size_t offset, int64_t count) = 0;
 
+    /*! copy this buffer's contents, as seen by the given device,
+        back to the host */
+    std::vector<uint8_t> download(const DeviceContext::SP &device) const;
+
     /*! creates the device-specific data for this group */
     RegisteredObject::DeviceData::SP createOn(const DeviceContext::SP &device) override;
 
+    /*! bytes of device memory this buffer has allocated on the given
+        device; only device buffers own any, all other buffer types
+        are either host memory or not owned by any one device */
+    virtual size_t getDeviceMemoryUsage(const DeviceContext::SP &device) const
+    { return 0; }
+
     /*! destroy whatever resouces this buffer may own on the device,
         but do NOT destroy this class itself. baiscally that's a
         resize(0), but that buffer can not - and shoult not - be used
@@ -120,6 +130,10 @@ namespace owl {
           old memory, and allocating required elemnts in device
           format, as required */
       virtual void executeResize() = 0;
+
+      /*! size of one element in device format (which for handle
+          types differs from the host-side handle) */
+      virtual size_t elementSize() const = 0;
       
       /*! create an async upload for data from the given host data
           pointer, using the given device's cuda stream, and doing any
@@ -146,6 +160,7 @@ namespace owl {
         : DeviceData(parent,device)
       {}
       void executeResize() override;
+      size_t elementSize() const override;
       void uploadAsync(const void *hostDataPtr, size_t offset, int64_t count) override;
       
       /*! clear the buffer by setting its contents to zero */
@@ -169,6 +184,7 @@ namespace owl {
       {}
       
       void executeResize() override;
+      size_t elementSize() const override;
       void uploadAsync(const void *hostDataPtr, size_t offset, int64_t count) override;
       
       /*! clear the buffer by setting its contents to zero */
@@ -191,6 +207,7 @@ namespace owl {
       {}
       
       void executeResize() override;
+      size_t elementSize() const override;
       void uploadAsync(const void *hostDataPtr, size_t offset, int64_t count) override;
       
       /*! clear the buffer by setting its contents to zero */
@@ -212,6 +229,7 @@ namespace owl {
         : DeviceData(parent,device)
       {}
       void executeResize() override;
+      size_t elementSize() const override;
       void uploadAsync(const void *hostDataPtr, size_t offset, int64_t count) override;
       
       /*! clear the buffer by setting its contents to zero */
@@ -238,9 +256,18 @@ namespace owl {
       
     /*! clear the buffer by setting its contents to zero */
     void clear() override;
+
+    size_t getDeviceMemoryUsage(const DeviceContext::SP &device) const override;
     
     /*! creates the device-specific data for this group */
     RegisteredObject::DeviceData::SP createOn(const DeviceContext::SP &device) override;
+
+  private:
+    /*! upload to all devices, following the context's replication
+        plan: from the host to one device, and peer-to-peer from
+        there, in pipelined chunks. Only for copyable data (handles
+        are different on every device) */
+    void replicatedUpload(const void *hostPtr, size_t offset, int64_t count);
   };
 
 
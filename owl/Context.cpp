@@ -88,6 +88,12 @@ namespace owl {
     for (auto device : devices) 
       LOG(" - device #" << device->ID << " : " << device->getDeviceName());
     LOG("enabling peer access:");
+
+    // CUDA doesn't say which device is closest to the host, nor how
+    // fast peer links are - only how they rank against each other
+    // (0 being the fastest, eg NVLink); that's what the replication
+    // plan gets to work with
+    topology = DeviceTopology(deviceCount);
     
     for (auto device : devices) {
       std::stringstream ss;
@@ -114,6 +120,22 @@ namespace owl {
             continue;
           }
           
+          int performanceRank = 0;
+          rc = cudaDeviceGetP2PAttribute(&performanceRank,
+                                         cudaDevP2PAttrPerformanceRank,
+                                         cuda_i,cuda_j);
+          if (rc == cudaSuccess)
+            topology.peer(i,j) = 1./(1+performanceRank);
+          else {
+            // without a rank we can't tell how good the link is, so
+            // don't plan any copies over it; uploads to this device
+            // then come from the host (or some other peer)
+            LOG("could not query peer link " << i << "->" << j
+                << " (" << cudaGetErrorString(rc) << "), not using it"
+                << " for replicated uploads");
+            cudaGetLastError();
+          }
+          
           rc = cudaDeviceEnablePeerAccess(cuda_j,0);
           if (rc == cudaErrorPeerAccessAlreadyEnabled) {
             std::cout << "#owl: peer access already enabled ... 'k." << std::endl;
@@ -126,6 +148,10 @@ namespace owl {
       }
       LOG(ss.str()); 
     }
+    
+    replicationPlan = planReplication(topology);
+    LOG("uploads to all devices go to " << replicationPlan.numHostUploads()
+        << " device(s) from the host, and peer-to-peer from there");
   }
   
   /*! creates a buffer that uses CUDA host pinned memory; that
@@ -191,6 +217,22 @@ namespace owl {
     assert(texture);
     return texture;
   }
+
+  Texture::SP
+  Context::texture2DCreateMipmapped(OWLTexelFormat texelFormat,
+                                    OWLTextureFilterMode filterMode,
+                                    OWLTextureAddressMode addressMode,
+                                    OWLTextureColorSpace colorSpace,
+                                    const vec2i size,
+                                    int numLevels,
+                                    const void *const *levels)
+  {
+    Texture::SP texture
+      = std::make_shared<Texture>(this,size,numLevels,levels,
+                                  texelFormat,filterMode,addressMode,colorSpace);
+    assert(texture);
+    return texture;
+  }
     
 
   Buffer::SP
@@ -611,6 +653,27 @@ namespace owl {
     spheresEnabled = true;
   }
 
+  size_t Context::getDeviceMemoryUsage(const DeviceContext::SP &device)
+  {
+    size_t bytes = 0;
+    for (size_t i=0;i<buffers.size();i++) {
+      Buffer *buffer = buffers.getPtr(i);
+      if (buffer && !buffer->deviceData.empty())
+        bytes += buffer->getDeviceMemoryUsage(device);
+    }
+    for (size_t i=0;i<textures.size();i++) {
+      Texture *texture = textures.getPtr(i);
+      if (texture)
+        bytes += texture->getDeviceMemoryUsage(device);
+    }
+    for (size_t i=0;i<groups.size();i++) {
+      Group *group = groups.getPtr(i);
+      if (group && !group->deviceData.empty())
+        bytes += group->getDD(device).memFinal;
+    }
+    return bytes;
+  }
+
   void Context::setNumAttributeValues(size_t numAttributeValues)
   {
     for (auto device : getDevices()) {
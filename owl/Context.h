@@ -24,6 +24,7 @@
 #include "RayGen.h"
 #include "LaunchParams.h"
 #include "MissProg.h"
+#include "owl/common/parallel/ReplicationPlan.h"
 
 namespace owl {
 
@@ -64,6 +65,12 @@ namespace owl {
     DeviceContext::SP getDevice(int ID) const
     { assert(ID >= 0 && ID < (int)devices.size()); return devices[ID]; }
 
+    /*! bytes of device memory that this context's device buffers,
+        textures, and acceleration structures use on the given
+        device (ie, excluding temporary build memory, and anything
+        that other contexts or the application allocated) */
+    size_t getDeviceMemoryUsage(const DeviceContext::SP &device);
+
     /*! part of the SBT creation - builds the hit group array */
     void buildHitGroupRecordsOn(const DeviceContext::SP &device);
     /*! part of the SBT creation - builds the raygen array */
@@ -147,6 +154,16 @@ namespace owl {
                     uint32_t linePitchInBytes,
                     const void *texels);
 
+    /*! creates a mipmapped 2D texture from the given levels' texels */
+    Texture::SP
+    texture2DCreateMipmapped(OWLTexelFormat texelFormat,
+                             OWLTextureFilterMode filterMode,
+                             OWLTextureAddressMode addressMode,
+                             OWLTextureColorSpace colorSpace,
+                             const vec2i size,
+                             int numLevels,
+                             const void *const *levels);
+
     /*! create a new *triangles* geometry group that will eventually
       create a BVH over all the trianlges across all its child
       geometries. only TrianglesGeoms can be added to this
@@ -327,6 +344,12 @@ namespace owl {
       user didn't specify any during launch */
     LaunchParams::SP dummyLaunchParams;
 
+    /*! how the devices are connected to each other (as far as CUDA
+        tells us), and thus how uploads to all devices get replicated
+        across them - see DeviceBuffer::upload() */
+    DeviceTopology  topology;
+    ReplicationPlan replicationPlan;
+
   private:
     void enablePeerAccess();
     std::vector<DeviceContext::SP> devices;
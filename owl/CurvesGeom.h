@@ -17,6 +17,7 @@
 #pragma once
 
 #include "Geometry.h"
+#include "owl/common/geometry/curvePreprocessing.h"
 
 namespace owl {
 
@@ -125,9 +126,21 @@ namespace owl {
     void setSegmentIndices(Buffer::SP indices,
                            size_t count);
 
+    /*! splits and converts this geometry's curves on the host (see
+        owl/common/geometry/curvePreprocessing.h); the result replaces
+        the contents of the same buffers (in the b-spline basis of
+        the type's degree, whatever config.outputBasis says), and
+        the segment remap table gets stored in newToOldSegment. Any
+        groups using these curves have to be rebuilt */
+    void preprocess(const CurvePreprocessConfig &config);
+
     /*! pretty-print */
     std::string toString() const override;
 
+    /*! remap table of the last preprocess(): for each segment, the
+        segment it was (a piece of) before */
+    std::vector<uint32_t> newToOldSegment;
+    
     int segmentIndicesCount = 0;
     Buffer::SP segmentIndicesBuffer;
     
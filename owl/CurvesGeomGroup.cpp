@@ -16,6 +16,7 @@
 
 #include "CurvesGeomGroup.h"
 #include "CurvesGeom.h"
+#include "owl/common/math/boundsReduction.h"
 #include "Context.h"
 
 #define LOG(message)                                            \
@@ -51,10 +52,28 @@ namespace owl {
       // buildFlags(OPTIX_BUILD_FLAG_ALLOW_RANDOM_VERTEX_ACCESS)
   {}
   
+  /*! computes one box per motion key, on the host, from the control
+      points (padded by their widths) as seen by the first GPU; that
+      is conservative for all the curve bases we use */
   void CurvesGeomGroup::updateMotionBounds()
   {
-    // only need this for older version of optix that wouldn't even support curves
-    OWL_NOTIMPLEMENTED;
+    DeviceContext::SP device = context->getDevice(0);
+    bounds.clear();
+    for (auto geom : geometries) {
+      CurvesGeom::SP curves = geom->as<CurvesGeom>();
+      assert(curves);
+      if (bounds.empty())
+        bounds.resize(curves->verticesBuffers.size());
+      for (size_t key=0;key<bounds.size() && key<curves->verticesBuffers.size();key++) {
+        const std::vector<uint8_t> controlPoints
+          = curves->verticesBuffers[key]->download(device);
+        const std::vector<uint8_t> widths
+          = curves->widthsBuffers[key]->download(device);
+        bounds[key].extend
+          (computeBounds(StridedVec3fs(controlPoints.data(),curves->vertexCount),
+                         StridedArray<float>(widths.data(),curves->vertexCount)));
+      }
+    }
   }
   
   void CurvesGeomGroup::buildAccel()
@@ -0,0 +1,98 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "CurvesGeom.h"
+#include "Context.h"
+
+#define LOG(message)                                            \
+  if (Context::logging())                                       \
+    std::cout << "#owl(" << device->ID << "): "                 \
+              << message                                        \
+              << std::endl
+
+namespace owl {
+
+  void CurvesGeom::preprocess(const CurvePreprocessConfig &_config)
+  {
+    if (!segmentIndicesBuffer || verticesBuffers.empty())
+      OWL_RAISE("curves preprocessing: control points and segment "
+                "indices have to be set first");
+    if (widthsBuffers.size() != verticesBuffers.size())
+      OWL_RAISE("curves preprocessing: need one widths buffer per "
+                "control point buffer");
+    for (size_t i=0;i<verticesBuffers.size();i++)
+      if (sizeOf(verticesBuffers[i]->type) != sizeof(vec3f) ||
+          sizeOf(widthsBuffers[i]->type) != sizeof(float))
+        OWL_RAISE("curves preprocessing works in place, so needs float3 "
+                  "control point and float width buffers");
+    if (sizeOf(segmentIndicesBuffer->type) != sizeof(uint32_t))
+      OWL_RAISE("curves preprocessing works in place, so needs an int "
+                "segment index buffer");
+    
+    CurvePreprocessConfig config = _config;
+    config.outputBasis
+      = curveBasisForDegree(std::dynamic_pointer_cast<CurvesGeomType>(type)->degree);
+    
+    // ------------------------------------------------------------------
+    // get everything to the host...
+    // ------------------------------------------------------------------
+    DeviceContext::SP device = context->getDevice(0);
+    std::vector<std::vector<uint8_t>> bytes;
+    std::vector<StridedVec3fs> controlPointKeys;
+    std::vector<StridedArray<float>> widthKeys;
+    for (size_t i=0;i<verticesBuffers.size();i++) {
+      bytes.push_back(verticesBuffers[i]->download(device));
+      controlPointKeys.push_back(StridedVec3fs(bytes.back().data(),vertexCount));
+      bytes.push_back(widthsBuffers[i]->download(device));
+      widthKeys.push_back(StridedArray<float>(bytes.back().data(),vertexCount));
+    }
+    bytes.push_back(segmentIndicesBuffer->download(device));
+    const StridedArray<uint32_t> segmentIndices(bytes.back().data(),
+                                                segmentIndicesCount);
+
+    // ------------------------------------------------------------------
+    // ... preprocess...
+    // ------------------------------------------------------------------
+    CurvePreprocessResult result
+      = preprocessCurves(controlPointKeys,widthKeys,segmentIndices,config);
+    LOG("preprocessed curves: "
+        << segmentIndicesCount << " -> " << result.segmentIndices.size()
+        << " segments, "
+        << vertexCount << " -> " << result.controlPoints[0].size()
+        << " control points");
+    
+    // ------------------------------------------------------------------
+    // ... and write it back, into the same buffers
+    // ------------------------------------------------------------------
+    const size_t numControlPoints = result.controlPoints[0].size();
+    for (size_t i=0;i<verticesBuffers.size();i++) {
+      verticesBuffers[i]->resize(numControlPoints);
+      verticesBuffers[i]->upload(result.controlPoints[i].data(),0,numControlPoints);
+      widthsBuffers[i]->resize(numControlPoints);
+      widthsBuffers[i]->upload(result.widths[i].data(),0,numControlPoints);
+    }
+    const size_t numSegments = result.segmentIndices.size();
+    segmentIndicesBuffer->resize(numSegments);
+    segmentIndicesBuffer->upload(result.segmentIndices.data(),0,numSegments);
+
+    // resizing may have changed the buffers' device addresses
+    setVertices(verticesBuffers,widthsBuffers,numControlPoints);
+    setSegmentIndices(segmentIndicesBuffer,numSegments);
+
+    newToOldSegment = std::move(result.newToOldSegment);
+  }
+  
+} // ::owl
@@ -205,6 +205,8 @@ namespace owl {
     
     OWL_CUDA_CHECK(cudaSetDevice(cudaDeviceID));
     OWL_CUDA_CHECK(cudaStreamCreate(&stream));
+    OWL_CUDA_CHECK(cudaEventCreateWithFlags(&replicationEvent,
+                                            cudaEventDisableTiming));
     
     CUresult  cuRes = cuCtxGetCurrent(&cudaContext);
     if (cuRes != CUDA_SUCCESS) 
@@ -224,6 +226,7 @@ namespace owl {
     destroyPipeline();
     
     OPTIX_CHECK(optixDeviceContextDestroy(optixContext));
+    cudaEventDestroy(replicationEvent);
     cudaStreamDestroy(stream);
   }
   
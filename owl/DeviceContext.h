@@ -60,6 +60,9 @@ namespace owl {
   /*! what will eventually containt the whole owl context across all gpus */
   struct Context;
 
+  /*! a batch of geometry bounds computations, see GeomBoundsBatch.h */
+  struct GeomBoundsBatch;
+
   /*! optix and cuda context for a single, specific GPU */
   struct DeviceContext : public std::enable_shared_from_this<DeviceContext>  {
     typedef std::shared_ptr<DeviceContext> SP;
@@ -102,6 +105,13 @@ namespace owl {
 
     void buildCurvesModules();
     void buildSphereModule();
+
+    /*! computes the bounds of all jobs in the given batch (whose
+        pointers have to be valid on this device), in one launch per
+        reduction stage, and writes two boxes (one per motion key)
+        per job into 'results'. Uses (and, if required, grows) this
+        device's boundsScratch memory */
+    void computeGeomBounds(const GeomBoundsBatch &batch, box3f *results);
     
     /*! collects all compiled programs during 'buildPrograms', such
         that all active progs can then be passed to optix durign
@@ -111,6 +121,11 @@ namespace owl {
     OptixDeviceContext optixContext = nullptr;
     CUcontext          cudaContext  = nullptr;
     CUstream           stream       = nullptr;
+    /*! marks how far this device's stream has gotten with a
+        replicated upload (see DeviceBuffer::replicatedUpload), so
+        devices copying from this one know when they can start;
+        created once, and re-recorded for every chunk */
+    cudaEvent_t        replicationEvent = nullptr;
 
     OptixPipelineCompileOptions pipelineCompileOptions = {};
     OptixPipelineLinkOptions    pipelineLinkOptions    = {};
@@ -129,6 +144,11 @@ namespace owl {
     /*! optix builtin module for spheres */
     OptixModule                 spheresModule = nullptr;
 
+    /*! scratch memory for computeGeomBounds; only ever grows, so
+        repeated bounds computations (eg, for motion blur refits)
+        don't have to allocate anything */
+    DeviceMemory                boundsScratch;
+
     /*! the owl context that this device is in */
     Context *const parent;
 
@@ -0,0 +1,181 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "InstanceGroup.h"
+#include "Context.h"
+
+namespace owl {
+
+  /*! device kernel that assembles the OptixInstance records of an
+      instance group from device-resident transforms, instance IDs,
+      and visibility masks, plus a (host-maintained) table of child
+      traversables and sbt offsets. Any of the three per-instance
+      arrays may be null, in which case we use the same defaults as
+      the host-side code path */
+  __global__ void assembleOptixInstances(OptixInstance *instances,
+                                         const InstanceGroup::ChildRecord *children,
+                                         const float    *transforms,
+                                         int             transformsAreRowMajor,
+                                         const uint32_t *instanceIDs,
+                                         const uint8_t  *visibilityMasks,
+                                         size_t          numInstances)
+  {
+    size_t tid = size_t(blockDim.x) * blockIdx.x + threadIdx.x;
+    if (tid >= numInstances) return;
+
+    OptixInstance oi = {};
+    if (!transforms) {
+      oi.transform[0*4+0] = 1.f;
+      oi.transform[1*4+1] = 1.f;
+      oi.transform[2*4+2] = 1.f;
+    } else if (transformsAreRowMajor) {
+      const float *m = transforms + 12*tid;
+      for (int i=0;i<12;i++)
+        oi.transform[i] = m[i];
+    } else {
+      // owl/affine3f layout: vx, vy, vz, p, each a (packed) vec3f
+      const float *m = transforms + 12*tid;
+      for (int row=0;row<3;row++)
+        for (int col=0;col<4;col++)
+          oi.transform[row*4+col] = m[col*3+row];
+    }
+
+    const InstanceGroup::ChildRecord child = children[tid];
+    oi.flags             = OPTIX_INSTANCE_FLAG_NONE;
+    oi.instanceId        = instanceIDs ? instanceIDs[tid] : uint32_t(tid);
+    oi.visibilityMask    = visibilityMasks ? visibilityMasks[tid] : 255;
+    oi.sbtOffset         = child.sbtOffset;
+    oi.traversableHandle = child.traversable;
+    instances[tid] = oi;
+  }
+
+  /*! fill in dd.optixInstanceBuffer by uploading whatever host data
+      the plan asks for and then running the instance assembly kernel
+      on device->stream */
+  void InstanceGroup::assembleInstancesOn(const DeviceContext::SP &device,
+                                          const InstanceBuildPlan &plan)
+  {
+    DeviceData &dd = getDD(device);
+    const size_t numInstances = children.size();
+    assert(plan.assembleOnDevice);
+    assert(plan.numChildren == numInstances);
+
+    // ------------------------------------------------------------------
+    // child table - the only thing we have to re-do on the host if
+    // the children (or their traversables) change
+    // ------------------------------------------------------------------
+    if (plan.rebuildChildTable) {
+      std::vector<ChildRecord> childTable(numInstances);
+      for (size_t childID=0;childID<numInstances;childID++) {
+        Group::SP child = children[childID];
+        assert(child);
+        ChildRecord &rec = childTable[childID];
+        rec.traversable = child->getTraversable(device);
+        rec.sbtOffset   = context->numRayTypes * child->getSBTOffset();
+        rec.pad         = 0;
+        assert(rec.traversable);
+      }
+      if (dd.childTable.size() != childTable.size()*sizeof(ChildRecord))
+        dd.childTable.alloc(childTable.size()*sizeof(ChildRecord));
+      dd.childTable.upload(childTable.data(),"instance child table");
+    }
+
+    // ------------------------------------------------------------------
+    // host-side fields that are used alongside device-side ones
+    // ------------------------------------------------------------------
+    if (plan.uploadTransforms) {
+      assert(transforms[0].size() == numInstances);
+      if (dd.hostTransforms.size() != numInstances*sizeof(affine3f))
+        dd.hostTransforms.alloc(numInstances*sizeof(affine3f));
+      dd.hostTransforms.uploadAsync(transforms[0].data(),device->stream);
+    }
+    if (plan.uploadInstanceIDs) {
+      assert(instanceIDs.size() == numInstances);
+      if (dd.hostInstanceIDs.size() != numInstances*sizeof(uint32_t))
+        dd.hostInstanceIDs.alloc(numInstances*sizeof(uint32_t));
+      dd.hostInstanceIDs.uploadAsync(instanceIDs.data(),device->stream);
+    }
+    if (plan.uploadVisibilityMasks) {
+      assert(visibilityMasks.size() == numInstances);
+      if (dd.hostVisibilityMasks.size() != numInstances*sizeof(uint8_t))
+        dd.hostVisibilityMasks.alloc(numInstances*sizeof(uint8_t));
+      dd.hostVisibilityMasks.uploadAsync(visibilityMasks.data(),device->stream);
+    }
+
+    // ------------------------------------------------------------------
+    // resolve where each field comes from
+    // ------------------------------------------------------------------
+    const float *d_transforms = nullptr;
+    bool transformsAreRowMajor = false;
+    if (plan.transforms == INSTANCE_FIELD_BUFFER) {
+      assert(transformsBuffer);
+      if (transformsBuffer->sizeInBytes() < numInstances*12*sizeof(float))
+        OWL_RAISE("transforms buffer of instance group is too small "
+                  "for the group's number of children");
+      d_transforms = (const float *)transformsBuffer->getPointer(device);
+      transformsAreRowMajor
+        = (transformsBufferFormat == OWL_MATRIX_FORMAT_ROW_MAJOR);
+    } else if (plan.transforms == INSTANCE_FIELD_HOST)
+      d_transforms = (const float *)dd.hostTransforms.get();
+
+    const uint32_t *d_instanceIDs = nullptr;
+    if (plan.instanceIDs == INSTANCE_FIELD_BUFFER) {
+      assert(instanceIDsBuffer);
+      if (instanceIDsBuffer->sizeInBytes() < numInstances*sizeof(uint32_t))
+        OWL_RAISE("instance IDs buffer of instance group is too small "
+                  "for the group's number of children");
+      d_instanceIDs = (const uint32_t *)instanceIDsBuffer->getPointer(device);
+    } else if (plan.instanceIDs == INSTANCE_FIELD_HOST)
+      d_instanceIDs = (const uint32_t *)dd.hostInstanceIDs.get();
+
+    const uint8_t *d_visibilityMasks = nullptr;
+    if (plan.visibilityMasks == INSTANCE_FIELD_BUFFER) {
+      assert(visibilityMasksBuffer);
+      if (visibilityMasksBuffer->sizeInBytes() < numInstances*sizeof(uint8_t))
+        OWL_RAISE("visibility masks buffer of instance group is too small "
+                  "for the group's number of children");
+      d_visibilityMasks = (const uint8_t *)visibilityMasksBuffer->getPointer(device);
+    } else if (plan.visibilityMasks == INSTANCE_FIELD_HOST)
+      d_visibilityMasks = (const uint8_t *)dd.hostVisibilityMasks.get();
+
+    // ------------------------------------------------------------------
+    // and assemble - this stays on the device, and in the same
+    // stream as the accel build/refit that consumes it
+    // ------------------------------------------------------------------
+    const size_t instanceBufferSize = numInstances*sizeof(OptixInstance);
+    if (dd.optixInstanceBuffer.size() != instanceBufferSize) {
+      if (Context::useManagedMemForAccelAux)
+        dd.optixInstanceBuffer.allocManaged(instanceBufferSize);
+      else
+        dd.optixInstanceBuffer.alloc(instanceBufferSize);
+    }
+    if (numInstances == 0) return;
+
+    const int numThreads = 128;
+    const int numBlocks  = int(owl::common::divRoundUp((uint64_t)numInstances,
+                                                             (uint64_t)numThreads));
+    assembleOptixInstances<<<numBlocks,numThreads,0,device->stream>>>
+      ((OptixInstance *)dd.optixInstanceBuffer.get(),
+       (const ChildRecord *)dd.childTable.get(),
+       d_transforms,
+       (int)transformsAreRowMajor,
+       d_instanceIDs,
+       d_visibilityMasks,
+       numInstances);
+    OWL_CUDA_CHECK(cudaGetLastError());
+  }
+
+} // ::owl
@@ -0,0 +1,153 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "DeviceContext.h"
+#include "GeomBoundsBatch.h"
+
+namespace owl {
+
+  /*! reduce a box across all threads of a warp; result is valid in
+      lane 0 */
+  inline __device__ void warpReduce(box3f &box)
+  {
+    for (int delta=16;delta>0;delta/=2) {
+      box.lower.x = fminf(box.lower.x,__shfl_down_sync(0xffffffff,box.lower.x,delta));
+      box.lower.y = fminf(box.lower.y,__shfl_down_sync(0xffffffff,box.lower.y,delta));
+      box.lower.z = fminf(box.lower.z,__shfl_down_sync(0xffffffff,box.lower.z,delta));
+      box.upper.x = fmaxf(box.upper.x,__shfl_down_sync(0xffffffff,box.upper.x,delta));
+      box.upper.y = fmaxf(box.upper.y,__shfl_down_sync(0xffffffff,box.upper.y,delta));
+      box.upper.z = fmaxf(box.upper.z,__shfl_down_sync(0xffffffff,box.upper.z,delta));
+    }
+  }
+
+  /*! reduce the two (one per motion key) boxes across all threads of
+      a block; results are valid in thread 0. all threads of the
+      block have to call this */
+  inline __device__ void blockReduce(box3f boxes[2])
+  {
+    enum { numWarps = GeomBoundsBatch::threadsPerBlock/32 };
+    __shared__ float warpBoxes[2][6][numWarps];
+
+    const int lane = threadIdx.x % 32;
+    const int warp = threadIdx.x / 32;
+    for (int key=0;key<2;key++) {
+      warpReduce(boxes[key]);
+      if (lane == 0) {
+        warpBoxes[key][0][warp] = boxes[key].lower.x;
+        warpBoxes[key][1][warp] = boxes[key].lower.y;
+        warpBoxes[key][2][warp] = boxes[key].lower.z;
+        warpBoxes[key][3][warp] = boxes[key].upper.x;
+        warpBoxes[key][4][warp] = boxes[key].upper.y;
+        warpBoxes[key][5][warp] = boxes[key].upper.z;
+      }
+    }
+    __syncthreads();
+    if (warp != 0) return;
+
+    for (int key=0;key<2;key++) {
+      boxes[key] = box3f();
+      if (lane < numWarps) {
+        boxes[key].lower = vec3f(warpBoxes[key][0][lane],
+                                 warpBoxes[key][1][lane],
+                                 warpBoxes[key][2][lane]);
+        boxes[key].upper = vec3f(warpBoxes[key][3][lane],
+                                 warpBoxes[key][4][lane],
+                                 warpBoxes[key][5][lane]);
+      }
+      warpReduce(boxes[key]);
+    }
+  }
+
+  /*! stage 1: each block reduces one range of items of one job into
+      one partial box per motion key */
+  __global__ void reduceGeomBoundsBlocks(box3f *partials,
+                                         const GeomBoundsJob *jobs,
+                                         const int32_t *blockJobs)
+  {
+    const int blockID = blockIdx.x;
+    const GeomBoundsJob &job = jobs[blockJobs[blockID]];
+    uint64_t begin, end;
+    job.getItemRange(blockID,begin,end);
+
+    box3f boxes[2];
+    for (uint64_t i=begin+threadIdx.x;i<end;i+=blockDim.x)
+      for (int key=0;key<job.numKeys;key++)
+        boxes[key].extend(job.getItem(key,i));
+
+    blockReduce(boxes);
+    if (threadIdx.x == 0) {
+      partials[2*blockID+0] = boxes[0];
+      partials[2*blockID+1] = boxes[1];
+    }
+  }
+
+  /*! stage 2: each block reduces all partial boxes of one job into
+      that job's final bounds */
+  __global__ void reduceGeomBoundsJobs(box3f *results,
+                                       const box3f *partials,
+                                       const GeomBoundsJob *jobs)
+  {
+    const int jobID = blockIdx.x;
+    const GeomBoundsJob &job = jobs[jobID];
+
+    box3f boxes[2];
+    for (int blockID=job.firstBlock+threadIdx.x;
+         blockID<job.firstBlock+job.numBlocks;
+         blockID+=blockDim.x) {
+      boxes[0].extend(partials[2*blockID+0]);
+      boxes[1].extend(partials[2*blockID+1]);
+    }
+
+    blockReduce(boxes);
+    if (threadIdx.x == 0) {
+      results[2*jobID+0] = boxes[0];
+      results[2*jobID+1] = (job.numKeys == 2) ? boxes[1] : boxes[0];
+    }
+  }
+
+  void DeviceContext::computeGeomBounds(const GeomBoundsBatch &batch,
+                                        box3f *results)
+  {
+    if (batch.numJobs() == 0) return;
+
+    SetActiveGPU forLifeTime(this);
+    const GeomBoundsBatch::Layout layout = batch.getLayout();
+    if (boundsScratch.size() < layout.totalSize)
+      boundsScratch.alloc(layout.totalSize);
+
+    uint8_t *scratch = (uint8_t *)boundsScratch.get();
+    const std::vector<uint8_t> header = batch.getHeader();
+    OWL_CUDA_CHECK(cudaMemcpyAsync(scratch,header.data(),header.size(),
+                                   cudaMemcpyHostToDevice,stream));
+
+    const GeomBoundsJob *d_jobs = (const GeomBoundsJob *)(scratch+layout.jobsOffset);
+    const int32_t *d_blockJobs  = (const int32_t *)(scratch+layout.blockJobsOffset);
+    box3f *d_partials = (box3f *)(scratch+layout.partialsOffset);
+    box3f *d_results  = (box3f *)(scratch+layout.resultsOffset);
+
+    if (batch.numBlocks() > 0)
+      reduceGeomBoundsBlocks
+        <<<batch.numBlocks(),GeomBoundsBatch::threadsPerBlock,0,stream>>>
+        (d_partials,d_jobs,d_blockJobs);
+    reduceGeomBoundsJobs
+      <<<batch.numJobs(),GeomBoundsBatch::threadsPerBlock,0,stream>>>
+      (d_results,d_partials,d_jobs);
+    OWL_CUDA_CHECK(cudaMemcpyAsync(results,d_results,layout.resultsSize,
+                                   cudaMemcpyDeviceToHost,stream));
+    OWL_CUDA_CHECK(cudaStreamSynchronize(stream));
+  }
+
+} // ::owl
@@ -0,0 +1,250 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file GeomBoundsBatch.h describes a batch of "compute the bounds of
+    this geometry" jobs (for one or two motion keys each), and how
+    those get split into thread blocks for a two-stage reduction: in
+    stage 1, each block reduces a fixed-size range of one job's items
+    into one partial box per key; in stage 2, each job reduces its
+    blocks' partial boxes into its final bounds. This file does not
+    depend on CUDA, so the batching logic can be tested on the host
+    (computeOnHost() runs the exact same two stages there); the
+    actual kernels live in GeomBounds.cu */
+
+#include "owl/common/math/box.h"
+#include <vector>
+#include <cstring>
+
+namespace owl {
+
+  using owl::common::vec3f;
+  using owl::common::box3f;
+
+  /*! one geometry whose bounds get computed as part of a batch. This
+      struct gets uploaded as is, so has to be the same on host and
+      device */
+  struct GeomBoundsJob {
+    typedef enum {
+      /*! items are vec3f vertices, using the same count/stride/offset
+          semantics as TrianglesGeom::vertex */
+      VERTICES = 0,
+      /*! items are box3f's as written by a user geom's bounds
+          program; empty boxes get ignored */
+      PRIM_BOUNDS
+    } Kind;
+
+    /*! returns the bounds of item i in motion key 'key' */
+    inline __both__ box3f getItem(int key, uint64_t i) const;
+
+    /*! range of items that the given (global) stage-1 block of this
+        job reduces */
+    inline __both__ void getItemRange(int blockID,
+                                      uint64_t &begin,
+                                      uint64_t &end) const;
+
+    /*! base pointers for the (up to two) motion keys */
+    const uint8_t *keys[2];
+    uint64_t count;
+    uint64_t stride;
+    uint64_t offset;
+    int32_t  kind;
+    int32_t  numKeys;
+    /*! first stage-1 block (within the entire batch) working on this
+        job, and how many blocks do */
+    int32_t  firstBlock;
+    int32_t  numBlocks;
+  };
+
+  /*! a batch of bounds computations that all get done in a single
+      launch (per stage); results are written as two boxes (one per
+      motion key) per job, with key 1 replicating key 0 for jobs that
+      only have one key */
+  struct GeomBoundsBatch {
+    enum {
+      /*! threads per block, in both stages */
+      threadsPerBlock = 256,
+      /*! number of items each thread in stage 1 reduces */
+      itemsPerThread  = 16,
+      itemsPerBlock   = threadsPerBlock*itemsPerThread
+    };
+
+    /*! where the different arrays live within the (per-device)
+        scratch memory; the first 'headerSize' bytes are what
+        getHeader() produces, and have to be uploaded before
+        launching. all offsets are in bytes */
+    struct Layout {
+      size_t jobsOffset;
+      size_t blockJobsOffset;
+      size_t headerSize;
+      size_t partialsOffset;
+      size_t resultsOffset;
+      size_t resultsSize;
+      size_t totalSize;
+    };
+
+    /*! add a vertex array, with one or two (if key1 is non-null)
+        motion keys; returns the job's ID */
+    int addVertices(const void *key0, const void *key1,
+                    size_t count, size_t stride, size_t offset);
+
+    /*! add an array of prim bounds (as written by a user geometry's
+        bounds program), with one or two (if key1 is non-null) motion
+        keys; returns the job's ID */
+    int addPrimBounds(const box3f *key0, const box3f *key1, size_t count);
+
+    int numJobs()   const { return (int)jobs.size(); }
+    int numBlocks() const { return (int)blockJobs.size(); }
+
+    /*! compute where everything lives in the scratch memory */
+    Layout getLayout() const;
+
+    /*! the bytes that go into the first layout.headerSize bytes of
+        the scratch memory */
+    std::vector<uint8_t> getHeader() const;
+
+    /*! runs both stages on the host, on host pointers; results must
+        have room for 2*numJobs() boxes */
+    void computeOnHost(box3f *results) const;
+
+    std::vector<GeomBoundsJob> jobs;
+    /*! for each stage-1 block, the job it works on */
+    std::vector<int32_t>       blockJobs;
+
+  private:
+    int addJob(GeomBoundsJob job);
+  };
+
+  // ------------------------------------------------------------------
+  // implementation section
+  // ------------------------------------------------------------------
+
+  inline __both__ box3f GeomBoundsJob::getItem(int key, uint64_t i) const
+  {
+    const uint8_t *ptr = keys[key] + offset + i*stride;
+    if (kind == VERTICES)
+      return box3f(*(const vec3f *)ptr);
+    const box3f box = *(const box3f *)ptr;
+    return box.empty() ? box3f() : box;
+  }
+
+  inline __both__ void GeomBoundsJob::getItemRange(int blockID,
+                                                   uint64_t &begin,
+                                                   uint64_t &end) const
+  {
+    begin = uint64_t(blockID-firstBlock)*GeomBoundsBatch::itemsPerBlock;
+    end   = begin + GeomBoundsBatch::itemsPerBlock;
+    if (end > count) end = count;
+  }
+
+  inline int GeomBoundsBatch::addJob(GeomBoundsJob job)
+  {
+    const int jobID = numJobs();
+    job.firstBlock = numBlocks();
+    job.numBlocks  = int((job.count + itemsPerBlock - 1) / itemsPerBlock);
+    for (int i=0;i<job.numBlocks;i++)
+      blockJobs.push_back(jobID);
+    jobs.push_back(job);
+    return jobID;
+  }
+
+  inline int GeomBoundsBatch::addVertices(const void *key0, const void *key1,
+                                          size_t count, size_t stride,
+                                          size_t offset)
+  {
+    GeomBoundsJob job;
+    job.keys[0] = (const uint8_t *)key0;
+    job.keys[1] = (const uint8_t *)(key1 ? key1 : key0);
+    job.count   = count;
+    job.stride  = stride;
+    job.offset  = offset;
+    job.kind    = GeomBoundsJob::VERTICES;
+    job.numKeys = key1 ? 2 : 1;
+    return addJob(job);
+  }
+
+  inline int GeomBoundsBatch::addPrimBounds(const box3f *key0,
+                                            const box3f *key1,
+                                            size_t count)
+  {
+    GeomBoundsJob job;
+    job.keys[0] = (const uint8_t *)key0;
+    job.keys[1] = (const uint8_t *)(key1 ? key1 : key0);
+    job.count   = count;
+    job.stride  = sizeof(box3f);
+    job.offset  = 0;
+    job.kind    = GeomBoundsJob::PRIM_BOUNDS;
+    job.numKeys = key1 ? 2 : 1;
+    return addJob(job);
+  }
+
+  inline GeomBoundsBatch::Layout GeomBoundsBatch::getLayout() const
+  {
+    auto align = [](size_t offset) { return (offset + 15) & ~size_t(15); };
+    Layout layout;
+    layout.jobsOffset      = 0;
+    layout.blockJobsOffset = align(layout.jobsOffset
+                                   + jobs.size()*sizeof(GeomBoundsJob));
+    layout.headerSize      = layout.blockJobsOffset
+                           + blockJobs.size()*sizeof(int32_t);
+    layout.partialsOffset  = align(layout.headerSize);
+    layout.resultsOffset   = align(layout.partialsOffset
+                                   + 2*blockJobs.size()*sizeof(box3f));
+    layout.resultsSize     = 2*jobs.size()*sizeof(box3f);
+    layout.totalSize       = layout.resultsOffset + layout.resultsSize;
+    return layout;
+  }
+
+  inline std::vector<uint8_t> GeomBoundsBatch::getHeader() const
+  {
+    const Layout layout = getLayout();
+    std::vector<uint8_t> header(layout.headerSize);
+    if (!jobs.empty())
+      memcpy(header.data()+layout.jobsOffset,jobs.data(),
+             jobs.size()*sizeof(GeomBoundsJob));
+    if (!blockJobs.empty())
+      memcpy(header.data()+layout.blockJobsOffset,blockJobs.data(),
+             blockJobs.size()*sizeof(int32_t));
+    return header;
+  }
+
+  inline void GeomBoundsBatch::computeOnHost(box3f *results) const
+  {
+    // stage 1: one pair of partial boxes per block
+    std::vector<box3f> partials(2*numBlocks());
+    for (int blockID=0;blockID<numBlocks();blockID++) {
+      const GeomBoundsJob &job = jobs[blockJobs[blockID]];
+      uint64_t begin, end;
+      job.getItemRange(blockID,begin,end);
+      for (uint64_t i=begin;i<end;i++)
+        for (int key=0;key<job.numKeys;key++)
+          partials[2*blockID+key].extend(job.getItem(key,i));
+    }
+    // stage 2: one pair of final boxes per job
+    for (int jobID=0;jobID<numJobs();jobID++) {
+      const GeomBoundsJob &job = jobs[jobID];
+      box3f bounds[2];
+      for (int blockID=job.firstBlock;
+           blockID<job.firstBlock+job.numBlocks;blockID++)
+        for (int key=0;key<2;key++)
+          bounds[key].extend(partials[2*blockID+key]);
+      results[2*jobID+0] = bounds[0];
+      results[2*jobID+1] = job.numKeys == 2 ? bounds[1] : bounds[0];
+    }
+  }
+
+} // ::owl
@@ -64,7 +64,14 @@ namespace owl {
     
     /*! re*fit* this accel - actual work depens on subclass */
     virtual void refitAccel() = 0;
-    
+
+    /*! (re-)compute this group's bounds; by default that only
+        happens during builds with motion blur enabled, so other users
+        of the bounds (such as instance culling) can request it
+        explicitly. Groups that cannot compute their bounds leave them
+        empty */
+    virtual void updateMotionBounds() {}
+
     /*! return the SBT offset (ie, the offset at which the geometries
         within this group will be written into the Shader Binding
         Table) */
@@ -92,8 +99,13 @@ namespace owl {
       memPeak  = dd.memPeak;
     }
 
-    /*! bounding box for t=0 and t=1; for motion blur. */
-    box3f bounds[2];
+    /*! bounds over all times; empty if not (yet) known */
+    inline box3f getBounds() const;
+
+    /*! bounding boxes for motion blur, one per motion key (evenly
+        spaced over t=0..1, see owl/common/math/motion.h); empty if
+        not (yet) known */
+    std::vector<box3f> bounds;
   };
 
   /*! a group containing geometries (ie, BLASes, whereas the
@@ -142,5 +154,16 @@ namespace owl {
   /*! returns the (device-specific) optix traversable handle to traverse this group */
   inline OptixTraversableHandle Group::getTraversable(const DeviceContext::SP &device) const
   { return getDD(device).traversable; }
+
+  /*! bounds over all times; empty if not (yet) known */
+  inline box3f Group::getBounds() const
+  {
+    box3f result;
+    for (auto &key : bounds) {
+      if (key.empty()) return box3f();
+      result.extend(key);
+    }
+    return result;
+  }
   
 } // ::owl
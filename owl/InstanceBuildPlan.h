@@ -0,0 +1,193 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file InstanceBuildPlan.h decides, for an instance group, where the
+    per-instance fields (transforms, instance IDs, visibility masks)
+    come from, and what has to be re-uploaded to a given device before
+    its OptixInstance array can be assembled. Deliberately free of any
+    cuda/optix types so this logic can be tested on the host. */
+
+#include "owl/common/owl-common.h"
+#include <stdint.h>
+
+namespace owl {
+
+  /*! where the values of one of the per-instance fields of an
+      instance group come from */
+  typedef enum {
+    /*! not specified: unit transform, instanceID=childID, and
+        visibility mask 255, respectively */
+    INSTANCE_FIELD_DEFAULT = 0,
+    /*! a host-side array set through the regular
+        owlInstanceGroupSet... calls */
+    INSTANCE_FIELD_HOST,
+    /*! a user-supplied OWLBuffer that already lives on the
+        device(s) */
+    INSTANCE_FIELD_BUFFER
+  } InstanceFieldSource;
+
+  /*! host-side state of one per-instance field */
+  struct InstanceField {
+    InstanceFieldSource source  = INSTANCE_FIELD_DEFAULT;
+    /*! bumped every time the field's values (or its source) change */
+    uint64_t            version = 0;
+  };
+
+  /*! everything an instance group tracks about where its instance
+      data comes from */
+  struct InstanceSources {
+    InstanceSources() { transforms.source = INSTANCE_FIELD_HOST; }
+
+    /*! true if any of the fields lives in a device buffer, in which
+        case the instance records get assembled on the device */
+    inline bool anyOnDevice() const
+    {
+      return
+        transforms.source      == INSTANCE_FIELD_BUFFER ||
+        instanceIDs.source     == INSTANCE_FIELD_BUFFER ||
+        visibilityMasks.source == INSTANCE_FIELD_BUFFER;
+    }
+
+    InstanceField transforms;
+    InstanceField instanceIDs;
+    InstanceField visibilityMasks;
+
+    /*! bumped every time a child gets set */
+    uint64_t      childrenVersion = 0;
+  };
+
+  /*! what a given device currently has in its memory for a given
+      instance group (ie, which versions of the host-side arrays and
+      of the child table were last uploaded to it) */
+  struct InstanceDeviceState {
+    uint64_t childrenVersion        = uint64_t(-1);
+    size_t   childTableSize         = 0;
+    uint64_t transformsVersion      = uint64_t(-1);
+    uint64_t instanceIDsVersion     = uint64_t(-1);
+    uint64_t visibilityMasksVersion = uint64_t(-1);
+  };
+
+  /*! the plan for assembling the OptixInstance array of one instance
+      group on one device */
+  struct InstanceBuildPlan {
+
+    /*! compute the plan for a (re-)build or refit of an instance
+        group with given sources and number of children, on a device
+        that currently has the given state */
+    static inline InstanceBuildPlan compute(const InstanceSources &sources,
+                                            size_t numChildren,
+                                            const InstanceDeviceState &state,
+                                            bool fullRebuild);
+
+    /*! update the device state to reflect that this plan has been
+        executed on that device */
+    inline void commit(InstanceDeviceState &state) const;
+
+    InstanceFieldSource transforms      = INSTANCE_FIELD_HOST;
+    InstanceFieldSource instanceIDs     = INSTANCE_FIELD_DEFAULT;
+    InstanceFieldSource visibilityMasks = INSTANCE_FIELD_DEFAULT;
+
+    /*! if true, the OptixInstance array gets assembled by a kernel
+        from device-side data; otherwise it gets assembled on the host
+        and uploaded (the original code path) */
+    bool assembleOnDevice      = false;
+
+    /*! whether the table of child traversables and sbt offsets has to
+        be rebuilt on the host and uploaded; only used if
+        assembleOnDevice */
+    bool rebuildChildTable     = false;
+
+    /*! @{ whether the host-side array for that field has to be
+        uploaded to the device before the assembly kernel can run;
+        only used if assembleOnDevice */
+    bool uploadTransforms      = false;
+    bool uploadInstanceIDs     = false;
+    bool uploadVisibilityMasks = false;
+    /*! @} */
+
+    /*! @{ the versions that the device will have after the plan is
+        executed */
+    size_t   numChildren            = 0;
+    uint64_t childrenVersion        = 0;
+    uint64_t transformsVersion      = 0;
+    uint64_t instanceIDsVersion     = 0;
+    uint64_t visibilityMasksVersion = 0;
+    /*! @} */
+  };
+
+  // ------------------------------------------------------------------
+  // implementation section
+  // ------------------------------------------------------------------
+
+  inline InstanceBuildPlan
+  InstanceBuildPlan::compute(const InstanceSources &sources,
+                             size_t numChildren,
+                             const InstanceDeviceState &state,
+                             bool fullRebuild)
+  {
+    InstanceBuildPlan plan;
+    plan.transforms             = sources.transforms.source;
+    plan.instanceIDs            = sources.instanceIDs.source;
+    plan.visibilityMasks        = sources.visibilityMasks.source;
+    plan.numChildren            = numChildren;
+    plan.childrenVersion        = sources.childrenVersion;
+    plan.transformsVersion      = sources.transforms.version;
+    plan.instanceIDsVersion     = sources.instanceIDs.version;
+    plan.visibilityMasksVersion = sources.visibilityMasks.version;
+
+    plan.assembleOnDevice = sources.anyOnDevice();
+    if (!plan.assembleOnDevice)
+      return plan;
+
+    /* children may have been rebuilt (and changed their traversable)
+       since the last time we built, so full rebuilds always re-create
+       the child table; refits only do so if the children changed */
+    plan.rebuildChildTable
+      =  fullRebuild
+      || state.childrenVersion != sources.childrenVersion
+      || state.childTableSize  != numChildren;
+
+    const bool sizeChanged = state.childTableSize != numChildren;
+    plan.uploadTransforms
+      =  plan.transforms == INSTANCE_FIELD_HOST
+      && (sizeChanged || state.transformsVersion != sources.transforms.version);
+    plan.uploadInstanceIDs
+      =  plan.instanceIDs == INSTANCE_FIELD_HOST
+      && (sizeChanged || state.instanceIDsVersion != sources.instanceIDs.version);
+    plan.uploadVisibilityMasks
+      =  plan.visibilityMasks == INSTANCE_FIELD_HOST
+      && (sizeChanged || state.visibilityMasksVersion != sources.visibilityMasks.version);
+    return plan;
+  }
+
+  inline void InstanceBuildPlan::commit(InstanceDeviceState &state) const
+  {
+    if (!assembleOnDevice) {
+      /* host path does not leave anything on the device that a later
+         device-side assembly could re-use */
+      state = InstanceDeviceState();
+      return;
+    }
+    state.childrenVersion        = childrenVersion;
+    state.childTableSize         = numChildren;
+    state.transformsVersion      = transformsVersion;
+    state.instanceIDsVersion     = instanceIDsVersion;
+    state.visibilityMasksVersion = visibilityMasksVersion;
+  }
+
+} // ::owl
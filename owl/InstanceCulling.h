@@ -0,0 +1,445 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file InstanceCulling.h host-side frustum/distance culling and LOD
+    selection for instance groups. Runs before the IAS build, and
+    turns the full list of instances into a compacted list of
+    (instance,LOD level) pairs. Free of any cuda/optix types so it can
+    be tested on the host. */
+
+#include "owl/common/math/box.h"
+#include "owl/common/math/AffineSpace.h"
+#include "owl/common/math/boundsReduction.h"
+#include "owl/common/math/morton.h"
+#include "owl/common/parallel/parallel_for.h"
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace owl {
+
+  using owl::common::vec3f;
+  using owl::common::vec3i;
+  using owl::common::vec4f;
+  using owl::common::box3f;
+  using owl::common::affine3f;
+
+  /*! what the culling stage needs to know about the camera */
+  struct CullingView {
+    /*! compute view from the usual pinhole-camera parameters */
+    static inline CullingView fromCamera(const vec3f &eye,
+                                         const vec3f &at,
+                                         const vec3f &up,
+                                         float fovyInDegrees,
+                                         float aspect,
+                                         float nearDist,
+                                         float farDist);
+
+    vec3f eye { 0.f, 0.f, 0.f };
+
+    /*! frustum planes (xyz=normal pointing into the frustum, w=offset),
+        a point p is inside if dot(n,p)+w >= 0 for all planes */
+    vec4f planes[6];
+    int   numPlanes = 0;
+
+    /*! all distances get multiplied by this before getting compared
+        to the LOD thresholds - allows for adjusting LOD selection to
+        resolution and field of view without re-specifying LODs */
+    float lodScale = 1.f;
+  };
+
+  /*! classification of a box relative to a frustum */
+  typedef enum { CULL_OUTSIDE, CULL_PARTIAL, CULL_INSIDE } CullResult;
+
+  /*! hierarchical instance culler. build() has to be re-run only when
+      transforms, bounds, or LODs change; select() is cheap, and is
+      what gets run every time the camera moves */
+  struct InstanceCuller {
+
+    /*! one instance that survived culling, and the LOD level it
+        should use */
+    struct Selection {
+      inline bool operator==(const Selection &other) const
+      { return instance == other.instance && lod == other.lod; }
+      
+      uint32_t instance;
+      uint32_t lod;
+    };
+
+    /*! (re-)build the instance hierarchy.
+
+      \param objectBounds object-space bounds of each instance's
+      (finest) LOD; an empty box means 'unknown', and such instances
+      never get frustum culled.
+
+      \param lodBegin if non-null, array of numInstances+1 offsets,
+      such that lodMaxDistances[lodBegin[i]..lodBegin[i+1]) are the
+      (increasing) distances up to which instance i uses LOD level 0,
+      1, ...; instances farther away than their last threshold get
+      culled. Instances without any thresholds always use level 0.
+    */
+    inline void build(size_t numInstances,
+                      const affine3f *transforms,
+                      const box3f    *objectBounds,
+                      const uint32_t *lodBegin,
+                      const float    *lodMaxDistances);
+
+    /*! compute list of visible instances (in increasing instance
+        order) for given view */
+    inline void select(const CullingView &view,
+                       std::vector<Selection> &result) const;
+
+    /*! number of instances in the last build() */
+    size_t numInstances() const { return lodOf.size(); }
+
+    /*! number of nodes in the culling hierarchy (for testing) */
+    size_t numNodes() const { return nodes.size(); }
+
+    /*! max number of instances per leaf */
+    enum { clusterSize = 64 };
+
+    /*! @{ helper functions, public so they can be tested */
+    static inline CullResult classify(const CullingView &view, const box3f &box);
+    static inline float distance(const vec3f &p, const box3f &box);
+    /*! @} */
+
+  private:
+    /*! node of the culling hierarchy, a binary tree over the
+        morton-sorted instances. Every node covers a range of
+        sortedIDs; inner nodes split that range in two, leaves
+        (child==0) hold at most clusterSize instances */
+    struct Node {
+      box3f    bounds;
+      /*! largest LOD threshold of any instance in this subtree -
+          anything farther away is culled for sure */
+      float    maxDistance;
+      uint32_t begin, end;
+      /*! index of the first of two consecutive children, or 0 for
+          leaves (the root is never anybody's child) */
+      uint32_t child;
+    };
+
+    /*! per instance: world-space bounds (empty if unknown) */
+    std::vector<box3f>    worldBounds;
+    /*! per instance: LOD thresholds, copied from the input */
+    std::vector<uint32_t> lodBegin;
+    std::vector<float>    lodMaxDistances;
+    /*! instance indices, sorted along the morton curve */
+    std::vector<uint32_t> sortedIDs;
+    /*! the hierarchy; children always come after their parent */
+    std::vector<Node>     nodes;
+    /*! instances with unknown bounds, and their origins */
+    std::vector<uint32_t> unbounded;
+    std::vector<vec3f>    unboundedOrigins;
+    /*! scratch space for select() - selected LOD per instance, or -1 */
+    mutable std::vector<int> lodOf;
+  };
+
+  // ------------------------------------------------------------------
+  // implementation section
+  // ------------------------------------------------------------------
+
+  inline CullingView CullingView::fromCamera(const vec3f &eye,
+                                             const vec3f &at,
+                                             const vec3f &up,
+                                             float fovyInDegrees,
+                                             float aspect,
+                                             float nearDist,
+                                             float farDist)
+  {
+    CullingView view;
+    view.eye = eye;
+
+    const vec3f dir   = normalize(at-eye);
+    const vec3f right = normalize(cross(dir,up));
+    const vec3f upv   = cross(right,dir);
+    const float tanY  = tanf(.5f*fovyInDegrees*float(M_PI)/180.f);
+    const float tanX  = tanY*aspect;
+
+    /* side planes all go through the eye; their inward normals are
+       chosen such that the view direction itself is inside, and the
+       frustum's edge directions are on the plane */
+    const vec3f normals[4] = {
+      normalize(dir*tanX - right),
+      normalize(dir*tanX + right),
+      normalize(dir*tanY - upv),
+      normalize(dir*tanY + upv)
+    };
+    for (int i=0;i<4;i++)
+      view.planes[view.numPlanes++] = vec4f(normals[i],-dot(normals[i],eye));
+    if (nearDist > 0.f)
+      view.planes[view.numPlanes++] = vec4f(dir,-dot(dir,eye+nearDist*dir));
+    if (farDist > 0.f)
+      view.planes[view.numPlanes++] = vec4f(-dir,dot(dir,eye+farDist*dir));
+    return view;
+  }
+
+  inline CullResult InstanceCuller::classify(const CullingView &view,
+                                             const box3f &box)
+  {
+    CullResult result = CULL_INSIDE;
+    for (int i=0;i<view.numPlanes;i++) {
+      const vec4f &plane = view.planes[i];
+      const vec3f n(plane.x,plane.y,plane.z);
+      // the box corners farthest along, and against, the normal
+      const vec3f pos(n.x >= 0.f ? box.upper.x : box.lower.x,
+                      n.y >= 0.f ? box.upper.y : box.lower.y,
+                      n.z >= 0.f ? box.upper.z : box.lower.z);
+      const vec3f neg(n.x >= 0.f ? box.lower.x : box.upper.x,
+                      n.y >= 0.f ? box.lower.y : box.upper.y,
+                      n.z >= 0.f ? box.lower.z : box.upper.z);
+      if (dot(n,pos)+plane.w < 0.f) return CULL_OUTSIDE;
+      if (dot(n,neg)+plane.w < 0.f) result = CULL_PARTIAL;
+    }
+    return result;
+  }
+
+  inline float InstanceCuller::distance(const vec3f &p, const box3f &box)
+  {
+    const vec3f closest = max(box.lower,min(p,box.upper));
+    return length(closest-p);
+  }
+
+  inline void InstanceCuller::build(size_t numInstances,
+                                    const affine3f *transforms,
+                                    const box3f    *objectBounds,
+                                    const uint32_t *_lodBegin,
+                                    const float    *_lodMaxDistances)
+  {
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    worldBounds.resize(numInstances);
+    lodOf.resize(numInstances);
+    lodBegin.resize(numInstances+1);
+    if (_lodBegin) {
+      std::copy(_lodBegin,_lodBegin+numInstances+1,lodBegin.begin());
+      lodMaxDistances.assign(_lodMaxDistances,
+                             _lodMaxDistances+lodBegin[numInstances]);
+    } else {
+      std::fill(lodBegin.begin(),lodBegin.end(),0u);
+      lodMaxDistances.clear();
+    }
+
+    owl::common::parallel_for_blocked
+      (0,numInstances,1024,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++)
+          worldBounds[i]
+            = objectBounds[i].empty()
+            ? box3f()
+            : xfmBounds(transforms[i],objectBounds[i]);
+      });
+
+    // ------------------------------------------------------------------
+    // sort bounded instances along a morton curve over their centers
+    // ------------------------------------------------------------------
+    const box3f centerBounds
+      = owl::common::parallelBoundsReduce
+      (numInstances,[&](size_t begin, size_t end){
+          box3f bounds;
+          for (size_t i=begin;i<end;i++)
+            if (!worldBounds[i].empty())
+              bounds.extend(worldBounds[i].center());
+          return bounds;
+        });
+    unbounded.clear();
+    unboundedOrigins.clear();
+    std::vector<std::pair<uint64_t,uint32_t>> codes;
+    codes.reserve(numInstances);
+    for (size_t i=0;i<numInstances;i++)
+      if (worldBounds[i].empty()) {
+        unbounded.push_back((uint32_t)i);
+        unboundedOrigins.push_back(transforms[i].p);
+      }
+
+    // 21 bits per axis is all that mortonEncode() can interleave
+    const float gridRes = float((1<<21)-1);
+    const vec3f scale
+      = gridRes / max(centerBounds.span(),vec3f(1e-20f));
+    for (size_t i=0;i<numInstances;i++) {
+      if (worldBounds[i].empty()) continue;
+      const vec3f rel
+        = min((worldBounds[i].center()-centerBounds.lower)*scale,
+              vec3f(gridRes));
+      const uint64_t code
+        = owl::common::mortonEncode(vec3i(int(rel.x),int(rel.y),int(rel.z)));
+      codes.push_back({code,(uint32_t)i});
+    }
+    std::sort(codes.begin(),codes.end());
+
+    sortedIDs.resize(codes.size());
+    for (size_t i=0;i<codes.size();i++)
+      sortedIDs[i] = codes[i].second;
+
+    // ------------------------------------------------------------------
+    // build the hierarchy top-down, splitting each range at the
+    // highest morton bit in which its first and last code differ (or
+    // in the middle if they don't differ at all)
+    // ------------------------------------------------------------------
+    nodes.clear();
+    if (codes.empty()) return;
+    nodes.push_back({box3f(),0.f,0u,uint32_t(codes.size()),0u});
+    std::vector<uint32_t> stack = { 0u };
+    while (!stack.empty()) {
+      const uint32_t nodeID = stack.back(); stack.pop_back();
+      const uint32_t begin = nodes[nodeID].begin, end = nodes[nodeID].end;
+      if (end-begin <= clusterSize) continue;
+
+      const uint64_t first = codes[begin].first, last = codes[end-1].first;
+      uint32_t split = begin+(end-begin)/2;
+      if (first != last) {
+        int bit = 63;
+        while (!((first^last) & (1ull<<bit))) --bit;
+        const uint64_t mask = 1ull<<bit;
+        split = uint32_t(std::partition_point
+                         (codes.begin()+begin,codes.begin()+end,
+                          [&](const std::pair<uint64_t,uint32_t> &c)
+                          { return !(c.first & mask); })
+                         -codes.begin());
+      }
+      const uint32_t child = uint32_t(nodes.size());
+      nodes[nodeID].child = child;
+      nodes.push_back({box3f(),0.f,begin,split,0u});
+      nodes.push_back({box3f(),0.f,split,end,0u});
+      stack.push_back(child);
+      stack.push_back(child+1);
+    }
+
+    // ------------------------------------------------------------------
+    // leaves' bounds and distances from their instances (in
+    // parallel), then inner nodes bottom-up
+    // ------------------------------------------------------------------
+    owl::common::parallel_for(nodes.size(),[&](size_t nodeID){
+        Node &node = nodes[nodeID];
+        if (node.child) return;
+        for (uint32_t j=node.begin;j<node.end;j++) {
+          const uint32_t instID = sortedIDs[j];
+          node.bounds.extend(worldBounds[instID]);
+          const uint32_t numLODs = lodBegin[instID+1]-lodBegin[instID];
+          node.maxDistance
+            = std::max(node.maxDistance,
+                       numLODs
+                       ? lodMaxDistances[lodBegin[instID+1]-1]
+                       : infinity);
+        }
+      });
+    for (size_t nodeID=nodes.size();nodeID-- > 0;) {
+      Node &node = nodes[nodeID];
+      if (!node.child) continue;
+      const Node &l = nodes[node.child], &r = nodes[node.child+1];
+      node.bounds      = box3f(l.bounds).extend(r.bounds);
+      node.maxDistance = std::max(l.maxDistance,r.maxDistance);
+    }
+  }
+
+  inline void InstanceCuller::select(const CullingView &view,
+                                     std::vector<Selection> &result) const
+  {
+    const size_t numInstances = lodOf.size();
+
+    /*! LOD level to use for given instance at given distance, or -1
+        if beyond the last LOD */
+    auto pickLOD = [&](uint32_t instID, float dist) -> int {
+      const uint32_t begin = lodBegin[instID], end = lodBegin[instID+1];
+      if (begin == end) return 0;
+      for (uint32_t k=begin;k<end;k++)
+        if (dist <= lodMaxDistances[k]) return int(k-begin);
+      return -1;
+    };
+
+    // ------------------------------------------------------------------
+    // top-down traversal of the hierarchy: subtrees that are
+    // outside (or beyond their largest LOD distance) get culled as a
+    // whole, subtrees fully inside need no more frustum tests; what
+    // remains is a list of instance ranges, which then get their
+    // LODs picked in parallel
+    // ------------------------------------------------------------------
+    struct WorkItem { uint32_t begin, end; CullResult cull; };
+    std::vector<WorkItem> work;
+    std::vector<std::pair<uint32_t,CullResult>> stack;
+    if (!nodes.empty())
+      stack.push_back({0u,CULL_PARTIAL});
+    while (!stack.empty()) {
+      const uint32_t   nodeID = stack.back().first;
+      CullResult       cull   = stack.back().second;
+      stack.pop_back();
+      const Node &node = nodes[nodeID];
+      if (cull != CULL_INSIDE)
+        cull = classify(view,node.bounds);
+      if (cull == CULL_OUTSIDE ||
+          view.lodScale*distance(view.eye,node.bounds) > node.maxDistance)
+        continue;
+      if (node.child) {
+        // (subtrees fully inside still get descended into, but only
+        // for the distance test)
+        stack.push_back({node.child,cull});
+        stack.push_back({node.child+1,cull});
+      } else
+        work.push_back({node.begin,node.end,cull});
+    }
+
+    owl::common::parallel_for_blocked
+      (0,numInstances,4096,[&](size_t begin, size_t end){
+        std::fill(lodOf.begin()+begin,lodOf.begin()+end,-1);
+      });
+    owl::common::parallel_for(work.size(),[&](size_t itemID){
+        const WorkItem &item = work[itemID];
+        for (uint32_t j=item.begin;j<item.end;j++) {
+          const uint32_t instID = sortedIDs[j];
+          const box3f &box = worldBounds[instID];
+          if (item.cull == CULL_PARTIAL && classify(view,box) == CULL_OUTSIDE)
+            continue;
+          lodOf[instID] = pickLOD(instID,view.lodScale*distance(view.eye,box));
+        }
+      });
+    for (size_t i=0;i<unbounded.size();i++)
+      lodOf[unbounded[i]]
+        = pickLOD(unbounded[i],view.lodScale*length(unboundedOrigins[i]-view.eye));
+
+    // ------------------------------------------------------------------
+    // compact, in parallel, in original instance order: count per
+    // block, prefix sum over blocks, then write
+    // ------------------------------------------------------------------
+    const size_t blockSize = 4096;
+    const size_t numBlocks = (numInstances+blockSize-1)/blockSize;
+    std::vector<size_t> blockOffset(numBlocks+1,0);
+    owl::common::parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numInstances);
+        size_t count = 0;
+        for (size_t i=begin;i<end;i++)
+          if (lodOf[i] >= 0) count++;
+        blockOffset[blockID+1] = count;
+      });
+    for (size_t blockID=0;blockID<numBlocks;blockID++)
+      blockOffset[blockID+1] += blockOffset[blockID];
+
+    result.resize(blockOffset[numBlocks]);
+    owl::common::parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numInstances);
+        size_t out = blockOffset[blockID];
+        for (size_t i=begin;i<end;i++)
+          if (lodOf[i] >= 0) {
+            result[out].instance = uint32_t(i);
+            result[out].lod      = uint32_t(lodOf[i]);
+            out++;
+          }
+      });
+  }
+
+} // ::owl
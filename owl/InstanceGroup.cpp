@@ -16,6 +16,8 @@
 
 #include "InstanceGroup.h"
 #include "Context.h"
+#include "owl/common/math/motion.h"
+#include <set>
 
 #define LOG(message)                                    \
   if (Context::logging())                               \
@@ -55,9 +57,10 @@ namespace owl {
       }
     }
 
+    // only one key - more only get added if we use motion blur for
+    // this object
+    transforms.resize(1);
     transforms[0].resize(children.size());
-    // do NOT automatically resize transforms[0] - need these only if
-    // we use motion blur for this object
   }
   
   
@@ -78,7 +81,18 @@ namespace owl {
                                    const affine3f &xfm)
   {
     assert(childID < children.size());
+    if (transformsBuffer)
+      // the host-side transforms of all other children are stale
+      // while a buffer is set, so silently switching back would
+      // move them
+      OWL_RAISE("cannot set the transform of a single instance while the "
+                "instance group takes its transforms from a buffer - "
+                "set the transforms buffer to null first");
     transforms[0][childID] = xfm;
+    if (useSRTMotion() && !srtTransforms[0].empty())
+      srtTransforms[0][childID] = decomposeSRT(xfm);
+    sources.transforms.source = INSTANCE_FIELD_HOST;
+    sources.transforms.version++;
   }
 
   void InstanceGroup::setTransforms(uint32_t timeStep,
@@ -87,6 +101,8 @@ namespace owl {
   {
     switch(matrixFormat) {
     case OWL_MATRIX_FORMAT_OWL: {
+      if (timeStep >= transforms.size())
+        transforms.resize(timeStep+1);
       transforms[timeStep].resize(children.size());
       memcpy((char*)transforms[timeStep].data(),floatsForThisStimeStep,
              children.size()*sizeof(affine3f));
@@ -95,6 +111,45 @@ namespace owl {
       OWL_RAISE("used matrix format not yet implmeneted for"
                 " InstanceGroup::setTransforms");
     };
+    // matrices again, so no more SRT motion
+    srtTransforms.clear();
+    if (timeStep == 0) {
+      transformsBuffer = nullptr;
+      sources.transforms.source = INSTANCE_FIELD_HOST;
+      sources.transforms.version++;
+    }
+  }
+
+  void InstanceGroup::setSRTTransforms(uint32_t timeStep,
+                                       const SRTTransform *srtsForThisTimeStep)
+  {
+    if (timeStep >= srtTransforms.size())
+      srtTransforms.resize(timeStep+1);
+    if (timeStep >= transforms.size())
+      transforms.resize(timeStep+1);
+    srtTransforms[timeStep].assign(srtsForThisTimeStep,
+                                   srtsForThisTimeStep+children.size());
+    // everything that doesn't build motion (culling, static builds)
+    // uses the matrices
+    transforms[timeStep].resize(children.size());
+    for (size_t childID=0;childID<children.size();childID++)
+      transforms[timeStep][childID] = toAffine(srtsForThisTimeStep[childID]);
+    if (timeStep == 0) {
+      transformsBuffer = nullptr;
+      sources.transforms.source = INSTANCE_FIELD_HOST;
+      sources.transforms.version++;
+    }
+  }
+
+  void InstanceGroup::setNumMotionKeys(int numKeys)
+  {
+    if (numKeys < 1)
+      OWL_RAISE("invalid number of motion keys "+std::to_string(numKeys)
+                +" (must be at least 1)");
+    transforms.resize(numKeys);
+    if (!srtTransforms.empty())
+      srtTransforms.resize(numKeys);
+    // (key 0 stays as it is, so a transforms buffer remains valid)
   }
 
   /* set instance IDs to use for the children - MUST be an array of children.size() items */
@@ -102,6 +157,9 @@ namespace owl {
   {
     instanceIDs.resize(children.size());
     std::copy(_instanceIDs,_instanceIDs+instanceIDs.size(),instanceIDs.data());
+    instanceIDsBuffer = nullptr;
+    sources.instanceIDs.source = INSTANCE_FIELD_HOST;
+    sources.instanceIDs.version++;
   }
 
   /* set visibility masks to use for the children - MUST be an array of children.size() items */
@@ -109,27 +167,255 @@ namespace owl {
   {
     visibilityMasks.resize(children.size());
     std::copy(_visibilityMasks,_visibilityMasks+visibilityMasks.size(),visibilityMasks.data());
+    visibilityMasksBuffer = nullptr;
+    sources.visibilityMasks.source = INSTANCE_FIELD_HOST;
+    sources.visibilityMasks.version++;
+  }
+
+  void InstanceGroup::setTransformsBuffer(Buffer::SP buffer,
+                                          OWLMatrixFormat matrixFormat)
+  {
+    if (buffer && buffer->type != OWL_FLOAT && buffer->type != OWL_AFFINE3F)
+      OWL_RAISE("transforms buffer for instance group has to be of type "
+                "OWL_FLOAT or OWL_AFFINE3F");
+    if (matrixFormat != OWL_MATRIX_FORMAT_OWL &&
+        matrixFormat != OWL_MATRIX_FORMAT_ROW_MAJOR)
+      OWL_RAISE("unsupported matrix format for instance transforms buffer");
+    transformsBuffer       = buffer;
+    transformsBufferFormat = matrixFormat;
+    sources.transforms.source
+      = buffer ? INSTANCE_FIELD_BUFFER : INSTANCE_FIELD_HOST;
+    sources.transforms.version++;
+  }
+
+  void InstanceGroup::setInstanceIDsBuffer(Buffer::SP buffer)
+  {
+    if (buffer && buffer->type != OWL_UINT && buffer->type != OWL_INT)
+      OWL_RAISE("instance IDs buffer has to be of type OWL_UINT or OWL_INT");
+    instanceIDsBuffer = buffer;
+    sources.instanceIDs.source
+      = buffer
+      ? INSTANCE_FIELD_BUFFER
+      : (instanceIDs.empty() ? INSTANCE_FIELD_DEFAULT : INSTANCE_FIELD_HOST);
+    sources.instanceIDs.version++;
+  }
+
+  void InstanceGroup::setVisibilityMasksBuffer(Buffer::SP buffer)
+  {
+    if (buffer && buffer->type != OWL_UCHAR && buffer->type != OWL_CHAR)
+      OWL_RAISE("visibility masks buffer has to be of type OWL_UCHAR or "
+                "OWL_CHAR");
+    visibilityMasksBuffer = buffer;
+    sources.visibilityMasks.source
+      = buffer
+      ? INSTANCE_FIELD_BUFFER
+      : (visibilityMasks.empty() ? INSTANCE_FIELD_DEFAULT : INSTANCE_FIELD_HOST);
+    sources.visibilityMasks.version++;
   }
   
   void InstanceGroup::setChild(size_t childID, Group::SP child)
   {
     assert(childID < children.size());
     children[childID] = child;
+    sources.childrenVersion++;
+  }
+
+  void InstanceGroup::setLODs(size_t childID,
+                              const std::vector<Group::SP> &lods,
+                              const std::vector<float> &maxDistances)
+  {
+    assert(childID < children.size());
+    if (lods.empty() || lods.size() != maxDistances.size())
+      OWL_RAISE("number of LOD groups and LOD distances have to match");
+    for (size_t i=1;i<maxDistances.size();i++)
+      if (maxDistances[i] < maxDistances[i-1])
+        OWL_RAISE("LOD distances have to be increasing");
+    lodGroups.resize(children.size());
+    lodMaxDistances.resize(children.size());
+    lodGroups[childID]       = lods;
+    lodMaxDistances[childID] = maxDistances;
+    children[childID]        = lods[0];
+    sources.childrenVersion++;
+  }
+
+  void InstanceGroup::setCullingView(const CullingView &view)
+  {
+    cullingEnabled = true;
+    cullingView    = view;
+  }
+
+  void InstanceGroup::disableCulling()
+  {
+    cullingEnabled = false;
+    activeInstances.clear();
+  }
+
+  void InstanceGroup::cullInstances(bool forceRebuild)
+  {
+    if (hasMotion() || sources.anyOnDevice())
+      OWL_RAISE("instance culling requires host-side, non-motion "
+                "blurred instance transforms");
+
+    const size_t numChildren = children.size();
+    if (forceRebuild ||
+        culler.numInstances()   != numChildren ||
+        cullerTransformsVersion != sources.transforms.version ||
+        cullerChildrenVersion   != sources.childrenVersion) {
+      // ------------------------------------------------------------------
+      // make sure all (distinct) groups we instantiate know their
+      // bounds - usually only the case with motion blur
+      // ------------------------------------------------------------------
+      std::set<Group *> alreadyTried;
+      auto requireBounds = [&](const Group::SP &group) {
+        if (group->getBounds().empty() && !alreadyTried.count(group.get())) {
+          alreadyTried.insert(group.get());
+          group->updateMotionBounds();
+        }
+      };
+      for (size_t childID=0;childID<numChildren;childID++) {
+        assert(children[childID]);
+        requireBounds(children[childID]);
+        if (childID < lodGroups.size())
+          for (auto &lod : lodGroups[childID])
+            requireBounds(lod);
+      }
+
+      // ------------------------------------------------------------------
+      // conservative object bounds over all LODs, and flattened list
+      // of LOD distances
+      // ------------------------------------------------------------------
+      std::vector<box3f>    objectBounds(numChildren);
+      std::vector<uint32_t> lodBegin(numChildren+1);
+      std::vector<float>    flatDistances;
+      for (size_t childID=0;childID<numChildren;childID++) {
+        lodBegin[childID] = (uint32_t)flatDistances.size();
+        const bool hasLODs
+          = childID < lodGroups.size() && !lodGroups[childID].empty();
+        if (!hasLODs) {
+          objectBounds[childID] = children[childID]->getBounds();
+          continue;
+        }
+        bool anyUnknown = false;
+        for (auto &lod : lodGroups[childID]) {
+          const box3f lodBounds = lod->getBounds();
+          anyUnknown |= lodBounds.empty();
+          objectBounds[childID].extend(lodBounds);
+        }
+        if (anyUnknown) objectBounds[childID] = box3f();
+        flatDistances.insert(flatDistances.end(),
+                             lodMaxDistances[childID].begin(),
+                             lodMaxDistances[childID].end());
+      }
+      lodBegin[numChildren] = (uint32_t)flatDistances.size();
+
+      culler.build(numChildren,transforms[0].data(),objectBounds.data(),
+                   lodBegin.data(),flatDistances.data());
+      cullerTransformsVersion = sources.transforms.version;
+      cullerChildrenVersion   = sources.childrenVersion;
+    }
+    culler.select(cullingView,activeInstances);
+  }
+
+  void InstanceGroup::updateMotionBounds()
+  {
+    bounds.clear();
+    if (sources.transforms.source != INSTANCE_FIELD_HOST || transforms.empty())
+      // transforms only live on the device, so can't do that on the host
+      return;
+
+    const int numKeys = (int)transforms.size();
+    std::set<Group *> alreadyTried;
+    std::vector<affine3f>     childKeys(numKeys);
+    std::vector<SRTTransform> childSRTKeys(numKeys);
+    box3f result;
+    for (size_t childID=0;childID<children.size();childID++) {
+      Group::SP child = children[childID];
+      assert(child);
+      if (child->getBounds().empty() && !alreadyTried.count(child.get())) {
+        alreadyTried.insert(child.get());
+        child->updateMotionBounds();
+      }
+      if (child->getBounds().empty())
+        // one unknown child makes the whole group unknown
+        return;
+
+      box3f childBounds;
+      if (!hasMotion())
+        childBounds = xfmBounds(transforms[0][childID],child->getBounds());
+      else if (useSRTMotion()) {
+        for (int key=0;key<numKeys;key++)
+          childSRTKeys[key] = srtTransforms[key][childID];
+        childBounds = motionBounds(childSRTKeys.data(),numKeys,
+                                   child->bounds.data(),(int)child->bounds.size(),
+                                   /* sub-steps per key interval: */4);
+      } else {
+        for (int key=0;key<numKeys;key++)
+          childKeys[key] = transforms[key][childID];
+        childBounds = motionBounds(childKeys.data(),numKeys,
+                                   child->bounds.data(),(int)child->bounds.size(),
+                                   /* sub-steps per key interval: */4);
+      }
+      result.extend(childBounds);
+    }
+    // over all times, just like the motion build computes it
+    bounds.assign(1,result);
   }
 
   void InstanceGroup::buildAccel()
   {
+    if (hasMotion() && sources.anyOnDevice())
+      OWL_RAISE("device-resident instance data is not (yet) supported "
+                "for motion blurred instance groups");
+    if (cullingEnabled)
+      // children may have been rebuilt, and changed their bounds
+      cullInstances(true);
+    if (!hasMotion())
+      // only motion builds compute bounds; drop any left over from
+      // an earlier one (updateMotionBounds() recomputes on request)
+      bounds.clear();
     for (auto device : context->getDevices())
-      if (transforms[1].empty())
+      if (!hasMotion())
         staticBuildOn<true>(device);
       else
         motionBlurBuildOn<true>(device);
+    builtNumMotionKeys = (int)transforms.size();
   }
   
   void InstanceGroup::refitAccel()
   {
+    if (hasMotion() && sources.anyOnDevice())
+      OWL_RAISE("device-resident instance data is not (yet) supported "
+                "for motion blurred instance groups");
+    if ((int)transforms.size() != builtNumMotionKeys) {
+      // optix can't refit a bvh into one with a different number of
+      // motion keys (or none at all)
+      buildAccel();
+      return;
+    }
+    if (!hasMotion())
+      // transforms may have changed; same as in buildAccel()
+      bounds.clear();
+    if (cullingEnabled) {
+      /* re-cull; as long as the same instances (with the same LODs)
+         survive this is a real refit - but optix cannot refit into a
+         different set of instances, so if that changed this has to
+         become a (usually much smaller) build */
+      if (!(buildFlags & OPTIX_BUILD_FLAG_ALLOW_UPDATE))
+        OWL_RAISE("trying to refit an accel struct that was not built "
+                  "with OPTIX_BUILD_FLAG_ALLOW_UPDATE");
+      const std::vector<InstanceCuller::Selection> builtInstances
+        = activeInstances;
+      cullInstances(false);
+      const bool sameInstances = (activeInstances == builtInstances);
+      for (auto device : context->getDevices())
+        if (sameInstances)
+          staticBuildOn<false>(device);
+        else
+          staticBuildOn<true>(device);
+      return;
+    }
     for (auto device : context->getDevices())
-      if (transforms[1].empty())
+      if (!hasMotion())
         staticBuildOn<false>(device);
       else
         motionBlurBuildOn<false>(device);
@@ -142,8 +428,12 @@ namespace owl {
     auto optixContext = device->optixContext;
 
     SetActiveGPU forLifeTime(device);
+    /* with culling enabled, only the active instances go into the
+       IAS, and each of those may use a different LOD group */
+    const size_t numInstances
+      = cullingEnabled ? activeInstances.size() : children.size();
     LOG("building instance accel over "
-        << children.size() << " groups");
+        << numInstances << " groups");
 
     // ==================================================================
     // sanity check that that many instances are actualy allowed by optix:
@@ -155,7 +445,7 @@ namespace owl {
        &maxInstsPerIAS,
        sizeof(maxInstsPerIAS));
       
-    if (children.size() > maxInstsPerIAS)
+    if (numInstances > maxInstsPerIAS)
       throw std::runtime_error("number of children in instance group exceeds "
                                "OptiX's MAX_INSTANCES_PER_IAS limit");
 
@@ -174,51 +464,67 @@ namespace owl {
     OptixBuildInput              instanceInput  {};
     OptixAccelBuildOptions       accelOptions   {};
     
-    //! the N build inputs that go into the builder
-    std::vector<OptixInstance>   optixInstances(children.size());
-
-    // now go over all children to set up the buildinputs
-    for (size_t childID=0;childID<children.size();childID++) {
-      Group::SP child = children[childID];
-      assert(child);
-
-      assert(transforms[1].empty());
-      const affine3f xfm = transforms[0][childID];
-
-      OptixInstance oi = {};
-      oi.transform[0*4+0]  = xfm.l.vx.x;
-      oi.transform[0*4+1]  = xfm.l.vy.x;
-      oi.transform[0*4+2]  = xfm.l.vz.x;
-      oi.transform[0*4+3]  = xfm.p.x;
-        
-      oi.transform[1*4+0]  = xfm.l.vx.y;
-      oi.transform[1*4+1]  = xfm.l.vy.y;
-      oi.transform[1*4+2]  = xfm.l.vz.y;
-      oi.transform[1*4+3]  = xfm.p.y;
-        
-      oi.transform[2*4+0]  = xfm.l.vx.z;
-      oi.transform[2*4+1]  = xfm.l.vy.z;
-      oi.transform[2*4+2]  = xfm.l.vz.z;
-      oi.transform[2*4+3]  = xfm.p.z;
+    const InstanceBuildPlan plan
+      = InstanceBuildPlan::compute(sources,children.size(),
+                                   dd.instanceState,FULL_REBUILD);
+    if (plan.assembleOnDevice) {
+      // instance records get assembled by a kernel, from
+      // device-resident data; the host only touches the child table
+      // (if at all)
+      assembleInstancesOn(device,plan);
+    } else {
+      //! the N build inputs that go into the builder
+      std::vector<OptixInstance>   optixInstances(numInstances);
+
+      // now go over all children to set up the buildinputs
+      for (size_t instID=0;instID<numInstances;instID++) {
+        const size_t childID
+          = cullingEnabled ? activeInstances[instID].instance : instID;
+        Group::SP child
+          = (cullingEnabled && childID < lodGroups.size() && !lodGroups[childID].empty())
+          ? lodGroups[childID][activeInstances[instID].lod]
+          : children[childID];
+        assert(child);
+
+        assert(!hasMotion());
+        const affine3f xfm = transforms[0][childID];
+
+        OptixInstance oi = {};
+        oi.transform[0*4+0]  = xfm.l.vx.x;
+        oi.transform[0*4+1]  = xfm.l.vy.x;
+        oi.transform[0*4+2]  = xfm.l.vz.x;
+        oi.transform[0*4+3]  = xfm.p.x;
+          
+        oi.transform[1*4+0]  = xfm.l.vx.y;
+        oi.transform[1*4+1]  = xfm.l.vy.y;
+        oi.transform[1*4+2]  = xfm.l.vz.y;
+        oi.transform[1*4+3]  = xfm.p.y;
+          
+        oi.transform[2*4+0]  = xfm.l.vx.z;
+        oi.transform[2*4+1]  = xfm.l.vy.z;
+        oi.transform[2*4+2]  = xfm.l.vz.z;
+        oi.transform[2*4+3]  = xfm.p.z;
+          
+        oi.flags             = OPTIX_INSTANCE_FLAG_NONE;
+        oi.instanceId        = (instanceIDs.empty())?uint32_t(childID):instanceIDs[childID];
+        oi.visibilityMask    = (visibilityMasks.empty()) ? 255 : visibilityMasks[childID];
+        oi.sbtOffset         = context->numRayTypes * child->getSBTOffset();
+        oi.traversableHandle = child->getTraversable(device);
+        assert(oi.traversableHandle);
         
-      oi.flags             = OPTIX_INSTANCE_FLAG_NONE;
-      oi.instanceId        = (instanceIDs.empty())?uint32_t(childID):instanceIDs[childID];
-      oi.visibilityMask    = (visibilityMasks.empty()) ? 255 : visibilityMasks[childID];
-      oi.sbtOffset         = context->numRayTypes * child->getSBTOffset();
-      oi.traversableHandle = child->getTraversable(device);
-      assert(oi.traversableHandle);
-      
-      optixInstances[childID] = oi;
+        optixInstances[instID] = oi;
+      }
+
+      if (Context::useManagedMemForAccelAux)
+        dd.optixInstanceBuffer.allocManaged(optixInstances.size()*
+                                            sizeof(optixInstances[0]));
+      else
+        dd.optixInstanceBuffer.alloc(optixInstances.size()*
+                                     sizeof(optixInstances[0]));
+      dd.optixInstanceBuffer.upload(optixInstances.data(),"optixinstances");
     }
+    plan.commit(dd.instanceState);
 
-    if (Context::useManagedMemForAccelAux)
-      dd.optixInstanceBuffer.allocManaged(optixInstances.size()*
-                                          sizeof(optixInstances[0]));
-    else
-      dd.optixInstanceBuffer.alloc(optixInstances.size()*
-                                   sizeof(optixInstances[0]));
-    dd.optixInstanceBuffer.upload(optixInstances.data(),"optixinstances");
-    
     // ==================================================================
     // set up build input
     // ==================================================================
@@ -227,7 +533,7 @@ namespace owl {
     instanceInput.instanceArray.instances
       = (CUdeviceptr)dd.optixInstanceBuffer.get();
     instanceInput.instanceArray.numInstances
-      = (int)optixInstances.size();
+      = (int)numInstances;
       
     // ==================================================================
     // set up accel uptions
@@ -259,7 +565,7 @@ namespace owl {
       ? blasBufferSizes.tempSizeInBytes
       : blasBufferSizes.tempUpdateSizeInBytes;
     LOG("starting to build/refit "
-        << prettyNumber(optixInstances.size()) << " instances, "
+        << prettyNumber(numInstances) << " instances, "
         << prettyNumber(blasBufferSizes.outputSizeInBytes) << "B in output and "
         << prettyNumber(tempSize) << "B in temp data");
       
@@ -280,7 +586,9 @@ namespace owl {
     }
       
     OPTIX_CHECK(optixAccelBuild(optixContext,
-                                /* todo: stream */0,
+                                /* same stream as the instance assembly
+                                   kernel, if any */
+                                device->stream,
                                 &accelOptions,
                                 // array of build inputs:
                                 &instanceInput,1,
@@ -338,56 +646,126 @@ namespace owl {
     // ==================================================================
     // build motion transforms
     // ==================================================================
-    assert(!transforms[1].empty());
-    std::vector<OptixMatrixMotionTransform> motionTransforms(children.size());
-#if OPTIX_VERSION >= 70200
-    /* since 7.2, optix no longer requires those aabbs (and in fact,
-       no longer supports specifying them */
-#else
+    assert(hasMotion());
+    const int numKeys = (int)transforms.size();
+    for (auto &keyTransforms : transforms)
+      if (keyTransforms.size() != children.size())
+        OWL_RAISE("not all motion keys' transforms have been set "
+                  "for motion blurred instance group");
+    const bool useSRT = useSRTMotion();
+    if (useSRT)
+      for (size_t timeStep=0;timeStep<transforms.size();timeStep++)
+        if (timeStep >= srtTransforms.size()
+            || srtTransforms[timeStep].size() != children.size())
+          OWL_RAISE("motion key "+std::to_string(timeStep)
+                    +" of instance group with SRT motion has not been "
+                    "set as SRT transforms");
+    
+    /* Optix{Matrix,SRT}MotionTransform have room for two keys; more
+       keys continue right behind them, so with more than two the
+       transforms are of variable size (but each has to start
+       properly aligned) */
+    const size_t motionTransformSize
+      = ((useSRT
+          ? sizeof(OptixSRTMotionTransform)
+          + std::max(numKeys-2,0)*sizeof(OptixSRTData)
+          : sizeof(OptixMatrixMotionTransform)
+          + std::max(numKeys-2,0)*12*sizeof(float))
+         + OPTIX_TRANSFORM_BYTE_ALIGNMENT-1)
+      & ~size_t(OPTIX_TRANSFORM_BYTE_ALIGNMENT-1);
+    std::vector<uint8_t> motionTransforms(children.size()*motionTransformSize);
+    /* conservative world-space bounds of each instance over all of
+       t=0..1: optix before 7.2 needs them in the build input, and on
+       all versions they're what this group's own bounds get computed
+       from */
     std::vector<box3f> motionAABBs(children.size());
-#endif
+    std::vector<affine3f>     childKeys(numKeys);
+    std::vector<SRTTransform> childSRTKeys(numKeys);
     for (size_t childID=0;childID<children.size();childID++) {
       Group::SP child = children[childID];
       assert(child);
-      OptixMatrixMotionTransform mt = {};
-      mt.child                      = child->getTraversable(device);
-      mt.motionOptions.numKeys      = 2;
-      mt.motionOptions.timeBegin    = 0.f;
-      mt.motionOptions.timeEnd      = 1.f;
-      mt.motionOptions.flags        = OPTIX_MOTION_FLAG_NONE;
-
-      for (int timeStep = 0; timeStep < 2; timeStep ++ ) {
-        const affine3f xfm = transforms[timeStep][childID];
-        mt.transform[timeStep][0*4+0]  = xfm.l.vx.x;
-        mt.transform[timeStep][0*4+1]  = xfm.l.vy.x;
-        mt.transform[timeStep][0*4+2]  = xfm.l.vz.x;
-        mt.transform[timeStep][0*4+3]  = xfm.p.x;
+      uint8_t *motionTransform
+        = motionTransforms.data()+childID*motionTransformSize;
+      OptixMotionOptions motionOptions = {};
+      motionOptions.numKeys   = (unsigned short)numKeys;
+      motionOptions.timeBegin = 0.f;
+      motionOptions.timeEnd   = 1.f;
+      motionOptions.flags     = OPTIX_MOTION_FLAG_NONE;
+
+      if (useSRT) {
+        OptixSRTMotionTransform &mt = *(OptixSRTMotionTransform *)motionTransform;
+        mt.child         = child->getTraversable(device);
+        mt.motionOptions = motionOptions;
+        for (int timeStep = 0; timeStep < numKeys; timeStep ++ ) {
+          const SRTTransform &srt = srtTransforms[timeStep][childID];
+          childSRTKeys[timeStep] = srt;
+          OptixSRTData &key = *(mt.srtData + timeStep);
+          key.sx  = srt.scale.x;
+          key.a   = srt.shear.x;
+          key.b   = srt.shear.y;
+          key.pvx = srt.pivot.x;
+          key.sy  = srt.scale.y;
+          key.c   = srt.shear.z;
+          key.pvy = srt.pivot.y;
+          key.sz  = srt.scale.z;
+          key.pvz = srt.pivot.z;
+          key.qx  = srt.rotation.i;
+          key.qy  = srt.rotation.j;
+          key.qz  = srt.rotation.k;
+          key.qw  = srt.rotation.r;
+          key.tx  = srt.translation.x;
+          key.ty  = srt.translation.y;
+          key.tz  = srt.translation.z;
+        }
+      } else {
+        OptixMatrixMotionTransform &mt = *(OptixMatrixMotionTransform *)motionTransform;
+        mt.child         = child->getTraversable(device);
+        mt.motionOptions = motionOptions;
+        for (int timeStep = 0; timeStep < numKeys; timeStep ++ ) {
+          const affine3f xfm = transforms[timeStep][childID];
+          childKeys[timeStep] = xfm;
+          float *key = mt.transform[0] + 12*timeStep;
+          key[0*4+0]  = xfm.l.vx.x;
+          key[0*4+1]  = xfm.l.vy.x;
+          key[0*4+2]  = xfm.l.vz.x;
+          key[0*4+3]  = xfm.p.x;
           
-        mt.transform[timeStep][1*4+0]  = xfm.l.vx.y;
-        mt.transform[timeStep][1*4+1]  = xfm.l.vy.y;
-        mt.transform[timeStep][1*4+2]  = xfm.l.vz.y;
-        mt.transform[timeStep][1*4+3]  = xfm.p.y;
+          key[1*4+0]  = xfm.l.vx.y;
+          key[1*4+1]  = xfm.l.vy.y;
+          key[1*4+2]  = xfm.l.vz.y;
+          key[1*4+3]  = xfm.p.y;
           
-        mt.transform[timeStep][2*4+0]  = xfm.l.vx.z;
-        mt.transform[timeStep][2*4+1]  = xfm.l.vy.z;
-        mt.transform[timeStep][2*4+2]  = xfm.l.vz.z;
-        mt.transform[timeStep][2*4+3]  = xfm.p.z;
+          key[2*4+0]  = xfm.l.vx.z;
+          key[2*4+1]  = xfm.l.vy.z;
+          key[2*4+2]  = xfm.l.vz.z;
+          key[2*4+3]  = xfm.p.z;
+        }
       }
 
-      motionTransforms[childID] = mt;
-
-#if OPTIX_VERSION >= 70200
-    /* since 7.2, optix no longer requires those aabbs (and in fact,
-       no longer supports specifying them */
-#else
+      if (child->getBounds().empty())
+        child->updateMotionBounds();
+      // over all keys of both the transform and the child, and
+      // conservative in between
       motionAABBs[childID]
-        = xfmBounds(transforms[0][childID],child->bounds[0]);
-      motionAABBs[childID].extend(xfmBounds(transforms[1][childID],child->bounds[1]));
-#endif
+        = child->getBounds().empty()
+        ? box3f()
+        : useSRT
+        ? motionBounds(childSRTKeys.data(),numKeys,
+                       child->bounds.data(),(int)child->bounds.size(),
+                       /* sub-steps per key interval: */4)
+        : motionBounds(childKeys.data(),numKeys,
+                       child->bounds.data(),(int)child->bounds.size(),
+                       /* sub-steps per key interval: */4);
+    }
+
+    // this group's bounds, over all times; unknown if any child's are
+    bounds.assign(1,box3f());
+    for (auto &box : motionAABBs) {
+      if (box.empty()) { bounds[0] = box3f(); break; }
+      bounds[0].extend(box);
     }
     // and upload
-    dd.motionTransformsBuffer.allocManaged(motionTransforms.size()*
-                                    sizeof(motionTransforms[0]));
+    dd.motionTransformsBuffer.allocManaged(motionTransforms.size());
     dd.motionTransformsBuffer.upload(motionTransforms.data(),"motionTransforms");
       
 #if OPTIX_VERSION >= 70200
@@ -415,9 +793,11 @@ namespace owl {
       OPTIX_CHECK(optixConvertPointerToTraversableHandle
                   (optixContext,
                    (CUdeviceptr)(((const uint8_t*)dd.motionTransformsBuffer.get())
-                                 +childID*sizeof(motionTransforms[0])
+                                 +childID*motionTransformSize
                                  ),
-                   OPTIX_TRAVERSABLE_TYPE_MATRIX_MOTION_TRANSFORM,
+                   useSRT
+                   ? OPTIX_TRAVERSABLE_TYPE_SRT_MOTION_TRANSFORM
+                   : OPTIX_TRAVERSABLE_TYPE_MATRIX_MOTION_TRANSFORM,
                    &childMotionHandle));
         
       OptixInstance oi    = {};
@@ -17,6 +17,9 @@
 #pragma once
 
 #include "Group.h"
+#include "InstanceBuildPlan.h"
+#include "InstanceCulling.h"
+#include "owl/common/math/SRTTransform.h"
 
 namespace owl {
 
@@ -34,6 +37,19 @@ namespace owl {
       
       DeviceMemory optixInstanceBuffer;
 
+      /*! @{ device-side copies of the per-child data that the
+          instance assembly kernel reads if any of the per-instance
+          fields comes from a device buffer; only (re-)uploaded when
+          they change, see InstanceBuildPlan */
+      DeviceMemory childTable;
+      DeviceMemory hostTransforms;
+      DeviceMemory hostInstanceIDs;
+      DeviceMemory hostVisibilityMasks;
+      /*! @} */
+
+      /*! what this device currently has of the above */
+      InstanceDeviceState instanceState;
+
       /*! if we use motion blur, this is used to store all the motoin transforms */
       DeviceMemory motionTransformsBuffer;
       DeviceMemory motionAABBsBuffer;
@@ -49,17 +65,41 @@ namespace owl {
     /*! pretty-printer, for printf-debugging */
     std::string toString() const override;
     
+    /*! one entry in the per-device child table that the instance
+        assembly kernel reads; all data that has to come from the
+        host because only the host knows the children's
+        traversables */
+    struct ChildRecord {
+      OptixTraversableHandle traversable;
+      uint32_t               sbtOffset;
+      uint32_t               pad;
+    };
+
     /*! set given child to given group */
     void setChild(size_t childID, Group::SP child);
                   
     /*! set transformation matrix of given child */
     void setTransform(size_t childID, const affine3f &xfm);
 
-    /*! set transformation matrix of given child */
+    /*! set the transformation matrices of all children for the
+        given motion key; setting a key beyond the current last one
+        adds keys (all of which have to be set before building) */
     void setTransforms(uint32_t timeStep,
                        const float *floatsForThisStimeStep,
                        OWLMatrixFormat matrixFormat);
 
+    /*! set the SRT transforms of all children for the given motion
+        key; once any key is set this way, motion blur uses SRT motion
+        transforms (and all keys have to be SRTs), until matrix keys
+        get set again */
+    void setSRTTransforms(uint32_t timeStep,
+                          const SRTTransform *srtsForThisTimeStep);
+
+    /*! change the number of motion keys: fewer keys drops the last
+        ones (so 1 turns motion blur off again), more keys adds keys
+        that all have to be set before the next build */
+    void setNumMotionKeys(int numKeys);
+
     /* set instance IDs to use for the children - MUST be an array of
        children.size() items */
     void setInstanceIDs(const uint32_t *instanceIDs);
@@ -67,10 +107,51 @@ namespace owl {
     /* set visibility masks to use for the children - MUST be an array of
        children.size() items */
     void setVisibilityMasks(const uint8_t *visibilityMasks);
+
+    /*! use the given (device-resident) buffer of children.size()
+        transforms instead of the host-side ones; passing a null
+        buffer reverts to the host-side transforms */
+    void setTransformsBuffer(Buffer::SP buffer,
+                             OWLMatrixFormat matrixFormat);
+
+    /*! use the given (device-resident) buffer of children.size()
+        uint32_t's as instance IDs; a null buffer reverts to the
+        host-side (or default) instance IDs */
+    void setInstanceIDsBuffer(Buffer::SP buffer);
+
+    /*! use the given (device-resident) buffer of children.size()
+        uint8_t's as visibility masks; a null buffer reverts to the
+        host-side (or default) masks */
+    void setVisibilityMasksBuffer(Buffer::SP buffer);
+
+    /*! specify levels of detail for given child: lods[0] becomes the
+        child itself, and lods[k] gets used for as long as the
+        instance's distance to the camera is <= maxDistances[k];
+        farther than the last distance, the instance gets culled. Only
+        has an effect if culling is enabled */
+    void setLODs(size_t childID,
+                 const std::vector<Group::SP> &lods,
+                 const std::vector<float> &maxDistances);
+
+    /*! enable culling and LOD selection for all following builds and
+        refits, using the given view */
+    void setCullingView(const CullingView &view);
+
+    /*! disable culling and LOD selection again */
+    void disableCulling();
+
+    /*! run the culling/LOD selection stage, which fills in
+        activeInstances; re-builds the culling hierarchy if required */
+    void cullInstances(bool forceRebuild);
       
     void buildAccel() override;
     void refitAccel() override;
 
+    /*! compute bounds (over all motion keys) from the children's
+        bounds and the host-side transforms; stays empty if any child's
+        bounds are unknown, or if the transforms live on the device */
+    void updateMotionBounds() override;
+
     /*! creates the device-specific data for this group */
     RegisteredObject::DeviceData::SP createOn(const DeviceContext::SP &device) override;
     
@@ -82,6 +163,12 @@ namespace owl {
     template<bool FULL_REBUILD>
     void motionBlurBuildOn(const DeviceContext::SP &device);
 
+    /*! fill in dd.optixInstanceBuffer by uploading whatever host
+        data the plan asks for and then running the instance assembly
+        kernel on device->stream (see DeviceInstances.cu) */
+    void assembleInstancesOn(const DeviceContext::SP &device,
+                             const InstanceBuildPlan &plan);
+
     /*! return the SBT offset to use for this group - SBT offsets for
       instnace groups are always 0 */
     int getSBTOffset() const override { return 0; }
@@ -91,9 +178,25 @@ namespace owl {
       transforms are only stored once, on the ll layer */
     std::vector<Group::SP>  children;
     
-    /*! set of transform matrices for t=0 and t=1, respectively. if we
-      don't use motion blur, the second one may be unused */
-    std::vector<affine3f>   transforms[2];
+    /*! one set of transform matrices per motion key, evenly spaced
+      over t=0..1; without motion blur, there's only one */
+    std::vector<std::vector<affine3f>> transforms;
+
+    /*! whether there's more than one motion key */
+    inline bool hasMotion() const { return transforms.size() > 1; }
+
+    /*! number of motion keys at the time of the last build (0 if
+        never built) - refits with a different count turn into builds */
+    int builtNumMotionKeys = 0;
+
+    /*! if specified via setSRTTransforms, the SRT transforms that the
+      above matrices were computed from; one set per motion key, just
+      like transforms - or empty, for matrix motion transforms */
+    std::vector<std::vector<SRTTransform>> srtTransforms;
+
+    /*! whether motion gets built with SRT (rather than matrix) motion
+      transforms */
+    inline bool useSRTMotion() const { return !srtTransforms.empty(); }
 
     /*! vector of instnace IDs to use for these instances - if not
       specified we/optix will fill in automatically using
@@ -105,6 +208,37 @@ namespace owl {
       visibility=255 */
     std::vector<uint8_t> visibilityMasks;
 
+    /*! @{ optional device-resident replacements for transforms[0],
+        instanceIDs, and visibilityMasks, respectively. If any of
+        those is set, the OptixInstance records get assembled by a
+        kernel, and the host only ever touches the per-child table of
+        traversables when the children change */
+    Buffer::SP      transformsBuffer;
+    OWLMatrixFormat transformsBufferFormat = OWL_MATRIX_FORMAT_OWL;
+    Buffer::SP      instanceIDsBuffer;
+    Buffer::SP      visibilityMasksBuffer;
+    /*! @} */
+
+    /*! tracks where the per-instance data comes from, and when it
+        last changed */
+    InstanceSources sources;
+
+    /*! @{ per-child levels of detail, as specified via setLODs; empty
+        for children without LODs */
+    std::vector<std::vector<Group::SP>> lodGroups;
+    std::vector<std::vector<float>>     lodMaxDistances;
+    /*! @} */
+
+    /*! @{ culling and LOD selection state; if culling is enabled,
+        only the instances in activeInstances go into the IAS */
+    bool                                   cullingEnabled = false;
+    CullingView                            cullingView;
+    InstanceCuller                         culler;
+    uint64_t                               cullerTransformsVersion = uint64_t(-1);
+    uint64_t                               cullerChildrenVersion   = uint64_t(-1);
+    std::vector<InstanceCuller::Selection> activeInstances;
+    /*! @} */
+
     constexpr static unsigned int defaultBuildFlags = 
         OPTIX_BUILD_FLAG_PREFER_FAST_TRACE;
 
@@ -30,6 +30,29 @@ namespace owl {
   {
   }
   
+  // ------------------------------------------------------------------
+  // CudaEventFence
+  // ------------------------------------------------------------------
+
+  void CudaEventFence::record(cudaStream_t stream)
+  {
+    if (!event)
+      OWL_CUDA_CHECK(cudaEventCreateWithFlags(&event,cudaEventDisableTiming));
+    OWL_CUDA_CHECK(cudaEventRecord(event,stream));
+  }
+  
+  bool CudaEventFence::isDone()
+  {
+    // errors other than 'not ready' get reported by wait()
+    return !event || cudaEventQuery(event) != cudaErrorNotReady;
+  }
+  
+  void CudaEventFence::wait()
+  {
+    if (event)
+      OWL_CUDA_CHECK(cudaEventSynchronize(event));
+  }
+  
   // ------------------------------------------------------------------
   // LaunchParams::DeviceData
   // ------------------------------------------------------------------
@@ -44,14 +67,39 @@ namespace owl {
     SetActiveGPU forLifeTime(device);
     
     OWL_CUDA_CHECK(cudaStreamCreate(&stream));
-    deviceMemory.alloc(dataSize);
-    hostMemory.resize(dataSize);
+    setNumSlots(defaultNumSlots);
   }
 
   LaunchParams::DeviceData::~DeviceData()
   {
+    SetActiveGPU forLifeTime(device);
+    
+    ring.drain();
+    for (auto &slot : slots)
+      cudaFreeHost(slot.hostMemory.ptr);
     cudaStreamDestroy(stream);
   }
+
+  /*! (re-)allocates the given number of slots, after waiting for
+      all launches still using the current ones */
+  void LaunchParams::DeviceData::setNumSlots(int numSlots)
+  {
+    if (numSlots < 1)
+      OWL_RAISE("invalid number of launch params slots "
+                +std::to_string(numSlots)+" (must be at least 1)");
+    // resize() waits for all slots in flight
+    ring.resize(numSlots);
+    for (auto &slot : slots)
+      cudaFreeHost(slot.hostMemory.ptr);
+    // note DeviceMemory frees in its destructor, but must not be
+    // copied - so always start over from an empty vector
+    slots.clear();
+    slots.resize(numSlots);
+    for (auto &slot : slots) {
+      slot.deviceMemory.alloc(dataSize);
+      slot.hostMemory.resize(int(dataSize));
+    }
+  }
   
   // ------------------------------------------------------------------
   // LaunchParams
@@ -79,6 +127,17 @@ namespace owl {
     return std::make_shared<DeviceData>(device,type->varStructSize);
   }
 
+  /*! sets the number of async launches (per device) that can be in
+      flight with these launch params before another launch has to
+      wait for the oldest one to complete */
+  void LaunchParams::setNumSlots(int numSlots)
+  {
+    for (auto device : context->getDevices()) {
+      SetActiveGPU forLifeTime(device);
+      getDD(device).setNumSlots(numSlots);
+    }
+  }
+  
   /*! returns the cuda stream associated with this launch params
     object (for given device, since each device has a different
     one. Note this stream is different from the default optix
@@ -99,6 +158,8 @@ namespace owl {
     for (auto device : context->getDevices()) {
       SetActiveGPU forLifeTime(device);
       cudaStreamSynchronize(getCudaStream(device));
+      // all slots are free now; this won't block any more
+      getDD(device).ring.drain();
     }
   }
   
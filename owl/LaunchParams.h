@@ -18,6 +18,7 @@
 
 #include "SBTObject.h"
 #include "Module.h"
+#include "owl/common/parallel/SlotRing.h"
 
 namespace owl {
 
@@ -38,12 +39,35 @@ namespace owl {
     virtual std::string toString() const { return "LaunchParamsType"; }
   };
 
+  /*! a fence for a SlotRing (see owl/common/parallel/SlotRing.h)
+      that signals once all work that was on a given cuda stream at
+      the time of record() has completed. The cuda event gets created
+      on first use, on whatever device is active at that time */
+  struct CudaEventFence {
+    CudaEventFence() = default;
+    CudaEventFence(const CudaEventFence &) = delete;
+    CudaEventFence(CudaEventFence &&other) : event(other.event)
+    { other.event = nullptr; }
+    ~CudaEventFence() { if (event) cudaEventDestroy(event); }
+
+    void record(cudaStream_t stream);
+    bool isDone();
+    void wait();
+
+    cudaEvent_t event = nullptr;
+  };
+  
   /*! an object that stores the variables used for building the launch
       params data - this is all this object does: store values and
       write them when requested */
   struct LaunchParams : public SBTObject<LaunchParamsType> {
     typedef std::shared_ptr<LaunchParams> SP;
 
+    /*! number of launches that can be in flight at the same time
+        with the same launch params (per device), unless changed via
+        setNumSlots() */
+    static const int defaultNumSlots = 2;
+    
     /*! device-specific data for these lauch params - each instance
         needs its own host- and device-side memory to store the
         parameter values (to avoid messing with other launches if and
@@ -53,22 +77,41 @@ namespace owl {
       /*! constructor, which allocs all the device-side data */
       DeviceData(const DeviceContext::SP &device, size_t  dataSize);
       ~DeviceData();
+
+      /*! (re-)allocates the given number of slots, after waiting for
+          all launches still using the current ones */
+      void setNumSlots(int numSlots);
       
       const size_t            dataSize;
       
       OptixShaderBindingTable sbt = {};
 
-      /*! host-size memory for the launch paramters - we have a
-          host-side copy, too, so we can leave the launch2D call
-          without having to first wait for the cudaMemcpy to
-          complete */
-      PinnedHostMem hostMemory;
-      
-      /*! the cuda device memory we copy the launch params to */
-      DeviceMemory         deviceMemory;
+      /*! one copy of the launch parameters; every async launch writes
+          its parameter values into a slot of its own, so a launch
+          can be issued before the previous ones (with possibly
+          different values) have completed */
+      struct Slot {
+        /*! host-size memory for the launch paramters - we have a
+            host-side copy, too, so we can leave the launch2D call
+            without having to first wait for the cudaMemcpy to
+            complete */
+        PinnedHostMem hostMemory;
+        
+        /*! the cuda device memory we copy the launch params to */
+        DeviceMemory  deviceMemory;
+      };
+      std::vector<Slot> slots;
+
+      /*! hands out the slots in round-robin order; a launch that
+          needs a slot whose previous launch is still running waits
+          for that one to complete */
+      SlotRing<CudaEventFence> ring;
       
       /*! a cuda stream we can use for the async upload and the
-          following async launch */
+          following async launch. This is shared by all slots, so
+          launches with these params execute in order (which is what
+          users of getCudaStream() rely on) - the slots only let the
+          host queue up new launches without waiting */
       cudaStream_t         stream = nullptr;
     };
 
@@ -89,6 +132,11 @@ namespace owl {
         launches */
     CUstream getCudaStream(const DeviceContext::SP &device);
 
+    /*! sets the number of async launches (per device) that can be in
+        flight with these launch params before another launch has to
+        wait for the oldest one to complete */
+    void setNumSlots(int numSlots);
+    
     /*! creates the device-specific data for this group */
     RegisteredObject::DeviceData::SP createOn(const DeviceContext::SP &device) override;
 
@@ -163,8 +163,13 @@ namespace owl {
     RayGen::DeviceData       &rgDD = getDD(device);
     LaunchParams::DeviceData &lpDD = lp->getDD(device);
     
-    lp->writeVariables(lpDD.hostMemory.data(),device);
-    lpDD.deviceMemory.uploadAsync(lpDD.hostMemory.data(),lpDD.stream);
+    // get a set of host/device parameter memory that no other launch
+    // is still using (which may have to wait for an earlier launch
+    // with these params to complete)
+    const size_t slotID = lpDD.ring.acquire();
+    LaunchParams::DeviceData::Slot &slot = lpDD.slots[slotID];
+    lp->writeVariables(slot.hostMemory.data(),device);
+    slot.deviceMemory.uploadAsync(slot.hostMemory.data(),lpDD.stream);
 
     auto &sbt = lpDD.sbt;
 
@@ -199,12 +204,15 @@ namespace owl {
 
     OPTIX_CALL(Launch(device->pipeline,
                       lpDD.stream,
-                      (CUdeviceptr)lpDD.deviceMemory.get(),
-                      lpDD.deviceMemory.sizeInBytes,
+                      (CUdeviceptr)slot.deviceMemory.get(),
+                      slot.deviceMemory.sizeInBytes,
                       &lpDD.sbt,
                       dims.x,dims.y,dims.z
                       ));
-    /* note we do NOT sync here ! */
+    /* note we do NOT sync here ! - the slot's fence tells the next
+       launch that wants this slot when it's safe to overwrite it */
+    lpDD.ring.fence(slotID).record(lpDD.stream);
+    lpDD.ring.submit(slotID);
   }
 
 } // ::owl
@@ -16,6 +16,7 @@
 
 #include "SphereGeomGroup.h"
 #include "SphereGeom.h"
+#include "owl/common/math/boundsReduction.h"
 #include "Context.h"
 
 #define LOG(message)                                            \
@@ -50,10 +51,27 @@ namespace owl {
 		)
 	{}
 
+	/*! computes one box per motion key, on the host, from the
+	    spheres' centers and radii as seen by the first GPU */
 	void SphereGeomGroup::updateMotionBounds()
 	{
-		// only need this for older version of optix that wouldn't even support spheres
-		OWL_NOTIMPLEMENTED;
+		DeviceContext::SP device = context->getDevice(0);
+		bounds.clear();
+		for (auto geom : geometries) {
+			SphereGeom::SP spheres = geom->as<SphereGeom>();
+			assert(spheres);
+			if (bounds.empty())
+				bounds.resize(spheres->verticesBuffers.size());
+			for (size_t key = 0; key < bounds.size() && key < spheres->verticesBuffers.size(); key++) {
+				const std::vector<uint8_t> centers
+					= spheres->verticesBuffers[key]->download(device);
+				const std::vector<uint8_t> radii
+					= spheres->radiusBuffers[key]->download(device);
+				bounds[key].extend
+					(computeBounds(StridedVec3fs(centers.data(), spheres->vertexCount),
+						StridedArray<float>(radii.data(), spheres->vertexCount)));
+			}
+		}
 	}
 
 	void SphereGeomGroup::buildAccel()
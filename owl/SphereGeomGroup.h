@@ -36,7 +36,7 @@ namespace owl {
 
     /*! (re-)compute the Group::bounds[2] information for motion blur
       - ie, our _parent_ node may need this */
-    void updateMotionBounds();
+    void updateMotionBounds() override;
 
     /*! low-level accel structure builder for given device */
     template<bool FULL_REBUILD>
@@ -26,6 +26,8 @@ namespace owl {
       return sizeof(vec4uc);
     case OWL_TEXEL_FORMAT_RGBA32F:
       return sizeof(vec4f);
+    case OWL_TEXEL_FORMAT_R8:
+      return sizeof(uint8_t);
     case OWL_TEXEL_FORMAT_R32F:
       return sizeof(float);
     default:
@@ -43,30 +45,58 @@ namespace owl {
                    OWLTextureColorSpace colorSpace,
                    const void *texels
                    )
-    : RegisteredObject(context,context->textures)
+    : RegisteredObject(context,context->textures),
+      size(size),
+      numLevels(1),
+      linePitchInBytes(linePitchInBytes),
+      texelFormat(texelFormat),
+      filterMode(filterMode)
+  {
+    assert(texels != nullptr);
+    create(&texels,addressMode,colorSpace);
+  }
+
+  Texture::Texture(Context *const context,
+                   vec2i                size,
+                   int                  numLevels,
+                   const void *const   *levels,
+                   OWLTexelFormat       texelFormat,
+                   OWLTextureFilterMode filterMode,
+                   OWLTextureAddressMode addressMode,
+                   OWLTextureColorSpace colorSpace
+                   )
+    : RegisteredObject(context,context->textures),
+      size(size),
+      numLevels(numLevels),
+      linePitchInBytes(0),
+      texelFormat(texelFormat),
+      filterMode(filterMode)
+  {
+    int maxLevels = 1;
+    for (int extent=max(size.x,size.y);extent > 1;extent /= 2) maxLevels++;
+    if (numLevels < 1 || numLevels > maxLevels)
+      OWL_RAISE("invalid number of mip levels for a "
+                +std::to_string(size.x)+"x"+std::to_string(size.y)
+                +" texture: "+std::to_string(numLevels));
+    assert(levels != nullptr);
+    for (int level=0;level<numLevels;level++)
+      assert(levels[level] != nullptr);
+    create(levels,addressMode,colorSpace);
+  }
+
+  void Texture::create(const void *const   *levels,
+                       OWLTextureAddressMode addressMode,
+                       OWLTextureColorSpace colorSpace)
   {
     assert(size.x > 0);
     assert(size.y > 0);
-    int32_t pitch  = linePitchInBytes;
-    if (pitch == 0)
-      pitch = int(size.x*bytesPerTexel(texelFormat));
     assert(
       (texelFormat == OWL_TEXEL_FORMAT_RGBA8) ||
       (texelFormat == OWL_TEXEL_FORMAT_RGBA32F) ||
       (texelFormat == OWL_TEXEL_FORMAT_R8) ||
       (texelFormat == OWL_TEXEL_FORMAT_R32F)
     );
-    if (pitch == 0) {
-      switch(texelFormat) {
-        case OWL_TEXEL_FORMAT_RGBA8:   pitch = size.x*sizeof(vec4uc); break;
-        case OWL_TEXEL_FORMAT_RGBA32F: pitch = size.x*sizeof(vec4f); break;
-        case OWL_TEXEL_FORMAT_R8:      pitch = size.x*sizeof(uint8_t); break;
-        case OWL_TEXEL_FORMAT_R32F:    pitch = size.x*sizeof(float); break;
-        default: assert(false);
-      }  
-    }
-
-    assert(texels != nullptr);
+    const size_t texelSize = bytesPerTexel(texelFormat);
     
     for (auto device : context->getDevices()) {
       SetActiveGPU forLifeTime(device);
@@ -82,20 +112,50 @@ namespace owl {
         default: assert(false);
       }        
 
-      cudaArray_t   pixelArray;
-      OWL_CUDA_CALL(MallocArray(&pixelArray,
-                             &channel_desc,
-                             size.x,size.y));
-      textureArrays.push_back(pixelArray);
+      if (numLevels == 1) {
+        size_t pitch = linePitchInBytes;
+        if (pitch == 0)
+          pitch = size.x*texelSize;
+
+        cudaArray_t   pixelArray;
+        OWL_CUDA_CALL(MallocArray(&pixelArray,
+                               &channel_desc,
+                               size.x,size.y));
+        textureArrays.push_back(pixelArray);
+        mipmappedArrays.push_back(nullptr);
       
-      OWL_CUDA_CALL(Memcpy2DToArray(pixelArray,
-                                 /* offset */0,0,
-                                 texels,
-                                 pitch,pitch,size.y,
-                                 cudaMemcpyHostToDevice));
+        OWL_CUDA_CALL(Memcpy2DToArray(pixelArray,
+                                   /* offset */0,0,
+                                   levels[0],
+                                   pitch,size.x*texelSize,size.y,
+                                   cudaMemcpyHostToDevice));
       
-      res_desc.resType          = cudaResourceTypeArray;
-      res_desc.res.array.array  = pixelArray;
+        res_desc.resType          = cudaResourceTypeArray;
+        res_desc.res.array.array  = pixelArray;
+      } else {
+        cudaMipmappedArray_t mipmappedArray;
+        OWL_CUDA_CALL(MallocMipmappedArray(&mipmappedArray,
+                                        &channel_desc,
+                                        make_cudaExtent(size.x,size.y,0),
+                                        numLevels));
+        textureArrays.push_back(nullptr);
+        mipmappedArrays.push_back(mipmappedArray);
+
+        for (int level=0;level<numLevels;level++) {
+          const vec2i levelSize(max(size.x>>level,1),max(size.y>>level,1));
+          cudaArray_t levelArray;
+          OWL_CUDA_CALL(GetMipmappedArrayLevel(&levelArray,mipmappedArray,level));
+          OWL_CUDA_CALL(Memcpy2DToArray(levelArray,
+                                     /* offset */0,0,
+                                     levels[level],
+                                     levelSize.x*texelSize,
+                                     levelSize.x*texelSize,levelSize.y,
+                                     cudaMemcpyHostToDevice));
+        }
+
+        res_desc.resType           = cudaResourceTypeMipmappedArray;
+        res_desc.res.mipmap.mipmap = mipmappedArray;
+      }
       
       cudaTextureDesc tex_desc     = {};
       if (addressMode == OWL_TEXTURE_BORDER) {
@@ -124,10 +184,10 @@ namespace owl {
         : cudaReadModeElementType;
       tex_desc.normalizedCoords    = 1;
       tex_desc.maxAnisotropy       = 1;
-      tex_desc.maxMipmapLevelClamp = 0;
-      // tex_desc.maxMipmapLevelClamp = 99;
+      tex_desc.maxMipmapLevelClamp = float(numLevels-1);
       tex_desc.minMipmapLevelClamp = 0;
-      tex_desc.mipmapFilterMode    = cudaFilterModePoint;
+      // linear filtering is trilinear for mipmapped textures
+      tex_desc.mipmapFilterMode    = tex_desc.filterMode;
       tex_desc.borderColor[0]      = 1.0f;
       tex_desc.borderColor[1]      = 1.0f;
       tex_desc.borderColor[2]      = 1.0f;
@@ -149,6 +209,18 @@ namespace owl {
     return textureObjects[deviceID];
   }
 
+  size_t Texture::getDeviceMemoryUsage(const DeviceContext::SP &device) const
+  {
+    if (ID < 0)
+      /* already destroyed */
+      return 0;
+    size_t numTexels = 0;
+    for (int level=0;level<numLevels;level++)
+      numTexels
+        += size_t(max(size.x>>level,1))*size_t(max(size.y>>level,1));
+    return numTexels*bytesPerTexel(texelFormat);
+  }
+
   Texture::~Texture()
   {
     destroy();
@@ -167,7 +239,10 @@ namespace owl {
       SetActiveGPU forLifeTime(device);
       uint32_t id = device->ID;
       cudaDestroyTextureObject(textureObjects[id]);
-      cudaFreeArray(textureArrays[id]);
+      if (textureArrays[id])
+        cudaFreeArray(textureArrays[id]);
+      if (mipmappedArrays[id])
+        cudaFreeMipmappedArray(mipmappedArrays[id]);
     }
 
     deviceData.clear();
@@ -33,6 +33,19 @@ namespace owl {
             OWLTextureColorSpace colorSpace,
             const void          *texels
             );
+
+    /*! a mipmapped texture: 'levels[i]' are the (tightly packed)
+        texels of level i, of size max(size>>i,1); see
+        owl/common/image/MipChain.h for computing those */
+    Texture(Context *const context,
+            vec2i                size,
+            int                  numLevels,
+            const void *const   *levels,
+            OWLTexelFormat       texelFormat,
+            OWLTextureFilterMode filterMode,
+            OWLTextureAddressMode addressMode,
+            OWLTextureColorSpace colorSpace
+            );
     
     /*! destructor - free device data, de-regsiter, and destruct */
     virtual ~Texture();
@@ -43,20 +56,33 @@ namespace owl {
        device ID*/
     cudaTextureObject_t getObject(int deviceID);
 
+    /*! bytes of device memory this texture's texels (over all mip
+        levels) use on the given device */
+    size_t getDeviceMemoryUsage(const DeviceContext::SP &device) const;
+
     
     /*! destroy whatever resources this texture's ll-layer handle this
         may refer to; this will not destruct the current object
         itself, but should already release all its references */
     void destroy();
 
-    /*! one entry per device */
-    std::vector<cudaTextureObject_t> textureObjects;
-    std::vector<cudaArray_t>         textureArrays;
+    /*! one entry per device; for mipmapped textures, the
+        textureArrays are null, otherwise the mipmappedArrays */
+    std::vector<cudaTextureObject_t>  textureObjects;
+    std::vector<cudaArray_t>          textureArrays;
+    std::vector<cudaMipmappedArray_t> mipmappedArrays;
     
     vec2i                size;
+    int                  numLevels { 1 };
     uint32_t             linePitchInBytes;
     OWLTexelFormat       texelFormat;
     OWLTextureFilterMode filterMode;
+
+  private:
+    /*! creates the (single or mipmapped) texture on all devices */
+    void create(const void *const   *levels,
+                OWLTextureAddressMode addressMode,
+                OWLTextureColorSpace colorSpace);
   };
 
 } // ::owl
@@ -16,58 +16,10 @@
 
 #include "Triangles.h"
 #include "Context.h"
+#include "GeomBoundsBatch.h"
 
 namespace owl {
 
-  __device__ static float atomicMax(float* address, float val)
-  {
-    int* address_as_i = (int*) address;
-    int old = *address_as_i, assumed;
-    do {
-      assumed = old;
-      old = ::atomicCAS(address_as_i, assumed,
-                        __float_as_int(::fmaxf(val, __int_as_float(assumed))));
-    } while (assumed != old);
-    return __int_as_float(old);
-  }
-  
-  __device__ static float atomicMin(float* address, float val)
-  {
-    int* address_as_i = (int*) address;
-    int old = *address_as_i, assumed;
-    do {
-      assumed = old;
-      old = ::atomicCAS(address_as_i, assumed,
-                        __float_as_int(::fminf(val, __int_as_float(assumed))));
-    } while (assumed != old);
-    return __int_as_float(old);
-  }
-
-  /*! device kernel to compute bounding box ov vertex array (and thus,
-      bbox of triangle mesh, for motion blur (which for instances
-      requies knowing the bboxes of its objects */
-  __global__ void computeBoundsOfVertices(box3f *d_bounds,
-                                          const void *d_vertices,
-                                          size_t count,
-                                          size_t stride,
-                                          size_t offset)
-  {
-    int tid = blockDim.x * blockIdx.x + threadIdx.x;
-    if (tid >= count) return;
-
-    const uint8_t *ptr = (const uint8_t *)d_vertices;
-    ptr += tid*stride;
-    ptr += offset;
-
-    vec3f vtx = *(const vec3f*)ptr;
-    atomicMin(&d_bounds->lower.x,vtx.x);
-    atomicMin(&d_bounds->lower.y,vtx.y);
-    atomicMin(&d_bounds->lower.z,vtx.z);
-    atomicMax(&d_bounds->upper.x,vtx.x);
-    atomicMax(&d_bounds->upper.y,vtx.y);
-    atomicMax(&d_bounds->upper.z,vtx.z);
-  }
-                                          
   // ------------------------------------------------------------------
   // TrianglesGeomType
   // ------------------------------------------------------------------
@@ -116,37 +68,41 @@ namespace owl {
     return "TrianglesGeom";
   }
 
-  /*! call a cuda kernel that computes the bounds of the vertex buffers */
-  void TrianglesGeom::computeBounds(box3f bounds[2])
+  /*! add jobs for this mesh's vertex arrays (on given device) to the
+      given bounds batch, two motion keys per job so the common
+      two-key case reads the vertices in a single pass; returns the
+      first job's ID. Since each job writes two boxes, the bounds of
+      key k end up in result box 2*firstJobID+k */
+  int TrianglesGeom::addBoundsJobs(GeomBoundsBatch &batch,
+                                   const DeviceContext::SP &device)
   {
-    assert(vertex.buffers.size() == 1 || vertex.buffers.size() == 2);
-
-    int numThreads = 1024;
-    int numBlocks = int((vertex.count + numThreads - 1) / numThreads);
+    assert(!vertex.buffers.empty());
+    const int firstJobID = batch.numJobs();
+    const size_t numKeys = vertex.buffers.size();
+    for (size_t key=0;key<numKeys;key+=2)
+      batch.addVertices(vertex.buffers[key]->getPointer(device),
+                        key+1 < numKeys
+                        ? vertex.buffers[key+1]->getPointer(device)
+                        : nullptr,
+                        vertex.count,vertex.stride,vertex.offset);
+    return firstJobID;
+  }
 
+  /*! compute the bounds of the vertex buffers, one per motion key,
+      on the first GPU */
+  std::vector<box3f> TrianglesGeom::computeBounds()
+  {
     DeviceContext::SP device = context->getDevice(0);
     assert(device);
-    SetActiveGPU forLifeTime(device);
-      
-    DeviceMemory d_bounds;
-    d_bounds.alloc(2*sizeof(box3f));
-    bounds[0] = bounds[1] = box3f();
-    d_bounds.upload(bounds);
-    computeBoundsOfVertices<<<numBlocks,numThreads>>>
-      (((box3f*)d_bounds.get())+0,
-       vertex.buffers[0]->getPointer(device),
-       vertex.count,vertex.stride,vertex.offset);
-    if (vertex.buffers.size() == 2)
-      computeBoundsOfVertices<<<numBlocks,numThreads>>>
-        (((box3f*)d_bounds.get())+1,
-         vertex.buffers[1]->getPointer(device),
-         vertex.count,vertex.stride,vertex.offset);
-    OWL_CUDA_SYNC_CHECK();
-    d_bounds.download(&bounds[0]);
-    d_bounds.free();
-    OWL_CUDA_SYNC_CHECK();
-    if (vertex.buffers.size() == 1)
-      bounds[1] = bounds[0];
+
+    GeomBoundsBatch batch;
+    addBoundsJobs(batch,device);
+    std::vector<box3f> bounds(2*batch.numJobs());
+    device->computeGeomBounds(batch,bounds.data());
+    // (with an odd number of keys, the last job's second box only
+    // repeats its first)
+    bounds.resize(vertex.buffers.size());
+    return bounds;
   }
 
   RegisteredObject::DeviceData::SP TrianglesGeom::createOn(const DeviceContext::SP &device) 
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "Geometry.h"
+#include "owl/common/geometry/triangleMeshPreprocessing.h"
 
 namespace owl {
 
@@ -52,7 +53,7 @@ namespace owl {
 
       /*! this is a *vector* of vertex arrays, for motion blur
           purposes. ie, for static meshes only one entry is used, for
-          motion blur two (and eventually, maybe more) will be used */
+          motion blur one per motion key */
       std::vector<CUdeviceptr> vertexPointers;
 
       /*! device poiner to array of indices - the memory for the
@@ -87,12 +88,40 @@ namespace owl {
                     size_t stride,
                     size_t offset);
 
-    /*! call a cuda kernel that computes the bounds of the vertex buffers */
-    void computeBounds(box3f bounds[2]);
+    /*! add jobs for this mesh's vertex arrays (on given device) to
+        the given bounds batch, two motion keys per job; returns the
+        first job's ID, key k's bounds are result box 2*firstJobID+k */
+    int addBoundsJobs(GeomBoundsBatch &batch, const DeviceContext::SP &device);
+
+    /*! compute the bounds of the vertex buffers, one per motion key,
+        on the first GPU */
+    std::vector<box3f> computeBounds();
+
+    /*! welds, cleans up, and re-orders this mesh's vertices and
+        indices on the host (see triangleMeshPreprocessing.h), and
+        writes the results back into the same buffers - which
+        therefore have to be compact arrays of float3s and int3s -
+        so any geom variables that refer to them stay valid. The
+        remap tables get stored in newToOldVertex and
+        newToOldTriangle. Any groups (and the SBT) using this mesh
+        have to be (re-)built afterwards. If 'indicesAreStrip' is
+        set, the index buffer (as set with setIndices) is read as
+        'count' 32-bit indices of a triangle strip, with ~0 as restart
+        index, which gets converted to a list first; the triangle
+        remap then refers to triangles in the order
+        triangleStripToList() produces them */
+    void preprocess(const TriangleMeshPreprocessConfig &config,
+                    bool indicesAreStrip = false);
 
     /*! pretty-print */
     std::string toString() const override;
 
+    /*! @{ remap tables of the last preprocess(): for each vertex and
+        triangle, the one in the input it came from */
+    std::vector<uint32_t> newToOldVertex;
+    std::vector<uint32_t> newToOldTriangle;
+    /*! @} */
+    
     struct {
       size_t count  = 0;
       size_t stride = 0;
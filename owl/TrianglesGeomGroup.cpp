@@ -17,6 +17,7 @@
 #include "TrianglesGeomGroup.h"
 #include "Triangles.h"
 #include "Context.h"
+#include "GeomBoundsBatch.h"
 
 #define LOG(message)                                            \
   if (Context::logging())                                       \
@@ -47,16 +48,29 @@ namespace owl {
     buildFlags( (_buildFlags > 0) ? _buildFlags : defaultBuildFlags)
   {}
   
+  /*! computes the bounds of all meshes in one batch (ie, one launch
+      per reduction stage), on the first GPU */
   void TrianglesGeomGroup::updateMotionBounds()
   {
-    bounds[0] = bounds[1] = box3f();
+    DeviceContext::SP device = context->getDevice(0);
+    GeomBoundsBatch batch;
+    // one job per mesh and pair of motion keys
+    std::vector<int> firstJob, numKeys;
     for (auto geom : geometries) {
       TrianglesGeom::SP mesh = geom->as<TrianglesGeom>();
-      box3f meshBounds[2];
-      mesh->computeBounds(meshBounds);
-      for (int i=0;i<2;i++)
-        bounds[i].extend(meshBounds[i]);
+      assert(mesh);
+      firstJob.push_back(mesh->addBoundsJobs(batch,device));
+      numKeys.push_back((int)mesh->vertex.buffers.size());
     }
+    std::vector<box3f> jobBounds(2*batch.numJobs());
+    device->computeGeomBounds(batch,jobBounds.data());
+
+    // all meshes in a group have the same number of keys (or the
+    // build would have failed)
+    bounds.assign(numKeys.empty() ? 1 : numKeys[0],box3f());
+    for (size_t meshID=0;meshID<firstJob.size();meshID++)
+      for (int key=0;key<numKeys[meshID] && key<(int)bounds.size();key++)
+        bounds[key].extend(jobBounds[2*firstJob[meshID]+key]);
   }
   
   void TrianglesGeomGroup::buildAccel()
@@ -0,0 +1,116 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "Triangles.h"
+#include "Context.h"
+
+#define LOG(message)                                            \
+  if (Context::logging())                                       \
+    std::cout << "#owl(" << device->ID << "): "                 \
+              << message                                        \
+              << std::endl
+
+namespace owl {
+
+  /*! whether 'count' elements of 'elementSize' bytes, at given stride
+      and offset, are exactly the buffer's contents, so we can write
+      the results back in place */
+  static bool isCompact(const Buffer::SP &buffer,
+                        size_t stride, size_t offset,
+                        size_t elementSize)
+  {
+    return buffer
+      && sizeOf(buffer->type) == elementSize
+      && stride == elementSize
+      && offset == 0;
+  }
+  
+  void TrianglesGeom::preprocess(const TriangleMeshPreprocessConfig &config,
+                                 bool indicesAreStrip)
+  {
+    if (!index.buffer || vertex.buffers.empty())
+      OWL_RAISE("triangle mesh preprocessing: vertices and indices "
+                "have to be set first");
+    for (auto &buffer : vertex.buffers)
+      if (!isCompact(buffer,vertex.stride,vertex.offset,sizeof(vec3f)))
+        OWL_RAISE("triangle mesh preprocessing works in place, so "
+                  "needs compact float3 vertex buffers");
+    if (indicesAreStrip
+        ? !isCompact(index.buffer,index.stride,index.offset,sizeof(uint32_t))
+        : !isCompact(index.buffer,index.stride,index.offset,sizeof(vec3i)))
+      OWL_RAISE("triangle mesh preprocessing works in place, so "
+                "needs a compact int3 index buffer (or int, for strips)");
+    
+    // ------------------------------------------------------------------
+    // get everything to the host...
+    // ------------------------------------------------------------------
+    DeviceContext::SP device = context->getDevice(0);
+    std::vector<std::vector<uint8_t>> vertexBytes;
+    std::vector<StridedVec3fs> vertexKeys;
+    for (auto &buffer : vertex.buffers) {
+      vertexBytes.push_back(buffer->download(device));
+      vertexKeys.push_back(StridedVec3fs(vertexBytes.back().data(),
+                                         vertex.count,vertex.stride,
+                                         vertex.offset));
+    }
+    const std::vector<uint8_t> indexBytes = index.buffer->download(device);
+    std::vector<vec3i> stripTriangles;
+    if (indicesAreStrip)
+      stripTriangles = triangleStripToList((const uint32_t *)indexBytes.data(),
+                                           index.count);
+    const StridedVec3is indices
+      = indicesAreStrip
+      ? StridedVec3is(stripTriangles)
+      : StridedVec3is(indexBytes.data(),index.count,index.stride,index.offset);
+
+    // ------------------------------------------------------------------
+    // ... preprocess...
+    // ------------------------------------------------------------------
+    TriangleMeshPreprocessResult result
+      = preprocessTriangleMesh(vertexKeys,indices,config);
+    LOG("preprocessed triangle mesh: "
+        << vertex.count << " -> " << result.newToOldVertex.size()
+        << " vertices, "
+        << indices.count << " -> " << result.indices.size()
+        << " triangles");
+    if (result.indices.empty())
+      OWL_RAISE("triangle mesh preprocessing removed all triangles "
+                "(all of them are degenerate)");
+    
+    // ------------------------------------------------------------------
+    // ... and write it back, into the same buffers
+    // ------------------------------------------------------------------
+    const size_t numVertices = result.newToOldVertex.size();
+    for (size_t key=0;key<vertex.buffers.size();key++) {
+      vertex.buffers[key]->resize(numVertices);
+      vertex.buffers[key]->upload(result.vertices[key].data(),0,numVertices);
+    }
+    const size_t numTriangles = result.indices.size();
+    // (in case of strips, the buffer's elements are single ints)
+    const size_t numIndexElements
+      = numTriangles*sizeof(vec3i)/sizeOf(index.buffer->type);
+    index.buffer->resize(numIndexElements);
+    index.buffer->upload(result.indices.data(),0,numIndexElements);
+    
+    // resizing may have changed the buffers' device addresses
+    setVertices(vertex.buffers,numVertices,sizeof(vec3f),0);
+    setIndices(index.buffer,numTriangles,sizeof(vec3i),0);
+    
+    newToOldVertex   = std::move(result.newToOldVertex);
+    newToOldTriangle = std::move(result.newToOldTriangle);
+  }
+  
+} // ::owl
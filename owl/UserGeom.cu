@@ -16,6 +16,7 @@
 
 #include "UserGeom.h"
 #include "Context.h"
+#include "GeomBoundsBatch.h"
 
 namespace owl {
 
@@ -31,48 +32,6 @@ namespace owl {
               << "#owl(" << device->ID << "): "                 \
               << message << OWL_TERMINAL_DEFAULT << std::endl
 
-  __device__ static float atomicMax(float* address, float val)
-  {
-    int* address_as_i = (int*) address;
-    int old = *address_as_i, assumed;
-    do {
-      assumed = old;
-      old = ::atomicCAS(address_as_i, assumed,
-                        __float_as_int(::fmaxf(val, __int_as_float(assumed))));
-    } while (assumed != old);
-    return __int_as_float(old);
-  }
-  
-  __device__ static float atomicMin(float* address, float val)
-  {
-    int* address_as_i = (int*) address;
-    int old = *address_as_i, assumed;
-    do {
-      assumed = old;
-      old = ::atomicCAS(address_as_i, assumed,
-                        __float_as_int(::fminf(val, __int_as_float(assumed))));
-    } while (assumed != old);
-    return __int_as_float(old);
-  }
-  
-  __global__ void computeBoundsOfPrimBounds(box3f *d_bounds,
-                                            const box3f *d_primBounds,
-                                            size_t count)
-  {
-    int tid = blockDim.x * blockIdx.x + threadIdx.x;
-    if (tid >= count) return;
-
-    box3f box = d_primBounds[tid];
-    if (!box.empty()) {
-      atomicMin(&d_bounds->lower.x,box.lower.x);
-      atomicMin(&d_bounds->lower.y,box.lower.y);
-      atomicMin(&d_bounds->lower.z,box.lower.z);
-      atomicMax(&d_bounds->upper.x,box.upper.x);
-      atomicMax(&d_bounds->upper.y,box.upper.y);
-      atomicMax(&d_bounds->upper.z,box.upper.z);
-    }
-  }
-                                          
   /*! construct a new device-data for this type */
   UserGeomType::DeviceData::DeviceData(const DeviceContext::SP &device)
     : GeomType::DeviceData(device)
@@ -109,32 +68,28 @@ namespace owl {
   std::string UserGeom::toString() const
   { return "UserGeom"; }
   
-  /*! call a cuda kernel that computes the bounds of the vertex
-      buffers. note we alwyas (and only) do this on the first GPU */
-  void UserGeom::computeBounds(box3f bounds[2])
+  /*! add a job for this geom's prim bounds (as computed by the
+      last executeBoundsProgOnPrimitives() on that device) to the
+      given bounds batch; returns the job's ID */
+  int UserGeom::addBoundsJob(GeomBoundsBatch &batch,
+                             const DeviceContext::SP &device)
   {
-    int numThreads = 1024;
-    int numBlocks = int((primCount + numThreads - 1) / numThreads);
+    DeviceData &dd = getDD(device);
+    assert("user geom is either empty, or has valid bounds buffer"
+           && ((primCount == 0) || dd.internalBufferForBoundsProgram.alloced()));
+    return batch.addPrimBounds((const box3f *)dd.internalBufferForBoundsProgram.get(),
+                               nullptr,primCount);
+  }
 
+  /*! compute the bounds of the prim bounds computed by the bounds
+      program. note we alwyas (and only) do this on the first GPU */
+  void UserGeom::computeBounds(box3f bounds[2])
+  {
     DeviceContext::SP device = context->getDevices()[0];
-    SetActiveGPU forLifeTime(device);
-
-    DeviceMemory d_bounds;
-    d_bounds.alloc(sizeof(box3f));
-    bounds[0] = bounds[1] = box3f();
-    d_bounds.upload(bounds);
 
-    DeviceData &dd = getDD(device);
-    
-    computeBoundsOfPrimBounds<<<numBlocks,numThreads>>>
-      (((box3f*)d_bounds.get())+0,
-       (box3f *)dd.internalBufferForBoundsProgram.get(),
-       primCount);
-    OWL_CUDA_SYNC_CHECK();
-    d_bounds.download(&bounds[0]);
-    d_bounds.free();
-    OWL_CUDA_SYNC_CHECK();
-    bounds[1] = bounds[0];
+    GeomBoundsBatch batch;
+    addBoundsJob(batch,device);
+    device->computeGeomBounds(batch,bounds);
   }
 
   UserGeomType::UserGeomType(Context *const context,
@@ -128,9 +128,13 @@ namespace owl {
     /*! set number of primitives that this geom will contain */
     void setPrimCount(size_t count);
     
-    /*! call a cuda kernel that computes the bounds *across* all
-      primitives within this group; may only get caleld after bound
-      progs have been executed */
+    /*! add a job for this geom's prim bounds (on given device) to
+        the given bounds batch; returns the job's ID. may only get
+        called after bound progs have been executed on that device */
+    int addBoundsJob(GeomBoundsBatch &batch, const DeviceContext::SP &device);
+
+    /*! compute the bounds *across* all primitives within this geom;
+      may only get caleld after bound progs have been executed */
     void computeBounds(box3f bounds[2]);
 
     /*! run the bounding box program for all primitives within this geometry */
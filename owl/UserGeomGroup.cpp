@@ -16,6 +16,7 @@
 
 #include "UserGeomGroup.h"
 #include "Context.h"
+#include "GeomBoundsBatch.h"
 
 #define LOG(message)                                            \
   if (Context::logging())                                       \
@@ -64,6 +65,38 @@ namespace owl {
     buildOrRefit(false);
   }
 
+  void UserGeomGroup::computeBoundsFromPrimBounds(const DeviceContext::SP &device)
+  {
+    GeomBoundsBatch batch;
+    for (auto child : geometries) {
+      UserGeom::SP userGeom = child->as<UserGeom>();
+      assert(userGeom);
+      userGeom->addBoundsJob(batch,device);
+    }
+    std::vector<box3f> geomBounds(2*batch.numJobs());
+    device->computeGeomBounds(batch,geomBounds.data());
+
+    bounds.assign(2,box3f());
+    for (int jobID=0;jobID<batch.numJobs();jobID++)
+      for (int i=0;i<2;i++)
+        bounds[i].extend(geomBounds[2*jobID+i]);
+  }
+
+  void UserGeomGroup::updateMotionBounds()
+  {
+    DeviceContext::SP device = context->getDevice(0);
+    for (auto child : geometries)
+      child->as<UserGeom>()->executeBoundsProgOnPrimitives(device);
+
+    computeBoundsFromPrimBounds(device);
+
+    for (auto child : geometries) {
+      UserGeom::DeviceData &ugDD = child->as<UserGeom>()->getDD(device);
+      if (ugDD.internalBufferForBoundsProgram.alloced())
+        ugDD.internalBufferForBoundsProgram.free();
+    }
+  }
+
   /*! low-level accel structure builder for given device */
   template<bool FULL_REBUILD>
   void UserGeomGroup::buildAccelOn(const DeviceContext::SP &device)
@@ -304,6 +337,11 @@ namespace owl {
 
     LOG_OK("successfully built user geom group accel");
 
+    // the prim bounds are about to get freed, so if anybody needs
+    // the group's bounds, now is the time to compute them
+    if (context->motionBlurEnabled && device->ID == 0)
+      computeBoundsFromPrimBounds(device);
+
     // size_t sumPrims = 0;
     size_t sumBoundsMem = 0;
     for (size_t childID=0;childID<geometries.size();childID++) {
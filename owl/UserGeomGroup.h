@@ -38,6 +38,15 @@ namespace owl {
     void buildAccel() override;
     void refitAccel() override;
 
+    /*! re-runs the children's bounds programs on the first GPU, and
+        computes this group's bounds from those */
+    void updateMotionBounds() override;
+
+    /*! computes this group's bounds from its children's prim bounds
+        on the given device, in one batch; may only get called while
+        those (ie, the outputs of the bounds programs) are valid */
+    void computeBoundsFromPrimBounds(const DeviceContext::SP &device);
+
     /*! low-level accel structure builder for given device */
     template<bool FULL_REBUILD>
     void buildAccelOn(const DeviceContext::SP &device);
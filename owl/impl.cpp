@@ -18,6 +18,7 @@
 #include "APIContext.h"
 #include "APIHandle.h"
 #include "owl/common/parallel/parallel_for.h"
+#include "owl/common/geometry/sphereClustering.h"
 #include "Triangles.h"
 #include "UserGeom.h"
 #include "CurvesGeom.h"
@@ -92,6 +93,22 @@ OWL_API OptixDeviceContext owlContextGetOptixContext(OWLContext _context, int de
   return checkGet(_context)->getDevice(deviceID)->optixContext;
 }
 
+OWL_API void owlContextGetDeviceMemoryInfo(OWLContext _context, int deviceID,
+                                           size_t *bytesUsed, size_t *bytesTotal)
+{
+  LOG_API_CALL();
+  APIContext::SP context = checkGet(_context);
+  DeviceContext::SP device = context->getDevice(deviceID);
+  if (bytesUsed)
+    *bytesUsed = context->getDeviceMemoryUsage(device);
+  if (bytesTotal) {
+    SetActiveGPU forLifeTime(device);
+    size_t bytesFree = 0, total = 0;
+    OWL_CUDA_CHECK(cudaMemGetInfo(&bytesFree,&total));
+    *bytesTotal = total;
+  }
+}
+
 /*! set number of ray types to be used in this context; this should be
   done before any programs, pipelines, geometries, etc get
   created */
@@ -716,6 +733,31 @@ owlTexture2DCreate(OWLContext _context,
   return (OWLTexture)context->createHandle(texture);
 }
 
+OWL_API OWLTexture
+owlTexture2DCreateMipmapped(OWLContext _context,
+                            OWLTexelFormat texelFormat,
+                            uint32_t size_x,
+                            uint32_t size_y,
+                            int numLevels,
+                            const void *const *levelTexels,
+                            OWLTextureFilterMode filterMode,
+                            OWLTextureAddressMode addressMode,
+                            OWLTextureColorSpace colorSpace)
+{
+  LOG_API_CALL();
+  APIContext::SP context = checkGet(_context);
+  Texture::SP  texture
+    = context->texture2DCreateMipmapped(texelFormat,
+                                        filterMode,
+                                        addressMode,
+                                        colorSpace,
+                                        vec2i(size_x,size_y),
+                                        numLevels,
+                                        levelTexels);
+  assert(texture);
+  return (OWLTexture)context->createHandle(texture);
+}
+
 OWL_API CUtexObject
 owlTextureGetObject(OWLTexture _texture, int deviceID)
 {
@@ -844,6 +886,16 @@ owlParamsGetCudaStream(OWLLaunchParams _lp, int deviceID)
   return lp->getCudaStream(lp->context->getDevice(deviceID));
 }
 
+OWL_API void
+owlParamsSetNumSlots(OWLLaunchParams _lp, int numSlots)
+{
+  LOG_API_CALL();
+  if (!_lp) OWL_RAISE("invalid null launch parameters handle");
+  LaunchParams::SP lp = ((APIHandle *)_lp)->get<LaunchParams>();
+  assert(lp);
+  lp->setNumSlots(numSlots);
+}
+
 OWL_API void 
 owlBufferResize(OWLBuffer _buffer, size_t newItemCount)
 {
@@ -1141,6 +1193,48 @@ owlTrianglesSetIndices(OWLGeom   _triangles,
   triangles->setIndices(buffer,count,stride,offset);
 }
 
+OWL_API void
+owlTrianglesPreprocess(OWLGeom _triangles,
+                       float weldTolerance,
+                       int flags)
+{
+  LOG_API_CALL();
+
+  assert(_triangles);
+
+  TrianglesGeom::SP triangles
+    = ((APIHandle *)_triangles)->get<TrianglesGeom>();
+  assert(triangles);
+
+  TriangleMeshPreprocessConfig config;
+  config.weldTolerance
+    = (flags & OWL_TRIANGLES_WELD_VERTICES) ? std::max(weldTolerance,0.f) : -1.f;
+  config.removeDegenerates = (flags & OWL_TRIANGLES_REMOVE_DEGENERATES) != 0;
+  config.reorder           = (flags & OWL_TRIANGLES_REORDER) != 0;
+  triangles->preprocess(config,(flags & OWL_TRIANGLES_FROM_STRIP) != 0);
+}
+
+OWL_API void
+owlTrianglesGetRemap(OWLGeom _triangles,
+                     size_t *numVertices,
+                     const uint32_t **newToOldVertex,
+                     size_t *numTriangles,
+                     const uint32_t **newToOldTriangle)
+{
+  LOG_API_CALL();
+
+  assert(_triangles);
+
+  TrianglesGeom::SP triangles
+    = ((APIHandle *)_triangles)->get<TrianglesGeom>();
+  assert(triangles);
+
+  if (numVertices)      *numVertices      = triangles->newToOldVertex.size();
+  if (newToOldVertex)   *newToOldVertex   = triangles->newToOldVertex.data();
+  if (numTriangles)     *numTriangles     = triangles->newToOldTriangle.size();
+  if (newToOldTriangle) *newToOldTriangle = triangles->newToOldTriangle.data();
+}
+
 // ==================================================================
 // function pointer setters ....
 // ==================================================================
@@ -1571,6 +1665,37 @@ owlInstanceGroupSetTransforms(OWLGroup _group,
 
   group->setTransforms(timeStep,floatsForThisStimeStep,matrixFormat);
 }
+
+OWL_API void
+owlInstanceGroupSetSRTTransforms(OWLGroup _group,
+                                 uint32_t timeStep,
+                                 const OWLSRTTransform *srtsForThisTimeStep)
+{
+  LOG_API_CALL();
+
+  static_assert(sizeof(OWLSRTTransform) == sizeof(SRTTransform),
+                "OWLSRTTransform and owl::common::SRTTransform "
+                "have to have the same layout");
+  assert(_group);
+  InstanceGroup::SP group = ((APIHandle*)_group)->get<InstanceGroup>();
+  assert(group);
+
+  group->setSRTTransforms(timeStep,
+                          (const SRTTransform *)srtsForThisTimeStep);
+}
+  
+OWL_API void
+owlInstanceGroupSetNumMotionKeys(OWLGroup _group,
+                                 int numKeys)
+{
+  LOG_API_CALL();
+
+  assert(_group);
+  InstanceGroup::SP group = ((APIHandle*)_group)->get<InstanceGroup>();
+  assert(group);
+
+  group->setNumMotionKeys(numKeys);
+}
   
 OWL_API void
 owlInstanceGroupSetInstanceIDs(OWLGroup _group,
@@ -1597,6 +1722,130 @@ owlInstanceGroupSetVisibilityMasks(OWLGroup _group,
 
   group->setVisibilityMasks(visibilityMasks);
 }
+
+OWL_API void
+owlInstanceGroupSetTransformsBuffer(OWLGroup _group,
+                                    OWLBuffer _transforms,
+                                    OWLMatrixFormat matrixFormat)
+{
+  LOG_API_CALL();
+
+  assert(_group);
+  InstanceGroup::SP group = ((APIHandle*)_group)->get<InstanceGroup>();
+  assert(group);
+
+  Buffer::SP transforms
+    = _transforms ? checkGet(_transforms) : Buffer::SP();
+  group->setTransformsBuffer(transforms,matrixFormat);
+}
+
+OWL_API void
+owlInstanceGroupSetInstanceIDsBuffer(OWLGroup _group,
+                                     OWLBuffer _instanceIDs)
+{
+  LOG_API_CALL();
+
+  assert(_group);
+  InstanceGroup::SP group = ((APIHandle*)_group)->get<InstanceGroup>();
+  assert(group);
+
+  Buffer::SP instanceIDs
+    = _instanceIDs ? checkGet(_instanceIDs) : Buffer::SP();
+  group->setInstanceIDsBuffer(instanceIDs);
+}
+
+OWL_API void
+owlInstanceGroupSetVisibilityMasksBuffer(OWLGroup _group,
+                                         OWLBuffer _visibilityMasks)
+{
+  LOG_API_CALL();
+
+  assert(_group);
+  InstanceGroup::SP group = ((APIHandle*)_group)->get<InstanceGroup>();
+  assert(group);
+
+  Buffer::SP visibilityMasks
+    = _visibilityMasks ? checkGet(_visibilityMasks) : Buffer::SP();
+  group->setVisibilityMasksBuffer(visibilityMasks);
+}
+
+OWL_API void
+owlInstanceGroupSetLODs(OWLGroup _group,
+                        int whichChild,
+                        int numLODs,
+                        const OWLGroup *_lodGroups,
+                        const float *maxDistances)
+{
+  LOG_API_CALL();
+
+  assert(_group);
+  InstanceGroup::SP group = ((APIHandle*)_group)->get<InstanceGroup>();
+  assert(group);
+
+  assert(numLODs > 0);
+  assert(_lodGroups);
+  assert(maxDistances);
+  std::vector<Group::SP> lodGroups(numLODs);
+  for (int i=0;i<numLODs;i++) {
+    assert(_lodGroups[i]);
+    lodGroups[i] = ((APIHandle*)_lodGroups[i])->get<Group>();
+    assert(lodGroups[i]);
+  }
+  group->setLODs(whichChild,lodGroups,
+                 std::vector<float>(maxDistances,maxDistances+numLODs));
+}
+
+OWL_API void
+owlInstanceGroupSetCullingView(OWLGroup _group,
+                               owl3f eye,
+                               owl3f at,
+                               owl3f up,
+                               float fovyInDegrees,
+                               float aspect,
+                               float nearDist,
+                               float farDist,
+                               float lodScale)
+{
+  LOG_API_CALL();
+
+  assert(_group);
+  InstanceGroup::SP group = ((APIHandle*)_group)->get<InstanceGroup>();
+  assert(group);
+
+  CullingView view
+    = CullingView::fromCamera(vec3f(eye.x,eye.y,eye.z),
+                              vec3f(at.x,at.y,at.z),
+                              vec3f(up.x,up.y,up.z),
+                              fovyInDegrees,aspect,nearDist,farDist);
+  view.lodScale = lodScale;
+  group->setCullingView(view);
+}
+
+OWL_API void
+owlInstanceGroupDisableCulling(OWLGroup _group)
+{
+  LOG_API_CALL();
+
+  assert(_group);
+  InstanceGroup::SP group = ((APIHandle*)_group)->get<InstanceGroup>();
+  assert(group);
+
+  group->disableCulling();
+}
+
+OWL_API size_t
+owlInstanceGroupGetNumActiveInstances(OWLGroup _group)
+{
+  LOG_API_CALL();
+
+  assert(_group);
+  InstanceGroup::SP group = ((APIHandle*)_group)->get<InstanceGroup>();
+  assert(group);
+
+  return group->cullingEnabled
+    ? group->activeInstances.size()
+    : group->children.size();
+}
   
 OWL_API void
 owlInstanceGroupSetTransform(OWLGroup _group,
@@ -1704,6 +1953,46 @@ OWL_API void owlCurvesSetSegmentIndices(OWLGeom   _curves,
 
   curves->setSegmentIndices({buffer},count);
 }
+
+OWL_API void owlCurvesPreprocess(OWLGeom       _curves,
+                                 OWLCurveBasis inputBasis,
+                                 float         maxTurnAngle,
+                                 float         maxWidthRatio,
+                                 float         maxLengthToWidth)
+{
+  LOG_API_CALL();
+
+  assert(_curves);
+
+  CurvesGeom::SP curves
+    = ((APIHandle *)_curves)->get<CurvesGeom>();
+  assert(curves);
+
+  static_assert(int(OWL_CURVE_BASIS_CUBIC_BEZIER) == int(CURVE_BASIS_CUBIC_BEZIER),
+                "OWLCurveBasis and owl::common::CurveBasis have to match");
+  CurvePreprocessConfig config;
+  config.inputBasis       = (CurveBasis)inputBasis;
+  config.maxTurnAngle     = maxTurnAngle;
+  config.maxWidthRatio    = maxWidthRatio;
+  config.maxLengthToWidth = maxLengthToWidth;
+  curves->preprocess(config);
+}
+
+OWL_API void owlCurvesGetSegmentRemap(OWLGeom _curves,
+                                      size_t *numSegments,
+                                      const uint32_t **newToOldSegment)
+{
+  LOG_API_CALL();
+
+  assert(_curves);
+
+  CurvesGeom::SP curves
+    = ((APIHandle *)_curves)->get<CurvesGeom>();
+  assert(curves);
+
+  if (numSegments)     *numSegments     = curves->newToOldSegment.size();
+  if (newToOldSegment) *newToOldSegment = curves->newToOldSegment.data();
+}
                                        
 OWL_API void owlSpheresSetVertices(OWLGeom _spheres,
                                        int numSpheres,
@@ -1734,3 +2023,55 @@ OWL_API void owlSpheresSetVertices(OWLGeom _spheres,
 
 	spheres->setVertices({ vertices_buffer }, { radii_buffer }, numSpheres);
 }
+
+OWL_API void owlSpheresGeomCreateLODs(OWLContext   _context,
+                                      OWLGeomType  _spheresGT,
+                                      const owl3f *centers,
+                                      const float *radii,
+                                      float        radius,
+                                      size_t       numSpheres,
+                                      int          numLODs,
+                                      const float  *maxCellSizes,
+                                      const size_t *maxSpheres,
+                                      OWLGeom      *lods)
+{
+  LOG_API_CALL();
+
+  assert(_spheresGT);
+  assert(centers);
+  assert(lods);
+  APIContext::SP context = checkGet(_context);
+
+  GeomType::SP spheresGT
+    = ((APIHandle *)_spheresGT)->get<GeomType>();
+  assert(spheresGT);
+
+  const StridedVec3fs inputCenters(centers,numSpheres);
+  const StridedArray<float> inputRadii
+    = radii
+    ? StridedArray<float>(radii,numSpheres)
+    : StridedArray<float>(&radius,numSpheres,0);
+  const SphereLODHierarchy hierarchy
+    = buildSphereLODs(inputCenters,inputRadii);
+
+  std::vector<vec3f> lodCenters;
+  std::vector<float> lodRadii;
+  for (int i=0;i<numLODs;i++) {
+    const int lod
+      = selectSphereLOD(hierarchy,
+                        maxCellSizes ? maxCellSizes[i] : 0.f,
+                        maxSpheres   ? maxSpheres[i]   : 0);
+    getSphereLOD(hierarchy,lod,inputCenters,inputRadii,lodCenters,lodRadii);
+    
+    SphereGeom::SP spheres
+      = std::dynamic_pointer_cast<SphereGeom>(spheresGT->createGeom());
+    if (!spheres)
+      OWL_RAISE("owlSpheresGeomCreateLODs needs a spheres geometry type");
+    Buffer::SP vertices_buffer
+      = context->deviceBufferCreate(OWL_FLOAT3,lodCenters.size(),lodCenters.data());
+    Buffer::SP radii_buffer
+      = context->deviceBufferCreate(OWL_FLOAT,lodRadii.size(),lodRadii.data());
+    spheres->setVertices({ vertices_buffer }, { radii_buffer }, lodCenters.size());
+    lods[i] = (OWLGeom)context->createHandle(spheres);
+  }
+}
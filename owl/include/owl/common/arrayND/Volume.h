@@ -0,0 +1,171 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file Volume.h a host-side container for 3D volumes of any cell
+    type, stored in any of the layouts of VolumeLayout.h. The
+    volume's storage can directly be uploaded into an OWLBuffer (see
+    owlVolumeBufferCreate() in owl_host.h), and device code can then
+    address that buffer through the volume's layout (see volumeFetch()
+    in owl_device.h) */
+
+#include "owl/common/arrayND/VolumeLayout.h"
+#include "owl/common/arrayND/array3D.h"
+#include <vector>
+
+namespace owl {
+  namespace common {
+
+    /*! one brick of a volume: the [begin,end) range of cells it
+        covers (which for bricks on the volume's upper boundaries can
+        be smaller than a full brick), and its index in linear brick
+        order */
+    struct VolumeBrick {
+      vec3i  begin;
+      vec3i  end;
+      size_t brickID;
+    };
+
+    /*! the bricks of a volume, in linear brick order; to be used as
+        'for (const VolumeBrick &brick : volume.bricks()) ...' */
+    struct VolumeBrickRange {
+      struct iterator {
+        inline VolumeBrick operator*() const { return range->getBrick(brickID); }
+        inline iterator &operator++() { ++brickID; return *this; }
+        inline bool operator!=(const iterator &other) const
+        { return brickID != other.brickID; }
+
+        const VolumeBrickRange *range;
+        size_t brickID;
+      };
+
+      inline VolumeBrickRange(const vec3i &dims, int logBrickSize)
+        : dims(dims),
+          logBrickSize(logBrickSize),
+          numBricks(divRoundUp(dims,vec3i(1<<logBrickSize)))
+      {}
+
+      inline size_t size() const
+      {
+        if (dims.x <= 0 || dims.y <= 0 || dims.z <= 0) return 0;
+        return size_t(numBricks.x)*numBricks.y*numBricks.z;
+      }
+      inline iterator begin() const { return iterator{this,0}; }
+      inline iterator end()   const { return iterator{this,size()}; }
+
+      inline VolumeBrick getBrick(size_t brickID) const
+      {
+        const vec3i brick(int(brickID % numBricks.x),
+                          int((brickID / numBricks.x) % numBricks.y),
+                          int(brickID / (size_t(numBricks.x)*numBricks.y)));
+        VolumeBrick result;
+        result.begin   = brick*vec3i(1<<logBrickSize);
+        result.end     = min(result.begin+vec3i(1<<logBrickSize),dims);
+        result.brickID = brickID;
+        return result;
+      }
+
+      const vec3i dims;
+      const int   logBrickSize;
+      const vec3i numBricks;
+    };
+
+    template<typename T>
+    struct Volume {
+      inline Volume() = default;
+      inline Volume(const VolumeLayout &layout)
+        : layout(layout),
+          storage(layout.numStorageElements())
+      {}
+      inline Volume(const vec3i &dims,
+                    VolumeLayoutType type = VOLUME_LAYOUT_LINEAR,
+                    int logBrickSize = 3)
+        : Volume(VolumeLayout(type,dims,logBrickSize))
+      {}
+
+      inline const vec3i &getDims() const { return layout.dims; }
+      inline const VolumeLayout &getLayout() const { return layout; }
+
+      inline T       &operator[](const vec3i &cell)
+      { return storage[layout.index(cell)]; }
+      inline const T &operator[](const vec3i &cell) const
+      { return storage[layout.index(cell)]; }
+
+      /*! the volume's storage, in its layout, including padding */
+      inline T       *data()       { return storage.data(); }
+      inline const T *data() const { return storage.data(); }
+      inline size_t   numStorageElements() const { return storage.size(); }
+      inline size_t   sizeInBytes() const { return storage.size()*sizeof(T); }
+
+      /*! the bricks of this volume. If not specified otherwise, these
+          are the layout's bricks for bricked volumes (so each brick
+          is one contiguous range of storage), and 8^3 bricks for
+          all others */
+      inline VolumeBrickRange bricks(int logBrickSize = -1) const
+      {
+        return VolumeBrickRange(getDims(),
+                                logBrickSize >= 0
+                                ? logBrickSize
+                                : (layout.type == VOLUME_LAYOUT_BRICKED
+                                   ? layout.logBrickSize
+                                   : 3));
+      }
+
+      /*! calls lambda(const VolumeBrick &) for all bricks (as in
+          bricks()), in parallel */
+      template<typename Lambda>
+      inline void parallel_for_bricks(const Lambda &lambda,
+                                      int logBrickSize = -1) const
+      {
+        const VolumeBrickRange range = bricks(logBrickSize);
+        owl::common::parallel_for(range.size(),[&](size_t brickID){
+            lambda(range.getBrick(brickID));
+          });
+      }
+
+      /*! returns a copy of this volume in the given layout; cells get
+          copied in parallel, brick by brick of the new layout */
+      inline Volume<T> convertedTo(const VolumeLayout &newLayout) const;
+      inline Volume<T> convertedTo(VolumeLayoutType type,
+                                   int logBrickSize = 3) const
+      { return convertedTo(VolumeLayout(type,getDims(),logBrickSize)); }
+
+      /*! changes this volume's layout to the given one */
+      inline void convertTo(VolumeLayoutType type, int logBrickSize = 3)
+      { *this = convertedTo(type,logBrickSize); }
+
+      VolumeLayout   layout;
+      std::vector<T> storage;
+    };
+
+    template<typename T>
+    inline Volume<T> Volume<T>::convertedTo(const VolumeLayout &newLayout) const
+    {
+      if (newLayout.dims != getDims())
+        throw std::runtime_error("#owl.common: Volume::convertedTo() "
+                                 "cannot change the volume's dims");
+      Volume<T> result(newLayout);
+      result.parallel_for_bricks([&](const VolumeBrick &brick){
+          array3D::for_each(brick.begin,brick.end,[&](const vec3i &cell){
+              result[cell] = (*this)[cell];
+            });
+        });
+      return result;
+    }
+
+  } // ::owl::common
+} // ::owl
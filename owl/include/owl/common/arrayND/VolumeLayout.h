@@ -0,0 +1,116 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file VolumeLayout.h describes how the cells of a 3D volume are
+    laid out in memory. This only does the addressing, so it can be
+    used on both host and device: on the host, it is what
+    owl::common::Volume (see Volume.h) is built on; on the device,
+    passing a VolumeLayout along with the volume's buffer is all it
+    takes to address that buffer (see volumeFetch and friends in
+    owl_device.h) */
+
+#include "owl/common/math/morton.h"
+
+namespace owl {
+  namespace common {
+
+    typedef enum {
+      /*! x fastest, then y, then z - what array3D::linear() does */
+      VOLUME_LAYOUT_LINEAR,
+      /*! cubic bricks of 2^logBrickSize cells per side, each stored
+          contiguously (x fastest within the brick), with bricks
+          stored in linear order. Storage gets padded to full bricks */
+      VOLUME_LAYOUT_BRICKED,
+      /*! along a Morton (aka Z-order) curve over the whole
+          volume. Storage gets padded to the next power of two per
+          dimension, so this can take up to 8x the memory of the
+          other layouts */
+      VOLUME_LAYOUT_MORTON
+    } VolumeLayoutType;
+
+    struct VolumeLayout {
+      inline __both__ VolumeLayout() {}
+      inline __both__ VolumeLayout(VolumeLayoutType type,
+                                   const vec3i &dims,
+                                   int logBrickSize = 3)
+        : type(type),
+          dims(dims),
+          logBrickSize(logBrickSize),
+          numBricks(divRoundUp(dims,vec3i(1<<logBrickSize))),
+          morton(dims)
+      {}
+
+      /*! number of cells in a (full) brick */
+      inline __both__ size_t cellsPerBrick() const
+      { return size_t(1) << (3*logBrickSize); }
+
+      /*! number of elements the volume's storage has to have; this
+          includes the padding (if any) of the given layout */
+      inline __both__ size_t numStorageElements() const
+      {
+        if (dims.x <= 0 || dims.y <= 0 || dims.z <= 0) return 0;
+        switch (type) {
+        case VOLUME_LAYOUT_BRICKED:
+          return size_t(numBricks.x)*numBricks.y*numBricks.z*cellsPerBrick();
+        case VOLUME_LAYOUT_MORTON:
+          return morton.numCodes();
+        default:
+          return size_t(dims.x)*dims.y*dims.z;
+        }
+      }
+
+      /*! offset of the given cell (which has to be inside the
+          volume) in the volume's storage */
+      inline __both__ size_t index(const vec3i &cell) const
+      {
+        switch (type) {
+        case VOLUME_LAYOUT_BRICKED: {
+          const int mask = (1<<logBrickSize)-1;
+          const size_t brickID
+            = (cell.x >> logBrickSize)
+            + numBricks.x*((cell.y >> logBrickSize)
+                           + size_t(numBricks.y)*(cell.z >> logBrickSize));
+          const size_t inBrick
+            = (cell.x & mask)
+            | ((cell.y & mask) << logBrickSize)
+            | ((cell.z & mask) << (2*logBrickSize));
+          return (brickID << (3*logBrickSize)) | inBrick;
+        }
+        case VOLUME_LAYOUT_MORTON:
+          return morton.encode(cell);
+        default:
+          return cell.x + dims.x*(cell.y + size_t(dims.y)*cell.z);
+        }
+      }
+
+      /*! clamps the given cell to the volume, for clamp-to-edge
+          style addressing */
+      inline __both__ vec3i clamp(const vec3i &cell) const
+      { return max(vec3i(0),min(cell,dims-vec3i(1))); }
+
+      VolumeLayoutType type { VOLUME_LAYOUT_LINEAR };
+      vec3i            dims { 0 };
+      int              logBrickSize { 3 };
+      /*! number of bricks per dimension (for VOLUME_LAYOUT_BRICKED) */
+      vec3i            numBricks { 0 };
+      /*! the volume's Morton order (for VOLUME_LAYOUT_MORTON) */
+      MortonOrder3     morton;
+    };
+
+  } // ::owl::common
+} // ::owl
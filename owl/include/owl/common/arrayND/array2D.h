@@ -17,6 +17,8 @@
 #pragma once
 
 #include <owl/common/math/vec.h>
+#include "owl/common/parallel/parallel_for.h"
+#include "owl/common/arrayND/tiling.h"
 
 namespace owl {
   namespace common {
@@ -43,15 +45,64 @@ namespace owl {
             lambda(vec2i(ix,iy));
       }
 
-// #if OWL_HAVE_PARALLEL_FOR
+      /*! tile size that parallel_for uses if none is specified */
+      inline vec2i defaultTileSize() { return vec2i(64,16); }
+
+      /*! calls lambda(tileBegin,tileEnd) for all tiles of the image,
+          in the given order, on the calling thread */
       template<typename Lambda>
-      inline void parallel_for(const vec2i &dims, const Lambda &lambda)
+      inline void for_each_tile(const vec2i &dims,
+                                const vec2i &tileSize,
+                                const Lambda &lambda,
+                                TileOrder order = TILE_ORDER_MORTON)
       {
-        owl::common::parallel_for(dims.x*dims.y,[&](int index){
-            lambda(vec2i(index%dims.x,index/dims.x));
+        const Tiling2D tiling(dims,tileSize,order);
+        for (size_t slot=0;slot<tiling.numSlots();slot++) {
+          vec2i begin, end;
+          if (tiling.getTileRange(slot,begin,end))
+            lambda(begin,end);
+        }
+      }
+
+      /*! calls lambda(tileBegin,tileEnd) for all tiles of the image,
+          in parallel, with each tile being one task, and tiles
+          getting handed out in the given order */
+      template<typename Lambda>
+      inline void parallel_for_blocked(const vec2i &dims,
+                                       const vec2i &blockSize,
+                                       const Lambda &lambda,
+                                       TileOrder order = TILE_ORDER_MORTON)
+      {
+        const Tiling2D tiling(dims,blockSize,order);
+        owl::common::parallel_for
+          (tiling.numSlots(),[&](size_t slot){
+            vec2i begin, end;
+            if (tiling.getTileRange(slot,begin,end))
+              lambda(begin,end);
           });
       }
-// #endif
+
+      /*! calls lambda(vec2i) for all pixels, in parallel over tiles of
+          the given size, and with plain nested loops within each
+          tile */
+      template<typename Lambda>
+      inline void parallel_for(const vec2i &dims,
+                               const vec2i &tileSize,
+                               const Lambda &lambda,
+                               TileOrder order = TILE_ORDER_MORTON)
+      {
+        array2D::parallel_for_blocked
+          (dims,tileSize,[&](const vec2i &begin, const vec2i &end){
+            array2D::for_each(begin,end,lambda);
+          },order);
+      }
+
+      template<typename Lambda>
+      inline void parallel_for(const vec2i &dims, const Lambda &lambda)
+      {
+        array2D::parallel_for(dims,defaultTileSize(),lambda);
+      }
+
       template<typename Lambda>
       inline void serial_for(const vec2i &dims, const Lambda &lambda)
       {
@@ -59,23 +110,6 @@ namespace owl {
             lambda(vec2i(index%dims.x,index/dims.x));
           });
       }
-    
-      template<typename Lambda>
-      inline void parallel_for_blocked(const vec2i &dims,
-                                       const vec2i &blockSize,
-                                       const Lambda &lambda)
-      {
-        const vec2i numBlocks = divRoundUp(dims,blockSize);
-        array2D::parallel_for
-          (numBlocks,[&](const vec2i &block){
-                       const vec2i begin = block*blockSize;
-                       const vec2i end   = min(begin+blockSize,dims);
-                       lambda(begin,end);
-                       // array2D::for_each(begin,end,
-                       //                   [&](const vec2i &pixel)
-                       //                   { lambda(pixel); });
-                     });
-      }
     } // owl::common::array2D
   } // owl::common
 } // owl
@@ -18,6 +18,7 @@
 
 #include "owl/common/math/vec.h"
 #include "owl/common/parallel/parallel_for.h"
+#include "owl/common/arrayND/tiling.h"
 
 namespace owl {
   namespace common {
@@ -48,16 +49,91 @@ namespace owl {
               lambda(vec3i(ix,iy,iz));
       }
 
+      /*! tile size that parallel_for uses if none is specified: wide
+          in x (which usually is the fastest-varying dimension in
+          memory), and large enough to amortize scheduling overhead */
+      inline vec3i defaultTileSize() { return vec3i(32,8,8); }
+
+      /*! calls lambda(tileBegin,tileEnd) for all tiles of the grid,
+          in the given order, on the calling thread */
       template<typename Lambda>
-      inline void parallel_for(const vec3i &dims, const Lambda &lambda)
+      inline void for_each_tile(const vec3i &dims,
+                                const vec3i &tileSize,
+                                const Lambda &lambda,
+                                TileOrder order = TILE_ORDER_MORTON)
+      {
+        const Tiling3D tiling(dims,tileSize,order);
+        for (size_t slot=0;slot<tiling.numSlots();slot++) {
+          vec3i begin, end;
+          if (tiling.getTileRange(slot,begin,end))
+            lambda(begin,end);
+        }
+      }
+
+      /*! calls lambda(tileBegin,tileEnd) for all tiles of the grid,
+          in parallel, with each tile being one task; tiles get handed
+          out in the given order, so for TILE_ORDER_MORTON
+          neighboring tasks work on neighboring tiles */
+      template<typename Lambda>
+      inline void parallel_for_blocked(const vec3i &dims,
+                                       const vec3i &tileSize,
+                                       const Lambda &lambda,
+                                       TileOrder order = TILE_ORDER_MORTON)
       {
+        const Tiling3D tiling(dims,tileSize,order);
         owl::common::parallel_for
-          (dims.x*(size_t)dims.y*dims.z,[&](size_t index){
-                                          lambda(vec3i(index%dims.x,
-                                                       (index/dims.x)%dims.y,
-                                                       index/((size_t)dims.x*dims.y)));
-                                        });
+          (tiling.numSlots(),[&](size_t slot){
+            vec3i begin, end;
+            if (tiling.getTileRange(slot,begin,end))
+              lambda(begin,end);
+          });
+      }
+
+      /*! calls lambda(vec3i) for all cells of the grid, in parallel
+          over tiles of the given size, and with plain nested loops
+          (no divisions) within each tile */
+      template<typename Lambda>
+      inline void parallel_for(const vec3i &dims,
+                               const vec3i &tileSize,
+                               const Lambda &lambda,
+                               TileOrder order = TILE_ORDER_MORTON)
+      {
+        array3D::parallel_for_blocked
+          (dims,tileSize,[&](const vec3i &begin, const vec3i &end){
+            array3D::for_each(begin,end,lambda);
+          },order);
       }
+
+      template<typename Lambda>
+      inline void parallel_for(const vec3i &dims, const Lambda &lambda)
+      {
+        array3D::parallel_for(dims,defaultTileSize(),lambda);
+      }
+
+      /*! reduces over all tiles of the grid: tileFunction(begin,end)
+          has to return the reduced value of one tile, and
+          combine(a,b) the combination of two values. Tiles get
+          reduced in parallel, but combined in linear tile order, so
+          the result is deterministic even for non-associative
+          operations (such as float sums) */
+      template<typename T, typename TileLambda, typename Combine>
+      inline T parallel_reduce(const vec3i &dims,
+                               const vec3i &tileSize,
+                               const T &identity,
+                               const TileLambda &tileFunction,
+                               const Combine &combine)
+      {
+        const Tiling3D tiling(dims,tileSize,TILE_ORDER_LINEAR);
+        return owl::common::parallel_reduce
+          (size_t(0),tiling.numSlots(),size_t(1),identity,
+           [&](size_t slot, size_t) -> T {
+            vec3i begin, end;
+            if (!tiling.getTileRange(slot,begin,end)) return identity;
+            return tileFunction(begin,end);
+          },
+           combine);
+      }
+
       template<typename Lambda>
       inline  void serial_for(const vec3i &dims, const Lambda &lambda)
       {
@@ -0,0 +1,137 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file tiling.h splits 2D and 3D grids into tiles, and enumerates
+    those in either linear or Morton order; this is what the tiled
+    iteration in array2D.h and array3D.h is built on */
+
+#include "owl/common/math/morton.h"
+
+namespace owl {
+  namespace common {
+
+    /*! order in which the tiles of a grid get enumerated (and thus,
+        handed out to threads) */
+    typedef enum {
+      /*! x fastest, then y, then z */
+      TILE_ORDER_LINEAR,
+      /*! along a Morton (aka Z-order) curve over the tiles, so tiles
+          that are processed close in time are also close in space */
+      TILE_ORDER_MORTON
+    } TileOrder;
+
+    /*! the tiles of a 3D grid. Tiles get enumerated through 'slots'
+        [0,numSlots()), some of which (for Morton order over grids
+        whose tile counts are not powers of two) may not map to a
+        tile */
+    struct Tiling3D {
+      inline Tiling3D(const vec3i &dims, const vec3i &tileSize,
+                      TileOrder order = TILE_ORDER_MORTON)
+        : dims(dims), tileSize(tileSize),
+          numTiles(divRoundUp(dims,tileSize)),
+          order(order),
+          morton(numTiles)
+      {}
+
+      inline size_t numSlots() const
+      {
+        if (dims.x <= 0 || dims.y <= 0 || dims.z <= 0) return 0;
+        return order == TILE_ORDER_MORTON
+          ? size_t(morton.numCodes())
+          : size_t(numTiles.x)*numTiles.y*numTiles.z;
+      }
+
+      /*! returns the tile (ie, its coordinates in tiles) of the given
+          slot, or false if that slot doesn't have one */
+      inline bool getTile(size_t slot, vec3i &tile) const
+      {
+        if (order == TILE_ORDER_MORTON) {
+          tile = morton.decode(slot);
+          return tile.x < numTiles.x && tile.y < numTiles.y && tile.z < numTiles.z;
+        }
+        const size_t tilesPerSlice = size_t(numTiles.x)*numTiles.y;
+        tile = vec3i(int(slot % numTiles.x),
+                     int((slot / numTiles.x) % numTiles.y),
+                     int(slot / tilesPerSlice));
+        return true;
+      }
+
+      /*! returns the [begin,end) range of grid cells of the given
+          slot's tile, or false if that slot doesn't have one */
+      inline bool getTileRange(size_t slot, vec3i &begin, vec3i &end) const
+      {
+        vec3i tile;
+        if (!getTile(slot,tile)) return false;
+        begin = tile*tileSize;
+        end   = min(begin+tileSize,dims);
+        return true;
+      }
+
+      const vec3i     dims;
+      const vec3i     tileSize;
+      const vec3i     numTiles;
+      const TileOrder order;
+      const MortonOrder3 morton;
+    };
+
+    /*! 2D version of Tiling3D */
+    struct Tiling2D {
+      inline Tiling2D(const vec2i &dims, const vec2i &tileSize,
+                      TileOrder order = TILE_ORDER_MORTON)
+        : dims(dims), tileSize(tileSize),
+          numTiles(divRoundUp(dims,tileSize)),
+          order(order),
+          morton(numTiles)
+      {}
+
+      inline size_t numSlots() const
+      {
+        if (dims.x <= 0 || dims.y <= 0) return 0;
+        return order == TILE_ORDER_MORTON
+          ? size_t(morton.numCodes())
+          : size_t(numTiles.x)*numTiles.y;
+      }
+
+      inline bool getTile(size_t slot, vec2i &tile) const
+      {
+        if (order == TILE_ORDER_MORTON) {
+          tile = morton.decode(slot);
+          return tile.x < numTiles.x && tile.y < numTiles.y;
+        }
+        tile = vec2i(int(slot % numTiles.x),int(slot / numTiles.x));
+        return true;
+      }
+
+      inline bool getTileRange(size_t slot, vec2i &begin, vec2i &end) const
+      {
+        vec2i tile;
+        if (!getTile(slot,tile)) return false;
+        begin = tile*tileSize;
+        end   = min(begin+tileSize,dims);
+        return true;
+      }
+
+      const vec2i     dims;
+      const vec2i     tileSize;
+      const vec2i     numTiles;
+      const TileOrder order;
+      const MortonOrder2 morton;
+    };
+
+  } // ::owl::common
+} // ::owl
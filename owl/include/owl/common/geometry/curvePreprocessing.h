@@ -0,0 +1,547 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file curvePreprocessing.h host-side clean-up of curves (hair,
+    fur, ...) before they go into a BVH build: converts between the
+    different control point conventions (linear, quadratic and cubic
+    b-splines, catmull-rom, and bezier), and adaptively splits
+    segments that turn too much, whose width changes too much, or
+    that are too long for their width - all of which make for large,
+    overlapping bounding boxes. Produces the segment index buffer
+    for the result, plus a remap table for per-segment data */
+
+#include "owl/common/math/boundsReduction.h"
+#include "owl/common/parallel/parallel_algorithms.h"
+#include <stdexcept>
+#include <string>
+
+namespace owl {
+  namespace common {
+
+    /*! the convention by which a segment's control points define
+        that segment. All but bezier advance by one control point
+        from one segment of a strand to the next; bezier segments
+        share only their end points */
+    typedef enum {
+      /*! 2 control points per segment (aka, optix/owl degree 1) */
+      CURVE_BASIS_LINEAR,
+      /*! 3 control points per segment (aka, optix/owl degree 2) */
+      CURVE_BASIS_QUADRATIC_BSPLINE,
+      /*! 4 control points per segment (aka, optix/owl degree 3) */
+      CURVE_BASIS_CUBIC_BSPLINE,
+      /*! 4 control points per segment, curve interpolates the middle
+          two */
+      CURVE_BASIS_CATMULL_ROM,
+      /*! 4 control points per segment, curve interpolates the first
+          and the last */
+      CURVE_BASIS_CUBIC_BEZIER
+    } CurveBasis;
+
+    /*! the b-spline basis owl uses for curves of given degree (1-3) */
+    inline CurveBasis curveBasisForDegree(int degree)
+    {
+      switch (degree) {
+      case 1: return CURVE_BASIS_LINEAR;
+      case 2: return CURVE_BASIS_QUADRATIC_BSPLINE;
+      case 3: return CURVE_BASIS_CUBIC_BSPLINE;
+      default:
+        throw std::runtime_error("#owl.common: invalid curve degree "
+                                 +std::to_string(degree));
+      }
+    }
+    
+    inline int curveBasisNumControlPoints(CurveBasis basis)
+    {
+      return basis == CURVE_BASIS_LINEAR ? 2
+        : basis == CURVE_BASIS_QUADRATIC_BSPLINE ? 3 : 4;
+    }
+
+    /*! by how many control points one segment of a strand is offset
+        from the previous one */
+    inline int curveBasisSegmentStride(CurveBasis basis)
+    {
+      return basis == CURVE_BASIS_CUBIC_BEZIER ? 3 : 1;
+    }
+    
+    struct CurvePreprocessConfig {
+      CurveBasis inputBasis  = CURVE_BASIS_CUBIC_BSPLINE;
+      /*! converting to a basis of lower degree approximates the
+          curve (which gets better the more it gets split); all
+          other conversions are exact */
+      CurveBasis outputBasis = CURVE_BASIS_CUBIC_BSPLINE;
+      
+      /*! split segments whose control polygon turns by more than
+          this many radians; 0 turns this off */
+      float maxTurnAngle = 0.5f;
+
+      /*! split segments whose widest control point is more than this
+          many times as wide as the narrowest one; 0 turns this off.
+          Widths of less than 1/16th of the (unsplit) segment's
+          widest one count as that, or tapered tips would get split
+          down to maxSplitDepth */
+      float maxWidthRatio = 2.f;
+
+      /*! split segments whose control polygon is longer than this
+          many times their largest width; 0 turns this off */
+      float maxLengthToWidth = 0.f;
+
+      /*! segments get split in halves, recursively, at most this
+          often; ie, into at most 2^maxSplitDepth pieces */
+      int maxSplitDepth = 4;
+    };
+
+    struct CurvePreprocessResult {
+      /*! one array of control points per motion key */
+      std::vector<std::vector<vec3f>> controlPoints;
+      /*! one array of widths per input array of widths */
+      std::vector<std::vector<float>> widths;
+      /*! index of each output segment's first control point */
+      std::vector<uint32_t> segmentIndices;
+      /*! for each output segment, the input segment it is (a piece
+          of); other per-segment data gets permuted the same way with
+          applyRemap(data,newToOldSegment) */
+      std::vector<uint32_t> newToOldSegment;
+    };
+
+    /*! the actual preprocessing; 'controlPointKeys' has one array of
+        control points per motion key (all of the same size), and
+        'widthKeys' either one array of widths per motion key, or a
+        single one for all of them. Segments get split the same way
+        in all keys - ie, as much as the key that needs it most.
+        Segments that don't get split, and are already in the output
+        basis, get passed through as they are, including the sharing
+        of control points between consecutive segments. Throws if any
+        segment index is out of range */
+    inline CurvePreprocessResult
+    preprocessCurves(const std::vector<StridedVec3fs> &controlPointKeys,
+                     const std::vector<StridedArray<float>> &widthKeys,
+                     const StridedArray<uint32_t> &segmentIndices,
+                     const CurvePreprocessConfig &config
+                     = CurvePreprocessConfig());
+
+    /*! builds the segment index buffer for strands of the given
+        numbers of control points (all stored one after another)
+        that use the given basis; strands that are too short for a
+        single segment don't get any */
+    inline std::vector<uint32_t> curveSegmentIndices(const uint32_t *strandSizes,
+                                                     size_t numStrands,
+                                                     CurveBasis basis);
+
+    /*! bounds of the convex hull of one segment's control points,
+        padded by its largest width - ie, what a BVH builder can do
+        without looking at the actual curve */
+    inline box3f curveSegmentBounds(const StridedVec3fs &controlPoints,
+                                    const StridedArray<float> &widths,
+                                    uint32_t segmentIndex,
+                                    CurveBasis basis)
+    {
+      box3f bounds;
+      float maxWidth = 0.f;
+      for (int i=0;i<curveBasisNumControlPoints(basis);i++) {
+        bounds.extend(controlPoints[segmentIndex+i]);
+        maxWidth = max(maxWidth,widths[segmentIndex+i]);
+      }
+      return box3f(bounds.lower-vec3f(maxWidth),bounds.upper+vec3f(maxWidth));
+    }
+    
+    // ------------------------------------------------------------------
+    // implementation section
+    // ------------------------------------------------------------------
+
+    namespace curvePreprocessing {
+      
+      enum { blockSize = 4*1024 };
+
+      /*! widths (relative to a segment's widest control point) below
+          which the width ratio doesn't care any more */
+      static const float widthRatioFloor = 1.f/16.f;
+
+      /*! position in xyz, width in w */
+      typedef vec4f ControlPoint;
+      
+      /*! converts one segment's control points (in given basis) to
+          the four control points of the same curve in bezier form */
+      inline void toBezier(CurveBasis basis, const ControlPoint *p, ControlPoint *b)
+      {
+        switch (basis) {
+        case CURVE_BASIS_LINEAR:
+          b[0] = p[0];
+          b[1] = (2.f*p[0]+p[1])*(1.f/3.f);
+          b[2] = (p[0]+2.f*p[1])*(1.f/3.f);
+          b[3] = p[1];
+          break;
+        case CURVE_BASIS_QUADRATIC_BSPLINE: {
+          // to quadratic bezier, then degree elevation
+          const ControlPoint q0 = .5f*(p[0]+p[1]);
+          const ControlPoint q2 = .5f*(p[1]+p[2]);
+          b[0] = q0;
+          b[1] = (q0+2.f*p[1])*(1.f/3.f);
+          b[2] = (2.f*p[1]+q2)*(1.f/3.f);
+          b[3] = q2;
+        } break;
+        case CURVE_BASIS_CUBIC_BSPLINE:
+          b[0] = (p[0]+4.f*p[1]+p[2])*(1.f/6.f);
+          b[1] = (2.f*p[1]+p[2])*(1.f/3.f);
+          b[2] = (p[1]+2.f*p[2])*(1.f/3.f);
+          b[3] = (p[1]+4.f*p[2]+p[3])*(1.f/6.f);
+          break;
+        case CURVE_BASIS_CATMULL_ROM:
+          b[0] = p[1];
+          b[1] = p[1]+(p[2]-p[0])*(1.f/6.f);
+          b[2] = p[2]-(p[3]-p[1])*(1.f/6.f);
+          b[3] = p[2];
+          break;
+        default:
+          for (int i=0;i<4;i++) b[i] = p[i];
+        }
+      }
+
+      /*! inverse of toBezier(); for linear and quadratic this is an
+          approximation, which is exact if the bezier curve actually
+          is of that degree */
+      inline void fromBezier(CurveBasis basis, const ControlPoint *b, ControlPoint *p)
+      {
+        switch (basis) {
+        case CURVE_BASIS_LINEAR:
+          p[0] = b[0];
+          p[1] = b[3];
+          break;
+        case CURVE_BASIS_QUADRATIC_BSPLINE: {
+          // the quadratic through b0 and b3 whose midpoint matches
+          const ControlPoint q1 = (3.f*(b[1]+b[2])-(b[0]+b[3]))*.25f;
+          p[0] = 2.f*b[0]-q1;
+          p[1] = q1;
+          p[2] = 2.f*b[3]-q1;
+        } break;
+        case CURVE_BASIS_CUBIC_BSPLINE:
+          p[1] = 2.f*b[1]-b[2];
+          p[2] = 2.f*b[2]-b[1];
+          p[0] = 6.f*b[0]-4.f*p[1]-p[2];
+          p[3] = 6.f*b[3]-p[1]-4.f*p[2];
+          break;
+        case CURVE_BASIS_CATMULL_ROM:
+          p[0] = b[3]-6.f*(b[1]-b[0]);
+          p[1] = b[0];
+          p[2] = b[3];
+          p[3] = b[0]+6.f*(b[3]-b[2]);
+          break;
+        default:
+          for (int i=0;i<4;i++) p[i] = b[i];
+        }
+      }
+
+      /*! de casteljau at t=.5 */
+      inline void splitBezier(const ControlPoint *b, ControlPoint *l, ControlPoint *r)
+      {
+        const ControlPoint b01 = .5f*(b[0]+b[1]);
+        const ControlPoint b12 = .5f*(b[1]+b[2]);
+        const ControlPoint b23 = .5f*(b[2]+b[3]);
+        const ControlPoint b012 = .5f*(b01+b12);
+        const ControlPoint b123 = .5f*(b12+b23);
+        const ControlPoint mid  = .5f*(b012+b123);
+        l[0] = b[0]; l[1] = b01;  l[2] = b012; l[3] = mid;
+        r[0] = mid;  r[1] = b123; r[2] = b23;  r[3] = b[3];
+      }
+
+      inline vec3f position(const ControlPoint &p) { return vec3f(p.x,p.y,p.z); }
+      
+      /*! whether a piece (of a segment whose widest control point is
+          'segmentWidth' wide) violates any of the config's limits */
+      inline bool needsSplit(const ControlPoint *b,
+                             float segmentWidth,
+                             const CurvePreprocessConfig &config)
+      {
+        float minWidth = b[0].w, maxWidth = b[0].w;
+        float length = 0.f, turn = 0.f;
+        vec3f prevLeg(0.f);
+        for (int i=1;i<4;i++) {
+          minWidth = min(minWidth,b[i].w);
+          maxWidth = max(maxWidth,b[i].w);
+          const vec3f leg = position(b[i])-position(b[i-1]);
+          length += owl::common::length(leg);
+          if (leg == vec3f(0.f)) continue;
+          if (prevLeg != vec3f(0.f))
+            turn += atan2f(owl::common::length(cross(prevLeg,leg)),dot(prevLeg,leg));
+          prevLeg = leg;
+        }
+        if (config.maxTurnAngle > 0.f && turn > config.maxTurnAngle)
+          return true;
+        if (config.maxWidthRatio > 0.f &&
+            maxWidth > config.maxWidthRatio*max(minWidth,widthRatioFloor*segmentWidth))
+          return true;
+        if (config.maxLengthToWidth > 0.f &&
+            length > config.maxLengthToWidth*maxWidth)
+          return true;
+        return false;
+      }
+
+      /*! splits one segment - given as one bezier per motion key -
+          as required by the config, and calls 'lambda' with each
+          resulting piece (again one bezier per key), in order. The
+          stack has to have room for (maxSplitDepth+2) pieces */
+      template<typename Lambda>
+      inline void forEachPiece(const ControlPoint *segment,
+                               size_t numKeys,
+                               const CurvePreprocessConfig &config,
+                               std::vector<ControlPoint> &stack,
+                               std::vector<int> &depthStack,
+                               const Lambda &lambda)
+      {
+        const size_t pieceSize = 4*numKeys;
+        float segmentWidth = 0.f;
+        for (size_t i=0;i<pieceSize;i++)
+          segmentWidth = max(segmentWidth,segment[i].w);
+        std::copy(segment,segment+pieceSize,stack.begin());
+        depthStack[0] = 0;
+        int top = 1;
+        while (top > 0) {
+          --top;
+          ControlPoint *piece = stack.data()+top*pieceSize;
+          const int depth = depthStack[top];
+          bool split = false;
+          if (depth < config.maxSplitDepth)
+            for (size_t k=0;k<numKeys && !split;k++)
+              split = needsSplit(piece+4*k,segmentWidth,config);
+          if (!split) { lambda(piece); continue; }
+          // left half goes on top, so it comes out first
+          ControlPoint *right = piece;
+          ControlPoint *left  = piece+pieceSize;
+          for (size_t k=0;k<numKeys;k++) {
+            ControlPoint l[4], r[4];
+            splitBezier(piece+4*k,l,r);
+            std::copy(l,l+4,left+4*k);
+            std::copy(r,r+4,right+4*k);
+          }
+          depthStack[top] = depthStack[top+1] = depth+1;
+          top += 2;
+        }
+      }
+
+    } // ::owl::common::curvePreprocessing
+
+    inline CurvePreprocessResult
+    preprocessCurves(const std::vector<StridedVec3fs> &controlPointKeys,
+                     const std::vector<StridedArray<float>> &widthKeys,
+                     const StridedArray<uint32_t> &segmentIndices,
+                     const CurvePreprocessConfig &config)
+    {
+      using namespace curvePreprocessing;
+      if (controlPointKeys.empty())
+        throw std::runtime_error("#owl.common: preprocessCurves() "
+                                 "needs at least one array of control points");
+      const size_t numKeys          = controlPointKeys.size();
+      const size_t numWidthKeys     = widthKeys.size();
+      const size_t numControlPoints = controlPointKeys[0].count;
+      const size_t numSegments      = segmentIndices.count;
+      for (auto &key : controlPointKeys)
+        if (key.count != numControlPoints)
+          throw std::runtime_error("#owl.common: preprocessCurves(): all motion "
+                                   "keys need the same number of control points");
+      if (numWidthKeys != 1 && numWidthKeys != numKeys)
+        throw std::runtime_error("#owl.common: preprocessCurves(): need either "
+                                 "one array of widths, or one per motion key");
+      for (auto &key : widthKeys)
+        if (key.count != numControlPoints)
+          throw std::runtime_error("#owl.common: preprocessCurves(): need one "
+                                   "width per control point");
+      if (config.maxSplitDepth < 0 || config.maxSplitDepth > 16)
+        throw std::runtime_error("#owl.common: preprocessCurves(): "
+                                 "maxSplitDepth has to be in [0,16]");
+
+      const CurveBasis inBasis  = config.inputBasis;
+      const CurveBasis outBasis = config.outputBasis;
+      const int numIn  = curveBasisNumControlPoints(inBasis);
+      const int numOut = curveBasisNumControlPoints(outBasis);
+      const size_t pieceSize = 4*numKeys;
+      
+      /*! the given segment, in bezier form, for all keys */
+      auto loadSegment = [&](size_t segID, ControlPoint *bezier) {
+        const uint32_t first = segmentIndices[segID];
+        for (size_t k=0;k<numKeys;k++) {
+          const StridedVec3fs &points = controlPointKeys[k];
+          const StridedArray<float> &widths = widthKeys[min(k,numWidthKeys-1)];
+          ControlPoint p[4];
+          for (int i=0;i<numIn;i++)
+            p[i] = ControlPoint(points[first+i],widths[first+i]);
+          toBezier(inBasis,p,bezier+4*k);
+        }
+      };
+      /*! per-thread scratch space for loadSegment() and forEachPiece() */
+      struct Scratch {
+        Scratch(size_t pieceSize, int maxDepth)
+          : segment(pieceSize),
+            stack((maxDepth+2)*pieceSize),
+            depth(maxDepth+2)
+        {}
+        std::vector<ControlPoint> segment, stack;
+        std::vector<int>          depth;
+      };
+      
+      // ------------------------------------------------------------------
+      // figure out how many pieces each segment gets split into...
+      // ------------------------------------------------------------------
+      std::vector<size_t>  numPieces(numSegments);
+      std::vector<uint8_t> outOfRange(numSegments);
+      parallel_for_blocked(0,numSegments,blockSize,[&](size_t begin, size_t end){
+          Scratch scratch(pieceSize,config.maxSplitDepth);
+          for (size_t i=begin;i<end;i++) {
+            if (size_t(segmentIndices[i])+numIn > numControlPoints) {
+              outOfRange[i] = 1;
+              continue;
+            }
+            loadSegment(i,scratch.segment.data());
+            size_t count = 0;
+            forEachPiece(scratch.segment.data(),numKeys,config,
+                         scratch.stack,scratch.depth,
+                         [&](const ControlPoint *){ count++; });
+            numPieces[i] = count;
+          }
+        });
+      for (size_t i=0;i<numSegments;i++)
+        if (outOfRange[i])
+          throw std::runtime_error("#owl.common: preprocessCurves(): segment "
+                                   +std::to_string(i)
+                                   +" has an out-of-range control point index");
+
+      // ------------------------------------------------------------------
+      // ... and how many control points each one needs. Unsplit
+      // segments that already are in the output basis get copied
+      // as they are, and share control points with the previous
+      // segment if that got copied, too
+      // ------------------------------------------------------------------
+      auto passThrough = [&](size_t segID) {
+        return inBasis == outBasis && numPieces[segID] == 1;
+      };
+      std::vector<size_t> numPoints(numSegments);
+      std::vector<int>    overlap(numSegments);
+      parallel_for_blocked(0,numSegments,blockSize,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) {
+            const size_t n = numPieces[i];
+            if (passThrough(i)) {
+              const int64_t step = i == 0 || !passThrough(i-1)
+                ? numIn
+                : int64_t(segmentIndices[i])-int64_t(segmentIndices[i-1]);
+              overlap[i]   = (step > 0 && step < numIn) ? int(numIn-step) : 0;
+              numPoints[i] = numIn-overlap[i];
+            } else if (outBasis == CURVE_BASIS_LINEAR)
+              // pieces share their end points
+              numPoints[i] = n+1;
+            else if (outBasis == CURVE_BASIS_CUBIC_BEZIER)
+              numPoints[i] = 3*n+1;
+            else
+              numPoints[i] = n*numOut;
+          }
+        });
+      std::vector<size_t> firstPoint(numSegments), firstPiece(numSegments);
+      const size_t numOutPoints
+        = parallel_exclusive_scan(numPoints.data(),firstPoint.data(),numSegments);
+      const size_t numOutSegments
+        = parallel_exclusive_scan(numPieces.data(),firstPiece.data(),numSegments);
+      if (numOutPoints >= size_t(uint32_t(-1)))
+        throw std::runtime_error("#owl.common: preprocessCurves(): too many "
+                                 "control points after splitting");
+
+      // ------------------------------------------------------------------
+      // write out everything
+      // ------------------------------------------------------------------
+      CurvePreprocessResult result;
+      result.controlPoints.resize(numKeys);
+      for (auto &key : result.controlPoints) key.resize(numOutPoints);
+      result.widths.resize(numWidthKeys);
+      for (auto &key : result.widths) key.resize(numOutPoints);
+      result.segmentIndices.resize(numOutSegments);
+      result.newToOldSegment.resize(numOutSegments);
+      parallel_for_blocked(0,numSegments,blockSize,[&](size_t begin, size_t end){
+          Scratch scratch(pieceSize,config.maxSplitDepth);
+          for (size_t i=begin;i<end;i++) {
+            const size_t outPoint = firstPoint[i];
+            const size_t outPiece = firstPiece[i];
+            if (passThrough(i)) {
+              const uint32_t first = segmentIndices[i];
+              for (size_t j=overlap[i];j<size_t(numIn);j++) {
+                const size_t out = outPoint+j-overlap[i];
+                for (size_t k=0;k<numKeys;k++)
+                  result.controlPoints[k][out] = controlPointKeys[k][first+j];
+                for (size_t k=0;k<numWidthKeys;k++)
+                  result.widths[k][out] = widthKeys[k][first+j];
+              }
+              result.segmentIndices[outPiece]  = uint32_t(outPoint-overlap[i]);
+              result.newToOldSegment[outPiece] = uint32_t(i);
+              continue;
+            }
+
+            const size_t n = numPieces[i];
+            auto write = [&](size_t out, size_t key, const ControlPoint &p) {
+              result.controlPoints[key][out] = position(p);
+              if (key < numWidthKeys)
+                result.widths[key][out] = max(p.w,0.f);
+            };
+            size_t pieceID = 0;
+            loadSegment(i,scratch.segment.data());
+            forEachPiece(scratch.segment.data(),numKeys,config,
+                         scratch.stack,scratch.depth,
+                         [&](const ControlPoint *piece) {
+                const bool last = (pieceID == n-1);
+                size_t out;
+                if (outBasis == CURVE_BASIS_LINEAR) {
+                  out = outPoint+pieceID;
+                  for (size_t k=0;k<numKeys;k++) {
+                    write(out,k,piece[4*k+0]);
+                    if (last) write(out+1,k,piece[4*k+3]);
+                  }
+                } else if (outBasis == CURVE_BASIS_CUBIC_BEZIER) {
+                  out = outPoint+3*pieceID;
+                  for (size_t k=0;k<numKeys;k++)
+                    for (int j=0;j<(last?4:3);j++)
+                      write(out+j,k,piece[4*k+j]);
+                } else {
+                  out = outPoint+numOut*pieceID;
+                  for (size_t k=0;k<numKeys;k++) {
+                    ControlPoint p[4];
+                    fromBezier(outBasis,piece+4*k,p);
+                    for (int j=0;j<numOut;j++)
+                      write(out+j,k,p[j]);
+                  }
+                }
+                result.segmentIndices[outPiece+pieceID]  = uint32_t(out);
+                result.newToOldSegment[outPiece+pieceID] = uint32_t(i);
+                pieceID++;
+              });
+          }
+        });
+      return result;
+    }
+
+    inline std::vector<uint32_t> curveSegmentIndices(const uint32_t *strandSizes,
+                                                     size_t numStrands,
+                                                     CurveBasis basis)
+    {
+      const uint32_t numCP  = curveBasisNumControlPoints(basis);
+      const uint32_t stride = curveBasisSegmentStride(basis);
+      std::vector<uint32_t> indices;
+      uint32_t first = 0;
+      for (size_t i=0;i<numStrands;i++) {
+        for (uint32_t seg=0;seg+numCP<=strandSizes[i];seg+=stride)
+          indices.push_back(first+seg);
+        first += strandSizes[i];
+      }
+      return indices;
+    }
+    
+  } // ::owl::common
+} // ::owl
@@ -0,0 +1,311 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file sphereClustering.h host-side levels of detail for large
+    sets of spheres (or points with a radius): spheres get sorted
+    into an octree (via their Morton codes), and every non-empty
+    octree cell of every level gets one sphere that encloses all the
+    spheres in that cell. Picking a level by the size of its cells -
+    eg, the world-space size of a pixel at the distance the spheres
+    get viewed from - or by a budget on the number of spheres then
+    gives a version of the input that can be much smaller to store
+    and to build a BVH over */
+
+#include "owl/common/math/boundsReduction.h"
+#include "owl/common/math/morton.h"
+#include "owl/common/parallel/parallel_algorithms.h"
+#include <stdexcept>
+#include <string>
+
+namespace owl {
+  namespace common {
+
+    struct SphereClusteringConfig {
+      /*! finest octree level to build; levels stop early if the next
+          one would have a cell for every sphere (and thus, be the
+          same as the input) */
+      int maxDepth = 12;
+    };
+
+    /*! one level of detail: one sphere per non-empty octree cell */
+    struct SphereLOD {
+      std::vector<vec3f> centers;
+      std::vector<float> radii;
+      
+      /*! sphere i stands for the input spheres
+          pointOrder[firstPoint[i]..firstPoint[i+1]) of the
+          hierarchy; ie, firstPoint has one more entry than there are
+          spheres. Other per-sphere data (eg, colors) can be averaged
+          over those */
+      std::vector<uint32_t> firstPoint;
+
+      /*! edge length of this level's octree cells */
+      float cellSize = 0.f;
+    };
+
+    struct SphereLODHierarchy {
+      /*! coarsest (a single sphere) first; each level's cells are
+          half the size of the previous level's. The input spheres
+          themselves are the (implicit) finest level of detail,
+          levels.size() */
+      std::vector<SphereLOD> levels;
+
+      /*! indices of the input spheres, in the (Morton) order in
+          which the levels' firstPoint ranges refer to them */
+      std::vector<uint32_t> pointOrder;
+
+      /*! the cube the octree is built over */
+      box3f rootCell;
+
+      /*! number of levels of detail, including the input */
+      inline int numLODs() const { return int(levels.size())+1; }
+      
+      /*! number of spheres in the given level of detail */
+      inline size_t numSpheres(int lod) const
+      {
+        return lod < int(levels.size())
+          ? levels[lod].centers.size()
+          : pointOrder.size();
+      }
+    };
+
+    /*! builds the hierarchy. 'radii' can have a stride of 0 if all
+        spheres have the same radius. Results don't depend on the
+        number of threads */
+    inline SphereLODHierarchy
+    buildSphereLODs(const StridedVec3fs &centers,
+                    const StridedArray<float> &radii,
+                    const SphereClusteringConfig &config
+                    = SphereClusteringConfig());
+
+    /*! returns the coarsest level of detail whose cells are no larger
+        than 'maxCellSize', but no finer than the finest one that has
+        at most 'maxSpheres' spheres; either limit can be 0 for "no
+        limit". Returns levels.size() for the input itself */
+    inline int selectSphereLOD(const SphereLODHierarchy &hierarchy,
+                               float maxCellSize,
+                               size_t maxSpheres)
+    {
+      const int numLevels = int(hierarchy.levels.size());
+      int lod = numLevels;
+      if (maxCellSize > 0.f)
+        for (int i=0;i<numLevels;i++)
+          if (hierarchy.levels[i].cellSize <= maxCellSize) { lod = i; break; }
+      if (maxSpheres > 0)
+        while (lod > 0 && hierarchy.numSpheres(lod) > maxSpheres)
+          --lod;
+      return lod;
+    }
+
+    /*! world-space size of 'pixels' pixels at the given distance from
+        a pinhole camera with given vertical field of view (in
+        radians) and image height - a good maxCellSize for
+        selectSphereLOD() */
+    inline float worldSizeOfPixels(float pixels, float distance,
+                                   float fovy, int imageHeight)
+    {
+      return pixels * 2.f*distance*tanf(.5f*fovy) / float(imageHeight);
+    }
+
+    /*! the spheres of the given level of detail; for the finest one
+        (ie, the input) that's the input spheres in Morton order */
+    inline void getSphereLOD(const SphereLODHierarchy &hierarchy,
+                             int lod,
+                             const StridedVec3fs &inputCenters,
+                             const StridedArray<float> &inputRadii,
+                             std::vector<vec3f> &centers,
+                             std::vector<float> &radii)
+    {
+      if (lod < 0 || lod > int(hierarchy.levels.size()))
+        throw std::runtime_error("#owl.common: getSphereLOD(): invalid "
+                                 "level of detail "+std::to_string(lod));
+      if (lod < int(hierarchy.levels.size())) {
+        centers = hierarchy.levels[lod].centers;
+        radii   = hierarchy.levels[lod].radii;
+        return;
+      }
+      const std::vector<uint32_t> &order = hierarchy.pointOrder;
+      centers.resize(order.size());
+      radii.resize(order.size());
+      parallel_for_blocked(0,order.size(),16*1024,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) {
+            centers[i] = inputCenters[order[i]];
+            radii[i]   = inputRadii[order[i]];
+          }
+        });
+    }
+    
+    // ------------------------------------------------------------------
+    // implementation section
+    // ------------------------------------------------------------------
+
+    namespace sphereClustering {
+      
+      enum { blockSize = 16*1024, maxMortonDepth = 21 };
+
+      /*! for n items with sorted keys, the index of the first item
+          with each distinct key (plus n, at the end) */
+      inline std::vector<uint32_t> findRuns(const std::vector<uint64_t> &keys)
+      {
+        const size_t n = keys.size();
+        std::vector<uint32_t> isFirst(n), runID(n);
+        parallel_for_blocked(0,n,blockSize,[&](size_t begin, size_t end){
+            for (size_t i=begin;i<end;i++)
+              isFirst[i] = (i == 0 || keys[i] != keys[i-1]);
+          });
+        const size_t numRuns
+          = parallel_exclusive_scan(isFirst.data(),runID.data(),n);
+        std::vector<uint32_t> first(numRuns+1);
+        first[numRuns] = uint32_t(n);
+        parallel_for_blocked(0,n,blockSize,[&](size_t begin, size_t end){
+            for (size_t i=begin;i<end;i++)
+              if (isFirst[i]) first[runID[i]] = uint32_t(i);
+          });
+        return first;
+      }
+      
+    } // ::owl::common::sphereClustering
+    
+    inline SphereLODHierarchy
+    buildSphereLODs(const StridedVec3fs &centers,
+                    const StridedArray<float> &radii,
+                    const SphereClusteringConfig &config)
+    {
+      using namespace sphereClustering;
+      const size_t numPoints = centers.count;
+      if (radii.count != numPoints)
+        throw std::runtime_error("#owl.common: buildSphereLODs(): need one "
+                                 "radius per sphere");
+      if (numPoints >= size_t(uint32_t(-1)))
+        throw std::runtime_error("#owl.common: buildSphereLODs(): too many "
+                                 "spheres");
+      if (config.maxDepth < 0 || config.maxDepth > maxMortonDepth)
+        throw std::runtime_error("#owl.common: buildSphereLODs(): maxDepth "
+                                 "has to be in [0,21]");
+      SphereLODHierarchy hierarchy;
+      if (numPoints == 0) return hierarchy;
+
+      // ------------------------------------------------------------------
+      // sort the spheres into a (cubical) octree...
+      // ------------------------------------------------------------------
+      const box3f bounds = computeBounds(centers);
+      const float rootSize = max(reduce_max(bounds.span()),1e-20f);
+      hierarchy.rootCell = box3f(bounds.lower,bounds.lower+vec3f(rootSize));
+      const float scale = float(1<<maxMortonDepth)/rootSize;
+      std::vector<uint64_t> codes(numPoints);
+      std::vector<uint32_t> &order = hierarchy.pointOrder;
+      order.resize(numPoints);
+      parallel_for_blocked(0,numPoints,blockSize,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) {
+            const vec3f c = (centers[i]-bounds.lower)*scale;
+            codes[i] = mortonEncode(clamp(vec3i(c),vec3i(0),
+                                          vec3i((1<<maxMortonDepth)-1)));
+            order[i] = uint32_t(i);
+          }
+        });
+      parallel_sort_by_key(codes.data(),order.data(),numPoints);
+
+      // ------------------------------------------------------------------
+      // ... then build the levels, from the finest one up. That's
+      // maxDepth, or the last one before the one in which every
+      // sphere has a cell of its own (which would be the same as the
+      // input)
+      // ------------------------------------------------------------------
+      std::vector<uint64_t> keys(numPoints);
+      std::vector<uint32_t> first;
+      int numLevels = 0;
+      for (int depth=0;depth<=config.maxDepth;depth++) {
+        const int shift = 3*(maxMortonDepth-depth);
+        parallel_for_blocked(0,numPoints,blockSize,[&](size_t begin, size_t end){
+            for (size_t i=begin;i<end;i++) keys[i] = codes[i] >> shift;
+          });
+        std::vector<uint32_t> runs = findRuns(keys);
+        if (runs.size()-1 == numPoints) break;
+        first = std::move(runs);
+        numLevels = depth+1;
+      }
+      const int finest = numLevels-1;
+      
+      hierarchy.levels.resize(numLevels);
+      for (int depth=finest;depth>=0;depth--) {
+        SphereLOD &level = hierarchy.levels[depth];
+        level.cellSize = rootSize/float(1<<depth);
+        // cells of this level in terms of the next finer one's (or
+        // in terms of the input spheres, for the finest one)
+        std::vector<uint32_t> children;
+        if (depth == finest) {
+          level.firstPoint = first;
+        } else {
+          const SphereLOD &finer = hierarchy.levels[depth+1];
+          const size_t numFiner = finer.centers.size();
+          std::vector<uint64_t> parentKeys(numFiner);
+          const int shift = 3*(maxMortonDepth-depth);
+          parallel_for_blocked(0,numFiner,blockSize,[&](size_t begin, size_t end){
+              for (size_t i=begin;i<end;i++)
+                parentKeys[i] = codes[finer.firstPoint[i]] >> shift;
+            });
+          children = findRuns(parentKeys);
+          level.firstPoint.resize(children.size());
+          for (size_t i=0;i<children.size();i++)
+            level.firstPoint[i] = finer.firstPoint[children[i]];
+        }
+        
+        const size_t numCells = level.firstPoint.size()-1;
+        level.centers.resize(numCells);
+        level.radii.resize(numCells);
+        parallel_for_blocked(0,numCells,blockSize/8,[&](size_t begin, size_t end){
+            for (size_t cell=begin;cell<end;cell++) {
+              // center is the average of all its spheres' centers,
+              // radius the smallest that encloses all of them
+              // (or all the finer level's spheres)
+              vec3d sum(0.);
+              float radius = 0.f;
+              if (depth == finest) {
+                const uint32_t pBegin = level.firstPoint[cell];
+                const uint32_t pEnd   = level.firstPoint[cell+1];
+                for (uint32_t p=pBegin;p<pEnd;p++)
+                  sum = sum + vec3d(centers[order[p]]);
+                const vec3f center = vec3f(sum * (1./(pEnd-pBegin)));
+                for (uint32_t p=pBegin;p<pEnd;p++)
+                  radius = max(radius,length(centers[order[p]]-center)
+                               + radii[order[p]]);
+                level.centers[cell] = center;
+              } else {
+                const SphereLOD &finer = hierarchy.levels[depth+1];
+                const uint32_t cBegin = children[cell];
+                const uint32_t cEnd   = children[cell+1];
+                for (uint32_t c=cBegin;c<cEnd;c++)
+                  sum = sum + vec3d(finer.centers[c])
+                    * double(finer.firstPoint[c+1]-finer.firstPoint[c]);
+                const uint32_t numInCell
+                  = level.firstPoint[cell+1]-level.firstPoint[cell];
+                const vec3f center = vec3f(sum * (1./numInCell));
+                for (uint32_t c=cBegin;c<cEnd;c++)
+                  radius = max(radius,length(finer.centers[c]-center)
+                               + finer.radii[c]);
+                level.centers[cell] = center;
+              }
+              level.radii[cell] = radius;
+            }
+          });
+      }
+      return hierarchy;
+    }
+    
+  } // ::owl::common
+} // ::owl
@@ -0,0 +1,428 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file triangleMeshPreprocessing.h host-side clean-up of triangle
+    meshes before they go into a BVH build: converting strips to
+    lists, welding (near-)duplicate vertices, removing degenerate
+    triangles, and re-ordering triangles and vertices such that
+    things that are close in space are also close in memory (which
+    makes for better BVHs and better vertex fetch locality in hit
+    programs). Returns remap tables, so any other per-vertex or
+    per-triangle data can be permuted the same way */
+
+#include "owl/common/math/boundsReduction.h"
+#include "owl/common/math/morton.h"
+#include "owl/common/parallel/parallel_algorithms.h"
+#include <stdexcept>
+#include <string>
+
+namespace owl {
+  namespace common {
+
+    struct TriangleMeshPreprocessConfig {
+      /*! vertices that are at most this far apart (in each
+          dimension, and in every motion key) get merged into one;
+          0 merges only exact duplicates, and a negative value turns
+          welding off. Only looks at positions, so vertices that
+          differ in other attributes (eg, along texture seams) get
+          merged, too */
+      float weldTolerance = 0.f;
+      
+      /*! drop triangles that (after welding) use the same vertex
+          more than once, or whose area is zero (up to float
+          precision) in every motion key */
+      bool removeDegenerates = true;
+      
+      /*! sort triangles along a Morton curve over their centroids,
+          and number vertices in the order they're first used by
+          those; otherwise, both keep their original order */
+      bool reorder = true;
+    };
+
+    struct TriangleMeshPreprocessResult {
+      /*! one array of vertices per motion key */
+      std::vector<std::vector<vec3f>> vertices;
+      std::vector<vec3i>              indices;
+
+      /*! for each output vertex, the input vertex it got taken from;
+          other per-vertex data gets permuted the same way with
+          applyRemap(data,newToOldVertex) */
+      std::vector<uint32_t> newToOldVertex;
+
+      /*! for each input vertex, the output vertex it got merged
+          into, or invalidIndex if it isn't used any more */
+      std::vector<uint32_t> oldToNewVertex;
+
+      /*! for each output triangle, the input triangle it got taken
+          from (see newToOldVertex) */
+      std::vector<uint32_t> newToOldTriangle;
+
+      static const uint32_t invalidIndex = uint32_t(-1);
+    };
+
+    /*! the actual preprocessing; 'vertexKeys' has one array of
+        vertices per motion key (all of the same size), all of which
+        get welded, cleaned up, and re-ordered the same way. Throws
+        if any index is out of range */
+    inline TriangleMeshPreprocessResult
+    preprocessTriangleMesh(const std::vector<StridedVec3fs> &vertexKeys,
+                           const StridedVec3is &indices,
+                           const TriangleMeshPreprocessConfig &config
+                           = TriangleMeshPreprocessConfig());
+
+    /*! converts a triangle strip (of 'count' indices, in which
+        'restartIndex' starts a new strip) to a list of triangles,
+        with every other triangle's winding flipped such that all of
+        them face the same way as the first one; triangles with a
+        repeated index (as used for stitching strips together) get
+        dropped */
+    inline std::vector<vec3i> triangleStripToList(const uint32_t *strip,
+                                                  size_t count,
+                                                  uint32_t restartIndex
+                                                  = uint32_t(-1));
+    
+    /*! result[i] = values[remap[i]] */
+    template<typename T>
+    inline std::vector<T> applyRemap(const T *values,
+                                     const std::vector<uint32_t> &remap)
+    {
+      std::vector<T> result(remap.size());
+      parallel_for_blocked(0,remap.size(),16*1024,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) result[i] = values[remap[i]];
+        });
+      return result;
+    }
+    
+    // ------------------------------------------------------------------
+    // implementation section
+    // ------------------------------------------------------------------
+
+    namespace meshPreprocessing {
+      
+      enum { blockSize = 16*1024 };
+      
+      /*! whether the given two vertices are within 'tolerance' of
+          each other in every key */
+      inline bool withinTolerance(const std::vector<StridedVec3fs> &keys,
+                                  uint32_t a, uint32_t b, float tolerance)
+      {
+        for (auto &key : keys) {
+          const vec3f d = abs(key[a]-key[b]);
+          if (d.x > tolerance || d.y > tolerance || d.z > tolerance)
+            return false;
+        }
+        return true;
+      }
+    
+      inline vec3l weldCell(const vec3f &v, float tolerance)
+      {
+        return vec3l(int64_t(floorf(v.x/tolerance)),
+                     int64_t(floorf(v.y/tolerance)),
+                     int64_t(floorf(v.z/tolerance)));
+      }
+      
+      inline uint64_t hashCell(const vec3l &cell)
+      {
+        uint64_t h = uint64_t(cell.x)*0x9E3779B97F4A7C15ull;
+        h ^= uint64_t(cell.y)*0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+        h ^= uint64_t(cell.z)*0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+        return h;
+      }
+
+      /*! for each vertex, the (lowest-numbered) vertex it gets
+          merged into - which is always <= the vertex itself. Welding
+          is not transitive (a may be close to b, and b to c, but a
+          not to c); each vertex first finds the lowest-numbered
+          vertex that is close to it, and then follows that one's
+          chain, so in that case all three end up as a */
+      inline std::vector<uint32_t> weld(const std::vector<StridedVec3fs> &keys,
+                                        float tolerance)
+      {
+        const size_t numVertices = keys[0].count;
+        std::vector<uint32_t> rep(numVertices);
+        if (tolerance < 0.f) {
+          parallel_for_blocked(0,numVertices,blockSize,[&](size_t begin, size_t end){
+              for (size_t i=begin;i<end;i++) rep[i] = uint32_t(i);
+            });
+          return rep;
+        }
+
+        std::vector<uint32_t> order(numVertices);
+        parallel_for_blocked(0,numVertices,blockSize,[&](size_t begin, size_t end){
+            for (size_t i=begin;i<end;i++) order[i] = uint32_t(i);
+          });
+        
+        if (tolerance == 0.f) {
+          // exact duplicates: sort by position (in all keys), then by
+          // ID, so each run of equal vertices starts with the lowest ID
+          auto less = [&](uint32_t a, uint32_t b) {
+            for (auto &key : keys) {
+              const vec3f &va = key[a], &vb = key[b];
+              if (va.x != vb.x) return va.x < vb.x;
+              if (va.y != vb.y) return va.y < vb.y;
+              if (va.z != vb.z) return va.z < vb.z;
+            }
+            return a < b;
+          };
+          parallel_sort(order.data(),numVertices,less);
+          for (size_t i=0;i<numVertices;i++)
+            rep[order[i]]
+              = (i > 0 && withinTolerance(keys,order[i-1],order[i],0.f))
+              ? rep[order[i-1]]
+              : order[i];
+          return rep;
+        }
+
+        // grid of cells twice as large as the tolerance, so all
+        // vertices that can be close to a given one are in its cell,
+        // or in one of the 7 neighbors on the side of the cell's
+        // center that it's on. Vertices get sorted by their cells'
+        // hashes (and, the sort being stable, then by ID), and a hash
+        // table maps each cell's hash to its first vertex in there
+        const float cellSize = 2.f*tolerance;
+        std::vector<uint64_t> hashes(numVertices);
+        parallel_for_blocked(0,numVertices,blockSize,[&](size_t begin, size_t end){
+            for (size_t i=begin;i<end;i++)
+              hashes[i] = hashCell(weldCell(keys[0][i],cellSize));
+          });
+        parallel_sort_by_key(hashes.data(),order.data(),numVertices);
+
+        size_t tableSize = 1;
+        while (tableSize < 2*numVertices) tableSize *= 2;
+        const size_t noEntry = size_t(-1);
+        std::vector<size_t> table(tableSize,noEntry);
+        for (size_t i=0;i<numVertices;i++) {
+          if (i > 0 && hashes[i] == hashes[i-1]) continue;
+          size_t slot = size_t(hashes[i]) & (tableSize-1);
+          while (table[slot] != noEntry) slot = (slot+1) & (tableSize-1);
+          table[slot] = i;
+        }
+        auto firstInCell = [&](uint64_t hash) {
+          for (size_t slot = size_t(hash) & (tableSize-1);
+               table[slot] != noEntry;
+               slot = (slot+1) & (tableSize-1))
+            if (hashes[table[slot]] == hash) return table[slot];
+          return noEntry;
+        };
+        
+        std::vector<uint32_t> closest(numVertices);
+        parallel_for_blocked(0,numVertices,blockSize,[&](size_t begin, size_t end){
+            for (size_t i=begin;i<end;i++) {
+              const vec3f v = keys[0][i]/cellSize;
+              const vec3l cell = weldCell(keys[0][i],cellSize);
+              const vec3l side(v.x-floorf(v.x) < .5f ? -1 : +1,
+                               v.y-floorf(v.y) < .5f ? -1 : +1,
+                               v.z-floorf(v.z) < .5f ? -1 : +1);
+              uint32_t best = uint32_t(i);
+              for (int n=0;n<8;n++) {
+                const uint64_t hash
+                  = hashCell(cell+vec3l((n&1)?side.x:0,(n&2)?side.y:0,(n&4)?side.z:0));
+                const size_t first = firstInCell(hash);
+                if (first == noEntry) continue;
+                // IDs within a cell are sorted, so we can stop at the
+                // first one that is not lower than the best so far
+                for (size_t j=first;
+                     j<numVertices && hashes[j] == hash && order[j] < best;
+                     j++)
+                  if (withinTolerance(keys,order[j],uint32_t(i),tolerance))
+                    best = order[j];
+              }
+              closest[i] = best;
+            }
+          });
+        // follow the chains; closest[i] <= i, so that one's done already
+        for (size_t i=0;i<numVertices;i++)
+          rep[i] = closest[i] == i ? uint32_t(i) : rep[closest[i]];
+        return rep;
+      }
+
+      /*! whether the triangle has no area (up to float precision,
+          relative to its size) in any of the keys */
+      inline bool zeroArea(const std::vector<StridedVec3fs> &keys, const vec3i &t)
+      {
+        for (auto &key : keys) {
+          const vec3f e0 = key[t.y]-key[t.x];
+          const vec3f e1 = key[t.z]-key[t.x];
+          const vec3f e2 = key[t.z]-key[t.y];
+          const float longest = max(dot(e0,e0),max(dot(e1,e1),dot(e2,e2)));
+          if (length(cross(e0,e1)) > 1e-6f*longest)
+            return false;
+        }
+        return true;
+      }
+    } // ::owl::common::meshPreprocessing
+    
+    inline TriangleMeshPreprocessResult
+    preprocessTriangleMesh(const std::vector<StridedVec3fs> &vertexKeys,
+                           const StridedVec3is &indices,
+                           const TriangleMeshPreprocessConfig &config)
+    {
+      using namespace meshPreprocessing;
+      const uint32_t invalid = TriangleMeshPreprocessResult::invalidIndex;
+      if (vertexKeys.empty())
+        throw std::runtime_error("#owl.common: preprocessTriangleMesh() "
+                                 "needs at least one array of vertices");
+      const size_t numVertices  = vertexKeys[0].count;
+      const size_t numTriangles = indices.count;
+      for (auto &key : vertexKeys)
+        if (key.count != numVertices)
+          throw std::runtime_error("#owl.common: preprocessTriangleMesh(): "
+                                   "all motion keys need the same number of "
+                                   "vertices");
+      if (numVertices >= size_t(invalid))
+        throw std::runtime_error("#owl.common: preprocessTriangleMesh(): "
+                                 "too many vertices");
+      
+      // ------------------------------------------------------------------
+      // weld, and re-index the triangles accordingly
+      // ------------------------------------------------------------------
+      const std::vector<uint32_t> rep = weld(vertexKeys,config.weldTolerance);
+      std::vector<vec3i>   welded(numTriangles);
+      std::vector<uint32_t> keep(numTriangles);
+      std::vector<uint8_t> outOfRange(numTriangles);
+      parallel_for_blocked(0,numTriangles,blockSize,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) {
+            const vec3i t = indices[i];
+            if (uint32_t(t.x) >= numVertices ||
+                uint32_t(t.y) >= numVertices ||
+                uint32_t(t.z) >= numVertices) {
+              outOfRange[i] = 1;
+              continue;
+            }
+            const vec3i w(rep[t.x],rep[t.y],rep[t.z]);
+            welded[i] = w;
+            keep[i] = !config.removeDegenerates
+              || !(w.x == w.y || w.y == w.z || w.x == w.z || zeroArea(vertexKeys,w));
+          }
+        });
+      for (size_t i=0;i<numTriangles;i++)
+        if (outOfRange[i])
+          throw std::runtime_error("#owl.common: preprocessTriangleMesh(): "
+                                   "triangle "+std::to_string(i)
+                                   +" has an out-of-range vertex index");
+
+      // ------------------------------------------------------------------
+      // compact the remaining triangles, and re-order them
+      // ------------------------------------------------------------------
+      TriangleMeshPreprocessResult result;
+      std::vector<uint32_t> slot(numTriangles);
+      const size_t numKept
+        = parallel_exclusive_scan(keep.data(),slot.data(),numTriangles);
+      std::vector<uint32_t> &kept = result.newToOldTriangle;
+      kept.resize(numKept);
+      parallel_for_blocked(0,numTriangles,blockSize,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++)
+            if (keep[i]) kept[slot[i]] = uint32_t(i);
+        });
+      
+      if (config.reorder && numKept > 1) {
+        const StridedVec3fs &v = vertexKeys[0];
+        std::vector<box3f> centroids(numKept);
+        box3f centroidBounds;
+        parallel_for_blocked(0,numKept,blockSize,[&](size_t begin, size_t end){
+            for (size_t i=begin;i<end;i++) {
+              const vec3i t = welded[kept[i]];
+              centroids[i] = box3f(v[t.x]).including(v[t.y]).including(v[t.z]);
+            }
+          });
+        centroidBounds = computeCentroidBounds(centroids.data(),numKept);
+        // same scale in all dimensions, or flat meshes would get
+        // ordered mostly by their (tiny) extent along the flat one
+        const float scale
+          = float((1<<21)-1)/max(reduce_max(centroidBounds.span()),1e-20f);
+        std::vector<uint64_t> codes(numKept);
+        parallel_for_blocked(0,numKept,blockSize,[&](size_t begin, size_t end){
+            for (size_t i=begin;i<end;i++) {
+              const vec3f c = (centroids[i].center()-centroidBounds.lower)*scale;
+              codes[i] = mortonEncode(clamp(vec3i(c),vec3i(0),vec3i((1<<21)-1)));
+            }
+          });
+        parallel_sort_by_key(codes.data(),kept.data(),numKept);
+      }
+
+      // ------------------------------------------------------------------
+      // number the vertices that are still in use
+      // ------------------------------------------------------------------
+      std::vector<uint32_t> newID(numVertices,invalid);
+      uint32_t numUsed = 0;
+      if (config.reorder) {
+        for (auto t : kept)
+          for (int c=0;c<3;c++) {
+            const int v = welded[t][c];
+            if (newID[v] == invalid) newID[v] = numUsed++;
+          }
+      } else {
+        for (auto t : kept)
+          for (int c=0;c<3;c++)
+            newID[welded[t][c]] = 0;
+        for (size_t i=0;i<numVertices;i++)
+          if (newID[i] != invalid) newID[i] = numUsed++;
+      }
+
+      // ------------------------------------------------------------------
+      // and write out everything
+      // ------------------------------------------------------------------
+      result.newToOldVertex.resize(numUsed);
+      result.oldToNewVertex.resize(numVertices);
+      parallel_for_blocked(0,numVertices,blockSize,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) {
+            if (newID[i] != invalid) result.newToOldVertex[newID[i]] = uint32_t(i);
+            result.oldToNewVertex[i] = newID[rep[i]];
+          }
+        });
+      result.vertices.resize(vertexKeys.size());
+      for (size_t k=0;k<vertexKeys.size();k++) {
+        const StridedVec3fs &key = vertexKeys[k];
+        std::vector<vec3f> &out = result.vertices[k];
+        out.resize(numUsed);
+        parallel_for_blocked(0,numUsed,blockSize,[&](size_t begin, size_t end){
+            for (size_t i=begin;i<end;i++) out[i] = key[result.newToOldVertex[i]];
+          });
+      }
+      result.indices.resize(numKept);
+      parallel_for_blocked(0,numKept,blockSize,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) {
+            const vec3i t = welded[kept[i]];
+            result.indices[i] = vec3i(newID[t.x],newID[t.y],newID[t.z]);
+          }
+        });
+      return result;
+    }
+
+    inline std::vector<vec3i> triangleStripToList(const uint32_t *strip,
+                                                  size_t count,
+                                                  uint32_t restartIndex)
+    {
+      std::vector<vec3i> triangles;
+      // the last two indices, and how many we've had in this strip
+      uint32_t a = 0, b = 0;
+      size_t numInStrip = 0;
+      for (size_t i=0;i<count;i++) {
+        const uint32_t c = strip[i];
+        if (c == restartIndex) { numInStrip = 0; continue; }
+        if (numInStrip >= 2 && a != b && b != c && a != c)
+          triangles.push_back((numInStrip & 1) ? vec3i(b,a,c) : vec3i(a,b,c));
+        a = b;
+        b = c;
+        numInStrip++;
+      }
+      return triangles;
+    }
+    
+  } // ::owl::common
+} // ::owl
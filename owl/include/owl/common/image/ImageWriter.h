@@ -0,0 +1,471 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file ImageWriter.h writing RGBA8 or float RGBA frame buffers to
+    PNG, PPM, or PFM files - either right away (writeImage()), or in
+    the background (ImageWriter).
+
+    PNG encoding is stb_image_write's, so this needs stb's include
+    path (ie, the 'stb_image' target), and exactly one translation
+    unit has to define STB_IMAGE_WRITE_IMPLEMENTATION before including
+    this file (or stb_image_write.h itself). */
+
+#include "owl/common/math/vec.h"
+#include "owl/common/math/packet/floatx.h"
+#include "stb/stb_image_write.h"
+#include <cctype>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace owl {
+  namespace common {
+
+    typedef enum {
+      /*! one uint32_t per pixel, red in the lowest byte (ie, what
+          make_rgba() produces) */
+      IMAGE_RGBA8,
+      /*! one vec4f per pixel */
+      IMAGE_RGBA32F
+    } ImagePixelFormat;
+
+    typedef enum {
+      /*! pick the format from the file name's extension */
+      IMAGE_FILE_FORMAT_AUTO,
+      IMAGE_FILE_FORMAT_PNG,
+      /*! binary 8-bit RGB portable pixmap ('P6') */
+      IMAGE_FILE_FORMAT_PPM,
+      /*! 32-bit float RGB portable float map ('PF') */
+      IMAGE_FILE_FORMAT_PFM
+    } ImageFileFormat;
+
+    // =======================================================
+    // RGBA8 <-> float conversion
+    // =======================================================
+
+    namespace detail {
+      /*! the same mapping as make_8bit() in owl_device.h, except that
+          out-of-range values (and NaNs) are well defined: anything
+          below 0 (or NaN) maps to 0, anything at or above 255/256 to
+          255 */
+      inline uint32_t floatTo8bit(float f)
+      {
+        float v = f*256.f;
+        if (!(v > 0.f)) v = 0.f;
+        if (v > 255.f)  v = 255.f;
+        return uint32_t(v);
+      }
+
+      inline void convertRGBA8ToFloat_scalar(const uint32_t *in, vec4f *out, size_t count)
+      {
+        const float scale = 1.f/255.f;
+        for (size_t i=0;i<count;i++)
+          out[i] = vec4f(float((in[i] >>  0) & 0xff)*scale,
+                         float((in[i] >>  8) & 0xff)*scale,
+                         float((in[i] >> 16) & 0xff)*scale,
+                         float((in[i] >> 24) & 0xff)*scale);
+      }
+
+      inline void convertFloatToRGBA8_scalar(const vec4f *in, uint32_t *out, size_t count)
+      {
+        for (size_t i=0;i<count;i++)
+          out[i] =
+            (floatTo8bit(in[i].x) <<  0) |
+            (floatTo8bit(in[i].y) <<  8) |
+            (floatTo8bit(in[i].z) << 16) |
+            (floatTo8bit(in[i].w) << 24);
+      }
+    } // ::owl::common::detail
+
+    /*! converts 'count' RGBA8 pixels to floats in [0,1]; four pixels
+        at a time with SSE where available */
+    inline void convertRGBA8ToFloat(const uint32_t *in, vec4f *out, size_t count)
+    {
+      size_t i = 0;
+#if OWL_HAVE_SSE
+      const __m128  scale = _mm_set1_ps(1.f/255.f);
+      const __m128i zero  = _mm_setzero_si128();
+      float *outFloats = (float *)out;
+      for (;i+4<=count;i+=4) {
+        const __m128i bytes = _mm_loadu_si128((const __m128i *)(in+i));
+        const __m128i lo16  = _mm_unpacklo_epi8(bytes,zero);
+        const __m128i hi16  = _mm_unpackhi_epi8(bytes,zero);
+        _mm_storeu_ps(outFloats+4*i+ 0,_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo16,zero)),scale));
+        _mm_storeu_ps(outFloats+4*i+ 4,_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo16,zero)),scale));
+        _mm_storeu_ps(outFloats+4*i+ 8,_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi16,zero)),scale));
+        _mm_storeu_ps(outFloats+4*i+12,_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi16,zero)),scale));
+      }
+#endif
+      detail::convertRGBA8ToFloat_scalar(in+i,out+i,count-i);
+    }
+
+    /*! converts 'count' float RGBA pixels to RGBA8 (see
+        detail::floatTo8bit() for the exact mapping); four pixels at a
+        time with SSE where available */
+    inline void convertFloatToRGBA8(const vec4f *in, uint32_t *out, size_t count)
+    {
+      size_t i = 0;
+#if OWL_HAVE_SSE
+      const __m128 scale   = _mm_set1_ps(256.f);
+      const __m128 lower   = _mm_setzero_ps();
+      const __m128 upper   = _mm_set1_ps(255.f);
+      const float *inFloats = (const float *)in;
+      for (;i+4<=count;i+=4) {
+        __m128i px[4];
+        for (int j=0;j<4;j++) {
+          const __m128 v = _mm_mul_ps(_mm_loadu_ps(inFloats+4*(i+j)),scale);
+          // max() returns its second operand if either one is a NaN
+          px[j] = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(v,lower),upper));
+        }
+        const __m128i lo = _mm_packs_epi32(px[0],px[1]);
+        const __m128i hi = _mm_packs_epi32(px[2],px[3]);
+        _mm_storeu_si128((__m128i *)(out+i),_mm_packus_epi16(lo,hi));
+      }
+#endif
+      detail::convertFloatToRGBA8_scalar(in+i,out+i,count-i);
+    }
+
+    // =======================================================
+    // ImageView
+    // =======================================================
+
+    /*! a (non-owning, unless 'owner' is set) view of the pixels of an
+        image; rows are addressed top row first, so frame buffers that
+        store the bottom row first (eg, anything that goes through GL)
+        use a negative stride rather than a flipped copy */
+    struct ImageView {
+      inline size_t bytesPerPixel() const
+      { return format == IMAGE_RGBA8 ? sizeof(uint32_t) : sizeof(vec4f); }
+
+      /*! start of the y'th row, counting from the top */
+      inline const void *row(int y) const
+      { return (const uint8_t *)pixels + y*stride; }
+
+      /*! a view of a contiguous, tightly packed RGBA8 frame buffer */
+      static inline ImageView rgba8(const uint32_t *pixels, const vec2i &size,
+                                    bool bottomRowFirst = false)
+      { return make(pixels,size,IMAGE_RGBA8,bottomRowFirst); }
+
+      /*! a view of a contiguous, tightly packed float RGBA frame buffer */
+      static inline ImageView rgba32f(const vec4f *pixels, const vec2i &size,
+                                      bool bottomRowFirst = false)
+      { return make(pixels,size,IMAGE_RGBA32F,bottomRowFirst); }
+
+      /*! a tightly packed, top-row-first copy of this image, in the
+          given pixel format, that owns its pixels. This is the one
+          place where the pixels of an image ever get copied (if the
+          formats differ, converting them while at it) */
+      inline ImageView copy(ImagePixelFormat newFormat) const
+      {
+        ImageView result;
+        result.size   = size;
+        result.format = newFormat;
+        result.stride = ptrdiff_t(result.bytesPerPixel())*size.x;
+        std::shared_ptr<std::vector<uint8_t>> storage
+          = std::make_shared<std::vector<uint8_t>>(result.stride*size_t(size.y));
+        for (int y=0;y<size.y;y++) {
+          uint8_t *out = storage->data()+y*result.stride;
+          if (format == newFormat)
+            memcpy(out,row(y),result.stride);
+          else if (format == IMAGE_RGBA8)
+            convertRGBA8ToFloat((const uint32_t *)row(y),(vec4f *)out,size.x);
+          else
+            convertFloatToRGBA8((const vec4f *)row(y),(uint32_t *)out,size.x);
+        }
+        result.pixels = storage->data();
+        result.owner  = storage;
+        return result;
+      }
+
+      inline ImageView copy() const { return copy(format); }
+
+      const void      *pixels { nullptr };
+      vec2i            size   { 0 };
+      ImagePixelFormat format { IMAGE_RGBA8 };
+      /*! distance in bytes from one row to the next one below it */
+      ptrdiff_t        stride { 0 };
+      /*! if set, keeps 'pixels' alive for as long as this view (or
+          any copy of it) exists; ImageWriter relies on that to avoid
+          copying the image */
+      std::shared_ptr<const void> owner;
+
+    private:
+      static inline ImageView make(const void *pixels, const vec2i &size,
+                                   ImagePixelFormat format, bool bottomRowFirst)
+      {
+        ImageView view;
+        view.size   = size;
+        view.format = format;
+        view.stride = ptrdiff_t(view.bytesPerPixel())*size.x;
+        view.pixels = pixels;
+        if (bottomRowFirst && size.y > 0) {
+          view.pixels = (const uint8_t *)pixels + (size.y-1)*view.stride;
+          view.stride = -view.stride;
+        }
+        return view;
+      }
+    };
+
+    // =======================================================
+    // writing images
+    // =======================================================
+
+    /*! the format implied by a file name's extension (case
+        insensitive); throws if it doesn't name one we can write */
+    inline ImageFileFormat imageFileFormatFor(const std::string &fileName)
+    {
+      const size_t dot = fileName.rfind('.');
+      std::string ext = dot == std::string::npos ? "" : fileName.substr(dot+1);
+      for (auto &c : ext) c = (char)tolower(c);
+      if (ext == "png") return IMAGE_FILE_FORMAT_PNG;
+      if (ext == "ppm") return IMAGE_FILE_FORMAT_PPM;
+      if (ext == "pfm") return IMAGE_FILE_FORMAT_PFM;
+      throw std::runtime_error("#owl.common: don't know how to write image '"
+                               +fileName+"' (supported: .png, .ppm, .pfm)");
+    }
+
+    /*! the pixel format a file format gets written from without any
+        conversion */
+    inline ImagePixelFormat nativePixelFormatOf(ImageFileFormat format)
+    {
+      return format == IMAGE_FILE_FORMAT_PFM ? IMAGE_RGBA32F : IMAGE_RGBA8;
+    }
+
+    namespace detail {
+      inline void writePNG(const std::string &fileName, const ImageView &image)
+      {
+        ImageView rgba8 = image;
+        if (image.format != IMAGE_RGBA8)
+          rgba8 = image.copy(IMAGE_RGBA8);
+        // stb's png writer is fine with negative strides, so
+        // bottom-row-first images don't need flipping
+        if (!stbi_write_png(fileName.c_str(),image.size.x,image.size.y,4,
+                            rgba8.pixels,int(rgba8.stride)))
+          throw std::runtime_error("#owl.common: could not write '"+fileName+"'");
+      }
+
+      inline void writePPM(std::ofstream &out, const ImageView &image)
+      {
+        out << "P6\n" << image.size.x << " " << image.size.y << "\n255\n";
+        std::vector<uint32_t> converted(image.format == IMAGE_RGBA8 ? 0 : image.size.x);
+        std::vector<uint8_t>  rgb(3*size_t(image.size.x));
+        for (int y=0;y<image.size.y;y++) {
+          const uint32_t *in = (const uint32_t *)image.row(y);
+          if (image.format != IMAGE_RGBA8) {
+            convertFloatToRGBA8((const vec4f *)image.row(y),converted.data(),image.size.x);
+            in = converted.data();
+          }
+          for (int x=0;x<image.size.x;x++) {
+            rgb[3*x+0] = uint8_t(in[x] >>  0);
+            rgb[3*x+1] = uint8_t(in[x] >>  8);
+            rgb[3*x+2] = uint8_t(in[x] >> 16);
+          }
+          out.write((const char *)rgb.data(),rgb.size());
+        }
+      }
+
+      /*! PFMs store the *bottom* row first, and a negative scale means
+          little endian (which is all we run on) */
+      inline void writePFM(std::ofstream &out, const ImageView &image)
+      {
+        out << "PF\n" << image.size.x << " " << image.size.y << "\n-1.0\n";
+        std::vector<vec4f> converted(image.format == IMAGE_RGBA32F ? 0 : image.size.x);
+        std::vector<float> rgb(3*size_t(image.size.x));
+        for (int y=image.size.y-1;y>=0;--y) {
+          const vec4f *in = (const vec4f *)image.row(y);
+          if (image.format != IMAGE_RGBA32F) {
+            convertRGBA8ToFloat((const uint32_t *)image.row(y),converted.data(),image.size.x);
+            in = converted.data();
+          }
+          for (int x=0;x<image.size.x;x++) {
+            rgb[3*x+0] = in[x].x;
+            rgb[3*x+1] = in[x].y;
+            rgb[3*x+2] = in[x].z;
+          }
+          out.write((const char *)rgb.data(),rgb.size()*sizeof(float));
+        }
+      }
+    } // ::owl::common::detail
+
+    /*! writes the given image right away; throws if that fails. PPM
+        and PFM files get converted one row at a time, so the only
+        full-image copy this ever makes is to write a float image as
+        PNG */
+    inline void writeImage(const std::string &fileName,
+                           const ImageView &image,
+                           ImageFileFormat format = IMAGE_FILE_FORMAT_AUTO)
+    {
+      if (format == IMAGE_FILE_FORMAT_AUTO)
+        format = imageFileFormatFor(fileName);
+      if (format == IMAGE_FILE_FORMAT_PNG)
+        return detail::writePNG(fileName,image);
+
+      std::ofstream out(fileName,std::ios::binary);
+      if (!out.good())
+        throw std::runtime_error("#owl.common: could not open '"+fileName+"' for writing");
+      if (format == IMAGE_FILE_FORMAT_PPM)
+        detail::writePPM(out,image);
+      else
+        detail::writePFM(out,image);
+      out.flush();
+      if (!out.good())
+        throw std::runtime_error("#owl.common: could not write '"+fileName+"'");
+    }
+
+    // =======================================================
+    // ImageWriter
+    // =======================================================
+
+    /*! writes images in the background, on its own worker threads
+        (writing files is mostly compression and I/O, which we don't
+        want to occupy the threads of parallel_for with).
+
+        write() only ever copies an image if the view it gets doesn't
+        have an 'owner' to keep its pixels alive - and if it has to
+        copy, converts to whatever the file format needs while at
+        it. Once 'maxQueuedJobs' images are waiting for a worker,
+        write() blocks until one gets picked up, so a renderer that
+        produces frames faster than they can be written gets slowed
+        down rather than running out of memory.
+
+        The first error that happens in the background gets thrown by
+        the next flush() */
+    class ImageWriter {
+    public:
+      ImageWriter(int numThreads = 2, int maxQueuedJobs = 8)
+        : maxQueuedJobs(std::max(1,maxQueuedJobs))
+      {
+        for (int i=0;i<std::max(1,numThreads);i++)
+          workers.push_back(std::thread([this](){ workerLoop(); }));
+      }
+
+      /*! waits for all pending images to be written; errors get
+          dropped (call flush() first to see those) */
+      ~ImageWriter()
+      {
+        try { flush(); } catch (...) {}
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          quit = true;
+        }
+        jobAvailable.notify_all();
+        for (auto &worker : workers) worker.join();
+      }
+
+      ImageWriter(const ImageWriter &) = delete;
+      ImageWriter &operator=(const ImageWriter &) = delete;
+
+      /*! schedules writing the given image; see class comment for
+          when this blocks, and when it copies */
+      void write(const std::string &fileName,
+                 const ImageView &image,
+                 ImageFileFormat format = IMAGE_FILE_FORMAT_AUTO)
+      {
+        if (format == IMAGE_FILE_FORMAT_AUTO)
+          format = imageFileFormatFor(fileName);
+        Job job { fileName,
+                  image.owner ? image : image.copy(nativePixelFormatOf(format)),
+                  format };
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          jobTaken.wait(lock,[&](){ return queue.size() < size_t(maxQueuedJobs); });
+          queue.push_back(std::move(job));
+          numPending++;
+        }
+        jobAvailable.notify_one();
+      }
+
+      /*! waits until all images scheduled so far have been written;
+          throws the first error that happened since the last flush
+          (if any) */
+      void flush()
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        jobDone.wait(lock,[&](){ return numPending == 0; });
+        if (firstError) {
+          std::exception_ptr error = firstError;
+          firstError = nullptr;
+          std::rethrow_exception(error);
+        }
+      }
+
+      /*! number of images scheduled but not yet fully written */
+      size_t getNumPending()
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        return numPending;
+      }
+
+    private:
+      struct Job {
+        std::string     fileName;
+        ImageView       image;
+        ImageFileFormat format;
+      };
+
+      void workerLoop()
+      {
+        while (1) {
+          Job job;
+          {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAvailable.wait(lock,[&](){ return quit || !queue.empty(); });
+            if (queue.empty()) return;
+            job = std::move(queue.front());
+            queue.pop_front();
+          }
+          jobTaken.notify_one();
+
+          std::exception_ptr error;
+          try {
+            writeImage(job.fileName,job.image,job.format);
+          } catch (...) {
+            error = std::current_exception();
+          }
+          // release the pixels before we say we're done with them
+          job.image = ImageView();
+
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (error && !firstError) firstError = error;
+            numPending--;
+          }
+          jobDone.notify_all();
+        }
+      }
+
+      const int                maxQueuedJobs;
+      std::vector<std::thread> workers;
+      std::deque<Job>          queue;
+      size_t                   numPending { 0 };
+      bool                     quit       { false };
+      std::exception_ptr       firstError;
+      std::mutex               mutex;
+      std::condition_variable  jobAvailable;
+      std::condition_variable  jobTaken;
+      std::condition_variable  jobDone;
+    };
+
+  } // ::owl::common
+} // ::owl
@@ -0,0 +1,423 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file MipChain.h computing the mip levels of a 2D texture on the
+    host (eg, for owlTexture2DCreateMipmapped()): each level is half
+    the size (rounded down, but at least 1) of the previous one in
+    each dimension, filtered down from that previous one with either
+    a box or a Kaiser-windowed sinc filter. Filtering is separable,
+    in float, SSE-vectorized where available, and parallel over the
+    rows of each level. 8-bit sRGB textures get filtered in linear
+    space. */
+
+#include "owl/common/math/vec.h"
+#include "owl/common/math/packet/floatx.h"
+#include "owl/common/parallel/parallel_for.h"
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace owl {
+  namespace common {
+
+    typedef enum {
+      /*! each texel of a level is the (area-weighted) average of the
+          texels it covers in the previous one; cheap, but blurs and
+          aliases more than it has to */
+      MIP_FILTER_BOX,
+      /*! a Kaiser-windowed sinc that is three texels of the new
+          level wide on either side - sharper, and with much less
+          aliasing, at about six times the taps per dimension */
+      MIP_FILTER_KAISER
+    } MipFilter;
+
+    struct MipOptions {
+      MipFilter filter { MIP_FILTER_BOX };
+      /*! whether the (8-bit) texels are sRGB encoded; float texels
+          are always taken to be linear */
+      bool      srgb   { false };
+      /*! whether filters wrap around the texture's edges (for
+          textures that get used with OWL_TEXTURE_WRAP), or clamp */
+      bool      wrap   { false };
+      /*! maximum number of levels (including level 0); 0 for the
+          full chain, down to 1x1 */
+      int       maxLevels { 0 };
+    };
+
+    /*! the levels of a mip chain; level 0 is the original texture,
+        which does not get copied, so has to stay around for as long
+        as the chain gets used */
+    template<typename T>
+    struct MipChain {
+      inline int numLevels() const { return int(size.size()); }
+
+      inline const T *level(int i) const
+      { return i == 0 ? level0 : texels[i-1].data(); }
+
+      /*! pointers to each level's texels, as owlTexture2DCreateMipmapped()
+          wants them */
+      inline std::vector<const void *> levelPointers() const
+      {
+        std::vector<const void *> result;
+        for (int i=0;i<numLevels();i++) result.push_back(level(i));
+        return result;
+      }
+
+      std::vector<vec2i>          size;
+      const T                    *level0 { nullptr };
+      std::vector<std::vector<T>> texels;
+    };
+
+    /*! number of levels of a full chain for a texture of given size */
+    inline int numMipLevels(const vec2i &size)
+    {
+      int numLevels = 1;
+      for (int extent=max(size.x,size.y);extent > 1;extent /= 2) numLevels++;
+      return numLevels;
+    }
+
+    namespace detail {
+
+      /*! how to convert one kind of texel from and to floats; RGBA8
+          texels can be either uint32_t's (red in the lowest byte) or
+          vec4uc's */
+      template<typename T> struct MipTexel;
+      template<> struct MipTexel<uint32_t> { enum { numChannels = 4, is8bit = 1 }; };
+      template<> struct MipTexel<vec4uc>   { enum { numChannels = 4, is8bit = 1 }; };
+      template<> struct MipTexel<uint8_t>  { enum { numChannels = 1, is8bit = 1 }; };
+      template<> struct MipTexel<float>    { enum { numChannels = 1, is8bit = 0 }; };
+      template<> struct MipTexel<vec4f>    { enum { numChannels = 4, is8bit = 0 }; };
+
+      inline float srgbToLinear(float c)
+      { return c <= 0.04045f ? c/12.92f : powf((c+0.055f)/1.055f,2.4f); }
+
+      inline float linearToSRGB(float c)
+      { return c <= 0.0031308f ? c*12.92f : 1.055f*powf(c,1.f/2.4f)-0.055f; }
+
+      /*! the float value of each 8-bit value, either as is (scaled to
+          [0,1]), or sRGB decoded */
+      struct DecodeTable {
+        inline DecodeTable(bool srgb)
+          : srgb(srgb)
+        {
+          for (int i=0;i<256;i++)
+            value[i] = srgb ? srgbToLinear(i/255.f) : i/255.f;
+        }
+        const bool srgb;
+        float value[256];
+      };
+
+      /*! linear [0,1] to sRGB-encoded 8-bit values (rounded to
+          nearest in sRGB space): the result is the number of
+          'threshold's - the linear values half way between two 8-bit
+          ones - that are <= the input, which a table over the input
+          range gets to within a step or two of; exact, and much
+          cheaper than linearToSRGB() */
+      struct EncodeTable {
+        enum { NUM_BUCKETS = 4096 };
+        inline EncodeTable()
+        {
+          for (int i=0;i<255;i++)
+            threshold[i] = srgbToLinear((i+.5f)/255.f);
+          threshold[255] = 2.f;
+          int count = 0;
+          for (int i=0;i<NUM_BUCKETS;i++) {
+            while (threshold[count] <= i/float(NUM_BUCKETS)) count++;
+            bucketStart[i] = uint8_t(count);
+          }
+        }
+        inline uint8_t operator()(float f) const
+        {
+          if (!(f > 0.f)) return 0;
+          if (f >= 1.f)   return 255;
+          int count = bucketStart[int(f*NUM_BUCKETS)];
+          while (threshold[count] <= f) count++;
+          return uint8_t(count);
+        }
+        float   threshold[256];
+        uint8_t bucketStart[NUM_BUCKETS];
+      };
+
+      inline uint8_t floatToUnorm8(float f)
+      {
+        if (!(f > 0.f)) return 0;
+        if (f >= 1.f)   return 255;
+        return uint8_t(f*255.f+.5f);
+      }
+
+      /*! converts a row of 'count' texels to floats */
+      template<typename T>
+      inline void mipToFloat(const T *in, float *out, size_t count, const DecodeTable &table)
+      {
+        const uint8_t *bytes = (const uint8_t *)in;
+        size_t i = 0;
+#if OWL_HAVE_SSE
+        if (!table.srgb) {
+          const __m128  scale = _mm_set1_ps(1.f/255.f);
+          const __m128i zero  = _mm_setzero_si128();
+          for (;i+16<=count*MipTexel<T>::numChannels;i+=16) {
+            const __m128i b    = _mm_loadu_si128((const __m128i *)(bytes+i));
+            const __m128i lo16 = _mm_unpacklo_epi8(b,zero);
+            const __m128i hi16 = _mm_unpackhi_epi8(b,zero);
+            _mm_storeu_ps(out+i+ 0,_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo16,zero)),scale));
+            _mm_storeu_ps(out+i+ 4,_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo16,zero)),scale));
+            _mm_storeu_ps(out+i+ 8,_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi16,zero)),scale));
+            _mm_storeu_ps(out+i+12,_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi16,zero)),scale));
+          }
+        }
+#endif
+        for (;i<count*MipTexel<T>::numChannels;i++)
+          out[i] = table.value[bytes[i]];
+        // alpha is never sRGB encoded
+        if (MipTexel<T>::numChannels == 4 && table.srgb)
+          for (size_t i=0;i<count;i++)
+            out[4*i+3] = bytes[4*i+3]/255.f;
+      }
+      template<>
+      inline void mipToFloat(const float *in, float *out, size_t count, const DecodeTable &)
+      { std::copy(in,in+count,out); }
+      template<>
+      inline void mipToFloat(const vec4f *in, float *out, size_t count, const DecodeTable &)
+      { std::copy((const float *)in,(const float *)(in+count),out); }
+
+      /*! converts a row of 'count' texels back from floats */
+      template<typename T>
+      inline void mipFromFloat(const float *in, T *out, size_t count, const EncodeTable *srgb)
+      {
+        uint8_t *bytes = (uint8_t *)out;
+        const int numChannels = MipTexel<T>::numChannels;
+        if (!srgb) {
+          size_t i = 0;
+#if OWL_HAVE_SSE
+          const __m128 scale = _mm_set1_ps(255.f);
+          const __m128 half  = _mm_set1_ps(.5f);
+          const __m128 lower = _mm_setzero_ps();
+          const __m128 upper = _mm_set1_ps(255.f);
+          for (;i+16<=count*numChannels;i+=16) {
+            __m128i v[4];
+            for (int j=0;j<4;j++) {
+              // (rounding like floatToUnorm8(), ie, halves up)
+              const __m128 f = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in+i+4*j),scale),half);
+              // max() returns its second operand if either one is a NaN
+              v[j] = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(f,lower),upper));
+            }
+            _mm_storeu_si128((__m128i *)(bytes+i),
+                             _mm_packus_epi16(_mm_packs_epi32(v[0],v[1]),
+                                              _mm_packs_epi32(v[2],v[3])));
+          }
+#endif
+          for (;i<count*numChannels;i++)
+            bytes[i] = floatToUnorm8(in[i]);
+        } else {
+          for (size_t i=0;i<count*numChannels;i++)
+            bytes[i] = (numChannels == 4 && i%4 == 3)
+              ? floatToUnorm8(in[i])
+              : (*srgb)(in[i]);
+        }
+      }
+      template<>
+      inline void mipFromFloat(const float *in, float *out, size_t count, const EncodeTable *)
+      { std::copy(in,in+count,out); }
+      template<>
+      inline void mipFromFloat(const float *in, vec4f *out, size_t count, const EncodeTable *)
+      { std::copy(in,in+4*count,(float *)out); }
+
+      /*! the taps (index into, and weight of, the input texels) of
+          each output texel, for filtering one dimension from
+          'inSize' down to 'outSize' texels */
+      struct MipKernel {
+        inline MipKernel(int inSize, int outSize, const MipOptions &options)
+        {
+          begin.push_back(0);
+          if (inSize == outSize) {
+            // (a dimension that already got down to one texel)
+            for (int o=0;o<outSize;o++) {
+              index.push_back(o);
+              w.push_back(1.f);
+              begin.push_back(o+1);
+            }
+            return;
+          }
+          const float scale = inSize/float(outSize);
+          // in output texels
+          const float radius = options.filter == MIP_FILTER_BOX ? .5f : 3.f;
+          for (int o=0;o<outSize;o++) {
+            const float center = (o+.5f)*scale;
+            const int first = int(floorf(center-radius*scale));
+            const int last  = int(ceilf(center+radius*scale));
+            float sum = 0.f;
+            for (int i=first;i<last;i++) {
+              const float w = weight(i,center,scale,radius,options.filter);
+              if (w == 0.f) continue;
+              index.push_back(options.wrap
+                              ? ((i % inSize) + inSize) % inSize
+                              : clamp(i,0,inSize-1));
+              this->w.push_back(w);
+              sum += w;
+            }
+            for (size_t t=begin.back();t<this->w.size();t++)
+              this->w[t] /= sum;
+            begin.push_back(int(this->w.size()));
+          }
+        }
+
+        static inline float weight(int i, float center, float scale,
+                                   float radius, MipFilter filter)
+        {
+          if (filter == MIP_FILTER_BOX)
+            // overlap of texel [i,i+1) with the box around 'center'
+            return max(0.f,min(float(i+1),center+.5f*scale)-max(float(i),center-.5f*scale));
+          const float x = (i+.5f-center)/scale;
+          if (fabsf(x) >= radius) return 0.f;
+          const float pi = 3.14159265358979f;
+          const float sinc = x == 0.f ? 1.f : sinf(pi*x)/(pi*x);
+          const float r = x/radius;
+          return sinc * besselI0(4.f*sqrtf(1.f-r*r))/besselI0(4.f);
+        }
+
+        /*! zeroth order modified Bessel function of the first kind */
+        static inline float besselI0(float x)
+        {
+          float sum = 1.f, term = 1.f;
+          for (int k=1;k<20;k++) {
+            term *= (x/(2.f*k))*(x/(2.f*k));
+            sum  += term;
+          }
+          return sum;
+        }
+
+        /*! output texel o's taps are [begin[o],begin[o+1]) */
+        std::vector<int>   begin;
+        std::vector<int>   index;
+        std::vector<float> w;
+      };
+
+      /*! out[i] += w*in[i] */
+      inline void mipAxpy(float w, const float *in, float *out, size_t count)
+      {
+        size_t i = 0;
+#if OWL_HAVE_SSE
+        const __m128 ww = _mm_set1_ps(w);
+        for (;i+4<=count;i+=4)
+          _mm_storeu_ps(out+i,_mm_add_ps(_mm_loadu_ps(out+i),
+                                         _mm_mul_ps(ww,_mm_loadu_ps(in+i))));
+#endif
+        for (;i<count;i++) out[i] += w*in[i];
+      }
+
+      /*! filters one row of numChannels-channel texels horizontally */
+      template<int numChannels>
+      inline void mipFilterRow(const MipKernel &kernel, const float *in, float *out,
+                               int outSize)
+      {
+        for (int o=0;o<outSize;o++) {
+#if OWL_HAVE_SSE
+          if (numChannels == 4) {
+            __m128 sum = _mm_setzero_ps();
+            for (int t=kernel.begin[o];t<kernel.begin[o+1];t++)
+              sum = _mm_add_ps(sum,_mm_mul_ps(_mm_set1_ps(kernel.w[t]),
+                                              _mm_loadu_ps(in+4*kernel.index[t])));
+            _mm_storeu_ps(out+4*o,sum);
+            continue;
+          }
+#endif
+          for (int c=0;c<numChannels;c++) {
+            float sum = 0.f;
+            for (int t=kernel.begin[o];t<kernel.begin[o+1];t++)
+              sum += kernel.w[t]*in[numChannels*kernel.index[t]+c];
+            out[numChannels*o+c] = sum;
+          }
+        }
+      }
+
+      /*! computes one level from the previous one */
+      template<typename T>
+      inline void mipDownsample(const T *in, const vec2i &inSize,
+                                T *out, const vec2i &outSize,
+                                const MipOptions &options,
+                                const DecodeTable &decode,
+                                const EncodeTable *encode)
+      {
+        const int numChannels = MipTexel<T>::numChannels;
+        const MipKernel kernelX(inSize.x,outSize.x,options);
+        const MipKernel kernelY(inSize.y,outSize.y,options);
+        const size_t inRowSize = size_t(inSize.x)*numChannels;
+        parallel_for_blocked(0,outSize.y,16,[&](size_t begin, size_t end){
+            // the float versions of the input rows this block's taps
+            // use, each converted only once
+            std::vector<int> slotOf(inSize.y,-1);
+            int numSlots = 0;
+            for (int t=kernelY.begin[begin];t<kernelY.begin[end];t++)
+              if (slotOf[kernelY.index[t]] < 0)
+                slotOf[kernelY.index[t]] = numSlots++;
+            std::vector<float> inRows(numSlots*inRowSize);
+            for (int row=0;row<inSize.y;row++)
+              if (slotOf[row] >= 0)
+                mipToFloat(in+size_t(row)*inSize.x,inRows.data()+slotOf[row]*inRowSize,
+                           inSize.x,decode);
+
+            std::vector<float> column(inRowSize);
+            std::vector<float> outRow(size_t(outSize.x)*numChannels);
+            for (size_t y=begin;y<end;y++) {
+              // vertically, into one row of the input's width ...
+              std::fill(column.begin(),column.end(),0.f);
+              for (int t=kernelY.begin[y];t<kernelY.begin[y+1];t++)
+                mipAxpy(kernelY.w[t],inRows.data()+slotOf[kernelY.index[t]]*inRowSize,
+                        column.data(),inRowSize);
+              // ... then horizontally
+              mipFilterRow<numChannels>(kernelX,column.data(),outRow.data(),outSize.x);
+              mipFromFloat(outRow.data(),out+y*outSize.x,outSize.x,encode);
+            }
+          });
+      }
+
+    } // ::owl::common::detail
+
+    /*! computes the mip chain of the given (tightly packed) texture.
+        T is the texel type: uint32_t or vec4uc for RGBA8, uint8_t for
+        R8, vec4f for RGBA32F, or float for R32F */
+    template<typename T>
+    inline MipChain<T> computeMipChain(const T *texels, const vec2i &size,
+                                       const MipOptions &options = MipOptions())
+    {
+      MipChain<T> chain;
+      chain.level0 = texels;
+      chain.size.push_back(size);
+      int numLevels = numMipLevels(size);
+      if (options.maxLevels > 0) numLevels = min(numLevels,options.maxLevels);
+
+      const bool srgb = options.srgb && detail::MipTexel<T>::is8bit;
+      const detail::DecodeTable decode(srgb);
+      std::unique_ptr<detail::EncodeTable> encode;
+      if (srgb) encode.reset(new detail::EncodeTable);
+
+      chain.texels.resize(numLevels-1);
+      for (int i=1;i<numLevels;i++) {
+        const vec2i prevSize = chain.size.back();
+        const vec2i levelSize(max(prevSize.x/2,1),max(prevSize.y/2,1));
+        chain.texels[i-1].resize(size_t(levelSize.x)*levelSize.y);
+        detail::mipDownsample(chain.level(i-1),prevSize,
+                              chain.texels[i-1].data(),levelSize,
+                              options,decode,encode.get());
+        chain.size.push_back(levelSize);
+      }
+      return chain;
+    }
+
+  } // ::owl::common
+} // ::owl
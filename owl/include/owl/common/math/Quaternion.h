@@ -100,7 +100,7 @@ namespace owl {
     template<typename T> __both__ QuaternionT<T> conj      ( const QuaternionT<T>& a ) { return QuaternionT<T>(a.r, -a.i, -a.j, -a.k); }
     template<typename T> __both__ T              abs       ( const QuaternionT<T>& a ) { return sqrt(a.r*a.r + a.i*a.i + a.j*a.j + a.k*a.k); }
     template<typename T> __both__ QuaternionT<T> rcp       ( const QuaternionT<T>& a ) { return conj(a)*rcp(a.r*a.r + a.i*a.i + a.j*a.j + a.k*a.k); }
-    template<typename T> __both__ QuaternionT<T> normalize ( const QuaternionT<T>& a ) { return a*rsqrt(a.r*a.r + a.i*a.i + a.j*a.j + a.k*a.k); }
+    template<typename T> __both__ QuaternionT<T> normalize ( const QuaternionT<T>& a ) { return a*owl::common::polymorphic::rsqrt(a.r*a.r + a.i*a.i + a.j*a.j + a.k*a.k); }
 
     ////////////////////////////////////////////////////////////////
     // Binary Operators
@@ -170,7 +170,7 @@ namespace owl {
       if ( vx.x + vy.y + vz.z >= T(zero) )
         {
           const T t = T(one) + (vx.x + vy.y + vz.z);
-          const T s = rsqrt(t)*T(0.5f);
+          const T s = owl::common::polymorphic::rsqrt(t)*T(0.5f);
           r = t*s;
           i = (vy.z - vz.y)*s;
           j = (vz.x - vx.z)*s;
@@ -179,7 +179,7 @@ namespace owl {
       else if ( vx.x >= max(vy.y, vz.z) )
         {
           const T t = (T(one) + vx.x) - (vy.y + vz.z);
-          const T s = rsqrt(t)*T(0.5f);
+          const T s = owl::common::polymorphic::rsqrt(t)*T(0.5f);
           r = (vy.z - vz.y)*s;
           i = t*s;
           j = (vx.y + vy.x)*s;
@@ -188,7 +188,7 @@ namespace owl {
       else if ( vy.y >= vz.z ) // if ( vy.y >= max(vz.z, vx.x) )
         {
           const T t = (T(one) + vy.y) - (vz.z + vx.x);
-          const T s = rsqrt(t)*T(0.5f);
+          const T s = owl::common::polymorphic::rsqrt(t)*T(0.5f);
           r = (vz.x - vx.z)*s;
           i = (vx.y + vy.x)*s;
           j = t*s;
@@ -197,7 +197,7 @@ namespace owl {
       else //if ( vz.z >= max(vy.y, vx.x) )
         {
           const T t = (T(one) + vz.z) - (vx.x + vy.y);
-          const T s = rsqrt(t)*T(0.5f);
+          const T s = owl::common::polymorphic::rsqrt(t)*T(0.5f);
           r = (vx.y - vy.x)*s;
           i = (vz.x + vx.z)*s;
           j = (vy.z + vz.y)*s;
@@ -0,0 +1,190 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file SRTTransform.h scale/rotate/translate (SRT) transforms, as
+    used for OptiX's SRT motion transforms: unlike affine3f's, whose
+    coefficients get interpolated linearly (which makes rotating
+    objects shrink in between keys), their rotation is a quaternion
+    that gets interpolated along the rotation's arc. Conversion from
+    and to affine3f, interpolation, and conservative motion bounds */
+
+#include "owl/common/math/motion.h"
+
+namespace owl {
+  namespace common {
+
+    /*! one key of an SRT transform, with the same meaning as
+        OptixSRTData: a point p gets transformed to
+
+        translation + rotation * (S * p + pivot)
+
+        where S is the upper triangular matrix
+
+        [ scale.x shear.x shear.y ]
+        [    0    scale.y shear.z ]
+        [    0       0    scale.z ]
+
+        To rotate and scale about a point c (eg, the object's
+        center), pivot is -S*c, and translation is where c ends up;
+        see decomposeSRT() */
+    struct SRTTransform {
+      /*! the scale/shear part as a matrix */
+      inline __both__ linear3f scaleShear() const
+      {
+        return linear3f(vec3f(scale.x,0.f,0.f),
+                        vec3f(shear.x,scale.y,0.f),
+                        vec3f(shear.y,shear.z,scale.z));
+      }
+      
+      vec3f        scale       { 1.f };
+      vec3f        shear       { 0.f };
+      vec3f        pivot       { 0.f };
+      Quaternion3f rotation    { 1.f };
+      vec3f        translation { 0.f };
+    };
+
+    /*! the affine transform that does the same as the given SRT */
+    inline __both__ affine3f toAffine(const SRTTransform &srt)
+    {
+      const linear3f rotation(normalize(srt.rotation));
+      return affine3f(rotation*srt.scaleShear(),
+                      srt.translation+rotation*srt.pivot);
+    }
+
+    /*! some unit vector perpendicular to the (unit) vector v */
+    inline __both__ vec3f anyPerpendicular(const vec3f &v)
+    {
+      return normalize(fabsf(v.x) < .9f
+                       ? cross(v,vec3f(1.f,0.f,0.f))
+                       : cross(v,vec3f(0.f,1.f,0.f)));
+    }
+    
+    /*! decomposes an affine transform into an SRT whose
+        toAffine() is that transform again, with rotation and scale
+        (and thus, interpolation between keys) about the given
+        center. This is a QR decomposition of the linear part, so
+        any shear ends up in S, as does mirroring (as a negative
+        scale.z); degenerate (eg, flattening) transforms are fine,
+        too */
+    inline SRTTransform decomposeSRT(const affine3f &xfm,
+                                     const vec3f &center = vec3f(0.f))
+    {
+      SRTTransform srt;
+      const vec3f &c0 = xfm.l.vx, &c1 = xfm.l.vy, &c2 = xfm.l.vz;
+
+      // Gram-Schmidt over the columns, c_i = sum_j<=i S_ji q_j
+      srt.scale.x = length(c0);
+      const vec3f q0 = srt.scale.x > 0.f ? c0/srt.scale.x : vec3f(1.f,0.f,0.f);
+      srt.shear.x = dot(q0,c1);
+      const vec3f r1 = c1-srt.shear.x*q0;
+      srt.scale.y = length(r1);
+      const vec3f q1 = srt.scale.y > 1e-6f*length(c1)
+        ? r1/srt.scale.y
+        : anyPerpendicular(q0);
+      // a proper rotation, so a mirroring transform gets a negative scale.z
+      const vec3f q2 = cross(q0,q1);
+      srt.shear.y = dot(q0,c2);
+      srt.shear.z = dot(q1,c2);
+      srt.scale.z = dot(q2,c2);
+      
+      srt.rotation    = normalize(Quaternion3f(q0,q1,q2));
+      srt.pivot       = -(srt.scaleShear()*center);
+      srt.translation = xfmPoint(xfm,center);
+      return srt;
+    }
+
+    inline __both__ float dot(const Quaternion3f &a, const Quaternion3f &b)
+    { return a.r*b.r + a.i*b.i + a.j*b.j + a.k*b.k; }
+    
+    /*! q and -q are the same rotation, but interpolating towards -q
+        takes the long way round; this flips keys' rotations such
+        that each one takes the short way from the one before it */
+    inline void alignSRTRotations(SRTTransform *keys, int numKeys)
+    {
+      for (int i=1;i<numKeys;i++)
+        if (dot(keys[i-1].rotation,keys[i].rotation) < 0.f)
+          keys[i].rotation = -keys[i].rotation;
+    }
+    
+    /*! interpolation between two SRT keys the way OptiX does it:
+        linear for all components, followed by re-normalizing the
+        rotation (ie, 'nlerp') */
+    inline __both__ SRTTransform motionLerp(const SRTTransform &a,
+                                            const SRTTransform &b,
+                                            float f)
+    {
+      SRTTransform srt;
+      srt.scale       = motionLerp(a.scale,b.scale,f);
+      srt.shear       = motionLerp(a.shear,b.shear,f);
+      srt.pivot       = motionLerp(a.pivot,b.pivot,f);
+      srt.rotation    = normalize((1.f-f)*a.rotation + f*b.rotation);
+      srt.translation = motionLerp(a.translation,b.translation,f);
+      return srt;
+    }
+
+    /*! bounds of srt(p) for every point p in 'box', and every srt
+        along the interpolation from 'a' to 'b'. Scale/shear and
+        translation get bounded by interval arithmetic; the rotation
+        is a rotation about a fixed axis (that of a's rotation
+        relative to b's) by a growing angle, so each corner gets
+        bounded along its arc - in pieces of at most a quarter turn,
+        each of which is inside the triangle of its two ends and the
+        point where their tangents meet */
+    inline box3f xfmBounds(const SRTTransform &a, const SRTTransform &b,
+                           const box3f &box)
+    {
+      if (box.empty()) return box3f();
+      const box3f scaled = xfmBounds(affine3f(a.scaleShear(),a.pivot),
+                                     affine3f(b.scaleShear(),b.pivot),
+                                     box);
+
+      const Quaternion3f q0 = normalize(a.rotation);
+      const Quaternion3f q1 = normalize(b.rotation);
+      const Quaternion3f d  = conj(q0)*q1;
+      const float sinHalfAngle = length(d.v());
+      const float angle  = 2.f*atan2f(sinHalfAngle,d.r);
+      const vec3f axis   = sinHalfAngle > 0.f ? d.v()/sinHalfAngle : vec3f(0.f);
+      const int numArcs  = sinHalfAngle > 0.f
+        ? max(1,int(ceilf(angle/1.5707964f)))
+        : 0;
+      const float arc    = numArcs ? angle/numArcs : 0.f;
+      const float bulge  = 1.f/cosf(.5f*arc);
+      const linear3f rotation0(q0);
+      
+      box3f rotated;
+      for (int c=0;c<8;c++) {
+        const vec3f corner((c&1) ? scaled.upper.x : scaled.lower.x,
+                           (c&2) ? scaled.upper.y : scaled.lower.y,
+                           (c&4) ? scaled.upper.z : scaled.lower.z);
+        rotated.extend(rotation0*corner);
+        if (numArcs == 0) continue;
+        const vec3f along  = axis*dot(axis,corner);
+        const vec3f radial = corner-along;
+        const vec3f tangent = cross(axis,radial);
+        for (int i=0;i<numArcs;i++) {
+          const float end = (i+1)*arc, mid = (i+.5f)*arc;
+          rotated.extend(rotation0*(along+cosf(end)*radial+sinf(end)*tangent));
+          rotated.extend(rotation0*(along+bulge*(cosf(mid)*radial+sinf(mid)*tangent)));
+        }
+      }
+      return box3f(rotated.lower+min(a.translation,b.translation),
+                   rotated.upper+max(a.translation,b.translation));
+    }
+    
+  } // ::owl::common
+} // ::owl
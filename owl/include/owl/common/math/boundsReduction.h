@@ -0,0 +1,245 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file boundsReduction.h host-side, SIMD and multi-threaded bounds
+    computations over (possibly strided) arrays of vertices and
+    triangles. All results are exactly the same as those of the
+    equivalent scalar box3f::extend() loops - min and max do not
+    round, so the order of reduction does not matter. */
+
+#include "owl/common/math/packet/floatx.h"
+#include "owl/common/math/box.h"
+#include "owl/common/parallel/parallel_for.h"
+#include <vector>
+
+namespace owl {
+  namespace common {
+
+    /*! a read-only view onto an array of elements of type T, using
+        the same count/stride/offset semantics as the vertex and
+        index arrays of triangle meshes (owlTrianglesSetVertices):
+        element i lives at (const uint8_t*)base + offset + i*stride */
+    template<typename T>
+    struct StridedArray {
+      StridedArray() = default;
+      StridedArray(const void *base, size_t count,
+                   size_t stride = sizeof(T), size_t offset = 0)
+        : base(base), count(count), stride(stride), offset(offset)
+      {}
+      StridedArray(const std::vector<T> &vec)
+        : base(vec.data()), count(vec.size())
+      {}
+
+      /*! pointer to element i */
+      inline const T *ptr(size_t i) const
+      { return (const T *)((const uint8_t *)base + offset + i*stride); }
+      inline const T &operator[](size_t i) const { return *ptr(i); }
+
+      const void *base   = nullptr;
+      size_t      count  = 0;
+      size_t      stride = sizeof(T);
+      size_t      offset = 0;
+    };
+
+    typedef StridedArray<vec3f> StridedVec3fs;
+    typedef StridedArray<vec3i> StridedVec3is;
+
+    /*! number of elements each thread reduces before writing out a
+        partial result */
+    enum { boundsReductionBlockSize = 64*1024 };
+
+    /*! bounds of all given points */
+    inline box3f computeBounds(const StridedVec3fs &points);
+
+    /*! bounds of all spheres with given centers and radii; since
+        round linear and b-spline curves stay within the convex hull
+        of their control points' spheres, this also bounds such
+        curves (with the curve widths as radii) */
+    inline box3f computeBounds(const StridedVec3fs &centers,
+                               const StridedArray<float> &radii);
+
+    /*! bounds of all triangles (ie, of all vertices referenced by
+        any of the triangles, which may be fewer than all vertices) */
+    inline box3f computeBounds(const StridedVec3fs &vertices,
+                               const StridedVec3is &indices);
+
+    /*! bounds of the triangles' centroids (ie, of the centers of the
+        triangles' bounding boxes, as a BVH builder would use them) */
+    inline box3f computeCentroidBounds(const StridedVec3fs &vertices,
+                                       const StridedVec3is &indices);
+
+    /*! bounds of the centers of all given boxes */
+    inline box3f computeCentroidBounds(const box3f *boxes, size_t count);
+
+    /*! write the bounding box of each triangle into primBounds[], and
+        return the bounds of all of them */
+    inline box3f computeTriangleBounds(box3f *primBounds,
+                                       const StridedVec3fs &vertices,
+                                       const StridedVec3is &indices);
+
+    // ------------------------------------------------------------------
+    // implementation section
+    // ------------------------------------------------------------------
+
+    /*! helper that runs 'blockFct(begin,end)' over [0,count) in
+        parallel, with each block returning a box, and reduces those */
+    template<typename BlockFct>
+    inline box3f parallelBoundsReduce(size_t count, const BlockFct &blockFct)
+    {
+      const size_t blockSize = boundsReductionBlockSize;
+      const size_t numBlocks = (count+blockSize-1)/blockSize;
+      if (numBlocks <= 1)
+        return blockFct(size_t(0),count);
+
+      std::vector<box3f> partial(numBlocks);
+      parallel_for(numBlocks,[&](size_t blockID){
+          const size_t begin = blockID*blockSize;
+          const size_t end   = std::min(begin+blockSize,count);
+          partial[blockID] = blockFct(begin,end);
+        });
+      box3f result;
+      for (auto &box : partial)
+        result.extend(box);
+      return result;
+    }
+
+    /*! bounds of 'count' vec3fs that are densely packed (ie, a plain
+        array of 3*count floats): four vertices are exactly three
+        4-wide loads, which we reduce as they are - lanes then hold
+        (x,y,z,x), (y,z,x,y), and (z,x,y,z) - so unlike going through
+        vec3fx_t::load() there's no transpose at all. That transpose
+        (or, for indexed triangles, the gather) costs more than the
+        packet math saves, so everything else below uses plain scalar
+        loops */
+    inline box3f packedPointBounds(const float *f, size_t count)
+    {
+      typedef floatx<4> floatx4;
+      const box3f empty;
+      floatx4 lo0(empty.lower.x), lo1(lo0), lo2(lo0);
+      floatx4 hi0(empty.upper.x), hi1(hi0), hi2(hi0);
+      size_t i = 0;
+      for (;i+4<=count;i+=4,f+=12) {
+        const floatx4 a = floatx4::load(f+0);
+        const floatx4 b = floatx4::load(f+4);
+        const floatx4 c = floatx4::load(f+8);
+        lo0 = min(lo0,a); hi0 = max(hi0,a);
+        lo1 = min(lo1,b); hi1 = max(hi1,b);
+        lo2 = min(lo2,c); hi2 = max(hi2,c);
+      }
+      box3f result;
+      const vec3f lanes[4][2] = {
+        { vec3f(lo0[0],lo0[1],lo0[2]), vec3f(hi0[0],hi0[1],hi0[2]) },
+        { vec3f(lo0[3],lo1[0],lo1[1]), vec3f(hi0[3],hi1[0],hi1[1]) },
+        { vec3f(lo1[2],lo1[3],lo2[0]), vec3f(hi1[2],hi1[3],hi2[0]) },
+        { vec3f(lo2[1],lo2[2],lo2[3]), vec3f(hi2[1],hi2[2],hi2[3]) }
+      };
+      for (int lane=0;lane<4;lane++)
+        result.extend(box3f(lanes[lane][0],lanes[lane][1]));
+      for (;i<count;i++,f+=3)
+        result.extend(vec3f(f[0],f[1],f[2]));
+      return result;
+    }
+
+    inline box3f computeBounds(const StridedVec3fs &points)
+    {
+      return parallelBoundsReduce
+        (points.count,[&](size_t begin, size_t end) -> box3f {
+          if (points.stride == sizeof(vec3f))
+            return packedPointBounds((const float *)points.ptr(begin),end-begin);
+          box3f result;
+          for (size_t i=begin;i<end;i++)
+            result.extend(points[i]);
+          return result;
+        });
+    }
+
+    inline box3f computeBounds(const StridedVec3fs &centers,
+                               const StridedArray<float> &radii)
+    {
+      assert(radii.count >= centers.count);
+      return parallelBoundsReduce
+        (centers.count,[&](size_t begin, size_t end) -> box3f {
+          box3f result;
+          for (size_t i=begin;i<end;i++) {
+            const float r = radii[i];
+            result.extend(box3f(centers[i]-vec3f(r),centers[i]+vec3f(r)));
+          }
+          return result;
+        });
+    }
+
+    inline box3f triangleBounds(const StridedVec3fs &vertices, const vec3i &idx)
+    {
+      return box3f()
+        .including(vertices[idx.x])
+        .including(vertices[idx.y])
+        .including(vertices[idx.z]);
+    }
+
+    inline box3f computeBounds(const StridedVec3fs &vertices,
+                               const StridedVec3is &indices)
+    {
+      return parallelBoundsReduce
+        (indices.count,[&](size_t begin, size_t end) -> box3f {
+          box3f result;
+          for (size_t i=begin;i<end;i++)
+            result.extend(triangleBounds(vertices,indices[i]));
+          return result;
+        });
+    }
+
+    inline box3f computeCentroidBounds(const StridedVec3fs &vertices,
+                                       const StridedVec3is &indices)
+    {
+      return parallelBoundsReduce
+        (indices.count,[&](size_t begin, size_t end) -> box3f {
+          box3f result;
+          for (size_t i=begin;i<end;i++)
+            result.extend(triangleBounds(vertices,indices[i]).center());
+          return result;
+        });
+    }
+
+    inline box3f computeCentroidBounds(const box3f *boxes, size_t count)
+    {
+      return parallelBoundsReduce
+        (count,[&](size_t begin, size_t end) -> box3f {
+          box3f result;
+          for (size_t i=begin;i<end;i++)
+            result.extend(boxes[i].center());
+          return result;
+        });
+    }
+
+    inline box3f computeTriangleBounds(box3f *primBounds,
+                                       const StridedVec3fs &vertices,
+                                       const StridedVec3is &indices)
+    {
+      return parallelBoundsReduce
+        (indices.count,[&](size_t begin, size_t end) -> box3f {
+          box3f result;
+          for (size_t i=begin;i<end;i++) {
+            primBounds[i] = triangleBounds(vertices,indices[i]);
+            result.extend(primBounds[i]);
+          }
+          return result;
+        });
+    }
+
+  } // ::owl::common
+} // ::owl
@@ -0,0 +1,200 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file morton.h Morton (aka Z-order) codes: interleaving the bits
+    of 2D or 3D integer coordinates, such that points that are close
+    in space tend to be close in the resulting 1D order. Usable on
+    both host and device */
+
+#include "owl/common/math/vec.h"
+
+namespace owl {
+  namespace common {
+
+    /*! spreads the lower 21 bits of 'x' out to every third bit */
+    inline __both__ uint64_t mortonSpread3(uint64_t x)
+    {
+      x &= 0x1fffff;
+      x = (x | (x << 32)) & 0x001f00000000ffffull;
+      x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+      x = (x | (x <<  8)) & 0x100f00f00f00f00full;
+      x = (x | (x <<  4)) & 0x10c30c30c30c30c3ull;
+      x = (x | (x <<  2)) & 0x1249249249249249ull;
+      return x;
+    }
+
+    /*! inverse of mortonSpread3: collects every third bit */
+    inline __both__ uint32_t mortonCompact3(uint64_t x)
+    {
+      x &= 0x1249249249249249ull;
+      x = (x ^ (x >>  2)) & 0x10c30c30c30c30c3ull;
+      x = (x ^ (x >>  4)) & 0x100f00f00f00f00full;
+      x = (x ^ (x >>  8)) & 0x001f0000ff0000ffull;
+      x = (x ^ (x >> 16)) & 0x001f00000000ffffull;
+      x = (x ^ (x >> 32)) & 0x00000000001fffffull;
+      return uint32_t(x);
+    }
+
+    /*! spreads the lower 32 bits of 'x' out to every second bit */
+    inline __both__ uint64_t mortonSpread2(uint64_t x)
+    {
+      x &= 0xffffffffull;
+      x = (x | (x << 16)) & 0x0000ffff0000ffffull;
+      x = (x | (x <<  8)) & 0x00ff00ff00ff00ffull;
+      x = (x | (x <<  4)) & 0x0f0f0f0f0f0f0f0full;
+      x = (x | (x <<  2)) & 0x3333333333333333ull;
+      x = (x | (x <<  1)) & 0x5555555555555555ull;
+      return x;
+    }
+
+    /*! inverse of mortonSpread2: collects every second bit */
+    inline __both__ uint32_t mortonCompact2(uint64_t x)
+    {
+      x &= 0x5555555555555555ull;
+      x = (x ^ (x >>  1)) & 0x3333333333333333ull;
+      x = (x ^ (x >>  2)) & 0x0f0f0f0f0f0f0f0full;
+      x = (x ^ (x >>  4)) & 0x00ff00ff00ff00ffull;
+      x = (x ^ (x >>  8)) & 0x0000ffff0000ffffull;
+      x = (x ^ (x >> 16)) & 0x00000000ffffffffull;
+      return uint32_t(x);
+    }
+
+    /*! 3D morton code of a (non-negative) coordinate of up to 21 bits
+        per dimension; x is the least significant */
+    inline __both__ uint64_t mortonEncode(const vec3i &v)
+    {
+      return mortonSpread3(v.x)
+        |   (mortonSpread3(v.y) << 1)
+        |   (mortonSpread3(v.z) << 2);
+    }
+
+    /*! 2D morton code of a (non-negative) coordinate of up to 32 bits
+        per dimension; x is the least significant */
+    inline __both__ uint64_t mortonEncode(const vec2i &v)
+    {
+      return mortonSpread2(v.x) | (mortonSpread2(v.y) << 1);
+    }
+
+    inline __both__ vec3i mortonDecode3(uint64_t code)
+    {
+      return vec3i(mortonCompact3(code),
+                   mortonCompact3(code >> 1),
+                   mortonCompact3(code >> 2));
+    }
+
+    inline __both__ vec2i mortonDecode2(uint64_t code)
+    {
+      return vec2i(mortonCompact2(code),mortonCompact2(code >> 1));
+    }
+
+    /*! log2 of the smallest power of two that is >= n */
+    inline __both__ int log2RoundUp(uint32_t n)
+    {
+      int log = 0;
+      while ((uint32_t(1) << log) < n) log++;
+      return log;
+    }
+
+    /*! a Morton order for grids whose dimensions are not all the same
+        power of two: bits get interleaved as long as each dimension
+        still has some left, so the order is dense over the grid
+        rounded up to powers of two per dimension (ie, at most 2x
+        larger per dimension than the grid), rather than over the
+        cube of the largest dimension */
+    struct MortonOrder3 {
+      inline __both__ MortonOrder3() {}
+      inline __both__ MortonOrder3(const vec3i &dims)
+        : logDims(log2RoundUp(dims.x),log2RoundUp(dims.y),log2RoundUp(dims.z))
+      {}
+
+      /*! number of codes - some of which may be outside the grid */
+      inline __both__ uint64_t numCodes() const
+      { return uint64_t(1) << (logDims.x+logDims.y+logDims.z); }
+
+      inline __both__ vec3i decode(uint64_t code) const
+      {
+        vec3i v(0);
+        int bit = 0;
+        const int maxLog = max(logDims.x,max(logDims.y,logDims.z));
+        for (int level=0;level<maxLog;level++) {
+          if (level < logDims.x) v.x |= int((code >> bit++) & 1) << level;
+          if (level < logDims.y) v.y |= int((code >> bit++) & 1) << level;
+          if (level < logDims.z) v.z |= int((code >> bit++) & 1) << level;
+        }
+        return v;
+      }
+
+      /*! same as the obvious bit-by-bit loop (see decode()), but
+          cheap enough for addressing volume data: the lowest levels
+          (where all three dimensions still have bits) are a regular
+          3D morton code, the next ones (where two are left) a 2D
+          one, and the rest are the bits of the one remaining
+          dimension */
+      inline __both__ uint64_t encode(const vec3i &v) const
+      {
+        const int log0 = min(logDims.x,min(logDims.y,logDims.z));
+        const int mask0 = (1<<log0)-1;
+        uint64_t code = mortonEncode(vec3i(v.x&mask0,v.y&mask0,v.z&mask0));
+        int bit = 3*log0;
+
+        // the (up to two) dimensions that have more than log0 bits
+        int a = -1, b = -1;
+        for (int dim=0;dim<3;dim++)
+          if (logDims[dim] > log0) { if (a < 0) a = dim; else b = dim; }
+        if (a < 0) return code;
+        if (b < 0) return code | (uint64_t(v[a] >> log0) << bit);
+
+        const int log1 = min(logDims[a],logDims[b]);
+        const int mask1 = (1<<(log1-log0))-1;
+        code |= (mortonSpread2((v[a] >> log0) & mask1)
+                 | (mortonSpread2((v[b] >> log0) & mask1) << 1)) << bit;
+        bit += 2*(log1-log0);
+        const int c = logDims[a] > log1 ? a : b;
+        return code | (uint64_t(v[c] >> log1) << bit);
+      }
+
+      vec3i logDims { 0 };
+    };
+
+    /*! 2D version of MortonOrder3 */
+    struct MortonOrder2 {
+      inline __both__ MortonOrder2() {}
+      inline __both__ MortonOrder2(const vec2i &dims)
+        : logDims(log2RoundUp(dims.x),log2RoundUp(dims.y))
+      {}
+
+      inline __both__ uint64_t numCodes() const
+      { return uint64_t(1) << (logDims.x+logDims.y); }
+
+      inline __both__ vec2i decode(uint64_t code) const
+      {
+        vec2i v(0);
+        int bit = 0;
+        const int maxLog = max(logDims.x,logDims.y);
+        for (int level=0;level<maxLog;level++) {
+          if (level < logDims.x) v.x |= int((code >> bit++) & 1) << level;
+          if (level < logDims.y) v.y |= int((code >> bit++) & 1) << level;
+        }
+        return v;
+      }
+
+      vec2i logDims { 0 };
+    };
+
+  } // ::owl::common
+} // ::owl
@@ -0,0 +1,149 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file motion.h motion keys: values (vertex positions, bounds,
+    transforms) given at numKeys evenly spaced times over [0,1] - the
+    motion range OWL always builds with - and linearly interpolated
+    in between, the same way OptiX does. Also, conservative bounds of
+    things that move that way. Key lookup and interpolation are usable
+    on both host and device */
+
+#include "owl/common/math/AffineSpace.h"
+#include <algorithm>
+#include <vector>
+
+namespace owl {
+  namespace common {
+
+    /*! the time of the given key */
+    inline __both__ float motionKeyTime(int key, int numKeys)
+    { return numKeys < 2 ? 0.f : float(key)/float(numKeys-1); }
+    
+    /*! the key at or before the given time, and how far (in [0,1])
+        towards the next key 'time' is; times outside [0,1] get
+        clamped, just like OptiX does with the default motion flags */
+    inline __both__ int motionKeySegment(int numKeys, float time, float &frac)
+    {
+      if (numKeys < 2) { frac = 0.f; return 0; }
+      const float f = max(0.f,min(1.f,time))*float(numKeys-1);
+      const int key = min(int(f),numKeys-2);
+      frac = f - float(key);
+      return key;
+    }
+
+    inline __both__ vec3f motionLerp(const vec3f &a, const vec3f &b, float f)
+    { return (1.f-f)*a + f*b; }
+    
+    /*! if every point of an object is within 'a' at one key, and within
+        'b' at the next, it's within this box at any time in between */
+    inline __both__ box3f motionLerp(const box3f &a, const box3f &b, float f)
+    {
+      if (a.empty() || b.empty()) return a.empty() ? b : a;
+      return box3f(motionLerp(a.lower,b.lower,f),motionLerp(a.upper,b.upper,f));
+    }
+    
+    inline __both__ affine3f motionLerp(const affine3f &a, const affine3f &b, float f)
+    {
+      return affine3f(linear3f(motionLerp(a.l.vx,b.l.vx,f),
+                               motionLerp(a.l.vy,b.l.vy,f),
+                               motionLerp(a.l.vz,b.l.vz,f)),
+                      motionLerp(a.p,b.p,f));
+    }
+    
+    /*! the value of 'numKeys' motion keys at the given time */
+    template<typename T>
+    inline __both__ T interpolateMotionKeys(const T *keys, int numKeys, float time)
+    {
+      if (numKeys < 2) return keys[0];
+      float frac;
+      const int key = motionKeySegment(numKeys,time,frac);
+      return motionLerp(keys[key],keys[key+1],frac);
+    }
+
+    /*! bounds of xfm(p) for every point p in 'box', and every
+        transform whose coefficients are all (each on its own) within
+        those of 'a' and 'b' - which includes every linear
+        interpolation between the two. Interval arithmetic, so the
+        wider a and b are apart, the looser this gets */
+    inline __both__ box3f xfmBounds(const affine3f &a, const affine3f &b,
+                                    const box3f &box)
+    {
+      if (box.empty()) return box3f();
+      box3f result(min(a.p,b.p),max(a.p,b.p));
+      const vec3f *colA = &a.l.vx;
+      const vec3f *colB = &b.l.vx;
+      for (int dim=0;dim<3;dim++) {
+        const vec3f lo = min(colA[dim],colB[dim]);
+        const vec3f hi = max(colA[dim],colB[dim]);
+        const float x0 = box.lower[dim], x1 = box.upper[dim];
+        result.lower += min(min(lo*x0,lo*x1),min(hi*x0,hi*x1));
+        result.upper += max(max(lo*x0,lo*x1),max(hi*x0,hi*x1));
+      }
+      return result;
+    }
+    
+    /*! all times at which a motion with 'numKeysA' keys, or one with
+        'numKeysB' keys, has a key - in order, and without duplicates */
+    inline std::vector<float> mergedMotionKeyTimes(int numKeysA, int numKeysB)
+    {
+      std::vector<float> times;
+      for (int i=0;i<numKeysA;i++) times.push_back(motionKeyTime(i,numKeysA));
+      for (int i=0;i<numKeysB;i++) times.push_back(motionKeyTime(i,numKeysB));
+      std::sort(times.begin(),times.end());
+      times.erase(std::unique(times.begin(),times.end()),times.end());
+      return times;
+    }
+    
+    /*! bounds over all times in [0,1] of an object whose bounds move
+        along 'numBoundsKeys' keys, under a transform that moves along
+        'numXfmKeys' keys - the two don't need to have the same number
+        of keys. Each interval between two keys of either one gets
+        split into 'numSubSteps' steps, each of which gets bounded
+        conservatively (see xfmBounds(a,b,box)); more steps make for
+        tighter bounds under strong rotation. Works for any transform
+        type that has motionLerp() and xfmBounds(a,b,box) - affine3f
+        here, and SRTTransform (see SRTTransform.h) */
+    template<typename Xfm>
+    inline box3f motionBounds(const Xfm *xfmKeys, int numXfmKeys,
+                              const box3f *boundsKeys, int numBoundsKeys,
+                              int numSubSteps = 1)
+    {
+      if (numXfmKeys < 1 || numBoundsKeys < 1) return box3f();
+      
+      const std::vector<float> times
+        = mergedMotionKeyTimes(numXfmKeys,numBoundsKeys);
+      if (times.size() == 1)
+        return xfmBounds(xfmKeys[0],xfmKeys[0],boundsKeys[0]);
+      box3f result;
+      for (size_t seg=0;seg+1<times.size();seg++)
+        for (int step=0;step<numSubSteps;step++) {
+          const float t0 = times[seg] + (times[seg+1]-times[seg])*step/numSubSteps;
+          const float t1 = step+1 == numSubSteps
+            ? times[seg+1]
+            : times[seg] + (times[seg+1]-times[seg])*(step+1)/numSubSteps;
+          box3f box = interpolateMotionKeys(boundsKeys,numBoundsKeys,t0);
+          box.extend(interpolateMotionKeys(boundsKeys,numBoundsKeys,t1));
+          result.extend(xfmBounds(interpolateMotionKeys(xfmKeys,numXfmKeys,t0),
+                                  interpolateMotionKeys(xfmKeys,numXfmKeys,t1),
+                                  box));
+        }
+      return result;
+    }
+    
+  } // ::owl::common
+} // ::owl
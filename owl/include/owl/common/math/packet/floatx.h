@@ -0,0 +1,328 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file floatx.h packets of N floats (and N bools) for host-side
+    SIMD code. floatx<4> maps to SSE, and floatx<8> to AVX if the
+    compiler is allowed to use those (for AVX, configure owl with
+    OWL_USE_AVX=ON); everything else (as well as builds with
+    OWL_DISABLE_SIMD, and anything compiled by nvcc) uses plain
+    per-lane loops with the same interface. */
+
+#include "owl/common/owl-common.h"
+#include <math.h>
+
+#if !defined(OWL_DISABLE_SIMD) && !defined(__CUDACC__)
+# if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define OWL_HAVE_SSE 1
+# endif
+# if defined(__AVX__)
+#  define OWL_HAVE_AVX 1
+# endif
+# if defined(__AVX2__)
+#  define OWL_HAVE_AVX2 1
+# endif
+#endif
+
+#if OWL_HAVE_SSE || OWL_HAVE_AVX
+# include <immintrin.h>
+#endif
+
+namespace owl {
+  namespace common {
+
+    // =======================================================
+    // generic (portable) versions
+    // =======================================================
+
+    /*! a packet of N bools, the result of comparing two floatx'es */
+    template<int N>
+    struct boolx {
+      enum { numLanes = N };
+      inline boolx() = default;
+      inline boolx(bool b) { for (int i=0;i<N;i++) v[i] = b; }
+      inline bool  operator[](int i) const { return v[i]; }
+      inline void  set(int i, bool b) { v[i] = b; }
+      bool v[N];
+    };
+
+    /*! a packet of N floats */
+    template<int N>
+    struct floatx {
+      enum { numLanes = N };
+      inline floatx() = default;
+      inline floatx(float f) { for (int i=0;i<N;i++) v[i] = f; }
+
+      /*! load N consecutive floats */
+      static inline floatx load(const float *ptr)
+      { floatx r; for (int i=0;i<N;i++) r.v[i] = ptr[i]; return r; }
+      /*! load N floats from base[indices[i]] */
+      static inline floatx gather(const float *base, const int32_t *indices)
+      { floatx r; for (int i=0;i<N;i++) r.v[i] = base[indices[i]]; return r; }
+      /*! store N consecutive floats */
+      inline void store(float *ptr) const
+      { for (int i=0;i<N;i++) ptr[i] = v[i]; }
+
+      inline float operator[](int i) const { return v[i]; }
+      inline void  set(int i, float f) { v[i] = f; }
+      float v[N];
+    };
+
+#define _define_floatx_binary_op(op)                                    \
+    template<int N>                                                     \
+    inline floatx<N> operator op(const floatx<N> &a, const floatx<N> &b) \
+    { floatx<N> r; for (int i=0;i<N;i++) r.set(i,a[i] op b[i]); return r; } \
+    template<int N>                                                     \
+    inline floatx<N> operator op(const floatx<N> &a, const float b)     \
+    { return a op floatx<N>(b); }                                       \
+    template<int N>                                                     \
+    inline floatx<N> operator op(const float a, const floatx<N> &b)     \
+    { return floatx<N>(a) op b; }
+
+    _define_floatx_binary_op(+)
+    _define_floatx_binary_op(-)
+    _define_floatx_binary_op(*)
+    _define_floatx_binary_op(/)
+#undef _define_floatx_binary_op
+
+#define _define_floatx_compare_op(op)                                   \
+    template<int N>                                                     \
+    inline boolx<N> operator op(const floatx<N> &a, const floatx<N> &b) \
+    { boolx<N> r; for (int i=0;i<N;i++) r.set(i,a[i] op b[i]); return r; }
+
+    _define_floatx_compare_op(<)
+    _define_floatx_compare_op(<=)
+    _define_floatx_compare_op(>)
+    _define_floatx_compare_op(>=)
+    _define_floatx_compare_op(==)
+    _define_floatx_compare_op(!=)
+#undef _define_floatx_compare_op
+
+#define _define_floatx_op_assign(op)                                    \
+    template<int N>                                                     \
+    inline floatx<N> &operator op##=(floatx<N> &a, const floatx<N> &b)  \
+    { a = a op b; return a; }
+
+    _define_floatx_op_assign(+)
+    _define_floatx_op_assign(-)
+    _define_floatx_op_assign(*)
+    _define_floatx_op_assign(/)
+#undef _define_floatx_op_assign
+
+    template<int N>
+    inline floatx<N> operator-(const floatx<N> &a)
+    { return floatx<N>(0.f) - a; }
+
+    template<int N>
+    inline floatx<N> min(const floatx<N> &a, const floatx<N> &b)
+    { floatx<N> r; for (int i=0;i<N;i++) r.set(i,a[i] < b[i] ? a[i] : b[i]); return r; }
+
+    template<int N>
+    inline floatx<N> max(const floatx<N> &a, const floatx<N> &b)
+    { floatx<N> r; for (int i=0;i<N;i++) r.set(i,a[i] > b[i] ? a[i] : b[i]); return r; }
+
+    template<int N>
+    inline floatx<N> abs(const floatx<N> &a)
+    { floatx<N> r; for (int i=0;i<N;i++) r.set(i,fabsf(a[i])); return r; }
+
+    template<int N>
+    inline floatx<N> sqrt(const floatx<N> &a)
+    { floatx<N> r; for (int i=0;i<N;i++) r.set(i,sqrtf(a[i])); return r; }
+
+    template<int N>
+    inline floatx<N> rcp(const floatx<N> &a)
+    { return floatx<N>(1.f) / a; }
+
+    template<int N>
+    inline floatx<N> madd(const floatx<N> &a, const floatx<N> &b, const floatx<N> &c)
+    { return a*b+c; }
+
+    /*! per lane: mask ? a : b */
+    template<int N>
+    inline floatx<N> select(const boolx<N> &mask, const floatx<N> &a, const floatx<N> &b)
+    { floatx<N> r; for (int i=0;i<N;i++) r.set(i,mask[i] ? a[i] : b[i]); return r; }
+
+    template<int N>
+    inline float reduce_min(const floatx<N> &a)
+    { float r = a[0]; for (int i=1;i<N;i++) r = a[i] < r ? a[i] : r; return r; }
+
+    template<int N>
+    inline float reduce_max(const floatx<N> &a)
+    { float r = a[0]; for (int i=1;i<N;i++) r = a[i] > r ? a[i] : r; return r; }
+
+    template<int N>
+    inline float reduce_add(const floatx<N> &a)
+    { float r = a[0]; for (int i=1;i<N;i++) r += a[i]; return r; }
+
+    template<int N>
+    inline boolx<N> operator&(const boolx<N> &a, const boolx<N> &b)
+    { boolx<N> r; for (int i=0;i<N;i++) r.set(i,a[i] && b[i]); return r; }
+
+    template<int N>
+    inline boolx<N> operator|(const boolx<N> &a, const boolx<N> &b)
+    { boolx<N> r; for (int i=0;i<N;i++) r.set(i,a[i] || b[i]); return r; }
+
+    template<int N>
+    inline boolx<N> operator!(const boolx<N> &a)
+    { boolx<N> r; for (int i=0;i<N;i++) r.set(i,!a[i]); return r; }
+
+    /*! bit i is set iff lane i is true */
+    template<int N>
+    inline int movemask(const boolx<N> &a)
+    { int r = 0; for (int i=0;i<N;i++) if (a[i]) r |= (1<<i); return r; }
+
+    template<int N>
+    inline bool any(const boolx<N> &a) { return movemask(a) != 0; }
+    template<int N>
+    inline bool all(const boolx<N> &a) { return movemask(a) == (1<<N)-1; }
+    template<int N>
+    inline bool none(const boolx<N> &a) { return movemask(a) == 0; }
+
+    // =======================================================
+    // SSE versions of floatx<4>/boolx<4>
+    // =======================================================
+#if OWL_HAVE_SSE
+    template<>
+    struct boolx<4> {
+      enum { numLanes = 4 };
+      inline boolx() = default;
+      inline boolx(__m128 m) : v(m) {}
+      inline boolx(bool b) : v(_mm_castsi128_ps(_mm_set1_epi32(b ? -1 : 0))) {}
+      inline bool operator[](int i) const { return (_mm_movemask_ps(v) >> i) & 1; }
+      inline void set(int i, bool b)
+      { ((int32_t*)&v)[i] = b ? -1 : 0; }
+      __m128 v;
+    };
+
+    template<>
+    struct floatx<4> {
+      enum { numLanes = 4 };
+      inline floatx() = default;
+      inline floatx(__m128 m) : v(m) {}
+      inline floatx(float f) : v(_mm_set1_ps(f)) {}
+
+      static inline floatx load(const float *ptr) { return _mm_loadu_ps(ptr); }
+      static inline floatx gather(const float *base, const int32_t *indices)
+      { return _mm_setr_ps(base[indices[0]],base[indices[1]],
+                           base[indices[2]],base[indices[3]]); }
+      inline void store(float *ptr) const { _mm_storeu_ps(ptr,v); }
+
+      inline float operator[](int i) const { return ((const float*)&v)[i]; }
+      inline void  set(int i, float f) { ((float*)&v)[i] = f; }
+      __m128 v;
+    };
+
+    inline floatx<4> operator+(const floatx<4> &a, const floatx<4> &b) { return _mm_add_ps(a.v,b.v); }
+    inline floatx<4> operator-(const floatx<4> &a, const floatx<4> &b) { return _mm_sub_ps(a.v,b.v); }
+    inline floatx<4> operator*(const floatx<4> &a, const floatx<4> &b) { return _mm_mul_ps(a.v,b.v); }
+    inline floatx<4> operator/(const floatx<4> &a, const floatx<4> &b) { return _mm_div_ps(a.v,b.v); }
+    inline boolx<4>  operator< (const floatx<4> &a, const floatx<4> &b) { return _mm_cmplt_ps(a.v,b.v); }
+    inline boolx<4>  operator<=(const floatx<4> &a, const floatx<4> &b) { return _mm_cmple_ps(a.v,b.v); }
+    inline boolx<4>  operator> (const floatx<4> &a, const floatx<4> &b) { return _mm_cmpgt_ps(a.v,b.v); }
+    inline boolx<4>  operator>=(const floatx<4> &a, const floatx<4> &b) { return _mm_cmpge_ps(a.v,b.v); }
+    inline boolx<4>  operator==(const floatx<4> &a, const floatx<4> &b) { return _mm_cmpeq_ps(a.v,b.v); }
+    inline boolx<4>  operator!=(const floatx<4> &a, const floatx<4> &b) { return _mm_cmpneq_ps(a.v,b.v); }
+    /* operand order matters: minps/maxps return their second operand
+       if the values compare equal or either is NaN - exactly like the
+       generic a<b?a:b */
+    inline floatx<4> min(const floatx<4> &a, const floatx<4> &b) { return _mm_min_ps(a.v,b.v); }
+    inline floatx<4> max(const floatx<4> &a, const floatx<4> &b) { return _mm_max_ps(a.v,b.v); }
+    inline floatx<4> sqrt(const floatx<4> &a) { return _mm_sqrt_ps(a.v); }
+    inline floatx<4> abs(const floatx<4> &a)
+    { return _mm_and_ps(a.v,_mm_castsi128_ps(_mm_set1_epi32(0x7fffffff))); }
+    inline floatx<4> select(const boolx<4> &m, const floatx<4> &a, const floatx<4> &b)
+    { return _mm_or_ps(_mm_and_ps(m.v,a.v),_mm_andnot_ps(m.v,b.v)); }
+    inline boolx<4>  operator&(const boolx<4> &a, const boolx<4> &b) { return _mm_and_ps(a.v,b.v); }
+    inline boolx<4>  operator|(const boolx<4> &a, const boolx<4> &b) { return _mm_or_ps(a.v,b.v); }
+    inline boolx<4>  operator!(const boolx<4> &a)
+    { return _mm_xor_ps(a.v,_mm_castsi128_ps(_mm_set1_epi32(-1))); }
+    inline int       movemask(const boolx<4> &a) { return _mm_movemask_ps(a.v); }
+#endif
+
+    // =======================================================
+    // AVX versions of floatx<8>/boolx<8>
+    // =======================================================
+#if OWL_HAVE_AVX
+    template<>
+    struct boolx<8> {
+      enum { numLanes = 8 };
+      inline boolx() = default;
+      inline boolx(__m256 m) : v(m) {}
+      inline boolx(bool b) : v(_mm256_castsi256_ps(_mm256_set1_epi32(b ? -1 : 0))) {}
+      inline bool operator[](int i) const { return (_mm256_movemask_ps(v) >> i) & 1; }
+      inline void set(int i, bool b)
+      { ((int32_t*)&v)[i] = b ? -1 : 0; }
+      __m256 v;
+    };
+
+    template<>
+    struct floatx<8> {
+      enum { numLanes = 8 };
+      inline floatx() = default;
+      inline floatx(__m256 m) : v(m) {}
+      inline floatx(float f) : v(_mm256_set1_ps(f)) {}
+
+      static inline floatx load(const float *ptr) { return _mm256_loadu_ps(ptr); }
+      static inline floatx gather(const float *base, const int32_t *indices)
+      {
+# if OWL_HAVE_AVX2
+        return _mm256_i32gather_ps(base,_mm256_loadu_si256((const __m256i*)indices),4);
+# else
+        return _mm256_setr_ps(base[indices[0]],base[indices[1]],
+                              base[indices[2]],base[indices[3]],
+                              base[indices[4]],base[indices[5]],
+                              base[indices[6]],base[indices[7]]);
+# endif
+      }
+      inline void store(float *ptr) const { _mm256_storeu_ps(ptr,v); }
+
+      inline float operator[](int i) const { return ((const float*)&v)[i]; }
+      inline void  set(int i, float f) { ((float*)&v)[i] = f; }
+      __m256 v;
+    };
+
+    inline floatx<8> operator+(const floatx<8> &a, const floatx<8> &b) { return _mm256_add_ps(a.v,b.v); }
+    inline floatx<8> operator-(const floatx<8> &a, const floatx<8> &b) { return _mm256_sub_ps(a.v,b.v); }
+    inline floatx<8> operator*(const floatx<8> &a, const floatx<8> &b) { return _mm256_mul_ps(a.v,b.v); }
+    inline floatx<8> operator/(const floatx<8> &a, const floatx<8> &b) { return _mm256_div_ps(a.v,b.v); }
+    inline boolx<8>  operator< (const floatx<8> &a, const floatx<8> &b) { return _mm256_cmp_ps(a.v,b.v,_CMP_LT_OQ); }
+    inline boolx<8>  operator<=(const floatx<8> &a, const floatx<8> &b) { return _mm256_cmp_ps(a.v,b.v,_CMP_LE_OQ); }
+    inline boolx<8>  operator> (const floatx<8> &a, const floatx<8> &b) { return _mm256_cmp_ps(a.v,b.v,_CMP_GT_OQ); }
+    inline boolx<8>  operator>=(const floatx<8> &a, const floatx<8> &b) { return _mm256_cmp_ps(a.v,b.v,_CMP_GE_OQ); }
+    inline boolx<8>  operator==(const floatx<8> &a, const floatx<8> &b) { return _mm256_cmp_ps(a.v,b.v,_CMP_EQ_OQ); }
+    inline boolx<8>  operator!=(const floatx<8> &a, const floatx<8> &b) { return _mm256_cmp_ps(a.v,b.v,_CMP_NEQ_UQ); }
+    inline floatx<8> min(const floatx<8> &a, const floatx<8> &b) { return _mm256_min_ps(a.v,b.v); }
+    inline floatx<8> max(const floatx<8> &a, const floatx<8> &b) { return _mm256_max_ps(a.v,b.v); }
+    inline floatx<8> sqrt(const floatx<8> &a) { return _mm256_sqrt_ps(a.v); }
+    inline floatx<8> abs(const floatx<8> &a)
+    { return _mm256_and_ps(a.v,_mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff))); }
+    inline floatx<8> select(const boolx<8> &m, const floatx<8> &a, const floatx<8> &b)
+    { return _mm256_blendv_ps(b.v,a.v,m.v); }
+    inline boolx<8>  operator&(const boolx<8> &a, const boolx<8> &b) { return _mm256_and_ps(a.v,b.v); }
+    inline boolx<8>  operator|(const boolx<8> &a, const boolx<8> &b) { return _mm256_or_ps(a.v,b.v); }
+    inline boolx<8>  operator!(const boolx<8> &a)
+    { return _mm256_xor_ps(a.v,_mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+    inline int       movemask(const boolx<8> &a) { return _mm256_movemask_ps(a.v); }
+#endif
+
+    typedef floatx<4> floatx4;
+    typedef floatx<8> floatx8;
+    typedef boolx<4>  boolx4;
+    typedef boolx<8>  boolx8;
+
+  } // ::owl::common
+} // ::owl
@@ -0,0 +1,373 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file vec3fx.h SoA ("packet") versions of vec3f, box3f, and
+    affine3f, with N lanes each: a vec3fx8 is eight vec3fs, stored as
+    three floatx<8>s. Same vocabulary as the scalar types (dot, cross,
+    min/max, any_less_than, xfmPoint, ...), except that everything
+    works per lane, and that everything that would return a bool
+    returns a boolx<N>. Loading from and storing to AoS arrays
+    (vec3f*, box3f*, ...) transposes, which can easily cost more than
+    the packet math saves; code that wants the speedup keeps its data
+    in SoA layout, and builds packets from floatx<N>::load()s */
+
+#include "owl/common/math/packet/floatx.h"
+#include "owl/common/math/box.h"
+#include "owl/common/math/AffineSpace.h"
+
+namespace owl {
+  namespace common {
+
+    // =======================================================
+    // vec3fx
+    // =======================================================
+
+    template<int N>
+    struct vec3fx_t {
+      enum { numLanes = N };
+      typedef floatx<N> scalar_t;
+
+      inline vec3fx_t() = default;
+      inline vec3fx_t(const floatx<N> &x, const floatx<N> &y, const floatx<N> &z)
+        : x(x), y(y), z(z)
+      {}
+      /*! broadcast the same vec3f to all lanes */
+      inline vec3fx_t(const vec3f &v) : x(v.x), y(v.y), z(v.z) {}
+      inline explicit vec3fx_t(const floatx<N> &f) : x(f), y(f), z(f) {}
+
+      /*! load N consecutive vec3fs from an AoS array */
+      static inline vec3fx_t load(const vec3f *aos)
+      { return loadStrided(aos,sizeof(vec3f)); }
+
+      /*! load N vec3fs from an AoS array with given stride (in bytes)
+          between them, similar to how vertex arrays are specified
+          (ie, lane i reads from (const uint8_t*)base+i*stride) */
+      static inline vec3fx_t loadStrided(const void *base, size_t stride)
+      {
+        /* transpose through memory rather than inserting lane by
+           lane - much cheaper for wide packets */
+        float xs[N], ys[N], zs[N];
+        const uint8_t *ptr = (const uint8_t *)base;
+        for (int i=0;i<N;i++,ptr+=stride) {
+          const vec3f &v = *(const vec3f*)ptr;
+          xs[i] = v.x; ys[i] = v.y; zs[i] = v.z;
+        }
+        return vec3fx_t(floatx<N>::load(xs),floatx<N>::load(ys),floatx<N>::load(zs));
+      }
+
+      /*! load lane i from aos[indices[i]] */
+      static inline vec3fx_t gather(const vec3f *aos, const int32_t *indices)
+      {
+        int32_t scaled[N];
+        for (int i=0;i<N;i++) scaled[i] = 3*indices[i];
+        const float *base = (const float *)aos;
+        return vec3fx_t(floatx<N>::gather(base+0,scaled),
+                        floatx<N>::gather(base+1,scaled),
+                        floatx<N>::gather(base+2,scaled));
+      }
+
+      /*! store to N consecutive vec3fs of an AoS array */
+      inline void store(vec3f *aos) const
+      {
+        float xs[N], ys[N], zs[N];
+        x.store(xs); y.store(ys); z.store(zs);
+        for (int i=0;i<N;i++) aos[i] = vec3f(xs[i],ys[i],zs[i]);
+      }
+
+      /*! write lane i to aos[indices[i]] */
+      inline void scatter(vec3f *aos, const int32_t *indices) const
+      { for (int i=0;i<N;i++) aos[indices[i]] = get(i); }
+
+      inline vec3f get(int i) const { return vec3f(x[i],y[i],z[i]); }
+      inline void  set(int i, const vec3f &v) { x.set(i,v.x); y.set(i,v.y); z.set(i,v.z); }
+
+      floatx<N> x, y, z;
+    };
+
+#define _define_vec3fx_binary_op(op)                                    \
+    template<int N>                                                     \
+    inline vec3fx_t<N> operator op(const vec3fx_t<N> &a, const vec3fx_t<N> &b) \
+    { return vec3fx_t<N>(a.x op b.x, a.y op b.y, a.z op b.z); }         \
+    template<int N>                                                     \
+    inline vec3fx_t<N> operator op(const vec3fx_t<N> &a, const floatx<N> &b) \
+    { return vec3fx_t<N>(a.x op b, a.y op b, a.z op b); }               \
+    template<int N>                                                     \
+    inline vec3fx_t<N> operator op(const floatx<N> &a, const vec3fx_t<N> &b) \
+    { return vec3fx_t<N>(a op b.x, a op b.y, a op b.z); }               \
+    template<int N>                                                     \
+    inline vec3fx_t<N> operator op(const vec3fx_t<N> &a, const float b) \
+    { return a op floatx<N>(b); }                                       \
+    template<int N>                                                     \
+    inline vec3fx_t<N> operator op(const float a, const vec3fx_t<N> &b) \
+    { return floatx<N>(a) op b; }                                       \
+    template<int N>                                                     \
+    inline vec3fx_t<N> &operator op##=(vec3fx_t<N> &a, const vec3fx_t<N> &b) \
+    { a = a op b; return a; }
+
+    _define_vec3fx_binary_op(+)
+    _define_vec3fx_binary_op(-)
+    _define_vec3fx_binary_op(*)
+    _define_vec3fx_binary_op(/)
+#undef _define_vec3fx_binary_op
+
+    template<int N>
+    inline vec3fx_t<N> operator-(const vec3fx_t<N> &a)
+    { return vec3fx_t<N>(-a.x,-a.y,-a.z); }
+
+#define _define_vec3fx_functor(fct)                                     \
+    template<int N>                                                     \
+    inline vec3fx_t<N> fct(const vec3fx_t<N> &a, const vec3fx_t<N> &b) \
+    { return vec3fx_t<N>(fct(a.x,b.x),fct(a.y,b.y),fct(a.z,b.z)); }
+
+    _define_vec3fx_functor(min)
+    _define_vec3fx_functor(max)
+#undef _define_vec3fx_functor
+
+    template<int N>
+    inline vec3fx_t<N> abs(const vec3fx_t<N> &a)
+    { return vec3fx_t<N>(abs(a.x),abs(a.y),abs(a.z)); }
+
+    template<int N>
+    inline vec3fx_t<N> rcp(const vec3fx_t<N> &a)
+    { return vec3fx_t<N>(rcp(a.x),rcp(a.y),rcp(a.z)); }
+
+    template<int N>
+    inline vec3fx_t<N> madd(const vec3fx_t<N> &a, const vec3fx_t<N> &b, const vec3fx_t<N> &c)
+    { return a*b+c; }
+
+    template<int N>
+    inline floatx<N> dot(const vec3fx_t<N> &a, const vec3fx_t<N> &b)
+    { return a.x*b.x + a.y*b.y + a.z*b.z; }
+
+    template<int N>
+    inline vec3fx_t<N> cross(const vec3fx_t<N> &a, const vec3fx_t<N> &b)
+    {
+      return vec3fx_t<N>(a.y*b.z-b.y*a.z,
+                         a.z*b.x-b.z*a.x,
+                         a.x*b.y-b.x*a.y);
+    }
+
+    template<int N>
+    inline floatx<N> length(const vec3fx_t<N> &a)
+    { return sqrt(dot(a,a)); }
+
+    template<int N>
+    inline vec3fx_t<N> normalize(const vec3fx_t<N> &a)
+    { return a * (1.f/length(a)); }
+
+    /*! per lane: mask ? a : b */
+    template<int N>
+    inline vec3fx_t<N> select(const boolx<N> &mask, const vec3fx_t<N> &a, const vec3fx_t<N> &b)
+    { return vec3fx_t<N>(select(mask,a.x,b.x),select(mask,a.y,b.y),select(mask,a.z,b.z)); }
+
+    template<int N>
+    inline floatx<N> reduce_min(const vec3fx_t<N> &v) { return min(min(v.x,v.y),v.z); }
+    template<int N>
+    inline floatx<N> reduce_max(const vec3fx_t<N> &v) { return max(max(v.x,v.y),v.z); }
+
+    template<int N>
+    inline boolx<N> any_less_than(const vec3fx_t<N> &a, const vec3fx_t<N> &b)
+    { return (a.x < b.x) | (a.y < b.y) | (a.z < b.z); }
+
+    template<int N>
+    inline boolx<N> all_less_than(const vec3fx_t<N> &a, const vec3fx_t<N> &b)
+    { return (a.x < b.x) & (a.y < b.y) & (a.z < b.z); }
+
+    template<int N>
+    inline boolx<N> any_greater_than(const vec3fx_t<N> &a, const vec3fx_t<N> &b)
+    { return (a.x > b.x) | (a.y > b.y) | (a.z > b.z); }
+
+    template<int N>
+    inline boolx<N> any_greater_or_equal(const vec3fx_t<N> &a, const vec3fx_t<N> &b)
+    { return (a.x >= b.x) | (a.y >= b.y) | (a.z >= b.z); }
+
+    /*! horizontal min over all lanes, per component */
+    template<int N>
+    inline vec3f reduce_lanes_min(const vec3fx_t<N> &v)
+    { return vec3f(reduce_min(v.x),reduce_min(v.y),reduce_min(v.z)); }
+
+    /*! horizontal max over all lanes, per component */
+    template<int N>
+    inline vec3f reduce_lanes_max(const vec3fx_t<N> &v)
+    { return vec3f(reduce_max(v.x),reduce_max(v.y),reduce_max(v.z)); }
+
+    // =======================================================
+    // box3fx
+    // =======================================================
+
+    template<int N>
+    struct box3fx_t {
+      enum { numLanes = N };
+
+      /*! N empty boxes */
+      inline box3fx_t()
+        : lower(vec3f(+std::numeric_limits<float>::infinity())),
+          upper(vec3f(-std::numeric_limits<float>::infinity()))
+      {}
+      inline box3fx_t(const vec3fx_t<N> &lower, const vec3fx_t<N> &upper)
+        : lower(lower), upper(upper)
+      {}
+      /*! broadcast the same box to all lanes */
+      inline box3fx_t(const box3f &b) : lower(b.lower), upper(b.upper) {}
+
+      /*! load N consecutive box3fs */
+      static inline box3fx_t load(const box3f *aos)
+      {
+        return box3fx_t(vec3fx_t<N>::loadStrided(&aos->lower,sizeof(box3f)),
+                        vec3fx_t<N>::loadStrided(&aos->upper,sizeof(box3f)));
+      }
+      /*! load lane i from aos[indices[i]] */
+      static inline box3fx_t gather(const box3f *aos, const int32_t *indices)
+      {
+        int32_t scaled[N];
+        for (int i=0;i<N;i++) scaled[i] = 2*indices[i];
+        const vec3f *base = (const vec3f *)aos;
+        return box3fx_t(vec3fx_t<N>::gather(base+0,scaled),
+                        vec3fx_t<N>::gather(base+1,scaled));
+      }
+      inline void store(box3f *aos) const
+      {
+        vec3f lo[N], hi[N];
+        lower.store(lo); upper.store(hi);
+        for (int i=0;i<N;i++) aos[i] = box3f(lo[i],hi[i]);
+      }
+      inline void scatter(box3f *aos, const int32_t *indices) const
+      { for (int i=0;i<N;i++) aos[indices[i]] = get(i); }
+
+      inline box3f get(int i) const { return box3f(lower.get(i),upper.get(i)); }
+      inline void  set(int i, const box3f &b) { lower.set(i,b.lower); upper.set(i,b.upper); }
+
+      inline box3fx_t &extend(const vec3fx_t<N> &v)
+      { lower = min(lower,v); upper = max(upper,v); return *this; }
+      inline box3fx_t &extend(const box3fx_t &b)
+      { lower = min(lower,b.lower); upper = max(upper,b.upper); return *this; }
+      inline box3fx_t including(const vec3fx_t<N> &v) const
+      { return box3fx_t(min(lower,v),max(upper,v)); }
+
+      inline vec3fx_t<N> center() const { return (lower+upper)*.5f; }
+      inline vec3fx_t<N> span()   const { return upper-lower; }
+      inline vec3fx_t<N> size()   const { return upper-lower; }
+
+      inline boolx<N> empty() const { return any_less_than(upper,lower); }
+      inline boolx<N> contains(const vec3fx_t<N> &point) const
+      { return !(any_less_than(point,lower) | any_greater_than(point,upper)); }
+      inline boolx<N> overlaps(const box3fx_t &other) const
+      { return !(any_less_than(other.upper,lower) | any_greater_than(other.lower,upper)); }
+
+      /*! the one box3f that contains all N lanes' boxes */
+      inline box3f reduce() const
+      { return box3f(reduce_lanes_min(lower),reduce_lanes_max(upper)); }
+
+      vec3fx_t<N> lower, upper;
+    };
+
+    template<int N>
+    inline floatx<N> area(const box3fx_t<N> &b)
+    {
+      const vec3fx_t<N> d = b.span();
+      return 2.f*(d.x*d.y+d.y*d.z+d.z*d.x);
+    }
+
+    template<int N>
+    inline box3fx_t<N> intersection(const box3fx_t<N> &a, const box3fx_t<N> &b)
+    { return box3fx_t<N>(max(a.lower,b.lower),min(a.upper,b.upper)); }
+
+    // =======================================================
+    // affine3fx
+    // =======================================================
+
+    template<int N>
+    struct affine3fx_t {
+      enum { numLanes = N };
+
+      inline affine3fx_t() = default;
+      /*! broadcast the same transform to all lanes */
+      inline affine3fx_t(const affine3f &a)
+        : vx(a.l.vx), vy(a.l.vy), vz(a.l.vz), p(a.p)
+      {}
+
+      /*! load N consecutive affine3fs */
+      static inline affine3fx_t load(const affine3f *aos)
+      {
+        affine3fx_t r;
+        r.vx = vec3fx_t<N>::loadStrided(&aos->l.vx,sizeof(affine3f));
+        r.vy = vec3fx_t<N>::loadStrided(&aos->l.vy,sizeof(affine3f));
+        r.vz = vec3fx_t<N>::loadStrided(&aos->l.vz,sizeof(affine3f));
+        r.p  = vec3fx_t<N>::loadStrided(&aos->p,   sizeof(affine3f));
+        return r;
+      }
+      /*! load lane i from aos[indices[i]] */
+      static inline affine3fx_t gather(const affine3f *aos, const int32_t *indices)
+      {
+        int32_t scaled[N];
+        for (int i=0;i<N;i++) scaled[i] = 4*indices[i];
+        const vec3f *base = (const vec3f *)aos;
+        affine3fx_t r;
+        r.vx = vec3fx_t<N>::gather(base+0,scaled);
+        r.vy = vec3fx_t<N>::gather(base+1,scaled);
+        r.vz = vec3fx_t<N>::gather(base+2,scaled);
+        r.p  = vec3fx_t<N>::gather(base+3,scaled);
+        return r;
+      }
+      inline void store(affine3f *aos) const
+      { for (int i=0;i<N;i++) aos[i] = get(i); }
+
+      inline affine3f get(int i) const
+      { return affine3f(vx.get(i),vy.get(i),vz.get(i),p.get(i)); }
+      inline void set(int i, const affine3f &a)
+      { vx.set(i,a.l.vx); vy.set(i,a.l.vy); vz.set(i,a.l.vz); p.set(i,a.p); }
+
+      /*! the three basis vectors of the linear part, and the
+          translation - same layout as affine3f */
+      vec3fx_t<N> vx, vy, vz, p;
+    };
+
+    template<int N>
+    inline vec3fx_t<N> xfmVector(const affine3fx_t<N> &m, const vec3fx_t<N> &v)
+    { return m.vx*v.x + m.vy*v.y + m.vz*v.z; }
+
+    template<int N>
+    inline vec3fx_t<N> xfmPoint(const affine3fx_t<N> &m, const vec3fx_t<N> &v)
+    { return m.vx*v.x + m.vy*v.y + m.vz*v.z + m.p; }
+
+    /*! bounds of the transformed box, per lane - same box as the
+        scalar xfmBounds (up to rounding), but computed from center
+        and half extents rather than from eight corners. Empty lanes
+        stay empty */
+    template<int N>
+    inline box3fx_t<N> xfmBounds(const affine3fx_t<N> &m, const box3fx_t<N> &b)
+    {
+      const vec3fx_t<N> c = xfmPoint(m,b.center());
+      const vec3fx_t<N> e = b.span()*.5f;
+      const vec3fx_t<N> d
+        = abs(m.vx)*e.x + abs(m.vy)*e.y + abs(m.vz)*e.z;
+      const box3fx_t<N> empty;
+      const boolx<N> isEmpty = b.empty();
+      return box3fx_t<N>(select(isEmpty,empty.lower,c-d),
+                         select(isEmpty,empty.upper,c+d));
+    }
+
+    typedef vec3fx_t<4>    vec3fx4;
+    typedef vec3fx_t<8>    vec3fx8;
+    typedef box3fx_t<4>    box3fx4;
+    typedef box3fx_t<8>    box3fx8;
+    typedef affine3fx_t<4> affine3fx4;
+    typedef affine3fx_t<8> affine3fx8;
+
+  } // ::owl::common
+} // ::owl
@@ -0,0 +1,247 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file DeviceTileBalancer.h sort-first load balancing of a frame
+    across multiple devices: the frame gets split into tiles, and
+    every frame each device gets a contiguous run of tiles (along a
+    Morton curve, so each device's share is a compact region rather
+    than scattered pixels) whose estimated cost matches that
+    device's estimated speed.
+
+    Both estimates come from what the previous frames measured: how
+    long each device took for its tiles, and - optionally - how that
+    time was distributed over its tiles (eg, clock64() cycles summed
+    per tile; any unit works, as long as it's proportional to time on
+    the device that measured it). Without per-tile measurements, all
+    of a device's time gets attributed to the cost of its tiles, and
+    device speeds stay as they are.
+
+    This is pure host logic, and fully deterministic: the same
+    sequence of measurements always produces the same assignments */
+
+#include "owl/common/arrayND/tiling.h"
+#include "owl/common/math/box.h"
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+
+namespace owl {
+  namespace common {
+
+    struct DeviceTileBalancer {
+      struct Config {
+        vec2i     tileSize  { 32,32 };
+        TileOrder order     { TILE_ORDER_MORTON };
+        /*! weight of a new frame's measurements vs what was estimated
+            before; lower is smoother, higher adapts faster */
+        double    smoothing { .5 };
+      };
+
+      /*! which tiles each device renders in a frame: device 'd' gets
+          tileIDs[begin[d]..begin[d+1]) */
+      struct Assignment {
+        std::vector<int> tileIDs;
+        std::vector<int> begin;
+
+        inline int numTiles(int deviceID) const
+        { return begin[deviceID+1]-begin[deviceID]; }
+      };
+
+      inline DeviceTileBalancer(int numDevices);
+      inline DeviceTileBalancer(int numDevices, const Config &config);
+
+      /*! starts over for a frame buffer of the given size; all tiles
+          are assumed equally expensive, and all devices equally
+          fast, until measured otherwise */
+      inline void resize(const vec2i &fbSize);
+
+      /*! the tiles each device should render in the next frame */
+      inline const Assignment &nextFrame();
+
+      /*! reports what the last frame returned by nextFrame()
+          measured: each device's time for its tiles, and (optional -
+          pass an empty vector if not available) one cost per tile,
+          indexed by tile ID */
+      inline void update(const std::vector<double> &deviceTimes,
+                         const std::vector<double> &tileCosts = {});
+
+      /*! the [begin,end) pixel range of a given tile */
+      inline box2i getTileRange(int tileID) const;
+
+      inline int   getNumTiles()   const { return (int)tileCost.size(); }
+      inline int   getNumDevices() const { return (int)deviceSpeed.size(); }
+      inline vec2i getNumTilesPerDim() const { return numTiles; }
+
+      /*! estimated relative speed of a device (in tile cost per
+          second). Note a device that is slow and one whose tiles are
+          expensive look the same, so this is only meaningful
+          together with the costs of that device's tiles */
+      inline double getDeviceSpeed(int deviceID) const { return deviceSpeed[deviceID]; }
+      /*! estimated relative cost of a tile; the average is 1 */
+      inline double getTileCost(int tileID) const { return tileCost[tileID]; }
+
+      const Config config;
+
+    private:
+      vec2i               fbSize   { 0,0 };
+      vec2i               numTiles { 0,0 };
+      /*! tile IDs in the order devices get them assigned */
+      std::vector<int>    order;
+      std::vector<double> tileCost;
+      std::vector<double> deviceSpeed;
+      Assignment          assignment;
+    };
+
+    // ------------------------------------------------------------------
+    // implementation section
+    // ------------------------------------------------------------------
+
+    inline DeviceTileBalancer::DeviceTileBalancer(int numDevices)
+      : DeviceTileBalancer(numDevices,Config())
+    {}
+
+    inline DeviceTileBalancer::DeviceTileBalancer(int numDevices,
+                                                  const Config &config)
+      : config(config),
+        deviceSpeed(numDevices,1.)
+    {
+      if (numDevices < 1)
+        throw std::runtime_error("DeviceTileBalancer needs at least one device");
+      if (config.tileSize.x < 1 || config.tileSize.y < 1)
+        throw std::runtime_error("DeviceTileBalancer: invalid tile size");
+    }
+
+    inline void DeviceTileBalancer::resize(const vec2i &fbSize)
+    {
+      this->fbSize = fbSize;
+      const Tiling2D tiling(fbSize,config.tileSize,config.order);
+      numTiles = tiling.numTiles;
+      order.clear();
+      for (size_t slot=0;slot<tiling.numSlots();slot++) {
+        vec2i tile;
+        if (tiling.getTile(slot,tile))
+          order.push_back(tile.x+numTiles.x*tile.y);
+      }
+      tileCost.assign(order.size(),1.);
+      std::fill(deviceSpeed.begin(),deviceSpeed.end(),1.);
+      assignment.tileIDs.clear();
+      assignment.begin.assign(deviceSpeed.size()+1,0);
+    }
+
+    /*! walks the tiles in order, and cuts that sequence wherever the
+        cost so far crosses the next device's share of the total
+        cost; a tile goes to the device that owns its center */
+    inline const DeviceTileBalancer::Assignment &DeviceTileBalancer::nextFrame()
+    {
+      const int numDevices = getNumDevices();
+      double totalCost = 0., totalSpeed = 0.;
+      for (auto c : tileCost) totalCost += c;
+      for (auto s : deviceSpeed) totalSpeed += s;
+
+      std::vector<double> cut(numDevices+1);
+      double speedSoFar = 0.;
+      for (int d=0;d<numDevices;d++) {
+        cut[d] = totalCost * speedSoFar / totalSpeed;
+        speedSoFar += deviceSpeed[d];
+      }
+      cut[numDevices] = totalCost;
+
+      assignment.tileIDs = order;
+      assignment.begin.assign(numDevices+1,(int)order.size());
+      assignment.begin[0] = 0;
+      double costSoFar = 0.;
+      int d = 0;
+      for (int i=0;i<(int)order.size();i++) {
+        const double c = tileCost[order[i]];
+        const double center = costSoFar + .5*c;
+        while (d < numDevices-1 && center >= cut[d+1])
+          assignment.begin[++d] = i;
+        costSoFar += c;
+      }
+      return assignment;
+    }
+
+    inline void DeviceTileBalancer::update(const std::vector<double> &deviceTimes,
+                                           const std::vector<double> &tileCosts)
+    {
+      const int numDevices = getNumDevices();
+      if ((int)deviceTimes.size() != numDevices)
+        throw std::runtime_error("DeviceTileBalancer::update: need one time per device");
+      if (!tileCosts.empty() && tileCosts.size() != tileCost.size())
+        throw std::runtime_error("DeviceTileBalancer::update: need one cost per tile");
+      const double alpha = config.smoothing;
+
+      for (int d=0;d<numDevices;d++) {
+        const int begin = assignment.begin[d], end = assignment.begin[d+1];
+        const double time = deviceTimes[d];
+        if (begin == end || !(time > 0.))
+          // nothing measured for this device; keep what we had
+          continue;
+
+        double estimatedCost = 0., measuredCost = 0.;
+        for (int i=begin;i<end;i++) {
+          const int tileID = assignment.tileIDs[i];
+          estimatedCost += tileCost[tileID];
+          if (!tileCosts.empty()) measuredCost += tileCosts[tileID];
+        }
+        if (!(measuredCost > 0.)) {
+          // no per-tile costs: a device being slow and its tiles being
+          // expensive look the same, so blame the tiles - their costs
+          // move along with them when the assignment changes, which
+          // keeps devices from taking turns at being the slowest one
+          const double scale = deviceSpeed[d]*time/estimatedCost;
+          for (int i=begin;i<end;i++) {
+            const int tileID = assignment.tileIDs[i];
+            tileCost[tileID]
+              = (1.-alpha)*tileCost[tileID] + alpha*scale*tileCost[tileID];
+          }
+          continue;
+        }
+        
+        deviceSpeed[d]
+          = (1.-alpha)*deviceSpeed[d] + alpha*estimatedCost/time;
+        // how long each tile took, in terms of the total device time,
+        // and thus how much it cost at this device's speed
+        const double scale = deviceSpeed[d]*time/measuredCost;
+        for (int i=begin;i<end;i++) {
+          const int tileID = assignment.tileIDs[i];
+          tileCost[tileID]
+            = (1.-alpha)*tileCost[tileID] + alpha*scale*tileCosts[tileID];
+        }
+      }
+
+      // costs and speeds are only relative to each other; keep them
+      // at an average tile cost of 1, so they can't drift off
+      double totalCost = 0.;
+      for (auto c : tileCost) totalCost += c;
+      if (totalCost > 0.) {
+        const double rcp = double(tileCost.size())/totalCost;
+        for (auto &c : tileCost) c *= rcp;
+        for (auto &s : deviceSpeed) s *= rcp;
+      }
+    }
+
+    inline box2i DeviceTileBalancer::getTileRange(int tileID) const
+    {
+      const vec2i tile(tileID % numTiles.x, tileID / numTiles.x);
+      const vec2i begin = tile*config.tileSize;
+      return box2i(begin,min(begin+config.tileSize,fbSize));
+    }
+
+  } // ::owl::common
+} // ::owl
@@ -0,0 +1,296 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file RayExchange.h ray forwarding between devices that each hold
+    only a part of the scene (see ScenePartitioner.h): a RayRouter
+    knows which region of space each device covers, and thus which
+    devices a ray has to visit, in which order; RayQueues carry rays
+    from the device that traced them to the one that has to trace
+    them next; and traceDataParallel() puts the two together into a
+    closest-hit query over the whole, distributed scene.
+
+    A ray first goes to the device whose region it enters first, and
+    gets traced against that device's part of the scene. After that
+    it goes on to the next device whose region it enters - but only
+    if it enters that region before the closest hit found so far -
+    and so on. Regions may overlap (pieces of the scene that straddle
+    a split plane), which is why this goes by where the ray *enters*
+    regions, not by where it leaves them.
+
+    Tracing itself is up to the caller - eg, one owl context per
+    device (each one created over just that device, and holding only
+    that device's part of the scene), with a raygen program that
+    traces a buffer of rays, as in samples/cmdline/s12-dataParallel -
+    so all of this is host-side bookkeeping, and can be tested with a
+    CPU tracer */
+
+#include "owl/common/math/box.h"
+#include "owl/common/parallel/parallel_for.h"
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+namespace owl {
+  namespace common {
+
+    /*! a ray to be traced on some device(s) */
+    struct RoutedRay {
+      vec3f org;
+      float tmin;
+      vec3f dir;
+      float tmax;
+    };
+
+    /*! result of tracing a RoutedRay: the closest hit, if any */
+    struct RoutedHit {
+      float t      { std::numeric_limits<float>::infinity() };
+      /*! whatever the tracer uses to identify what it hit; -1 for
+          'no hit' */
+      int   primID { -1 };
+      /*! device on which that hit was found */
+      int   deviceID { -1 };
+
+      inline bool hit() const { return primID >= 0; }
+    };
+
+    struct RayRouter {
+      /*! one step on a ray's way through the devices: the device, and
+          the distance at which the ray enters that device's region */
+      struct Hop {
+        float t;
+        int   deviceID;
+      };
+
+      /*! a router for devices covering the given regions; devices
+          with empty bounds never get any rays */
+      inline RayRouter(const std::vector<box3f> &deviceBounds)
+        : deviceBounds(deviceBounds)
+      {}
+
+      /*! all devices whose regions the ray overlaps, in the order it
+          enters them (ties by device ID) */
+      inline void route(const RoutedRay &ray, std::vector<Hop> &hops) const;
+
+      /*! index of the hop (in route()) that a ray has to go to after
+          having been traced up to (and including) 'hop', given the
+          closest hit it found so far; -1 if it's done. 'hop' may be
+          -1 for 'not traced anywhere yet' */
+      inline int nextHop(const std::vector<Hop> &hops, int hop, float tHit) const;
+
+      inline int getNumDevices() const { return (int)deviceBounds.size(); }
+
+      const std::vector<box3f> deviceBounds;
+    };
+
+    /*! per-device queues of items (such as rays) to be exchanged
+        between devices: while processing its inbox, device 'd' only
+        ever pushes into its own outboxes (so multiple devices can do
+        that in parallel), and exchange() then moves everything into
+        the destination devices' inboxes. Items arrive ordered by
+        source device, then by the order they got pushed in, so the
+        result doesn't depend on timing */
+    template<typename T>
+    struct RayQueues {
+      inline RayQueues(int numDevices)
+        : inboxes(numDevices), outboxes(numDevices*numDevices)
+      {}
+
+      inline void push(int fromDevice, int toDevice, const T &item)
+      { outboxes[fromDevice*getNumDevices()+toDevice].push_back(item); }
+
+      /*! replaces all inboxes with what got pushed to their devices
+          since the last exchange, and returns how many items that
+          are in total */
+      inline size_t exchange();
+
+      inline std::vector<T> &inbox(int deviceID) { return inboxes[deviceID]; }
+
+      /*! whether there's nothing in any inbox */
+      inline bool empty() const;
+
+      inline int getNumDevices() const { return (int)inboxes.size(); }
+
+    private:
+      std::vector<std::vector<T>> inboxes;
+      /*! [from*numDevices+to] */
+      std::vector<std::vector<T>> outboxes;
+    };
+
+    /*! a ray in a RayQueue: which ray it is, and how far along its
+        route it is; ray.tmax is the closest hit found so far */
+    struct QueuedRay {
+      RoutedRay ray;
+      int       rayID;
+      int       hop;
+    };
+
+    /*! what traceDataParallel() did */
+    struct RayExchangeStats {
+      /*! number of times any device got traced */
+      size_t numTraces   { 0 };
+      /*! number of rays traced, over all devices and rounds; the
+          difference to the number of rays is how many got
+          forwarded */
+      size_t numRayTraces { 0 };
+      /*! rounds of exchanging rays */
+      size_t numRounds   { 0 };
+    };
+
+    /*! computes the closest hit for every ray, for a scene that is
+        distributed across devices as described by the router. The
+        actual tracing gets done by
+
+          trace(int deviceID, const std::vector<QueuedRay> &rays,
+                std::vector<RoutedHit> &hits)
+
+        which has to find, for every ray, the closest hit in
+        [ray.tmin,ray.tmax] among the device's part of the scene, and
+        write it to the same index in 'hits' (which comes with the
+        right size, and all set to 'no hit'). Different devices'
+        trace() calls may run in parallel */
+    template<typename TraceLambda>
+    inline void traceDataParallel(const RayRouter &router,
+                                  const std::vector<RoutedRay> &rays,
+                                  std::vector<RoutedHit> &hits,
+                                  const TraceLambda &trace,
+                                  RayExchangeStats *stats = nullptr);
+
+    // ------------------------------------------------------------------
+    // implementation section
+    // ------------------------------------------------------------------
+
+    inline void RayRouter::route(const RoutedRay &ray, std::vector<Hop> &hops) const
+    {
+      hops.clear();
+      // (tiny instead of zero direction components, so rays along a
+      // region's face don't produce 0*inf)
+      const float eps = 1e-20f;
+      const vec3f rcp(1.f/(fabsf(ray.dir.x) > eps ? ray.dir.x : copysignf(eps,ray.dir.x)),
+                      1.f/(fabsf(ray.dir.y) > eps ? ray.dir.y : copysignf(eps,ray.dir.y)),
+                      1.f/(fabsf(ray.dir.z) > eps ? ray.dir.z : copysignf(eps,ray.dir.z)));
+      for (int d=0;d<(int)deviceBounds.size();d++) {
+        const box3f &box = deviceBounds[d];
+        if (box.empty()) continue;
+        const vec3f t_lo = (box.lower - ray.org) * rcp;
+        const vec3f t_hi = (box.upper - ray.org) * rcp;
+        const float t0 = max(ray.tmin,reduce_max(min(t_lo,t_hi)));
+        const float t1 = min(ray.tmax,reduce_min(max(t_lo,t_hi)));
+        if (t0 <= t1) hops.push_back({t0,d});
+      }
+      std::sort(hops.begin(),hops.end(),[](const Hop &a, const Hop &b){
+          return a.t < b.t || (a.t == b.t && a.deviceID < b.deviceID);
+        });
+    }
+
+    inline int RayRouter::nextHop(const std::vector<Hop> &hops, int hop, float tHit) const
+    {
+      const int next = hop+1;
+      return (next < (int)hops.size() && hops[next].t <= tHit) ? next : -1;
+    }
+
+    template<typename T>
+    inline size_t RayQueues<T>::exchange()
+    {
+      const int numDevices = getNumDevices();
+      size_t count = 0;
+      for (int to=0;to<numDevices;to++) {
+        std::vector<T> &inbox = inboxes[to];
+        inbox.clear();
+        for (int from=0;from<numDevices;from++) {
+          std::vector<T> &outbox = outboxes[from*numDevices+to];
+          inbox.insert(inbox.end(),outbox.begin(),outbox.end());
+          outbox.clear();
+        }
+        count += inbox.size();
+      }
+      return count;
+    }
+
+    template<typename T>
+    inline bool RayQueues<T>::empty() const
+    {
+      for (auto &inbox : inboxes)
+        if (!inbox.empty()) return false;
+      return true;
+    }
+
+    template<typename TraceLambda>
+    inline void traceDataParallel(const RayRouter &router,
+                                  const std::vector<RoutedRay> &rays,
+                                  std::vector<RoutedHit> &hits,
+                                  const TraceLambda &trace,
+                                  RayExchangeStats *stats)
+    {
+      const int numDevices = router.getNumDevices();
+      hits.assign(rays.size(),RoutedHit());
+      RayQueues<QueuedRay> queues(numDevices);
+
+      // every ray starts at the first device on its way; rays that
+      // don't overlap any device's region are done right away
+      std::vector<RayRouter::Hop> hops;
+      for (int rayID=0;rayID<(int)rays.size();rayID++) {
+        router.route(rays[rayID],hops);
+        if (hops.empty()) continue;
+        const int deviceID = hops[0].deviceID;
+        queues.push(deviceID,deviceID,QueuedRay{rays[rayID],rayID,0});
+      }
+      
+      size_t numInFlight = queues.exchange();
+      while (numInFlight) {
+        if (stats) {
+          stats->numRounds++;
+          stats->numRayTraces += numInFlight;
+        }
+        // note each ray is in exactly one inbox, so devices can
+        // update their rays' hits without getting in each other's way
+        std::vector<int> traced(numDevices,0);
+        parallel_for(numDevices,[&](int deviceID){
+            std::vector<QueuedRay> &inbox = queues.inbox(deviceID);
+            if (inbox.empty()) return;
+            traced[deviceID] = 1;
+            std::vector<RoutedHit> local(inbox.size());
+            trace(deviceID,(const std::vector<QueuedRay> &)inbox,local);
+
+            std::vector<RayRouter::Hop> hops;
+            for (size_t i=0;i<inbox.size();i++) {
+              QueuedRay q = inbox[i];
+              RoutedHit &hit = hits[q.rayID];
+              if (local[i].hit() && local[i].t < hit.t) {
+                hit = local[i];
+                hit.deviceID = deviceID;
+              }
+              // the route only depends on the original ray, so it's
+              // the same one every device computes
+              router.route(rays[q.rayID],hops);
+              const int next = router.nextHop(hops,q.hop,hit.t);
+              if (next < 0) continue;
+              q.hop = next;
+              q.ray.tmax = min(rays[q.rayID].tmax,hit.t);
+              queues.push(deviceID,hops[next].deviceID,q);
+            }
+          });
+        if (stats)
+          for (auto t : traced) stats->numTraces += t;
+        numInFlight = queues.exchange();
+      }
+    }
+    
+  } // ::owl::common
+} // ::owl
@@ -0,0 +1,258 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file ReplicationPlan.h how to get the same data onto every device
+    while moving it across the host's PCIe link as few times as
+    possible - ideally, once: one device
+    gets it from the host, and passes it on to others over peer
+    links, which pass it on further, along a tree. The data moves in
+    chunks, so all levels of the tree copy at the same time (each
+    device forwarding chunk i while receiving chunk i+1), and the
+    whole thing takes little longer than a single upload.
+
+    Devices that can't be reached over peer links from any device
+    with the data - or only over links so slow that another upload
+    from the host is faster - get their own upload, and become the
+    root of another tree. This is pure host logic, computed from a
+    (measured, queried, or - for testing - made up) description of
+    the machine's topology */
+
+#include "owl/common/owl-common.h"
+#include <algorithm>
+#include <vector>
+#include <stdexcept>
+
+namespace owl {
+  namespace common {
+
+    /*! how fast data moves from the host to each device, and between
+        devices; bandwidths are relative to each other (so any unit
+        works), with 0 meaning there is no (peer) path */
+    struct DeviceTopology {
+      inline DeviceTopology() {}
+      inline DeviceTopology(int numDevices,
+                            double hostBandwidth = 1.,
+                            double peerBandwidth = 0.);
+      
+      inline int numDevices() const { return (int)hostBandwidth.size(); }
+
+      /*! bandwidth of copies from device 'from' to device 'to' */
+      inline double &peer(int from, int to)
+      { return peerBandwidth[from*numDevices()+to]; }
+      inline double peer(int from, int to) const
+      { return peerBandwidth[from*numDevices()+to]; }
+
+      std::vector<double> hostBandwidth;
+      /*! row-major numDevices x numDevices matrix, one row per source
+          device; the diagonal is unused */
+      std::vector<double> peerBandwidth;
+    };
+
+    struct ReplicationPlan {
+      struct Config {
+        /*! max number of devices that copy from the same device; the
+            lower, the less those copies compete for the source's
+            links, but the deeper the tree gets */
+        int    maxFanout { 2 };
+        /*! granularity of the pipelining: smaller chunks let lower
+            levels of the tree start sooner, larger ones mean fewer
+            copies to issue */
+        size_t chunkSize { size_t(4) << 20 };
+      };
+      
+      /*! where each device gets its copy from: -1 for the host, else
+          the ID of the device it copies from */
+      std::vector<int> source;
+      /*! all devices, in an order in which every device comes after
+          its source */
+      std::vector<int> order;
+      /*! number of copies between the host and each device */
+      std::vector<int> depth;
+      size_t           chunkSize { size_t(4) << 20 };
+
+      inline int numDevices() const { return (int)source.size(); }
+      inline int numHostUploads() const
+      { return (int)std::count(source.begin(),source.end(),-1); }
+      inline size_t numChunks(size_t numBytes) const
+      { return (numBytes+chunkSize-1)/chunkSize; }
+
+      /*! estimated time for replicating 'numBytes' this way, assuming
+          every link has its own bandwidth, every device receives one
+          chunk at a time, and uploads from the host happen one at a
+          time (as they do from pageable memory). In whatever time
+          unit the topology's bandwidths imply */
+      inline double estimateTime(const DeviceTopology &topology,
+                                 size_t numBytes) const;
+    };
+
+    /*! the plan for replicating data across the given topology */
+    inline ReplicationPlan planReplication(const DeviceTopology &topology,
+                                           const ReplicationPlan::Config &config
+                                           = ReplicationPlan::Config());
+
+    /*! the plan without any peer copies - every device gets its own
+        upload from the host */
+    inline ReplicationPlan hostUploadPlan(int numDevices,
+                                          size_t chunkSize = size_t(4) << 20);
+    
+    // ------------------------------------------------------------------
+    // implementation section
+    // ------------------------------------------------------------------
+
+    inline DeviceTopology::DeviceTopology(int numDevices,
+                                          double hostBandwidth,
+                                          double peerBandwidth)
+      : hostBandwidth(numDevices,hostBandwidth),
+        peerBandwidth(size_t(numDevices)*numDevices,peerBandwidth)
+    {}
+    
+    inline double ReplicationPlan::estimateTime(const DeviceTopology &topology,
+                                                size_t numBytes) const
+    {
+      const int    numDevices = this->numDevices();
+      const size_t numChunks  = this->numChunks(numBytes);
+      std::vector<double> streamFree(numDevices,0.);
+      // when the current chunk has arrived on each device
+      std::vector<double> arrived(numDevices,0.);
+      double hostFree = 0.;
+      for (size_t chunk=0;chunk<numChunks;chunk++) {
+        const double size = double(std::min(chunkSize,numBytes-chunk*chunkSize));
+        for (int d : order) {
+          const int src = source[d];
+          double done;
+          if (src < 0) {
+            done = std::max(hostFree,streamFree[d]) + size/topology.hostBandwidth[d];
+            hostFree = done;
+          } else
+            done = std::max(streamFree[d],arrived[src]) + size/topology.peer(src,d);
+          streamFree[d] = arrived[d] = done;
+        }
+      }
+      double time = 0.;
+      for (auto t : streamFree) time = std::max(time,t);
+      return time;
+    }
+
+    inline ReplicationPlan hostUploadPlan(int numDevices, size_t chunkSize)
+    {
+      ReplicationPlan plan;
+      plan.chunkSize = chunkSize;
+      plan.source.assign(numDevices,-1);
+      plan.depth.assign(numDevices,1);
+      for (int d=0;d<numDevices;d++) plan.order.push_back(d);
+      return plan;
+    }
+    
+    inline ReplicationPlan planReplication(const DeviceTopology &topology,
+                                           const ReplicationPlan::Config &config)
+    {
+      const int numDevices = topology.numDevices();
+      if ((int)topology.peerBandwidth.size() != numDevices*numDevices)
+        throw std::runtime_error("planReplication: need one peer bandwidth per pair of devices");
+      if (config.maxFanout < 1 || config.chunkSize < 1)
+        throw std::runtime_error("planReplication: invalid config");
+      
+      ReplicationPlan plan;
+      plan.chunkSize = config.chunkSize;
+      plan.source.assign(numDevices,-1);
+      plan.depth.assign(numDevices,0);
+      std::vector<bool>   done(numDevices,false);
+      std::vector<int>    fanout(numDevices,0);
+      /*! bandwidth of the slowest link between host and device */
+      std::vector<double> width(numDevices,0.);
+      
+      while ((int)plan.order.size() < numDevices) {
+        // root of the next tree: the device closest to the host; among
+        // equally close ones, the one with the widest peer links to
+        // those still left
+        int root = -1;
+        double rootPeers = 0.;
+        for (int d=0;d<numDevices;d++) {
+          if (done[d]) continue;
+          double peers = 0.;
+          for (int e=0;e<numDevices;e++)
+            if (e != d && !done[e]) peers += topology.peer(d,e);
+          if (root < 0
+              || topology.hostBandwidth[d] > topology.hostBandwidth[root]
+              || (topology.hostBandwidth[d] == topology.hostBandwidth[root]
+                  && peers > rootPeers)) {
+            root = d;
+            rootPeers = peers;
+          }
+        }
+        done[root]        = true;
+        plan.source[root] = -1;
+        plan.depth[root]  = 1;
+        width[root]       = topology.hostBandwidth[root];
+        const size_t treeBegin = plan.order.size();
+        plan.order.push_back(root);
+
+        // grow the tree along the widest paths (ie, those whose
+        // slowest link is fastest), preferring shallower sources
+        while (1) {
+          int bestSrc = -1, bestDst = -1;
+          double bestWidth = 0.;
+          for (size_t i=treeBegin;i<plan.order.size();i++) {
+            const int src = plan.order[i];
+            if (fanout[src] >= config.maxFanout) continue;
+            for (int dst=0;dst<numDevices;dst++) {
+              if (done[dst] || !(topology.peer(src,dst) > 0.)) continue;
+              const double w = std::min(width[src],topology.peer(src,dst));
+              if (bestSrc < 0
+                  || w > bestWidth
+                  || (w == bestWidth && plan.depth[src] < plan.depth[bestSrc])) {
+                bestSrc = src; bestDst = dst; bestWidth = w;
+              }
+            }
+          }
+          if (bestSrc < 0) break;
+          done[bestDst]        = true;
+          plan.source[bestDst] = bestSrc;
+          plan.depth[bestDst]  = plan.depth[bestSrc]+1;
+          width[bestDst]       = bestWidth;
+          fanout[bestSrc]++;
+          plan.order.push_back(bestDst);
+        }
+      }
+
+      // a slow peer link can be worse than another upload from the
+      // host; give devices their own upload wherever that's faster
+      // (for a transfer long enough for pipelining to matter)
+      const size_t numBytes = 64*config.chunkSize;
+      double time = plan.estimateTime(topology,numBytes);
+      for (bool improved = true; improved; ) {
+        improved = false;
+        for (int d : plan.order) {
+          const int src = plan.source[d];
+          if (src < 0) continue;
+          plan.source[d] = -1;
+          const double newTime = plan.estimateTime(topology,numBytes);
+          if (newTime < time*(1.-1e-6)) {
+            time = newTime;
+            improved = true;
+          } else
+            plan.source[d] = src;
+        }
+      }
+      for (int d : plan.order)
+        plan.depth[d] = plan.source[d] < 0 ? 1 : plan.depth[plan.source[d]]+1;
+      return plan;
+    }
+    
+  } // ::owl::common
+} // ::owl
@@ -0,0 +1,184 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file ScenePartitioner.h data-parallel distribution of a scene
+    across multiple devices: instead of every device holding all of
+    the scene, the scene's pieces (eg, GeomGroups, or instances) get
+    split up such that every device holds only some of them, and the
+    largest scene that can be rendered is bounded by the sum of all
+    devices' memories rather than by the smallest one.
+
+    The split is a recursive bisection over the pieces' bounding box
+    centers: the devices get split into two halves, and the pieces
+    along the longest axis of their centers, such that each half of
+    the devices gets a share of the memory that's proportional to how
+    much memory these devices have. Each device thus ends up with a
+    spatially compact region of the scene, which is what keeps the
+    number of rays that have to visit multiple devices (see
+    RayExchange.h) low.
+
+    This is pure host logic, and fully deterministic */
+
+#include "owl/common/math/box.h"
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+
+namespace owl {
+  namespace common {
+
+    struct ScenePartition {
+      /*! the device that owns each piece of the scene */
+      std::vector<int>    owner;
+      /*! per device, the bounds of all the pieces it owns; empty if
+          it doesn't own any */
+      std::vector<box3f>  deviceBounds;
+      /*! per device, the memory used by all the pieces it owns */
+      std::vector<size_t> deviceBytes;
+
+      inline int getNumDevices() const { return (int)deviceBounds.size(); }
+
+      /*! the pieces owned by the given device, in ascending order */
+      inline std::vector<int> piecesOf(int deviceID) const;
+    };
+
+    /*! splits the pieces of a scene - each one with given bounds, and
+        using the given number of bytes of device memory - across
+        devices that have the given amounts of memory each. Devices
+        get as much as their share of the total memory, but no check
+        is made whether that actually fits: compare the resulting
+        deviceBytes with what the devices have (which, eg,
+        owlDeviceGetMemoryInfo() reports) */
+    inline ScenePartition partitionScene(const std::vector<box3f>  &pieceBounds,
+                                         const std::vector<size_t> &pieceBytes,
+                                         const std::vector<size_t> &deviceMemory);
+
+    /*! same, for devices that all have the same amount of memory */
+    inline ScenePartition partitionScene(const std::vector<box3f>  &pieceBounds,
+                                         const std::vector<size_t> &pieceBytes,
+                                         int numDevices);
+
+    // ------------------------------------------------------------------
+    // implementation section
+    // ------------------------------------------------------------------
+
+    inline std::vector<int> ScenePartition::piecesOf(int deviceID) const
+    {
+      std::vector<int> pieces;
+      for (int i=0;i<(int)owner.size();i++)
+        if (owner[i] == deviceID) pieces.push_back(i);
+      return pieces;
+    }
+
+    namespace detail {
+      /*! assigns pieces[begin..end) to devices [deviceBegin..deviceEnd) */
+      inline void bisectScene(const std::vector<box3f>  &pieceBounds,
+                              const std::vector<size_t> &pieceBytes,
+                              const std::vector<size_t> &deviceMemory,
+                              std::vector<int> &pieces,
+                              size_t begin, size_t end,
+                              int deviceBegin, int deviceEnd,
+                              std::vector<int> &owner)
+      {
+        if (deviceEnd-deviceBegin == 1) {
+          for (size_t i=begin;i<end;i++)
+            owner[pieces[i]] = deviceBegin;
+          return;
+        }
+        const int deviceMid = (deviceBegin+deviceEnd)/2;
+        double memLeft = 0., memRight = 0.;
+        for (int d=deviceBegin;d<deviceMid;d++) memLeft  += double(deviceMemory[d]);
+        for (int d=deviceMid;d<deviceEnd;d++)   memRight += double(deviceMemory[d]);
+
+        // sort along the longest axis of the centers; ties get
+        // broken by index, so the result doesn't depend on the sort
+        box3f centers;
+        for (size_t i=begin;i<end;i++)
+          centers.extend(pieceBounds[pieces[i]].center());
+        const int axis = centers.empty() ? 0 : arg_max(centers.size());
+        std::sort(pieces.begin()+begin,pieces.begin()+end,
+                  [&](int a, int b) {
+                    const float ca = pieceBounds[a].center()[axis];
+                    const float cb = pieceBounds[b].center()[axis];
+                    return ca < cb || (ca == cb && a < b);
+                  });
+
+        // a piece goes left if its 'center of mass' in the sorted
+        // order is within the left devices' share of the memory (if
+        // no piece uses any memory, count pieces instead)
+        double totalBytes = 0.;
+        for (size_t i=begin;i<end;i++) totalBytes += double(pieceBytes[pieces[i]]);
+        const bool byCount = !(totalBytes > 0.);
+        if (byCount) totalBytes = double(end-begin);
+        const double target = totalBytes * memLeft / (memLeft+memRight);
+        size_t mid = begin;
+        double bytesSoFar = 0.;
+        while (mid < end) {
+          const double bytes = byCount ? 1. : double(pieceBytes[pieces[mid]]);
+          if (bytesSoFar + .5*bytes > target) break;
+          bytesSoFar += bytes;
+          mid++;
+        }
+        bisectScene(pieceBounds,pieceBytes,deviceMemory,pieces,
+                    begin,mid,deviceBegin,deviceMid,owner);
+        bisectScene(pieceBounds,pieceBytes,deviceMemory,pieces,
+                    mid,end,deviceMid,deviceEnd,owner);
+      }
+    }
+    
+    inline ScenePartition partitionScene(const std::vector<box3f>  &pieceBounds,
+                                         const std::vector<size_t> &pieceBytes,
+                                         const std::vector<size_t> &deviceMemory)
+    {
+      if (pieceBounds.size() != pieceBytes.size())
+        throw std::runtime_error("partitionScene: need one size per piece");
+      if (deviceMemory.empty())
+        throw std::runtime_error("partitionScene: need at least one device");
+      double totalMemory = 0.;
+      for (auto m : deviceMemory) totalMemory += double(m);
+      if (!(totalMemory > 0.))
+        throw std::runtime_error("partitionScene: devices don't have any memory");
+      
+      const int numDevices = (int)deviceMemory.size();
+      ScenePartition partition;
+      partition.owner.resize(pieceBounds.size());
+      std::vector<int> pieces(pieceBounds.size());
+      for (size_t i=0;i<pieces.size();i++) pieces[i] = int(i);
+      detail::bisectScene(pieceBounds,pieceBytes,deviceMemory,pieces,
+                          0,pieces.size(),0,numDevices,partition.owner);
+
+      partition.deviceBounds.assign(numDevices,box3f());
+      partition.deviceBytes.assign(numDevices,0);
+      for (size_t i=0;i<pieceBounds.size();i++) {
+        const int d = partition.owner[i];
+        partition.deviceBounds[d].extend(pieceBounds[i]);
+        partition.deviceBytes[d] += pieceBytes[i];
+      }
+      return partition;
+    }
+
+    inline ScenePartition partitionScene(const std::vector<box3f>  &pieceBounds,
+                                         const std::vector<size_t> &pieceBytes,
+                                         int numDevices)
+    {
+      return partitionScene(pieceBounds,pieceBytes,
+                            std::vector<size_t>(std::max(numDevices,0),size_t(1)));
+    }
+    
+  } // ::owl::common
+} // ::owl
@@ -0,0 +1,145 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file SlotRing.h a fixed-size ring of 'slots' - eg, N copies of
+    some buffer - that get handed out in round-robin order to a
+    producer that submits asynchronous work reading from them (such
+    as a CUDA upload followed by a launch).
+
+    Every slot has a 'Fence' that the producer arms when it submits
+    work using that slot, and that signals once the slot may be
+    reused. Acquiring a slot whose fence has not signalled yet blocks
+    until it has, so at most N submissions can be in flight at any
+    time (ie, the producer gets back-pressure once the ring is full,
+    rather than overwriting data still in use).
+
+    The ring only tracks slot indices; the slots' actual data lives
+    wherever the user wants it. A 'Fence' is any default-constructible
+    and movable type with
+
+      bool isDone();  // non-blocking: has the fence signalled?
+      void wait();    // block until the fence has signalled
+
+    A SlotRing is NOT thread-safe - it is meant to be driven by the
+    one thread that submits the work. */
+
+#include <owl/common/owl-common.h>
+#include <vector>
+#include <stdexcept>
+
+namespace owl {
+  namespace common {
+
+    template<typename Fence>
+    struct SlotRing {
+      inline SlotRing(size_t numSlots = 1) { resize(numSlots); }
+
+      /*! changes the number of slots; waits for all slots in flight
+          first, and restarts at slot 0 */
+      inline void resize(size_t numSlots);
+
+      /*! returns the next slot in round-robin order, after first
+          waiting for that slot's previous use (if any) to complete.
+          The slot counts as free until submit() gets called on it */
+      inline size_t acquire();
+
+      /*! marks the given (just acquired) slot as being in flight; its
+          fence should have been armed before this gets called */
+      inline void submit(size_t slot);
+
+      /*! waits for all slots in flight, after which every slot is
+          free again */
+      inline void drain();
+
+      /*! the given slot's fence, for the producer to arm */
+      inline Fence &fence(size_t slot) { return fences[slot]; }
+
+      inline size_t numSlots() const { return fences.size(); }
+
+      /*! number of slots that have been submitted, and not yet been
+          found to be done */
+      inline size_t numInFlight() const;
+
+      /*! number of times acquire() had to block because the ring was
+          full - if that's frequent, more slots may help */
+      inline size_t numStalls() const { return stalls; }
+
+    private:
+      std::vector<Fence> fences;
+      std::vector<bool>  inFlight;
+      size_t             next   = 0;
+      size_t             stalls = 0;
+    };
+
+    // ------------------------------------------------------------------
+    // implementation section
+    // ------------------------------------------------------------------
+
+    template<typename Fence>
+    inline void SlotRing<Fence>::resize(size_t numSlots)
+    {
+      if (numSlots < 1)
+        throw std::runtime_error("SlotRing needs at least one slot");
+      drain();
+      fences = std::vector<Fence>(numSlots);
+      inFlight.assign(numSlots,false);
+      next = 0;
+    }
+
+    template<typename Fence>
+    inline size_t SlotRing<Fence>::acquire()
+    {
+      const size_t slot = next;
+      next = (next+1) % fences.size();
+      if (inFlight[slot]) {
+        if (!fences[slot].isDone()) {
+          stalls++;
+          fences[slot].wait();
+        }
+        inFlight[slot] = false;
+      }
+      return slot;
+    }
+
+    template<typename Fence>
+    inline void SlotRing<Fence>::submit(size_t slot)
+    {
+      assert(slot < fences.size());
+      inFlight[slot] = true;
+    }
+
+    template<typename Fence>
+    inline void SlotRing<Fence>::drain()
+    {
+      for (size_t slot=0;slot<inFlight.size();slot++)
+        if (inFlight[slot]) {
+          fences[slot].wait();
+          inFlight[slot] = false;
+        }
+    }
+
+    template<typename Fence>
+    inline size_t SlotRing<Fence>::numInFlight() const
+    {
+      size_t count = 0;
+      for (bool b : inFlight) count += b;
+      return count;
+    }
+
+  } // ::owl::common
+} // ::owl
@@ -0,0 +1,352 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file TaskSystem.h a small, built-in work-stealing thread pool
+    that backs owl::common::parallel_for and friends whenever TBB is
+    not available (see parallel_for.h; you usually don't want to use
+    this directly).
+
+    Every worker owns a deque of tasks: it pushes and pops its own
+    tasks at the back (so it works depth-first on what it just
+    spawned), while idle workers steal from the front of other
+    workers' deques (so they get the largest chunks of remaining
+    work). Threads that are not workers (such as the application's
+    main thread) share one more such deque. A thread that waits for a
+    TaskGroup keeps executing tasks until the group is done, so
+    parallel_for's can be nested arbitrarily without deadlocking, and
+    without oversubscribing the machine. */
+
+#include <owl/common/owl-common.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+namespace owl {
+  namespace common {
+
+    struct TaskGroup;
+
+    /*! abstract base class for a unit of work in the task system */
+    struct Task {
+      virtual ~Task() {}
+      virtual void execute() = 0;
+      /*! the group that this task belongs to, and that gets notified
+          when it is done */
+      TaskGroup *group = nullptr;
+    };
+
+    /*! a task that calls a given lambda */
+    template<typename Lambda>
+    struct LambdaTask : public Task {
+      LambdaTask(const Lambda &lambda) : lambda(lambda) {}
+      void execute() override { lambda(); }
+      Lambda lambda;
+    };
+
+    /*! the thread pool itself; there's only one (see get()) */
+    struct TaskSystem {
+      /*! returns the (lazily created) one and only task system. Its
+          number of threads defaults to the OWL_NUM_THREADS
+          environment variable if set, and to the number of hardware
+          threads otherwise */
+      static inline TaskSystem &get();
+
+      inline ~TaskSystem() { stopWorkers(); }
+
+      /*! total number of threads executing tasks, including the
+          thread waiting for them */
+      inline int getNumThreads() const { return numThreads; }
+
+      /*! (re-)start with the given number of threads (including the
+          calling one); 0 means 'number of hardware threads'. Must not
+          be called while any tasks are in flight, nor from within a
+          task */
+      inline void setNumThreads(int numThreads);
+
+      /*! schedule the given task for execution */
+      inline void spawn(Task *task);
+
+      /*! tries to find and execute one task; returns false if none
+          was found */
+      inline bool tryExecuteOneTask();
+
+    private:
+      struct WorkQueue {
+        std::mutex        mutex;
+        std::deque<Task*> tasks;
+      };
+
+      inline TaskSystem();
+      inline void startWorkers(int numThreads);
+      inline void stopWorkers();
+      inline void workerLoop(int workerID);
+      inline Task *findTask();
+      inline void  execute(Task *task);
+      inline void  wakeWorkers();
+
+      /*! index of the calling thread's own queue, or -1 if it is not
+          one of our workers */
+      static inline int &myWorkerID()
+      { static thread_local int workerID = -1; return workerID; }
+
+      int numThreads = 1;
+      /*! one queue per worker, plus one (the last) for tasks that
+          get spawned by any other thread */
+      std::vector<std::unique_ptr<WorkQueue>> queues;
+      std::vector<std::thread>                workers;
+
+      /*! sleeping machinery for idle workers: the epoch gets bumped
+          every time new work arrives */
+      std::mutex               sleepMutex;
+      std::condition_variable  sleepCond;
+      std::atomic<uint64_t>    workEpoch { 0 };
+      std::atomic<int>         numSleeping { 0 };
+      std::atomic<bool>        shutdown { false };
+    };
+
+    /*! a group of tasks that can be waited on as a whole; the first
+        exception thrown by any task gets re-thrown by wait() */
+    struct TaskGroup {
+      inline TaskGroup() = default;
+      /*! waits for all tasks, but - since this is a destructor -
+          silently drops any exception they may have thrown */
+      inline ~TaskGroup() { waitForTasks(); }
+
+      /*! schedule the given lambda for (possibly, parallel) execution */
+      template<typename Lambda>
+      inline void run(const Lambda &lambda);
+
+      /*! returns once all tasks of this group are done; keeps
+          executing tasks (of this or any other group) in the
+          meantime */
+      inline void wait();
+
+      /*! called by the task system once a task of ours is done */
+      inline void taskDone(std::exception_ptr exception);
+
+    private:
+      inline void waitForTasks();
+
+      std::atomic<int>   numPending { 0 };
+      std::mutex         exceptionMutex;
+      std::exception_ptr exception;
+    };
+
+    // ------------------------------------------------------------------
+    // implementation section
+    // ------------------------------------------------------------------
+
+    inline TaskSystem &TaskSystem::get()
+    {
+      static TaskSystem taskSystem;
+      return taskSystem;
+    }
+
+    inline TaskSystem::TaskSystem()
+    {
+      const char *fromEnv = getenv("OWL_NUM_THREADS");
+      startWorkers(fromEnv ? atoi(fromEnv) : 0);
+    }
+
+    inline void TaskSystem::setNumThreads(int numThreads)
+    {
+      stopWorkers();
+      startWorkers(numThreads);
+    }
+
+    inline void TaskSystem::startWorkers(int requested)
+    {
+      numThreads = requested > 0
+        ? requested
+        : std::max(1,(int)std::thread::hardware_concurrency());
+      const int numWorkers = numThreads-1;
+
+      shutdown = false;
+      queues.clear();
+      for (int i=0;i<=numWorkers;i++)
+        queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue));
+      for (int i=0;i<numWorkers;i++)
+        workers.push_back(std::thread([this,i](){ workerLoop(i); }));
+    }
+
+    inline void TaskSystem::stopWorkers()
+    {
+      {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        shutdown = true;
+      }
+      sleepCond.notify_all();
+      for (auto &worker : workers)
+        worker.join();
+      workers.clear();
+    }
+
+    inline void TaskSystem::spawn(Task *task)
+    {
+      if (workers.empty()) {
+        // nobody to share with - just do it right away
+        execute(task);
+        return;
+      }
+      const int workerID = myWorkerID();
+      WorkQueue &queue = *queues[workerID >= 0 ? workerID : workers.size()];
+      {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(task);
+      }
+      wakeWorkers();
+    }
+
+    inline void TaskSystem::wakeWorkers()
+    {
+      // sleeping workers first increment numSleeping, and then
+      // re-check the epoch; since we first bump the epoch and then
+      // check numSleeping, at least one of us sees the other's change
+      workEpoch++;
+      if (numSleeping.load() > 0) {
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        sleepCond.notify_one();
+      }
+    }
+
+    inline Task *TaskSystem::findTask()
+    {
+      // threads that are not workers treat the shared queue as their
+      // own; taking the *newest* task from that (rather than the
+      // oldest, as a thief would) matters for threads that wait: the
+      // oldest task is usually the biggest, and executing that one
+      // while waiting would make the stack grow with the size of the
+      // work, not with its nesting depth
+      const int numQueues = (int)queues.size();
+      const int workerID  = myWorkerID();
+      const int ownQueue  = workerID >= 0 ? workerID : numQueues-1;
+      {
+        WorkQueue &queue = *queues[ownQueue];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+          Task *task = queue.tasks.back();
+          queue.tasks.pop_back();
+          return task;
+        }
+      }
+      // otherwise, steal the oldest task from anybody else, starting
+      // at a random victim
+      static thread_local uint32_t seed = 0x12345678u;
+      seed = seed * 1664525u + 1013904223u;
+      const int firstVictim = int((seed >> 8) % numQueues);
+      for (int i=0;i<numQueues;i++) {
+        const int victim = (firstVictim+i) % numQueues;
+        if (victim == ownQueue) continue;
+        WorkQueue &queue = *queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+          Task *task = queue.tasks.front();
+          queue.tasks.pop_front();
+          return task;
+        }
+      }
+      return nullptr;
+    }
+
+    inline void TaskSystem::execute(Task *task)
+    {
+      std::exception_ptr exception;
+      try {
+        task->execute();
+      } catch (...) {
+        exception = std::current_exception();
+      }
+      TaskGroup *group = task->group;
+      delete task;
+      // the group may be gone right after this, so this has to be the
+      // very last thing we do with it
+      group->taskDone(exception);
+    }
+
+    inline bool TaskSystem::tryExecuteOneTask()
+    {
+      Task *task = findTask();
+      if (!task) return false;
+      execute(task);
+      return true;
+    }
+
+    inline void TaskSystem::workerLoop(int workerID)
+    {
+      myWorkerID() = workerID;
+      while (!shutdown) {
+        const uint64_t epoch = workEpoch.load();
+        if (tryExecuteOneTask())
+          continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        numSleeping++;
+        sleepCond.wait(lock,[&](){
+            return shutdown || workEpoch.load() != epoch;
+          });
+        numSleeping--;
+      }
+      myWorkerID() = -1;
+    }
+
+    template<typename Lambda>
+    inline void TaskGroup::run(const Lambda &lambda)
+    {
+      Task *task = new LambdaTask<Lambda>(lambda);
+      task->group = this;
+      numPending++;
+      TaskSystem::get().spawn(task);
+    }
+
+    inline void TaskGroup::taskDone(std::exception_ptr taskException)
+    {
+      if (taskException) {
+        std::lock_guard<std::mutex> lock(exceptionMutex);
+        if (!exception) exception = taskException;
+      }
+      numPending--;
+    }
+
+    inline void TaskGroup::waitForTasks()
+    {
+      TaskSystem &taskSystem = TaskSystem::get();
+      while (numPending.load() > 0)
+        if (!taskSystem.tryExecuteOneTask())
+          std::this_thread::yield();
+    }
+
+    inline void TaskGroup::wait()
+    {
+      waitForTasks();
+
+      std::lock_guard<std::mutex> lock(exceptionMutex);
+      if (exception) {
+        std::exception_ptr toThrow = exception;
+        exception = nullptr;
+        std::rethrow_exception(toThrow);
+      }
+    }
+
+  } // ::owl::common
+} // ::owl
@@ -0,0 +1,323 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file parallel_algorithms.h parallel versions of the std::
+    algorithms that host-side preprocessing code keeps re-writing:
+    prefix sums, (radix) sorting, and partitioning. All of them are
+    built on parallel_for (see parallel_for.h), so they run on TBB if
+    OWL was built with it, and on the built-in task system
+    otherwise. (For reductions, see parallel_reduce in
+    parallel_for.h) */
+
+#include "owl/common/parallel/parallel_for.h"
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <cstring>
+#if OWL_HAVE_TBB
+# include <tbb/parallel_sort.h>
+#endif
+
+namespace owl {
+  namespace common {
+
+    /*! writes out[i] = init + in[0] + ... + in[i-1] (using 'op'
+        instead of '+' if specified), and returns the sum of all
+        elements (plus init). 'in' and 'out' may be the same
+        array. Like parallel_reduce, the result is deterministic
+        (independent of the number of threads) */
+    template<typename T, typename OP = std::plus<T>>
+    inline T parallel_exclusive_scan(const T *in, T *out, size_t count,
+                                     T init = T(0), OP op = OP());
+
+    /*! sorts (in ascending order) an array of integer or floating
+        point keys, with a parallel LSD radix sort. Floats sort like
+        operator< would (with -0.f before +0.f, and NaNs at the ends) */
+    template<typename KEY>
+    inline void parallel_sort(KEY *keys, size_t count);
+
+    /*! sorts an array of integer or floating point keys, and the
+        values that go with them, by key; this sort is stable */
+    template<typename KEY, typename VALUE>
+    inline void parallel_sort_by_key(KEY *keys, VALUE *values, size_t count);
+
+    /*! sorts an array of arbitrary type, using the given comparison;
+        this sort is not stable */
+    template<typename T, typename LESS>
+    inline void parallel_sort(T *data, size_t count, const LESS &less);
+
+    /*! re-arranges the array such that all elements for which 'pred'
+        returns true come before those for which it returns false, and
+        returns the number of the former. Unlike std::partition, this
+        is stable (ie, like std::stable_partition). T has to be
+        default-constructible */
+    template<typename T, typename PRED>
+    inline size_t parallel_partition(T *data, size_t count, const PRED &pred);
+
+
+    // ------------------------------------------------------------------
+    // implementation section
+    // ------------------------------------------------------------------
+
+    /*! block size for all algorithms in this file; fixed (rather than
+        depending on the number of threads) so results are
+        deterministic */
+    enum { parallelAlgorithmsBlockSize = 64*1024 };
+
+    template<typename T, typename OP>
+    inline T parallel_exclusive_scan(const T *in, T *out, size_t count,
+                                     T init, OP op)
+    {
+      const size_t blockSize = parallelAlgorithmsBlockSize;
+      const size_t numBlocks = (count+blockSize-1)/blockSize;
+      if (numBlocks <= 1) {
+        T sum = init;
+        for (size_t i=0;i<count;i++) {
+          const T value = in[i];
+          out[i] = sum;
+          sum = op(sum,value);
+        }
+        return sum;
+      }
+
+      // pass 1: sum of each block
+      std::vector<T> blockSum(numBlocks);
+      parallel_for(numBlocks,[&](size_t blockID){
+          const size_t begin = blockID*blockSize;
+          const size_t end   = std::min(begin+blockSize,count);
+          T sum = in[begin];
+          for (size_t i=begin+1;i<end;i++) sum = op(sum,in[i]);
+          blockSum[blockID] = sum;
+        });
+      // serial scan over the blocks
+      T sum = init;
+      for (size_t blockID=0;blockID<numBlocks;blockID++) {
+        const T blockTotal = blockSum[blockID];
+        blockSum[blockID] = sum;
+        sum = op(sum,blockTotal);
+      }
+      // pass 2: scan each block, starting at its offset
+      parallel_for(numBlocks,[&](size_t blockID){
+          const size_t begin = blockID*blockSize;
+          const size_t end   = std::min(begin+blockSize,count);
+          T blockRunning = blockSum[blockID];
+          for (size_t i=begin;i<end;i++) {
+            const T value = in[i];
+            out[i] = blockRunning;
+            blockRunning = op(blockRunning,value);
+          }
+        });
+      return sum;
+    }
+
+    /*! maps keys to unsigned integers that sort the same way */
+    template<typename KEY, typename Enable = void>
+    struct RadixKeyTraits;
+
+    template<typename KEY>
+    struct RadixKeyTraits<KEY,typename std::enable_if<std::is_integral<KEY>::value>::type> {
+      typedef typename std::make_unsigned<KEY>::type bits_t;
+      static inline bits_t toBits(KEY key)
+      {
+        bits_t bits = bits_t(key);
+        if (std::is_signed<KEY>::value)
+          bits ^= bits_t(1) << (8*sizeof(KEY)-1);
+        return bits;
+      }
+    };
+
+    template<typename KEY>
+    struct RadixKeyTraits<KEY,typename std::enable_if<std::is_floating_point<KEY>::value>::type> {
+      typedef typename std::conditional<sizeof(KEY) == 4,uint32_t,uint64_t>::type bits_t;
+      static inline bits_t toBits(KEY key)
+      {
+        bits_t bits;
+        memcpy(&bits,&key,sizeof(bits));
+        const bits_t signBit = bits_t(1) << (8*sizeof(KEY)-1);
+        // negative numbers: flip all bits (so larger magnitudes come
+        // first); positive ones: only the sign bit
+        return (bits & signBit) ? ~bits : (bits ^ signBit);
+      }
+    };
+
+    /*! the actual radix sort; 'values' may be null, in which case
+        VALUE is ignored */
+    template<typename KEY, typename VALUE>
+    inline void parallel_radix_sort(KEY *keys, VALUE *values, size_t count)
+    {
+      typedef RadixKeyTraits<KEY> Traits;
+      const size_t blockSize = parallelAlgorithmsBlockSize;
+      const size_t numBlocks = (count+blockSize-1)/blockSize;
+      const int    numPasses = int(sizeof(KEY));
+
+      std::vector<KEY>   tmpKeys(count);
+      std::vector<VALUE> tmpValues(values ? count : 0);
+      KEY   *srcKeys = keys,   *dstKeys = tmpKeys.data();
+      VALUE *srcVals = values, *dstVals = tmpValues.data();
+
+      // per-block histograms, and (after the scan) per-block offsets
+      std::vector<size_t> offsets(numBlocks*256);
+      for (int pass=0;pass<numPasses;pass++) {
+        const int shift = 8*pass;
+        parallel_for(numBlocks,[&](size_t blockID){
+            size_t *histogram = offsets.data()+256*blockID;
+            std::fill(histogram,histogram+256,size_t(0));
+            const size_t begin = blockID*blockSize;
+            const size_t end   = std::min(begin+blockSize,count);
+            for (size_t i=begin;i<end;i++)
+              histogram[(Traits::toBits(srcKeys[i]) >> shift) & 0xff]++;
+          });
+
+        // if all keys have the same digit, this pass wouldn't change
+        // anything
+        bool allSame = false;
+        for (int digit=0;digit<256 && !allSame;digit++) {
+          size_t digitCount = 0;
+          for (size_t blockID=0;blockID<numBlocks;blockID++)
+            digitCount += offsets[256*blockID+digit];
+          if (digitCount == count) allSame = true;
+          else if (digitCount > 0) break;
+        }
+        if (allSame) continue;
+
+        // all blocks' counts of smaller digits, plus earlier blocks'
+        // counts of the same digit, is where a block writes a digit
+        size_t sum = 0;
+        for (int digit=0;digit<256;digit++)
+          for (size_t blockID=0;blockID<numBlocks;blockID++) {
+            const size_t blockCount = offsets[256*blockID+digit];
+            offsets[256*blockID+digit] = sum;
+            sum += blockCount;
+          }
+
+        parallel_for(numBlocks,[&](size_t blockID){
+            size_t *offset = offsets.data()+256*blockID;
+            const size_t begin = blockID*blockSize;
+            const size_t end   = std::min(begin+blockSize,count);
+            for (size_t i=begin;i<end;i++) {
+              const size_t out = offset[(Traits::toBits(srcKeys[i]) >> shift) & 0xff]++;
+              dstKeys[out] = srcKeys[i];
+              if (values) dstVals[out] = srcVals[i];
+            }
+          });
+        std::swap(srcKeys,dstKeys);
+        std::swap(srcVals,dstVals);
+      }
+
+      // odd number of passes done - result is in the temp arrays
+      if (srcKeys != keys) {
+        parallel_for_blocked(0,count,blockSize,[&](size_t begin, size_t end){
+            std::copy(srcKeys+begin,srcKeys+end,keys+begin);
+            if (values) std::copy(srcVals+begin,srcVals+end,values+begin);
+          });
+      }
+    }
+
+    template<typename KEY>
+    inline void parallel_sort(KEY *keys, size_t count)
+    {
+      static_assert(std::is_arithmetic<KEY>::value,
+                    "parallel_sort(keys,count) only works for integer or "
+                    "floating point keys; use the version with a comparison "
+                    "function for anything else");
+      if (count <= parallelAlgorithmsBlockSize) {
+        std::sort(keys,keys+count,[](KEY a, KEY b){
+            return RadixKeyTraits<KEY>::toBits(a) < RadixKeyTraits<KEY>::toBits(b);
+          });
+        return;
+      }
+      parallel_radix_sort(keys,(uint8_t*)nullptr,count);
+    }
+
+    template<typename KEY, typename VALUE>
+    inline void parallel_sort_by_key(KEY *keys, VALUE *values, size_t count)
+    {
+      static_assert(std::is_arithmetic<KEY>::value,
+                    "parallel_sort_by_key only works for integer or "
+                    "floating point keys");
+      parallel_radix_sort(keys,values,count);
+    }
+
+    template<typename T, typename LESS>
+    inline void parallel_sort(T *data, size_t count, const LESS &less)
+    {
+#if OWL_HAVE_TBB
+      tbb::parallel_sort(data,data+count,less);
+#else
+      // sort blocks in parallel, then merge pairs of sorted ranges
+      // (in parallel over the pairs) until there's only one left
+      const size_t blockSize = parallelAlgorithmsBlockSize;
+      const size_t numBlocks = (count+blockSize-1)/blockSize;
+      parallel_for(numBlocks,[&](size_t blockID){
+          const size_t begin = blockID*blockSize;
+          const size_t end   = std::min(begin+blockSize,count);
+          std::sort(data+begin,data+end,less);
+        });
+      for (size_t width=blockSize;width<count;width*=2) {
+        const size_t numPairs = (count+2*width-1)/(2*width);
+        parallel_for(numPairs,[&](size_t pairID){
+            const size_t begin = pairID*2*width;
+            const size_t mid   = std::min(begin+width,count);
+            const size_t end   = std::min(begin+2*width,count);
+            std::inplace_merge(data+begin,data+mid,data+end,less);
+          });
+      }
+#endif
+    }
+
+    template<typename T, typename PRED>
+    inline size_t parallel_partition(T *data, size_t count, const PRED &pred)
+    {
+      const size_t blockSize = parallelAlgorithmsBlockSize;
+      const size_t numBlocks = (count+blockSize-1)/blockSize;
+
+      // classify (once per element - pred may be expensive), and
+      // count per block
+      std::vector<uint8_t> selected(count);
+      std::vector<size_t>  numSelected(numBlocks);
+      parallel_for(numBlocks,[&](size_t blockID){
+          const size_t begin = blockID*blockSize;
+          const size_t end   = std::min(begin+blockSize,count);
+          size_t blockCount = 0;
+          for (size_t i=begin;i<end;i++)
+            blockCount += (selected[i] = pred(data[i]) ? 1 : 0);
+          numSelected[blockID] = blockCount;
+        });
+      std::vector<size_t> selectedOffset(numBlocks);
+      const size_t totalSelected
+        = parallel_exclusive_scan(numSelected.data(),selectedOffset.data(),
+                                  numBlocks);
+
+      // scatter into a temp array, then move back
+      std::vector<T> tmp(count);
+      parallel_for(numBlocks,[&](size_t blockID){
+          const size_t begin = blockID*blockSize;
+          const size_t end   = std::min(begin+blockSize,count);
+          size_t outSelected   = selectedOffset[blockID];
+          size_t outUnselected = totalSelected + begin - selectedOffset[blockID];
+          for (size_t i=begin;i<end;i++)
+            tmp[selected[i] ? outSelected++ : outUnselected++] = std::move(data[i]);
+        });
+      parallel_for_blocked(0,count,blockSize,[&](size_t begin, size_t end){
+          std::move(tmp.begin()+begin,tmp.begin()+end,data+begin);
+        });
+      return totalSelected;
+    }
+
+  } // ::owl::common
+} // ::owl
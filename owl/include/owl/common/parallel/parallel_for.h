@@ -19,6 +19,8 @@
 #include <owl/common/owl-common.h>
 // std
 #include <mutex>
+#include <vector>
+#include <memory>
 
 #ifdef OWL_DISABLE_TBB
 # undef OWL_HAVE_TBB
@@ -28,8 +30,13 @@
 #if OWL_HAVE_TBB
 #include <tbb/parallel_for.h>
 #include <tbb/task_arena.h>
-#define OWL_HAVE_PARALLEL_FOR 1
+#include <tbb/task_group.h>
+#include <tbb/global_control.h>
+#else
+// without TBB, everything runs on our own work-stealing thread pool
+#include "owl/common/parallel/TaskSystem.h"
 #endif
+#define OWL_HAVE_PARALLEL_FOR 1
 
 namespace owl {
   namespace common {
@@ -41,8 +48,57 @@ namespace owl {
         taskFunction(taskIndex);
       }
     }
-  
+
+    /*! sets the number of threads that parallel_for and friends may
+        use (including the calling thread); 0 means 'as many as there
+        are hardware threads'. Must not be called while any parallel
+        work is in flight */
+    inline void setNumThreads(int numThreads);
+
+    /*! returns the number of threads that parallel_for and friends
+        may use */
+    inline int getNumThreads();
+
 #if OWL_HAVE_TBB
+    inline std::unique_ptr<tbb::global_control> &tbbThreadLimit()
+    {
+      static std::unique_ptr<tbb::global_control> limit;
+      return limit;
+    }
+
+    inline void setNumThreads(int numThreads)
+    {
+      tbbThreadLimit().reset();
+      if (numThreads > 0)
+        tbbThreadLimit().reset
+          (new tbb::global_control(tbb::global_control::max_allowed_parallelism,
+                                   numThreads));
+    }
+
+    inline int getNumThreads()
+    {
+      return (int)tbb::global_control::active_value
+        (tbb::global_control::max_allowed_parallelism);
+    }
+
+    /*! a group of tasks that can be waited on as a whole */
+    struct TaskGroup {
+      /*! waits for all tasks, but - since this is a destructor -
+          silently drops any exception they may have thrown */
+      inline ~TaskGroup() { try { group.wait(); } catch (...) {} }
+
+      /*! schedule the given lambda for (possibly, parallel) execution */
+      template<typename Lambda>
+      inline void run(const Lambda &lambda) { group.run(lambda); }
+
+      /*! returns once all tasks of this group are done, re-throwing
+          the first exception any of them may have thrown */
+      inline void wait() { group.wait(); }
+
+    private:
+      tbb::task_group group;
+    };
+
     template<typename INDEX_T, typename TASK_T>
     inline void parallel_for(INDEX_T nTasks, TASK_T&& taskFunction, size_t blockSize=1)
     {
@@ -62,12 +118,55 @@ namespace owl {
       }
     }
 #else
-#ifndef OWL_DISABLE_TBB
-// # pragma message("warning: TBB not available, will replace all parallel_for's with serial_for's")
-#endif
+    inline void setNumThreads(int numThreads)
+    { TaskSystem::get().setNumThreads(numThreads); }
+
+    inline int getNumThreads()
+    { return TaskSystem::get().getNumThreads(); }
+
+    /*! recursively splits [begin,end) in halves, handing the upper
+        halves off to the task system, until the ranges are no larger
+        than 'grainSize', and calls rangeFunction(begin,end) on those */
+    template<typename RANGE_TASK_T>
+    inline void parallel_split(size_t begin, size_t end, size_t grainSize,
+                               const RANGE_TASK_T &rangeFunction)
+    {
+      TaskGroup group;
+      while (end-begin > grainSize) {
+        const size_t mid = begin+(end-begin)/2;
+        group.run([=,&rangeFunction](){
+            parallel_split(mid,end,grainSize,rangeFunction);
+          });
+        end = mid;
+      }
+      rangeFunction(begin,end);
+      group.wait();
+    }
+
     template<typename INDEX_T, typename TASK_T>
     inline void parallel_for(INDEX_T nTasks, TASK_T&& taskFunction, size_t blockSize=1)
-    { serial_for(nTasks,taskFunction); }
+    {
+      if (nTasks == 0) return;
+      if (nTasks == 1) {
+        taskFunction(INDEX_T(0));
+        return;
+      }
+      const size_t numThreads = getNumThreads();
+      const size_t numBlocks  = (size_t(nTasks)+blockSize-1)/blockSize;
+      if (numThreads == 1) {
+        serial_for(nTasks,taskFunction);
+        return;
+      }
+      // like tbb's auto_partitioner: a few chunks per thread, so
+      // stealing can even out imbalances, but not so many that
+      // scheduling overhead dominates for tiny tasks
+      const size_t grainSize = std::max(size_t(1),numBlocks/(8*numThreads));
+      parallel_split(0,numBlocks,grainSize,[&](size_t blockBegin, size_t blockEnd){
+          const size_t end = std::min(blockEnd*blockSize,size_t(nTasks));
+          for (size_t i=blockBegin*blockSize;i<end;i++)
+            taskFunction(INDEX_T(i));
+        });
+    }
 #endif
   
     // template<typename TASK_T>
@@ -101,6 +200,39 @@ namespace owl {
         });
 #endif
     }
+
+    /*! reduces the range [begin,end) in blocks of (at most)
+        'blockSize' elements: rangeFunction(blockBegin,blockEnd) has
+        to return the reduced value of one block, and
+        combine(a,b) to return the combination of two values. The
+        block results get combined in order, so the result is
+        deterministic (ie, always the same for the same blockSize, no
+        matter how many threads) even for non-associative operations
+        such as float additions */
+    template<typename T, typename RANGE_TASK_T, typename COMBINE_T>
+    inline T parallel_reduce(size_t begin, size_t end, size_t blockSize,
+                             const T &identity,
+                             const RANGE_TASK_T &rangeFunction,
+                             const COMBINE_T &combine)
+    {
+      if (end <= begin) return identity;
+      const size_t numBlocks = (end-begin+blockSize-1)/blockSize;
+      if (numBlocks == 1)
+        return combine(identity,rangeFunction(begin,end));
+
+      // (wrapped in a struct so T=bool doesn't end up in a bit vector)
+      struct Partial { T value; };
+      std::vector<Partial> partial(numBlocks,Partial{identity});
+      parallel_for(numBlocks,[&](size_t blockID){
+          const size_t block_begin = begin+blockID*blockSize;
+          partial[blockID].value
+            = rangeFunction(block_begin,std::min(block_begin+blockSize,end));
+        });
+      T result = identity;
+      for (auto &p : partial)
+        result = combine(result,p.value);
+      return result;
+    }
   
   } // ::owl::common
 } // ::owl
@@ -18,6 +18,7 @@
 
 #include "owl/common/math/vec.h"
 #include "owl/common/math/box.h"
+#include "owl/common/arrayND/VolumeLayout.h"
 // the 'actual' optix
 #include <cuda.h>
 #include <optix.h>
@@ -46,6 +47,19 @@ namespace owl {
     return (vec2i)optixGetLaunchDimensions();
   }
 
+  /*! return index of a 3-dimensional optix launch (see
+      owlRayGenLaunch3D) */
+  inline __device__ vec3i getLaunchIndex3D()
+  {
+    return (vec3i)optixGetLaunchIndex();
+  }
+
+  /*! return dimensions of a 3-dimensional optix launch */
+  inline __device__ vec3i getLaunchDims3D()
+  {
+    return (vec3i)optixGetLaunchDimensions();
+  }
+
   /*! return pointer to currently running program's "SBT Data" (which
       is pretty much what in owl we call the Program Data/Program
       Variables Struct. This method returns an untyped pointer, for
@@ -98,6 +112,58 @@ namespace owl {
       (make_8bit(color.w) << 24);
   }
 
+  // ==================================================================
+  // addressing of volumes uploaded from a owl::common::Volume<T>;
+  // 'data' is that volume's buffer, and 'layout' its getLayout()
+  // ==================================================================
+
+  /*! returns the given cell, which has to be inside the volume */
+  template<typename T>
+  inline __device__ const T &volumeFetch(const T *data,
+                                         const VolumeLayout &layout,
+                                         const vec3i &cell)
+  {
+    return data[layout.index(cell)];
+  }
+
+  /*! returns the given cell, with cells outside the volume getting
+      clamped to its boundary */
+  template<typename T>
+  inline __device__ const T &volumeFetchClamped(const T *data,
+                                                const VolumeLayout &layout,
+                                                const vec3i &cell)
+  {
+    return data[layout.index(layout.clamp(cell))];
+  }
+
+  /*! trilinearly interpolated, clamp-to-edge sample at the given
+      position in cell space (ie, cell (i,j,k) is centered at
+      (i+.5,j+.5,k+.5)). T has to support T*float and T+T */
+  template<typename T>
+  inline __device__ T volumeSample(const T *data,
+                                   const VolumeLayout &layout,
+                                   const vec3f &pos)
+  {
+    const vec3f p = pos - vec3f(.5f);
+    const vec3i c0(int(floorf(p.x)),int(floorf(p.y)),int(floorf(p.z)));
+    const vec3f f = p - vec3f(c0);
+    const T v000 = volumeFetchClamped(data,layout,c0+vec3i(0,0,0));
+    const T v001 = volumeFetchClamped(data,layout,c0+vec3i(1,0,0));
+    const T v010 = volumeFetchClamped(data,layout,c0+vec3i(0,1,0));
+    const T v011 = volumeFetchClamped(data,layout,c0+vec3i(1,1,0));
+    const T v100 = volumeFetchClamped(data,layout,c0+vec3i(0,0,1));
+    const T v101 = volumeFetchClamped(data,layout,c0+vec3i(1,0,1));
+    const T v110 = volumeFetchClamped(data,layout,c0+vec3i(0,1,1));
+    const T v111 = volumeFetchClamped(data,layout,c0+vec3i(1,1,1));
+    const T v00 = v000*(1.f-f.x) + v001*f.x;
+    const T v01 = v010*(1.f-f.x) + v011*f.x;
+    const T v10 = v100*(1.f-f.x) + v101*f.x;
+    const T v11 = v110*(1.f-f.x) + v111*f.x;
+    const T v0  = v00*(1.f-f.y) + v01*f.y;
+    const T v1  = v10*(1.f-f.y) + v11*f.y;
+    return v0*(1.f-f.z) + v1*f.z;
+  }
+
 
   static __forceinline__ __device__ void* unpackPointer( uint32_t i0, uint32_t i1 )
   {
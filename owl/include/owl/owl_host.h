@@ -263,6 +263,21 @@ typedef struct _OWL_double4 { double   x,y,z,w; } owl4d;
 
 typedef struct _OWL_affine3f { owl3f vx,vy,vz,t; } owl4x3f;
 
+/*! one key of a scale/rotate/translate (SRT) instance transform;
+    same layout as owl::common::SRTTransform, and same meaning as
+    OptixSRTData: a point p gets transformed to translation +
+    rotation * (S * p + pivot), where S is the upper triangular
+    matrix with 'scale' on the diagonal and 'shear' above it (in
+    order (0,1), (0,2), (1,2)), and 'rotation' is a unit quaternion
+    with real part 'r' */
+typedef struct _OWL_SRTTransform {
+  owl3f scale;
+  owl3f shear;
+  owl3f pivot;
+  struct { float r,i,j,k; } rotation;
+  owl3f translation;
+} OWLSRTTransform;
+
 typedef struct _OWLVarDecl {
   const char *name;
   OWLDataType type;
@@ -446,6 +461,18 @@ owlContextGetStream(OWLContext context, int deviceID);
 OWL_API OptixDeviceContext
 owlContextGetOptixContext(OWLContext context, int deviceID);
 
+/*! returns how much memory the given device has in total, and how
+    much of that this context's device buffers, textures, and
+    acceleration structures use (not counting temporary build
+    memory, or anything other contexts or the application
+    allocated). Either pointer may be NULL. Useful for deciding how
+    much of a scene to put on which device when distributing a scene
+    across devices rather than replicating it (see
+    owl/common/parallel/ScenePartitioner.h) */
+OWL_API void
+owlContextGetDeviceMemoryInfo(OWLContext context, int deviceID,
+                              size_t *bytesUsed, size_t *bytesTotal);
+
 OWL_API OWLModule
 owlModuleCreate(OWLContext  context,
                 const char *ptxCode);
@@ -692,6 +719,24 @@ owlTexture2DCreate(OWLContext context,
                      the next; '0' means 'size_x * sizeof(texel)' */
                    uint32_t linePitchInBytes       OWL_IF_CPP(=0)
                    );
+
+/*! create a mipmapped texture: 'levelTexels[i]' are the (tightly
+  packed) texels of level i, which is max(size>>i,1) texels in
+  either dimension, for 1 <= numLevels <= 1+log2(max(size_x,size_y))
+  levels (owl/common/image/MipChain.h can compute those). Only the
+  filtering that tex2DLod()/tex2DGrad() lookups do picks levels other
+  than 0; with OWL_TEXTURE_LINEAR, that filtering is trilinear */
+OWL_API OWLTexture
+owlTexture2DCreateMipmapped(OWLContext context,
+                            OWLTexelFormat texelFormat,
+                            uint32_t size_x,
+                            uint32_t size_y,
+                            int numLevels,
+                            const void *const *levelTexels,
+                            OWLTextureFilterMode filterMode OWL_IF_CPP(=OWL_TEXTURE_LINEAR),
+                            OWLTextureAddressMode addressMode OWL_IF_CPP(=OWL_TEXTURE_CLAMP),
+                            OWLTextureColorSpace colorSpace OWL_IF_CPP(=OWL_COLOR_SPACE_LINEAR)
+                            );
                    
 /*! destroy the given texture; after this call any accesses to the 
    given texture are invalid */
@@ -855,6 +900,22 @@ owlAsyncLaunch2DOnDevice(OWLRayGen rayGen, int dims_x, int dims_y,
 OWL_API CUstream
 owlParamsGetCudaStream(OWLParams params, int deviceID);
 
+/*! sets how many async launches with the same params can be in flight
+    (per device) at the same time. Each such launch gets its own copy
+    of the parameter values, so the values can be changed between
+    owlAsyncLaunch calls without an owlLaunchSync in between; once
+    all copies are in use, the next async launch waits for the
+    oldest launch with these params to complete. Default is 2.
+
+    Note all launches with the same params still go into the one
+    stream returned by owlParamsGetCudaStream, so they execute one
+    after another: the slots only save the host from waiting for the
+    previous launch before it can queue the next one. Launches that
+    should actually run concurrently on the GPU need different
+    params objects. */
+OWL_API void
+owlParamsSetNumSlots(OWLParams params, int numSlots);
+
 /*! wait for the async launch to finish */
 OWL_API void
 owlLaunchSync(OWLParams params);
@@ -886,6 +947,50 @@ OWL_API void owlTrianglesSetIndices(OWLGeom triangles,
                                     size_t stride,
                                     size_t offset);
 
+/*! what owlTrianglesPreprocess should do; can be or'ed together */
+typedef enum {
+  /*! merge vertices that are within the weld tolerance of each other
+      (in all motion keys) */
+  OWL_TRIANGLES_WELD_VERTICES      = 0x1,
+  /*! drop triangles with repeated indices, or zero area */
+  OWL_TRIANGLES_REMOVE_DEGENERATES = 0x2,
+  /*! sort triangles along a Morton curve, and renumber vertices in
+      order of first use, for better memory locality */
+  OWL_TRIANGLES_REORDER            = 0x4,
+  OWL_TRIANGLES_PREPROCESS_ALL     = 0x7,
+  /*! the index buffer isn't int3 triangles, but a triangle strip:
+      'count' ints (with stride 4), with 0xffffffff starting a new
+      strip. It gets converted to a list (into the same buffer)
+      before anything else happens. Not part of
+      OWL_TRIANGLES_PREPROCESS_ALL, since it changes how the input
+      gets read */
+  OWL_TRIANGLES_FROM_STRIP         = 0x8
+} OWLTrianglesPreprocessFlags;
+
+/*! cleans up a triangle mesh on the host, in place: downloads its
+    vertices and indices, welds vertices (with the given tolerance;
+    0 only merges exact duplicates), removes degenerate triangles,
+    and reorders the mesh, as requested by 'flags'; then writes the
+    result back into the mesh's own buffers (which get resized
+    accordingly). Vertex and index buffers have to be compact float3
+    and int3 buffers (or int, for OWL_TRIANGLES_FROM_STRIP); any other
+    per-vertex or per-triangle data the user keeps has to be remapped
+    with owlTrianglesGetRemap. Raises an error if no triangles are
+    left */
+OWL_API void owlTrianglesPreprocess(OWLGeom triangles,
+                                    float weldTolerance,
+                                    int flags);
+
+/*! returns, for the last owlTrianglesPreprocess on this mesh, the
+    original vertex of each new vertex and the original triangle of
+    each new triangle. The returned arrays stay valid until the mesh
+    gets preprocessed again, or released */
+OWL_API void owlTrianglesGetRemap(OWLGeom triangles,
+                                  size_t *numVertices,
+                                  const uint32_t **newToOldVertex,
+                                  size_t *numTriangles,
+                                  const uint32_t **newToOldTriangle);
+
 // ==================================================================
 // "Curves" functions
 // ==================================================================
@@ -916,6 +1021,42 @@ OWL_API void owlCurvesSetSegmentIndices(OWLGeom curvesGeom,
                                         int numSegmentIndices,
                                         OWLBuffer segmentIndices);
 
+/*! conventions for what control points mean, for
+    owlCurvesPreprocess (owl itself only renders the first three, as
+    degree 1, 2, and 3) */
+typedef enum {
+  OWL_CURVE_BASIS_LINEAR,
+  OWL_CURVE_BASIS_QUADRATIC_BSPLINE,
+  OWL_CURVE_BASIS_CUBIC_BSPLINE,
+  OWL_CURVE_BASIS_CATMULL_ROM,
+  OWL_CURVE_BASIS_CUBIC_BEZIER
+} OWLCurveBasis;
+
+/*! converts and splits a curves geom's segments on the host, in
+    place: downloads control points, widths, and segment indices
+    (which are in the given input basis), splits every segment whose
+    control polygon turns by more than 'maxTurnAngle' radians, whose
+    widths vary by more than a factor of 'maxWidthRatio', or that is
+    more than 'maxLengthToWidth' times as long as it is wide (0
+    turns the respective test off), and writes the result - in the
+    b-spline basis of the geom type's degree - back into the geom's
+    own buffers, which get resized accordingly. Much tighter
+    bounding boxes for long, curly strands. Needs float3, float, and
+    int buffers; other per-segment data the user keeps has to be
+    remapped with owlCurvesGetSegmentRemap */
+OWL_API void owlCurvesPreprocess(OWLGeom curvesGeom,
+                                 OWLCurveBasis inputBasis,
+                                 float maxTurnAngle,
+                                 float maxWidthRatio,
+                                 float maxLengthToWidth);
+
+/*! returns, for the last owlCurvesPreprocess on this geom, the
+    original segment of each new segment. The returned array stays
+    valid until the geom gets preprocessed again, or released */
+OWL_API void owlCurvesGetSegmentRemap(OWLGeom curvesGeom,
+                                      size_t *numSegments,
+                                      const uint32_t **newToOldSegment);
+
 // ==================================================================
 // "Spheres" functions
 // ==================================================================
@@ -930,6 +1071,30 @@ OWL_API void owlSpheresSetVertices(OWLGeom spheresGeom,
                                        /*! buffer of (one float per
                                            sphere) specifies radius*/
                                        OWLBuffer radius);
+
+/*! builds levels of detail for a (large) set of spheres on the host,
+    and creates one spheres geom (of the given type) per requested
+    level: spheres get sorted into an octree, and each level's octree
+    cells get one sphere each that encloses all spheres in that cell
+    (see owl/common/geometry/sphereClustering.h). The i'th geom gets
+    the coarsest level whose cells are no larger than maxCellSizes[i]
+    (eg, the world-space size of a pixel at the distance it's viewed
+    from), but no finer than the finest level with at most
+    maxSpheres[i] spheres; either array can be NULL, and any value
+    can be 0, for "no limit". All geoms are in the same space as the
+    input, so they can go into groups that get instanced
+    interchangeably. 'centers' and 'radii' are host arrays; 'radii'
+    can be NULL, in which case all spheres have radius 'radius' */
+OWL_API void owlSpheresGeomCreateLODs(OWLContext context,
+                                      OWLGeomType spheresGeomType,
+                                      const owl3f *centers,
+                                      const float *radii,
+                                      float radius,
+                                      size_t numSpheres,
+                                      int numLODs,
+                                      const float *maxCellSizes,
+                                      const size_t *maxSpheres,
+                                      OWLGeom *lods);
                                        
 // -------------------------------------------------------
 // group/hierarchy creation and setting
@@ -940,7 +1105,9 @@ owlInstanceGroupSetChild(OWLGroup group,
                          OWLGroup child);
 
 /*! sets the transformatoin matrix to be applied to the childID'th
-  child of the given instance group */
+  child of the given instance group. Raises an error while the group
+  takes its transforms from a buffer (see
+  owlInstanceGroupSetTransformsBuffer) */
 OWL_API void
 owlInstanceGroupSetTransform(OWLGroup group,
                              int whichChild,
@@ -950,16 +1117,47 @@ owlInstanceGroupSetTransform(OWLGroup group,
 
 /*! this function allows to set up to N different arrays of trnsforms
     for motion blur; the first such array is used as transforms for
-    t=0, the last one for t=1.  */
+    t=0, the last one for t=1, and the others for evenly spaced times
+    in between; transforms get linearly interpolated between those
+    keys. All keys up to the highest one set have to be set before
+    building. */
 OWL_API void
 owlInstanceGroupSetTransforms(OWLGroup group,
-                              /*! whether to set for t=0 or t=1 -
-                                  currently supporting only 0 or 1*/
+                              /*! which motion key to set, with 0
+                                  being t=0 */
                               uint32_t timeStep,
                               const float *floatsForThisStimeStep,
                               OWLMatrixFormat matrixFormat
                               OWL_IF_CPP(=OWL_MATRIX_FORMAT_OWL));
 
+/*! same as \see owlInstanceGroupSetTransforms, but with SRT keys
+    (one per child) instead of matrices: the rotation then gets
+    interpolated along its arc between keys, rather than the
+    matrices' coefficients getting interpolated linearly (which
+    makes rotating objects shrink in between keys). Once any key
+    has been set this way, all keys have to be, and motion gets
+    built with OptiX SRT motion transforms; setting keys as matrices
+    again switches back. Between two keys, rotations take the short
+    way unless the two quaternions point into opposite hemispheres
+    (see owl::common::alignSRTRotations); for more than half a turn,
+    use more keys. owl::common::decomposeSRT computes these from an
+    affine3f */
+OWL_API void
+owlInstanceGroupSetSRTTransforms(OWLGroup group,
+                                 /*! which motion key to set, with 0
+                                     being t=0 */
+                                 uint32_t timeStep,
+                                 const OWLSRTTransform *srtsForThisTimeStep);
+
+/*! sets the number of motion keys of an instance group: fewer keys
+    than currently set drops the last ones - in particular, 1 turns
+    motion blur off again, keeping the t=0 transforms - and more keys
+    add keys that all have to be set before the next build. The next
+    build or refit of the group is always a full build */
+OWL_API void
+owlInstanceGroupSetNumMotionKeys(OWLGroup group,
+                                 int numKeys);
+
 /*! sets the list of IDs to use for the child instnaces. By default
     the instance ID of child #i is simply i, but optix allows to
     specify a user-defined instnace ID for each instance, which with
@@ -973,6 +1171,78 @@ OWL_API void
 owlInstanceGroupSetVisibilityMasks(OWLGroup group,
                                const uint8_t *visibilityMasks);
 
+/*! makes the instance group take its transforms from a (device-side)
+    buffer of one matrix (12 floats) per child, instead of from the
+    host-side transforms. If any of the per-instance arrays comes from
+    a buffer, the optix instance records get assembled on the
+    device, so animated instances can be written by a user kernel and
+    refit without any round-trip through the host. Passing a null
+    buffer reverts to the host-side transforms. Setting all
+    transforms from the host (owlInstanceGroupSetTransforms) replaces
+    the buffer, setting a single one raises an error. Not (yet)
+    supported for motion blurred instance groups. */
+OWL_API void
+owlInstanceGroupSetTransformsBuffer(OWLGroup group,
+                                    /*! buffer of OWL_FLOAT or OWL_AFFINE3F */
+                                    OWLBuffer transforms,
+                                    OWLMatrixFormat matrixFormat
+                                    OWL_IF_CPP(=OWL_MATRIX_FORMAT_OWL));
+
+/*! same as owlInstanceGroupSetInstanceIDs, but with the IDs coming
+    from a (device-side) buffer of OWL_UINTs (or OWL_INTs) */
+OWL_API void
+owlInstanceGroupSetInstanceIDsBuffer(OWLGroup group,
+                                     OWLBuffer instanceIDs);
+
+/*! same as owlInstanceGroupSetVisibilityMasks, but with the masks
+    coming from a (device-side) buffer of OWL_UCHARs (or OWL_CHARs) */
+OWL_API void
+owlInstanceGroupSetVisibilityMasksBuffer(OWLGroup group,
+                                         OWLBuffer visibilityMasks);
+
+/*! specifies levels of detail for the given child of an instance
+    group: lodGroups[0] replaces the child itself, and lodGroups[k] is
+    used for as long as the instance's distance to the camera is at
+    most maxDistances[k] (distances have to be increasing); instances
+    farther away than the last distance get culled. LODs only have an
+    effect once culling is enabled via owlInstanceGroupSetCullingView */
+OWL_API void
+owlInstanceGroupSetLODs(OWLGroup group,
+                        int whichChild,
+                        int numLODs,
+                        const OWLGroup *lodGroups,
+                        const float *maxDistances);
+
+/*! enables culling and LOD selection for the given instance group:
+    every following build or refit first culls all instances against
+    the given view frustum (using the children's bounds), selects each
+    remaining instance's LOD by its distance to the eye (multiplied by
+    lodScale), and only puts the remaining instances into the
+    IAS. Instance IDs stay those of the original children. A
+    non-positive near or far distance disables that plane. Refits
+    stay refits as long as the same instances and LODs get selected,
+    and turn into builds otherwise. Requires host-side, non-motion
+    blurred transforms. */
+OWL_API void
+owlInstanceGroupSetCullingView(OWLGroup group,
+                               owl3f eye,
+                               owl3f at,
+                               owl3f up,
+                               float fovyInDegrees,
+                               float aspect,
+                               float nearDist,
+                               float farDist,
+                               float lodScale);
+
+/*! disables culling and LOD selection again */
+OWL_API void
+owlInstanceGroupDisableCulling(OWLGroup group);
+
+/*! returns how many instances made it into the instance group's IAS
+    during the last build (ie, after culling, if enabled) */
+OWL_API size_t
+owlInstanceGroupGetNumActiveInstances(OWLGroup group);
+
 
 OWL_API void
 owlGeomTypeSetClosestHit(OWLGeomType type,
@@ -1729,4 +1999,38 @@ owlInstanceGroupSetTransform(OWLGroup group,
                                OWL_MATRIX_FORMAT_OWL);
 }
 
+
+namespace owl { namespace common { template<typename T> struct Volume; } }
+
+/*! c++ convenience function that creates a device buffer holding the
+  given owl::common::Volume's storage (in whatever layout that volume
+  has, and including its padding). Device code addresses this buffer
+  through the volume's getLayout(), which can be passed as a
+  variable of type OWL_USER_TYPE(owl::common::VolumeLayout); see
+  volumeFetch() in owl_device.h. 'type' has to be of the volume's
+  cell type's size. Requires owl/common/arrayND/Volume.h */
+template<typename T>
+inline OWLBuffer
+owlVolumeBufferCreate(OWLContext context,
+                      OWLDataType type,
+                      const owl::common::Volume<T> &volume)
+{
+  return owlDeviceBufferCreate(context,type,
+                               volume.numStorageElements(),
+                               volume.data());
+}
+
+/*! c++ convenience function that (re-)uploads the given volume's
+  storage into a buffer created by owlVolumeBufferCreate(), resizing
+  that buffer if required */
+template<typename T>
+inline void
+owlVolumeBufferUpload(OWLBuffer buffer,
+                      const owl::common::Volume<T> &volume)
+{
+  if (owlBufferSizeInBytes(buffer) != volume.sizeInBytes())
+    owlBufferResize(buffer,volume.numStorageElements());
+  owlBufferUpload(buffer,volume.data());
+}
+
 #endif
@@ -0,0 +1,295 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "MeshImport.h"
+#include "owl/common/parallel/parallel_for.h"
+#include "owl/common/math/boundsReduction.h"
+#include "stb/stb_image.h"
+//std
+#include <algorithm>
+#include <atomic>
+#include <map>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  inline bool operator==(const tinyobj::index_t &a, const tinyobj::index_t &b)
+  {
+    return a.vertex_index   == b.vertex_index
+      &&   a.normal_index   == b.normal_index
+      &&   a.texcoord_index == b.texcoord_index;
+  }
+
+  inline size_t hashOf(const tinyobj::index_t &idx)
+  {
+    uint64_t h = uint32_t(idx.vertex_index);
+    h = h * 0x9e3779b97f4a7c15ull + uint32_t(idx.normal_index);
+    h = h * 0x9e3779b97f4a7c15ull + uint32_t(idx.texcoord_index);
+    return size_t(h ^ (h >> 29));
+  }
+
+  VertexHashTable::VertexHashTable(size_t expectedNumKeys)
+  {
+    size_t capacity = 16;
+    while (capacity < 2*expectedNumKeys) capacity *= 2;
+    keys.resize(capacity);
+    ids.resize(capacity,-1);
+  }
+
+  int VertexHashTable::findOrInsert(const tinyobj::index_t &key, int newID)
+  {
+    if (2*(numKeys+1) > ids.size()) grow();
+    const size_t mask = ids.size()-1;
+    for (size_t slot = hashOf(key) & mask;; slot = (slot+1) & mask) {
+      if (ids[slot] < 0) {
+        keys[slot] = key;
+        ids[slot]  = newID;
+        numKeys++;
+        return newID;
+      }
+      if (keys[slot] == key)
+        return ids[slot];
+    }
+  }
+
+  void VertexHashTable::grow()
+  {
+    std::vector<tinyobj::index_t> oldKeys(2*keys.size());
+    std::vector<int>              oldIDs(2*ids.size(),-1);
+    oldKeys.swap(keys);
+    oldIDs.swap(ids);
+    const size_t mask = ids.size()-1;
+    for (size_t i=0;i<oldIDs.size();i++) {
+      if (oldIDs[i] < 0) continue;
+      size_t slot = hashOf(oldKeys[i]) & mask;
+      while (ids[slot] >= 0) slot = (slot+1) & mask;
+      keys[slot] = oldKeys[i];
+      ids[slot]  = oldIDs[i];
+    }
+  }
+
+  /*! the faces of one shape that use one material; these become one
+      mesh */
+  struct MeshJob {
+    int                 shapeID;
+    int                 materialID;
+    std::vector<size_t> faces;
+  };
+
+  /*! builds the mesh of one job: vertices get numbered in the order
+      their index triple is first used, and a vertex without a normal
+      (or texcoord) gets the one of the next vertex that has one */
+  static TriangleMesh *buildMesh(const MeshJob &job,
+                                 const tinyobj::attrib_t &attributes,
+                                 const tinyobj::shape_t &shape)
+  {
+    const vec3f *vertex_array   = (const vec3f*)attributes.vertices.data();
+    const vec3f *normal_array   = (const vec3f*)attributes.normals.data();
+    const vec2f *texcoord_array = (const vec2f*)attributes.texcoords.data();
+
+    TriangleMesh *mesh = new TriangleMesh;
+    mesh->index.reserve(job.faces.size());
+
+    VertexHashTable knownVertices(job.faces.size());
+    std::vector<tinyobj::index_t> uniques;
+    uniques.reserve(job.faces.size());
+    for (auto faceID : job.faces) {
+      vec3i idx;
+      for (int i=0;i<3;i++) {
+        const tinyobj::index_t &corner = shape.mesh.indices[3*faceID+i];
+        const int newID = (int)uniques.size();
+        idx[i] = knownVertices.findOrInsert(corner,newID);
+        if (idx[i] == newID) uniques.push_back(corner);
+      }
+      mesh->index.push_back(idx);
+    }
+
+    const size_t numVertices = uniques.size();
+    bool hasNormals = false, hasTexcoords = false;
+    for (auto &idx : uniques) {
+      hasNormals   |= idx.normal_index >= 0;
+      hasTexcoords |= idx.texcoord_index >= 0;
+    }
+    mesh->vertex.resize(numVertices);
+    if (hasNormals)   mesh->normal.resize(numVertices,vec3f(0.f));
+    if (hasTexcoords) mesh->texcoord.resize(numVertices,vec2f(0.f));
+    for (size_t i=0;i<numVertices;i++)
+      mesh->vertex[i] = vertex_array[uniques[i].vertex_index];
+    // walk backwards, so vertices without normals/texcoords can pick
+    // up the next following one
+    int nextNormal = -1, nextTexcoord = -1;
+    for (size_t i=numVertices;i-- > 0;) {
+      if (uniques[i].normal_index >= 0)   nextNormal   = uniques[i].normal_index;
+      if (uniques[i].texcoord_index >= 0) nextTexcoord = uniques[i].texcoord_index;
+      if (hasNormals && nextNormal >= 0)
+        mesh->normal[i] = normal_array[nextNormal];
+      if (hasTexcoords && nextTexcoord >= 0)
+        mesh->texcoord[i] = texcoord_array[nextTexcoord];
+    }
+    return mesh;
+  }
+
+  /*! the file a material's texture name refers to */
+  static std::string textureFileName(const std::string &inFileName,
+                                     const std::string &modelPath)
+  {
+    std::string fileName = inFileName;
+    // first, fix backspaces:
+    for (auto &c : fileName)
+      if (c == '\\') c = '/';
+    return modelPath+"/"+fileName;
+  }
+
+  /*! loads one texture, or returns null if it can't be loaded */
+  static Texture *loadTexture(const std::string &fileName)
+  {
+    vec2i res;
+    int   comp;
+    unsigned char* image = stbi_load(fileName.c_str(),
+                                     &res.x, &res.y, &comp, STBI_rgb_alpha);
+    if (!image) {
+      std::cout << OWL_TERMINAL_RED
+                << "Could not load texture from " << fileName << "!"
+                << OWL_TERMINAL_DEFAULT << std::endl;
+      return nullptr;
+    }
+    // stbi stores the top row first, we want the bottom one first
+    Texture *texture = new Texture;
+    texture->resolution = res;
+    texture->pixel.resize(size_t(res.x)*res.y);
+    const uint32_t *src = (const uint32_t *)image;
+    for (int y=0;y<res.y;y++)
+      std::copy(src+size_t(res.y-1-y)*res.x,src+size_t(res.y-y)*res.x,
+                texture->pixel.data()+size_t(y)*res.x);
+    stbi_image_free(image);
+    return texture;
+  }
+
+  void buildModel(Model *model,
+                  const tinyobj::attrib_t &attributes,
+                  const std::vector<tinyobj::shape_t> &shapes,
+                  const std::vector<tinyobj::material_t> &materials,
+                  const std::string &modelDir,
+                  std::vector<std::string> *sourceFiles)
+  {
+    // ------------------------------------------------------------------
+    // sort each shape's faces into per-material buckets; meshes come
+    // out shape by shape, and by ascending material ID within a shape
+    // ------------------------------------------------------------------
+    std::vector<std::vector<MeshJob>> jobsOfShape(shapes.size());
+    std::atomic<bool> badTessellation(false);
+    parallel_for(shapes.size(),[&](size_t shapeID){
+        const tinyobj::mesh_t &mesh = shapes[shapeID].mesh;
+        std::map<int,size_t> bucketOf;
+        std::vector<MeshJob> &jobs = jobsOfShape[shapeID];
+        for (auto matID : mesh.material_ids)
+          bucketOf[matID] = 0;
+        for (auto &it : bucketOf) {
+          it.second = jobs.size();
+          jobs.push_back(MeshJob{(int)shapeID,it.first,{}});
+        }
+        for (size_t faceID=0;faceID<mesh.material_ids.size();faceID++) {
+          if (mesh.num_face_vertices[faceID] != 3)
+            badTessellation = true;
+          jobs[bucketOf[mesh.material_ids[faceID]]].faces.push_back(faceID);
+        }
+      });
+    if (badTessellation)
+      throw std::runtime_error("not properly tessellated");
+
+    std::vector<MeshJob> jobs;
+    for (auto &shapeJobs : jobsOfShape)
+      for (auto &job : shapeJobs)
+        jobs.push_back(std::move(job));
+    jobsOfShape.clear();
+
+    // ------------------------------------------------------------------
+    // textures get their IDs in the order their meshes first use
+    // them; find the distinct file names in that order, then decode
+    // them in the background while the meshes get built
+    // ------------------------------------------------------------------
+    std::vector<std::string> textureNames;
+    std::map<std::string,int> textureSlot;
+    std::vector<int> slotOfJob(jobs.size(),-1);
+    for (size_t jobID=0;jobID<jobs.size();jobID++) {
+      const int materialID = jobs[jobID].materialID;
+      if (materialID < 0) continue;
+      const std::string &name = materials[materialID].diffuse_texname;
+      if (name == "") continue;
+      auto it = textureSlot.find(name);
+      if (it == textureSlot.end()) {
+        it = textureSlot.insert({name,(int)textureNames.size()}).first;
+        textureNames.push_back(name);
+      }
+      slotOfJob[jobID] = it->second;
+    }
+
+    if (sourceFiles)
+      for (auto &name : textureNames)
+        sourceFiles->push_back(textureFileName(name,modelDir));
+
+    std::vector<Texture *> loadedTextures(textureNames.size(),nullptr);
+    TaskGroup textureLoads;
+    for (size_t slot=0;slot<textureNames.size();slot++)
+      textureLoads.run([&,slot](){
+          loadedTextures[slot] = loadTexture(textureFileName(textureNames[slot],modelDir));
+        });
+
+    std::vector<TriangleMesh *> meshes(jobs.size(),nullptr);
+    parallel_for(jobs.size(),[&](size_t jobID){
+        const MeshJob &job = jobs[jobID];
+        meshes[jobID] = buildMesh(job,attributes,shapes[job.shapeID]);
+      });
+    textureLoads.wait();
+
+    // ------------------------------------------------------------------
+    // hand out texture IDs (skipping the ones that failed to load),
+    // and attach materials
+    // ------------------------------------------------------------------
+    std::vector<int> textureIDOfSlot(loadedTextures.size(),-1);
+    for (size_t slot=0;slot<loadedTextures.size();slot++) {
+      if (!loadedTextures[slot]) continue;
+      textureIDOfSlot[slot] = (int)model->textures.size();
+      model->textures.push_back(loadedTextures[slot]);
+    }
+    for (size_t jobID=0;jobID<jobs.size();jobID++) {
+      TriangleMesh *mesh = meshes[jobID];
+      const int materialID = jobs[jobID].materialID;
+      if (materialID < 0) {
+        mesh->diffuse = vec3f(1,0,0);
+        mesh->diffuseTextureID = -1;
+      } else {
+        mesh->diffuse = (const vec3f&)materials[materialID].diffuse;
+        mesh->diffuseTextureID
+          = slotOfJob[jobID] < 0 ? -1 : textureIDOfSlot[slotOfJob[jobID]];
+      }
+      model->meshes.push_back(mesh);
+    }
+
+    model->bounds
+      = parallel_reduce(size_t(0),meshes.size(),size_t(1),box3f(),
+                        [&](size_t begin, size_t end){
+                          box3f bounds;
+                          for (size_t i=begin;i<end;i++) {
+                            const auto &vertex = meshes[i]->vertex;
+                            bounds.extend(computeBounds(StridedVec3fs(vertex.data(),
+                                                                      vertex.size())));
+                          }
+                          return bounds;
+                        },
+                        [](box3f a, box3f b){ a.extend(b); return a; });
+  }
+}
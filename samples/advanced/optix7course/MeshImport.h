@@ -0,0 +1,60 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "Model.h"
+#include "tiny_obj_loader.h"
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /*! maps the (vertex,normal,texcoord) index triples of an OBJ
+      file's face corners to the vertex IDs of one mesh. Open
+      addressing with linear probing, growing (to stay at most half
+      full) as needed */
+  struct VertexHashTable {
+    VertexHashTable(size_t expectedNumKeys);
+
+    /*! the ID of the given key; if there isn't one yet, 'newID'
+        becomes its ID */
+    int findOrInsert(const tinyobj::index_t &key, int newID);
+
+    size_t size() const { return numKeys; }
+
+  private:
+    void grow();
+
+    std::vector<tinyobj::index_t> keys;
+    /*! -1 for empty slots */
+    std::vector<int>              ids;
+    size_t                        numKeys { 0 };
+  };
+
+  /*! turns what tinyobj parsed into the model's meshes - one per
+      shape and material, with the face corners' index triples
+      de-duplicated into vertices - and textures. Meshes get built in
+      parallel, and textures decoded in parallel to that; the result
+      is exactly what building them one after another would give. If
+      'sourceFiles' is given, the textures' file names get appended
+      to it */
+  void buildModel(Model *model,
+                  const tinyobj::attrib_t &attributes,
+                  const std::vector<tinyobj::shape_t> &shapes,
+                  const std::vector<tinyobj::material_t> &materials,
+                  const std::string &modelDir,
+                  std::vector<std::string> *sourceFiles = nullptr);
+}
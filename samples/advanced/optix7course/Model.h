@@ -18,6 +18,7 @@
 
 #include <owl/owl.h>
 #include <owl/common/math/AffineSpace.h>
+#include <memory>
 #include <vector>
 
 /*! \namespace osc - Optix Siggraph Course */
@@ -25,13 +26,60 @@ namespace osc {
   using namespace owl;
   using namespace owl::common;
   
+  /*! an array of model data: either owned, or - for models mapped
+      from a cache file (see ModelCache.h) - a view of memory that the
+      model keeps mapped. Reading works the same either way; anything
+      that could modify a view - which includes non-const data(),
+      operator[] and begin()/end() - first copies it, so read through
+      a const reference where that matters */
+  template<typename T>
+  struct Array {
+    size_t   size()  const { return view ? viewSize : owned.size(); }
+    bool     empty() const { return size() == 0; }
+    bool     isView() const { return view != nullptr; }
+    const T *data()  const { return view ? view : owned.data(); }
+    T       *data()        { own(); return owned.data(); }
+    const T *begin() const { return data(); }
+    const T *end()   const { return data()+size(); }
+    T       *begin()       { return data(); }
+    T       *end()         { return data()+size(); }
+    const T &operator[](size_t i) const { return data()[i]; }
+    T       &operator[](size_t i)       { return data()[i]; }
+
+    void reserve(size_t n)             { own(); owned.reserve(n); }
+    void resize(size_t n)              { own(); owned.resize(n); }
+    void resize(size_t n, const T &t)  { own(); owned.resize(n,t); }
+    void push_back(const T &t)         { own(); owned.push_back(t); }
+
+    /*! makes this a view of the given memory, which has to outlive it */
+    void setView(const T *ptr, size_t n)
+    {
+      owned.clear();
+      owned.shrink_to_fit();
+      view     = ptr;
+      viewSize = n;
+    }
+
+  private:
+    void own()
+    {
+      if (!view) return;
+      owned.assign(view,view+viewSize);
+      view = nullptr;
+    }
+
+    std::vector<T> owned;
+    const T       *view     { nullptr };
+    size_t         viewSize { 0 };
+  };
+
   /*! a simple indexed triangle mesh that our sample renderer will
       render */
   struct TriangleMesh {
-    std::vector<vec3f> vertex;
-    std::vector<vec3f> normal;
-    std::vector<vec2f> texcoord;
-    std::vector<vec3i> index;
+    Array<vec3f> vertex;
+    Array<vec3f> normal;
+    Array<vec2f> texcoord;
+    Array<vec3i> index;
 
     // material data:
     vec3f              diffuse;
@@ -43,11 +91,9 @@ namespace osc {
   };
   
   struct Texture {
-    ~Texture()
-    { if (pixel) delete[] pixel; }
-    
-    uint32_t *pixel      { nullptr };
-    vec2i     resolution { -1 };
+    /*! RGBA8, bottom row first */
+    Array<uint32_t> pixel;
+    vec2i           resolution { -1 };
   };
   
   struct Model {
@@ -61,7 +107,14 @@ namespace osc {
     std::vector<Texture *>      textures;
     //! bounding box of all vertices in the model
     box3f bounds;
+    /*! for models mapped from a cache file: keeps the file mapped
+        for the meshes' and textures' views into it */
+    std::shared_ptr<const void> mapping;
   };
 
-  Model *loadOBJ(const std::string &objFile);
+  /*! loads the given OBJ file; if 'sourceFiles' is given, appends
+      the names of all files the model was (or would have been)
+      loaded from - the OBJ itself, material libraries, and textures */
+  Model *loadOBJ(const std::string &objFile,
+                 std::vector<std::string> *sourceFiles = nullptr);
 }
@@ -0,0 +1,376 @@
+// ======================================================================== //
+// Copyright 2018-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "ModelCache.h"
+//std
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#ifdef _WIN32
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /* the file layout: a CacheHeader, the source files (each a uint32
+     length plus that many characters), the CacheMesh and CacheTexture
+     tables, and then the arrays' data, each starting at a multiple
+     of cacheAlignment */
+
+  static const char     cacheMagic[8]  = { 'O','S','C','M','O','D','E','L' };
+  static const uint32_t cacheVersion   = 1;
+  /*! so caches written on a machine of different byte order don't
+      get used */
+  static const uint32_t cacheByteOrder = 0x01020304;
+  /*! same as what cudaMalloc gives */
+  static const uint64_t cacheAlignment = 256;
+
+  struct CacheArray {
+    uint64_t offset;
+    uint64_t count;
+  };
+
+  struct CacheHeader {
+    char       magic[8];
+    uint32_t   version;
+    uint32_t   byteOrder;
+    uint64_t   fileSize;
+    uint64_t   sourceHash;
+    uint64_t   numSources;
+    uint64_t   sourcesOffset;
+    uint64_t   numMeshes;
+    uint64_t   meshesOffset;
+    uint64_t   numTextures;
+    uint64_t   texturesOffset;
+    box3f      bounds;
+  };
+
+  struct CacheMesh {
+    CacheArray vertex, normal, texcoord, index;
+    vec3f      diffuse;
+    int32_t    diffuseTextureID;
+  };
+
+  struct CacheTexture {
+    CacheArray pixel;
+    vec2i      resolution;
+  };
+
+  static uint64_t alignUp(uint64_t offset)
+  { return (offset+cacheAlignment-1) & ~(cacheAlignment-1); }
+
+  /*! FNV-1a */
+  static void hashBytes(uint64_t &hash, const void *ptr, size_t numBytes)
+  {
+    const uint8_t *bytes = (const uint8_t *)ptr;
+    for (size_t i=0;i<numBytes;i++)
+      hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+
+  /*! the hash of the source files' names, sizes, and modification
+      times; files that don't exist count, too, so a texture that
+      failed to load invalidates the cache once it shows up */
+  static uint64_t hashSources(const std::vector<std::string> &sourceFiles)
+  {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (auto &fileName : sourceFiles) {
+      struct stat info;
+      int64_t size = -1, mtime = 0;
+      if (stat(fileName.c_str(),&info) == 0) {
+        size  = (int64_t)info.st_size;
+        mtime = (int64_t)info.st_mtime;
+      }
+      hashBytes(hash,fileName.c_str(),fileName.size()+1);
+      hashBytes(hash,&size,sizeof(size));
+      hashBytes(hash,&mtime,sizeof(mtime));
+    }
+    return hash;
+  }
+
+  // ------------------------------------------------------------------
+  // writing
+  // ------------------------------------------------------------------
+
+  template<typename T>
+  static CacheArray place(uint64_t &offset, const Array<T> &array)
+  {
+    CacheArray placed;
+    placed.offset = array.empty() ? 0 : alignUp(offset);
+    placed.count  = array.size();
+    if (!array.empty())
+      offset = placed.offset + array.size()*sizeof(T);
+    return placed;
+  }
+
+  template<typename T>
+  static void write(std::ofstream &out, const CacheArray &placed, const Array<T> &array)
+  {
+    if (array.empty()) return;
+    static const char zeros[cacheAlignment] = { 0 };
+    out.write(zeros,placed.offset-(uint64_t)out.tellp());
+    out.write((const char *)array.data(),array.size()*sizeof(T));
+  }
+
+  void saveModelCache(const std::string &cacheFile,
+                      const Model *model,
+                      const std::vector<std::string> &sourceFiles)
+  {
+    CacheHeader header;
+    memset((void *)&header,0,sizeof(header));
+    memcpy(header.magic,cacheMagic,sizeof(cacheMagic));
+    header.version     = cacheVersion;
+    header.byteOrder   = cacheByteOrder;
+    header.sourceHash  = hashSources(sourceFiles);
+    header.numSources  = sourceFiles.size();
+    header.numMeshes   = model->meshes.size();
+    header.numTextures = model->textures.size();
+    header.bounds      = model->bounds;
+
+    uint64_t offset = sizeof(header);
+    header.sourcesOffset = offset;
+    for (auto &fileName : sourceFiles)
+      offset += sizeof(uint32_t)+fileName.size();
+    offset = header.meshesOffset = (offset+7) & ~uint64_t(7);
+    offset += header.numMeshes*sizeof(CacheMesh);
+    header.texturesOffset = offset;
+    offset += header.numTextures*sizeof(CacheTexture);
+
+    std::vector<CacheMesh> meshes(model->meshes.size());
+    for (size_t i=0;i<meshes.size();i++) {
+      const TriangleMesh *mesh = model->meshes[i];
+      memset((void *)&meshes[i],0,sizeof(meshes[i]));
+      meshes[i].vertex   = place(offset,mesh->vertex);
+      meshes[i].normal   = place(offset,mesh->normal);
+      meshes[i].texcoord = place(offset,mesh->texcoord);
+      meshes[i].index    = place(offset,mesh->index);
+      meshes[i].diffuse  = mesh->diffuse;
+      meshes[i].diffuseTextureID = mesh->diffuseTextureID;
+    }
+    std::vector<CacheTexture> textures(model->textures.size());
+    for (size_t i=0;i<textures.size();i++) {
+      const Texture *texture = model->textures[i];
+      memset((void *)&textures[i],0,sizeof(textures[i]));
+      textures[i].pixel      = place(offset,texture->pixel);
+      textures[i].resolution = texture->resolution;
+    }
+    header.fileSize = offset;
+
+    // write to a temporary file first, so no one ever maps a
+    // half-written cache
+    const std::string tmpFile = cacheFile+".tmp";
+    {
+      std::ofstream out(tmpFile,std::ios::binary);
+      if (!out)
+        throw std::runtime_error("could not open model cache file "+tmpFile);
+      out.write((const char *)&header,sizeof(header));
+      for (auto &fileName : sourceFiles) {
+        const uint32_t length = (uint32_t)fileName.size();
+        out.write((const char *)&length,sizeof(length));
+        out.write(fileName.data(),length);
+      }
+      static const char zeros[8] = { 0 };
+      out.write(zeros,header.meshesOffset-(uint64_t)out.tellp());
+      out.write((const char *)meshes.data(),meshes.size()*sizeof(CacheMesh));
+      out.write((const char *)textures.data(),textures.size()*sizeof(CacheTexture));
+      for (size_t i=0;i<meshes.size();i++) {
+        const TriangleMesh *mesh = model->meshes[i];
+        write(out,meshes[i].vertex,  mesh->vertex);
+        write(out,meshes[i].normal,  mesh->normal);
+        write(out,meshes[i].texcoord,mesh->texcoord);
+        write(out,meshes[i].index,   mesh->index);
+      }
+      for (size_t i=0;i<textures.size();i++)
+        write(out,textures[i].pixel,model->textures[i]->pixel);
+      if (!out)
+        throw std::runtime_error("could not write model cache file "+tmpFile);
+    }
+    std::remove(cacheFile.c_str());
+    if (std::rename(tmpFile.c_str(),cacheFile.c_str()) != 0) {
+      std::remove(tmpFile.c_str());
+      throw std::runtime_error("could not write model cache file "+cacheFile);
+    }
+  }
+
+  // ------------------------------------------------------------------
+  // loading
+  // ------------------------------------------------------------------
+
+  /*! a read-only mapping of an entire file */
+  struct MappedFile {
+    ~MappedFile()
+    {
+#ifdef _WIN32
+      if (base) UnmapViewOfFile(base);
+      if (mapping) CloseHandle(mapping);
+      if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+      if (base) munmap(base,size);
+#endif
+    }
+
+    /*! returns false if the file doesn't exist, or can't be mapped */
+    bool map(const std::string &fileName)
+    {
+#ifdef _WIN32
+      file = CreateFileA(fileName.c_str(),GENERIC_READ,FILE_SHARE_READ,
+                         nullptr,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,nullptr);
+      if (file == INVALID_HANDLE_VALUE) return false;
+      LARGE_INTEGER fileSize;
+      if (!GetFileSizeEx(file,&fileSize) || fileSize.QuadPart == 0) return false;
+      size = (size_t)fileSize.QuadPart;
+      mapping = CreateFileMappingA(file,nullptr,PAGE_READONLY,0,0,nullptr);
+      if (!mapping) return false;
+      base = MapViewOfFile(mapping,FILE_MAP_READ,0,0,0);
+      return base != nullptr;
+#else
+      const int fd = open(fileName.c_str(),O_RDONLY);
+      if (fd < 0) return false;
+      struct stat info;
+      if (fstat(fd,&info) != 0 || info.st_size == 0) { close(fd); return false; }
+      size = (size_t)info.st_size;
+      void *ptr = mmap(nullptr,size,PROT_READ,MAP_PRIVATE,fd,0);
+      // the mapping stays valid after closing the file
+      close(fd);
+      if (ptr == MAP_FAILED) return false;
+      base = ptr;
+      return true;
+#endif
+    }
+
+    void  *base { nullptr };
+    size_t size { 0 };
+#ifdef _WIN32
+    HANDLE file    { INVALID_HANDLE_VALUE };
+    HANDLE mapping { nullptr };
+#endif
+  };
+
+  template<typename T>
+  static bool inFile(const CacheArray &array, uint64_t fileSize)
+  {
+    return array.count == 0
+      || (array.offset % cacheAlignment == 0
+          && array.offset <= fileSize
+          && array.count <= (fileSize-array.offset)/sizeof(T));
+  }
+
+  template<typename T>
+  static void setView(Array<T> &array, const CacheArray &cached, const uint8_t *base)
+  {
+    if (cached.count)
+      array.setView((const T *)(base+cached.offset),cached.count);
+  }
+
+  Model *loadModelCache(const std::string &cacheFile)
+  {
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->map(cacheFile) || file->size < sizeof(CacheHeader))
+      return nullptr;
+    const uint8_t *base = (const uint8_t *)file->base;
+    const uint64_t fileSize = file->size;
+
+    const CacheHeader &header = *(const CacheHeader *)base;
+    if (memcmp(header.magic,cacheMagic,sizeof(cacheMagic)) != 0 ||
+        header.version   != cacheVersion ||
+        header.byteOrder != cacheByteOrder ||
+        header.fileSize  != fileSize)
+      return nullptr;
+    if (header.meshesOffset > fileSize ||
+        header.numMeshes > (fileSize-header.meshesOffset)/sizeof(CacheMesh) ||
+        header.texturesOffset > fileSize ||
+        header.numTextures > (fileSize-header.texturesOffset)/sizeof(CacheTexture))
+      return nullptr;
+
+    std::vector<std::string> sourceFiles;
+    uint64_t offset = header.sourcesOffset;
+    for (uint64_t i=0;i<header.numSources;i++) {
+      uint32_t length;
+      if (offset+sizeof(length) > header.meshesOffset) return nullptr;
+      memcpy(&length,base+offset,sizeof(length));
+      offset += sizeof(length);
+      if (offset+length > header.meshesOffset) return nullptr;
+      sourceFiles.push_back(std::string((const char *)base+offset,length));
+      offset += length;
+    }
+    if (hashSources(sourceFiles) != header.sourceHash)
+      return nullptr;
+
+    const CacheMesh    *meshes   = (const CacheMesh *)(base+header.meshesOffset);
+    const CacheTexture *textures = (const CacheTexture *)(base+header.texturesOffset);
+    for (uint64_t i=0;i<header.numMeshes;i++)
+      if (!inFile<vec3f>(meshes[i].vertex,fileSize) ||
+          !inFile<vec3f>(meshes[i].normal,fileSize) ||
+          !inFile<vec2f>(meshes[i].texcoord,fileSize) ||
+          !inFile<vec3i>(meshes[i].index,fileSize) ||
+          meshes[i].diffuseTextureID < -1 ||
+          meshes[i].diffuseTextureID >= int64_t(header.numTextures))
+        return nullptr;
+    for (uint64_t i=0;i<header.numTextures;i++)
+      if (!inFile<uint32_t>(textures[i].pixel,fileSize) ||
+          textures[i].pixel.count != uint64_t(area(textures[i].resolution)))
+        return nullptr;
+
+    Model *model = new Model;
+    model->mapping = file;
+    model->bounds  = header.bounds;
+    for (uint64_t i=0;i<header.numMeshes;i++) {
+      TriangleMesh *mesh = new TriangleMesh;
+      setView(mesh->vertex,  meshes[i].vertex,  base);
+      setView(mesh->normal,  meshes[i].normal,  base);
+      setView(mesh->texcoord,meshes[i].texcoord,base);
+      setView(mesh->index,   meshes[i].index,   base);
+      mesh->diffuse          = meshes[i].diffuse;
+      mesh->diffuseTextureID = meshes[i].diffuseTextureID;
+      model->meshes.push_back(mesh);
+    }
+    for (uint64_t i=0;i<header.numTextures;i++) {
+      Texture *texture = new Texture;
+      setView(texture->pixel,textures[i].pixel,base);
+      texture->resolution = textures[i].resolution;
+      model->textures.push_back(texture);
+    }
+    return model;
+  }
+
+  Model *loadOBJCached(const std::string &objFile,
+                       const std::string &cacheFile)
+  {
+    const std::string fileName = cacheFile.empty() ? objFile+".oscache" : cacheFile;
+    if (Model *model = loadModelCache(fileName)) {
+      std::cout << "loaded model from cache file " << fileName << std::endl;
+      return model;
+    }
+    std::vector<std::string> sourceFiles;
+    Model *model = loadOBJ(objFile,&sourceFiles);
+    try {
+      saveModelCache(fileName,model,sourceFiles);
+      std::cout << "wrote model cache file " << fileName << std::endl;
+    } catch (std::runtime_error &e) {
+      std::cout << OWL_TERMINAL_RED
+                << "could not write model cache: " << e.what()
+                << OWL_TERMINAL_DEFAULT << std::endl;
+    }
+    return model;
+  }
+}
@@ -0,0 +1,48 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "Model.h"
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /*! writes the model - meshes, and decoded textures - to a binary
+      cache file, each array aligned such that it can be uploaded
+      straight from a mapping of that file. The cache records the
+      given source files (see loadOBJ()), and is only valid for as
+      long as none of them changes. Throws if the file can't be
+      written */
+  void saveModelCache(const std::string &cacheFile,
+                      const Model *model,
+                      const std::vector<std::string> &sourceFiles);
+
+  /*! memory-maps a model cache file: the returned model's arrays are
+      views into the mapping (which the model keeps alive), so
+      loading costs next to nothing, and only what actually gets used
+      is ever read from disk. Returns null if there's no such file,
+      or if it is out of date with respect to its source files, or
+      otherwise unusable */
+  Model *loadModelCache(const std::string &cacheFile);
+
+  /*! loads the OBJ file from its cache file ('cacheFile', or
+      objFile+".oscache") if that is up to date; otherwise loads the
+      OBJ file itself, and (tries to) write the cache for the next
+      time */
+  Model *loadOBJCached(const std::string &objFile,
+                       const std::string &cacheFile = "");
+}
@@ -16,6 +16,7 @@
 
 #include "SampleRenderer.h"
 #include "LaunchParams.h"
+#include "owl/common/image/MipChain.h"
 #include <string.h>
 #include <fstream>
 
@@ -90,19 +91,32 @@ namespace osc {
 
     textures.resize(numTextures);
 
+    // compute all textures' mip chains in parallel; minified lookups
+    // of the full-res textures would thrash the texture cache
+    std::vector<MipChain<uint32_t>> mipChains(numTextures);
+    parallel_for(numTextures,[&](int textureID){
+        const Texture *texture = model->textures[textureID];
+        MipOptions options;
+        options.filter = MIP_FILTER_KAISER;
+        mipChains[textureID]
+          = computeMipChain(texture->pixel.data(),texture->resolution,options);
+      });
+
     for (int textureID=0;textureID<numTextures;textureID++) {
-      auto texture = model->textures[textureID];
+      const Texture *texture = model->textures[textureID];
 
       int32_t width  = texture->resolution.x;
       int32_t height = texture->resolution.y;
+      const MipChain<uint32_t> &mipChain = mipChains[textureID];
       this->textures[textureID]
-        = owlTexture2DCreate(context,
-                             OWL_TEXEL_FORMAT_RGBA8,
-                             width,
-                             height,
-                             texture->pixel,
-                             OWL_TEXTURE_LINEAR,
-                             OWL_TEXTURE_CLAMP);
+        = owlTexture2DCreateMipmapped(context,
+                                      OWL_TEXEL_FORMAT_RGBA8,
+                                      width,
+                                      height,
+                                      mipChain.numLevels(),
+                                      mipChain.levelPointers().data(),
+                                      OWL_TEXTURE_LINEAR,
+                                      OWL_TEXTURE_CLAMP);
     }
   }
 
@@ -133,7 +147,8 @@ namespace osc {
     std::vector<OWLGeom> geoms;
     for (int meshID=0;meshID<numMeshes;meshID++) {
       // upload the model to the device: the builder
-      TriangleMesh &mesh = *model->meshes[meshID];
+      // (const, so meshes mapped from a model cache don't get copied)
+      const TriangleMesh &mesh = *model->meshes[meshID];
 
       OWLBuffer vertexBuffer
         = owlDeviceBufferCreate(context,OWL_FLOAT3,mesh.vertex.size(),
@@ -138,7 +138,24 @@ namespace osc {
         +         u * sbtData.texcoord[index.y]
         +         v * sbtData.texcoord[index.z];
       
-      vec4f fromTexture = tex2D<float4>(sbtData.texture,tc.x,tc.y);
+      // pick the mip level from the ray's footprint ("ray cones"):
+      // the pixel's spread angle times the distance, stretched by
+      // the incident angle, and scaled to texture space by the
+      // ratio of the triangle's texcoord and world space sizes
+      const auto &camera = optixLaunchParams.camera;
+      const float pixelSpread
+        = length(camera.vertical)
+        / (length(camera.direction)*optixLaunchParams.frame.fbSize.y);
+      const vec2f dA = sbtData.texcoord[index.y]-sbtData.texcoord[index.x];
+      const vec2f dB = sbtData.texcoord[index.z]-sbtData.texcoord[index.x];
+      const float uvArea    = fabsf(dA.x*dB.y-dA.y*dB.x);
+      const float worldArea = length(cross(B-A,C-A));
+      const float footprint
+        = optixGetRayTmax()*pixelSpread/fmaxf(fabsf(dot(rayDir,Ng)),1e-2f);
+      const float duv = footprint*sqrtf(uvArea/fmaxf(worldArea,1e-20f));
+      vec4f fromTexture = tex2DGrad<float4>(sbtData.texture,tc.x,tc.y,
+                                            make_float2(duv,0.f),
+                                            make_float2(0.f,duv));
       diffuseColor *= (vec3f)fromTexture;
     }
 
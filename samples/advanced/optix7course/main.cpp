@@ -15,6 +15,7 @@
 // ======================================================================== //
 
 #include "SampleRenderer.h"
+#include "ModelCache.h"
 
 // our helper library for window handling
 #include "owlViewer/OWLViewer.h"
@@ -119,7 +120,7 @@ namespace osc {
     if (ac == 2)
       inFileName = av[1];
     try {
-      Model *model = loadOBJ(inFileName);
+      Model *model = loadOBJCached(inFileName);
       Camera camera = { /*from*/vec3f(-1293.07f, 154.681f, -0.7304f),
                         /* at */model->bounds.center()-vec3f(0,400,0),
                         /* up */vec3f(0.f,1.f,0.f) };
@@ -23,7 +23,7 @@
 #include "GeomTypes.h"
 // external helper stuff for image output
 #define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb/stb_image_write.h"
+#include "owl/common/image/ImageWriter.h"
 
 #include <random>
 
@@ -311,8 +311,7 @@ int main(int ac, char **av)
   // for host pinned mem it doesn't matter which device we query...
   const uint32_t *fb
     = (const uint32_t*)owlBufferGetPointer(frameBuffer,0);
-  stbi_write_png(outFileName,fbSize.x,fbSize.y,4,
-                 fb,fbSize.x*sizeof(uint32_t));
+  owl::common::writeImage(outFileName,owl::common::ImageView::rgba8(fb,fbSize));
   LOG_OK("written rendered frame buffer to file "<<outFileName);
 
   // ##################################################################
@@ -104,15 +104,6 @@ namespace owl {
     vec2i  fbSize;
     OptixTraversableHandle world;
 
-    /*! index of the device that the current programs are running on;
-        filled in automatically by owl as long as it is exported as a
-        variable of type OWL_DEVICE */
-    int deviceIndex;
-    /*! number of devices that are available in the context; set by
-        the app by querying owlGetDeviceCount and then assigning this
-        via a int variable. */
-    int deviceCount;
-    
     struct {
       vec3f origin;
       vec3f lower_left_corner;
@@ -121,6 +112,26 @@ namespace owl {
     } camera;
   };
 
+  /* which tiles of the frame buffer each device renders in a given
+     frame; computed on the host by a owl::common::DeviceTileBalancer,
+     and the same on all devices */
+  struct LaunchParams
+  {
+    /*! index of the device that the current programs are running on;
+        filled in automatically by owl as long as it is exported as a
+        variable of type OWL_DEVICE */
+    int deviceIndex;
+    /*! the tiles that device 'd' renders are
+        tileIDs[tileBegin[d]..tileBegin[d+1]) */
+    int *tileIDs;
+    int *tileBegin;
+    vec2i tileSize;
+    int   numTilesX;
+    /*! clock cycles spent per tile, so the host can tell which parts
+        of the frame are expensive */
+    unsigned long long *tileCycles;
+  };
+
   struct MissProgData
   {
     /* nothing in this example */
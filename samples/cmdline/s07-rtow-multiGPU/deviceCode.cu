@@ -19,6 +19,8 @@
 
 using namespace owl;
 
+extern "C" __constant__ LaunchParams optixLaunchParams;
+
 #define NUM_SAMPLES_PER_PIXEL 16
 
 // ==================================================================
@@ -252,17 +254,25 @@ vec3f tracePath(const RayGenData &self,
 OPTIX_RAYGEN_PROGRAM(rayGen)()
 {
   const RayGenData &self = owl::getProgramData<RayGenData>();
-  const vec2i pixelID = owl::getLaunchIndex();
+  const LaunchParams &lp = optixLaunchParams;
+
+  /* each device gets launched over (tileSize.x,numTiles*tileSize.y)
+     threads, for the tiles the host assigned to it: the launch
+     index's y coordinate tells which of these tiles, and which row
+     in that tile */
+  const vec2i launchIdx = owl::getLaunchIndex();
+  const int tileID
+    = lp.tileIDs[lp.tileBegin[lp.deviceIndex] + launchIdx.y / lp.tileSize.y];
+  const vec2i tile(tileID % lp.numTilesX, tileID / lp.numTilesX);
+  const vec2i pixelID
+    = tile*lp.tileSize + vec2i(launchIdx.x, launchIdx.y % lp.tileSize.y);
+  /* (tiles along the right and top border may be partial) */
+  if (pixelID.x >= self.fbSize.x || pixelID.y >= self.fbSize.y)
+    return;
+  const long long begin = clock64();
   
   const int pixelIdx = pixelID.x+self.fbSize.x*(self.fbSize.y-1-pixelID.y);
 
-  /* compute who is repsonible for a given group of pixels: */
-  int deviceThatIsResponsible = (pixelID.x>>5) % self.deviceCount;
-  /* ... and if it's not us, just return (some other device will
-     compute these pixels */
-  if (self.deviceIndex != deviceThatIsResponsible)
-    return;
-  
   PerRayData prd;
   prd.random.init(pixelID.x,pixelID.y);
   
@@ -290,6 +300,8 @@ OPTIX_RAYGEN_PROGRAM(rayGen)()
     
   self.fbPtr[pixelIdx]
     = owl::make_rgba(color * (1.f / NUM_SAMPLES_PER_PIXEL));
+
+  atomicAdd(&lp.tileCycles[tileID],(unsigned long long)(clock64()-begin));
 }
 
 
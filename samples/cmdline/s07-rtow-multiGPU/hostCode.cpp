@@ -23,9 +23,13 @@
 #include "GeomTypes.h"
 // external helper stuff for image output
 #define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb/stb_image_write.h"
+#include "owl/common/image/ImageWriter.h"
+// decides which device renders which tiles
+#include "owl/common/parallel/DeviceTileBalancer.h"
+#include "owl/helper/cuda.h"
 
 #include <random>
+#include <sstream>
 
 #define LOG(message)                                            \
   std::cout << OWL_TERMINAL_BLUE;                               \
@@ -44,6 +48,10 @@ const vec3f lookFrom(13, 2, 3);
 const vec3f lookAt(0, 0, 0);
 const vec3f lookUp(0.f,1.f,0.f);
 const float fovy = 20.f;
+/*! we render the same frame several times, to show how the work
+    distribution adapts to what each device measured in the frames
+    before */
+const int numFrames = 8;
 
 std::vector<DielectricSphere> dielectricSpheres;
 std::vector<LambertianSphere> lambertianSpheres;
@@ -504,8 +512,6 @@ int main(int ac, char **av)
   // set up ray gen program
   // -------------------------------------------------------
   OWLVarDecl rayGenVars[] = {
-    { "deviceIndex",   OWL_DEVICE, OWL_OFFSETOF(RayGenData,deviceIndex)},
-    { "deviceCount",   OWL_INT,    OWL_OFFSETOF(RayGenData,deviceCount)},
     { "fbPtr",         OWL_BUFPTR, OWL_OFFSETOF(RayGenData,fbPtr)},
     { "fbSize",        OWL_INT2,   OWL_OFFSETOF(RayGenData,fbSize)},
     { "world",         OWL_GROUP,  OWL_OFFSETOF(RayGenData,world)},
@@ -551,7 +557,50 @@ int main(int ac, char **av)
   owlRayGenSet3f    (rayGen,"camera.horiz", (const owl3f&)horizontal);
   owlRayGenSet3f    (rayGen,"camera.vert",  (const owl3f&)vertical);
 
-  owlRayGenSet1i    (rayGen,"deviceCount",  numGPUsFound);
+  // -------------------------------------------------------
+  // set up launch params: which device renders which tiles
+  // -------------------------------------------------------
+  DeviceTileBalancer balancer(numGPUsFound);
+  balancer.resize(fbSize);
+  const int numTiles = balancer.getNumTiles();
+
+  OWLVarDecl launchParamsVars[] = {
+    { "deviceIndex", OWL_DEVICE, OWL_OFFSETOF(LaunchParams,deviceIndex)},
+    { "tileIDs",     OWL_BUFPTR, OWL_OFFSETOF(LaunchParams,tileIDs)},
+    { "tileBegin",   OWL_BUFPTR, OWL_OFFSETOF(LaunchParams,tileBegin)},
+    { "tileSize",    OWL_INT2,   OWL_OFFSETOF(LaunchParams,tileSize)},
+    { "numTilesX",   OWL_INT,    OWL_OFFSETOF(LaunchParams,numTilesX)},
+    { "tileCycles",  OWL_BUFPTR, OWL_OFFSETOF(LaunchParams,tileCycles)},
+    { /* sentinel to mark end of list */ }
+  };
+  OWLParams launchParams
+    = owlParamsCreate(context,sizeof(LaunchParams),launchParamsVars,-1);
+  OWLBuffer tileIDsBuffer
+    = owlDeviceBufferCreate(context,OWL_INT,numTiles,nullptr);
+  OWLBuffer tileBeginBuffer
+    = owlDeviceBufferCreate(context,OWL_INT,numGPUsFound+1,nullptr);
+  OWLBuffer tileCyclesBuffer
+    = owlDeviceBufferCreate(context,OWL_ULONG,numTiles,nullptr);
+  owlParamsSetBuffer(launchParams,"tileIDs",   tileIDsBuffer);
+  owlParamsSetBuffer(launchParams,"tileBegin", tileBeginBuffer);
+  owlParamsSetBuffer(launchParams,"tileCycles",tileCyclesBuffer);
+  owlParamsSet2i    (launchParams,"tileSize",
+                     (const owl2i&)balancer.config.tileSize);
+  owlParamsSet1i    (launchParams,"numTilesX",balancer.getNumTilesPerDim().x);
+
+  // cuda events for measuring each device's time, created on the
+  // device that the respective owl device runs on
+  std::vector<int>         cudaDevice(numGPUsFound);
+  std::vector<cudaEvent_t> launchBegin(numGPUsFound), launchEnd(numGPUsFound);
+  for (int d=0;d<numGPUsFound;d++) {
+    cudaPointerAttributes attributes;
+    OWL_CUDA_CHECK(cudaPointerGetAttributes
+                   (&attributes,owlBufferGetPointer(tileCyclesBuffer,d)));
+    cudaDevice[d] = attributes.device;
+    OWL_CUDA_CHECK(cudaSetDevice(cudaDevice[d]));
+    OWL_CUDA_CHECK(cudaEventCreate(&launchBegin[d]));
+    OWL_CUDA_CHECK(cudaEventCreate(&launchEnd[d]));
+  }
 
   // ##################################################################
   // build *SBT* required to trace the groups
@@ -567,21 +616,72 @@ int main(int ac, char **av)
   // now that everything is ready: launch it ....
   // ##################################################################
 
-  LOG("launching ...");
-  owlRayGenLaunch2D(rayGen,fbSize.x,fbSize.y);
+  std::vector<double>             deviceTimes(numGPUsFound);
+  std::vector<double>             tileCosts(numTiles);
+  std::vector<unsigned long long> tileCycles(numTiles);
+  for (int frameID=0;frameID<numFrames;frameID++) {
+    const DeviceTileBalancer::Assignment &assignment = balancer.nextFrame();
+    owlBufferUpload(tileIDsBuffer,assignment.tileIDs.data());
+    owlBufferUpload(tileBeginBuffer,assignment.begin.data());
+    owlBufferClear(tileCyclesBuffer);
+
+    // one launch per device, over just its tiles; all of them write
+    // into the same (host pinned) frame buffer
+    const vec2i tileSize = balancer.config.tileSize;
+    for (int d=0;d<numGPUsFound;d++) {
+      if (assignment.numTiles(d) == 0) continue;
+      CUstream stream = owlParamsGetCudaStream(launchParams,d);
+      OWL_CUDA_CHECK(cudaSetDevice(cudaDevice[d]));
+      OWL_CUDA_CHECK(cudaEventRecord(launchBegin[d],stream));
+      owlAsyncLaunch2DOnDevice(rayGen,tileSize.x,
+                               tileSize.y*assignment.numTiles(d),
+                               d,launchParams);
+      OWL_CUDA_CHECK(cudaSetDevice(cudaDevice[d]));
+      OWL_CUDA_CHECK(cudaEventRecord(launchEnd[d],stream));
+    }
+    owlLaunchSync(launchParams);
+
+    // tell the balancer what each device took, and where that time
+    // went; every tile got rendered by exactly one device, the other
+    // devices' counters for that tile stayed zero
+    std::fill(tileCosts.begin(),tileCosts.end(),0.);
+    std::stringstream perDevice;
+    for (int d=0;d<numGPUsFound;d++) {
+      deviceTimes[d] = 0.;
+      if (assignment.numTiles(d) == 0) continue;
+      float ms = 0.f;
+      OWL_CUDA_CHECK(cudaSetDevice(cudaDevice[d]));
+      OWL_CUDA_CHECK(cudaEventElapsedTime(&ms,launchBegin[d],launchEnd[d]));
+      deviceTimes[d] = ms*1e-3;
+      OWL_CUDA_CHECK(cudaMemcpy(tileCycles.data(),
+                                owlBufferGetPointer(tileCyclesBuffer,d),
+                                numTiles*sizeof(tileCycles[0]),
+                                cudaMemcpyDeviceToHost));
+      for (int t=0;t<numTiles;t++)
+        tileCosts[t] += double(tileCycles[t]);
+      perDevice << " #" << d << ": " << assignment.numTiles(d)
+                << " tiles, " << ms << "ms;";
+    }
+    balancer.update(deviceTimes,tileCosts);
+    LOG("frame " << frameID << ":" << perDevice.str());
+  }
 
   LOG("done with launch, writing picture ...");
   // for host pinned mem it doesn't matter which device we query...
   const uint32_t *fb
     = (const uint32_t*)owlBufferGetPointer(frameBuffer,0);
-  stbi_write_png(outFileName,fbSize.x,fbSize.y,4,
-                 fb,fbSize.x*sizeof(uint32_t));
+  owl::common::writeImage(outFileName,owl::common::ImageView::rgba8(fb,fbSize));
   LOG_OK("written rendered frame buffer to file "<<outFileName);
 
   // ##################################################################
   // and finally, clean up
   // ##################################################################
 
+  for (int d=0;d<numGPUsFound;d++) {
+    OWL_CUDA_CHECK(cudaSetDevice(cudaDevice[d]));
+    cudaEventDestroy(launchBegin[d]);
+    cudaEventDestroy(launchEnd[d]);
+  }
   LOG("destroying devicegroup ...");
   owlContextDestroy(context);
 
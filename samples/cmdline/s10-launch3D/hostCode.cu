@@ -23,7 +23,7 @@
 #include "GeomTypes.h"
 // external helper stuff for image output
 #define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb/stb_image_write.h"
+#include "owl/common/image/ImageWriter.h"
 
 #include <random>
 #include <optix_device.h>
@@ -339,8 +339,7 @@ int main(int ac, char **av)
   // ------------------------------------------------------------------
   // frame buffer not in png friendly form, let's write it
   // ------------------------------------------------------------------
-  stbi_write_png(outFileName,fbSize.x,fbSize.y,4,
-                 fb,fbSize.x*sizeof(uint32_t));
+  owl::common::writeImage(outFileName,owl::common::ImageView::rgba8(fb,fbSize));
   cudaFree(fb);
   LOG_OK("written rendered frame buffer to file "<<outFileName);
 
@@ -0,0 +1,60 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#include "deviceCode.h"
+#include <optix_device.h>
+
+extern "C" __constant__ LaunchParams optixLaunchParams;
+
+struct PerRayData {
+  float t;
+  int   pieceID;
+};
+
+/* one thread per ray (the launch is 2D only because the number of
+   rays can exceed what a 1D launch allows) */
+OPTIX_RAYGEN_PROGRAM(traceRays)()
+{
+  const LaunchParams &lp = optixLaunchParams;
+  const int rayID
+    = owl::getLaunchIndex().x
+    + owl::getLaunchDims().x * owl::getLaunchIndex().y;
+  if (rayID >= lp.numRays) return;
+
+  const RayIn in = lp.rays[rayID];
+  owl::Ray ray(in.org,in.dir,in.tmin,in.tmax);
+  PerRayData prd;
+  prd.t       = in.tmax;
+  prd.pieceID = -1;
+  owl::traceRay(lp.world,ray,prd);
+
+  lp.hits[rayID].t       = prd.t;
+  lp.hits[rayID].pieceID = prd.pieceID;
+}
+
+OPTIX_CLOSEST_HIT_PROGRAM(piece)()
+{
+  const PieceGeomData &self = owl::getProgramData<PieceGeomData>();
+  PerRayData &prd = owl::getPRD<PerRayData>();
+  prd.t       = optixGetRayTmax();
+  prd.pieceID = self.pieceID;
+}
+
+OPTIX_MISS_PROGRAM(miss)()
+{
+  /* nothing to do, the ray generation program already set 'no hit' */
+}
@@ -1,5 +1,5 @@
 // ======================================================================== //
-// Copyright 2018-2019 Ingo Wald                                            //
+// Copyright 2019-2021 Ingo Wald                                            //
 //                                                                          //
 // Licensed under the Apache License, Version 2.0 (the "License");          //
 // you may not use this file except in compliance with the License.         //
@@ -14,12 +14,41 @@
 // limitations under the License.                                           //
 // ======================================================================== //
 
-#include "gdt/parallel/parallel_for.h"
 
-namespace owl {
-  namespace common {
+#pragma once
 
-    tbb::task_scheduler_init tbb_init(tbb::task_scheduler_init::automatic);
-  
-  } // ::owl::common
-} // ::owl
+#include <owl/owl.h>
+#include <owl/common/math/vec.h>
+
+using namespace owl;
+
+/* a ray to trace; same layout as owl::common::RoutedRay, so the
+   rays the host-side ray exchange hands out can get uploaded as
+   they are */
+struct RayIn {
+  vec3f org;
+  float tmin;
+  vec3f dir;
+  float tmax;
+};
+
+/* the closest hit of a ray, within this context's part of the
+   scene */
+struct HitOut {
+  float t;
+  /*! ID of the piece of the scene that got hit, or -1 */
+  int   pieceID;
+};
+
+/* variables for the triangle mesh geometry - one mesh per piece */
+struct PieceGeomData {
+  int pieceID;
+};
+
+/* launch params: trace a list of rays, and write back their hits */
+struct LaunchParams {
+  RayIn  *rays;
+  HitOut *hits;
+  int     numRays;
+  OptixTraversableHandle world;
+};
@@ -0,0 +1,397 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+// This sample renders a scene that is *distributed* across GPUs
+// rather than replicated on all of them: the scene's pieces get split
+// up by owl::common::partitionScene(), every partition gets its own
+// owl context over just one GPU (and holding only its own pieces),
+// and owl::common::traceDataParallel() forwards rays from one
+// partition to the next until they have found their closest hit. On
+// a single GPU it runs several partitions side by side on that one
+// GPU, which exercises the same code path. The result gets compared
+// to tracing the whole scene in a single context.
+
+// public owl node-graph API
+#include "owl/owl.h"
+// our device-side data structures
+#include "deviceCode.h"
+// host-side partitioning and ray forwarding
+#include "owl/common/parallel/ScenePartitioner.h"
+#include "owl/common/parallel/RayExchange.h"
+// external helper stuff for image output
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "owl/common/image/ImageWriter.h"
+#include <memory>
+#include <random>
+
+#define LOG(message)                                            \
+  std::cout << OWL_TERMINAL_BLUE;                               \
+  std::cout << "#owl.sample(main): " << message << std::endl;   \
+  std::cout << OWL_TERMINAL_DEFAULT;
+#define LOG_OK(message)                                         \
+  std::cout << OWL_TERMINAL_LIGHT_BLUE;                         \
+  std::cout << "#owl.sample(main): " << message << std::endl;   \
+  std::cout << OWL_TERMINAL_DEFAULT;
+
+extern "C" char deviceCode_ptx[];
+
+using owl::common::RoutedRay;
+using owl::common::RoutedHit;
+using owl::common::QueuedRay;
+
+static_assert(sizeof(RayIn) == sizeof(RoutedRay),
+              "device-side rays have to match owl::common::RoutedRay");
+
+const char *outFileName = "s12-dataParallel.png";
+const vec2i fbSize(800,600);
+const vec3f lookFrom(-40.f,30.f,-25.f);
+const vec3f lookAt(0.f,0.f,0.f);
+const vec3f lookUp(0.f,1.f,0.f);
+const float cosFovy = 0.66f;
+
+/*! the scene is a 'city' of gridSize x gridSize boxes, each of which
+    is one piece that the partitioner can put on any device */
+const int gridSize = 32;
+
+const int NUM_VERTICES = 8;
+const int NUM_INDICES = 12;
+vec3i indices[NUM_INDICES] =
+  {
+    { 0,1,3 }, { 2,3,0 },
+    { 5,7,6 }, { 5,6,4 },
+    { 0,4,5 }, { 0,5,1 },
+    { 2,3,7 }, { 2,7,6 },
+    { 1,5,7 }, { 1,7,3 },
+    { 4,0,2 }, { 4,2,6 }
+  };
+
+/*! host-side equivalent of owl::make_rgba() */
+inline uint32_t makeRGBA(const vec3f &color)
+{
+  auto to8bit = [](float f) { return uint32_t(std::min(255,std::max(0,int(f*256.f)))); };
+  return
+    (to8bit(color.x) << 0) +
+    (to8bit(color.y) << 8) +
+    (to8bit(color.z) << 16) +
+    (0xffU << 24);
+}
+
+/*! rays get traced in 2D launches of this width */
+const int launchWidth = 1024;
+
+/*! one owl context, over a single GPU, holding only some of the
+    pieces of the scene */
+struct Partition {
+  Partition(int gpuID,
+            const std::vector<box3f> &pieceBounds,
+            const std::vector<int>   &pieceIDs);
+  ~Partition() { owlContextDestroy(context); }
+
+  /*! closest hits of the given rays within this partition - this is
+      what traceDataParallel() calls */
+  void trace(const std::vector<QueuedRay> &rays,
+             std::vector<RoutedHit> &hits);
+
+  /*! bytes of device memory this partition's context uses */
+  size_t memoryUsed() const
+  {
+    size_t bytesUsed = 0;
+    owlContextGetDeviceMemoryInfo(context,0,&bytesUsed,nullptr);
+    return bytesUsed;
+  }
+
+  OWLContext context;
+  OWLRayGen  rayGen;
+  OWLParams  params;
+  OWLBuffer  raysBuffer;
+  OWLBuffer  hitsBuffer;
+};
+
+Partition::Partition(int gpuID,
+                     const std::vector<box3f> &pieceBounds,
+                     const std::vector<int>   &pieceIDs)
+{
+  context = owlContextCreate(&gpuID,1);
+  OWLModule module = owlModuleCreate(context,deviceCode_ptx);
+
+  // -------------------------------------------------------
+  // one triangle mesh per piece, all in one group
+  // -------------------------------------------------------
+  OWLVarDecl pieceGeomVars[] = {
+    { "pieceID", OWL_INT, OWL_OFFSETOF(PieceGeomData,pieceID)},
+    { /* sentinel to mark end of list */ }
+  };
+  OWLGeomType pieceGeomType
+    = owlGeomTypeCreate(context,
+                        OWL_TRIANGLES,
+                        sizeof(PieceGeomData),
+                        pieceGeomVars,-1);
+  owlGeomTypeSetClosestHit(pieceGeomType,0,
+                           module,"piece");
+
+  OWLGroup world = nullptr;
+  if (!pieceIDs.empty()) {
+    OWLBuffer indexBuffer
+      = owlDeviceBufferCreate(context,OWL_INT3,NUM_INDICES,indices);
+    std::vector<OWLGeom> geoms;
+    for (int pieceID : pieceIDs) {
+      const box3f &box = pieceBounds[pieceID];
+      vec3f vertices[NUM_VERTICES];
+      for (int i=0;i<NUM_VERTICES;i++)
+        vertices[i] = vec3f((i & 1) ? box.upper.x : box.lower.x,
+                            (i & 2) ? box.upper.y : box.lower.y,
+                            (i & 4) ? box.upper.z : box.lower.z);
+      OWLBuffer vertexBuffer
+        = owlDeviceBufferCreate(context,OWL_FLOAT3,NUM_VERTICES,vertices);
+      OWLGeom geom = owlGeomCreate(context,pieceGeomType);
+      owlTrianglesSetVertices(geom,vertexBuffer,
+                              NUM_VERTICES,sizeof(vec3f),0);
+      owlTrianglesSetIndices(geom,indexBuffer,
+                             NUM_INDICES,sizeof(vec3i),0);
+      owlGeomSet1i(geom,"pieceID",pieceID);
+      geoms.push_back(geom);
+    }
+    OWLGroup piecesGroup
+      = owlTrianglesGeomGroupCreate(context,geoms.size(),geoms.data());
+    owlGroupBuildAccel(piecesGroup);
+    world = owlInstanceGroupCreate(context,1,&piecesGroup);
+    owlGroupBuildAccel(world);
+  }
+
+  // -------------------------------------------------------
+  // programs, and the launch params the rays come in with
+  // -------------------------------------------------------
+  owlMissProgCreate(context,module,"miss",
+                    /* no sbt data: */0,nullptr,-1);
+  rayGen
+    = owlRayGenCreate(context,module,"traceRays",
+                      /* no sbt data: */0,nullptr,-1);
+
+  OWLVarDecl launchParamsVars[] = {
+    { "rays",    OWL_BUFPTR, OWL_OFFSETOF(LaunchParams,rays)},
+    { "hits",    OWL_BUFPTR, OWL_OFFSETOF(LaunchParams,hits)},
+    { "numRays", OWL_INT,    OWL_OFFSETOF(LaunchParams,numRays)},
+    { "world",   OWL_GROUP,  OWL_OFFSETOF(LaunchParams,world)},
+    { /* sentinel to mark end of list */ }
+  };
+  params
+    = owlParamsCreate(context,sizeof(LaunchParams),launchParamsVars,-1);
+  raysBuffer
+    = owlDeviceBufferCreate(context,OWL_USER_TYPE(RayIn),1,nullptr);
+  hitsBuffer
+    = owlHostPinnedBufferCreate(context,OWL_USER_TYPE(HitOut),1);
+  if (world)
+    owlParamsSetGroup(params,"world",world);
+
+  owlBuildPrograms(context);
+  owlBuildPipeline(context);
+  owlBuildSBT(context);
+}
+
+void Partition::trace(const std::vector<QueuedRay> &rays,
+                      std::vector<RoutedHit> &hits)
+{
+  const int numRays = (int)rays.size();
+  std::vector<RayIn> deviceRays(numRays);
+  for (int i=0;i<numRays;i++) {
+    const RoutedRay &ray = rays[i].ray;
+    deviceRays[i].org  = ray.org;
+    deviceRays[i].tmin = ray.tmin;
+    deviceRays[i].dir  = ray.dir;
+    deviceRays[i].tmax = ray.tmax;
+  }
+  owlBufferResize(raysBuffer,numRays);
+  owlBufferUpload(raysBuffer,deviceRays.data());
+  owlBufferResize(hitsBuffer,numRays);
+
+  // (resizing may have moved the buffers, so set them every time)
+  owlParamsSetBuffer(params,"rays",raysBuffer);
+  owlParamsSetBuffer(params,"hits",hitsBuffer);
+  owlParamsSet1i(params,"numRays",numRays);
+  owlLaunch2D(rayGen,launchWidth,(numRays+launchWidth-1)/launchWidth,params);
+
+  const HitOut *deviceHits
+    = (const HitOut *)owlBufferGetPointer(hitsBuffer,0);
+  for (int i=0;i<numRays;i++)
+    if (deviceHits[i].pieceID >= 0) {
+      hits[i].t      = deviceHits[i].t;
+      hits[i].primID = deviceHits[i].pieceID;
+    }
+}
+
+int main(int ac, char **av)
+{
+  LOG("owl::ng example '" << av[0] << "' starting up");
+
+  // ##################################################################
+  // find out what GPUs we have, and how many partitions to use
+  // ##################################################################
+  OWLContext probe = owlContextCreate(nullptr,0);
+  const int numGPUs = owlGetDeviceCount(probe);
+  std::vector<size_t> gpuMemory(numGPUs);
+  for (int i=0;i<numGPUs;i++)
+    owlContextGetDeviceMemoryInfo(probe,i,nullptr,&gpuMemory[i]);
+  owlContextDestroy(probe);
+
+  // with only one GPU, use two partitions on that GPU anyway, so the
+  // rays still have to get forwarded
+  int numPartitions = std::max(numGPUs,2);
+  for (int i=1;i<ac;i++) {
+    const std::string arg = av[i];
+    if ((arg == "-n" || arg == "--partitions") && i+1 < ac)
+      numPartitions = std::max(1,atoi(av[++i]));
+    else if (arg == "-o" && i+1 < ac)
+      outFileName = av[++i];
+    else
+      throw std::runtime_error("unknown cmdline argument '"+arg+"'");
+  }
+  LOG("distributing scene across " << numPartitions << " partition(s) on "
+      << numGPUs << " GPU(s)");
+
+  // ##################################################################
+  // the scene's pieces, and which partition gets which
+  // ##################################################################
+  std::mt19937 rng(0x5eed);
+  std::uniform_real_distribution<float> height(.5f,6.f);
+  std::vector<box3f>  pieceBounds;
+  std::vector<size_t> pieceBytes;
+  for (int iz=0;iz<gridSize;iz++)
+    for (int ix=0;ix<gridSize;ix++) {
+      const vec3f lower(2.f*ix-gridSize,0.f,2.f*iz-gridSize);
+      pieceBounds.push_back(box3f(lower,lower+vec3f(1.4f,height(rng),1.4f)));
+      pieceBytes.push_back(NUM_VERTICES*sizeof(vec3f)
+                           +NUM_INDICES*sizeof(vec3i));
+    }
+
+  // partitions that share a GPU share its memory
+  std::vector<size_t> partitionMemory(numPartitions);
+  for (int p=0;p<numPartitions;p++) {
+    const int gpuID = p % numGPUs;
+    const int sharing = numPartitions/numGPUs + (gpuID < numPartitions%numGPUs);
+    partitionMemory[p] = gpuMemory[gpuID]/sharing;
+  }
+  const owl::common::ScenePartition scenePartition
+    = owl::common::partitionScene(pieceBounds,pieceBytes,partitionMemory);
+
+  std::vector<std::unique_ptr<Partition>> partitions;
+  for (int p=0;p<numPartitions;p++) {
+    const std::vector<int> pieceIDs = scenePartition.piecesOf(p);
+    partitions.emplace_back(new Partition(p % numGPUs,pieceBounds,pieceIDs));
+    LOG("partition #" << p << " on GPU #" << (p % numGPUs) << ": "
+        << pieceIDs.size() << " pieces, "
+        << prettyNumber(partitions.back()->memoryUsed()) << "B of device memory");
+  }
+
+  // ##################################################################
+  // generate primary rays, and trace them through all partitions
+  // ##################################################################
+  vec3f camera_d00
+    = normalize(lookAt-lookFrom);
+  float aspect = fbSize.x / float(fbSize.y);
+  vec3f camera_ddu
+    = cosFovy * aspect * normalize(cross(camera_d00,lookUp));
+  vec3f camera_ddv
+    = cosFovy * normalize(cross(camera_ddu,camera_d00));
+  camera_d00 -= 0.5f * camera_ddu;
+  camera_d00 -= 0.5f * camera_ddv;
+
+  std::vector<RoutedRay> rays(fbSize.x*fbSize.y);
+  for (int iy=0;iy<fbSize.y;iy++)
+    for (int ix=0;ix<fbSize.x;ix++) {
+      const vec2f screen = (vec2f(ix,iy)+vec2f(.5f)) / vec2f(fbSize);
+      RoutedRay &ray = rays[ix+fbSize.x*iy];
+      ray.org  = lookFrom;
+      ray.dir  = normalize(camera_d00
+                           + screen.u * camera_ddu
+                           + screen.v * camera_ddv);
+      ray.tmin = 0.f;
+      ray.tmax = std::numeric_limits<float>::infinity();
+    }
+
+  LOG("tracing ...");
+  const owl::common::RayRouter router(scenePartition.deviceBounds);
+  std::vector<RoutedHit> hits;
+  owl::common::RayExchangeStats stats;
+  owl::common::traceDataParallel
+    (router,rays,hits,
+     [&](int partitionID,
+         const std::vector<QueuedRay> &queued,
+         std::vector<RoutedHit> &queuedHits)
+     { partitions[partitionID]->trace(queued,queuedHits); },
+     &stats);
+  LOG("traced " << prettyNumber(rays.size()) << " rays in "
+      << stats.numRounds << " rounds; "
+      << prettyNumber(stats.numRayTraces-std::min(stats.numRayTraces,rays.size()))
+      << " times a ray got forwarded to another partition");
+
+  // ##################################################################
+  // compare to tracing the whole scene in one context
+  // ##################################################################
+  LOG("tracing whole scene in a single context, for reference ...");
+  std::vector<int> allPieceIDs(pieceBounds.size());
+  for (size_t i=0;i<allPieceIDs.size();i++) allPieceIDs[i] = int(i);
+  size_t numMismatches = 0;
+  {
+    Partition reference(0,pieceBounds,allPieceIDs);
+    std::vector<QueuedRay> queued(rays.size());
+    for (size_t i=0;i<rays.size();i++)
+      queued[i] = QueuedRay{rays[i],int(i),0};
+    std::vector<RoutedHit> referenceHits(rays.size());
+    reference.trace(queued,referenceHits);
+    for (size_t i=0;i<rays.size();i++)
+      if (referenceHits[i].primID != hits[i].primID)
+        numMismatches++;
+    LOG("single context uses " << prettyNumber(reference.memoryUsed())
+        << "B of device memory");
+  }
+
+  // ##################################################################
+  // color by partition, with some variation by piece
+  // ##################################################################
+  const vec3f partitionColors[] = {
+    vec3f(.9f,.3f,.2f), vec3f(.2f,.7f,.3f), vec3f(.2f,.4f,.9f),
+    vec3f(.9f,.8f,.2f), vec3f(.7f,.3f,.8f), vec3f(.2f,.8f,.8f),
+    vec3f(.9f,.5f,.1f), vec3f(.6f,.6f,.6f)
+  };
+  std::vector<uint32_t> fb(rays.size());
+  for (size_t i=0;i<rays.size();i++) {
+    const RoutedHit &hit = hits[i];
+    vec3f color(.15f);
+    if (hit.hit()) {
+      const float variation = .6f + .4f*((hit.primID*2654435761u >> 16) & 0xff)/255.f;
+      color = variation * partitionColors[hit.deviceID % 8];
+    }
+    fb[i] = makeRGBA(color);
+  }
+  owl::common::writeImage(outFileName,owl::common::ImageView::rgba8(fb.data(),fbSize));
+  LOG_OK("written rendered frame buffer to file "<<outFileName);
+
+  // ##################################################################
+  // and finally, clean up
+  // ##################################################################
+  partitions.clear();
+
+  if (numMismatches) {
+    std::cout << OWL_TERMINAL_RED
+              << "#owl.sample(main): " << numMismatches
+              << " rays found a different closest hit than in the single context"
+              << OWL_TERMINAL_DEFAULT << std::endl;
+    return 1;
+  }
+  LOG_OK("all rays found the same hits as in the single context; app is done");
+  return 0;
+}
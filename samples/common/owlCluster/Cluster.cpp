@@ -0,0 +1,357 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "Cluster.h"
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+namespace owl {
+  namespace cluster {
+
+    /*! the messages between lead and workers; each starts with its
+        type */
+    enum MessageType : uint32_t {
+      /*! lead to worker: frame number, mode and size, the tiles to
+          render, and what changed in the parameters */
+      MESSAGE_FRAME = 1,
+      /*! worker to lead: one rendered tile */
+      MESSAGE_TILE,
+      /*! worker to lead: all tiles of the frame have been sent */
+      MESSAGE_FRAME_DONE,
+      /*! lead to worker: stop */
+      MESSAGE_SHUTDOWN
+    };
+
+    inline void writePixels(MessageWriter &out, const uint32_t *words,
+                            size_t numWords, bool compress,
+                            std::vector<uint8_t> &scratch)
+    {
+      if (compress) {
+        compressWords(words,numWords,scratch);
+        out.write(uint64_t(scratch.size()));
+        out.writeBytes(scratch.data(),scratch.size());
+      } else {
+        out.write(uint64_t(numWords*sizeof(uint32_t)));
+        out.writeBytes(words,numWords*sizeof(uint32_t));
+      }
+    }
+
+    inline void readPixels(MessageReader &in, uint32_t *words,
+                           size_t numWords, bool compressed)
+    {
+      const size_t size = (size_t)in.read<uint64_t>();
+      const uint8_t *data = in.skipBytes(size);
+      if (compressed)
+        decompressWords(data,size,words,numWords);
+      else if (size != numWords*sizeof(uint32_t))
+        throw std::runtime_error("#owl.cluster: tile of wrong size");
+      else
+        memcpy(words,data,size);
+    }
+
+    inline MessageWriter makeMessage(MessageType type)
+    {
+      MessageWriter out;
+      out.write(type);
+      return out;
+    }
+    
+    std::ostream &operator<<(std::ostream &o, const FrameStats &stats)
+    {
+      o << "frame " << stats.frameID
+        << ": latency " << prettyDouble(stats.latency) << "s"
+        << ", " << stats.numTiles << " tiles"
+        << ", sent " << prettyNumber(stats.bytesSent) << "B"
+        << ", received " << prettyNumber(stats.bytesReceived) << "B"
+        << " (" << int(stats.compressionRatio()*10.+.5)/10. << "x compressed)"
+        << ", " << prettyNumber(size_t(stats.throughput())) << "B/s"
+        << ", render times";
+      for (auto t : stats.workerRenderTime)
+        o << " " << prettyDouble(t) << "s";
+      return o;
+    }
+    
+    // ------------------------------------------------------------------
+    // lead
+    // ------------------------------------------------------------------
+
+    /*! the balancer's tiles are the lead's tiles, whatever the mode */
+    inline DeviceTileBalancer::Config balancerConfig(const ClusterLead::Config &config)
+    {
+      DeviceTileBalancer::Config balancer;
+      balancer.tileSize = config.tileSize;
+      return balancer;
+    }
+    
+    ClusterLead::ClusterLead(const std::vector<Connection::SP> &workers)
+      : ClusterLead(workers,Config())
+    {}
+    
+    ClusterLead::ClusterLead(const std::vector<Connection::SP> &workers,
+                             const Config &config)
+      : config(config),
+        workers(workers),
+        balancer(std::max(int(workers.size()),1),balancerConfig(config))
+    {
+      if (workers.empty())
+        throw std::runtime_error("#owl.cluster: need at least one worker");
+    }
+
+    ClusterLead::~ClusterLead()
+    {
+      try {
+        shutdown();
+      } catch (const std::exception &e) {
+        std::cerr << "#owl.cluster: error on shutdown: " << e.what() << std::endl;
+      }
+    }
+
+    void ClusterLead::shutdown()
+    {
+      for (auto &worker : workers) {
+        worker->send(makeMessage(MESSAGE_SHUTDOWN).data);
+        worker->close();
+      }
+      workers.clear();
+    }
+    
+    FrameStats ClusterLead::renderFrame(const ParamSet &params,
+                                        const vec2i &fbSize,
+                                        std::vector<uint32_t> &color)
+    {
+      if (workers.empty())
+        throw std::runtime_error("#owl.cluster: lead has already shut down");
+      if (fbSize != this->fbSize) {
+        balancer.resize(fbSize);
+        this->fbSize = fbSize;
+      }
+      const int  numWorkers = (int)workers.size();
+      const int  numTiles   = balancer.getNumTiles();
+      const bool sortLast   = config.mode == COMPOSITE_SORT_LAST;
+      
+      FrameStats stats;
+      stats.frameID = frameID++;
+      stats.workerRenderTime.assign(numWorkers,0.);
+      const double t0 = getCurrentTime();
+      
+      const size_t numPixels = size_t(fbSize.x)*fbSize.y;
+      color.assign(numPixels,0);
+      if (sortLast) {
+        depth.assign(numPixels,std::numeric_limits<float>::infinity());
+        depthOwner.assign(numPixels,numWorkers);
+      }
+
+      // sort-first: every worker gets its share of the tiles;
+      // sort-last: every worker gets all of them
+      std::vector<int> allTiles;
+      const DeviceTileBalancer::Assignment *assignment = nullptr;
+      if (sortLast) {
+        allTiles.resize(numTiles);
+        std::iota(allTiles.begin(),allTiles.end(),0);
+      } else
+        assignment = &balancer.nextFrame();
+      
+      for (int workerID=0;workerID<numWorkers;workerID++) {
+        const int *tiles
+          = sortLast ? allTiles.data() : assignment->tileIDs.data()+assignment->begin[workerID];
+        const int numWorkerTiles
+          = sortLast ? numTiles : assignment->numTiles(workerID);
+        
+        MessageWriter out = makeMessage(MESSAGE_FRAME);
+        out.write(int32_t(stats.frameID));
+        out.write(int32_t(workerID));
+        out.write(int32_t(numWorkers));
+        out.write(int32_t(config.mode));
+        out.write(fbSize);
+        out.write(uint8_t(config.compress));
+        out.write(uint32_t(numWorkerTiles));
+        for (int i=0;i<numWorkerTiles;i++) {
+          out.write(int32_t(tiles[i]));
+          out.write(balancer.getTileRange(tiles[i]));
+        }
+        params.writeDelta(out,sent);
+        workers[workerID]->send(out.data);
+        stats.bytesSent += out.data.size();
+      }
+      sent = params;
+
+      // receive from all workers in parallel, and composite tiles as
+      // they come in. In sort-first mode, tiles don't overlap; in
+      // sort-last mode, each tile gets its own lock
+      std::vector<double>     tileTime(sortLast ? 0 : numTiles,0.);
+      std::vector<std::mutex> tileMutex(sortLast ? numTiles : 0);
+      std::vector<size_t>     bytesReceived(numWorkers,0);
+      std::vector<size_t>     bytesUncompressed(numWorkers,0);
+      std::vector<int>        tilesReceived(numWorkers,0);
+      std::vector<std::exception_ptr> errors(numWorkers);
+      auto receive = [&](int workerID) {
+        std::vector<uint8_t> message;
+        std::vector<uint32_t> tileColor;
+        std::vector<float> tileDepth;
+        while (1) {
+          if (!workers[workerID]->recv(message))
+            throw std::runtime_error("#owl.cluster: worker "+std::to_string(workerID)
+                                     +" disconnected");
+          bytesReceived[workerID] += message.size();
+          MessageReader in(message);
+          const MessageType type = in.read<MessageType>();
+          const int msgFrameID = in.read<int32_t>();
+          if (msgFrameID != stats.frameID)
+            throw std::runtime_error("#owl.cluster: message for wrong frame");
+          if (type == MESSAGE_FRAME_DONE) {
+            stats.workerRenderTime[workerID] = in.read<double>();
+            return;
+          }
+          if (type != MESSAGE_TILE)
+            throw std::runtime_error("#owl.cluster: unexpected message from worker");
+
+          const int    tileID     = in.read<int32_t>();
+          const box2i  tile       = in.read<box2i>();
+          const double time       = in.read<double>();
+          const bool   compressed = in.read<uint8_t>() != 0;
+          if (tileID < 0 || tileID >= numTiles
+              || tile != balancer.getTileRange(tileID))
+            throw std::runtime_error("#owl.cluster: invalid tile from worker");
+          const vec2i  size = tile.size();
+          const size_t tilePixels = size_t(size.x)*size.y;
+          tileColor.resize(tilePixels);
+          readPixels(in,tileColor.data(),tilePixels,compressed);
+          bytesUncompressed[workerID] += tilePixels*sizeof(uint32_t);
+          tilesReceived[workerID]++;
+
+          if (!sortLast) {
+            tileTime[tileID] = time;
+            for (int iy=0;iy<size.y;iy++)
+              memcpy(color.data()+(tile.lower.y+iy)*size_t(fbSize.x)+tile.lower.x,
+                     tileColor.data()+iy*size_t(size.x),
+                     size.x*sizeof(uint32_t));
+            continue;
+          }
+
+          tileDepth.resize(tilePixels);
+          readPixels(in,(uint32_t*)tileDepth.data(),tilePixels,compressed);
+          bytesUncompressed[workerID] += tilePixels*sizeof(float);
+          std::lock_guard<std::mutex> lock(tileMutex[tileID]);
+          for (int iy=0;iy<size.y;iy++)
+            for (int ix=0;ix<size.x;ix++) {
+              const size_t src = iy*size_t(size.x)+ix;
+              const size_t dst = (tile.lower.y+iy)*size_t(fbSize.x)+tile.lower.x+ix;
+              const float  d   = tileDepth[src];
+              if (d < depth[dst] || (d == depth[dst] && workerID < depthOwner[dst])) {
+                depth[dst]      = d;
+                depthOwner[dst] = workerID;
+                color[dst]      = tileColor[src];
+              }
+            }
+        }
+      };
+      std::vector<std::thread> threads;
+      for (int workerID=0;workerID<numWorkers;workerID++)
+        threads.push_back(std::thread([&,workerID](){
+              try {
+                receive(workerID);
+              } catch (...) {
+                errors[workerID] = std::current_exception();
+              }
+            }));
+      for (auto &thread : threads) thread.join();
+      for (auto &error : errors)
+        if (error) std::rethrow_exception(error);
+      
+      stats.latency = getCurrentTime()-t0;
+      for (int workerID=0;workerID<numWorkers;workerID++) {
+        stats.bytesReceived     += bytesReceived[workerID];
+        stats.bytesUncompressed += bytesUncompressed[workerID];
+        stats.numTiles          += tilesReceived[workerID];
+      }
+      if (!sortLast)
+        balancer.update(stats.workerRenderTime,tileTime);
+      return stats;
+    }
+    
+    // ------------------------------------------------------------------
+    // worker
+    // ------------------------------------------------------------------
+    
+    ClusterWorker::ClusterWorker(Connection::SP lead,
+                                 const RenderTileFunc &renderTile)
+      : lead(lead), renderTile(renderTile)
+    {}
+
+    void ClusterWorker::run()
+    {
+      std::vector<uint8_t>  message;
+      std::vector<uint32_t> color;
+      std::vector<float>    depth;
+      std::vector<uint8_t>  scratch;
+      std::vector<std::pair<int,box2i>> tiles;
+      while (lead->recv(message)) {
+        MessageReader in(message);
+        const MessageType type = in.read<MessageType>();
+        if (type == MESSAGE_SHUTDOWN) break;
+        if (type != MESSAGE_FRAME)
+          throw std::runtime_error("#owl.cluster: unexpected message from lead");
+
+        const int           frameID    = in.read<int32_t>();
+        const int           workerID   = in.read<int32_t>();
+        const int           numWorkers = in.read<int32_t>();
+        const CompositeMode mode       = (CompositeMode)in.read<int32_t>();
+        const vec2i         fbSize     = in.read<vec2i>();
+        const bool          compress   = in.read<uint8_t>() != 0;
+        tiles.resize(in.read<uint32_t>());
+        for (auto &tile : tiles) {
+          tile.first  = in.read<int32_t>();
+          tile.second = in.read<box2i>();
+        }
+        params.applyDelta(in);
+        const bool sortLast = mode == COMPOSITE_SORT_LAST;
+        const RenderJob job = { frameID, workerID, numWorkers, mode, fbSize, params };
+
+        double renderTime = 0.;
+        for (auto &tile : tiles) {
+          const vec2i  size = tile.second.size();
+          const size_t numPixels = size_t(size.x)*size.y;
+          color.resize(numPixels);
+          depth.resize(sortLast ? numPixels : 0);
+          const double t0 = getCurrentTime();
+          renderTile(job,tile.second,color.data(),sortLast ? depth.data() : nullptr);
+          const double time = getCurrentTime()-t0;
+          renderTime += time;
+
+          MessageWriter out = makeMessage(MESSAGE_TILE);
+          out.write(int32_t(frameID));
+          out.write(int32_t(tile.first));
+          out.write(tile.second);
+          out.write(time);
+          out.write(uint8_t(compress));
+          writePixels(out,color.data(),numPixels,compress,scratch);
+          if (sortLast)
+            writePixels(out,(const uint32_t*)depth.data(),numPixels,compress,scratch);
+          lead->send(out.data);
+        }
+        MessageWriter out = makeMessage(MESSAGE_FRAME_DONE);
+        out.write(int32_t(frameID));
+        out.write(renderTime);
+        lead->send(out.data);
+      }
+      lead->close();
+    }
+    
+  } // ::owl::cluster
+} // ::owl
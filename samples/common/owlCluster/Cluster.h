@@ -0,0 +1,162 @@
+// ======================================================================== //
+// Copyright 2018-2019 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file Cluster.h rendering one frame across multiple processes: a
+    lead process sends each frame's parameters (only those that
+    changed) to its workers, along with which tiles to render; the
+    workers render those (with OWL, or whatever else their render
+    callback does), and stream the (compressed) tiles back as they
+    finish, which the lead composites into the final frame.
+
+    Two ways of splitting the work are supported:
+
+    - sort-first: every worker has the whole scene, and renders a
+      different part of the frame. Tiles get distributed with a
+      DeviceTileBalancer (with workers as devices), using the
+      workers' per-tile render times of the previous frames.
+
+    - sort-last: every worker has a different part of the scene, and
+      renders all of the frame, with depth; the lead keeps the closest
+      sample per pixel (on equal depth, that of the lower-ranked
+      worker, so results are deterministic) */
+
+#include "Transport.h"
+#include "Protocol.h"
+#include "owl/common/parallel/DeviceTileBalancer.h"
+#include <functional>
+#include <iostream>
+
+namespace owl {
+  namespace cluster {
+
+    typedef enum {
+      COMPOSITE_SORT_FIRST,
+      COMPOSITE_SORT_LAST
+    } CompositeMode;
+
+    /*! what a worker knows about the frame it's rendering */
+    struct RenderJob {
+      int            frameID;
+      int            workerID;
+      int            numWorkers;
+      CompositeMode  mode;
+      vec2i          fbSize;
+      /*! the parameters as of this frame */
+      const ParamSet &params;
+    };
+
+    /*! renders the given [lower,upper) pixel range of a frame, into
+        'color' (RGBA8, one word per pixel, row-major with tile width
+        as the stride) and - in sort-last mode only, else it's null -
+        'depth' (any value that's lower for closer, eg, the hit
+        distance; infinity for no hit) */
+    typedef std::function<void(const RenderJob &job,
+                               const box2i &tile,
+                               uint32_t *color,
+                               float *depth)> RenderTileFunc;
+
+    /*! what one frame took */
+    struct FrameStats {
+      int    frameID = -1;
+      /*! from starting to send the frame to having composited the
+          last tile, in seconds */
+      double latency = 0.;
+      /*! each worker's time spent in rendering, in seconds */
+      std::vector<double> workerRenderTime;
+      /*! bytes sent to all workers (frame parameters, and tile
+          assignments) */
+      size_t bytesSent = 0;
+      /*! bytes received from all workers */
+      size_t bytesReceived = 0;
+      /*! bytes the tiles would have taken uncompressed */
+      size_t bytesUncompressed = 0;
+      int    numTiles = 0;
+
+      /*! received bytes per second */
+      inline double throughput() const
+      { return latency > 0. ? bytesReceived/latency : 0.; }
+      /*! uncompressed bytes per compressed byte */
+      inline double compressionRatio() const
+      { return bytesReceived ? bytesUncompressed/double(bytesReceived) : 1.; }
+    };
+    
+    std::ostream &operator<<(std::ostream &o, const FrameStats &stats);
+
+    /*! the process that drives the workers, and composites what they
+        render */
+    struct ClusterLead {
+      struct Config {
+        CompositeMode mode     { COMPOSITE_SORT_FIRST };
+        vec2i         tileSize { 64,64 };
+        /*! whether workers should compress their tiles; only worth
+            turning off if the network is faster than the codec */
+        bool          compress { true };
+      };
+
+      /*! one connection per worker; worker 'i' is the one at
+          workers[i] */
+      ClusterLead(const std::vector<Connection::SP> &workers);
+      ClusterLead(const std::vector<Connection::SP> &workers,
+                  const Config &config);
+      /*! tells all workers to shut down */
+      ~ClusterLead();
+
+      /*! renders one frame with the given parameters, into 'color'
+          (fbSize.x*fbSize.y RGBA8 pixels, row-major); returns what
+          that frame cost */
+      FrameStats renderFrame(const ParamSet &params,
+                             const vec2i &fbSize,
+                             std::vector<uint32_t> &color);
+
+      /*! tells all workers to shut down, and closes the connections */
+      void shutdown();
+      
+      const Config config;
+      
+    private:
+      std::vector<Connection::SP> workers;
+      DeviceTileBalancer          balancer;
+      vec2i                       fbSize  { 0,0 };
+      /*! what the workers have, as of the last frame */
+      ParamSet                    sent;
+      int                         frameID { 0 };
+      /*! sort-last only: the depth of what 'color' currently has per
+          pixel, and from which worker it came */
+      std::vector<float>          depth;
+      std::vector<int>            depthOwner;
+    };
+
+    /*! one of the processes doing the actual rendering */
+    struct ClusterWorker {
+      ClusterWorker(Connection::SP lead, const RenderTileFunc &renderTile);
+
+      /*! renders frames as the lead sends them, until the lead shuts
+          down */
+      void run();
+
+      /*! the parameters as of the last frame */
+      const ParamSet &getParams() const { return params; }
+      
+    private:
+      Connection::SP lead;
+      RenderTileFunc renderTile;
+      ParamSet       params;
+    };
+    
+  } // ::owl::cluster
+} // ::owl
@@ -0,0 +1,180 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "Protocol.h"
+#include "owl/owl.h"
+#include <algorithm>
+
+namespace owl {
+  namespace cluster {
+
+    // ------------------------------------------------------------------
+    // ParamSet
+    // ------------------------------------------------------------------
+    
+    void ParamSet::set(const std::string &name, const void *ptr, size_t size)
+    {
+      values[name].assign((const uint8_t *)ptr,(const uint8_t *)ptr+size);
+    }
+    
+    const std::vector<uint8_t> *ParamSet::find(const std::string &name) const
+    {
+      auto it = values.find(name);
+      return it == values.end() ? nullptr : &it->second;
+    }
+      
+    void ParamSet::writeDelta(MessageWriter &out, const ParamSet &previous) const
+    {
+      std::vector<const std::pair<const std::string,std::vector<uint8_t>> *> changed;
+      for (auto &value : values) {
+        const std::vector<uint8_t> *before = previous.find(value.first);
+        if (!before || *before != value.second)
+          changed.push_back(&value);
+      }
+      out.write(uint32_t(changed.size()));
+      for (auto value : changed) {
+        out.writeString(value->first);
+        out.write(uint64_t(value->second.size()));
+        out.writeBytes(value->second.data(),value->second.size());
+      }
+    }
+    
+    void ParamSet::applyDelta(MessageReader &in)
+    {
+      const uint32_t numChanged = in.read<uint32_t>();
+      for (uint32_t i=0;i<numChanged;i++) {
+        const std::string name = in.readString();
+        const size_t size = (size_t)in.read<uint64_t>();
+        set(name,in.skipBytes(size),size);
+      }
+    }
+    
+    void ParamSet::applyTo(OWLParams params,
+                           const OWLVarDecl *vars, int numVars) const
+    {
+      for (auto &value : values) {
+        const OWLVarDecl *decl = nullptr;
+        for (int i=0;vars && (numVars < 0 ? vars[i].name != nullptr : i < numVars);i++)
+          if (value.first == vars[i].name) { decl = &vars[i]; break; }
+        if (!decl)
+          throw std::runtime_error("#owl.cluster: no launch parameter '"
+                                   +value.first+"'");
+        /* owlParamsSetRaw reads as many bytes as the variable was
+           declared with; that's only defined for user types */
+        if ((size_t)decl->type < (size_t)OWL_USER_TYPE_BEGIN
+            || (size_t)decl->type - (size_t)OWL_USER_TYPE_BEGIN != value.second.size())
+          throw std::runtime_error("#owl.cluster: launch parameter '"
+                                   +value.first+"' is not a user type of "
+                                   +std::to_string(value.second.size())+" bytes");
+      }
+      for (auto &value : values)
+        owlParamsSetRaw(params,value.first.c_str(),value.second.data());
+    }
+
+    // ------------------------------------------------------------------
+    // tile codec
+    // ------------------------------------------------------------------
+
+    /* every block starts with a varint 'header': the lowest bit says
+       whether it's a run (1: one word, repeated) or literals (0: that
+       many words, as they are), the other bits are the count minus
+       one */
+    
+    inline void writeVarint(std::vector<uint8_t> &out, uint64_t v)
+    {
+      while (v >= 0x80) {
+        out.push_back(uint8_t(v | 0x80));
+        v >>= 7;
+      }
+      out.push_back(uint8_t(v));
+    }
+
+    inline void writeWords(std::vector<uint8_t> &out,
+                           const uint32_t *words, size_t numWords)
+    {
+      const size_t at = out.size();
+      out.resize(at+numWords*sizeof(uint32_t));
+      memcpy(out.data()+at,words,numWords*sizeof(uint32_t));
+    }
+
+    /*! whether a run worth encoding as such (ie, at least three words
+        long) starts at 'i' */
+    inline bool runStartsAt(const uint32_t *words, size_t numWords, size_t i)
+    {
+      return i+2 < numWords
+        && words[i] == words[i+1]
+        && words[i] == words[i+2];
+    }
+    
+    void compressWords(const uint32_t *words, size_t numWords,
+                       std::vector<uint8_t> &out)
+    {
+      out.clear();
+      out.reserve(numWords*sizeof(uint32_t)/4);
+      size_t i = 0;
+      while (i < numWords) {
+        if (runStartsAt(words,numWords,i)) {
+          size_t end = i+3;
+          while (end < numWords && words[end] == words[i]) end++;
+          writeVarint(out,(uint64_t(end-i-1) << 1) | 1);
+          writeWords(out,words+i,1);
+          i = end;
+        } else {
+          size_t end = i+1;
+          while (end < numWords && !runStartsAt(words,numWords,end)) end++;
+          writeVarint(out,uint64_t(end-i-1) << 1);
+          writeWords(out,words+i,end-i);
+          i = end;
+        }
+      }
+    }
+
+    inline std::runtime_error corrupt()
+    { return std::runtime_error("#owl.cluster: corrupt compressed tile"); }
+    
+    void decompressWords(const uint8_t *data, size_t size,
+                         uint32_t *words, size_t numWords)
+    {
+      const uint8_t *const end = data+size;
+      size_t i = 0;
+      while (data < end) {
+        uint64_t header = 0;
+        for (int shift=0;;shift+=7) {
+          if (data == end || shift > 63) throw corrupt();
+          const uint8_t byte = *data++;
+          header |= uint64_t(byte & 0x7f) << shift;
+          if (!(byte & 0x80)) break;
+        }
+        const uint64_t count = (header >> 1) + 1;
+        if (count > numWords-i) throw corrupt();
+        if (header & 1) {
+          if (end-data < (ptrdiff_t)sizeof(uint32_t)) throw corrupt();
+          uint32_t word;
+          memcpy(&word,data,sizeof(word));
+          data += sizeof(word);
+          std::fill(words+i,words+i+count,word);
+        } else {
+          if (uint64_t(end-data) < count*sizeof(uint32_t)) throw corrupt();
+          memcpy(words+i,data,count*sizeof(uint32_t));
+          data += count*sizeof(uint32_t);
+        }
+        i += count;
+      }
+      if (i != numWords) throw corrupt();
+    }
+    
+  } // ::owl::cluster
+} // ::owl
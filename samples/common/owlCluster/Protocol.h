@@ -0,0 +1,164 @@
+// ======================================================================== //
+// Copyright 2018-2019 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file Protocol.h the building blocks of cluster messages: writing
+    and reading values to/from byte blobs, sets of named parameters
+    that only send what changed since last time, and a lossless codec
+    for tile pixels. All of this assumes every process in a job has
+    the same byte order (ie, they're all little-endian) */
+
+#include "owl/common/math/box.h"
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/* what an OWLParams handle points to, and what an OWLVarDecl is;
+   declared here so this header (and the tests using it) don't need
+   CUDA */
+struct _OWLLaunchParams;
+struct _OWLVarDecl;
+
+namespace owl {
+  namespace cluster {
+
+    /*! appends values to a message */
+    struct MessageWriter {
+      template<typename T>
+      inline void write(const T &t) { writeBytes(&t,sizeof(t)); }
+      
+      inline void writeBytes(const void *ptr, size_t size)
+      {
+        const size_t at = data.size();
+        data.resize(at+size);
+        if (size) memcpy(data.data()+at,ptr,size);
+      }
+
+      inline void writeString(const std::string &s)
+      {
+        write(uint32_t(s.size()));
+        writeBytes(s.data(),s.size());
+      }
+      
+      std::vector<uint8_t> data;
+    };
+
+    /*! reads back, in the same order, what a MessageWriter wrote;
+        throws if reading beyond the end of the message */
+    struct MessageReader {
+      inline MessageReader(const std::vector<uint8_t> &data)
+        : data(data)
+      {}
+      
+      template<typename T>
+      inline T read() { T t; readBytes(&t,sizeof(t)); return t; }
+
+      /*! returns a pointer to the next 'size' bytes, and skips them */
+      inline const uint8_t *skipBytes(size_t size)
+      {
+        if (size > data.size()-pos)
+          throw std::runtime_error("#owl.cluster: truncated message");
+        const uint8_t *ptr = data.data()+pos;
+        pos += size;
+        return ptr;
+      }
+      
+      inline void readBytes(void *ptr, size_t size)
+      { if (size) memcpy(ptr,skipBytes(size),size); }
+
+      inline std::string readString()
+      {
+        const size_t size = read<uint32_t>();
+        const uint8_t *ptr = skipBytes(size);
+        return std::string((const char *)ptr,size);
+      }
+
+      inline bool atEnd() const { return pos == data.size(); }
+
+      const std::vector<uint8_t> &data;
+      size_t pos = 0;
+    };
+    
+    /*! a set of named values (a camera, a time step, any launch
+        parameter variable...) that a lead process keeps in sync with
+        its workers. Values are plain bytes, so anything that can be
+        memcpy'ed works */
+    struct ParamSet {
+      void set(const std::string &name, const void *ptr, size_t size);
+      
+      template<typename T>
+      inline void set(const std::string &name, const T &t) { set(name,&t,sizeof(t)); }
+
+      /*! the value of given name, or nullptr if there is none */
+      const std::vector<uint8_t> *find(const std::string &name) const;
+      
+      /*! returns the value of given name; throws if there is no such
+          value, or if it's of a different size */
+      template<typename T>
+      inline T get(const std::string &name) const;
+      
+      /*! writes all values that are not in 'previous', or that have
+          different values there */
+      void writeDelta(MessageWriter &out, const ParamSet &previous) const;
+
+      /*! applies what writeDelta() wrote */
+      void applyDelta(MessageReader &in);
+
+      /*! sets every value as the same-named variable of the given
+          launch params (an OWLParams created from 'vars'). Values
+          come from another process, so each one has to match a
+          declared user-type variable of exactly its size; throws
+          otherwise. As with owlParamsCreate, numVars==-1 means
+          'vars' is terminated by a null name */
+      void applyTo(_OWLLaunchParams *params,
+                   const _OWLVarDecl *vars, int numVars = -1) const;
+
+      std::map<std::string,std::vector<uint8_t>> values;
+    };
+
+    /*! lossless compression of 32-bit words (eg, RGBA8 pixels, or
+        float depths), as runs of repeated words and blocks of
+        literal ones. That's cheap enough to not show up next to the
+        network, and wins big on background, converged, or otherwise
+        flat regions; noisy pixels cost a single varint per block */
+    void compressWords(const uint32_t *words, size_t numWords,
+                       std::vector<uint8_t> &out);
+
+    /*! inverse of compressWords; throws if the data is corrupt, or
+        doesn't expand to exactly 'numWords' words */
+    void decompressWords(const uint8_t *data, size_t size,
+                         uint32_t *words, size_t numWords);
+    
+    // ------------------------------------------------------------------
+    // implementation section
+    // ------------------------------------------------------------------
+    
+    template<typename T>
+    inline T ParamSet::get(const std::string &name) const
+    {
+      const std::vector<uint8_t> *value = find(name);
+      if (!value || value->size() != sizeof(T))
+        throw std::runtime_error("#owl.cluster: no parameter '"+name+"' of that size");
+      T t;
+      memcpy((void*)&t,value->data(),sizeof(T));
+      return t;
+    }
+    
+  } // ::owl::cluster
+} // ::owl
@@ -0,0 +1,513 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "Transport.h"
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#ifndef _WIN32
+# include <sys/socket.h>
+# include <sys/un.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <netdb.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <cerrno>
+#endif
+
+namespace owl {
+  namespace cluster {
+
+    // ------------------------------------------------------------------
+    // local (in-process) connections
+    // ------------------------------------------------------------------
+
+    /*! what two local endpoints share: one queue per direction */
+    struct LocalChannel {
+      std::mutex mutex;
+      std::condition_variable cv;
+      std::deque<std::vector<uint8_t>> queue[2];
+      bool closed[2] = { false, false };
+    };
+
+    struct LocalConnection : public Connection {
+      LocalConnection(const std::shared_ptr<LocalChannel> &channel, int side)
+        : channel(channel), side(side)
+      {}
+      ~LocalConnection() override { close(); }
+
+      void send(const std::vector<uint8_t> &message) override
+      {
+        std::lock_guard<std::mutex> lock(channel->mutex);
+        if (channel->closed[side])
+          throw std::runtime_error("#owl.cluster: send on closed connection");
+        channel->queue[1-side].push_back(message);
+        channel->cv.notify_all();
+      }
+      
+      bool recv(std::vector<uint8_t> &message) override
+      {
+        std::unique_lock<std::mutex> lock(channel->mutex);
+        channel->cv.wait(lock,[&](){
+            return !channel->queue[side].empty() || channel->closed[1-side];
+          });
+        if (channel->queue[side].empty()) return false;
+        message = std::move(channel->queue[side].front());
+        channel->queue[side].pop_front();
+        return true;
+      }
+      
+      void close() override
+      {
+        std::lock_guard<std::mutex> lock(channel->mutex);
+        channel->closed[side] = true;
+        channel->cv.notify_all();
+      }
+      
+      std::shared_ptr<LocalChannel> channel;
+      const int side;
+    };
+
+    std::pair<Connection::SP,Connection::SP> createLocalConnectionPair()
+    {
+      auto channel = std::make_shared<LocalChannel>();
+      return { std::make_shared<LocalConnection>(channel,0),
+               std::make_shared<LocalConnection>(channel,1) };
+    }
+
+#ifdef _WIN32
+    UnixSocketListener::UnixSocketListener(const std::string &path,
+                                           size_t sharedMemoryThreshold)
+      : path(path), sharedMemoryThreshold(sharedMemoryThreshold)
+    { throw std::runtime_error("#owl.cluster: unix sockets not supported on windows"); }
+    UnixSocketListener::~UnixSocketListener() {}
+    Connection::SP UnixSocketListener::accept() { return {}; }
+    Connection::SP connectUnixSocket(const std::string &, double, size_t)
+    { throw std::runtime_error("#owl.cluster: unix sockets not supported on windows"); }
+    TcpListener::TcpListener(int port) : port(port)
+    { throw std::runtime_error("#owl.cluster: sockets not (yet) supported on windows"); }
+    TcpListener::~TcpListener() {}
+    Connection::SP TcpListener::accept() { return {}; }
+    Connection::SP connectTcp(const std::string &, int, double)
+    { throw std::runtime_error("#owl.cluster: sockets not (yet) supported on windows"); }
+#else
+    // ------------------------------------------------------------------
+    // sockets (unix-domain and TCP)
+    // ------------------------------------------------------------------
+
+    /*! flags for send()/sendmsg(): a broken connection has to show up
+        as an error, not as a SIGPIPE that kills the process. Where
+        there's no MSG_NOSIGNAL (eg, macOS), setSocketOptions() sets
+        SO_NOSIGPIPE on the socket instead */
+#ifdef MSG_NOSIGNAL
+    const int sendFlags = MSG_NOSIGNAL;
+#else
+    const int sendFlags = 0;
+#endif
+
+    /*! marks a socket close-on-exec, and makes writing to a broken one
+        fail rather than raise SIGPIPE (where that's a socket option) */
+    inline void setSocketOptions(int fd)
+    {
+      fcntl(fd,F_SETFD,FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+      const int one = 1;
+      setsockopt(fd,SOL_SOCKET,SO_NOSIGPIPE,&one,sizeof(one));
+#endif
+    }
+
+    inline int newSocket(int domain)
+    {
+#ifdef SOCK_CLOEXEC
+      const int fd = socket(domain,SOCK_STREAM|SOCK_CLOEXEC,0);
+#else
+      const int fd = socket(domain,SOCK_STREAM,0);
+#endif
+      if (fd >= 0) setSocketOptions(fd);
+      return fd;
+    }
+
+    inline int acceptSocket(int listenFD)
+    {
+      int fd;
+      do {
+#ifdef __linux__
+        fd = ::accept4(listenFD,nullptr,nullptr,SOCK_CLOEXEC);
+#else
+        fd = ::accept(listenFD,nullptr,nullptr);
+#endif
+      } while (fd < 0 && errno == EINTR);
+      if (fd >= 0) setSocketOptions(fd);
+      return fd;
+    }
+
+    /*! what precedes every message on the socket */
+    struct MessageHeader {
+      uint64_t size;
+      /*! whether the payload comes as a shared memory file descriptor
+          (passed along with the header), rather than inline */
+      uint32_t inSharedMemory;
+      uint32_t pad;
+    };
+
+    /*! largest message we send or accept; 'size' comes from the
+        peer, and we'd otherwise allocate whatever it says. A full
+        8K frame of float4 pixels is well below this */
+    static const uint64_t maxMessageSize = 1ull<<31;
+
+    inline std::runtime_error socketError(const std::string &what)
+    {
+      return std::runtime_error("#owl.cluster: "+what+" ("+strerror(errno)+")");
+    }
+
+    /*! creates an anonymous shared memory file holding the given data,
+        or returns -1 if that's not supported */
+    inline int createSharedMemory(const std::vector<uint8_t> &data)
+    {
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+      const int fd = memfd_create("owl-cluster",MFD_CLOEXEC);
+      if (fd < 0) return -1;
+      if (ftruncate(fd,data.size()) != 0) { ::close(fd); return -1; }
+      void *mem = mmap(nullptr,data.size(),PROT_WRITE,MAP_SHARED,fd,0);
+      if (mem == MAP_FAILED) { ::close(fd); return -1; }
+      memcpy(mem,data.data(),data.size());
+      munmap(mem,data.size());
+      return fd;
+#else
+      return -1;
+#endif
+    }
+
+    /*! a connection over a stream socket; messages of at least
+        'sharedMemoryThreshold' bytes go through shared memory (which
+        only works for unix-domain sockets - TCP connections never use
+        it) */
+    struct SocketConnection : public Connection {
+      SocketConnection(int fd, size_t sharedMemoryThreshold)
+        : fd(fd), sharedMemoryThreshold(sharedMemoryThreshold)
+      {}
+      ~SocketConnection() override
+      {
+        close();
+        ::close(fd);
+      }
+
+      void sendAll(const void *data, size_t size)
+      {
+        const uint8_t *ptr = (const uint8_t *)data;
+        while (size) {
+          const ssize_t n = ::send(fd,ptr,size,sendFlags);
+          if (n < 0) {
+            if (errno == EINTR) continue;
+            throw socketError("send failed");
+          }
+          ptr += n; size -= n;
+        }
+      }
+
+      /*! reads exactly 'size' bytes, or returns false on end of file */
+      bool recvAll(void *data, size_t size)
+      {
+        uint8_t *ptr = (uint8_t *)data;
+        while (size) {
+          const ssize_t n = ::recv(fd,ptr,size,0);
+          if (n == 0) return false;
+          if (n < 0) {
+            if (errno == EINTR) continue;
+            throw socketError("recv failed");
+          }
+          ptr += n; size -= n;
+        }
+        return true;
+      }
+      
+      void send(const std::vector<uint8_t> &message) override
+      {
+        if (message.size() > maxMessageSize)
+          throw std::runtime_error("#owl.cluster: message of "
+                                   +std::to_string(message.size())
+                                   +" bytes exceeds maximum message size");
+        std::lock_guard<std::mutex> lock(sendMutex);
+        MessageHeader header = { message.size(), 0, 0 };
+        const int shm
+          = message.size() >= sharedMemoryThreshold
+          ? createSharedMemory(message)
+          : -1;
+        if (shm < 0) {
+          sendAll(&header,sizeof(header));
+          sendAll(message.data(),message.size());
+          return;
+        }
+
+        // header, with the shared memory's file descriptor attached
+        header.inSharedMemory = 1;
+        struct iovec iov = { &header, sizeof(header) };
+        char control[CMSG_SPACE(sizeof(int))];
+        memset(control,0,sizeof(control));
+        struct msghdr msg = {};
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type  = SCM_RIGHTS;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg),&shm,sizeof(int));
+        ssize_t n;
+        do {
+          n = sendmsg(fd,&msg,sendFlags);
+        } while (n < 0 && errno == EINTR);
+        // the receiver has its own reference now (or never will)
+        ::close(shm);
+        if (n < 0) throw socketError("sendmsg failed");
+        // (the fd went with the first byte; send whatever is left of
+        // the header the usual way)
+        if (size_t(n) < sizeof(header))
+          sendAll((const uint8_t *)&header+n,sizeof(header)-n);
+      }
+      
+      bool recv(std::vector<uint8_t> &message) override
+      {
+        MessageHeader header;
+        struct iovec iov = { &header, sizeof(header) };
+        char control[CMSG_SPACE(sizeof(int))];
+        struct msghdr msg = {};
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t n;
+#ifdef MSG_CMSG_CLOEXEC
+        const int recvFlags = MSG_CMSG_CLOEXEC;
+#else
+        const int recvFlags = 0;
+#endif
+        do {
+          n = recvmsg(fd,&msg,recvFlags);
+        } while (n < 0 && errno == EINTR);
+        if (n == 0) return false;
+        if (n < 0) throw socketError("recvmsg failed");
+        int shm = -1;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+             cmsg = CMSG_NXTHDR(&msg,cmsg))
+          if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            memcpy(&shm,CMSG_DATA(cmsg),sizeof(int));
+#ifndef MSG_CMSG_CLOEXEC
+            fcntl(shm,F_SETFD,FD_CLOEXEC);
+#endif
+          }
+        if (size_t(n) < sizeof(header)
+            && !recvAll((uint8_t *)&header+n,sizeof(header)-n)) {
+          if (shm >= 0) ::close(shm);
+          throw std::runtime_error("#owl.cluster: connection closed mid-message");
+        }
+
+        if (header.size > maxMessageSize) {
+          if (shm >= 0) ::close(shm);
+          throw std::runtime_error("#owl.cluster: peer announced a message of "
+                                   +std::to_string(header.size)
+                                   +" bytes, more than the maximum message size");
+        }
+        message.resize(header.size);
+        if (!header.inSharedMemory) {
+          if (!recvAll(message.data(),message.size()))
+            throw std::runtime_error("#owl.cluster: connection closed mid-message");
+          return true;
+        }
+        
+        if (shm < 0)
+          throw std::runtime_error("#owl.cluster: shared memory message without file descriptor");
+        /* reading past the end of the file would be a SIGBUS, not an error */
+        struct stat shmStat;
+        if (fstat(shm,&shmStat) != 0 || (uint64_t)shmStat.st_size < header.size) {
+          ::close(shm);
+          throw std::runtime_error("#owl.cluster: shared memory message smaller than announced");
+        }
+        void *mem = message.empty()
+          ? nullptr
+          : mmap(nullptr,message.size(),PROT_READ,MAP_SHARED,shm,0);
+        if (mem == MAP_FAILED) {
+          ::close(shm);
+          throw socketError("could not map shared memory message");
+        }
+        if (mem) {
+          memcpy(message.data(),mem,message.size());
+          munmap(mem,message.size());
+        }
+        ::close(shm);
+        return true;
+      }
+      
+      void close() override
+      {
+        std::lock_guard<std::mutex> lock(sendMutex);
+        if (!closed) shutdown(fd,SHUT_WR);
+        closed = true;
+      }
+
+      const int    fd;
+      const size_t sharedMemoryThreshold;
+      std::mutex   sendMutex;
+      bool         closed = false;
+    };
+
+    inline struct sockaddr_un makeAddress(const std::string &path)
+    {
+      struct sockaddr_un addr = {};
+      addr.sun_family = AF_UNIX;
+      if (path.size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("#owl.cluster: socket path too long: "+path);
+      strcpy(addr.sun_path,path.c_str());
+      return addr;
+    }
+    
+    UnixSocketListener::UnixSocketListener(const std::string &path,
+                                           size_t sharedMemoryThreshold)
+      : path(path), sharedMemoryThreshold(sharedMemoryThreshold)
+    {
+      const struct sockaddr_un addr = makeAddress(path);
+      fd = newSocket(AF_UNIX);
+      if (fd < 0) throw socketError("could not create socket");
+      unlink(path.c_str());
+      if (bind(fd,(const struct sockaddr *)&addr,sizeof(addr)) != 0
+          || listen(fd,64) != 0) {
+        ::close(fd);
+        throw socketError("could not listen on "+path);
+      }
+    }
+    
+    UnixSocketListener::~UnixSocketListener()
+    {
+      ::close(fd);
+      unlink(path.c_str());
+    }
+
+    Connection::SP UnixSocketListener::accept()
+    {
+      const int conn = acceptSocket(fd);
+      if (conn < 0) throw socketError("accept failed");
+      return std::make_shared<SocketConnection>(conn,sharedMemoryThreshold);
+    }
+    
+    Connection::SP connectUnixSocket(const std::string &path,
+                                     double timeout,
+                                     size_t sharedMemoryThreshold)
+    {
+      const struct sockaddr_un addr = makeAddress(path);
+      const double giveUp = common::getCurrentTime() + timeout;
+      while (1) {
+        const int fd = newSocket(AF_UNIX);
+        if (fd < 0) throw socketError("could not create socket");
+        if (connect(fd,(const struct sockaddr *)&addr,sizeof(addr)) == 0)
+          return std::make_shared<SocketConnection>(fd,sharedMemoryThreshold);
+        ::close(fd);
+        if ((errno != ENOENT && errno != ECONNREFUSED) || common::getCurrentTime() > giveUp)
+          throw socketError("could not connect to "+path);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+    }
+
+    /*! TCP connections never go through shared memory */
+    const size_t noSharedMemory = size_t(-1);
+
+    /*! messages are often small (frame parameters, tile requests), so
+        don't have them wait for more data to fill up a packet */
+    inline void setNoDelay(int fd)
+    {
+      const int one = 1;
+      setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+    }
+    
+    TcpListener::TcpListener(int port)
+      : port(port)
+    {
+      fd = newSocket(AF_INET);
+      if (fd < 0) throw socketError("could not create socket");
+      const int one = 1;
+      setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&one,sizeof(one));
+      struct sockaddr_in addr = {};
+      addr.sin_family      = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      addr.sin_port        = htons((uint16_t)port);
+      socklen_t addrLen = sizeof(addr);
+      if (bind(fd,(const struct sockaddr *)&addr,sizeof(addr)) != 0
+          || listen(fd,64) != 0
+          || getsockname(fd,(struct sockaddr *)&addr,&addrLen) != 0) {
+        ::close(fd);
+        throw socketError("could not listen on port "+std::to_string(port));
+      }
+      this->port = ntohs(addr.sin_port);
+    }
+    
+    TcpListener::~TcpListener()
+    {
+      ::close(fd);
+    }
+
+    Connection::SP TcpListener::accept()
+    {
+      const int conn = acceptSocket(fd);
+      if (conn < 0) throw socketError("accept failed");
+      setNoDelay(conn);
+      return std::make_shared<SocketConnection>(conn,noSharedMemory);
+    }
+    
+    Connection::SP connectTcp(const std::string &host,
+                              int port,
+                              double timeout)
+    {
+      struct addrinfo hints = {};
+      hints.ai_family   = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      struct addrinfo *addrs = nullptr;
+      const int rc = getaddrinfo(host.c_str(),std::to_string(port).c_str(),
+                                 &hints,&addrs);
+      if (rc != 0)
+        throw std::runtime_error("#owl.cluster: could not resolve "+host
+                                 +" ("+gai_strerror(rc)+")");
+      const double giveUp = common::getCurrentTime() + timeout;
+      while (1) {
+        int err = 0;
+        for (struct addrinfo *ai = addrs; ai; ai = ai->ai_next) {
+          const int fd = newSocket(ai->ai_family);
+          if (fd < 0) { err = errno; continue; }
+          if (connect(fd,ai->ai_addr,ai->ai_addrlen) == 0) {
+            freeaddrinfo(addrs);
+            setNoDelay(fd);
+            return std::make_shared<SocketConnection>(fd,noSharedMemory);
+          }
+          err = errno;
+          ::close(fd);
+        }
+        if (err != ECONNREFUSED || common::getCurrentTime() > giveUp) {
+          freeaddrinfo(addrs);
+          errno = err;
+          throw socketError("could not connect to "+host+":"+std::to_string(port));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+    }
+#endif
+    
+  } // ::owl::cluster
+} // ::owl
@@ -0,0 +1,112 @@
+// ======================================================================== //
+// Copyright 2018-2019 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file Transport.h how the processes of a distributed render job
+    talk to each other: a Connection carries messages (byte blobs)
+    between two endpoints, reliably and in order. Which transport
+    that is is up to the application - this file has one that works
+    within a process (for tests), and one that works across processes
+    on the same machine (unix-domain sockets, with large messages
+    going through shared memory), and one that works across machines
+    (TCP). Other transports (eg, MPI) just need to implement
+    Connection */
+
+#include "owl/common/owl-common.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace owl {
+  namespace cluster {
+
+    /*! a reliable, ordered, bidirectional channel for messages */
+    struct Connection {
+      typedef std::shared_ptr<Connection> SP;
+
+      virtual ~Connection() {}
+
+      /*! sends one message; can be called from multiple threads at
+          the same time. Throws if the connection is broken */
+      virtual void send(const std::vector<uint8_t> &message) = 0;
+
+      /*! receives the next message, waiting for it if required;
+          returns false once the other side has closed the connection
+          (and all its messages have been received). Only one thread
+          should receive at a time */
+      virtual bool recv(std::vector<uint8_t> &message) = 0;
+
+      /*! closes this end for sending; the other end's recv()
+          returns false once it has received everything sent before
+          (but can still send to, and be received from, this end) */
+      virtual void close() = 0;
+    };
+
+    /*! two connected endpoints within the same process */
+    std::pair<Connection::SP,Connection::SP> createLocalConnectionPair();
+
+    /*! messages of at least this many bytes go through shared memory
+        rather than through the socket itself (where supported) */
+    const size_t defaultSharedMemoryThreshold = size_t(64*1024);
+
+    /*! accepts connections on a unix-domain socket, at the given path
+        in the file system; the path gets removed again when the
+        listener dies */
+    struct UnixSocketListener {
+      UnixSocketListener(const std::string &path,
+                         size_t sharedMemoryThreshold = defaultSharedMemoryThreshold);
+      ~UnixSocketListener();
+
+      /*! waits for the next process to connect */
+      Connection::SP accept();
+
+      const std::string path;
+      const size_t      sharedMemoryThreshold;
+    private:
+      int fd = -1;
+    };
+
+    /*! connects to a UnixSocketListener at the given path; retries
+        for up to 'timeout' seconds if there's no listener (yet) */
+    Connection::SP connectUnixSocket(const std::string &path,
+                                     double timeout = 10.,
+                                     size_t sharedMemoryThreshold = defaultSharedMemoryThreshold);
+
+    /*! accepts TCP connections on the given port (on all network
+        interfaces); port 0 picks any free port, which is then stored
+        in 'port' */
+    struct TcpListener {
+      TcpListener(int port = 0);
+      ~TcpListener();
+
+      /*! waits for the next process to connect */
+      Connection::SP accept();
+
+      int port;
+    private:
+      int fd = -1;
+    };
+
+    /*! connects to a TcpListener on the given host and port; retries
+        for up to 'timeout' seconds if there's no listener (yet) */
+    Connection::SP connectTcp(const std::string &host,
+                              int port,
+                              double timeout = 10.);
+
+  } // ::owl::cluster
+} // ::owl
@@ -0,0 +1,125 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "CameraPath.h"
+#include "owl/common/math/LinearSpace.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace owl {
+  namespace viewer {
+
+    inline CameraKey lerp(const CameraKey &a, const CameraKey &b, float f)
+    {
+      CameraKey result;
+      result.from = (1.f-f)*a.from + f*b.from;
+      result.at   = (1.f-f)*a.at   + f*b.at;
+      result.up   = (1.f-f)*a.up   + f*b.up;
+      result.fovy = (1.f-f)*a.fovy + f*b.fovy;
+      return result;
+    }
+
+    CameraKey CameraPath::evaluate(float t) const
+    {
+      if (keys.empty())
+        throw std::runtime_error("#owl.viewer: evaluating empty camera path");
+      const int numSegments = int(keys.size()) - (closed ? 0 : 1);
+      if (numSegments <= 0)
+        return keys[0];
+
+      const float pos = max(0.f,min(1.f,t))*numSegments;
+      const int segment = min(int(pos),numSegments-1);
+      return lerp(keys[segment],
+                  keys[(segment+1) % keys.size()],
+                  pos-segment);
+    }
+
+    CameraKey CameraPath::evaluateFrame(int frameID, int numFrames) const
+    {
+      const int numSteps = closed ? numFrames : numFrames-1;
+      return evaluate(numSteps > 0 ? frameID/float(numSteps) : 0.f);
+    }
+
+    CameraPath CameraPath::load(const std::string &fileName)
+    {
+      std::ifstream in(fileName);
+      if (!in.good())
+        throw std::runtime_error("#owl.viewer: could not open camera path '"
+                                 +fileName+"'");
+      CameraPath path;
+      std::string line;
+      for (int lineNo=1;std::getline(in,line);lineNo++) {
+        std::istringstream tokens(line);
+        std::string first;
+        if (!(tokens >> first) || first[0] == '#')
+          continue;
+        if (first == "closed") {
+          path.closed = true;
+          continue;
+        }
+        CameraKey key;
+        std::istringstream values(line);
+        if (!(values
+              >> key.from.x >> key.from.y >> key.from.z
+              >> key.at.x   >> key.at.y   >> key.at.z
+              >> key.up.x   >> key.up.y   >> key.up.z
+              >> key.fovy))
+          throw std::runtime_error("#owl.viewer: could not parse line "
+                                   +std::to_string(lineNo)
+                                   +" of camera path '"+fileName+"'");
+        path.keys.push_back(key);
+      }
+      if (path.keys.empty())
+        throw std::runtime_error("#owl.viewer: camera path '"+fileName
+                                 +"' does not have any keys");
+      return path;
+    }
+
+    void CameraPath::save(const std::string &fileName) const
+    {
+      std::ofstream out(fileName);
+      out.precision(9);
+      out << "# from(xyz) at(xyz) up(xyz) fovy" << std::endl;
+      if (closed)
+        out << "closed" << std::endl;
+      for (auto &key : keys)
+        out << key.from.x << " " << key.from.y << " " << key.from.z << "  "
+            << key.at.x   << " " << key.at.y   << " " << key.at.z   << "  "
+            << key.up.x   << " " << key.up.y   << " " << key.up.z   << "  "
+            << key.fovy << std::endl;
+      if (!out.good())
+        throw std::runtime_error("#owl.viewer: could not write camera path '"
+                                 +fileName+"'");
+    }
+
+    CameraPath CameraPath::orbit(const CameraKey &start, int numKeys)
+    {
+      CameraPath path;
+      path.closed = true;
+      const vec3f axis = normalize(start.up);
+      for (int i=0;i<numKeys;i++) {
+        const linear3f rot
+          = linear3f::rotate(axis,float(2.*M_PI*i/numKeys));
+        CameraKey key = start;
+        key.from = start.at + xfmVector(rot,start.from-start.at);
+        path.keys.push_back(key);
+      }
+      return path;
+    }
+
+  } // ::owl::viewer
+} // ::owl
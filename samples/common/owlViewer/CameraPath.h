@@ -0,0 +1,70 @@
+// ======================================================================== //
+// Copyright 2018-2019 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "owl/common/math/vec.h"
+#include <string>
+#include <vector>
+
+namespace owl {
+  namespace viewer {
+
+    /*! one key frame of a CameraPath, in the same terms as
+        OWLViewer::setCameraOrientation() */
+    struct CameraKey {
+      vec3f from { 0.f,0.f,-1.f };
+      vec3f at   { 0.f,0.f,0.f };
+      vec3f up   { 0.f,1.f,0.f };
+      float fovy { 60.f };
+    };
+
+    /*! a camera path, piece-wise linear between key frames, that a
+        headless OWLViewer run follows (see
+        OWLViewer::HeadlessConfig) */
+    struct CameraPath {
+      bool empty() const { return keys.empty(); }
+
+      /*! the camera at 't' in [0,1] along the path; for closed
+          paths, t=1 is back at the first key */
+      CameraKey evaluate(float t) const;
+
+      /*! the camera for the given frame of a run over 'numFrames'
+          frames: the first frame is at the first key, and for open
+          paths the last frame is at the last key */
+      CameraKey evaluateFrame(int frameID, int numFrames) const;
+
+      /*! reads a path from a text file with one key per line, as
+          "from.x from.y from.z at.x at.y at.z up.x up.y up.z fovy";
+          empty lines and lines starting with '#' get ignored, and a
+          line 'closed' makes the path closed. Throws if the file
+          can't be read or has no keys */
+      static CameraPath load(const std::string &fileName);
+
+      /*! writes the path in the format load() reads */
+      void save(const std::string &fileName) const;
+
+      /*! a closed path that circles the 'at' point of the given key
+          once, around its 'up' axis */
+      static CameraPath orbit(const CameraKey &start, int numKeys = 36);
+
+      std::vector<CameraKey> keys;
+      /*! whether the path goes from the last key back to the first */
+      bool closed { false };
+    };
+
+  } // ::owl::viewer
+} // ::owl
@@ -0,0 +1,80 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "FrameSink.h"
+#include "owl/common/parallel/parallel_for.h"
+#include <cstring>
+#include <stdexcept>
+
+// ImageWriter.h (through FrameSink.h) only pulls in stb's declarations
+#define STB_IMAGE_WRITE_IMPLEMENTATION 1
+#include "stb/stb_image_write.h"
+
+namespace owl {
+  namespace viewer {
+
+    void copyFlipped(Frame &frame, const uint32_t *bottomRowFirst, const vec2i &size)
+    {
+      frame.size = size;
+      frame.pixels.resize(size_t(size.x)*size.y);
+      common::parallel_for_blocked
+        (0,size.y,16,[&](size_t begin, size_t end){
+          for (size_t y=begin;y<end;y++) {
+            uint32_t *out = frame.pixels.data() + y*size.x;
+            memcpy(out,bottomRowFirst + (size.y-1-y)*size_t(size.x),
+                   size.x*sizeof(uint32_t));
+            for (int x=0;x<size.x;x++)
+              out[x] |= 0xff000000u;
+          }
+        });
+    }
+
+    void writePNG(const std::string &fileName, const Frame &frame)
+    {
+      common::writeImage(fileName,
+                         common::ImageView::rgba8(frame.pixels.data(),frame.size),
+                         common::IMAGE_FILE_FORMAT_PNG);
+    }
+
+    ImageFileSink::ImageFileSink(const std::string &fileNamePattern,
+                                 int maxFramesInFlight)
+      : fileNamePattern(fileNamePattern),
+        writer(/*numThreads*/2,maxFramesInFlight)
+    {}
+
+    std::string ImageFileSink::getFileName(int frameID) const
+    {
+      char fileName[4096];
+      snprintf(fileName,sizeof(fileName),fileNamePattern.c_str(),frameID);
+      return fileName;
+    }
+
+    void ImageFileSink::consume(const std::shared_ptr<Frame> &frame)
+    {
+      // the frame is ours to keep, so the writer doesn't need to copy it
+      common::ImageView image
+        = common::ImageView::rgba8(frame->pixels.data(),frame->size);
+      image.owner = frame;
+      writer.write(getFileName(frame->frameID),image);
+    }
+
+    void ImageFileSink::finish()
+    {
+      writer.flush();
+    }
+
+  } // ::owl::viewer
+} // ::owl
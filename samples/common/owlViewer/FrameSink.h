@@ -0,0 +1,89 @@
+// ======================================================================== //
+// Copyright 2018-2019 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "owl/common/math/vec.h"
+#include "owl/common/image/ImageWriter.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace owl {
+  namespace viewer {
+
+    /*! one finished frame, as handed to a FrameSink */
+    struct Frame {
+      /*! number of this frame within the run, starting at 0 */
+      int   frameID { 0 };
+      vec2i size    { 0 };
+      /*! RGBA8 pixels, with the *top* row first (ie, the way image
+          files store them) */
+      std::vector<uint32_t> pixels;
+    };
+
+    /*! fills 'frame' from a frame buffer whose *bottom* row comes first
+        (which is what OWLViewer's fbPointer holds, since that's what
+        GL displays), copying one row at a time, and forcing alpha to
+        opaque */
+    void copyFlipped(Frame &frame, const uint32_t *bottomRowFirst, const vec2i &size);
+
+    /*! writes the given frame to a PNG file, right away; throws if
+        that fails */
+    void writePNG(const std::string &fileName, const Frame &frame);
+
+    /*! receives the frames of a headless OWLViewer run (see
+        OWLViewer::HeadlessConfig) */
+    struct FrameSink {
+      typedef std::shared_ptr<FrameSink> SP;
+
+      virtual ~FrameSink() {}
+
+      /*! called for every finished frame. Rendering waits for this to
+          return, so anything expensive should be done
+          asynchronously */
+      virtual void consume(const std::shared_ptr<Frame> &frame) = 0;
+
+      /*! called once after the last frame; returns only once all
+          frames have been fully processed */
+      virtual void finish() {}
+    };
+
+    /*! a frame sink that writes every frame to an image file, named
+        through a printf-style pattern of the frame number (eg,
+        "frame%05d.png"); the file format follows the pattern's
+        extension (see owl::common::ImageWriter for which ones are
+        supported). Compression and writing happen in the background,
+        without copying the frames; with more than 'maxFramesInFlight'
+        frames waiting to be written, consume() waits until one of
+        them gets picked up. The first error (if any) gets thrown by
+        finish() */
+    struct ImageFileSink : public FrameSink {
+      ImageFileSink(const std::string &fileNamePattern,
+                    int maxFramesInFlight = 4);
+
+      void consume(const std::shared_ptr<Frame> &frame) override;
+      void finish() override;
+
+      std::string getFileName(int frameID) const;
+
+    private:
+      const std::string   fileNamePattern;
+      common::ImageWriter writer;
+    };
+
+  } // ::owl::viewer
+} // ::owl
@@ -20,14 +20,12 @@
 #include "FlyMode.h"
 #include "owl/helper/cuda.h"
 #include <sstream>
-
-// eventually to go into 'apps/'
-#define STB_IMAGE_WRITE_IMPLEMENTATION 1
-#include "stb/stb_image_write.h"
+#include <cmath>
 
 namespace owl {
   namespace viewer {
 
+#if !OWL_VIEWER_HEADLESS
     inline const char* getGLErrorString( GLenum error )
     {
       switch( error )
@@ -93,28 +91,60 @@ namespace owl {
       // std::cout << "#owl.viewer: glfw initialized" << std::endl;
       alreadyInitialized = true;
     }
+#endif
+
+    OWLViewer::HeadlessConfig OWLViewer::HeadlessConfig::fromEnvironment()
+    {
+      HeadlessConfig config;
+      const char *enabled = getenv("OWL_VIEWER_HEADLESS");
+      config.enabled = enabled && std::string(enabled) != "0";
+
+      if (const char *numFrames = getenv("OWL_VIEWER_FRAMES"))
+        config.numFrames = std::max(1,atoi(numFrames));
+      if (const char *size = getenv("OWL_VIEWER_SIZE"))
+        if (sscanf(size,"%ix%i",&config.frameSize.x,&config.frameSize.y) != 2)
+          throw std::runtime_error("#owl.viewer: OWL_VIEWER_SIZE has to be "
+                                   "'<width>x<height>', not '"+std::string(size)+"'");
+      if (const char *output = getenv("OWL_VIEWER_OUTPUT"))
+        config.outputFileName = output;
+      if (const char *path = getenv("OWL_VIEWER_CAMERA_PATH")) {
+        if (std::string(path) == "orbit")
+          config.orbit = true;
+        else
+          config.cameraPath = CameraPath::load(path);
+      }
+      return config;
+    }
+
+    OWLViewer::HeadlessConfig &OWLViewer::defaultHeadlessConfig()
+    {
+      static HeadlessConfig config = HeadlessConfig::fromEnvironment();
+      return config;
+    }
+
+    std::shared_ptr<Frame> OWLViewer::grabFrame(int frameID)
+    {
+      // make sure whatever render() launched is done
+      OWL_CUDA_CHECK(cudaDeviceSynchronize());
+      std::shared_ptr<Frame> frame = std::make_shared<Frame>();
+      frame->frameID = frameID;
+      copyFlipped(*frame,fbPointer,fbSize);
+      return frame;
+    }
 
     /*! helper function that dumps the current frame buffer in a png
       file of given name */
     void OWLViewer::screenShot(const std::string &fileName)
     {
-      const uint32_t *fb
-        = (const uint32_t*)fbPointer;
-
-      std::vector<uint32_t> pixels;
-      for (int y=0;y<fbSize.y;y++) {
-        const uint32_t *line = fb + (fbSize.y-1-y)*fbSize.x;
-        for (int x=0;x<fbSize.x;x++) {
-          pixels.push_back(line[x] | (0xff << 24));
-        }
-      }
-      stbi_write_png(fileName.c_str(),fbSize.x,fbSize.y,4,
-                     pixels.data(),fbSize.x*sizeof(uint32_t));
+      writePNG(fileName,*grabFrame());
       std::cout << "#owl.viewer: frame buffer written to " << fileName << std::endl;
     }
 
     vec2i OWLViewer::getScreenSize()
     {
+#if OWL_VIEWER_HEADLESS
+      throw std::runtime_error("#owl.viewer: no screen in headless build");
+#else
       initGLFW();
       int numModes = 0;
       auto monitor = glfwGetPrimaryMonitor();
@@ -126,6 +156,7 @@ namespace owl {
       for (int i=0; i<numModes; i++)
         size = max(size,vec2i(modes[i].width,modes[i].height));
       return size;
+#endif
     }
 
     float computeStableEpsilon(float f)
@@ -175,6 +206,15 @@ namespace owl {
 
     void OWLViewer::resize(const vec2i &newSize)
     {
+      if (isHeadless()) {
+        if (fbPointer)
+          cudaFree(fbPointer);
+        OWL_CUDA_CHECK(cudaMallocManaged(&fbPointer,newSize.x*newSize.y*sizeof(uint32_t)));
+        fbSize = newSize;
+        setAspect(fbSize.x/float(fbSize.y));
+        return;
+      }
+#if !OWL_VIEWER_HEADLESS
       glfwMakeContextCurrent(handle);
       if (fbPointer)
         cudaFree(fbPointer);
@@ -223,6 +263,7 @@ namespace owl {
         resourceSharingSuccessful = true;
       }
       setAspect(fbSize.x/float(fbSize.y));
+#endif
     }
 
     /*! re-draw the current frame. This function itself isn't
@@ -230,6 +271,8 @@ namespace owl {
       is */
     void OWLViewer::draw()
     {
+#if !OWL_VIEWER_HEADLESS
+      if (isHeadless()) return;
       glfwMakeContextCurrent(handle);
       if (resourceSharingSuccessful) {
         OWL_CUDA_CHECK(cudaGraphicsMapResources(1, &cuDisplayTexture));
@@ -292,6 +335,7 @@ namespace owl {
       if (resourceSharingSuccessful) {
         OWL_CUDA_CHECK(cudaGraphicsUnmapResources(1, &cuDisplayTexture));
       }
+#endif
     }
 
     /*! re-computes the 'camera' from the 'cameracontrol', and notify
@@ -300,7 +344,12 @@ namespace owl {
     {
       // camera.digestInto(simpleCamera);
       // if (isActive)
-      camera.lastModified = getCurrentTime();
+      // (make sure that updates within the same clock tick - which
+      // can happen in headless mode - still count as updates)
+      camera.lastModified
+        = std::max(getCurrentTime(),
+                   std::nextafter(camera.lastModified,
+                                  std::numeric_limits<double>::infinity()));
     }
 
     void OWLViewer::enableInspectMode(RotateMode rm,
@@ -401,21 +450,32 @@ namespace owl {
     }
 
 
+#if !OWL_VIEWER_HEADLESS
     static void glfw_error_callback(int error, const char* description)
     {
       fprintf(stderr, "Error: %s\n", description);
     }
-
+#endif
 
     void OWLViewer::setTitle(const std::string &s)
     {
+#if !OWL_VIEWER_HEADLESS
+      if (isHeadless()) return;
       glfwSetWindowTitle(handle,s.c_str());
+#endif
     }
 
     OWLViewer::OWLViewer(const std::string &title,
                          const vec2i &initWindowSize,
                          bool visible, bool enableVsync)
+      : headless(defaultHeadlessConfig()),
+        initWindowSize(initWindowSize)
     {
+#if OWL_VIEWER_HEADLESS
+      headless.enabled = true;
+#else
+      if (isHeadless()) return;
+
       glfwSetErrorCallback(glfw_error_callback);
 
       initGLFW();
@@ -434,8 +494,11 @@ namespace owl {
       glfwSetWindowUserPointer(handle, this);
       glfwMakeContextCurrent(handle);
       glfwSwapInterval( (enableVsync) ? 1 : 0 );
+#endif
     }
 
+#if !OWL_VIEWER_HEADLESS
+
 
     /*! callback for a window resizing event */
     static void glfwindow_reshape_cb(GLFWwindow* window, int width, int height )
@@ -486,9 +549,11 @@ namespace owl {
       assert(gw);
       gw->mouseButton(button,action,mods);
     }
+#endif
 
     void OWLViewer::mouseButton(int button, int action, int mods)
     {
+#if !OWL_VIEWER_HEADLESS
       const bool pressed = (action == GLFW_PRESS);
       lastMousePos = getMousePos();
       switch(button) {
@@ -514,6 +579,7 @@ namespace owl {
         mouseButtonRight(lastMousePos, pressed);
         break;
       }
+#endif
     }
 
     void OWLViewer::setCameraOptions(float fovy,
@@ -553,8 +619,48 @@ namespace owl {
       showAndRun([]() {return true; }); // run until closed manually
     }
 
+    void OWLViewer::runHeadless(std::function<bool()> keepgoing)
+    {
+      resize(headless.frameSize != vec2i(0) ? headless.frameSize : initWindowSize);
+
+      FrameSink::SP sink = frameSink;
+      if (!sink && !headless.outputFileName.empty())
+        sink = std::make_shared<ImageFileSink>(headless.outputFileName,
+                                               headless.maxFramesInFlight);
+
+      CameraPath path = headless.cameraPath;
+      if (path.empty() && headless.orbit) {
+        CameraKey start;
+        getCameraOrientation(start.from,start.at,start.up,start.fovy);
+        // (one key per frame, so no frame is on a chord of the circle)
+        path = CameraPath::orbit(start,std::max(1,headless.numFrames));
+      }
+
+      double lastCameraUpdate = -1.;
+      for (int frameID=0;frameID<headless.numFrames && keepgoing();frameID++) {
+        if (!path.empty()) {
+          const CameraKey key = path.evaluateFrame(frameID,headless.numFrames);
+          setCameraOrientation(key.from,key.at,key.up,key.fovy);
+        }
+        if (camera.lastModified != lastCameraUpdate) {
+          cameraChanged();
+          lastCameraUpdate = camera.lastModified;
+        }
+        render();
+        // the sink takes it from here, so the next frame can get
+        // rendered while this one is still being written
+        if (sink) sink->consume(grabFrame(frameID));
+      }
+      if (sink) sink->finish();
+    }
+
     void OWLViewer::showAndRun(std::function<bool()> keepgoing)
     {
+      if (isHeadless()) {
+        runHeadless(keepgoing);
+        return;
+      }
+#if !OWL_VIEWER_HEADLESS
       int width, height;
       glfwGetFramebufferSize(handle, &width, &height);
       resize(vec2i(width,height));
@@ -565,6 +671,7 @@ namespace owl {
       glfwSetCharCallback(handle, glfwindow_char_cb);
       glfwSetCursorPosCallback(handle, glfwindow_mouseMotion_cb);
 
+      int frameID = 0;
       while (!glfwWindowShouldClose(handle) && keepgoing()) {
         static double lastCameraUpdate = -1.f;
         if (camera.lastModified != lastCameraUpdate) {
@@ -573,20 +680,26 @@ namespace owl {
         }
         render();
         draw();
+        if (frameSink) frameSink->consume(grabFrame(frameID++));
 
         glfwSwapBuffers(handle);
         glfwPollEvents();
       }
+      if (frameSink) frameSink->finish();
 
       glfwDestroyWindow(handle);
       glfwTerminate();
+#endif
     }
 
     /*! tell GLFW to set desired active window size (GLFW my choose
       something smaller if it can't fit this on screen */
     void OWLViewer::setWindowSize(const vec2i &desiredSize) const
     {
+#if !OWL_VIEWER_HEADLESS
+      if (isHeadless()) return;
       glfwSetWindowSize(handle,desiredSize.x,desiredSize.y);
+#endif
     }
 
   } // ::owl::viewer
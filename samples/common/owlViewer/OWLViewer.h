@@ -16,14 +16,27 @@
 
 #pragma once
 
+#if OWL_VIEWER_HEADLESS
+/* built without GL and GLFW; all we need of those are the key codes
+   that the camera manipulators react to */
+# define GLFW_KEY_RIGHT      262
+# define GLFW_KEY_LEFT       263
+# define GLFW_KEY_DOWN       264
+# define GLFW_KEY_UP         265
+# define GLFW_KEY_PAGE_UP    266
+# define GLFW_KEY_PAGE_DOWN  267
+#else
 #include "GLFW/glfw3.h"
 #ifdef WIN32
 #include <windows.h>
 #include <gl/GL.h>
 #endif
-#include <cuda_runtime.h>
 #include <cuda_gl_interop.h>
+#endif
+#include <cuda_runtime.h>
 #include "Camera.h"
+#include "CameraPath.h"
+#include "FrameSink.h"
 
 #include <functional>
 
@@ -72,6 +85,43 @@ namespace owl {
 
       static inline vec3f getUpVector(const vec3f &v) { return owl::viewer::getUpVector(v); }
 
+      /*! configuration for running without a window: instead of
+          getting displayed, frames go to a FrameSink. This is what
+          viewers do if built with OWL_VIEWER_HEADLESS (ie, without
+          GL), or if enabled through the environment (see
+          fromEnvironment()) */
+      struct HeadlessConfig {
+        bool        enabled           { false };
+        /*! frame buffer size; if 0, the viewer's initial window size */
+        vec2i       frameSize         { 0 };
+        /*! number of frames showAndRun() renders before returning */
+        int         numFrames         { 1 };
+        /*! if not empty (and the app didn't set a sink of its own),
+            frames get written to PNG files of this printf-style
+            pattern, such as "frame%05d.png" */
+        std::string outputFileName;
+        /*! path the camera follows over all frames; if empty, the
+            camera stays wherever the app puts it */
+        CameraPath  cameraPath;
+        /*! if set (and cameraPath is empty), the camera orbits its
+            initial point of interest once over all frames */
+        bool        orbit             { false };
+        /*! how many frames may get written in the background before
+            rendering waits */
+        int         maxFramesInFlight { 4 };
+
+        /*! reads OWL_VIEWER_HEADLESS (enabled unless "0"),
+            OWL_VIEWER_FRAMES, OWL_VIEWER_SIZE ("<w>x<h>"),
+            OWL_VIEWER_OUTPUT, and OWL_VIEWER_CAMERA_PATH (a file as
+            read by CameraPath::load(), or "orbit") */
+        static HeadlessConfig fromEnvironment();
+      };
+
+      /*! the config that newly created viewers use; initialized from
+          the environment, but apps can change it before creating
+          their viewer */
+      static HeadlessConfig &defaultHeadlessConfig();
+
       OWLViewer(const std::string &title = "OWL Sample Viewer",
                 const vec2i &initWindowSize=vec2i(1200,800),
                       bool visible=true,
@@ -179,6 +229,16 @@ namespace owl {
       /*! helper function that dumps the current frame buffer in a png
         file of given name */
       void screenShot(const std::string &fileName);
+
+      /*! returns the current frame buffer, top row first */
+      std::shared_ptr<Frame> grabFrame(int frameID = 0);
+
+      bool isHeadless() const { return headless.enabled; }
+
+      /*! all frames rendered by showAndRun() get handed to this sink;
+          in headless mode, that is the default way of getting
+          anything out of the viewer */
+      void setFrameSink(FrameSink::SP sink) { frameSink = sink; }
       
       
       const SimpleCamera getSimplifiedCamera() const
@@ -218,9 +278,14 @@ namespace owl {
 
       inline vec2i getMousePos() const
       {
+#if OWL_VIEWER_HEADLESS
+        return lastMousePos;
+#else
+        if (isHeadless()) return lastMousePos;
         double x,y;
         glfwGetCursorPos(handle,&x,&y);
         return vec2i((int)x, (int)y);
+#endif
       }
     private:
       friend struct CameraManipulator;
@@ -228,17 +293,24 @@ namespace owl {
       friend struct CameraFlyMode;
 
     protected:
+      /*! showAndRun() for headless mode */
+      void runHeadless(std::function<bool()> keepgoing);
 
-    
-      
       vec2i    fbSize { 0 };
+      uint32_t *fbPointer { nullptr };
+
+      HeadlessConfig headless;
+      FrameSink::SP  frameSink;
+      /*! window size we got created with, for headless mode */
+      vec2i          initWindowSize { 0 };
 
+#if !OWL_VIEWER_HEADLESS
       GLuint   fbTexture  {0};
       cudaGraphicsResource_t cuDisplayTexture { 0 };
-      uint32_t *fbPointer { nullptr };
       
       /*! the glfw window handle */
       GLFWwindow *handle { nullptr };
+#endif
       vec2i lastMousePos = { -1,-1 };
 
       /*! tracks whether we could successfully do cuda resource
@@ -0,0 +1,125 @@
+// ======================================================================== //
+// Copyright 2018-2019 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file ProgressiveFrame.h the device side of ProgressiveRenderer:
+    what a sample's launch params have to contain, and the helpers
+    its ray gen program uses to find its pixel and accumulate into
+    it. Usable from both host and device code */
+
+#include "owl/common/math/vec.h"
+#ifdef __CUDACC__
+# include "owl/owl_device.h"
+#endif
+
+namespace owl {
+  namespace viewer {
+
+    /*! one tile's work in a progressive pass, as seen by the device
+        (see TileScheduler::Job) */
+    struct ProgressiveTile {
+      vec2i begin;
+      int   firstSample;
+      int   numSamples;
+    };
+
+    /*! goes into a sample's launch params; ProgressiveRenderer fills
+        it in (see ProgressiveRenderer::declareVariables()). A pass
+        gets launched as one 2D launch of tileSize.x by
+        tileSize.y*numTiles threads, one (vertical) tile after
+        another */
+    struct ProgressiveFrame {
+      ProgressiveTile *tiles;
+      /*! per pixel: sum of all samples' colors in xyz, and of their
+          squared luminance in w */
+      vec4f           *accumBuffer;
+      /*! per device, and per entry in 'tiles': sum of
+          progressiveRelativeError() over the tile's pixels. Each
+          device only adds into its own numTileSlots entries starting
+          at deviceIndex*numTileSlots - device-scope atomics are not
+          atomic across GPUs - and the host sums them up */
+      float           *tileError;
+      int              numTileSlots;
+      int              deviceIndex;
+      vec2i            fbSize;
+      vec2i            tileSize;
+    };
+
+    inline __both__ float progressiveLuminance(const vec3f &c)
+    { return .2126f*c.x + .7152f*c.y + .0722f*c.z; }
+
+    /*! the sums of a pixel's samples in one pass */
+    struct ProgressiveSum {
+      inline __both__ void add(const vec3f &color)
+      {
+        sum  += color;
+        sum2 += progressiveLuminance(color)*progressiveLuminance(color);
+      }
+      vec3f sum  { 0.f };
+      float sum2 { 0.f };
+    };
+
+    /*! estimated relative standard error of a pixel's mean luminance
+        after 'numSamples' samples, given its accumulated sums */
+    inline __both__ float progressiveRelativeError(const vec4f &accum, int numSamples)
+    {
+      const float n        = float(numSamples);
+      const float mean     = progressiveLuminance(vec3f(accum.x,accum.y,accum.z)/n);
+      const float variance = max(0.f,accum.w/n - mean*mean);
+      // absolute floor, so almost-black pixels don't look noisy forever
+      return sqrtf(variance/n) / (mean + 1e-2f);
+    }
+
+#ifdef __CUDACC__
+    /*! the pixel (and tile) the current launch index is for; returns
+        false for threads beyond the edge of the frame buffer, which
+        must not do anything */
+    inline __device__ bool progressiveGetPixel(const ProgressiveFrame &frame,
+                                               vec2i &pixel,
+                                               ProgressiveTile &tile,
+                                               int &tileSlot)
+    {
+      const vec2i launchIndex = owl::getLaunchIndex();
+      tileSlot = launchIndex.y / frame.tileSize.y;
+      tile     = frame.tiles[tileSlot];
+      pixel    = tile.begin + vec2i(launchIndex.x,launchIndex.y % frame.tileSize.y);
+      return pixel.x < frame.fbSize.x && pixel.y < frame.fbSize.y;
+    }
+
+    /*! adds this pass' samples to the pixel, updates the tile's error
+        estimate, and returns the pixel's new mean color */
+    inline __device__ vec3f progressiveAccumulate(const ProgressiveFrame &frame,
+                                                  const ProgressiveTile &tile,
+                                                  int tileSlot,
+                                                  const vec2i &pixel,
+                                                  const ProgressiveSum &samples)
+    {
+      vec4f &accum = frame.accumBuffer[pixel.x+frame.fbSize.x*pixel.y];
+      vec4f sum(samples.sum.x,samples.sum.y,samples.sum.z,samples.sum2);
+      if (tile.firstSample > 0)
+        sum += accum;
+      accum = sum;
+
+      const int numSamples = tile.firstSample+tile.numSamples;
+      atomicAdd(&frame.tileError[frame.deviceIndex*frame.numTileSlots+tileSlot],
+                progressiveRelativeError(sum,numSamples));
+      return vec3f(sum.x,sum.y,sum.z) * (1.f/numSamples);
+    }
+#endif
+
+  } // ::owl::viewer
+} // ::owl
@@ -0,0 +1,141 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "ProgressiveRenderer.h"
+#include <algorithm>
+
+namespace owl {
+  namespace viewer {
+
+    ProgressiveRenderer::ProgressiveRenderer(OWLContext context,
+                                             OWLRayGen  rayGen,
+                                             OWLParams  params,
+                                             const TileScheduler::Config &config)
+      : scheduler(config),
+        context(context),
+        rayGen(rayGen),
+        params(params)
+    {
+      // written by the host, read by the device, and the other way
+      // around; so host-pinned rather than device buffers
+      tilesBuffer
+        = owlHostPinnedBufferCreate(context,OWL_USER_TYPE(ProgressiveTile),1);
+      tileErrorBuffer
+        = owlHostPinnedBufferCreate(context,OWL_FLOAT,
+                                    owlGetDeviceCount(context));
+      accumBuffer
+        = owlDeviceBufferCreate(context,OWL_FLOAT4,1,nullptr);
+      owlParamsSetBuffer(params,"progressive.tiles",tilesBuffer);
+      owlParamsSetBuffer(params,"progressive.tileError",tileErrorBuffer);
+      owlParamsSetBuffer(params,"progressive.accumBuffer",accumBuffer);
+      owlParamsSet1i(params,"progressive.numTileSlots",1);
+      owlParamsSet2i(params,"progressive.tileSize",
+                     (const owl2i&)scheduler.config.tileSize);
+    }
+
+    ProgressiveRenderer::~ProgressiveRenderer()
+    {
+      owlBufferRelease(tilesBuffer);
+      owlBufferRelease(tileErrorBuffer);
+      owlBufferRelease(accumBuffer);
+    }
+
+    void ProgressiveRenderer::declareVariables(std::vector<OWLVarDecl> &vars,
+                                               uint32_t offset)
+    {
+      vars.push_back({ "progressive.tiles",       OWL_BUFPTR, offset+OWL_OFFSETOF(ProgressiveFrame,tiles) });
+      vars.push_back({ "progressive.accumBuffer", OWL_BUFPTR, offset+OWL_OFFSETOF(ProgressiveFrame,accumBuffer) });
+      vars.push_back({ "progressive.tileError",   OWL_BUFPTR, offset+OWL_OFFSETOF(ProgressiveFrame,tileError) });
+      vars.push_back({ "progressive.numTileSlots",OWL_INT,    offset+OWL_OFFSETOF(ProgressiveFrame,numTileSlots) });
+      vars.push_back({ "progressive.deviceIndex", OWL_DEVICE, offset+OWL_OFFSETOF(ProgressiveFrame,deviceIndex) });
+      vars.push_back({ "progressive.fbSize",      OWL_INT2,   offset+OWL_OFFSETOF(ProgressiveFrame,fbSize) });
+      vars.push_back({ "progressive.tileSize",    OWL_INT2,   offset+OWL_OFFSETOF(ProgressiveFrame,tileSize) });
+    }
+
+    void ProgressiveRenderer::resize(const vec2i &fbSize)
+    {
+      sync();
+      scheduler.resize(fbSize);
+      owlBufferResize(accumBuffer,size_t(fbSize.x)*fbSize.y);
+      // a pass has at most one job per tile
+      owlBufferResize(tilesBuffer,std::max(1,scheduler.getNumTiles()));
+      // ... and one set of error sums per device
+      const int numTileSlots = std::max(1,scheduler.getNumTiles());
+      owlBufferResize(tileErrorBuffer,
+                      size_t(numTileSlots)*owlGetDeviceCount(context));
+      owlParamsSetBuffer(params,"progressive.tiles",tilesBuffer);
+      owlParamsSetBuffer(params,"progressive.tileError",tileErrorBuffer);
+      owlParamsSet1i(params,"progressive.numTileSlots",numTileSlots);
+      owlParamsSetBuffer(params,"progressive.accumBuffer",accumBuffer);
+      owlParamsSet2i(params,"progressive.fbSize",(const owl2i&)fbSize);
+    }
+
+    void ProgressiveRenderer::invalidate()
+    {
+      scheduler.invalidate();
+    }
+
+    void ProgressiveRenderer::invalidate(const box2i &region)
+    {
+      scheduler.invalidate(region);
+    }
+
+    bool ProgressiveRenderer::render(bool wait)
+    {
+      sync();
+      const std::vector<TileScheduler::Job> jobs = scheduler.nextPass();
+      if (jobs.empty())
+        return false;
+
+      ProgressiveTile *tiles = (ProgressiveTile *)owlBufferGetPointer(tilesBuffer,0);
+      for (size_t i=0;i<jobs.size();i++) {
+        tiles[i].begin       = jobs[i].begin;
+        tiles[i].firstSample = jobs[i].firstSample;
+        tiles[i].numSamples  = jobs[i].numSamples;
+      }
+      float *tileError = (float *)owlBufferGetPointer(tileErrorBuffer,0);
+      std::fill(tileError,tileError+owlBufferSizeInBytes(tileErrorBuffer)/sizeof(float),0.f);
+
+      const vec2i tileSize = scheduler.config.tileSize;
+      owlAsyncLaunch2D(rayGen,tileSize.x,tileSize.y*int(jobs.size()),params);
+      pending = jobs;
+      if (wait)
+        sync();
+      return true;
+    }
+
+    void ProgressiveRenderer::sync()
+    {
+      if (pending.empty()) return;
+      owlLaunchSync(params);
+      const float *tileError = (const float *)owlBufferGetPointer(tileErrorBuffer,0);
+      // every device adds its own estimate for the same pixels, each
+      // into its own slots
+      const int numDevices   = owlGetDeviceCount(context);
+      const int numTileSlots = std::max(1,scheduler.getNumTiles());
+      for (size_t i=0;i<pending.size();i++) {
+        const TileScheduler::Job &job = pending[i];
+        const float numPixels = float(area(job.end-job.begin));
+        float error = 0.f;
+        for (int d=0;d<numDevices;d++)
+          error += tileError[d*numTileSlots+i];
+        scheduler.reportError(job.tileID,error/(numPixels*numDevices));
+      }
+      pending.clear();
+    }
+
+  } // ::owl::viewer
+} // ::owl
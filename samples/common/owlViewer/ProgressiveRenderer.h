@@ -0,0 +1,80 @@
+// ======================================================================== //
+// Copyright 2018-2019 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "TileScheduler.h"
+#include "ProgressiveFrame.h"
+#include "owl/owl.h"
+#include <vector>
+
+namespace owl {
+  namespace viewer {
+
+    /*! progressive, tile-based rendering for a sample's ray gen
+        program: instead of launching over the whole frame every
+        time, each render() launches only over the tiles that a
+        TileScheduler picked, with as many samples per pixel as it
+        picked, and accumulates those. On the device, the ray gen
+        program uses progressiveGetPixel() and
+        progressiveAccumulate() (see ProgressiveFrame.h).
+
+        With multiple devices, every device renders (and accumulates)
+        the same tiles */
+    struct ProgressiveRenderer {
+      /*! 'params' must have been created with the variables from
+          declareVariables() */
+      ProgressiveRenderer(OWLContext context,
+                          OWLRayGen  rayGen,
+                          OWLParams  params,
+                          const TileScheduler::Config &config = TileScheduler::Config());
+      ~ProgressiveRenderer();
+
+      /*! adds the variables for a ProgressiveFrame at 'offset' in the
+          launch params struct to 'vars' (all named "progressive.*") */
+      static void declareVariables(std::vector<OWLVarDecl> &vars,
+                                   uint32_t offset);
+
+      void resize(const vec2i &fbSize);
+
+      /*! see TileScheduler::invalidate() */
+      void invalidate();
+      void invalidate(const box2i &region);
+
+      /*! launches the next pass; unless 'wait' is false, also waits
+          for it to finish (see sync()). Returns false (and does
+          nothing) if every tile has converged */
+      bool render(bool wait = true);
+
+      /*! waits for the last pass to finish, and hands its error
+          estimates to the scheduler */
+      void sync();
+
+      TileScheduler scheduler;
+
+    private:
+      const OWLContext  context;
+      const OWLRayGen   rayGen;
+      const OWLParams   params;
+      OWLBuffer         tilesBuffer     { 0 };
+      OWLBuffer         tileErrorBuffer { 0 };
+      OWLBuffer         accumBuffer     { 0 };
+      /*! jobs of the last pass, if that's still running */
+      std::vector<TileScheduler::Job> pending;
+    };
+
+  } // ::owl::viewer
+} // ::owl
@@ -0,0 +1,165 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "TileScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace owl {
+  namespace viewer {
+
+    TileScheduler::TileScheduler() : config(Config()) {}
+
+    TileScheduler::TileScheduler(const Config &config) : config(config) {}
+
+    void TileScheduler::resize(const vec2i &newSize)
+    {
+      fbSize = newSize;
+      tiles.clear();
+      const vec2i numTiles = divRoundUp(max(fbSize,vec2i(0)),config.tileSize);
+      for (int ty=0;ty<numTiles.y;ty++)
+        for (int tx=0;tx<numTiles.x;tx++) {
+          Tile tile;
+          tile.begin = vec2i(tx,ty)*config.tileSize;
+          tile.end   = min(tile.begin+config.tileSize,fbSize);
+          tiles.push_back(tile);
+        }
+    }
+
+    void TileScheduler::invalidate()
+    {
+      for (auto &tile : tiles) {
+        tile.stale = true;
+        tile.error = -1.f;
+      }
+    }
+
+    void TileScheduler::invalidate(const box2i &region)
+    {
+      for (auto &tile : tiles)
+        if (tile.begin.x < region.upper.x && region.lower.x < tile.end.x &&
+            tile.begin.y < region.upper.y && region.lower.y < tile.end.y) {
+          tile.stale = true;
+          tile.error = -1.f;
+        }
+    }
+
+    int TileScheduler::samplesFor(const Tile &tile) const
+    {
+      if (tile.stale)
+        // one sample, to get the whole frame refreshed asap
+        return 1;
+      const int n = tile.numSamples;
+      const int left = config.maxSamplesPerPixel - n;
+      if (left <= 0)
+        return 0;
+      if (n < config.minSamplesPerPixel)
+        return std::min(left,std::min(config.minSamplesPerPixel-n,config.maxSamplesPerPass));
+      if (tile.error < 0.f)
+        return 1;
+      if (tile.error <= config.targetError)
+        return 0;
+      // the error goes down with the square root of the number of
+      // samples, so that's how many we'd need to hit the target
+      const float ratio = tile.error/config.targetError;
+      const double needed = std::ceil(double(n)*ratio*ratio) - n;
+      return std::min(left,(int)std::max(1.,std::min(needed,double(config.maxSamplesPerPass))));
+    }
+
+    std::vector<TileScheduler::Job> TileScheduler::nextPass()
+    {
+      struct Candidate {
+        int     tileID;
+        int     numSamples;
+        /*! (twice the) squared distance of the tile center to the
+            frame center, so it stays an integer */
+        int64_t distance;
+      };
+      std::vector<Candidate> candidates;
+      for (int tileID=0;tileID<(int)tiles.size();tileID++) {
+        const Tile &tile = tiles[tileID];
+        const int numSamples = samplesFor(tile);
+        if (numSamples == 0) continue;
+        const vec2i d = tile.begin+tile.end-fbSize;
+        candidates.push_back({tileID,numSamples,int64_t(d.x)*d.x+int64_t(d.y)*d.y});
+      }
+
+      // everything's ordered all the way down to the tile ID, so the
+      // order is deterministic
+      const Priority priority = config.priority;
+      std::sort(candidates.begin(),candidates.end(),
+                [&](const Candidate &ca, const Candidate &cb){
+                  const Tile &a = tiles[ca.tileID];
+                  const Tile &b = tiles[cb.tileID];
+                  if (a.stale != b.stale)
+                    return a.stale;
+                  if (!a.stale) {
+                    const bool aEstimated = a.numSamples >= config.minSamplesPerPixel;
+                    const bool bEstimated = b.numSamples >= config.minSamplesPerPixel;
+                    if (priority == PRIORITY_CENTER_FIRST || !aEstimated || !bEstimated) {
+                      if (a.numSamples != b.numSamples)
+                        return a.numSamples < b.numSamples;
+                    } else if (a.error != b.error)
+                      return a.error > b.error;
+                  }
+                  if (ca.distance != cb.distance)
+                    return ca.distance < cb.distance;
+                  return ca.tileID < cb.tileID;
+                });
+
+      const size_t budget
+        = config.samplesPerPass
+        ? config.samplesPerPass
+        : size_t(std::max(fbSize.x,0))*size_t(std::max(fbSize.y,0));
+      size_t used = 0;
+      std::vector<Job> jobs;
+      for (auto &candidate : candidates) {
+        Tile &tile = tiles[candidate.tileID];
+        const size_t cost = size_t(candidate.numSamples)*area(tile.end-tile.begin);
+        if (!jobs.empty() && used+cost > budget)
+          break;
+        used += cost;
+
+        Job job;
+        job.tileID      = candidate.tileID;
+        job.begin       = tile.begin;
+        job.end         = tile.end;
+        job.firstSample = tile.stale ? 0 : tile.numSamples;
+        job.numSamples  = candidate.numSamples;
+        jobs.push_back(job);
+
+        tile.numSamples = job.firstSample+job.numSamples;
+        tile.stale      = false;
+      }
+      return jobs;
+    }
+
+    void TileScheduler::reportError(int tileID, float error)
+    {
+      Tile &tile = tiles[tileID];
+      if (tile.stale) return;
+      tile.error = error;
+    }
+
+    bool TileScheduler::isConverged() const
+    {
+      for (auto &tile : tiles)
+        if (samplesFor(tile) > 0) return false;
+      return true;
+    }
+
+  } // ::owl::viewer
+} // ::owl
@@ -0,0 +1,130 @@
+// ======================================================================== //
+// Copyright 2018-2019 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "owl/common/math/box.h"
+#include <vector>
+
+namespace owl {
+  namespace viewer {
+
+    /*! decides, for progressive rendering, which tiles of the frame
+        buffer get how many more samples in the next pass: tiles
+        whose content got invalidated (eg, by a camera change) come
+        first, and each get a single sample, so the whole frame gets
+        refreshed as early as possible; after that, tiles get
+        samples in priority order, as many as their error estimate
+        says they need, until the pass' sample budget is used
+        up. Tiles whose error falls below the target stop getting
+        samples.
+
+        Invalidation is incremental in two ways: only the tiles that
+        overlap the invalidated region get reset, and tiles that
+        didn't get refreshed yet keep showing what they showed
+        before (rather than going black) until it's their turn.
+
+        This is pure host logic, and fully deterministic: the same
+        sequence of calls always produces the same passes */
+    struct TileScheduler {
+      typedef enum {
+        /*! tiles with fewer samples first, and among those, the ones
+            closer to the center of the frame */
+        PRIORITY_CENTER_FIRST,
+        /*! tiles with the largest estimated error first */
+        PRIORITY_BY_ERROR
+      } Priority;
+
+      struct Config {
+        vec2i    tileSize           { 32,32 };
+        Priority priority           { PRIORITY_CENTER_FIRST };
+        /*! pixel samples per pass; 0 means one per pixel of the
+            frame buffer */
+        size_t   samplesPerPass     { 0 };
+        /*! samples every pixel gets before its error estimate is
+            trusted */
+        int      minSamplesPerPixel { 4 };
+        int      maxSamplesPerPixel { 1024 };
+        /*! most samples a tile gets in a single pass */
+        int      maxSamplesPerPass  { 8 };
+        /*! relative error (see progressiveRelativeError()) below
+            which a tile counts as converged */
+        float    targetError        { .02f };
+      };
+
+      /*! one tile's work in a pass; the samples to take are
+          [firstSample,firstSample+numSamples), with firstSample == 0
+          meaning whatever got accumulated for that tile before gets
+          discarded */
+      struct Job {
+        int   tileID;
+        vec2i begin;
+        vec2i end;
+        int   firstSample;
+        int   numSamples;
+      };
+
+      struct Tile {
+        vec2i begin, end;
+        /*! samples accumulated (or scheduled to be) */
+        int   numSamples { 0 };
+        /*! last reported error estimate, or -1 if there's none */
+        float error      { -1.f };
+        /*! content is out of date, next job restarts accumulation */
+        bool  stale      { true };
+      };
+
+      TileScheduler();
+      TileScheduler(const Config &config);
+
+      /*! starts over for a frame buffer of the given size */
+      void resize(const vec2i &fbSize);
+
+      /*! everything needs re-rendering (eg, camera moved) */
+      void invalidate();
+
+      /*! the pixels in the given region need re-rendering */
+      void invalidate(const box2i &region);
+
+      /*! the jobs for the next pass; empty once every tile has
+          converged */
+      std::vector<Job> nextPass();
+
+      /*! reports the error estimate of a tile, after its job of the
+          last pass is done. Reports for tiles that got invalidated
+          since that pass was scheduled get ignored */
+      void reportError(int tileID, float error);
+
+      /*! whether any tile still needs samples */
+      bool isConverged() const;
+
+      int         getNumTiles() const { return (int)tiles.size(); }
+      const Tile &getTile(int tileID) const { return tiles[tileID]; }
+      vec2i       getFrameSize() const { return fbSize; }
+
+      const Config config;
+
+    private:
+      /*! samples the given tile should get in the next pass, 0 if it
+          doesn't need any */
+      int samplesFor(const Tile &tile) const;
+
+      vec2i             fbSize { 0 };
+      std::vector<Tile> tiles;
+    };
+
+  } // ::owl::viewer
+} // ::owl
@@ -15,6 +15,7 @@
 // ======================================================================== //
 
 #include "Materials.h"
+#include "../../common/owlViewer/ProgressiveFrame.h"
 
 namespace owl {
 
@@ -101,10 +102,8 @@ namespace owl {
     struct RayGenData
     {
         uint32_t* fbPtr;
-        float4* accumBuffer;
         vec2i  fbSize;
         OptixTraversableHandle world;
-        int    accumID;
         struct {
             vec3f origin;
             vec3f lower_left_corner;
@@ -113,6 +112,12 @@ namespace owl {
         } camera;
     };
 
+    /* which tiles to render, and where to accumulate them */
+    struct LaunchParams
+    {
+        viewer::ProgressiveFrame progressive;
+    };
+
     struct MissProgData
     {
         /* nothing in this example */
@@ -19,7 +19,7 @@
 
 using namespace owl;
 
-#define NUM_SAMPLES_PER_PIXEL 32
+extern "C" __constant__ LaunchParams optixLaunchParams;
 
 // ==================================================================
 // bounding box programs - since these don't actually use the material
@@ -266,16 +266,22 @@ vec3f tracePath(const RayGenData &self,
 OPTIX_RAYGEN_PROGRAM(rayGen)()
 {
   const RayGenData &self = owl::getProgramData<RayGenData>();
-  const vec2i pixelID = owl::getLaunchIndex();
-  
+  const auto &lp = optixLaunchParams;
+  vec2i pixelID;
+  viewer::ProgressiveTile tile;
+  int tileSlot;
+  if (!viewer::progressiveGetPixel(lp.progressive,pixelID,tile,tileSlot))
+    return;
+
   const int pixelIdx = pixelID.x+self.fbSize.x*pixelID.y;
 
   PerRayData prd;
-  prd.random.init(pixelID.x+self.fbSize.x*self.accumID*NUM_SAMPLES_PER_PIXEL,
-                  pixelID.y+self.fbSize.y*self.accumID*NUM_SAMPLES_PER_PIXEL);
-  
-  vec4f color = 0.f;
-  for (int sampleID=0;sampleID<NUM_SAMPLES_PER_PIXEL;sampleID++) {
+  viewer::ProgressiveSum samples;
+  for (int sampleID=tile.firstSample;
+       sampleID<tile.firstSample+tile.numSamples;
+       sampleID++) {
+    prd.random.init(pixelIdx,sampleID);
+
     owl::Ray ray;
     
     const vec2f pixelSample(prd.random(),prd.random());
@@ -293,14 +299,13 @@ OPTIX_RAYGEN_PROGRAM(rayGen)()
     ray.origin = origin;
     ray.direction = normalize(direction);
 
-    color += vec4f(tracePath(self, ray, prd),0.f);
+    samples.add(tracePath(self, ray, prd));
   }
-  if (self.accumID)
-    color = color + vec4f(self.accumBuffer[pixelIdx]);
-  self.accumBuffer[pixelIdx] = color;
-  
+
+  const vec3f color
+    = viewer::progressiveAccumulate(lp.progressive,tile,tileSlot,pixelID,samples);
   self.fbPtr[pixelIdx]
-    = owl::make_rgba(color * (1.f / ((self.accumID+1)*NUM_SAMPLES_PER_PIXEL)));
+    = owl::make_rgba(color);
 }
 
 
@@ -24,6 +24,7 @@
 #include "GeomTypes.h"
 // viewer base class, for window and user interaction
 #include "owlViewer/OWLViewer.h"
+#include "owlViewer/ProgressiveRenderer.h"
 
 #include <random>
 
@@ -166,8 +167,10 @@ struct Viewer : public owl::viewer::OWLViewer
     OWLRayGen  rayGen{ 0 };
     OWLContext context{ 0 };
     OWLGroup   world{ 0 };
-    OWLBuffer  accumBuffer{ 0 };
-    int        accumID{ 0 };
+    OWLParams  lp{ 0 };
+    /*! does the accumulation, and decides which tiles get how many
+        samples in which frame */
+    std::unique_ptr<viewer::ProgressiveRenderer> progressive;
 };
 
 
@@ -195,7 +198,7 @@ void Viewer::cameraChanged()
     const vec3f horizontal = 2.0f * half_width * focusDist * u;
     const vec3f vertical = 2.0f * half_height * focusDist * v;
 
-    accumID = 0;
+    progressive->invalidate();
 
     // ----------- set variables  ----------------------------
     owlRayGenSetGroup(rayGen, "world", world);
@@ -207,10 +210,9 @@ void Viewer::cameraChanged()
 
 void Viewer::render()
 {
-    owlRayGenSet1i(rayGen, "accumID", accumID);
-    accumID++;
     owlBuildSBT(context);
-    owlRayGenLaunch2D(rayGen, fbSize.x, fbSize.y);
+    // once every tile has converged, this doesn't launch anything
+    progressive->render();
 }
 
 
@@ -218,15 +220,9 @@ void Viewer::render()
 void Viewer::resize(const vec2i& newSize)
 {
     OWLViewer::resize(newSize);
+    progressive->resize(newSize);
     cameraChanged();
 
-    if (accumBuffer)
-        owlBufferResize(accumBuffer, newSize.x * newSize.y * sizeof(float4));
-    else
-        accumBuffer = owlDeviceBufferCreate(context, OWL_FLOAT4,
-            newSize.x * newSize.y, nullptr);
-
-    owlRayGenSetBuffer(rayGen, "accumBuffer", accumBuffer);
     owlRayGenSet1ul(rayGen, "fbPtr", (uint64_t)fbPointer);
     owlRayGenSet2i(rayGen, "fbSize", (const owl2i&)fbSize);
 
@@ -444,8 +440,6 @@ Viewer::Viewer()
     // -------------------------------------------------------
     OWLVarDecl rayGenVars[] = {
       { "fbPtr",         OWL_RAW_POINTER, OWL_OFFSETOF(RayGenData,fbPtr)},
-      { "accumBuffer",   OWL_BUFPTR, OWL_OFFSETOF(RayGenData,accumBuffer)},
-      { "accumID",       OWL_INT,    OWL_OFFSETOF(RayGenData,accumID)},
       { "fbSize",        OWL_INT2,   OWL_OFFSETOF(RayGenData,fbSize)},
       { "world",         OWL_GROUP,  OWL_OFFSETOF(RayGenData,world)},
       { "camera.org",    OWL_FLOAT3, OWL_OFFSETOF(RayGenData,camera.origin)},
@@ -461,6 +455,17 @@ Viewer::Viewer()
             sizeof(RayGenData),
             rayGenVars, -1);
 
+    // -------------------------------------------------------
+    // set up launch params
+    // -------------------------------------------------------
+    std::vector<OWLVarDecl> launchParamsVars;
+    viewer::ProgressiveRenderer::declareVariables
+        (launchParamsVars, OWL_OFFSETOF(LaunchParams, progressive));
+    launchParamsVars.push_back({ /* sentinel to mark end of list */ });
+    lp = owlParamsCreate(context, sizeof(LaunchParams), launchParamsVars.data(), -1);
+
+    progressive.reset(new viewer::ProgressiveRenderer(context, rayGen, lp));
+
     // ##################################################################
     // build *SBT* required to trace the groups
     // ##################################################################
@@ -23,7 +23,7 @@
 #include "deviceCode.h"
 // viewer base class, for window and user interaction
 #include "owlViewer/OWLViewer.h"
-#include "owl/common/math/AffineSpace.h"
+#include "owl/common/math/SRTTransform.h"
 #include <random>
 
 using namespace owl::common;
@@ -72,17 +72,19 @@ inline vec3f getRandomDir()
   return normalize(rotationAxis);
 }
 
-void getTransforms(affine3f &xfm0,
-                   affine3f &xfm1,
+/*! SRT keys, so the boxes' rotations get interpolated along their
+    arcs (with matrix keys, the boxes would shrink in between) */
+void getTransforms(SRTTransform &xfm0,
+                   SRTTransform &xfm1,
                    vec3i boxID)
 {
   const vec3f rotationAxis = getRandomDir();
 
   const float rotationAngle0 = float(distribution_uniform(rndGen)*(2.f*M_PI));
-  const linear3f rot0 = linear3f::rotate(rotationAxis,rotationAngle0);
+  const Quaternion3f rot0 = Quaternion3f::rotate(rotationAxis,rotationAngle0);
 
   const float rotationAngle1 = float(rotationAngle0+distribution_rot(rndGen));
-  const linear3f rot1 = linear3f::rotate(rotationAxis,rotationAngle1);
+  const Quaternion3f rot1 = Quaternion3f::rotate(rotationAxis,rotationAngle1);
 
   const vec3f rel = (vec3f(boxID)+.5f) / vec3f(numBoxes);
   const vec3f boxCenter = vec3f(-worldSize) + (2.f*worldSize)*rel;
@@ -92,12 +94,14 @@ void getTransforms(affine3f &xfm0,
   const vec3f motion = speed * getRandomDir();
   const vec3f pos1 = pos0+motion;;
 
-  xfm0 = affine3f(rot0,pos0);
-  xfm1 = affine3f(rot1,pos1);
+  xfm0.rotation    = rot0;
+  xfm0.translation = pos0;
+  xfm1.rotation    = rot1;
+  xfm1.translation = pos1;
 }
 
-std::vector<affine3f>     boxTransforms0;
-std::vector<affine3f>     boxTransforms1;
+std::vector<SRTTransform> boxTransforms0;
+std::vector<SRTTransform> boxTransforms1;
 
 void addFace(Mesh &mesh, const vec3f ll, const vec3f du, const vec3f dv)
 {
@@ -297,7 +301,7 @@ Viewer::Viewer()
   for (int iz=0;iz<numBoxes.z;iz++)
     for (int iy=0;iy<numBoxes.y;iy++)
       for (int ix=0;ix<numBoxes.x;ix++) {
-        affine3f xfm0, xfm1;
+        SRTTransform xfm0, xfm1;
         getTransforms(xfm0,xfm1,vec3i(ix,iy,iz));
         boxTransforms0.push_back(xfm0);
         boxTransforms1.push_back(xfm1);
@@ -318,8 +322,8 @@ Viewer::Viewer()
   //                                              boxTransforms1.data());
   // OWLBuffer xfmArrays[2] = { xfmBuffer0, xfmBuffer1 };
   // owlInstanceGroupSetTransformArrays(world,2,xfmArrays);
-  owlInstanceGroupSetTransforms(world,0,(const float*)boxTransforms0.data());
-  owlInstanceGroupSetTransforms(world,1,(const float*)boxTransforms1.data());
+  owlInstanceGroupSetSRTTransforms(world,0,(const OWLSRTTransform*)boxTransforms0.data());
+  owlInstanceGroupSetSRTTransforms(world,1,(const OWLSRTTransform*)boxTransforms1.data());
   owlGroupBuildAccel(world);
 
   // ##################################################################
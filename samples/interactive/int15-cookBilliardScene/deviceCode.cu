@@ -409,45 +409,50 @@ OPTIX_RAYGEN_PROGRAM(simpleRayGen)()
 {
   const RayGenData &self = owl::getProgramData<RayGenData>();
   const auto &lp = optixLaunchParams;
-  const vec2i launchIndex = owl::getLaunchIndex();
-  const int pixelID = launchIndex.x+self.fbSize.x*launchIndex.y; 
+  vec2i pixel;
+  owl::viewer::ProgressiveTile tile;
+  int tileSlot;
+  if (!owl::viewer::progressiveGetPixel(lp.progressive,pixel,tile,tileSlot))
+    return;
+  const int pixelID = pixel.x+self.fbSize.x*pixel.y;
+
+  owl::viewer::ProgressiveSum samples;
+  for (int sampleID=tile.firstSample;
+       sampleID<tile.firstSample+tile.numSamples;
+       sampleID++) {
+    Random rng(pixelID,sampleID);
+
+    const vec2f screen = (vec2f(pixel)+vec2f(rng(),rng())) / vec2f(self.fbSize);
+    RadianceRay ray;
+    ray.origin
+      = self.camera.pos;
+    ray.direction
+      = normalize(self.camera.dir_00
+                  + screen.u * self.camera.dir_du
+                  + screen.v * self.camera.dir_dv);
+    vec3f ray_target = ray.origin + self.camera.focal_scale * ray.direction;
+    // lens sampling
+    vec2f sample = square_to_disk(make_float2(rng(), rng()));
+    ray.origin = ray.origin + self.camera.aperture_radius * ( sample.x * normalize( self.camera.dir_du ) +  sample.y * normalize( self.camera.dir_dv ) );
+    ray.direction = normalize(ray_target - ray.origin);
+
+    //ray.time = 0.5f;
+
+    PRD prd;
+    prd.t_hit = 1e20f;
+    prd.radiance.importance = 1.f;
+    owl::traceRay(/*accel to trace against*/self.world,
+                  /*the ray to trace*/ray,
+                  /*prd*/prd,
+                  /*only CH*/OPTIX_RAY_FLAG_DISABLE_ANYHIT);
+
+    samples.add(prd.radiance.result);
+  }
 
-  Random rng(pixelID,lp.accumID);
-  
-  const vec2f screen = (vec2f(launchIndex)+vec2f(rng(),rng())) / vec2f(self.fbSize);
-  RadianceRay ray;
-  ray.origin    
-    = self.camera.pos;
-  ray.direction 
-    = normalize(self.camera.dir_00
-                + screen.u * self.camera.dir_du
-                + screen.v * self.camera.dir_dv);
-  vec3f ray_target = ray.origin + self.camera.focal_scale * ray.direction;
-  // lens sampling
-  vec2f sample = square_to_disk(make_float2(rng(), rng()));
-  ray.origin = ray.origin + self.camera.aperture_radius * ( sample.x * normalize( self.camera.dir_du ) +  sample.y * normalize( self.camera.dir_dv ) );
-  ray.direction = normalize(ray_target - ray.origin);
-
-  //ray.time = 0.5f;
-
-  vec4f accumColor = 0.f;
-
-  PRD prd;
-  prd.t_hit = 1e20f;
-  prd.radiance.importance = 1.f;
-  owl::traceRay(/*accel to trace against*/self.world,
-                /*the ray to trace*/ray,
-                /*prd*/prd,
-                /*only CH*/OPTIX_RAY_FLAG_DISABLE_ANYHIT);
-
-  accumColor += vec4f(prd.radiance.result,1.f);
-
-  if (lp.accumID > 0)
-    accumColor += vec4f(lp.accumBuffer[pixelID]);
-  lp.accumBuffer[pixelID] = accumColor;
-  accumColor *= (1.f/(lp.accumID+1));
+  const vec3f color
+    = owl::viewer::progressiveAccumulate(lp.progressive,tile,tileSlot,pixel,samples);
   self.fbPtr[pixelID]
-    = owl::make_rgba(vec3f(accumColor));
+    = owl::make_rgba(color);
 }
 
 OPTIX_MISS_PROGRAM(miss)()
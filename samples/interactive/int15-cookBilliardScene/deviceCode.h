@@ -20,6 +20,7 @@
 #include "owl/common/math/LinearSpace.h"
 #include <owl/common/math/vec.h>
 #include <cuda_runtime.h>
+#include "../../common/owlViewer/ProgressiveFrame.h"
 
 using namespace owl;
 
@@ -110,8 +111,8 @@ struct LaunchParams
   vec3f ambient_light_color;
   float scene_epsilon;
   OptixTraversableHandle world;
-  float4   *accumBuffer;
-  int       accumID;
+  /*! which tiles to render, and where to accumulate them */
+  owl::viewer::ProgressiveFrame progressive;
 };
 
 /* variables for the miss program */
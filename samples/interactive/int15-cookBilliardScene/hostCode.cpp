@@ -24,6 +24,7 @@
 // viewer base class, for window and user interaction
 #include "owlViewer/InspectMode.h"
 #include "owlViewer/OWLViewer.h"
+#include "owlViewer/ProgressiveRenderer.h"
 #include "owl/common/math/LinearSpace.h"
 #include <random>
 
@@ -164,17 +165,15 @@ struct Viewer : public owl::viewer::OWLViewer
   OWLContext context { 0 };
   OWLGroup   world   { 0 };
   OWLGroup   groups[2]; // [pool balls|parallelogram]
-  OWLBuffer  accumBuffer { 0 };
-  int accumID { 0 };
+  /*! does the accumulation, and decides which tiles get how many
+      samples in which frame */
+  std::unique_ptr<viewer::ProgressiveRenderer> progressive;
 };
 
 /*! window notifies us that we got resized */
 void Viewer::resize(const vec2i &newSize)
 {
-  if (!accumBuffer)
-    accumBuffer = owlDeviceBufferCreate(context,OWL_FLOAT4,1,nullptr);
-  owlBufferResize(accumBuffer,newSize.x*newSize.y);
-  owlParamsSetBuffer(lp,"accumBuffer",accumBuffer);
+  progressive->resize(newSize);
   OWLViewer::resize(newSize);
   cameraChanged();
 }
@@ -197,7 +196,7 @@ void Viewer::cameraChanged()
     = cosFovy * normalize(cross(camera_ddu,camera_d00));
   camera_d00 -= 0.5f * camera_ddu;
   camera_d00 -= 0.5f * camera_ddv;
-  accumID = 0;
+  progressive->invalidate();
 
   float focal_distance = length(lookAt-lookFrom);// + (-1.5f); // 0.f for 1984 scene!
   focal_distance = fmaxf(focal_distance, 1e-2f);
@@ -576,19 +575,19 @@ Viewer::Viewer(Viewer::Setup stp)
   // -------------------------------------------------------
   // set up launch params
   // -------------------------------------------------------
-  OWLVarDecl launchParamsVars[] = {
+  std::vector<OWLVarDecl> launchParamsVars = {
     { "world",         OWL_GROUP,  OWL_OFFSETOF(LaunchParams,world)},
-    { "accumBuffer",   OWL_BUFPTR, OWL_OFFSETOF(LaunchParams,accumBuffer) },
-    { "accumID",   OWL_INT, OWL_OFFSETOF(LaunchParams,accumID) },
     { "numLights",     OWL_INT, OWL_OFFSETOF(LaunchParams,numLights)},
     { "lights",        OWL_BUFPTR, OWL_OFFSETOF(LaunchParams,lights)},
     { "ambient_light_color", OWL_FLOAT3, OWL_OFFSETOF(LaunchParams,ambient_light_color)},
     { "scene_epsilon", OWL_FLOAT, OWL_OFFSETOF(LaunchParams,scene_epsilon)},
-    { nullptr/* sentinel to mark end of list */ }
   };
+  viewer::ProgressiveRenderer::declareVariables
+    (launchParamsVars,OWL_OFFSETOF(LaunchParams,progressive));
+  launchParamsVars.push_back({ nullptr/* sentinel to mark end of list */ });
 
   // ----------- create object  ----------------------------
-  lp = owlParamsCreate(context,sizeof(LaunchParams),launchParamsVars,-1);
+  lp = owlParamsCreate(context,sizeof(LaunchParams),launchParamsVars.data(),-1);
 
   owlParamsSetGroup (lp,"world",        world);
 
@@ -630,6 +629,8 @@ Viewer::Viewer(Viewer::Setup stp)
   /* camera and frame buffer get set in resiez() and cameraChanged() */
   owlRayGenSetGroup (rayGen,"world",        world);
 
+  progressive.reset(new viewer::ProgressiveRenderer(context,rayGen,lp));
+
   // ##################################################################
   // build *SBT* required to trace the groups
   // ##################################################################
@@ -656,9 +657,8 @@ void Viewer::render()
     owlBuildSBT(context);
     sbtDirty = false;
   }
-  owlParamsSet1i(lp,"accumID",accumID);
-  accumID++;
-  owlLaunch2D(rayGen,fbSize.x,fbSize.y,lp);
+  // once every tile has converged, this doesn't launch anything
+  progressive->render();
 }
 
 
@@ -0,0 +1,38 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+// CHECK() macro shared by the host-only tests; each test defines
+// OWL_TEST_NAME (e.g., "t04") before including this, so failures
+// report which test (and line) they came from.
+
+#include "owl/common/owl-common.h"
+#include <iostream>
+#include <stdlib.h>
+
+#ifndef OWL_TEST_NAME
+# error "define OWL_TEST_NAME before including owlTestCheck.h"
+#endif
+
+#define CHECK(cond)                                                     \
+  if (!(cond)) {                                                        \
+    std::cerr << OWL_TERMINAL_RED                                       \
+              << "#owl.test(" OWL_TEST_NAME "): check failed, line "    \
+              << __LINE__                                               \
+              << ": " #cond << OWL_TERMINAL_DEFAULT << std::endl;       \
+    exit(1);                                                            \
+  }
@@ -0,0 +1,149 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of the logic that decides, for an instance group,
+// whether instance records get assembled on the device, and what has
+// to be re-uploaded to a device before doing so. Does not need a GPU.
+
+#include "owl/InstanceBuildPlan.h"
+#include <iostream>
+
+#define OWL_TEST_NAME "t04"
+#include "../owlTestCheck.h"
+
+using namespace owl;
+
+/*! default group, as created by owlInstanceGroupCreate: host-side
+    transforms, nothing else set -> original host-side code path */
+void testHostOnly()
+{
+  InstanceSources sources;
+  InstanceDeviceState state;
+  InstanceBuildPlan plan = InstanceBuildPlan::compute(sources,10,state,true);
+  CHECK(!plan.assembleOnDevice);
+  CHECK(plan.transforms == INSTANCE_FIELD_HOST);
+  CHECK(plan.instanceIDs == INSTANCE_FIELD_DEFAULT);
+  CHECK(plan.visibilityMasks == INSTANCE_FIELD_DEFAULT);
+  plan.commit(state);
+  CHECK(state.childTableSize == 0);
+}
+
+/*! transforms from a buffer: first build uploads the child table,
+    refits without any changes touch nothing on the host */
+void testDeviceTransforms()
+{
+  InstanceSources sources;
+  sources.transforms.source = INSTANCE_FIELD_BUFFER;
+  sources.transforms.version++;
+  InstanceDeviceState state;
+
+  InstanceBuildPlan plan = InstanceBuildPlan::compute(sources,100,state,true);
+  CHECK(plan.assembleOnDevice);
+  CHECK(plan.rebuildChildTable);
+  CHECK(!plan.uploadTransforms);
+  CHECK(!plan.uploadInstanceIDs);
+  CHECK(!plan.uploadVisibilityMasks);
+  plan.commit(state);
+  CHECK(state.childTableSize == 100);
+
+  // user kernel wrote new transforms into the buffer -> refit
+  for (int frame=0;frame<3;frame++) {
+    plan = InstanceBuildPlan::compute(sources,100,state,false);
+    CHECK(plan.assembleOnDevice);
+    CHECK(!plan.rebuildChildTable);
+    CHECK(!plan.uploadTransforms);
+    plan.commit(state);
+  }
+
+  // a full rebuild may have changed child traversables
+  plan = InstanceBuildPlan::compute(sources,100,state,true);
+  CHECK(plan.rebuildChildTable);
+  plan.commit(state);
+
+  // changing a child invalidates the table even for a refit
+  sources.childrenVersion++;
+  plan = InstanceBuildPlan::compute(sources,100,state,false);
+  CHECK(plan.rebuildChildTable);
+  plan.commit(state);
+  plan = InstanceBuildPlan::compute(sources,100,state,false);
+  CHECK(!plan.rebuildChildTable);
+}
+
+/*! mixed: masks from a buffer, host-side transforms and IDs -> the
+    host arrays get uploaded once, and again only when they change */
+void testMixedSources()
+{
+  InstanceSources sources;
+  sources.instanceIDs.source = INSTANCE_FIELD_HOST;
+  sources.instanceIDs.version++;
+  sources.visibilityMasks.source = INSTANCE_FIELD_BUFFER;
+  sources.visibilityMasks.version++;
+  InstanceDeviceState state;
+
+  InstanceBuildPlan plan = InstanceBuildPlan::compute(sources,8,state,true);
+  CHECK(plan.assembleOnDevice);
+  CHECK(plan.uploadTransforms);
+  CHECK(plan.uploadInstanceIDs);
+  CHECK(!plan.uploadVisibilityMasks);
+  plan.commit(state);
+
+  plan = InstanceBuildPlan::compute(sources,8,state,false);
+  CHECK(!plan.uploadTransforms);
+  CHECK(!plan.uploadInstanceIDs);
+  plan.commit(state);
+
+  sources.transforms.version++;
+  plan = InstanceBuildPlan::compute(sources,8,state,false);
+  CHECK(plan.uploadTransforms);
+  CHECK(!plan.uploadInstanceIDs);
+  CHECK(!plan.rebuildChildTable);
+  plan.commit(state);
+}
+
+/*! switching from device back to host path and back again must not
+    re-use stale device state */
+void testSwitchBackAndForth()
+{
+  InstanceSources sources;
+  sources.transforms.source = INSTANCE_FIELD_BUFFER;
+  InstanceDeviceState state;
+  InstanceBuildPlan::compute(sources,4,state,true).commit(state);
+  CHECK(state.childTableSize == 4);
+
+  sources.transforms.source = INSTANCE_FIELD_HOST;
+  sources.transforms.version++;
+  InstanceBuildPlan plan = InstanceBuildPlan::compute(sources,4,state,true);
+  CHECK(!plan.assembleOnDevice);
+  plan.commit(state);
+
+  sources.instanceIDs.source = INSTANCE_FIELD_BUFFER;
+  plan = InstanceBuildPlan::compute(sources,4,state,false);
+  CHECK(plan.assembleOnDevice);
+  CHECK(plan.rebuildChildTable);
+  CHECK(plan.uploadTransforms);
+}
+
+int main()
+{
+  testHostOnly();
+  testDeviceTransforms();
+  testMixedSources();
+  testSwitchBackAndForth();
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t04): all instance build plan tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
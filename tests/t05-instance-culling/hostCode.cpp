@@ -0,0 +1,263 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of the instance culling/LOD selection stage that
+// runs before the IAS build: checks the culled/compacted list against
+// a brute-force reference, and prints how long selection takes for a
+// large instanced 'forest'. Does not need a GPU.
+
+#include "owl/InstanceCulling.h"
+#include "owl/common/geometry/sphereClustering.h"
+#include <iostream>
+#include <random>
+
+#define OWL_TEST_NAME "t05"
+#include "../owlTestCheck.h"
+
+using namespace owl;
+using namespace owl::common;
+
+void testFrustum()
+{
+  CullingView view
+    = CullingView::fromCamera(vec3f(0.f),vec3f(0.f,0.f,1.f),vec3f(0.f,1.f,0.f),
+                              90.f,1.f,.1f,100.f);
+  CHECK(view.numPlanes == 6);
+  const box3f ahead(vec3f(-1.f,-1.f,9.f),vec3f(1.f,1.f,11.f));
+  const box3f behind(vec3f(-1.f,-1.f,-11.f),vec3f(1.f,1.f,-9.f));
+  const box3f straddling(vec3f(9.f,-1.f,9.f),vec3f(11.f,1.f,11.f));
+  const box3f tooFar(vec3f(-1.f,-1.f,200.f),vec3f(1.f,1.f,201.f));
+  CHECK(InstanceCuller::classify(view,ahead)      == CULL_INSIDE);
+  CHECK(InstanceCuller::classify(view,behind)     == CULL_OUTSIDE);
+  CHECK(InstanceCuller::classify(view,straddling) == CULL_PARTIAL);
+  CHECK(InstanceCuller::classify(view,tooFar)     == CULL_OUTSIDE);
+  CHECK(InstanceCuller::distance(vec3f(0.f),ahead) == 9.f);
+}
+
+/*! brute-force reference: same decisions, without any hierarchy */
+void referenceSelect(const CullingView &view,
+                     const std::vector<affine3f> &xfms,
+                     const box3f &objectBounds,
+                     const std::vector<float> &lodDistances,
+                     std::vector<InstanceCuller::Selection> &result)
+{
+  result.clear();
+  for (size_t i=0;i<xfms.size();i++) {
+    const box3f box = xfmBounds(xfms[i],objectBounds);
+    if (InstanceCuller::classify(view,box) == CULL_OUTSIDE) continue;
+    const float dist = view.lodScale*InstanceCuller::distance(view.eye,box);
+    for (size_t k=0;k<lodDistances.size();k++)
+      if (dist <= lodDistances[k]) {
+        result.push_back({uint32_t(i),uint32_t(k)});
+        break;
+      }
+  }
+}
+
+void testForest(size_t numTrees, bool verbose)
+{
+  std::mt19937 rng(0x1234);
+  std::uniform_real_distribution<float> pos(-1000.f,1000.f);
+  std::vector<affine3f> xfms(numTrees);
+  for (auto &xfm : xfms)
+    xfm = affine3f::translate(vec3f(pos(rng),0.f,pos(rng)));
+  const box3f treeBounds(vec3f(-1.f,0.f,-1.f),vec3f(1.f,10.f,1.f));
+  std::vector<box3f>    bounds(numTrees,treeBounds);
+  const std::vector<float> lodDistances = { 50.f, 200.f, 600.f };
+  std::vector<uint32_t> lodBegin(numTrees+1);
+  std::vector<float>    lodMaxDistances;
+  for (size_t i=0;i<numTrees;i++) {
+    lodBegin[i] = (uint32_t)lodMaxDistances.size();
+    lodMaxDistances.insert(lodMaxDistances.end(),
+                           lodDistances.begin(),lodDistances.end());
+  }
+  lodBegin[numTrees] = (uint32_t)lodMaxDistances.size();
+
+  InstanceCuller culler;
+  double t0 = getCurrentTime();
+  culler.build(numTrees,xfms.data(),bounds.data(),
+               lodBegin.data(),lodMaxDistances.data());
+  double t1 = getCurrentTime();
+
+  std::vector<InstanceCuller::Selection> selection, reference;
+  const int numViews = 8;
+  double selectTime = 0.;
+  for (int v=0;v<numViews;v++) {
+    const float angle = v*2.f*float(M_PI)/numViews;
+    const vec3f eye(pos(rng)*.5f,2.f,pos(rng)*.5f);
+    CullingView view
+      = CullingView::fromCamera(eye,eye+vec3f(cosf(angle),0.f,sinf(angle)),
+                                vec3f(0.f,1.f,0.f),60.f,16.f/9.f,.1f,0.f);
+    double s0 = getCurrentTime();
+    culler.select(view,selection);
+    selectTime += getCurrentTime()-s0;
+
+    referenceSelect(view,xfms,treeBounds,lodDistances,reference);
+    CHECK(selection.size() == reference.size());
+    for (size_t i=0;i<selection.size();i++) {
+      CHECK(selection[i].instance == reference[i].instance);
+      CHECK(selection[i].lod      == reference[i].lod);
+    }
+  }
+  if (verbose)
+    std::cout << "#owl.test(t05): " << prettyNumber(numTrees) << " instances, "
+              << "hierarchy build " << prettyDouble(t1-t0) << "s ("
+              << prettyNumber(culler.numNodes()) << " nodes), "
+              << "select " << prettyDouble(selectTime/numViews) << "s/view, "
+              << "last view kept " << prettyNumber(selection.size())
+              << " instances" << std::endl;
+}
+
+/*! instances with unknown (empty) bounds are never frustum culled,
+    and select their LOD by distance to their origin */
+void testUnbounded()
+{
+  std::vector<affine3f> xfms = {
+    affine3f::translate(vec3f(0.f,0.f,-10.f)),
+    affine3f::translate(vec3f(0.f,0.f,-100.f))
+  };
+  std::vector<box3f> bounds(2);
+  std::vector<uint32_t> lodBegin = { 0, 2, 4 };
+  std::vector<float> lodMaxDistances = { 20.f, 50.f, 20.f, 50.f };
+  InstanceCuller culler;
+  culler.build(2,xfms.data(),bounds.data(),lodBegin.data(),lodMaxDistances.data());
+  CullingView view
+    = CullingView::fromCamera(vec3f(0.f),vec3f(0.f,0.f,1.f),vec3f(0.f,1.f,0.f),
+                              60.f,1.f,0.f,0.f);
+  std::vector<InstanceCuller::Selection> selection;
+  culler.select(view,selection);
+  CHECK(selection.size() == 1);
+  CHECK(selection[0].instance == 0 && selection[0].lod == 0);
+  view.lodScale = 3.f;
+  culler.select(view,selection);
+  CHECK(selection.size() == 1 && selection[0].lod == 1);
+}
+
+/*! many instances sharing the same position (and thus the same
+    morton code) must still get split into leaves, and still cull
+    correctly */
+void testCoincident()
+{
+  const size_t numInstances = 10*InstanceCuller::clusterSize+3;
+  std::vector<affine3f> xfms(numInstances,
+                             affine3f::translate(vec3f(0.f,0.f,10.f)));
+  std::vector<box3f> bounds(numInstances,box3f(vec3f(-1.f),vec3f(1.f)));
+  InstanceCuller culler;
+  culler.build(numInstances,xfms.data(),bounds.data(),nullptr,nullptr);
+  // a binary tree over at least 11 leaves
+  CHECK(culler.numNodes() >= 21);
+  CHECK(culler.numNodes() % 2 == 1);
+
+  std::vector<InstanceCuller::Selection> selection;
+  CullingView view
+    = CullingView::fromCamera(vec3f(0.f),vec3f(0.f,0.f,1.f),vec3f(0.f,1.f,0.f),
+                              60.f,1.f,0.f,0.f);
+  culler.select(view,selection);
+  CHECK(selection.size() == numInstances);
+  for (size_t i=0;i<selection.size();i++)
+    CHECK(selection[i].instance == i && selection[i].lod == 0);
+  view
+    = CullingView::fromCamera(vec3f(0.f),vec3f(0.f,0.f,-1.f),vec3f(0.f,1.f,0.f),
+                              60.f,1.f,0.f,0.f);
+  culler.select(view,selection);
+  CHECK(selection.empty());
+}
+
+/*! instances of a spheres group with levels of detail (as
+    owlSpheresGeomCreateLODs creates them): each level's bounds come
+    from the same center/radius reduction the spheres groups use for
+    their bounds, and have to enclose all of that level's spheres */
+void testSphereLODChild()
+{
+  std::mt19937 rng(0x5678);
+  std::uniform_real_distribution<float> pos(-5.f,5.f);
+  const size_t numSpheres = 20000;
+  std::vector<vec3f> centers(numSpheres);
+  std::vector<float> radii(numSpheres);
+  for (size_t i=0;i<numSpheres;i++) {
+    centers[i] = vec3f(pos(rng),pos(rng),pos(rng));
+    radii[i]   = .05f+.02f*pos(rng);
+  }
+  const StridedVec3fs      inputCenters(centers);
+  const StridedArray<float> inputRadii(radii);
+  const SphereLODHierarchy hierarchy = buildSphereLODs(inputCenters,inputRadii);
+  const int numLevels = int(hierarchy.levels.size());
+  CHECK(numLevels >= 2);
+
+  // finest (ie, the input) up close, then ever coarser levels
+  const int lods[3] = { numLevels, numLevels/2, 0 };
+  box3f objectBounds;
+  for (int lod : lods) {
+    std::vector<vec3f> lodCenters;
+    std::vector<float> lodRadii;
+    getSphereLOD(hierarchy,lod,inputCenters,inputRadii,lodCenters,lodRadii);
+    const box3f lodBounds
+      = computeBounds(StridedVec3fs(lodCenters),StridedArray<float>(lodRadii));
+    box3f reference;
+    for (size_t i=0;i<lodCenters.size();i++)
+      reference.extend(box3f(lodCenters[i]-vec3f(lodRadii[i]),
+                             lodCenters[i]+vec3f(lodRadii[i])));
+    CHECK(lodBounds.lower == reference.lower);
+    CHECK(lodBounds.upper == reference.upper);
+    objectBounds.extend(lodBounds);
+  }
+
+  const size_t numInstances = 2000;
+  std::uniform_real_distribution<float> place(-500.f,500.f);
+  std::vector<affine3f> xfms(numInstances);
+  for (auto &xfm : xfms)
+    xfm = affine3f::translate(vec3f(place(rng),0.f,place(rng)));
+  std::vector<box3f> bounds(numInstances,objectBounds);
+  const std::vector<float> lodDistances = { 40.f, 150.f, 400.f };
+  std::vector<uint32_t> lodBegin(numInstances+1);
+  std::vector<float>    lodMaxDistances;
+  for (size_t i=0;i<numInstances;i++) {
+    lodBegin[i] = (uint32_t)lodMaxDistances.size();
+    lodMaxDistances.insert(lodMaxDistances.end(),
+                           lodDistances.begin(),lodDistances.end());
+  }
+  lodBegin[numInstances] = (uint32_t)lodMaxDistances.size();
+
+  InstanceCuller culler;
+  culler.build(numInstances,xfms.data(),bounds.data(),
+               lodBegin.data(),lodMaxDistances.data());
+  CullingView view
+    = CullingView::fromCamera(vec3f(0.f,2.f,0.f),vec3f(1.f,2.f,1.f),
+                              vec3f(0.f,1.f,0.f),60.f,1.f,.1f,0.f);
+  std::vector<InstanceCuller::Selection> selection, reference;
+  culler.select(view,selection);
+  referenceSelect(view,xfms,objectBounds,lodDistances,reference);
+  CHECK(!selection.empty());
+  CHECK(selection.size() == reference.size());
+  for (size_t i=0;i<selection.size();i++) {
+    CHECK(selection[i].instance == reference[i].instance);
+    CHECK(selection[i].lod      == reference[i].lod);
+  }
+}
+
+int main()
+{
+  testFrustum();
+  testUnbounded();
+  testCoincident();
+  testSphereLODChild();
+  testForest(1000,false);
+  testForest(1000000,true);
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t05): all instance culling tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
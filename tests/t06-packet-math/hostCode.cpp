@@ -0,0 +1,295 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of the SoA packet math types (owl/common/math/packet):
+// checks every operation against the scalar owl math it mirrors, for
+// both 4- and 8-wide packets, and prints how much faster transforming
+// a large number of boxes gets, with the boxes kept in AoS and in SoA
+// layout. Does not need a GPU.
+
+#include "owl/common/math/packet/vec3fx.h"
+#include <iostream>
+#include <random>
+#include <vector>
+
+#define OWL_TEST_NAME "t06"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+std::mt19937 rng(0x1234);
+std::uniform_real_distribution<float> uniform(-10.f,10.f);
+
+vec3f randomVec() { return vec3f(uniform(rng),uniform(rng),uniform(rng)); }
+
+bool close(float a, float b)
+{ return fabsf(a-b) <= 1e-5f*std::max(1.f,std::max(fabsf(a),fabsf(b))); }
+bool close(const vec3f &a, const vec3f &b)
+{ return close(a.x,b.x) && close(a.y,b.y) && close(a.z,b.z); }
+/*! for results of longer computations, where we can only expect
+    closeness relative to the magnitude of the inputs */
+bool close(const vec3f &a, const vec3f &b, float eps)
+{ return reduce_max(abs(a-b)) <= eps; }
+
+template<int N>
+void testLaneWise()
+{
+  const int numTrials = 1000;
+  for (int trial=0;trial<numTrials;trial++) {
+    vec3f a[N], b[N];
+    for (int i=0;i<N;i++) { a[i] = randomVec(); b[i] = randomVec(); }
+    const vec3fx_t<N> A = vec3fx_t<N>::load(a);
+    const vec3fx_t<N> B = vec3fx_t<N>::load(b);
+
+    const vec3fx_t<N> sum = A+B, diff = A-B, prod = A*B, quot = A/B;
+    const vec3fx_t<N> mn = min(A,B), mx = max(A,B), cr = cross(A,B);
+    const vec3fx_t<N> nrm = normalize(A), scaled = 2.f*A;
+    const floatx<N>   dt = dot(A,B), len = length(A);
+    const boolx<N>    lt = any_less_than(A,B), alt = all_less_than(A,B);
+    const boolx<N>    gt = any_greater_than(A,B);
+    for (int i=0;i<N;i++) {
+      CHECK(sum.get(i)  == a[i]+b[i]);
+      CHECK(diff.get(i) == a[i]-b[i]);
+      CHECK(prod.get(i) == a[i]*b[i]);
+      CHECK(close(quot.get(i),a[i]/b[i]));
+      CHECK(mn.get(i)   == min(a[i],b[i]));
+      CHECK(mx.get(i)   == max(a[i],b[i]));
+      CHECK(close(cr.get(i),cross(a[i],b[i])));
+      CHECK(close(nrm.get(i),normalize(a[i])));
+      CHECK(scaled.get(i) == 2.f*a[i]);
+      CHECK(close(dt[i],dot(a[i],b[i])));
+      CHECK(close(len[i],length(a[i])));
+      CHECK(lt[i]  == any_less_than(a[i],b[i]));
+      CHECK(alt[i] == all_less_than(a[i],b[i]));
+      CHECK(gt[i]  == any_greater_than(a[i],b[i]));
+    }
+    CHECK(any(lt) == (movemask(lt) != 0));
+    CHECK(close(reduce_add(dt),[&]{ float s=0.f; for (int i=0;i<N;i++) s+=dt[i]; return s; }()));
+  }
+}
+
+template<int N>
+void testGatherScatter()
+{
+  const int numItems = 100;
+  std::vector<vec3f> items(numItems);
+  for (auto &v : items) v = randomVec();
+  int32_t indices[N];
+  for (int i=0;i<N;i++) indices[i] = (i*37+11) % numItems;
+
+  const vec3fx_t<N> g = vec3fx_t<N>::gather(items.data(),indices);
+  for (int i=0;i<N;i++)
+    CHECK(g.get(i) == items[indices[i]]);
+
+  std::vector<vec3f> out(numItems,vec3f(0.f));
+  g.scatter(out.data(),indices);
+  for (int i=0;i<N;i++)
+    CHECK(out[indices[i]] == items[indices[i]]);
+
+  // strided: vec3fs embedded in a larger struct, as in a vertex array
+  struct Vertex { float pad; vec3f pos; float moarPad[2]; };
+  std::vector<Vertex> vertices(N);
+  for (int i=0;i<N;i++) vertices[i].pos = items[i];
+  const vec3fx_t<N> s
+    = vec3fx_t<N>::loadStrided(&vertices[0].pos,sizeof(Vertex));
+  for (int i=0;i<N;i++)
+    CHECK(s.get(i) == items[i]);
+
+  std::vector<affine3f> xfms(numItems);
+  for (auto &x : xfms) x = affine3f(randomVec(),randomVec(),randomVec(),randomVec());
+  const affine3fx_t<N> X = affine3fx_t<N>::gather(xfms.data(),indices);
+  for (int i=0;i<N;i++) {
+    const affine3f x = X.get(i);
+    CHECK(x.l.vx == xfms[indices[i]].l.vx && x.p == xfms[indices[i]].p);
+  }
+}
+
+template<int N>
+void testBoxes()
+{
+  for (int trial=0;trial<1000;trial++) {
+    box3f boxes[N];
+    affine3f xfms[N];
+    for (int i=0;i<N;i++) {
+      boxes[i] = box3f().including(randomVec()).including(randomVec());
+      xfms[i]  = affine3f(randomVec(),randomVec(),randomVec(),randomVec());
+    }
+    // one empty lane, which has to stay empty
+    boxes[N/2] = box3f();
+
+    const box3fx_t<N>    B = box3fx_t<N>::load(boxes);
+    const affine3fx_t<N> X = affine3fx_t<N>::load(xfms);
+    const box3fx_t<N>    T = xfmBounds(X,B);
+    const boolx<N>       E = B.empty();
+    box3f all;
+    for (int i=0;i<N;i++) {
+      CHECK(E[i] == boxes[i].empty());
+      const box3f ref = xfmBounds(xfms[i],boxes[i]);
+      if (boxes[i].empty()) {
+        CHECK(T.get(i).empty());
+        continue;
+      }
+      all.extend(boxes[i]);
+      CHECK(close(T.get(i).lower,ref.lower,1e-3f));
+      CHECK(close(T.get(i).upper,ref.upper,1e-3f));
+      const vec3f p = xfmPoint(xfms[i],boxes[i].center());
+      CHECK(close(xfmPoint(X,B.center()).get(i),p));
+    }
+    const box3f red = B.reduce();
+    CHECK(red.lower == all.lower && red.upper == all.upper);
+  }
+}
+
+/*! best-of-several time for one call of 'pass', over data that
+    stays in cache, so this measures the math, not memory bandwidth
+    or page faults */
+template<typename Lambda>
+double bestTime(const Lambda &pass)
+{
+  double best = 1e20;
+  for (int i=0;i<20;i++) {
+    const double t0 = getCurrentTime();
+    for (int rep=0;rep<16;rep++)
+      pass();
+    best = std::min(best,(getCurrentTime()-t0)/16);
+  }
+  return best;
+}
+
+/*! boxes and transforms in SoA layout - one array per component -
+    so packets load and store with plain vector loads and stores */
+struct SoAArrays {
+  SoAArrays(size_t count, int numComponents)
+    : count(count), data(count*numComponents)
+  {}
+  float *operator[](int c) { return data.data()+c*count; }
+  size_t count;
+  std::vector<float> data;
+};
+
+template<int N>
+inline vec3fx_t<N> loadSoA(SoAArrays &a, int c, size_t i)
+{
+  return vec3fx_t<N>(floatx<N>::load(a[c+0]+i),
+                     floatx<N>::load(a[c+1]+i),
+                     floatx<N>::load(a[c+2]+i));
+}
+
+template<int N>
+inline void storeSoA(SoAArrays &a, int c, size_t i, const vec3fx_t<N> &v)
+{
+  v.x.store(a[c+0]+i); v.y.store(a[c+1]+i); v.z.store(a[c+2]+i);
+}
+
+/*! seconds per pass of transforming all boxes N at a time, with
+    AoS inputs and outputs (so every packet gets transposed on load
+    and store) */
+template<int N>
+double benchmarkXfmBoundsAoS(const std::vector<affine3f> &xfms,
+                             const std::vector<box3f> &boxes,
+                             std::vector<box3f> &result)
+{
+  return bestTime([&]{
+      for (size_t i=0;i<boxes.size();i+=N)
+        xfmBounds(affine3fx_t<N>::load(&xfms[i]),
+                  box3fx_t<N>::load(&boxes[i])).store(&result[i]);
+    });
+}
+
+/*! same, but with data that stays in SoA layout */
+template<int N>
+double benchmarkXfmBoundsSoA(SoAArrays &xfms, SoAArrays &boxes, SoAArrays &result)
+{
+  return bestTime([&]{
+      for (size_t i=0;i<boxes.count;i+=N) {
+        affine3fx_t<N> X;
+        X.vx = loadSoA<N>(xfms,0,i);
+        X.vy = loadSoA<N>(xfms,3,i);
+        X.vz = loadSoA<N>(xfms,6,i);
+        X.p  = loadSoA<N>(xfms,9,i);
+        const box3fx_t<N> B(loadSoA<N>(boxes,0,i),loadSoA<N>(boxes,3,i));
+        const box3fx_t<N> T = xfmBounds(X,B);
+        storeSoA(result,0,i,T.lower);
+        storeSoA(result,3,i,T.upper);
+      }
+    });
+}
+
+void benchmark()
+{
+  const size_t count = 1<<14;
+  std::vector<affine3f> xfms(count);
+  std::vector<box3f>    boxes(count), result(count);
+  SoAArrays soaXfms(count,12), soaBoxes(count,6), soaResult(count,6);
+  for (size_t i=0;i<count;i++) {
+    xfms[i]  = affine3f(randomVec(),randomVec(),randomVec(),randomVec());
+    boxes[i] = box3f().including(randomVec()).including(randomVec());
+    const float *x = (const float *)&xfms[i];
+    const float *b = (const float *)&boxes[i];
+    for (int c=0;c<12;c++) soaXfms[c][i]  = x[c];
+    for (int c=0;c<6;c++)  soaBoxes[c][i] = b[c];
+  }
+
+  const double scalarTime = bestTime([&]{
+      for (size_t i=0;i<count;i++)
+        result[i] = xfmBounds(xfms[i],boxes[i]);
+    });
+  const double times[2][2] = {
+    { benchmarkXfmBoundsAoS<4>(xfms,boxes,result),
+      benchmarkXfmBoundsAoS<8>(xfms,boxes,result) },
+    { benchmarkXfmBoundsSoA<4>(soaXfms,soaBoxes,soaResult),
+      benchmarkXfmBoundsSoA<8>(soaXfms,soaBoxes,soaResult) }
+  };
+  // the SoA results have to be the same as the AoS ones
+  for (size_t i=0;i<count;i++)
+    for (int c=0;c<6;c++)
+      CHECK(soaResult[c][i] == ((const float *)&result[i])[c]);
+
+  std::cout << "#owl.test(t06): xfmBounds of " << prettyNumber(count) << " boxes: "
+            << "scalar " << prettyNumber(count/scalarTime) << "/s" << std::endl;
+  for (int soa=0;soa<2;soa++)
+    std::cout << "#owl.test(t06):   " << (soa ? "SoA data" : "AoS data") << ": "
+              << "x4 " << prettyNumber(count/times[soa][0]) << "/s ("
+              << scalarTime/times[soa][0] << "x), "
+              << "x8 " << prettyNumber(count/times[soa][1]) << "/s ("
+              << scalarTime/times[soa][1] << "x)" << std::endl;
+}
+
+int main()
+{
+  std::cout << "#owl.test(t06): simd support:"
+#if OWL_HAVE_SSE
+            << " sse"
+#endif
+#if OWL_HAVE_AVX
+            << " avx"
+#endif
+#if OWL_HAVE_AVX2
+            << " avx2"
+#endif
+            << std::endl;
+  testLaneWise<4>();
+  testLaneWise<8>();
+  testGatherScatter<4>();
+  testGatherScatter<8>();
+  testBoxes<4>();
+  testBoxes<8>();
+  benchmark();
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t06): all packet math tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
@@ -0,0 +1,97 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Benchmark for the batch bounds reductions in
+// owl/common/math/boundsReduction.h: reports throughput in GB/s of
+// input data (ie, how close each reduction gets to memory bandwidth),
+// against a plain scalar loop. Usage: bench07-bounds-reduction
+// [numVertices] [numRepeats]
+
+#include "owl/common/math/boundsReduction.h"
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace owl::common;
+
+template<typename Lambda>
+double measure(const std::string &what, size_t numBytes, int numRepeats,
+               const Lambda &lambda)
+{
+  lambda(); // warm-up
+  const double t0 = getCurrentTime();
+  for (int i=0;i<numRepeats;i++)
+    lambda();
+  const double t = (getCurrentTime()-t0)/numRepeats;
+  std::cout << "  " << what << ": " << prettyDouble(t) << "s, "
+            << prettyDouble(numBytes/t) << "B/s" << std::endl;
+  return t;
+}
+
+int main(int ac, char **av)
+{
+  const size_t numVertices = ac > 1 ? std::stoll(av[1]) : 32*1024*1024;
+  const int    numRepeats  = ac > 2 ? std::stoi(av[2]) : 10;
+  const size_t numTriangles = 2*numVertices;
+
+  std::cout << "#owl.bench(07): " << prettyNumber(numVertices) << " vertices, "
+            << prettyNumber(numTriangles) << " triangles" << std::endl;
+
+  std::vector<vec3f> vertices(numVertices);
+  std::vector<vec3i> indices(numTriangles);
+  parallel_for_blocked(0,numVertices,64*1024,[&](size_t begin, size_t end){
+      std::mt19937 rng((unsigned)begin);
+      std::uniform_real_distribution<float> uniform(-100.f,100.f);
+      for (size_t i=begin;i<end;i++)
+        vertices[i] = vec3f(uniform(rng),uniform(rng),uniform(rng));
+    });
+  // mostly-coherent indices, as in a real mesh
+  for (size_t i=0;i<numTriangles;i++) {
+    const int base = int((i/2)%(numVertices-2));
+    indices[i] = vec3i(base,base+1,base+2);
+  }
+  std::vector<box3f> primBounds(numTriangles);
+
+  const size_t vertexBytes = numVertices*sizeof(vec3f);
+  const size_t indexBytes  = numTriangles*sizeof(vec3i);
+
+  box3f sink;
+  std::cout << "vertex bounds" << std::endl;
+  const double tScalar
+    = measure("scalar",vertexBytes,numRepeats,[&](){
+        box3f b; for (auto &v : vertices) b.extend(v); sink.extend(b);
+      });
+  const double tBatch
+    = measure("batch ",vertexBytes,numRepeats,[&](){
+        sink.extend(computeBounds(vertices));
+      });
+  std::cout << "  speedup " << prettyDouble(tScalar/tBatch) << std::endl;
+
+  std::cout << "triangle centroid bounds" << std::endl;
+  measure("batch ",indexBytes,numRepeats,[&](){
+      sink.extend(computeCentroidBounds(vertices,indices));
+    });
+
+  std::cout << "per-triangle bounds" << std::endl;
+  measure("batch ",indexBytes+numTriangles*sizeof(box3f),numRepeats,[&](){
+      sink.extend(computeTriangleBounds(primBounds.data(),vertices,indices));
+    });
+
+  // print something that depends on the results, so nothing gets
+  // optimized away
+  std::cout << "(bounds " << sink << ")" << std::endl;
+  return 0;
+}
@@ -0,0 +1,129 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of the batch bounds reductions in
+// owl/common/math/boundsReduction.h: checks all of them against plain
+// scalar loops, for tightly packed as well as strided/offset arrays,
+// and for sizes that do and do not fill entire packets and blocks.
+// Does not need a GPU.
+
+#include "owl/common/math/boundsReduction.h"
+#include <iostream>
+#include <random>
+#include <vector>
+
+#define OWL_TEST_NAME "t07"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+std::mt19937 rng(0x1234);
+std::uniform_real_distribution<float> uniform(-100.f,100.f);
+
+/*! vertex type with some other data interleaved, to test strides
+    and offsets the way a vertex buffer with normals would use them */
+struct Vertex {
+  float someOtherData;
+  vec3f position;
+  vec3f normal;
+};
+
+/*! same for indices */
+struct Prim {
+  vec3i index;
+  int   materialID;
+};
+
+bool same(const box3f &a, const box3f &b)
+{ return a.lower == b.lower && a.upper == b.upper; }
+
+void testSize(size_t numVertices, size_t numTriangles)
+{
+  std::vector<Vertex> vertices(numVertices);
+  for (auto &v : vertices) {
+    v.someOtherData = uniform(rng);
+    v.position = vec3f(uniform(rng),uniform(rng),uniform(rng));
+    v.normal = vec3f(uniform(rng),uniform(rng),uniform(rng));
+  }
+  std::vector<Prim> prims(numTriangles);
+  std::uniform_int_distribution<int> randomIndex(0,int(numVertices)-1);
+  for (auto &p : prims) {
+    // only use the first half of the vertices, so the bounds of the
+    // triangles differ from those of the vertices
+    p.index = vec3i(randomIndex(rng)/2,randomIndex(rng)/2,randomIndex(rng)/2);
+    p.materialID = -1;
+  }
+
+  const StridedVec3fs positions(vertices.data(),numVertices,sizeof(Vertex),
+                                offsetof(Vertex,position));
+  const StridedVec3is indices(prims.data(),numTriangles,sizeof(Prim),
+                              offsetof(Prim,index));
+
+  // ------------------------------------------------------------------
+  // scalar reference
+  // ------------------------------------------------------------------
+  box3f refVertexBounds;
+  for (auto &v : vertices) refVertexBounds.extend(v.position);
+  std::vector<box3f> refPrimBounds(numTriangles);
+  box3f refTriangleBounds, refCentroidBounds;
+  for (size_t i=0;i<numTriangles;i++) {
+    const vec3i idx = prims[i].index;
+    refPrimBounds[i] = box3f()
+      .including(vertices[idx.x].position)
+      .including(vertices[idx.y].position)
+      .including(vertices[idx.z].position);
+    refTriangleBounds.extend(refPrimBounds[i]);
+    refCentroidBounds.extend(refPrimBounds[i].center());
+  }
+
+  // ------------------------------------------------------------------
+  // batch versions
+  // ------------------------------------------------------------------
+  CHECK(same(computeBounds(positions),refVertexBounds));
+  CHECK(same(computeBounds(positions,indices),refTriangleBounds));
+  CHECK(same(computeCentroidBounds(positions,indices),refCentroidBounds));
+  CHECK(same(computeCentroidBounds(refPrimBounds.data(),numTriangles),
+             refCentroidBounds));
+
+  std::vector<box3f> primBounds(numTriangles);
+  CHECK(same(computeTriangleBounds(primBounds.data(),positions,indices),
+             refTriangleBounds));
+  for (size_t i=0;i<numTriangles;i++)
+    CHECK(same(primBounds[i],refPrimBounds[i]));
+
+  // tightly packed arrays, using the std::vector constructors
+  std::vector<vec3f> packed(numVertices);
+  for (size_t i=0;i<numVertices;i++) packed[i] = vertices[i].position;
+  CHECK(same(computeBounds(packed),refVertexBounds));
+}
+
+int main()
+{
+  // empty inputs have empty bounds
+  CHECK(computeBounds(StridedVec3fs()).empty());
+  CHECK(computeCentroidBounds((const box3f*)nullptr,0).empty());
+
+  // sizes around the packet width and the per-thread block size
+  const size_t block = boundsReductionBlockSize;
+  for (size_t n : { size_t(1), size_t(7), size_t(8), size_t(9), size_t(1000),
+                    block-1, block, block+1, 3*block+5 })
+    testSize(n+2,n);
+
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t07): all bounds reduction tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
@@ -0,0 +1,146 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of the batching logic behind the geometry bounds
+// kernels (owl/GeomBoundsBatch.h): checks the block assignment and
+// scratch memory layout of a batch with different kinds of jobs, and
+// that running the two reduction stages on the host gives the same
+// bounds as a plain loop. Does not need a GPU.
+
+#include "owl/GeomBoundsBatch.h"
+#include <iostream>
+#include <random>
+
+#define OWL_TEST_NAME "t08"
+#include "../owlTestCheck.h"
+
+using namespace owl;
+
+std::mt19937 rng(0x1234);
+std::uniform_real_distribution<float> uniform(-100.f,100.f);
+
+vec3f randomVec() { return vec3f(uniform(rng),uniform(rng),uniform(rng)); }
+
+bool same(const box3f &a, const box3f &b)
+{ return a.lower == b.lower && a.upper == b.upper; }
+
+/*! vertex with other data interleaved, to test stride and offset */
+struct Vertex {
+  vec3f normal;
+  vec3f position;
+};
+
+int main()
+{
+  const size_t perBlock = GeomBoundsBatch::itemsPerBlock;
+
+  // ------------------------------------------------------------------
+  // some meshes (one and two keys), some user geoms (with some empty
+  // prims), and an empty geom in between
+  // ------------------------------------------------------------------
+  std::vector<Vertex> mesh0(3*perBlock+17);
+  std::vector<Vertex> mesh1key0(perBlock), mesh1key1(perBlock);
+  std::vector<box3f>  prims0(2*perBlock+1), prims1key0(5), prims1key1(5);
+  for (auto &v : mesh0) { v.normal = randomVec(); v.position = randomVec(); }
+  for (auto &v : mesh1key0) { v.normal = randomVec(); v.position = randomVec(); }
+  for (auto &v : mesh1key1) { v.normal = randomVec(); v.position = randomVec(); }
+  for (auto *prims : { &prims0, &prims1key0, &prims1key1 })
+    for (size_t i=0;i<prims->size();i++)
+      (*prims)[i] = (i % 3 == 1)
+        ? box3f() // empty prims must not affect the bounds
+        : box3f(randomVec()).including(randomVec());
+  // an 'empty' prim that is not the default empty box
+  prims0[4] = box3f(vec3f(1e6f),vec3f(-1e6f));
+
+  GeomBoundsBatch batch;
+  CHECK(batch.addVertices(mesh0.data(),nullptr,mesh0.size(),
+                          sizeof(Vertex),offsetof(Vertex,position)) == 0);
+  CHECK(batch.addPrimBounds(prims0.data(),nullptr,0) == 1);
+  CHECK(batch.addVertices(mesh1key0.data(),mesh1key1.data(),mesh1key0.size(),
+                          sizeof(Vertex),offsetof(Vertex,position)) == 2);
+  CHECK(batch.addPrimBounds(prims0.data(),nullptr,prims0.size()) == 3);
+  CHECK(batch.addPrimBounds(prims1key0.data(),prims1key1.data(),5) == 4);
+
+  // ------------------------------------------------------------------
+  // block assignment: each job gets a contiguous range of blocks,
+  // with empty jobs getting none
+  // ------------------------------------------------------------------
+  const int expectedBlocks[] = { 4, 0, 1, 3, 1 };
+  CHECK(batch.numJobs() == 5);
+  CHECK(batch.numBlocks() == 9);
+  int nextBlock = 0;
+  for (int jobID=0;jobID<batch.numJobs();jobID++) {
+    const GeomBoundsJob &job = batch.jobs[jobID];
+    CHECK(job.numBlocks == expectedBlocks[jobID]);
+    CHECK(job.firstBlock == nextBlock);
+    uint64_t covered = 0;
+    for (int b=job.firstBlock;b<job.firstBlock+job.numBlocks;b++) {
+      CHECK(batch.blockJobs[b] == jobID);
+      uint64_t begin, end;
+      job.getItemRange(b,begin,end);
+      CHECK(begin == covered && end > begin);
+      covered = end;
+    }
+    CHECK(covered == job.count);
+    nextBlock += job.numBlocks;
+  }
+
+  // ------------------------------------------------------------------
+  // scratch layout: aligned, non-overlapping, and the header contains
+  // the jobs and block table
+  // ------------------------------------------------------------------
+  const GeomBoundsBatch::Layout layout = batch.getLayout();
+  CHECK(layout.blockJobsOffset % 16 == 0);
+  CHECK(layout.partialsOffset  % 16 == 0);
+  CHECK(layout.resultsOffset   % 16 == 0);
+  CHECK(layout.blockJobsOffset >= 5*sizeof(GeomBoundsJob));
+  CHECK(layout.headerSize == layout.blockJobsOffset + 9*sizeof(int32_t));
+  CHECK(layout.partialsOffset >= layout.headerSize);
+  CHECK(layout.resultsOffset >= layout.partialsOffset + 2*9*sizeof(box3f));
+  CHECK(layout.resultsSize == 2*5*sizeof(box3f));
+  CHECK(layout.totalSize == layout.resultsOffset + layout.resultsSize);
+  const std::vector<uint8_t> header = batch.getHeader();
+  CHECK(header.size() == layout.headerSize);
+  CHECK(memcmp(header.data()+layout.jobsOffset,batch.jobs.data(),
+               5*sizeof(GeomBoundsJob)) == 0);
+  CHECK(memcmp(header.data()+layout.blockJobsOffset,batch.blockJobs.data(),
+               9*sizeof(int32_t)) == 0);
+
+  // ------------------------------------------------------------------
+  // results, against plain loops
+  // ------------------------------------------------------------------
+  box3f expected[5][2];
+  for (auto &v : mesh0) expected[0][0].extend(v.position);
+  expected[0][1] = expected[0][0];
+  for (auto &v : mesh1key0) expected[2][0].extend(v.position);
+  for (auto &v : mesh1key1) expected[2][1].extend(v.position);
+  for (auto &b : prims0) if (!b.empty()) expected[3][0].extend(b);
+  expected[3][1] = expected[3][0];
+  for (auto &b : prims1key0) if (!b.empty()) expected[4][0].extend(b);
+  for (auto &b : prims1key1) if (!b.empty()) expected[4][1].extend(b);
+
+  box3f results[10];
+  batch.computeOnHost(results);
+  for (int jobID=0;jobID<5;jobID++)
+    for (int key=0;key<2;key++)
+      CHECK(same(results[2*jobID+key],expected[jobID][key]));
+  CHECK(results[2].empty() && results[3].empty());
+
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t08): all geom bounds batch tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
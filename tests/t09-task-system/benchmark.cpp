@@ -0,0 +1,107 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Scaling benchmark for owl::common's parallel layer: runs a
+// compute-bound parallel_for, a memory-bound parallel_reduce, and a
+// recursive task-group workload with 1, 2, 4, ... threads, and
+// reports speedups relative to one thread. Build it once with TBB and
+// once without (bench09-task-system-builtin) to compare the
+// backends. Usage: bench09-task-system [maxThreads]
+
+#include "owl/common/parallel/parallel_for.h"
+#include <iostream>
+#include <cmath>
+#include <iomanip>
+#include <vector>
+
+using namespace owl::common;
+
+/*! average time of a few runs of the given lambda, after a warm-up */
+template<typename Lambda>
+double measure(const Lambda &lambda)
+{
+  const int numRepeats = 5;
+  lambda();
+  const double t0 = getCurrentTime();
+  for (int i=0;i<numRepeats;i++)
+    lambda();
+  return (getCurrentTime()-t0)/numRepeats;
+}
+
+size_t fibTasks(int n)
+{
+  if (n < 2) return 1;
+  size_t a = 0, b = 0;
+  TaskGroup group;
+  group.run([&](){ a = fibTasks(n-1); });
+  b = fibTasks(n-2);
+  group.wait();
+  return a+b+1;
+}
+
+int main(int ac, char **av)
+{
+  setNumThreads(0);
+  const int maxThreads = ac > 1 ? std::stoi(av[1]) : getNumThreads();
+#if OWL_HAVE_TBB
+  std::cout << "#owl.bench(09): using TBB" << std::endl;
+#else
+  std::cout << "#owl.bench(09): using the built-in task system" << std::endl;
+#endif
+
+  const size_t numCompute = 10000000;
+  std::vector<float> out(numCompute);
+  const size_t numMemory = 100000000;
+  std::vector<float> values(numMemory,1.f);
+
+  std::cout << std::fixed << std::setprecision(2);
+  double base[3] = { 0., 0., 0. };
+  float sink = 0.f;
+  for (int numThreads=1;numThreads<=maxThreads;numThreads*=2) {
+    setNumThreads(numThreads);
+    const double tCompute = measure([&](){
+        parallel_for(numCompute,[&](size_t i){
+            float f = float(i);
+            for (int j=0;j<16;j++) f = sinf(f)+cosf(f);
+            out[i] = f;
+          });
+      });
+    const double tMemory = measure([&](){
+        sink += parallel_reduce(size_t(0),numMemory,size_t(64*1024),0.f,
+                                [&](size_t begin, size_t end){
+                                  float sum = 0.f;
+                                  for (size_t i=begin;i<end;i++) sum += values[i];
+                                  return sum;
+                                },
+                                [](float a, float b){ return a+b; });
+      });
+    size_t numTasks = 0;
+    const double tTasks = measure([&](){ numTasks = fibTasks(25); });
+    if (numThreads == 1) {
+      base[0] = tCompute; base[1] = tMemory; base[2] = tTasks;
+    }
+    std::cout << numThreads << " threads:"
+              << " compute " << prettyDouble(tCompute) << "s ("
+              << base[0]/tCompute << "x),"
+              << " reduce " << prettyDouble(numMemory*sizeof(float)/tMemory) << "B/s ("
+              << base[1]/tMemory << "x),"
+              << " tasks " << prettyDouble(numTasks/tTasks) << "/s ("
+              << base[2]/tTasks << "x)"
+              << std::endl;
+  }
+  std::cout << "(" << sink << ")" << std::endl;
+  return 0;
+}
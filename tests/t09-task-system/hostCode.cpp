@@ -0,0 +1,211 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of owl::common's parallel layer (parallel_for.h),
+// using whichever backend (TBB or the built-in work-stealing task
+// system) it was compiled with: coverage of all indices, parallel
+// reductions being deterministic, nested parallelism, task groups
+// (including exceptions), changing the number of threads, and
+// multiple application threads using it at the same time. Does not
+// need a GPU.
+
+#include "owl/common/parallel/parallel_for.h"
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <cmath>
+
+#define OWL_TEST_NAME "t09"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+/*! every index gets visited exactly once, for different block sizes */
+void testCoverage()
+{
+  const size_t N = 1000003;
+  for (size_t blockSize : { size_t(1), size_t(7), size_t(1024) }) {
+    std::vector<int> visited(N,0);
+    parallel_for(N,[&](size_t i){ visited[i]++; },blockSize);
+    for (size_t i=0;i<N;i++)
+      CHECK(visited[i] == 1);
+  }
+  // blocked, on a sub-range
+  std::vector<int> visited(N,0);
+  parallel_for_blocked(100,N,333,[&](size_t begin, size_t end){
+      CHECK(end > begin && end-begin <= 333);
+      for (size_t i=begin;i<end;i++) visited[i]++;
+    });
+  for (size_t i=0;i<N;i++)
+    CHECK(visited[i] == (i >= 100 ? 1 : 0));
+
+  // the trivial cases
+  int count = 0;
+  parallel_for(0,[&](int){ count++; });
+  parallel_for(1,[&](int){ count++; });
+  CHECK(count == 1);
+}
+
+float reduceFloats(const std::vector<float> &values)
+{
+  return parallel_reduce(size_t(0),values.size(),size_t(4096),0.f,
+                         [&](size_t begin, size_t end){
+                           float sum = 0.f;
+                           for (size_t i=begin;i<end;i++) sum += values[i];
+                           return sum;
+                         },
+                         [](float a, float b){ return a+b; });
+}
+
+/*! reductions give exact results for integers, and the same results
+    for floats no matter how many threads */
+void testReduce()
+{
+  const size_t N = 10000000;
+  const uint64_t sum
+    = parallel_reduce(size_t(0),N,size_t(1000),uint64_t(0),
+                      [](size_t begin, size_t end){
+                        uint64_t sum = 0;
+                        for (size_t i=begin;i<end;i++) sum += i;
+                        return sum;
+                      },
+                      [](uint64_t a, uint64_t b){ return a+b; });
+  CHECK(sum == uint64_t(N)*(N-1)/2);
+
+  // non-commutative combine, to check the order
+  const std::string digits
+    = parallel_reduce(size_t(0),size_t(10),size_t(1),std::string(),
+                      [](size_t begin, size_t){ return std::to_string(begin); },
+                      [](const std::string &a, const std::string &b){ return a+b; });
+  CHECK(digits == "0123456789");
+
+  std::vector<float> values(N);
+  for (size_t i=0;i<N;i++) values[i] = sinf(float(i));
+  float reference = 0.f;
+  for (int numThreads : { 1, 2, 4, 7 }) {
+    setNumThreads(numThreads);
+    const float result = reduceFloats(values);
+    if (numThreads == 1) reference = result;
+    CHECK(result == reference);
+  }
+  setNumThreads(4);
+}
+
+/*! parallel_for's inside parallel_for's, and task groups inside tasks */
+int fib(int n)
+{
+  if (n < 2) return n;
+  int a = 0, b = 0;
+  TaskGroup group;
+  group.run([&](){ a = fib(n-1); });
+  b = fib(n-2);
+  group.wait();
+  return a+b;
+}
+
+void testNesting()
+{
+  std::atomic<size_t> count { 0 };
+  parallel_for(64,[&](int){
+      parallel_for(1000,[&](int){
+          parallel_for(3,[&](int){ count++; });
+        });
+    });
+  CHECK(count == 64*1000*3);
+
+  CHECK(fib(22) == 17711);
+}
+
+void testTaskGroups()
+{
+  std::atomic<int> count { 0 };
+  TaskGroup group;
+  for (int i=0;i<1000;i++)
+    group.run([&](){ count++; });
+  group.wait();
+  CHECK(count == 1000);
+
+  // groups can be re-used after wait()
+  for (int i=0;i<10;i++)
+    group.run([&](){ count++; });
+  group.wait();
+  CHECK(count == 1010);
+
+  // exceptions get passed on to whoever waits
+  bool caught = false;
+  try {
+    TaskGroup throwing;
+    for (int i=0;i<100;i++)
+      throwing.run([i](){ if (i == 42) throw std::runtime_error("42"); });
+    throwing.wait();
+  } catch (const std::runtime_error &e) {
+    caught = (std::string(e.what()) == "42");
+  }
+  CHECK(caught);
+
+  // ... and through parallel_for's
+  caught = false;
+  try {
+    parallel_for(100000,[](size_t i){
+        if (i == 12345) throw std::runtime_error("12345");
+      });
+  } catch (const std::runtime_error &e) {
+    caught = true;
+  }
+  CHECK(caught);
+}
+
+/*! several application threads using the parallel layer at once */
+void testConcurrentCallers()
+{
+  std::vector<std::thread> callers;
+  std::atomic<size_t> count { 0 };
+  for (int t=0;t<4;t++)
+    callers.push_back(std::thread([&](){
+          for (int rep=0;rep<10;rep++)
+            parallel_for(10000,[&](int){ count++; });
+        }));
+  for (auto &caller : callers) caller.join();
+  CHECK(count == 4*10*10000);
+}
+
+int main()
+{
+  setNumThreads(4);
+  CHECK(getNumThreads() == 4);
+
+  testCoverage();
+  testReduce();
+  testNesting();
+  testTaskGroups();
+  testConcurrentCallers();
+
+  // everything still works on a single thread
+  setNumThreads(1);
+  CHECK(getNumThreads() == 1);
+  testCoverage();
+  testNesting();
+  testTaskGroups();
+
+  setNumThreads(0);
+  CHECK(getNumThreads() >= 1);
+  testCoverage();
+
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t09): all task system tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
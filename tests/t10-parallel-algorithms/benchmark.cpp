@@ -0,0 +1,135 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Benchmark for owl/common/parallel/parallel_algorithms.h (and
+// parallel_reduce): compares each algorithm against its serial std::
+// counterpart. Usage: bench10-parallel-algorithms [N...], where each
+// N is an element count (default: 10M and 100M; 1G needs about 16GB
+// of memory for the sorts)
+
+#include "owl/common/parallel/parallel_algorithms.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <numeric>
+
+using namespace owl::common;
+
+template<typename Setup, typename Lambda>
+double measure(const Setup &setup, const Lambda &lambda)
+{
+  setup();
+  const double t0 = getCurrentTime();
+  lambda();
+  return getCurrentTime()-t0;
+}
+
+void report(const std::string &what, size_t N, double tSerial, double tParallel)
+{
+  std::cout << "  " << std::setw(16) << std::left << what
+            << " std:: " << prettyDouble(tSerial) << "s ("
+            << prettyDouble(N/tSerial) << "/s), parallel "
+            << prettyDouble(tParallel) << "s ("
+            << prettyDouble(N/tParallel) << "/s), speedup "
+            << std::fixed << std::setprecision(2) << (tSerial/tParallel)
+            << std::defaultfloat << std::endl;
+}
+
+void run(size_t N)
+{
+  std::cout << "#owl.bench(10): " << prettyNumber(N) << " elements, "
+            << getNumThreads() << " threads" << std::endl;
+  std::vector<uint32_t> input(N);
+  parallel_for_blocked(0,N,1<<20,[&](size_t begin, size_t end){
+      std::mt19937 rng((unsigned)begin);
+      for (size_t i=begin;i<end;i++) input[i] = rng();
+    });
+  std::vector<uint32_t> data(N);
+  std::vector<uint64_t> scan(N);
+  auto reset = [&](){
+    parallel_for_blocked(0,N,1<<20,[&](size_t begin, size_t end){
+        std::copy(input.begin()+begin,input.begin()+end,data.begin()+begin);
+      });
+  };
+  uint64_t sink = 0;
+
+  report("reduce",N,
+         measure(reset,[&](){
+             sink += std::accumulate(data.begin(),data.end(),uint64_t(0));
+           }),
+         measure(reset,[&](){
+             sink += parallel_reduce(size_t(0),N,size_t(1<<16),uint64_t(0),
+                                     [&](size_t begin, size_t end){
+                                       uint64_t sum = 0;
+                                       for (size_t i=begin;i<end;i++) sum += data[i];
+                                       return sum;
+                                     },
+                                     [](uint64_t a, uint64_t b){ return a+b; });
+           }));
+
+  // scan of 32-bit values into 64-bit sums
+  std::vector<uint64_t> wide(N);
+  report("exclusive scan",N,
+         measure([&](){ std::copy(input.begin(),input.end(),wide.begin()); },
+                 [&](){
+                   uint64_t sum = 0;
+                   for (size_t i=0;i<N;i++) { scan[i] = sum; sum += wide[i]; }
+                   sink += sum;
+                 }),
+         measure([&](){ std::copy(input.begin(),input.end(),wide.begin()); },
+                 [&](){
+                   sink += parallel_exclusive_scan(wide.data(),scan.data(),N);
+                 }));
+
+  report("sort (uint32)",N,
+         measure(reset,[&](){ std::sort(data.begin(),data.end()); }),
+         measure(reset,[&](){ parallel_sort(data.data(),N); }));
+
+  std::vector<float> floats(N);
+  auto resetFloats = [&](){
+    parallel_for(N,[&](size_t i){ floats[i] = float(int32_t(input[i])); },1<<16);
+  };
+  report("sort (float)",N,
+         measure(resetFloats,[&](){ std::sort(floats.begin(),floats.end()); }),
+         measure(resetFloats,[&](){ parallel_sort(floats.data(),N); }));
+
+  auto greater = [](uint32_t a, uint32_t b){ return a > b; };
+  report("sort (custom)",N,
+         measure(reset,[&](){ std::sort(data.begin(),data.end(),greater); }),
+         measure(reset,[&](){ parallel_sort(data.data(),N,greater); }));
+
+  auto pred = [](uint32_t v){ return (v & 3) == 0; };
+  report("partition",N,
+         measure(reset,[&](){
+             sink += std::stable_partition(data.begin(),data.end(),pred)-data.begin();
+           }),
+         measure(reset,[&](){
+             sink += parallel_partition(data.data(),N,pred);
+           }));
+  std::cout << "  (" << sink << ")" << std::endl;
+}
+
+int main(int ac, char **av)
+{
+  std::vector<size_t> sizes;
+  for (int i=1;i<ac;i++)
+    sizes.push_back(std::stoll(av[i]));
+  if (sizes.empty())
+    sizes = { size_t(10000000), size_t(100000000) };
+  for (auto N : sizes)
+    run(N);
+  return 0;
+}
@@ -0,0 +1,198 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of owl/common/parallel/parallel_algorithms.h: checks
+// scans, sorts and partitions against the serial std:: algorithms, for
+// all supported key types, and for sizes around the block size. Does
+// not need a GPU.
+
+#include "owl/common/parallel/parallel_algorithms.h"
+#include <iostream>
+#include <random>
+#include <numeric>
+#include <limits>
+#include <cmath>
+
+#define OWL_TEST_NAME "t10"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+std::mt19937_64 rng(0x1234);
+
+const size_t block = parallelAlgorithmsBlockSize;
+const std::vector<size_t> sizes
+= { 0, 1, 2, 1000, block-1, block, block+1, 5*block+17 };
+
+template<typename T> T randomValue();
+template<> int32_t  randomValue() { return int32_t(rng()); }
+template<> uint32_t randomValue() { return uint32_t(rng()); }
+template<> int64_t  randomValue() { return int64_t(rng()); }
+template<> uint64_t randomValue() { return uint64_t(rng()); }
+template<> uint8_t  randomValue() { return uint8_t(rng()); }
+template<> float    randomValue()
+{ return std::uniform_real_distribution<float>(-1e6f,1e6f)(rng); }
+template<> double   randomValue()
+{ return std::uniform_real_distribution<double>(-1e6,1e6)(rng); }
+
+void testScan()
+{
+  for (size_t n : sizes) {
+    std::vector<uint64_t> in(n), out(n), expected(n);
+    for (auto &v : in) v = rng() % 1000;
+    uint64_t sum = 7;
+    for (size_t i=0;i<n;i++) { expected[i] = sum; sum += in[i]; }
+    CHECK(parallel_exclusive_scan(in.data(),out.data(),n,uint64_t(7)) == sum);
+    CHECK(out == expected);
+    // in place
+    CHECK(parallel_exclusive_scan(in.data(),in.data(),n,uint64_t(7)) == sum);
+    CHECK(in == expected);
+  }
+  // different operator, on a non-trivial type
+  std::vector<int> in(3*block+5);
+  for (auto &v : in) v = int(rng() % 1000000);
+  std::vector<int> out(in.size());
+  const int max = parallel_exclusive_scan(in.data(),out.data(),in.size(),-1,
+                                          [](int a, int b){ return std::max(a,b); });
+  CHECK(max == *std::max_element(in.begin(),in.end()));
+  int running = -1;
+  for (size_t i=0;i<in.size();i++) {
+    CHECK(out[i] == running);
+    running = std::max(running,in[i]);
+  }
+}
+
+template<typename KEY>
+void testSort()
+{
+  for (size_t n : sizes) {
+    std::vector<KEY> keys(n);
+    for (auto &k : keys) k = randomValue<KEY>();
+    // some duplicates
+    for (size_t i=1;i<n;i+=7) keys[i] = keys[i-1];
+    std::vector<KEY> expected = keys;
+    std::sort(expected.begin(),expected.end());
+    parallel_sort(keys.data(),n);
+    CHECK(keys == expected);
+  }
+}
+
+template<typename KEY>
+void testSortByKey()
+{
+  for (size_t n : sizes) {
+    std::vector<KEY> keys(n);
+    std::vector<uint32_t> values(n);
+    for (size_t i=0;i<n;i++) {
+      // few distinct keys, to check stability
+      keys[i] = KEY(randomValue<KEY>() / KEY(1 << 20));
+      values[i] = uint32_t(i);
+    }
+    std::vector<std::pair<KEY,uint32_t>> expected(n);
+    for (size_t i=0;i<n;i++) expected[i] = { keys[i], values[i] };
+    std::stable_sort(expected.begin(),expected.end(),
+                     [](const std::pair<KEY,uint32_t> &a,
+                        const std::pair<KEY,uint32_t> &b){
+                       return a.first < b.first;
+                     });
+    parallel_sort_by_key(keys.data(),values.data(),n);
+    for (size_t i=0;i<n;i++) {
+      CHECK(keys[i] == expected[i].first);
+      CHECK(values[i] == expected[i].second);
+    }
+  }
+}
+
+void testFloatSpecials()
+{
+  const float inf = std::numeric_limits<float>::infinity();
+  std::vector<float> keys(3*block);
+  for (auto &k : keys) k = randomValue<float>();
+  keys[0] = inf; keys[1] = -inf; keys[2] = 0.f; keys[3] = -0.f;
+  keys[4] = std::numeric_limits<float>::denorm_min();
+  keys[5] = -std::numeric_limits<float>::denorm_min();
+  std::vector<float> expected = keys;
+  std::sort(expected.begin(),expected.end());
+  parallel_sort(keys.data(),keys.size());
+  CHECK(keys.front() == -inf && keys.back() == inf);
+  for (size_t i=0;i<keys.size();i++)
+    CHECK(keys[i] == expected[i]);
+  // -0 sorts before +0
+  const size_t zero = std::lower_bound(keys.begin(),keys.end(),0.f)-keys.begin();
+  CHECK(std::signbit(keys[zero]) && !std::signbit(keys[zero+1]));
+}
+
+struct Item {
+  uint32_t key;
+  uint32_t originalIndex;
+};
+
+void testCustomSort()
+{
+  for (size_t n : sizes) {
+    std::vector<Item> items(n);
+    for (size_t i=0;i<n;i++) items[i] = { uint32_t(rng()), uint32_t(i) };
+    auto less = [](const Item &a, const Item &b){
+      return a.key < b.key || (a.key == b.key && a.originalIndex < b.originalIndex);
+    };
+    std::vector<Item> expected = items;
+    std::sort(expected.begin(),expected.end(),less);
+    parallel_sort(items.data(),n,less);
+    for (size_t i=0;i<n;i++)
+      CHECK(items[i].originalIndex == expected[i].originalIndex);
+  }
+}
+
+void testPartition()
+{
+  for (size_t n : sizes) {
+    std::vector<Item> items(n);
+    for (size_t i=0;i<n;i++) items[i] = { uint32_t(rng() % 100), uint32_t(i) };
+    auto pred = [](const Item &item){ return item.key < 30; };
+    std::vector<Item> expected = items;
+    const size_t expectedCount
+      = std::stable_partition(expected.begin(),expected.end(),pred)-expected.begin();
+    CHECK(parallel_partition(items.data(),n,pred) == expectedCount);
+    for (size_t i=0;i<n;i++)
+      CHECK(items[i].originalIndex == expected[i].originalIndex);
+  }
+}
+
+int main()
+{
+  for (int numThreads : { 4, 1 }) {
+    setNumThreads(numThreads);
+    testScan();
+    testSort<uint8_t>();
+    testSort<int32_t>();
+    testSort<uint32_t>();
+    testSort<int64_t>();
+    testSort<uint64_t>();
+    testSort<float>();
+    testSort<double>();
+    testSortByKey<uint32_t>();
+    testSortByKey<int64_t>();
+    testSortByKey<float>();
+    testFloatSpecials();
+    testCustomSort();
+    testPartition();
+  }
+
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t10): all parallel algorithm tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
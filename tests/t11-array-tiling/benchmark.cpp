@@ -0,0 +1,142 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Benchmark for the tiled iteration in owl/common/arrayND/array3D.h:
+// compares array3D::parallel_for and parallel_reduce against the
+// previous implementation (one parallel_for over the linearized
+// index, with divisions to recover the 3D index of every cell), for a
+// 7-point stencil and a sum. Usage: bench11-array-tiling [N...], where
+// each N is the edge length of a cubic grid (default: 128 256 512)
+
+#include "owl/common/arrayND/array3D.h"
+#include <iostream>
+#include <iomanip>
+
+using namespace owl::common;
+
+/*! what array3D::parallel_for used to do */
+template<typename Lambda>
+void linearized_parallel_for(const vec3i &dims, const Lambda &lambda)
+{
+  owl::common::parallel_for
+    (dims.x*(size_t)dims.y*dims.z,[&](size_t index){
+      lambda(vec3i(index%dims.x,
+                   (index/dims.x)%dims.y,
+                   index/((size_t)dims.x*dims.y)));
+    });
+}
+
+template<typename Lambda>
+double measure(const Lambda &lambda)
+{
+  // best of three, so the first run's page faults don't count
+  double best = 1e20;
+  for (int i=0;i<3;i++) {
+    const double t0 = getCurrentTime();
+    lambda();
+    best = std::min(best,getCurrentTime()-t0);
+  }
+  return best;
+}
+
+void report(const std::string &what, size_t N, double tOld, double tNew)
+{
+  std::cout << "  " << std::setw(24) << std::left << what
+            << " linearized " << prettyDouble(tOld) << "s ("
+            << prettyDouble(N/tOld) << "cells/s), tiled "
+            << prettyDouble(tNew) << "s ("
+            << prettyDouble(N/tNew) << "cells/s), speedup "
+            << std::fixed << std::setprecision(2) << (tOld/tNew)
+            << std::defaultfloat << std::endl;
+}
+
+void run(int n)
+{
+  const vec3i dims(n);
+  const size_t N = size_t(n)*n*n;
+  std::cout << "grid " << dims << " (" << prettyNumber(N) << " cells):" << std::endl;
+
+  std::vector<float> in(N), out(N);
+  array3D::parallel_for(dims,[&](const vec3i &idx){
+      in[array3D::linear(idx,dims)] = float((idx.x*7+idx.y*13+idx.z*29)%101);
+    });
+
+  auto stencil = [&](const vec3i &idx){
+    const int64_t i = array3D::linear(idx,dims);
+    float sum = 6.f*in[i];
+    if (idx.x > 0)        sum -= in[i-1];
+    if (idx.x < dims.x-1) sum -= in[i+1];
+    if (idx.y > 0)        sum -= in[i-dims.x];
+    if (idx.y < dims.y-1) sum -= in[i+dims.x];
+    if (idx.z > 0)        sum -= in[i-int64_t(dims.x)*dims.y];
+    if (idx.z < dims.z-1) sum -= in[i+int64_t(dims.x)*dims.y];
+    out[i] = sum;
+  };
+  report("stencil",N,
+         measure([&](){ linearized_parallel_for(dims,stencil); }),
+         measure([&](){ array3D::parallel_for(dims,stencil); }));
+  report("stencil (linear tiles)",N,
+         measure([&](){ linearized_parallel_for(dims,stencil); }),
+         measure([&](){
+             array3D::parallel_for(dims,array3D::defaultTileSize(),
+                                   stencil,TILE_ORDER_LINEAR);
+           }));
+
+  double sink = 0.;
+  report("sum",N,
+         measure([&](){
+             // the old way: a linear parallel_reduce, with divisions
+             // to get back to the cell index
+             sink += parallel_reduce
+               (size_t(0),N,size_t(1<<16),0.,
+                [&](size_t begin, size_t end){
+                  double sum = 0.;
+                  for (size_t i=begin;i<end;i++) {
+                    const vec3i idx(int(i%dims.x),
+                                    int((i/dims.x)%dims.y),
+                                    int(i/((size_t)dims.x*dims.y)));
+                    sum += in[array3D::linear(idx,dims)];
+                  }
+                  return sum;
+                },
+                [](double a, double b){ return a+b; });
+           }),
+         measure([&](){
+             sink += array3D::parallel_reduce
+               (dims,array3D::defaultTileSize(),0.,
+                [&](const vec3i &begin, const vec3i &end){
+                  double sum = 0.;
+                  array3D::for_each(begin,end,[&](const vec3i &idx){
+                      sum += in[array3D::linear(idx,dims)];
+                    });
+                  return sum;
+                },
+                [](double a, double b){ return a+b; });
+           }));
+  std::cout << "  (" << sink << ")" << std::endl;
+}
+
+int main(int ac, char **av)
+{
+  std::vector<int> sizes;
+  for (int i=1;i<ac;i++)
+    sizes.push_back(std::stoi(av[i]));
+  if (sizes.empty())
+    sizes = { 128, 256, 512 };
+  for (auto n : sizes)
+    run(n);
+  return 0;
+}
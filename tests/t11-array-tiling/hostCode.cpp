@@ -0,0 +1,179 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of owl/common/math/morton.h, owl/common/arrayND/tiling.h,
+// and the tiled iteration in array2D.h and array3D.h: checks that
+// Morton codes round-trip, that tilings cover every cell exactly once
+// (in either order, and for grids that are not multiples of the tile
+// size), and that parallel_reduce over 3D domains is correct and
+// deterministic. Does not need a GPU.
+
+#include "owl/common/arrayND/array2D.h"
+#include "owl/common/arrayND/array3D.h"
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+#define OWL_TEST_NAME "t11"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+void testMorton()
+{
+  for (uint32_t i=0;i<100000;i++) {
+    const vec3i v((i*7919u)&0x1fffff,(i*104729u)&0x1fffff,(i*1299709u)&0x1fffff);
+    CHECK(mortonDecode3(mortonEncode(v)) == v);
+    const vec2i w((i*7919u)&0x7fffffff,(i*104729u)&0x7fffffff);
+    CHECK(mortonDecode2(mortonEncode(w)) == w);
+  }
+  // spatial order: the 8 corners of the unit cube come first, x fastest
+  for (int i=0;i<8;i++)
+    CHECK(mortonDecode3(i) == vec3i(i&1,(i>>1)&1,(i>>2)&1));
+
+  // non-cubic orders are dense, and bijective over their domain
+  const vec3i dims(5,2,17);
+  const MortonOrder3 order(dims);
+  CHECK(order.numCodes() == 8*2*32);
+  std::vector<int> hits(order.numCodes(),0);
+  for (uint64_t code=0;code<order.numCodes();code++) {
+    const vec3i v = order.decode(code);
+    CHECK(v.x < 8 && v.y < 2 && v.z < 32);
+    CHECK(order.encode(v) == code);
+    hits[v.x+8*(v.y+2*v.z)]++;
+  }
+  for (auto h : hits) CHECK(h == 1);
+}
+
+void testTiling3D(const vec3i &dims, const vec3i &tileSize, TileOrder order)
+{
+  const size_t numCells = size_t(dims.x)*dims.y*dims.z;
+  std::vector<std::atomic<int>> visits(numCells);
+  for (auto &v : visits) v = 0;
+
+  array3D::parallel_for(dims,tileSize,[&](const vec3i &idx){
+      CHECK(array3D::validIndex(idx,dims));
+      visits[array3D::linear(idx,dims)]++;
+    },order);
+  for (auto &v : visits) CHECK(v == 1);
+
+  // tiles are what they claim to be, and all of them are visited
+  std::atomic<size_t> numTiles { 0 };
+  array3D::parallel_for_blocked(dims,tileSize,[&](const vec3i &begin,
+                                                  const vec3i &end){
+      CHECK(begin.x % tileSize.x == 0);
+      CHECK(begin.y % tileSize.y == 0);
+      CHECK(begin.z % tileSize.z == 0);
+      CHECK(end == min(begin+tileSize,dims));
+      numTiles++;
+    },order);
+  const vec3i expectedTiles = divRoundUp(dims,tileSize);
+  CHECK(numTiles == size_t(expectedTiles.x)*expectedTiles.y*expectedTiles.z);
+
+  // morton order enumerates neighboring tiles one after another
+  if (order == TILE_ORDER_MORTON && expectedTiles == vec3i(4)) {
+    std::vector<vec3i> tiles;
+    array3D::for_each_tile(dims,tileSize,[&](const vec3i &begin, const vec3i &){
+        tiles.push_back(begin/tileSize);
+      },order);
+    for (int i=0;i<8;i++)
+      CHECK(tiles[i] == vec3i(i&1,(i>>1)&1,(i>>2)&1));
+  }
+}
+
+void testTiling2D(const vec2i &dims, const vec2i &tileSize, TileOrder order)
+{
+  std::vector<std::atomic<int>> visits(size_t(dims.x)*dims.y);
+  for (auto &v : visits) v = 0;
+  array2D::parallel_for(dims,tileSize,[&](const vec2i &idx){
+      CHECK(idx.x >= 0 && idx.x < dims.x && idx.y >= 0 && idx.y < dims.y);
+      visits[array2D::linear(idx,dims)]++;
+    },order);
+  for (auto &v : visits) CHECK(v == 1);
+
+  size_t numPixels = 0;
+  array2D::for_each_tile(dims,tileSize,[&](const vec2i &begin, const vec2i &end){
+      numPixels += area(end-begin);
+    },order);
+  CHECK(numPixels == visits.size());
+}
+
+void testReduce()
+{
+  const vec3i dims(93,41,27);
+  std::vector<float> values(size_t(dims.x)*dims.y*dims.z);
+  for (size_t i=0;i<values.size();i++)
+    values[i] = float((i*2654435761u) % 10007)*1e-3f;
+
+  auto tileSum = [&](const vec3i &begin, const vec3i &end){
+    double sum = 0.;
+    array3D::for_each(begin,end,[&](const vec3i &idx){
+        sum += values[array3D::linear(idx,dims)];
+      });
+    return sum;
+  };
+  auto plus = [](double a, double b){ return a+b; };
+
+  double expected = 0.;
+  for (auto v : values) expected += v;
+  const double result
+    = array3D::parallel_reduce(dims,vec3i(16,8,4),0.,tileSum,plus);
+  CHECK(fabs(result-expected) <= 1e-9*expected);
+
+  // combining happens in a fixed order, so results are bit-identical
+  // from run to run
+  for (int i=0;i<10;i++)
+    CHECK(array3D::parallel_reduce(dims,vec3i(16,8,4),0.,tileSum,plus) == result);
+
+  // reduce a min/max, over a single tile, and over an empty domain
+  const vec2f range
+    = array3D::parallel_reduce
+    (dims,vec3i(7,5,3),vec2f(+INFINITY,-INFINITY),
+     [&](const vec3i &begin, const vec3i &end){
+      vec2f r(+INFINITY,-INFINITY);
+      array3D::for_each(begin,end,[&](const vec3i &idx){
+          const float v = values[array3D::linear(idx,dims)];
+          r = vec2f(min(r.x,v),max(r.y,v));
+        });
+      return r;
+    },
+     [](vec2f a, vec2f b){ return vec2f(min(a.x,b.x),max(a.y,b.y)); });
+  CHECK(range.x == *std::min_element(values.begin(),values.end()));
+  CHECK(range.y == *std::max_element(values.begin(),values.end()));
+  CHECK(array3D::parallel_reduce(dims,dims,0.,tileSum,plus) == expected);
+  CHECK(array3D::parallel_reduce(vec3i(0,4,4),vec3i(8),1.,tileSum,plus) == 1.);
+}
+
+int main()
+{
+  testMorton();
+  for (auto order : { TILE_ORDER_LINEAR, TILE_ORDER_MORTON }) {
+    testTiling3D(vec3i(1),vec3i(8),order);
+    testTiling3D(vec3i(64),vec3i(16),order);
+    testTiling3D(vec3i(37,5,91),vec3i(8,8,8),order);
+    testTiling3D(vec3i(100,3,2),vec3i(32,8,8),order);
+    testTiling3D(vec3i(33,17,9),vec3i(1,1,1),order);
+    testTiling3D(vec3i(0,10,10),vec3i(4),order);
+    testTiling2D(vec2i(1),vec2i(16),order);
+    testTiling2D(vec2i(1920,1080),vec2i(64,16),order);
+    testTiling2D(vec2i(123,457),vec2i(7,3),order);
+  }
+  testReduce();
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t11): all array tiling tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
@@ -0,0 +1,127 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Benchmark for owl/common/arrayND/Volume.h: measures converting a
+// linear volume into each layout, and then marching random rays
+// through it with trilinear sampling (the host-side equivalent of
+// volumeSample() in owl_device.h), which is where bricked and Morton
+// layouts are supposed to pay off. Usage: bench12-volume [N...],
+// where each N is the edge length of a cubic float volume (default:
+// 256 512)
+
+#include "owl/common/arrayND/Volume.h"
+#include "owl/common/math/random.h"
+#include <iostream>
+#include <iomanip>
+
+using namespace owl::common;
+
+float sample(const Volume<float> &volume, const vec3f &pos)
+{
+  const VolumeLayout &layout = volume.getLayout();
+  const vec3f p = pos - vec3f(.5f);
+  const vec3i c0(int(floorf(p.x)),int(floorf(p.y)),int(floorf(p.z)));
+  const vec3f f = p - vec3f(c0);
+  auto fetch = [&](int dx, int dy, int dz){
+    return volume.data()[layout.index(layout.clamp(c0+vec3i(dx,dy,dz)))];
+  };
+  const float v00 = fetch(0,0,0)*(1.f-f.x) + fetch(1,0,0)*f.x;
+  const float v01 = fetch(0,1,0)*(1.f-f.x) + fetch(1,1,0)*f.x;
+  const float v10 = fetch(0,0,1)*(1.f-f.x) + fetch(1,0,1)*f.x;
+  const float v11 = fetch(0,1,1)*(1.f-f.x) + fetch(1,1,1)*f.x;
+  return (v00*(1.f-f.y) + v01*f.y)*(1.f-f.z) + (v10*(1.f-f.y) + v11*f.y)*f.z;
+}
+
+/*! marches numRays rays with random origins and directions through
+    the volume, with half-cell steps, and returns the sum of all
+    samples */
+double marchRays(const Volume<float> &volume, int numRays)
+{
+  const vec3f dims = vec3f(volume.getDims());
+  const int numSteps = int(2*reduce_max(dims));
+  return parallel_reduce
+    (size_t(0),size_t(numRays),size_t(64),0.,
+     [&](size_t begin, size_t end){
+      LCG<8> rng; rng.init(unsigned(begin),0);
+      double sum = 0.;
+      for (size_t rayID=begin;rayID<end;rayID++) {
+        vec3f pos = dims*vec3f(rng(),rng(),rng());
+        const vec3f dir
+          = .5f*normalize(vec3f(rng(),rng(),rng())-vec3f(.5f));
+        for (int step=0;step<numSteps;step++) {
+          if (pos.x < 0.f || pos.y < 0.f || pos.z < 0.f ||
+              pos.x >= dims.x || pos.y >= dims.y || pos.z >= dims.z)
+            break;
+          sum += sample(volume,pos);
+          pos = pos + dir;
+        }
+      }
+      return sum;
+    },
+     [](double a, double b){ return a+b; });
+}
+
+const char *nameOf(VolumeLayoutType type)
+{
+  switch (type) {
+  case VOLUME_LAYOUT_BRICKED: return "bricked";
+  case VOLUME_LAYOUT_MORTON:  return "morton";
+  default:                    return "linear";
+  }
+}
+
+void run(int n)
+{
+  const vec3i dims(n);
+  Volume<float> linear(dims);
+  array3D::parallel_for(dims,[&](const vec3i &cell){
+      linear[cell] = sinf(.1f*cell.x)*cosf(.07f*cell.y)+.01f*cell.z;
+    });
+  const int numRays = 1<<16;
+  std::cout << "volume " << dims << " (" << prettyNumber(volume(dims))
+            << " cells), " << prettyNumber(numRays) << " rays:" << std::endl;
+
+  double tLinear = 0.;
+  for (auto type : { VOLUME_LAYOUT_LINEAR, VOLUME_LAYOUT_BRICKED, VOLUME_LAYOUT_MORTON }) {
+    double t0 = getCurrentTime();
+    const Volume<float> converted = linear.convertedTo(type);
+    const double tConvert = getCurrentTime()-t0;
+
+    t0 = getCurrentTime();
+    const double sum = marchRays(converted,numRays);
+    const double tMarch = getCurrentTime()-t0;
+    if (type == VOLUME_LAYOUT_LINEAR) tLinear = tMarch;
+
+    std::cout << "  " << std::setw(8) << std::left << nameOf(type)
+              << " convert " << prettyDouble(tConvert) << "s, storage "
+              << prettyNumber(converted.sizeInBytes()) << "B, march "
+              << prettyDouble(tMarch) << "s, speedup over linear "
+              << std::fixed << std::setprecision(2) << (tLinear/tMarch)
+              << std::defaultfloat << " (" << sum << ")" << std::endl;
+  }
+}
+
+int main(int ac, char **av)
+{
+  std::vector<int> sizes;
+  for (int i=1;i<ac;i++)
+    sizes.push_back(std::stoi(av[i]));
+  if (sizes.empty())
+    sizes = { 256, 512 };
+  for (auto n : sizes)
+    run(n);
+  return 0;
+}
@@ -0,0 +1,152 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of owl/common/arrayND/Volume.h and VolumeLayout.h:
+// checks that every layout maps the volume's cells to distinct
+// storage elements, that conversions between layouts preserve all
+// cells, and that brick iteration covers the volume. Does not need a
+// GPU.
+
+#include "owl/common/arrayND/Volume.h"
+#include <iostream>
+#include <atomic>
+
+#define OWL_TEST_NAME "t12"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+const VolumeLayoutType allTypes[]
+= { VOLUME_LAYOUT_LINEAR, VOLUME_LAYOUT_BRICKED, VOLUME_LAYOUT_MORTON };
+
+/*! the value we store in a given cell */
+uint32_t valueOf(const vec3i &cell)
+{ return uint32_t(cell.x) | (uint32_t(cell.y) << 10) | (uint32_t(cell.z) << 20); }
+
+void testLayout(const VolumeLayout &layout)
+{
+  const size_t numCells = size_t(layout.dims.x)*layout.dims.y*layout.dims.z;
+  const size_t numElements = layout.numStorageElements();
+  CHECK(numElements >= numCells);
+  if (layout.type == VOLUME_LAYOUT_LINEAR)
+    CHECK(numElements == numCells);
+  if (layout.type == VOLUME_LAYOUT_BRICKED)
+    CHECK(numElements % layout.cellsPerBrick() == 0);
+
+  std::vector<int> hits(numElements,0);
+  array3D::for_each(layout.dims,[&](const vec3i &cell){
+      const size_t idx = layout.index(cell);
+      CHECK(idx < numElements);
+      hits[idx]++;
+      if (layout.type == VOLUME_LAYOUT_LINEAR)
+        CHECK(idx == size_t(array3D::linear(cell,layout.dims)));
+    });
+  for (auto h : hits) CHECK(h <= 1);
+}
+
+void testVolume(const vec3i &dims)
+{
+  for (auto type : allTypes)
+    for (int logBrickSize : { 1, 3 })
+      testLayout(VolumeLayout(type,dims,logBrickSize));
+
+  Volume<uint32_t> linear(dims);
+  CHECK(linear.getDims() == dims);
+  array3D::parallel_for(dims,[&](const vec3i &cell){
+      linear[cell] = valueOf(cell);
+    });
+
+  // all conversions preserve all cells, both from linear and from
+  // the other layouts
+  for (auto type : allTypes) {
+    const Volume<uint32_t> converted = linear.convertedTo(type);
+    CHECK(converted.getLayout().type == type);
+    CHECK(converted.numStorageElements() == converted.getLayout().numStorageElements());
+    array3D::for_each(dims,[&](const vec3i &cell){
+        CHECK(converted[cell] == valueOf(cell));
+      });
+    for (auto other : allTypes) {
+      const Volume<uint32_t> back = converted.convertedTo(other,2);
+      array3D::for_each(dims,[&](const vec3i &cell){
+          CHECK(back[cell] == valueOf(cell));
+        });
+    }
+  }
+
+  // for bricked volumes, each brick is one contiguous range of storage
+  Volume<uint32_t> bricked = linear.convertedTo(VOLUME_LAYOUT_BRICKED);
+  size_t numBricks = 0, numCells = 0;
+  for (const VolumeBrick &brick : bricked.bricks()) {
+    CHECK(brick.brickID == numBricks);
+    const uint32_t *brickData = bricked.data() + brick.brickID*bricked.getLayout().cellsPerBrick();
+    array3D::for_each(brick.begin,brick.end,[&](const vec3i &cell){
+        const vec3i local = cell - brick.begin;
+        CHECK(brickData[local.x+8*(local.y+8*local.z)] == valueOf(cell));
+      });
+    numCells += volume(brick.end-brick.begin);
+    numBricks++;
+  }
+  CHECK(numCells == size_t(dims.x)*dims.y*dims.z);
+  CHECK(numBricks == bricked.bricks().size());
+
+  // parallel brick iteration, with a non-default brick size
+  std::vector<std::atomic<int>> visits(numCells);
+  for (auto &v : visits) v = 0;
+  linear.parallel_for_bricks([&](const VolumeBrick &brick){
+      CHECK(brick.end.x-brick.begin.x <= 4);
+      array3D::for_each(brick.begin,brick.end,[&](const vec3i &cell){
+          visits[array3D::linear(cell,dims)]++;
+        });
+    },2);
+  for (auto &v : visits) CHECK(v == 1);
+
+  // in-place conversion
+  Volume<uint32_t> morton = linear;
+  morton.convertTo(VOLUME_LAYOUT_MORTON);
+  CHECK(morton.getLayout().type == VOLUME_LAYOUT_MORTON);
+  CHECK(morton[dims-vec3i(1)] == valueOf(dims-vec3i(1)));
+}
+
+void testClamp()
+{
+  const VolumeLayout layout(VOLUME_LAYOUT_BRICKED,vec3i(10,20,30));
+  CHECK(layout.clamp(vec3i(-1,5,100)) == vec3i(0,5,29));
+  CHECK(layout.clamp(vec3i(9,19,29)) == vec3i(9,19,29));
+  CHECK(layout.clamp(vec3i(10,-100,0)) == vec3i(9,0,0));
+}
+
+int main()
+{
+  testVolume(vec3i(1));
+  testVolume(vec3i(8));
+  testVolume(vec3i(17,9,33));
+  testVolume(vec3i(64,3,40));
+  testVolume(vec3i(100,100,1));
+  testLayout(VolumeLayout(VOLUME_LAYOUT_MORTON,vec3i(0,10,10)));
+  CHECK(VolumeLayout(VOLUME_LAYOUT_BRICKED,vec3i(0,10,10)).numStorageElements() == 0);
+  testClamp();
+
+  bool threw = false;
+  try {
+    Volume<float>(vec3i(4)).convertedTo(VolumeLayout(VOLUME_LAYOUT_LINEAR,vec3i(5)));
+  } catch (const std::runtime_error &) { threw = true; }
+  CHECK(threw);
+
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t12): all volume tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
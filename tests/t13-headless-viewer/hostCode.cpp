@@ -0,0 +1,249 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Test of the samples viewer's headless mode: camera paths, frame
+// flipping, asynchronous writing of frames to files, and a full
+// headless OWLViewer run whose frames go to a custom FrameSink. Needs
+// a GPU (for the viewer's frame buffer), but no display.
+
+#include "owlViewer/OWLViewer.h"
+#define STB_IMAGE_IMPLEMENTATION 1
+#include "stb/stb_image.h"
+#include <iostream>
+#include <cstdio>
+
+#define OWL_TEST_NAME "t13"
+#include "../owlTestCheck.h"
+
+using namespace owl;
+using namespace owl::viewer;
+
+bool equal(const vec3f &a, const vec3f &b)
+{ return length(a-b) <= 1e-4f*(1.f+length(a)); }
+
+bool equal(const CameraKey &a, const CameraKey &b)
+{
+  return equal(a.from,b.from) && equal(a.at,b.at) && equal(a.up,b.up)
+    && fabsf(a.fovy-b.fovy) <= 1e-4f;
+}
+
+CameraKey makeKey(const vec3f &from, float fovy)
+{
+  CameraKey key;
+  key.from = from;
+  key.fovy = fovy;
+  return key;
+}
+
+void testCameraPath()
+{
+  CameraPath path;
+  path.keys = { makeKey(vec3f(0,0,-1),40.f),
+                makeKey(vec3f(2,0,-1),50.f),
+                makeKey(vec3f(2,4,-1),60.f) };
+  CHECK(equal(path.evaluate(0.f),path.keys[0]));
+  CHECK(equal(path.evaluate(.5f),path.keys[1]));
+  CHECK(equal(path.evaluate(1.f),path.keys[2]));
+  CHECK(equal(path.evaluate(2.f),path.keys[2]));
+  CHECK(equal(path.evaluate(.25f),makeKey(vec3f(1,0,-1),45.f)));
+  CHECK(equal(path.evaluateFrame(0,5),path.keys[0]));
+  CHECK(equal(path.evaluateFrame(4,5),path.keys[2]));
+  CHECK(equal(path.evaluateFrame(0,1),path.keys[0]));
+
+  // closed paths wrap around, and their frames never hit the end
+  path.closed = true;
+  CHECK(equal(path.evaluate(1.f),path.keys[0]));
+  CHECK(equal(path.evaluate(5.f/6.f),makeKey(vec3f(1,2,-1),50.f)));
+  CHECK(equal(path.evaluateFrame(2,6),path.keys[1]));
+
+  const std::string fileName = "t13-camera-path.txt";
+  path.save(fileName);
+  const CameraPath loaded = CameraPath::load(fileName);
+  CHECK(loaded.closed);
+  CHECK(loaded.keys.size() == path.keys.size());
+  for (size_t i=0;i<path.keys.size();i++)
+    CHECK(equal(loaded.keys[i],path.keys[i]));
+  std::remove(fileName.c_str());
+
+  bool threw = false;
+  try { CameraPath::load("t13-does-not-exist.txt"); }
+  catch (const std::runtime_error &) { threw = true; }
+  CHECK(threw);
+
+  CameraKey start = makeKey(vec3f(3,1,0),30.f);
+  start.at = vec3f(0,1,0);
+  const CameraPath orbit = CameraPath::orbit(start,8);
+  CHECK(orbit.closed && orbit.keys.size() == 8);
+  CHECK(equal(orbit.keys[0],start));
+  CHECK(equal(orbit.keys[2].from,vec3f(0,1,-3)) || equal(orbit.keys[2].from,vec3f(0,1,3)));
+  for (auto &key : orbit.keys) {
+    CHECK(fabsf(length(key.from-start.at)-3.f) < 1e-4f);
+    CHECK(key.from.y == 1.f || fabsf(key.from.y-1.f) < 1e-5f);
+  }
+}
+
+/*! the pixel we put at (x,y) of a bottom-row-first frame buffer */
+uint32_t pixelValue(int x, int y, int tag)
+{ return uint32_t(x) | (uint32_t(y) << 8) | (uint32_t(tag) << 16); }
+
+void testCopyFlipped()
+{
+  const vec2i size(7,5);
+  std::vector<uint32_t> fb(size.x*size.y);
+  for (int y=0;y<size.y;y++)
+    for (int x=0;x<size.x;x++)
+      fb[x+size.x*y] = pixelValue(x,y,3);
+  Frame frame;
+  copyFlipped(frame,fb.data(),size);
+  CHECK(frame.size == size);
+  for (int y=0;y<size.y;y++)
+    for (int x=0;x<size.x;x++)
+      CHECK(frame.pixels[x+size.x*y] == (pixelValue(x,size.y-1-y,3) | 0xff000000u));
+}
+
+void testImageFileSink()
+{
+  const vec2i size(32,16);
+  const int numFrames = 6;
+  {
+    ImageFileSink sink("t13-frame%03d.png",2);
+    CHECK(sink.getFileName(7) == "t13-frame007.png");
+    for (int frameID=0;frameID<numFrames;frameID++) {
+      std::shared_ptr<Frame> frame = std::make_shared<Frame>();
+      frame->frameID = frameID;
+      frame->size = size;
+      for (int y=0;y<size.y;y++)
+        for (int x=0;x<size.x;x++)
+          frame->pixels.push_back(pixelValue(x,y,frameID) | 0xff000000u);
+      sink.consume(frame);
+    }
+    sink.finish();
+  }
+  for (int frameID=0;frameID<numFrames;frameID++) {
+    char fileName[100];
+    sprintf(fileName,"t13-frame%03d.png",frameID);
+    vec2i readSize;
+    int numChannels;
+    uint32_t *pixels
+      = (uint32_t*)stbi_load(fileName,&readSize.x,&readSize.y,&numChannels,4);
+    CHECK(pixels != nullptr);
+    CHECK(readSize == size);
+    for (int y=0;y<size.y;y++)
+      for (int x=0;x<size.x;x++)
+        CHECK(pixels[x+size.x*y] == (pixelValue(x,y,frameID) | 0xff000000u));
+    stbi_image_free(pixels);
+    std::remove(fileName);
+  }
+
+  // errors during (asynchronous) writing show up in finish()
+  ImageFileSink broken("t13-no-such-dir/frame%03d.png");
+  std::shared_ptr<Frame> frame = std::make_shared<Frame>();
+  frame->size = size;
+  frame->pixels.resize(size.x*size.y);
+  broken.consume(frame);
+  bool threw = false;
+  try { broken.finish(); }
+  catch (const std::runtime_error &) { threw = true; }
+  CHECK(threw);
+}
+
+/*! keeps all frames it gets */
+struct CollectingSink : public FrameSink {
+  void consume(const std::shared_ptr<Frame> &frame) override
+  { frames.push_back(frame); }
+  void finish() override { finished = true; }
+
+  std::vector<std::shared_ptr<Frame>> frames;
+  bool finished { false };
+};
+
+/*! a 'renderer' that writes a known pattern, tagged with the number
+    of the frame, and records every camera it gets */
+struct TestViewer : public OWLViewer {
+  TestViewer() : OWLViewer("t13",vec2i(16,16)) {}
+
+  void render() override
+  {
+    for (int y=0;y<fbSize.y;y++)
+      for (int x=0;x<fbSize.x;x++)
+        fbPointer[x+fbSize.x*y] = pixelValue(x,y,numFramesRendered);
+    numFramesRendered++;
+  }
+  void cameraChanged() override
+  { cameraPositions.push_back(camera.position); }
+
+  int numFramesRendered { 0 };
+  std::vector<vec3f> cameraPositions;
+};
+
+void testHeadlessViewer()
+{
+  OWLViewer::HeadlessConfig &config = OWLViewer::defaultHeadlessConfig();
+  config.enabled   = true;
+  config.frameSize = vec2i(40,30);
+  config.numFrames = 5;
+  config.orbit     = true;
+
+  TestViewer viewer;
+  CHECK(viewer.isHeadless());
+  viewer.setCameraOrientation(vec3f(0,0,10),vec3f(0,0,0),vec3f(0,1,0),45.f);
+  std::shared_ptr<CollectingSink> sink = std::make_shared<CollectingSink>();
+  viewer.setFrameSink(sink);
+  viewer.showAndRun();
+
+  CHECK(viewer.numFramesRendered == 5);
+  CHECK(sink->finished);
+  CHECK(sink->frames.size() == 5);
+  for (int frameID=0;frameID<5;frameID++) {
+    const Frame &frame = *sink->frames[frameID];
+    CHECK(frame.frameID == frameID);
+    CHECK(frame.size == config.frameSize);
+    for (int y=0;y<frame.size.y;y++)
+      for (int x=0;x<frame.size.x;x++)
+        CHECK(frame.pixels[x+frame.size.x*y]
+              == (pixelValue(x,frame.size.y-1-y,frameID) | 0xff000000u));
+  }
+
+  // every frame moved the camera, along a circle around the poi
+  CHECK(viewer.cameraPositions.size() == 5);
+  for (size_t i=0;i<viewer.cameraPositions.size();i++) {
+    CHECK(fabsf(length(viewer.cameraPositions[i])-10.f) < 1e-3f);
+    if (i > 0) CHECK(!equal(viewer.cameraPositions[i],viewer.cameraPositions[i-1]));
+  }
+  CHECK(equal(viewer.cameraPositions[0],vec3f(0,0,10)));
+
+  // a run that stops early still finishes its sink
+  config.orbit = false;
+  TestViewer stopped;
+  std::shared_ptr<CollectingSink> stoppedSink = std::make_shared<CollectingSink>();
+  stopped.setFrameSink(stoppedSink);
+  int numCalls = 0;
+  stopped.showAndRun([&](){ return numCalls++ < 2; });
+  CHECK(stoppedSink->frames.size() == 2);
+  CHECK(stoppedSink->finished);
+}
+
+int main()
+{
+  testCameraPath();
+  testCopyFlipped();
+  testImageFileSink();
+  testHeadlessViewer();
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t13): all headless viewer tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
@@ -0,0 +1,134 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Benchmark for owl/common/image/ImageWriter.h: how many 4K frames
+// per second get written synchronously (with plain stbi_write_png,
+// the way the samples used to, and with writeImage()), and through
+// ImageWriter with different numbers of threads - per file format,
+// and for both pixel formats. Usage: bench14-image-writer [numFrames
+// [width height]] (default: 16 frames of 3840x2160)
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION 1
+#include "owl/common/image/ImageWriter.h"
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+
+using namespace owl::common;
+
+int numFrames = 16;
+vec2i size(3840,2160);
+
+void report(const std::string &what, double seconds)
+{
+  std::cout << "  " << std::setw(44) << std::left << what
+            << std::fixed << std::setprecision(2) << std::right
+            << std::setw(8) << (numFrames/seconds) << " frames/s"
+            << std::defaultfloat << std::endl;
+}
+
+std::string fileNameOf(int frameID, const char *ext)
+{
+  return "bench14-frame"+std::to_string(frameID)+"."+ext;
+}
+
+template<typename Lambda>
+double measure(const Lambda &lambda)
+{
+  const double t0 = getCurrentTime();
+  lambda();
+  return getCurrentTime()-t0;
+}
+
+void cleanUp()
+{
+  for (auto ext : { "png", "ppm", "pfm" })
+    for (int i=0;i<numFrames;i++)
+      remove(fileNameOf(i,ext).c_str());
+}
+
+int main(int ac, char **av)
+{
+  if (ac > 1) numFrames = std::stoi(av[1]);
+  if (ac > 3) size = vec2i(std::stoi(av[2]),std::stoi(av[3]));
+  const size_t numPixels = size_t(size.x)*size.y;
+
+  // something with enough structure for the PNG compressor to not
+  // be entirely unrealistic
+  std::vector<vec4f>    floats(numPixels);
+  std::vector<uint32_t> rgba8(numPixels);
+  for (int y=0;y<size.y;y++)
+    for (int x=0;x<size.x;x++) {
+      const float r = x/float(size.x), g = y/float(size.y);
+      floats[y*size.x+x] = vec4f(r,g,.5f+.5f*sinf(.01f*(x+y)),1.f);
+    }
+  convertFloatToRGBA8(floats.data(),rgba8.data(),numPixels);
+
+  std::cout << "#owl.bench(14): " << numFrames << " frames of "
+            << size.x << "x" << size.y << std::endl;
+
+  report("float->rgba8 conversion",
+         measure([&](){
+             for (int i=0;i<numFrames;i++)
+               convertFloatToRGBA8(floats.data(),rgba8.data(),numPixels);
+           }));
+  report("float->rgba8 conversion (scalar)",
+         measure([&](){
+             for (int i=0;i<numFrames;i++)
+               owl::common::detail::convertFloatToRGBA8_scalar(floats.data(),rgba8.data(),numPixels);
+           }));
+
+  report("stbi_write_png, bottom row first",
+         measure([&](){
+             // what the samples used to do: flip through a negative
+             // stride, synchronously
+             for (int i=0;i<numFrames;i++)
+               stbi_write_png(fileNameOf(i,"png").c_str(),size.x,size.y,4,
+                              rgba8.data()+(size.y-1)*size_t(size.x),
+                              -size.x*int(sizeof(uint32_t)));
+           }));
+
+  for (auto ext : { "png", "ppm", "pfm" })
+    for (auto format : { IMAGE_RGBA8, IMAGE_RGBA32F }) {
+      const ImageView image = format == IMAGE_RGBA8
+        ? ImageView::rgba8(rgba8.data(),size,true)
+        : ImageView::rgba32f(floats.data(),size,true);
+      const std::string what
+        = std::string(ext)+(format == IMAGE_RGBA8 ? " from rgba8" : " from float");
+      report(what+", writeImage",
+             measure([&](){
+                 for (int i=0;i<numFrames;i++)
+                   writeImage(fileNameOf(i,ext),image);
+               }));
+      for (int numThreads : { 1, 2, 4, 8 }) {
+        // 'submit' is what the renderer sees, as long as the queue
+        // doesn't fill up
+        ImageWriter writer(numThreads);
+        double submitted = 0.;
+        const double total = measure([&](){
+            const double t0 = getCurrentTime();
+            for (int i=0;i<numFrames;i++)
+              writer.write(fileNameOf(i,ext),image);
+            submitted = getCurrentTime()-t0;
+            writer.flush();
+          });
+        report(what+", ImageWriter("+std::to_string(numThreads)+")",total);
+        report(what+", ImageWriter("+std::to_string(numThreads)+") submit",submitted);
+      }
+    }
+  cleanUp();
+  return 0;
+}
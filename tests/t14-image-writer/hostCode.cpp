@@ -0,0 +1,285 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of owl/common/image/ImageWriter.h: checks the SIMD
+// RGBA8<->float conversions against their scalar versions, writes
+// images of both pixel formats and orientations to every file format
+// and reads them back, and checks ImageWriter's copying, queue
+// bound, and error reporting. Does not need a GPU.
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION 1
+#include "owl/common/image/ImageWriter.h"
+#define STB_IMAGE_IMPLEMENTATION 1
+#include "stb/stb_image.h"
+#include <iostream>
+#include <cstdio>
+#include <random>
+
+#define OWL_TEST_NAME "t14"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+const vec2i testSize(37,23);
+
+/*! pixel (x,y) - counting from the top - of our RGBA8 test image */
+uint32_t testPixel(int x, int y)
+{
+  return uint32_t(x*7) | (uint32_t(y*11) << 8) | (uint32_t((x^y)*3&0xff) << 16) | 0xff000000u;
+}
+
+vec4f testPixelF(int x, int y)
+{
+  return vec4f(x/float(testSize.x-1),1.f-y/float(testSize.y-1),(x+y)/60.f-.25f,1.f);
+}
+
+void testConversions()
+{
+  // every 8-bit value in every channel, in every position within a
+  // group of four pixels
+  std::vector<uint32_t> bytes(1024+3);
+  for (size_t i=0;i<bytes.size();i++) {
+    const uint32_t v = uint32_t(i & 0xff);
+    bytes[i] = v | ((255-v) << 8) | ((v^0x5a) << 16) | (((v*7)&0xff) << 24);
+  }
+  for (size_t count : { size_t(0), size_t(1), size_t(3), size_t(4), size_t(5), bytes.size() }) {
+    std::vector<vec4f> simd(count), scalar(count);
+    convertRGBA8ToFloat(bytes.data(),simd.data(),count);
+    owl::common::detail::convertRGBA8ToFloat_scalar(bytes.data(),scalar.data(),count);
+    // empty vectors may hand out null pointers, which memcmp must not get
+    CHECK(count == 0 || memcmp(simd.data(),scalar.data(),count*sizeof(vec4f)) == 0);
+  }
+  vec4f f;
+  convertRGBA8ToFloat(bytes.data(),&f,1);
+  CHECK(f.x == 0.f && f.y == 1.f);
+
+  std::vector<float> special
+    = { 0.f, -0.f, 1.f, -1.f, .5f, 255.f/256.f, 254.999f/256.f, 1.f/256.f,
+        .99999f, 1e-30f, 1e30f, -1e30f,
+        std::numeric_limits<float>::infinity(),
+        -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::quiet_NaN() };
+  std::mt19937 rng(14);
+  std::uniform_real_distribution<float> dist(-.5f,1.5f);
+  while (special.size() < 4*4099) special.push_back(dist(rng));
+  const size_t numPixels = special.size()/4;
+  for (size_t count : { size_t(0), size_t(1), size_t(3), size_t(4), size_t(7), numPixels }) {
+    std::vector<uint32_t> simd(count), scalar(count);
+    convertFloatToRGBA8((const vec4f *)special.data(),simd.data(),count);
+    owl::common::detail::convertFloatToRGBA8_scalar((const vec4f *)special.data(),scalar.data(),count);
+    CHECK(simd == scalar);
+  }
+  CHECK(owl::common::detail::floatTo8bit(1.f) == 255);
+  CHECK(owl::common::detail::floatTo8bit(.5f) == 128);
+  CHECK(owl::common::detail::floatTo8bit(-1.f) == 0);
+  CHECK(owl::common::detail::floatTo8bit(std::numeric_limits<float>::quiet_NaN()) == 0);
+
+  // going through float and back is lossless
+  std::vector<vec4f>    asFloat(bytes.size());
+  std::vector<uint32_t> back(bytes.size());
+  convertRGBA8ToFloat(bytes.data(),asFloat.data(),bytes.size());
+  convertFloatToRGBA8(asFloat.data(),back.data(),bytes.size());
+  CHECK(back == bytes);
+}
+
+/*! reads a PFM as written by writeImage(), top row first */
+std::vector<vec3f> readPFM(const std::string &fileName, vec2i &size)
+{
+  FILE *file = fopen(fileName.c_str(),"rb");
+  CHECK(file != nullptr);
+  float scale = 0.f;
+  CHECK(fscanf(file,"PF\n%d %d\n%f",&size.x,&size.y,&scale) == 3);
+  CHECK(scale == -1.f);
+  CHECK(fgetc(file) == '\n');
+  std::vector<vec3f> pixels(size_t(size.x)*size.y);
+  for (int y=size.y-1;y>=0;--y)
+    CHECK(fread(pixels.data()+size_t(y)*size.x,sizeof(vec3f),size.x,file) == size_t(size.x));
+  fclose(file);
+  return pixels;
+}
+
+/*! the test image in the given format and orientation; 'storage'
+    holds the pixels the returned view points to */
+ImageView makeTestImage(ImagePixelFormat format, bool bottomRowFirst,
+                        std::vector<uint8_t> &storage)
+{
+  const size_t numPixels = size_t(testSize.x)*testSize.y;
+  if (format == IMAGE_RGBA8) {
+    storage.resize(numPixels*sizeof(uint32_t));
+    uint32_t *pixels = (uint32_t *)storage.data();
+    for (int y=0;y<testSize.y;y++)
+      for (int x=0;x<testSize.x;x++)
+        pixels[(bottomRowFirst ? testSize.y-1-y : y)*testSize.x+x] = testPixel(x,y);
+    return ImageView::rgba8(pixels,testSize,bottomRowFirst);
+  } else {
+    storage.resize(numPixels*sizeof(vec4f));
+    vec4f *pixels = (vec4f *)storage.data();
+    for (int y=0;y<testSize.y;y++)
+      for (int x=0;x<testSize.x;x++)
+        pixels[(bottomRowFirst ? testSize.y-1-y : y)*testSize.x+x] = testPixelF(x,y);
+    return ImageView::rgba32f(pixels,testSize,bottomRowFirst);
+  }
+}
+
+/*! checks that 'fileName' holds the test image of the given pixel
+    format, as it should have been written in the given file format */
+void checkFile(const std::string &fileName,
+               ImageFileFormat fileFormat,
+               ImagePixelFormat format)
+{
+  vec2i size;
+  if (fileFormat == IMAGE_FILE_FORMAT_PFM) {
+    std::vector<vec3f> pixels = readPFM(fileName,size);
+    CHECK(size == testSize);
+    for (int y=0;y<size.y;y++)
+      for (int x=0;x<size.x;x++) {
+        vec4f expected = testPixelF(x,y);
+        if (format == IMAGE_RGBA8) {
+          uint32_t rgba8 = testPixel(x,y);
+          convertRGBA8ToFloat(&rgba8,&expected,1);
+        }
+        CHECK(pixels[y*size.x+x] == vec3f(expected.x,expected.y,expected.z));
+      }
+    return;
+  }
+
+  int comp = 0;
+  const int numChannels = fileFormat == IMAGE_FILE_FORMAT_PNG ? 4 : 3;
+  uint8_t *pixels = stbi_load(fileName.c_str(),&size.x,&size.y,&comp,numChannels);
+  CHECK(pixels != nullptr);
+  CHECK(size == testSize);
+  CHECK(comp == numChannels);
+  for (int y=0;y<size.y;y++)
+    for (int x=0;x<size.x;x++) {
+      uint32_t expected = testPixel(x,y);
+      if (format == IMAGE_RGBA32F) {
+        const vec4f f = testPixelF(x,y);
+        convertFloatToRGBA8(&f,&expected,1);
+      }
+      const uint8_t *p = pixels+numChannels*(y*size.x+x);
+      for (int c=0;c<numChannels;c++)
+        CHECK(p[c] == uint8_t(expected >> (8*c)));
+    }
+  stbi_image_free(pixels);
+}
+
+const ImageFileFormat allFileFormats[]
+= { IMAGE_FILE_FORMAT_PNG, IMAGE_FILE_FORMAT_PPM, IMAGE_FILE_FORMAT_PFM };
+const char *extensionOf[] = { "", "png", "ppm", "pfm" };
+
+void testWriteImage()
+{
+  for (auto format : { IMAGE_RGBA8, IMAGE_RGBA32F })
+    for (bool bottomRowFirst : { false, true })
+      for (auto fileFormat : allFileFormats) {
+        std::vector<uint8_t> storage;
+        const ImageView image = makeTestImage(format,bottomRowFirst,storage);
+        const std::string fileName
+          = std::string("t14-test.")+extensionOf[fileFormat];
+        writeImage(fileName,image);
+        checkFile(fileName,fileFormat,format);
+
+        // a copy (converting or not) is always top row first
+        const ImageView copy = image.copy(nativePixelFormatOf(fileFormat));
+        CHECK(copy.stride > 0 && copy.owner);
+        storage.clear();
+        writeImage(fileName,copy,fileFormat);
+        checkFile(fileName,fileFormat,format);
+        remove(fileName.c_str());
+      }
+
+  CHECK(imageFileFormatFor("a/b.c/FRAME.PNG") == IMAGE_FILE_FORMAT_PNG);
+  bool threw = false;
+  try { imageFileFormatFor("frame.exr"); } catch (const std::runtime_error &) { threw = true; }
+  CHECK(threw);
+  threw = false;
+  try { imageFileFormatFor("frame"); } catch (const std::runtime_error &) { threw = true; }
+  CHECK(threw);
+}
+
+void testImageWriter()
+{
+  const int numThreads = 2, maxQueuedJobs = 3;
+  ImageWriter writer(numThreads,maxQueuedJobs);
+
+  // views without an owner get copied, so the caller may reuse its
+  // buffer as soon as write() returns
+  for (auto format : { IMAGE_RGBA8, IMAGE_RGBA32F }) {
+    for (auto fileFormat : allFileFormats) {
+      std::vector<uint8_t> storage;
+      const ImageView image = makeTestImage(format,true,storage);
+      for (int i=0;i<8;i++) {
+        const std::string fileName
+          = "t14-writer-"+std::to_string(i)+"."+extensionOf[fileFormat];
+        writer.write(fileName,image);
+        CHECK(writer.getNumPending() <= size_t(numThreads+maxQueuedJobs));
+      }
+      std::fill(storage.begin(),storage.end(),0);
+      writer.flush();
+      CHECK(writer.getNumPending() == 0);
+      for (int i=0;i<8;i++) {
+        const std::string fileName
+          = "t14-writer-"+std::to_string(i)+"."+extensionOf[fileFormat];
+        checkFile(fileName,fileFormat,format);
+        remove(fileName.c_str());
+      }
+    }
+  }
+
+  // views with an owner don't, and get released once written
+  std::shared_ptr<std::vector<uint32_t>> pixels
+    = std::make_shared<std::vector<uint32_t>>(size_t(testSize.x)*testSize.y);
+  for (int y=0;y<testSize.y;y++)
+    for (int x=0;x<testSize.x;x++)
+      (*pixels)[y*testSize.x+x] = testPixel(x,y);
+  ImageView owned = ImageView::rgba8(pixels->data(),testSize);
+  owned.owner = pixels;
+  std::weak_ptr<std::vector<uint32_t>> watch = pixels;
+  pixels.reset();
+  writer.write("t14-owned.png",owned);
+  owned = ImageView();
+  writer.flush();
+  CHECK(watch.expired());
+  checkFile("t14-owned.png",IMAGE_FILE_FORMAT_PNG,IMAGE_RGBA8);
+  remove("t14-owned.png");
+
+  // errors: unknown formats throw right away, failed writes on the
+  // next flush() (and only that one)
+  std::vector<uint8_t> storage;
+  const ImageView image = makeTestImage(IMAGE_RGBA8,false,storage);
+  bool threw = false;
+  try { writer.write("t14.tiff",image); } catch (const std::runtime_error &) { threw = true; }
+  CHECK(threw);
+  for (auto fileFormat : allFileFormats) {
+    writer.write(std::string("t14-no-such-dir/frame.")+extensionOf[fileFormat],image);
+    threw = false;
+    try { writer.flush(); } catch (const std::runtime_error &) { threw = true; }
+    CHECK(threw);
+    writer.flush();
+  }
+}
+
+int main()
+{
+  testConversions();
+  testWriteImage();
+  testImageWriter();
+
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t14): all image writer tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
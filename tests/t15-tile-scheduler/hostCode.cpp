@@ -0,0 +1,259 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of the samples viewer's TileScheduler (the logic
+// behind ProgressiveRenderer): tiling, pass budgets, priority orders,
+// adaptive sample counts against a simulated noise model, incremental
+// invalidation, and determinism. Does not need a GPU.
+
+#include "owlViewer/TileScheduler.h"
+#include "owlViewer/ProgressiveFrame.h"
+#include <iostream>
+#include <cmath>
+#include <set>
+
+#define OWL_TEST_NAME "t15"
+#include "../owlTestCheck.h"
+
+using namespace owl;
+using namespace owl::viewer;
+
+/*! what our simulated renderer's error estimate of a tile would be:
+    each tile has its own noise level, and the error goes down with
+    the square root of the number of samples */
+float noiseOf(const TileScheduler &scheduler, int tileID)
+{ return tileID % 3 == 0 ? .2f : .02f; }
+
+void reportErrors(TileScheduler &scheduler, const std::vector<TileScheduler::Job> &jobs)
+{
+  for (auto &job : jobs) {
+    const int numSamples = job.firstSample+job.numSamples;
+    scheduler.reportError(job.tileID,noiseOf(scheduler,job.tileID)/sqrtf(float(numSamples)));
+  }
+}
+
+int64_t distanceToCenter(const TileScheduler &scheduler, const TileScheduler::Job &job)
+{
+  const vec2i d = job.begin+job.end-scheduler.getFrameSize();
+  return int64_t(d.x)*d.x+int64_t(d.y)*d.y;
+}
+
+void testTiling()
+{
+  TileScheduler scheduler;
+  scheduler.resize(vec2i(100,70));
+  CHECK(scheduler.getNumTiles() == 4*3);
+  size_t numPixels = 0;
+  for (int i=0;i<scheduler.getNumTiles();i++) {
+    const TileScheduler::Tile &tile = scheduler.getTile(i);
+    CHECK(tile.stale);
+    CHECK(tile.end.x <= 100 && tile.end.y <= 70);
+    numPixels += area(tile.end-tile.begin);
+  }
+  CHECK(numPixels == 100*70);
+  CHECK(scheduler.getTile(11).begin == vec2i(96,64));
+  CHECK(scheduler.getTile(11).end   == vec2i(100,70));
+
+  // the first pass refreshes the whole frame (with the default budget
+  // of one sample per pixel), center first
+  std::vector<TileScheduler::Job> jobs = scheduler.nextPass();
+  CHECK(jobs.size() == 12);
+  std::set<int> seen;
+  for (size_t i=0;i<jobs.size();i++) {
+    CHECK(jobs[i].firstSample == 0 && jobs[i].numSamples == 1);
+    seen.insert(jobs[i].tileID);
+    if (i > 0)
+      CHECK(distanceToCenter(scheduler,jobs[i-1]) <= distanceToCenter(scheduler,jobs[i]));
+  }
+  CHECK(seen.size() == 12);
+
+  TileScheduler empty;
+  empty.resize(vec2i(0,0));
+  CHECK(empty.nextPass().empty());
+  CHECK(empty.isConverged());
+}
+
+void testBudget()
+{
+  TileScheduler::Config config;
+  config.samplesPerPass = 2*32*32;
+  TileScheduler scheduler(config);
+  scheduler.resize(vec2i(256,128));
+
+  // not enough budget for everything: the stale tiles get refreshed
+  // over several passes, two at a time, center first...
+  std::set<int> refreshed;
+  for (int pass=0;pass<16;pass++) {
+    std::vector<TileScheduler::Job> jobs = scheduler.nextPass();
+    CHECK(jobs.size() == 2);
+    for (auto &job : jobs) {
+      CHECK(job.firstSample == 0);
+      CHECK(refreshed.insert(job.tileID).second);
+    }
+    if (pass == 0)
+      for (auto &job : jobs)
+        CHECK(job.begin.x == 96 || job.begin.x == 128);
+  }
+  // ... and then the ones that have samples already continue
+  std::vector<TileScheduler::Job> jobs = scheduler.nextPass();
+  CHECK(!jobs.empty());
+  for (auto &job : jobs)
+    CHECK(job.firstSample == 1);
+}
+
+void testConvergence(TileScheduler::Priority priority)
+{
+  TileScheduler::Config config;
+  config.priority = priority;
+  TileScheduler scheduler(config);
+  scheduler.resize(vec2i(200,150));
+
+  for (int pass=0;pass<10000 && !scheduler.isConverged();pass++) {
+    std::vector<TileScheduler::Job> jobs = scheduler.nextPass();
+    CHECK(!jobs.empty());
+    size_t cost = 0;
+    for (size_t i=0;i<jobs.size();i++) {
+      CHECK(jobs[i].numSamples >= 1 && jobs[i].numSamples <= config.maxSamplesPerPass);
+      cost += jobs[i].numSamples*area(jobs[i].end-jobs[i].begin);
+      if (priority == TileScheduler::PRIORITY_BY_ERROR && i > 0) {
+        const TileScheduler::Tile &prev = scheduler.getTile(jobs[i-1].tileID);
+        const TileScheduler::Tile &tile = scheduler.getTile(jobs[i].tileID);
+        // (tiles that didn't have an estimate yet come first)
+        if (jobs[i-1].firstSample >= config.minSamplesPerPixel &&
+            jobs[i].firstSample >= config.minSamplesPerPixel)
+          CHECK(prev.error >= tile.error);
+        (void)tile;
+      }
+    }
+    CHECK(cost <= 200*150 || jobs.size() == 1);
+    reportErrors(scheduler,jobs);
+  }
+  CHECK(scheduler.isConverged());
+  CHECK(scheduler.nextPass().empty());
+
+  // noisy tiles needed (many) more samples than quiet ones
+  for (int i=0;i<scheduler.getNumTiles();i++) {
+    const TileScheduler::Tile &tile = scheduler.getTile(i);
+    CHECK(tile.error <= config.targetError);
+    if (noiseOf(scheduler,i) > .1f) {
+      CHECK(tile.numSamples >= 100);
+    } else {
+      CHECK(tile.numSamples <= 2*config.minSamplesPerPixel);
+    }
+  }
+}
+
+void testAdaptiveCount()
+{
+  TileScheduler::Config config;
+  config.maxSamplesPerPass = 64;
+  TileScheduler scheduler(config);
+  scheduler.resize(config.tileSize);
+  CHECK(scheduler.nextPass()[0].numSamples == 1);
+  // before there's an estimate, the tile first gets filled up to
+  // the minimum
+  std::vector<TileScheduler::Job> jobs = scheduler.nextPass();
+  CHECK(jobs[0].firstSample == 1 && jobs[0].numSamples == config.minSamplesPerPixel-1);
+  // twice the target error at n samples means 4n in total
+  scheduler.reportError(0,2.f*config.targetError);
+  jobs = scheduler.nextPass();
+  CHECK(jobs[0].firstSample == 4 && jobs[0].numSamples == 12);
+  scheduler.reportError(0,config.targetError);
+  CHECK(scheduler.isConverged());
+}
+
+void testInvalidation()
+{
+  TileScheduler scheduler;
+  scheduler.resize(vec2i(128,128));
+  for (int pass=0;pass<4;pass++)
+    reportErrors(scheduler,scheduler.nextPass());
+
+  // only the tiles overlapping the region start over ...
+  scheduler.invalidate(box2i(vec2i(40,40),vec2i(100,50)));
+  int numStale = 0;
+  for (int i=0;i<scheduler.getNumTiles();i++)
+    numStale += scheduler.getTile(i).stale;
+  CHECK(numStale == 3);
+  std::vector<TileScheduler::Job> jobs = scheduler.nextPass();
+  for (size_t i=0;i<jobs.size();i++)
+    // ... and do so first
+    CHECK((jobs[i].firstSample == 0) == (i < 3));
+
+  // reports from before an invalidation get ignored
+  scheduler.invalidate();
+  reportErrors(scheduler,jobs);
+  for (int i=0;i<scheduler.getNumTiles();i++)
+    CHECK(scheduler.getTile(i).error < 0.f);
+}
+
+void testDeterminism()
+{
+  TileScheduler::Config config;
+  config.priority = TileScheduler::PRIORITY_BY_ERROR;
+  config.samplesPerPass = 5000;
+  TileScheduler a(config), b(config);
+  a.resize(vec2i(300,200));
+  b.resize(vec2i(300,200));
+  for (int pass=0;pass<50;pass++) {
+    if (pass == 20) {
+      a.invalidate(box2i(vec2i(10),vec2i(100)));
+      b.invalidate(box2i(vec2i(10),vec2i(100)));
+    }
+    std::vector<TileScheduler::Job> ja = a.nextPass(), jb = b.nextPass();
+    CHECK(ja.size() == jb.size());
+    for (size_t i=0;i<ja.size();i++)
+      CHECK(ja[i].tileID == jb[i].tileID &&
+            ja[i].firstSample == jb[i].firstSample &&
+            ja[i].numSamples == jb[i].numSamples);
+    reportErrors(a,ja);
+    reportErrors(b,jb);
+  }
+}
+
+void testRelativeError()
+{
+  // identical samples: no error
+  ProgressiveSum sum;
+  for (int i=0;i<8;i++) sum.add(vec3f(.5f));
+  const vec4f accum(sum.sum.x,sum.sum.y,sum.sum.z,sum.sum2);
+  CHECK(progressiveRelativeError(accum,8) < 1e-3f);
+
+  // half black, half white: luminance 0 or 1, so mean .5, and
+  // variance .25
+  ProgressiveSum noisy;
+  for (int i=0;i<16;i++) noisy.add(vec3f(float(i&1)));
+  const vec4f accumNoisy(noisy.sum.x,noisy.sum.y,noisy.sum.z,noisy.sum2);
+  const float expected = sqrtf(.25f/16.f)/(.5f+1e-2f);
+  CHECK(fabsf(progressiveRelativeError(accumNoisy,16)-expected) < 1e-4f);
+}
+
+int main()
+{
+  testTiling();
+  testBudget();
+  testConvergence(TileScheduler::PRIORITY_CENTER_FIRST);
+  testConvergence(TileScheduler::PRIORITY_BY_ERROR);
+  testAdaptiveCount();
+  testInvalidation();
+  testDeterminism();
+  testRelativeError();
+
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t15): all tile scheduler tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
@@ -0,0 +1,67 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Benchmark for the optix7course sample's OBJ importer: load times of
+// osc::loadOBJ and of the serial std::map based loader it replaced,
+// on a random model. Usage: bench16-obj-import [numShapes
+// [numMaterials [facesPerGroup]]] (default: 16 shapes, 32 materials,
+// 20K faces per group - about 10M triangles)
+
+#include "MeshImport.h"
+#include "referenceLoader.h"
+#include "randomOBJ.h"
+#include "owl/common/parallel/parallel_for.h"
+#include <iostream>
+#include <iomanip>
+#include <memory>
+
+using namespace owl::common;
+
+template<typename Lambda>
+double measure(const Lambda &lambda)
+{
+  const double t0 = getCurrentTime();
+  lambda();
+  return getCurrentTime()-t0;
+}
+
+int main(int ac, char **av)
+{
+  const int numShapes     = ac > 1 ? std::stoi(av[1]) : 16;
+  const int numMaterials  = ac > 2 ? std::stoi(av[2]) : 32;
+  const int facesPerGroup = ac > 3 ? std::stoi(av[3]) : 20000;
+
+  const std::string fileName = "./bench16-random.obj";
+  const size_t numFaces
+    = writeRandomOBJ(fileName,numShapes,numMaterials,facesPerGroup,{},16);
+  std::cout << "#owl.bench(16): " << prettyNumber(numFaces) << " triangles, "
+            << getNumThreads() << " threads" << std::endl;
+
+  // both include tinyobj's parsing, which is the same for both
+  const double tReference = measure([&](){
+      std::unique_ptr<osc::Model> model(reference::loadOBJ(fileName));
+    });
+  const double tNew = measure([&](){
+      std::unique_ptr<osc::Model> model(osc::loadOBJ(fileName));
+    });
+  std::cout << "  std::map loader " << prettyDouble(tReference) << "s ("
+            << prettyDouble(numFaces/tReference) << " tris/s), MeshImport "
+            << prettyDouble(tNew) << "s ("
+            << prettyDouble(numFaces/tNew) << " tris/s), speedup "
+            << std::fixed << std::setprecision(2) << (tReference/tNew)
+            << std::defaultfloat << std::endl;
+  return 0;
+}
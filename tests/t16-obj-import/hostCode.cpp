@@ -0,0 +1,169 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Tests the optix7course sample's OBJ importer (MeshImport): the
+// vertex hash table against std::map, and osc::loadOBJ against the
+// serial std::map based loader it replaced - which it has to match
+// bit for bit - on random models with several shapes, materials and
+// textures. Does not need a GPU.
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION 1
+#include "stb/stb_image_write.h"
+#include "MeshImport.h"
+#include "owl/common/parallel/parallel_for.h"
+#include "referenceLoader.h"
+#include "randomOBJ.h"
+#include <cstring>
+#include <memory>
+#include <iostream>
+
+#define OWL_TEST_NAME "t16"
+#include "../owlTestCheck.h"
+
+using namespace osc;
+
+template<typename T>
+bool sameBits(const Array<T> &a, const Array<T> &b)
+{
+  return a.size() == b.size()
+    && (a.empty() || memcmp(a.data(),b.data(),a.size()*sizeof(T)) == 0);
+}
+
+void checkSameModel(const Model *model, const Model *expected)
+{
+  CHECK(model->meshes.size() == expected->meshes.size());
+  for (size_t i=0;i<model->meshes.size();i++) {
+    const TriangleMesh *mesh = model->meshes[i];
+    const TriangleMesh *ref  = expected->meshes[i];
+    CHECK(sameBits(mesh->vertex,ref->vertex));
+    CHECK(sameBits(mesh->normal,ref->normal));
+    CHECK(sameBits(mesh->texcoord,ref->texcoord));
+    CHECK(sameBits(mesh->index,ref->index));
+    CHECK(memcmp(&mesh->diffuse,&ref->diffuse,sizeof(vec3f)) == 0);
+    CHECK(mesh->diffuseTextureID == ref->diffuseTextureID);
+  }
+  CHECK(model->textures.size() == expected->textures.size());
+  for (size_t i=0;i<model->textures.size();i++) {
+    const Texture *texture = model->textures[i];
+    const Texture *ref     = expected->textures[i];
+    CHECK(texture->resolution == ref->resolution);
+    CHECK(sameBits(texture->pixel,ref->pixel));
+  }
+  CHECK(memcmp(&model->bounds,&expected->bounds,sizeof(box3f)) == 0);
+}
+
+void testHashTable()
+{
+  std::mt19937 rng(16);
+  VertexHashTable table(10);
+  std::map<tinyobj::index_t,int,reference::IndexLess> expected;
+  for (int i=0;i<100000;i++) {
+    tinyobj::index_t key;
+    key.vertex_index   = int(rng()%1000);
+    key.normal_index   = int(rng()%8)-1;
+    key.texcoord_index = int(rng()%8)-1;
+    const int newID = (int)expected.size();
+    auto it = expected.find(key);
+    const int id = table.findOrInsert(key,newID);
+    if (it == expected.end()) {
+      CHECK(id == newID);
+      expected[key] = newID;
+    } else {
+      CHECK(id == it->second);
+    }
+  }
+  CHECK(table.size() == expected.size());
+}
+
+/*! writes a few small textures (of different sizes, so they're easy
+    to tell apart) into the current directory */
+std::vector<std::string> writeTextures()
+{
+  std::vector<std::string> names;
+  for (int t=0;t<5;t++) {
+    const vec2i size(8+t,4+2*t);
+    std::vector<uint32_t> pixels(area(size));
+    for (size_t i=0;i<pixels.size();i++)
+      pixels[i] = uint32_t(i*2654435761u+t) | 0xff000000u;
+    const std::string name = "t16-texture"+std::to_string(t)+".png";
+    stbi_write_png(name.c_str(),size.x,size.y,4,pixels.data(),size.x*sizeof(uint32_t));
+    names.push_back(name);
+  }
+  return names;
+}
+
+void testSameAsReference(const std::vector<std::string> &textures)
+{
+  // some materials without textures, and one with a texture that
+  // doesn't exist - which should get ID -1, and not use up an ID
+  std::vector<std::string> materialTextures = textures;
+  materialTextures.insert(materialTextures.begin()+2,"");
+  materialTextures.insert(materialTextures.begin()+4,"t16-no-such-texture.png");
+  for (unsigned seed=0;seed<8;seed++) {
+    const std::string fileName = "./t16-random.obj";
+    writeRandomOBJ(fileName,1+seed%4,1+seed,1+(seed*37)%50,materialTextures,seed);
+    std::unique_ptr<Model> expected(reference::loadOBJ(fileName));
+    std::unique_ptr<Model> model(loadOBJ(fileName));
+    CHECK(!model->meshes.empty());
+    checkSameModel(model.get(),expected.get());
+  }
+}
+
+/*! the old loader shared one vertex map across all meshes of a shape,
+    so a vertex used with two materials got an index into the wrong
+    mesh; now each mesh gets its own copy */
+void testSharedVertices()
+{
+  {
+    std::ofstream mtl("t16-shared.mtl");
+    mtl << "newmtl a\nKd 1 1 1\nnewmtl b\nKd 0 0 1\n";
+    std::ofstream obj("t16-shared.obj");
+    obj << "mtllib t16-shared.mtl\n"
+        << "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+        << "vn 0 0 1\n"
+        << "usemtl a\nf 1//1 2//1 3//1\n"
+        << "usemtl b\nf 4//1 3//1 2//1\n";
+  }
+  std::unique_ptr<Model> model(loadOBJ("./t16-shared.obj"));
+  CHECK(model->meshes.size() == 2);
+  const TriangleMesh *b = model->meshes[1];
+  CHECK(b->vertex.size() == 3);
+  CHECK(b->normal.size() == 3);
+  CHECK(b->texcoord.empty());
+  CHECK(b->index.size() == 1 && b->index[0] == vec3i(0,1,2));
+  CHECK(b->vertex[0] == vec3f(1,1,0));
+  CHECK(b->vertex[1] == vec3f(0,1,0));
+  CHECK(b->vertex[2] == vec3f(1,0,0));
+  CHECK(b->diffuse == vec3f(0,0,1));
+  CHECK(model->bounds.lower == vec3f(0.f) && model->bounds.upper == vec3f(1,1,0));
+}
+
+int main()
+{
+  testHashTable();
+  const std::vector<std::string> textures = writeTextures();
+  // the machine may not have many cores, but the result must not
+  // depend on how the work gets split up, either way
+  for (int numThreads : { 1, 4 }) {
+    owl::common::setNumThreads(numThreads);
+    testSameAsReference(textures);
+  }
+  testSharedVertices();
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t16): all obj import tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
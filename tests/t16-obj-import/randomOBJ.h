@@ -0,0 +1,113 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Writes random OBJ files for the test and benchmark: several shapes,
+// each with faces of several materials, with some face corners
+// missing their normal and/or texcoord.
+
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+/*! writes 'fileName' (plus an .mtl next to it, whose materials
+    reference the given textures round-robin - "" for none); returns
+    the number of faces. Each material's faces use their own range of
+    positions, so no vertex is shared across meshes, and each
+    shape/material group ends with a face whose corners are new
+    vertices with all attributes - these are the two places where the
+    old loader's output was undefined */
+inline size_t writeRandomOBJ(const std::string &fileName,
+                             int numShapes, int numMaterials,
+                             int facesPerGroup,
+                             const std::vector<std::string> &textures,
+                             unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> coord(-10.f,10.f);
+  const int verticesPerGroup = facesPerGroup + 3;
+  // material -1 (faces before the first 'usemtl') gets its own range, too
+  const int numRanges = numMaterials+1;
+  const int numNormals = 257, numTexcoords = 263;
+
+  const std::string mtlFile = fileName.substr(0,fileName.rfind('.'))+".mtl";
+  {
+    std::ofstream mtl(mtlFile);
+    for (int m=0;m<numMaterials;m++) {
+      mtl << "newmtl mat" << m << "\n"
+          << "Kd " << (m%7)/7.f << " " << (m%5)/5.f << " " << (m%3)/3.f << "\n";
+      if (!textures.empty() && textures[m % textures.size()] != "")
+        mtl << "map_Kd " << textures[m % textures.size()] << "\n";
+    }
+  }
+
+  std::ofstream obj(fileName);
+  obj << "mtllib " << mtlFile.substr(mtlFile.rfind('/')+1) << "\n";
+  // every shape gets its own copy of the vertex ranges, so the
+  // closing faces' vertices are new in every shape
+  for (int s=0;s<numShapes;s++)
+    for (int i=0;i<numRanges*(verticesPerGroup+3);i++)
+      obj << "v " << coord(rng) << " " << coord(rng) << " " << coord(rng) << "\n";
+  for (int i=0;i<numNormals;i++)
+    obj << "vn " << coord(rng) << " " << coord(rng) << " " << coord(rng) << "\n";
+  for (int i=0;i<numTexcoords;i++)
+    obj << "vt " << coord(rng) << " " << coord(rng) << "\n";
+
+  size_t numFaces = 0;
+  for (int s=0;s<numShapes;s++) {
+    obj << "o shape" << s << "\n";
+    const int shapeBase = s*numRanges*(verticesPerGroup+3);
+    // materials in random order, possibly more than once per shape;
+    // the first shape starts with faces that don't have a material
+    std::vector<int> groups;
+    if (s == 0) groups.push_back(-1);
+    const int numGroups = 1+int(rng()%(2*numMaterials));
+    for (int g=0;g<numGroups;g++)
+      groups.push_back(int(rng()%numMaterials));
+    for (size_t g=0;g<groups.size();g++) {
+      const int m = groups[g];
+      if (m >= 0) obj << "usemtl mat" << m << "\n";
+      const int rangeBase = shapeBase+(m+1)*(verticesPerGroup+3);
+      for (int f=0;f<facesPerGroup;f++,numFaces++) {
+        obj << "f";
+        for (int c=0;c<3;c++) {
+          obj << " " << (1+rangeBase+int(rng()%verticesPerGroup));
+          const int attribs = rng()%4;
+          if (attribs == 0) continue;
+          obj << "/";
+          if (attribs & 1) obj << (1+int(rng()%numTexcoords));
+          if (attribs & 2) obj << "/" << (1+int(rng()%numNormals));
+        }
+        obj << "\n";
+      }
+      const bool lastOfMaterial
+        = std::find(groups.begin()+g+1,groups.end(),m) == groups.end();
+      if (lastOfMaterial) {
+        obj << "f";
+        for (int c=0;c<3;c++)
+          obj << " " << (1+rangeBase+verticesPerGroup+c)
+              << "/" << (1+int(rng()%numTexcoords))
+              << "/" << (1+int(rng()%numNormals));
+        obj << "\n";
+        numFaces++;
+      }
+    }
+  }
+  return numFaces;
+}
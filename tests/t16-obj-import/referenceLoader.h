@@ -0,0 +1,173 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// The optix7course sample's OBJ loader as it was before MeshImport:
+// std::map based vertex de-duplication, everything serial. The test
+// and benchmark compare osc::loadOBJ against this.
+
+#pragma once
+
+#include "Model.h"
+#include "tiny_obj_loader.h"
+#include "stb/stb_image.h"
+#include <cstring>
+#include <map>
+#include <set>
+
+namespace reference {
+  using namespace osc;
+
+  struct IndexLess {
+    bool operator()(const tinyobj::index_t &a, const tinyobj::index_t &b) const
+    {
+      if (a.vertex_index != b.vertex_index) return a.vertex_index < b.vertex_index;
+      if (a.normal_index != b.normal_index) return a.normal_index < b.normal_index;
+      return a.texcoord_index < b.texcoord_index;
+    }
+  };
+  typedef std::map<tinyobj::index_t,int,IndexLess> KnownVertices;
+
+  inline int addVertex(TriangleMesh *mesh,
+                       tinyobj::attrib_t &attributes,
+                       const tinyobj::index_t &idx,
+                       KnownVertices &knownVertices)
+  {
+    if (knownVertices.find(idx) != knownVertices.end())
+      return knownVertices[idx];
+
+    const vec3f *vertex_array   = (const vec3f*)attributes.vertices.data();
+    const vec3f *normal_array   = (const vec3f*)attributes.normals.data();
+    const vec2f *texcoord_array = (const vec2f*)attributes.texcoords.data();
+
+    int newID = (int)mesh->vertex.size();
+    knownVertices[idx] = newID;
+
+    mesh->vertex.push_back(vertex_array[idx.vertex_index]);
+    if (idx.normal_index >= 0) {
+      while (mesh->normal.size() < mesh->vertex.size())
+        mesh->normal.push_back(normal_array[idx.normal_index]);
+    }
+    if (idx.texcoord_index >= 0) {
+      while (mesh->texcoord.size() < mesh->vertex.size())
+        mesh->texcoord.push_back(texcoord_array[idx.texcoord_index]);
+    }
+    return newID;
+  }
+
+  inline int loadTexture(Model *model,
+                         std::map<std::string,int> &knownTextures,
+                         const std::string &inFileName,
+                         const std::string &modelPath)
+  {
+    if (inFileName == "")
+      return -1;
+    if (knownTextures.find(inFileName) != knownTextures.end())
+      return knownTextures[inFileName];
+
+    std::string fileName = inFileName;
+    for (auto &c : fileName)
+      if (c == '\\') c = '/';
+    fileName = modelPath+"/"+fileName;
+
+    vec2i res;
+    int   comp;
+    unsigned char* image = stbi_load(fileName.c_str(),
+                                     &res.x, &res.y, &comp, STBI_rgb_alpha);
+    int textureID = -1;
+    if (image) {
+      textureID = (int)model->textures.size();
+      Texture *texture = new Texture;
+      texture->resolution = res;
+      // (the original kept stbi's buffer as Texture::pixel)
+      texture->pixel.resize(size_t(res.x)*res.y);
+      memcpy(texture->pixel.data(),image,size_t(res.x)*res.y*sizeof(uint32_t));
+      stbi_image_free(image);
+      for (int y=0;y<res.y/2;y++) {
+        uint32_t *line_y = texture->pixel.data() + y * res.x;
+        uint32_t *mirrored_y = texture->pixel.data() + (res.y-1-y) * res.x;
+        for (int x=0;x<res.x;x++)
+          std::swap(line_y[x],mirrored_y[x]);
+      }
+      model->textures.push_back(texture);
+    }
+    knownTextures[inFileName] = textureID;
+    return textureID;
+  }
+
+  inline Model *loadOBJ(const std::string &objFile)
+  {
+    Model *model = new Model;
+    const std::string modelDir
+      = objFile.substr(0,objFile.rfind('/')+1);
+
+    tinyobj::attrib_t attributes;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string err = "";
+    bool readOK
+      = tinyobj::LoadObj(&attributes,&shapes,&materials,&err,&err,
+                         objFile.c_str(),modelDir.c_str(),true);
+    if (!readOK)
+      throw std::runtime_error("Could not read OBJ model from "+objFile+" : "+err);
+
+    std::map<std::string, int> knownTextures;
+    for (int shapeID=0;shapeID<(int)shapes.size();shapeID++) {
+      tinyobj::shape_t &shape = shapes[shapeID];
+      std::set<int> materialIDs;
+      for (auto faceMatID : shape.mesh.material_ids)
+        materialIDs.insert(faceMatID);
+
+      KnownVertices knownVertices;
+      for (int materialID : materialIDs) {
+        TriangleMesh *mesh = new TriangleMesh;
+        for (size_t faceID=0;faceID<shape.mesh.material_ids.size();faceID++) {
+          if (shape.mesh.material_ids[faceID] != materialID) continue;
+          if (shape.mesh.num_face_vertices[faceID] != 3)
+            throw std::runtime_error("not properly tessellated");
+          // (the original did this in a single vec3i constructor
+          // call, which left the corners' order up to the compiler)
+          vec3i idx;
+          idx.x = addVertex(mesh, attributes, shape.mesh.indices[3*faceID+0], knownVertices);
+          idx.y = addVertex(mesh, attributes, shape.mesh.indices[3*faceID+1], knownVertices);
+          idx.z = addVertex(mesh, attributes, shape.mesh.indices[3*faceID+2], knownVertices);
+          mesh->index.push_back(idx);
+          if (materialID < 0) {
+            mesh->diffuse = vec3f(1,0,0);
+            mesh->diffuseTextureID = -1;
+          } else {
+            mesh->diffuse = (const vec3f&)materials[materialID].diffuse;
+            mesh->diffuseTextureID = loadTexture(model,knownTextures,
+                                                 materials[materialID].diffuse_texname,
+                                                 modelDir);
+          }
+        }
+        if (mesh->vertex.empty())
+          delete mesh;
+        else {
+          if (mesh->texcoord.size() > 0)
+            mesh->texcoord.resize(mesh->vertex.size());
+          if (mesh->normal.size() > 0)
+            mesh->normal.resize(mesh->vertex.size());
+          model->meshes.push_back(mesh);
+        }
+      }
+    }
+    for (auto mesh : model->meshes)
+      for (auto vtx : mesh->vertex)
+        model->bounds.extend(vtx);
+    return model;
+  }
+}
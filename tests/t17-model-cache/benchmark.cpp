@@ -0,0 +1,95 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Benchmark for the optix7course sample's model cache: time to load a
+// random model from its OBJ file, and from its cache file - both just
+// mapping it, and mapping it and reading all of it once (roughly
+// what uploading it all would cost on the host side). Usage:
+// bench17-model-cache [numShapes [numMaterials [facesPerGroup]]]
+// (default: 16 shapes, 32 materials, 20K faces per group - about 10M
+// triangles)
+
+#include "ModelCache.h"
+#include "../t16-obj-import/randomOBJ.h"
+#include "owl/common/parallel/parallel_for.h"
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+using namespace owl::common;
+
+template<typename Lambda>
+double measure(const Lambda &lambda)
+{
+  const double t0 = getCurrentTime();
+  lambda();
+  return getCurrentTime()-t0;
+}
+
+/*! reads every byte of the model once, as uploading it would */
+uint32_t touchAll(const osc::Model *model)
+{
+  uint32_t sum = 0;
+  auto touch = [&](const void *ptr, size_t numBytes){
+    const uint32_t *words = (const uint32_t *)ptr;
+    for (size_t i=0;i<numBytes/4;i++) sum += words[i];
+  };
+  for (const osc::TriangleMesh *mesh : model->meshes) {
+    touch(mesh->vertex.data(),  mesh->vertex.size()*sizeof(vec3f));
+    touch(mesh->normal.data(),  mesh->normal.size()*sizeof(vec3f));
+    touch(mesh->texcoord.data(),mesh->texcoord.size()*sizeof(vec2f));
+    touch(mesh->index.data(),   mesh->index.size()*sizeof(vec3i));
+  }
+  return sum;
+}
+
+int main(int ac, char **av)
+{
+  const int numShapes     = ac > 1 ? std::stoi(av[1]) : 16;
+  const int numMaterials  = ac > 2 ? std::stoi(av[2]) : 32;
+  const int facesPerGroup = ac > 3 ? std::stoi(av[3]) : 20000;
+
+  const std::string objFile   = "./bench17-random.obj";
+  const std::string cacheFile = "./bench17-random.obj.oscache";
+  const size_t numFaces
+    = writeRandomOBJ(objFile,numShapes,numMaterials,facesPerGroup,{},17);
+  std::cout << "#owl.bench(17): " << prettyNumber(numFaces) << " triangles, "
+            << getNumThreads() << " threads" << std::endl;
+
+  std::vector<std::string> sourceFiles;
+  std::unique_ptr<osc::Model> model;
+  const double tOBJ = measure([&](){ model.reset(osc::loadOBJ(objFile,&sourceFiles)); });
+  const double tSave = measure([&](){ osc::saveModelCache(cacheFile,model.get(),sourceFiles); });
+  const uint32_t expected = touchAll(model.get());
+  model.reset();
+
+  // (the cache file will mostly be in the OS's page cache by now, as
+  // it would be for repeated runs of the same model)
+  const double tMap = measure([&](){ model.reset(osc::loadModelCache(cacheFile)); });
+  if (!model) throw std::runtime_error("could not map cache file");
+  uint32_t sum = 0;
+  const double tTouch = measure([&](){ sum = touchAll(model.get()); });
+  if (sum != expected) throw std::runtime_error("cache has different contents");
+
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "  load OBJ             " << prettyDouble(tOBJ) << "s\n"
+            << "  write cache          " << prettyDouble(tSave) << "s\n"
+            << "  map cache            " << prettyDouble(tMap) << "s (speedup "
+            << (tOBJ/tMap) << "x)\n"
+            << "  map cache, read all  " << prettyDouble(tMap+tTouch) << "s (speedup "
+            << (tOBJ/(tMap+tTouch)) << "x)" << std::defaultfloat << std::endl;
+  return 0;
+}
@@ -0,0 +1,210 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Tests the optix7course sample's binary model cache (ModelCache):
+// that a mapped cache gives exactly the model loading the OBJ does,
+// that it gets invalidated when the OBJ, its materials, or its
+// textures change, and that damaged cache files get rejected rather
+// than used. Does not need a GPU.
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION 1
+#include "stb/stb_image_write.h"
+#include "ModelCache.h"
+#include "../t16-obj-import/randomOBJ.h"
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+
+#define OWL_TEST_NAME "t17"
+#include "../owlTestCheck.h"
+
+using namespace osc;
+
+const std::string objFile   = "./t17-model.obj";
+const std::string cacheFile = "./t17-model.obj.oscache";
+
+template<typename T>
+bool sameBits(const Array<T> &a, const Array<T> &b)
+{
+  return a.size() == b.size()
+    && (a.empty() || memcmp(a.data(),b.data(),a.size()*sizeof(T)) == 0);
+}
+
+void checkSameModel(const Model *model, const Model *expected)
+{
+  CHECK(model->meshes.size() == expected->meshes.size());
+  for (size_t i=0;i<model->meshes.size();i++) {
+    const TriangleMesh *mesh = model->meshes[i];
+    const TriangleMesh *ref  = expected->meshes[i];
+    CHECK(sameBits(mesh->vertex,ref->vertex));
+    CHECK(sameBits(mesh->normal,ref->normal));
+    CHECK(sameBits(mesh->texcoord,ref->texcoord));
+    CHECK(sameBits(mesh->index,ref->index));
+    CHECK(mesh->diffuse == ref->diffuse);
+    CHECK(mesh->diffuseTextureID == ref->diffuseTextureID);
+  }
+  CHECK(model->textures.size() == expected->textures.size());
+  for (size_t i=0;i<model->textures.size();i++) {
+    CHECK(model->textures[i]->resolution == expected->textures[i]->resolution);
+    CHECK(sameBits(model->textures[i]->pixel,expected->textures[i]->pixel));
+  }
+  CHECK(model->bounds.lower == expected->bounds.lower);
+  CHECK(model->bounds.upper == expected->bounds.upper);
+}
+
+void writeTexture(const std::string &name, const vec2i &size, uint32_t seed)
+{
+  std::vector<uint32_t> pixels(area(size));
+  for (size_t i=0;i<pixels.size();i++)
+    pixels[i] = uint32_t(i*2654435761u+seed) | 0xff000000u;
+  stbi_write_png(name.c_str(),size.x,size.y,4,pixels.data(),size.x*sizeof(uint32_t));
+}
+
+std::vector<char> readFile(const std::string &fileName)
+{
+  std::ifstream in(fileName,std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(in),
+                           std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string &fileName, const std::vector<char> &bytes)
+{
+  std::ofstream out(fileName,std::ios::binary);
+  out.write(bytes.data(),bytes.size());
+}
+
+void testRoundTrip()
+{
+  std::remove(cacheFile.c_str());
+  // the first load writes the cache, the second one maps it
+  std::unique_ptr<Model> loaded(loadOBJCached(objFile));
+  CHECK(!loaded->meshes.empty() && !loaded->meshes[0]->vertex.isView());
+  std::unique_ptr<Model> mapped(loadOBJCached(objFile));
+  CHECK(mapped->mapping != nullptr);
+  CHECK(mapped->textures.size() == 2);
+  for (const TriangleMesh *mesh : mapped->meshes) {
+    CHECK(mesh->vertex.isView() && mesh->index.isView());
+    CHECK(size_t(mesh->vertex.data()) % 256 == 0);
+    CHECK(size_t(mesh->index.data()) % 256 == 0);
+  }
+  std::unique_ptr<Model> reference(loadOBJ(objFile));
+  checkSameModel(mapped.get(),reference.get());
+  checkSameModel(loaded.get(),reference.get());
+
+  // modifying a mapped array copies it, and leaves the cache alone
+  TriangleMesh *mesh = mapped->meshes[0];
+  const vec3f first = mesh->vertex[0];
+  const size_t numVertices = mesh->vertex.size();
+  mesh->vertex.push_back(vec3f(1e6f));
+  CHECK(!mesh->vertex.isView());
+  CHECK(mesh->vertex.size() == numVertices+1 && mesh->vertex[0] == first);
+  std::unique_ptr<Model> again(loadModelCache(cacheFile));
+  CHECK(again && again->meshes[0]->vertex.size() == numVertices);
+}
+
+/*! checks that 'change' outdates the cache. The changes all change
+    a file's size, too, since within a test, its modification time
+    may well stay the same */
+void checkInvalidatedBy(const std::function<void()> &change)
+{
+  std::unique_ptr<Model> model(loadOBJCached(objFile));
+  CHECK(loadModelCache(cacheFile) != nullptr);
+  change();
+  CHECK(loadModelCache(cacheFile) == nullptr);
+  // ... and the next load updates it
+  model.reset(loadOBJCached(objFile));
+  std::unique_ptr<Model> mapped(loadModelCache(cacheFile));
+  CHECK(mapped != nullptr);
+  checkSameModel(mapped.get(),model.get());
+}
+
+void testInvalidation()
+{
+  // the OBJ (by its size changing)
+  checkInvalidatedBy([](){
+      std::ofstream out(objFile,std::ios::app);
+      out << "# a comment\n";
+    });
+  // the material library
+  checkInvalidatedBy([](){
+      std::ofstream out("./t17-model.mtl",std::ios::app);
+      out << "# a comment\n";
+    });
+  // a texture
+  checkInvalidatedBy([](){ writeTexture("t17-texture0.png",vec2i(9,5),1); });
+  // a texture that didn't exist before
+  checkInvalidatedBy([](){ writeTexture("t17-texture-missing.png",vec2i(3,3),2); });
+}
+
+void testDamagedCache()
+{
+  std::unique_ptr<Model> model(loadOBJCached(objFile));
+  const std::vector<char> good = readFile(cacheFile);
+  CHECK(good.size() > 1024);
+
+  std::vector<char> bad = good;
+  bad.resize(good.size()/2);
+  writeFile(cacheFile,bad);
+  CHECK(loadModelCache(cacheFile) == nullptr);
+
+  bad = good;
+  bad[0] = 'X';
+  writeFile(cacheFile,bad);
+  CHECK(loadModelCache(cacheFile) == nullptr);
+
+  // version
+  bad = good;
+  bad[8]++;
+  writeFile(cacheFile,bad);
+  CHECK(loadModelCache(cacheFile) == nullptr);
+
+  writeFile(cacheFile,std::vector<char>());
+  CHECK(loadModelCache(cacheFile) == nullptr);
+
+  std::remove(cacheFile.c_str());
+  CHECK(loadModelCache(cacheFile) == nullptr);
+
+  // a mesh referring to a texture that isn't there
+  std::vector<std::string> sourceFiles;
+  std::unique_ptr<Model> broken(loadOBJ(objFile,&sourceFiles));
+  broken->meshes[0]->diffuseTextureID = int(broken->textures.size());
+  saveModelCache(cacheFile,broken.get(),sourceFiles);
+  CHECK(loadModelCache(cacheFile) == nullptr);
+  broken->meshes[0]->diffuseTextureID = -2;
+  saveModelCache(cacheFile,broken.get(),sourceFiles);
+  CHECK(loadModelCache(cacheFile) == nullptr);
+
+  writeFile(cacheFile,good);
+  CHECK(loadModelCache(cacheFile) != nullptr);
+}
+
+int main()
+{
+  writeTexture("t17-texture0.png",vec2i(8,4),0);
+  writeTexture("t17-texture1.png",vec2i(5,7),1);
+  std::remove("t17-texture-missing.png");
+  writeRandomOBJ(objFile,3,4,20,
+                 { "t17-texture0.png", "", "t17-texture1.png", "t17-texture-missing.png" },
+                 17);
+  testRoundTrip();
+  testInvalidation();
+  testDamagedCache();
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t17): all model cache tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
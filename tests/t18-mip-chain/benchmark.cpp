@@ -0,0 +1,93 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Benchmark for owl/common/image/MipChain.h: time to compute the full
+// mip chain of an RGBA8 texture, with each filter, with and without
+// sRGB, against a straightforward serial 2x2 box filter. Usage:
+// bench18-mip-chain [size] (default: 4096, ie, a 4Kx4K texture)
+
+#include "owl/common/image/MipChain.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+using namespace owl::common;
+
+template<typename Lambda>
+double measure(const Lambda &lambda)
+{
+  const double t0 = getCurrentTime();
+  lambda();
+  return getCurrentTime()-t0;
+}
+
+/*! the obvious way of doing it, for reference */
+std::vector<std::vector<uint32_t>> naiveBoxChain(const uint32_t *texels, vec2i size)
+{
+  std::vector<std::vector<uint32_t>> levels;
+  const uint32_t *in = texels;
+  while (size.x > 1 || size.y > 1) {
+    const vec2i outSize(max(size.x/2,1),max(size.y/2,1));
+    std::vector<uint32_t> out(area(outSize));
+    for (int y=0;y<outSize.y;y++)
+      for (int x=0;x<outSize.x;x++) {
+        uint32_t result = 0;
+        for (int c=0;c<4;c++) {
+          int sum = 0;
+          for (int dy=0;dy<2;dy++)
+            for (int dx=0;dx<2;dx++) {
+              const int ix = min(2*x+dx,size.x-1), iy = min(2*y+dy,size.y-1);
+              sum += (in[iy*size.x+ix] >> (8*c)) & 0xff;
+            }
+          result |= uint32_t((sum+2)/4) << (8*c);
+        }
+        out[y*outSize.x+x] = result;
+      }
+    levels.push_back(std::move(out));
+    in = levels.back().data();
+    size = outSize;
+  }
+  return levels;
+}
+
+int main(int ac, char **av)
+{
+  const int res = ac > 1 ? std::stoi(av[1]) : 4096;
+  const vec2i size(res);
+  std::vector<uint32_t> texels(area(size));
+  std::mt19937 rng(18);
+  for (auto &t : texels) t = rng();
+  std::cout << "#owl.bench(18): " << res << "x" << res << " RGBA8, "
+            << getNumThreads() << " threads" << std::endl;
+
+  const double tNaive = measure([&](){ naiveBoxChain(texels.data(),size); });
+  std::cout << "  naive box          " << prettyDouble(tNaive) << "s ("
+            << prettyDouble(area(size)/tNaive) << " texels/s)" << std::endl;
+  for (auto filter : { MIP_FILTER_BOX, MIP_FILTER_KAISER })
+    for (bool srgb : { false, true }) {
+      MipOptions options;
+      options.filter = filter;
+      options.srgb   = srgb;
+      const double t = measure([&](){ computeMipChain(texels.data(),size,options); });
+      std::cout << "  " << (filter == MIP_FILTER_BOX ? "box   " : "kaiser")
+                << (srgb ? " (sRGB)    " : "           ") << " "
+                << prettyDouble(t) << "s ("
+                << prettyDouble(area(size)/t) << " texels/s, speedup "
+                << std::fixed << std::setprecision(2) << (tNaive/t)
+                << std::defaultfloat << ")" << std::endl;
+    }
+  return 0;
+}
@@ -0,0 +1,249 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Tests owl/common/image/MipChain.h: level sizes, that filters
+// preserve constant textures and compute exact averages where they
+// should, sRGB-correct filtering, that the Kaiser filter removes
+// frequencies the box filter aliases, edge handling, the SSE
+// conversions against their scalar versions, and determinism.
+
+#include "owl/common/image/MipChain.h"
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#define OWL_TEST_NAME "t18"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+void testLevelSizes()
+{
+  CHECK(numMipLevels(vec2i(1,1)) == 1);
+  CHECK(numMipLevels(vec2i(256,256)) == 9);
+  CHECK(numMipLevels(vec2i(13,7)) == 4);
+  CHECK(numMipLevels(vec2i(1,1000)) == 10);
+
+  std::vector<float> texels(13*7,1.f);
+  MipChain<float> chain = computeMipChain(texels.data(),vec2i(13,7));
+  CHECK(chain.numLevels() == 4);
+  CHECK(chain.size[1] == vec2i(6,3));
+  CHECK(chain.size[2] == vec2i(3,1));
+  CHECK(chain.size[3] == vec2i(1,1));
+  CHECK(chain.level(0) == texels.data());
+  for (int i=1;i<chain.numLevels();i++)
+    CHECK(chain.texels[i-1].size() == size_t(area(chain.size[i])));
+  const std::vector<const void *> pointers = chain.levelPointers();
+  CHECK(pointers.size() == 4 && pointers[2] == chain.level(2));
+
+  MipOptions options;
+  options.maxLevels = 2;
+  CHECK(computeMipChain(texels.data(),vec2i(13,7),options).numLevels() == 2);
+}
+
+template<typename T>
+bool same(const T &a, const T &b) { return memcmp(&a,&b,sizeof(T)) == 0; }
+// (normalized filter weights needn't sum up to exactly one in float)
+bool same(float a, float b) { return fabsf(a-b) <= 1e-6f*fabsf(b); }
+bool same(const vec4f &a, const vec4f &b)
+{ return same(a.x,b.x) && same(a.y,b.y) && same(a.z,b.z) && same(a.w,b.w); }
+
+template<typename T>
+void checkConstant(const T &value, const vec2i &size, MipFilter filter, bool srgb, bool wrap)
+{
+  std::vector<T> texels(area(size),value);
+  MipOptions options;
+  options.filter = filter;
+  options.srgb   = srgb;
+  options.wrap   = wrap;
+  MipChain<T> chain = computeMipChain(texels.data(),size,options);
+  for (int i=1;i<chain.numLevels();i++)
+    for (auto &t : chain.texels[i-1])
+      CHECK(same(t,value));
+}
+
+void testConstant()
+{
+  for (auto filter : { MIP_FILTER_BOX, MIP_FILTER_KAISER })
+    for (bool wrap : { false, true }) {
+      for (bool srgb : { false, true }) {
+        checkConstant<uint32_t>(0x80ff4001u,vec2i(37,64),filter,srgb,wrap);
+        checkConstant<vec4uc>(vec4uc(1,2,254,128),vec2i(16,5),filter,srgb,wrap);
+        checkConstant<uint8_t>(77,vec2i(100,3),filter,srgb,wrap);
+      }
+      checkConstant<float>(.25f,vec2i(33,17),filter,false,wrap);
+      checkConstant<vec4f>(vec4f(.5f,-2.f,8.f,1.f),vec2i(64,64),filter,false,wrap);
+    }
+}
+
+void testBoxAverage()
+{
+  std::mt19937 rng(18);
+  const vec2i size(32,16);
+  std::vector<vec4f> texels(area(size));
+  for (auto &t : texels)
+    t = vec4f(float(rng()%256),float(rng()%256),float(rng()%256),float(rng()%256));
+  MipChain<vec4f> chain = computeMipChain(texels.data(),size);
+  for (int y=0;y<size.y/2;y++)
+    for (int x=0;x<size.x/2;x++) {
+      const vec4f expected
+        = .25f*(texels[(2*y)*size.x+2*x]   + texels[(2*y)*size.x+2*x+1]
+                + texels[(2*y+1)*size.x+2*x] + texels[(2*y+1)*size.x+2*x+1]);
+      const vec4f got = chain.texels[0][y*(size.x/2)+x];
+      CHECK(reduce_max(abs(got-expected)) < 1e-4f);
+    }
+
+  // odd sizes: the one texel of 3x1 -> 1x1 covers all three
+  std::vector<float> odd = { 1.f, 2.f, 6.f };
+  CHECK(fabsf(computeMipChain(odd.data(),vec2i(3,1)).texels[0][0]-3.f) < 1e-6f);
+
+  // 8-bit texels round to nearest
+  std::vector<uint8_t> bytes = { 0, 1, 1, 1 };
+  CHECK(computeMipChain(bytes.data(),vec2i(2,2)).texels[0][0] == 1);
+  bytes = { 0, 0, 1, 1 };
+  CHECK(computeMipChain(bytes.data(),vec2i(2,2)).texels[0][0] == 1);
+  bytes = { 0, 0, 0, 1 };
+  CHECK(computeMipChain(bytes.data(),vec2i(2,2)).texels[0][0] == 0);
+}
+
+void testSRGB()
+{
+  // half black, half white: the linear average is .5, which is 188
+  // in sRGB; alpha is always linear
+  std::vector<uint32_t> texels = { 0x00000000u, 0xffffffffu };
+  MipOptions options;
+  options.srgb = true;
+  const uint32_t avg = computeMipChain(texels.data(),vec2i(2,1),options).texels[0][0];
+  CHECK((avg & 0xff) == 188 && ((avg >> 8) & 0xff) == 188 && ((avg >> 16) & 0xff) == 188);
+  CHECK((avg >> 24) == 128);
+  options.srgb = false;
+  CHECK(computeMipChain(texels.data(),vec2i(2,1),options).texels[0][0] == 0x80808080u);
+
+  // the encode table against the exact function
+  const owl::common::detail::EncodeTable encode;
+  for (int i=0;i<=1000;i++) {
+    const float f = i/1000.f;
+    const int exact = int(owl::common::detail::linearToSRGB(f)*255.f+.5f);
+    CHECK(int(encode(f)) == exact);
+  }
+  CHECK(encode(-1.f) == 0 && encode(2.f) == 255 && encode(NAN) == 0);
+}
+
+/*! standard deviation of a level that ideally would be constant */
+float deviation(const std::vector<float> &level)
+{
+  double sum = 0.f, sum2 = 0.f;
+  for (float f : level) { sum += f; sum2 += f*f; }
+  const double mean = sum/level.size();
+  return float(sqrt(std::max(0.,sum2/level.size()-mean*mean)));
+}
+
+void testAliasing()
+{
+  // stripes of a frequency (.4 cycles per texel) that the next level
+  // can't represent, so should ideally be filtered out entirely
+  const vec2i size(256,4);
+  std::vector<float> texels(area(size));
+  for (int y=0;y<size.y;y++)
+    for (int x=0;x<size.x;x++)
+      texels[y*size.x+x] = .5f+.5f*cosf(2.f*3.14159265f*.4f*x);
+  MipOptions options;
+  options.wrap   = true;
+  options.filter = MIP_FILTER_BOX;
+  const float box    = deviation(computeMipChain(texels.data(),size,options).texels[0]);
+  options.filter = MIP_FILTER_KAISER;
+  const float kaiser = deviation(computeMipChain(texels.data(),size,options).texels[0]);
+  CHECK(box > .1f);
+  CHECK(kaiser < .2f*box);
+}
+
+void testEdges()
+{
+  // a white first column: with wrap, the filter footprints of the
+  // last column reach over to it, with clamp they don't
+  const vec2i size(64,8);
+  std::vector<float> texels(area(size),0.f);
+  for (int y=0;y<size.y;y++) texels[y*size.x] = 1.f;
+  MipOptions options;
+  options.filter = MIP_FILTER_KAISER;
+  options.wrap   = false;
+  const std::vector<float> clamped = computeMipChain(texels.data(),size,options).texels[0];
+  options.wrap   = true;
+  const std::vector<float> wrapped = computeMipChain(texels.data(),size,options).texels[0];
+  const int last = size.x/2-1;
+  CHECK(fabsf(clamped[last]) < 1e-3f);
+  CHECK(wrapped[last] > 1e-2f);
+}
+
+void testConversions()
+{
+  // the SSE path (16 at a time) against the scalar one, including
+  // out-of-range values and NaNs
+  std::mt19937 rng(18);
+  std::uniform_real_distribution<float> dist(-.5f,1.5f);
+  std::vector<float> values(4*1001);
+  for (auto &f : values) f = dist(rng);
+  values[3] = NAN;
+  values[100] = 1.f/255.f*.5f;
+  std::vector<uint32_t> texels(values.size()/4);
+  owl::common::detail::mipFromFloat(values.data(),texels.data(),texels.size(),nullptr);
+  const uint8_t *bytes = (const uint8_t *)texels.data();
+  for (size_t i=0;i<values.size();i++)
+    CHECK(bytes[i] == owl::common::detail::floatToUnorm8(values[i]));
+
+  // and 8 bit -> float -> 8 bit is lossless
+  std::vector<uint32_t> all(64);
+  for (int i=0;i<64;i++)
+    all[i] = uint32_t(4*i) | (uint32_t(4*i+1) << 8) | (uint32_t(4*i+2) << 16) | (uint32_t(4*i+3) << 24);
+  std::vector<float> floats(4*all.size());
+  owl::common::detail::mipToFloat(all.data(),floats.data(),all.size(),owl::common::detail::DecodeTable(false));
+  std::vector<uint32_t> back(all.size());
+  owl::common::detail::mipFromFloat(floats.data(),back.data(),back.size(),nullptr);
+  CHECK(back == all);
+}
+
+void testDeterminism()
+{
+  std::mt19937 rng(18);
+  const vec2i size(301,203);
+  std::vector<uint32_t> texels(area(size));
+  for (auto &t : texels) t = rng();
+  MipOptions options;
+  options.filter = MIP_FILTER_KAISER;
+  options.srgb   = true;
+  setNumThreads(1);
+  MipChain<uint32_t> serial = computeMipChain(texels.data(),size,options);
+  setNumThreads(4);
+  MipChain<uint32_t> parallel = computeMipChain(texels.data(),size,options);
+  for (int i=1;i<serial.numLevels();i++)
+    CHECK(serial.texels[i-1] == parallel.texels[i-1]);
+}
+
+int main()
+{
+  testLevelSizes();
+  testConstant();
+  testBoxAverage();
+  testSRGB();
+  testAliasing();
+  testEdges();
+  testConversions();
+  testDeterminism();
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t18): all mip chain tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
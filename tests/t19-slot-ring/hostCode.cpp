@@ -0,0 +1,246 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of owl::common::SlotRing (the slot recycling behind
+// async launches with the same launch params): round-robin order,
+// back-pressure exactly when the ring is full, drain/resize, and a
+// producer/consumer run against a simulated stream that checks no
+// slot ever gets overwritten while still being read. Does not need
+// a GPU.
+
+#include "owl/common/parallel/SlotRing.h"
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <functional>
+
+#define OWL_TEST_NAME "t19"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+/*! a fence that the test signals by hand; wait() on a fence that
+    isn't done would block forever, so here it just gets counted (and
+    signals the fence, as if the work had completed) */
+struct ManualFence {
+  bool isDone() { return done; }
+  void wait() { numWaits++; done = true; }
+
+  void arm() { done = false; }
+  
+  bool done = true;
+  static int numWaits;
+};
+int ManualFence::numWaits = 0;
+
+void testRoundRobin()
+{
+  SlotRing<ManualFence> ring(3);
+  CHECK(ring.numSlots() == 3);
+  CHECK(ring.numInFlight() == 0);
+
+  // nothing in flight: slots come in order, without waiting
+  for (int i=0;i<3;i++) {
+    const size_t slot = ring.acquire();
+    CHECK(slot == size_t(i));
+    ring.fence(slot).arm();
+    ring.submit(slot);
+  }
+  CHECK(ring.numInFlight() == 3);
+  CHECK(ring.numStalls() == 0);
+  CHECK(ManualFence::numWaits == 0);
+
+  // oldest one completed: re-used without waiting
+  ring.fence(0).done = true;
+  CHECK(ring.acquire() == 0);
+  CHECK(ring.numStalls() == 0);
+  CHECK(ManualFence::numWaits == 0);
+  CHECK(ring.numInFlight() == 2);
+  ring.fence(0).arm();
+  ring.submit(0);
+
+  // ring full, next one still running: must wait for exactly that one
+  CHECK(ring.acquire() == 1);
+  CHECK(ring.numStalls() == 1);
+  CHECK(ManualFence::numWaits == 1);
+  CHECK(ring.fence(1).done);
+  CHECK(!ring.fence(2).done);
+
+  // an acquired but never submitted slot is free right away
+  CHECK(ring.numInFlight() == 2);
+  
+  ring.drain();
+  CHECK(ring.numInFlight() == 0);
+  CHECK(ManualFence::numWaits == 3);
+  CHECK(ring.acquire() == 2);
+  CHECK(ring.acquire() == 0);
+  CHECK(ManualFence::numWaits == 3);
+}
+
+void testResize()
+{
+  ManualFence::numWaits = 0;
+  SlotRing<ManualFence> ring;
+  CHECK(ring.numSlots() == 1);
+  
+  // a single slot serializes everything
+  for (int i=0;i<4;i++) {
+    const size_t slot = ring.acquire();
+    CHECK(slot == 0);
+    ring.fence(slot).arm();
+    ring.submit(slot);
+  }
+  CHECK(ring.numStalls() == 3);
+
+  // resizing waits for what's in flight, and starts over
+  ring.resize(4);
+  CHECK(ManualFence::numWaits == 4);
+  CHECK(ring.numSlots() == 4);
+  CHECK(ring.numInFlight() == 0);
+  CHECK(ring.acquire() == 0);
+
+  bool threw = false;
+  try {
+    ring.resize(0);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  CHECK(threw);
+}
+
+/*! a (very) simplified cuda stream: work items get executed in
+    order, by one thread, each one after a short delay. Every
+    submission gets a ticket, and a fence is done once the stream
+    has completed the ticket it was recorded with */
+struct SimulatedStream {
+  SimulatedStream() : thread([this](){ run(); }) {}
+  ~SimulatedStream()
+  {
+    { std::lock_guard<std::mutex> lock(mutex); quit = true; }
+    cv.notify_all();
+    thread.join();
+  }
+
+  uint64_t enqueue(const std::function<void()> &work)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(work);
+    cv.notify_all();
+    return ++lastTicket;
+  }
+
+  void waitFor(uint64_t ticket)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock,[&](){ return completed >= ticket; });
+  }
+  
+  void run()
+  {
+    while (1) {
+      std::function<void()> work;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock,[&](){ return quit || !queue.empty(); });
+        if (queue.empty()) return;
+        work = queue.front();
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+      work();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.pop_front();
+        completed++;
+      }
+      cv.notify_all();
+    }
+  }
+  
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<std::function<void()>> queue;
+  uint64_t lastTicket = 0;
+  uint64_t completed  = 0;
+  bool quit = false;
+  std::thread thread;
+};
+
+struct StreamFence {
+  bool isDone()
+  {
+    std::lock_guard<std::mutex> lock(stream->mutex);
+    return stream->completed >= ticket;
+  }
+  void wait() { stream->waitFor(ticket); }
+  
+  SimulatedStream *stream = nullptr;
+  uint64_t ticket = 0;
+};
+
+/*! the same pattern as an async launch: write the values into the
+    slot's host memory, enqueue a 'launch' that reads them later on,
+    record the fence, submit - and check that every launch sees
+    exactly the values it was issued with */
+void testProducerConsumer(int numSlots)
+{
+  const int numLaunches = 2000;
+  SimulatedStream stream;
+  SlotRing<StreamFence> ring(numSlots);
+  std::vector<int> slotValues(numSlots,-1);
+  std::atomic<int> numWrong(0), numDone(0);
+  std::atomic<int> inFlight(0), maxInFlight(0);
+  
+  for (int launchID=0;launchID<numLaunches;launchID++) {
+    const size_t slot = ring.acquire();
+    slotValues[slot] = launchID;
+    int now = ++inFlight;
+    int prev = maxInFlight;
+    while (now > prev && !maxInFlight.compare_exchange_weak(prev,now));
+    
+    const uint64_t ticket = stream.enqueue([&,slot,launchID](){
+        if (slotValues[slot] != launchID) numWrong++;
+        numDone++;
+        inFlight--;
+      });
+    ring.fence(slot).stream = &stream;
+    ring.fence(slot).ticket = ticket;
+    ring.submit(slot);
+  }
+  ring.drain();
+  CHECK(numDone == numLaunches);
+  CHECK(numWrong == 0);
+  CHECK(maxInFlight <= numSlots);
+  // the producer is a lot faster than the 'stream', so it should
+  // have hit the back-pressure most of the time
+  CHECK(ring.numStalls() > 0);
+}
+
+int main()
+{
+  testRoundRobin();
+  testResize();
+  for (int numSlots : { 1, 2, 3, 8 })
+    testProducerConsumer(numSlots);
+  
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t19): all slot ring tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
@@ -0,0 +1,262 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of owl::common::DeviceTileBalancer (sort-first
+// multi-GPU frame distribution): every tile assigned exactly once,
+// in compact per-device runs; convergence to a balanced frame for
+// simulated devices of different speeds on a frame of uneven cost,
+// both with and without per-tile cost measurements; and
+// determinism. Does not need a GPU.
+
+#include "owl/common/parallel/DeviceTileBalancer.h"
+#include <iostream>
+#include <stdexcept>
+#include <cmath>
+
+#define OWL_TEST_NAME "t20"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+const vec2i fbSize(1600,800);
+
+/*! the 'true' cost of rendering a tile: a cheap background, and an
+    expensive blob off to one side of the frame (think: a glass
+    object in front of an empty sky) */
+double trueCost(const DeviceTileBalancer &balancer, int tileID)
+{
+  const box2i range = balancer.getTileRange(tileID);
+  const vec2f center = vec2f(range.lower+range.upper)*.5f;
+  const vec2f blob(1100.f,300.f);
+  const vec2f delta = (center-blob)/200.f;
+  const float dist2 = dot(delta,delta);
+  return double(area(range)) * (1. + 20.*exp(-dist2));
+}
+
+/*! a simulated multi-GPU frame: how long each device takes for the
+    tiles it got, plus the per-tile costs it measured - in its own
+    'clock', which is different on every device */
+struct SimulatedDevices {
+  std::vector<double> speed;
+
+  void render(const DeviceTileBalancer &balancer,
+              const DeviceTileBalancer::Assignment &assignment,
+              std::vector<double> &deviceTimes,
+              std::vector<double> &tileCosts) const
+  {
+    deviceTimes.assign(speed.size(),0.);
+    tileCosts.assign(balancer.getNumTiles(),0.);
+    for (int d=0;d<(int)speed.size();d++)
+      for (int i=assignment.begin[d];i<assignment.begin[d+1];i++) {
+        const int tileID = assignment.tileIDs[i];
+        const double time = trueCost(balancer,tileID)/speed[d];
+        deviceTimes[d] += time;
+        tileCosts[tileID] = time * 1e9 * (d+1.5);
+      }
+  }
+
+  /*! the best possible frame time: all devices busy until the end */
+  double idealTime(const DeviceTileBalancer &balancer) const
+  {
+    double total = 0., totalSpeed = 0.;
+    for (int t=0;t<balancer.getNumTiles();t++) total += trueCost(balancer,t);
+    for (auto s : speed) totalSpeed += s;
+    return total/totalSpeed;
+  }
+
+  /*! the frame time with 32-pixel columns interleaved over the
+      devices, the way the multi-GPU sample used to do it */
+  double interleavedTime() const
+  {
+    DeviceTileBalancer columns((int)speed.size());
+    columns.resize(fbSize);
+    std::vector<double> times(speed.size(),0.);
+    for (int t=0;t<columns.getNumTiles();t++) {
+      const int d = (columns.getTileRange(t).lower.x/32) % (int)speed.size();
+      times[d] += trueCost(columns,t)/speed[d];
+    }
+    return *std::max_element(times.begin(),times.end());
+  }
+};
+
+void testCoverage()
+{
+  for (int numDevices : { 1, 2, 3, 7 }) {
+    DeviceTileBalancer balancer(numDevices);
+    // not a multiple of the tile size, on purpose
+    balancer.resize(vec2i(1000,333));
+    CHECK(balancer.getNumTiles() == 32*11);
+    
+    const DeviceTileBalancer::Assignment &a = balancer.nextFrame();
+    CHECK((int)a.begin.size() == numDevices+1);
+    CHECK(a.begin[0] == 0);
+    CHECK(a.begin[numDevices] == balancer.getNumTiles());
+    std::vector<int> seen(balancer.getNumTiles(),0);
+    int64_t pixels = 0;
+    for (int d=0;d<numDevices;d++) {
+      CHECK(a.begin[d] <= a.begin[d+1]);
+      // all equally fast, all tiles equally expensive
+      CHECK(std::abs(a.numTiles(d) - balancer.getNumTiles()/numDevices) <= 1);
+      for (int i=a.begin[d];i<a.begin[d+1];i++) {
+        const int tileID = a.tileIDs[i];
+        seen[tileID]++;
+        const box2i range = balancer.getTileRange(tileID);
+        CHECK(!range.empty());
+        CHECK(range.upper.x <= 1000 && range.upper.y <= 333);
+        pixels += area(range);
+      }
+    }
+    for (auto s : seen) { CHECK(s == 1); }
+    CHECK(pixels == 1000*333);
+  }
+
+  // a device's tiles form a compact region, not scattered columns:
+  // its bounding box shouldn't be much larger than its tiles
+  DeviceTileBalancer balancer(4);
+  balancer.resize(vec2i(1024,1024));
+  const DeviceTileBalancer::Assignment &a = balancer.nextFrame();
+  for (int d=0;d<4;d++) {
+    box2i bounds;
+    int64_t pixels = 0;
+    for (int i=a.begin[d];i<a.begin[d+1];i++) {
+      const box2i range = balancer.getTileRange(a.tileIDs[i]);
+      bounds.extend(range);
+      pixels += area(range);
+    }
+    CHECK(area(bounds) == pixels);
+  }
+}
+
+void testConvergence(const std::vector<double> &speeds, bool withTileCosts)
+{
+  SimulatedDevices devices{speeds};
+  DeviceTileBalancer balancer((int)speeds.size());
+  balancer.resize(fbSize);
+  
+  std::vector<double> deviceTimes, tileCosts;
+  double frameTime = 0.;
+  for (int frame=0;frame<30;frame++) {
+    const auto &assignment = balancer.nextFrame();
+    devices.render(balancer,assignment,deviceTimes,tileCosts);
+    frameTime = *std::max_element(deviceTimes.begin(),deviceTimes.end());
+    balancer.update(deviceTimes,
+                    withTileCosts ? tileCosts : std::vector<double>());
+  }
+  const double ideal = devices.idealTime(balancer);
+  const double interleaved = devices.interleavedTime();
+  std::cout << "#owl.test(t20): " << speeds.size() << " devices, "
+            << (withTileCosts ? "with" : "without") << " tile costs: "
+            << "balanced " << frameTime/ideal << "x ideal, "
+            << "interleaved " << interleaved/ideal << "x ideal" << std::endl;
+  CHECK(frameTime < 1.05*ideal);
+  // (fine-grained interleaving is hard to beat if all devices are
+  // equally fast - it just can't handle devices that aren't)
+  if (*std::min_element(speeds.begin(),speeds.end())
+      != *std::max_element(speeds.begin(),speeds.end())) {
+    CHECK(frameTime < interleaved);
+  }
+
+  // a device being slow and its tiles being expensive look the same,
+  // so speeds and costs can only be checked together: the time
+  // predicted for each device's tiles has to match what it measured
+  const auto &assignment = balancer.nextFrame();
+  devices.render(balancer,assignment,deviceTimes,tileCosts);
+  for (int d=0;d<(int)speeds.size();d++) {
+    double predicted = 0.;
+    for (int i=assignment.begin[d];i<assignment.begin[d+1];i++)
+      predicted += balancer.getTileCost(assignment.tileIDs[i]);
+    predicted /= balancer.getDeviceSpeed(d);
+    CHECK(fabs(predicted/deviceTimes[d] - 1.) < .05);
+  }
+}
+
+void testDeterminism()
+{
+  SimulatedDevices devices{{1.,1.7,.6}};
+  DeviceTileBalancer a(3), b(3);
+  a.resize(fbSize);
+  b.resize(fbSize);
+  std::vector<double> deviceTimes, tileCosts;
+  for (int frame=0;frame<10;frame++) {
+    const auto &assignmentA = a.nextFrame();
+    const auto &assignmentB = b.nextFrame();
+    CHECK(assignmentA.tileIDs == assignmentB.tileIDs);
+    CHECK(assignmentA.begin == assignmentB.begin);
+    devices.render(a,assignmentA,deviceTimes,tileCosts);
+    a.update(deviceTimes,tileCosts);
+    b.update(deviceTimes,tileCosts);
+  }
+
+  // starting over forgets everything that was measured
+  a.resize(fbSize);
+  DeviceTileBalancer fresh(3);
+  fresh.resize(fbSize);
+  CHECK(a.nextFrame().begin == fresh.nextFrame().begin);
+}
+
+void testIdleDevice()
+{
+  DeviceTileBalancer balancer(2);
+  balancer.resize(fbSize);
+  balancer.nextFrame();
+  // device 1 didn't report anything useful: its tiles' costs stay
+  // as they are, while device 0 was twice as fast as assumed (or had
+  // cheaper tiles, same thing), so it has to get more of them
+  const double tiles0 = balancer.nextFrame().numTiles(0);
+  const double tiles1 = balancer.nextFrame().numTiles(1);
+  balancer.update({ tiles0/2., 0. });
+  CHECK(balancer.nextFrame().numTiles(0) > tiles0);
+  // ... and the same with per-tile costs
+  balancer.resize(fbSize);
+  balancer.nextFrame();
+  balancer.update({ tiles0/2., 0. },
+                  std::vector<double>(balancer.getNumTiles(),1.));
+  CHECK(balancer.getDeviceSpeed(0) > balancer.getDeviceSpeed(1));
+  CHECK(balancer.nextFrame().numTiles(0) > tiles0);
+  CHECK(balancer.nextFrame().numTiles(1) < tiles1);
+
+  bool threw = false;
+  try {
+    balancer.update({ 1. });
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  CHECK(threw);
+  threw = false;
+  try {
+    balancer.update({ 1., 1. }, { 1., 2., 3. });
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  CHECK(threw);
+}
+
+int main()
+{
+  testCoverage();
+  testConvergence({ 1., 1. },       true);
+  testConvergence({ 1., 2.5 },      true);
+  testConvergence({ 1., 1., 3. },   true);
+  testConvergence({ 1., 2.5 },      false);
+  testConvergence({ 1., .5, 2., 1.}, false);
+  testDeterminism();
+  testIdleDevice();
+  
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t20): all device tile balancer tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
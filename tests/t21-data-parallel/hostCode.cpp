@@ -0,0 +1,313 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of owl::common's data-parallel scene distribution
+// (ScenePartitioner.h and RayExchange.h): partitioning a scene's
+// groups across devices with different amounts of memory, routing
+// rays through the devices' regions, the ray queues, and - with a
+// CPU tracer standing in for the devices - that tracing the
+// distributed scene finds exactly the same closest hits as tracing
+// the whole scene at once. Does not need a GPU.
+
+#include "owl/common/parallel/ScenePartitioner.h"
+#include "owl/common/parallel/RayExchange.h"
+#include <iostream>
+#include <random>
+#include <cmath>
+
+#define OWL_TEST_NAME "t21"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+struct Sphere {
+  vec3f center;
+  float radius;
+};
+
+/*! a scene made of 'groups' (think: one GeomGroup each) of spheres
+    that are close together, scattered over a 100^3 box */
+struct Scene {
+  Scene(int numGroups, int spheresPerGroup, uint32_t seed)
+  {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> pos(0.f,100.f), offset(-3.f,3.f), radius(.2f,1.f);
+    std::uniform_int_distribution<int> count(1,2*spheresPerGroup);
+    for (int g=0;g<numGroups;g++) {
+      const vec3f center(pos(rng),pos(rng),pos(rng));
+      box3f bounds;
+      const int n = count(rng);
+      for (int i=0;i<n;i++) {
+        Sphere s{center+vec3f(offset(rng),offset(rng),offset(rng)),radius(rng)};
+        spheres.push_back(s);
+        groupOf.push_back(g);
+        bounds.extend(s.center-vec3f(s.radius));
+        bounds.extend(s.center+vec3f(s.radius));
+      }
+      groupBounds.push_back(bounds);
+      groupBytes.push_back(n*sizeof(Sphere));
+    }
+  }
+  
+  std::vector<Sphere> spheres;
+  std::vector<int>    groupOf;
+  std::vector<box3f>  groupBounds;
+  std::vector<size_t> groupBytes;
+};
+
+/*! closest hit in [ray.tmin,ray.tmax] among the given spheres */
+RoutedHit traceSpheres(const Scene &scene, const RoutedRay &ray,
+                       const std::vector<int> &sphereIDs)
+{
+  RoutedHit hit;
+  float tmax = ray.tmax;
+  for (int sphereID : sphereIDs) {
+    const Sphere &s = scene.spheres[sphereID];
+    const vec3f oc = ray.org - s.center;
+    const float a = dot(ray.dir,ray.dir);
+    const float b = dot(oc,ray.dir);
+    const float c = dot(oc,oc) - s.radius*s.radius;
+    const float disc = b*b - a*c;
+    if (disc < 0.f) continue;
+    const float sq = sqrtf(disc);
+    for (float t : { (-b-sq)/a, (-b+sq)/a })
+      if (t >= ray.tmin && t <= tmax) {
+        tmax = t;
+        hit.t = t;
+        hit.primID = sphereID;
+        break;
+      }
+  }
+  return hit;
+}
+
+std::vector<RoutedRay> makeRays(int numRays, uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> pos(-20.f,120.f), dir(-1.f,1.f);
+  std::vector<RoutedRay> rays;
+  for (int i=0;i<numRays;i++) {
+    RoutedRay ray;
+    ray.org  = vec3f(pos(rng),pos(rng),pos(rng));
+    ray.dir  = normalize(vec3f(dir(rng),dir(rng),dir(rng)));
+    ray.tmin = 0.f;
+    ray.tmax = (i % 4 == 0) ? 30.f : 1e20f;
+    rays.push_back(ray);
+  }
+  // some axis-aligned ones, too (zero direction components)
+  for (int i=0;i<100;i++)
+    rays.push_back({vec3f(-10.f,pos(rng),pos(rng)),0.f,vec3f(1.f,0.f,0.f),1e20f});
+  return rays;
+}
+
+void testPartition()
+{
+  Scene scene(500,20,0x1234);
+  // four devices, one of them with twice the memory of the others
+  const std::vector<size_t> memory = { size_t(1)<<30, size_t(2)<<30, size_t(1)<<30, size_t(1)<<30 };
+  ScenePartition partition = partitionScene(scene.groupBounds,scene.groupBytes,memory);
+  CHECK(partition.getNumDevices() == 4);
+
+  size_t totalBytes = 0;
+  for (auto b : scene.groupBytes) totalBytes += b;
+  size_t assignedBytes = 0;
+  int numPieces = 0;
+  for (int d=0;d<4;d++) {
+    const std::vector<int> pieces = partition.piecesOf(d);
+    CHECK(!pieces.empty());
+    size_t bytes = 0;
+    box3f bounds;
+    for (int g : pieces) {
+      CHECK(partition.owner[g] == d);
+      bytes += scene.groupBytes[g];
+      bounds.extend(scene.groupBounds[g]);
+    }
+    CHECK(bytes == partition.deviceBytes[d]);
+    CHECK(bounds.lower == partition.deviceBounds[d].lower);
+    CHECK(bounds.upper == partition.deviceBounds[d].upper);
+    assignedBytes += bytes;
+    numPieces += (int)pieces.size();
+
+    // each device's share matches its share of the memory, up to
+    // about one group
+    const double share = double(bytes)/double(totalBytes);
+    const double memShare = d == 1 ? .4 : .2;
+    CHECK(fabs(share-memShare) < .02);
+  }
+  CHECK(assignedBytes == totalBytes);
+  CHECK(numPieces == 500);
+
+  // regions are compact: together they're not much larger than the
+  // scene (as they would be with, say, a round-robin distribution)
+  box3f sceneBounds;
+  double sumOfVolumes = 0.;
+  for (auto &b : scene.groupBounds) sceneBounds.extend(b);
+  for (auto &b : partition.deviceBounds) sumOfVolumes += volume(b);
+  CHECK(sumOfVolumes < 1.5*volume(sceneBounds));
+
+  // deterministic
+  ScenePartition again = partitionScene(scene.groupBounds,scene.groupBytes,memory);
+  CHECK(again.owner == partition.owner);
+
+  // more devices than pieces: some devices just don't get any
+  ScenePartition sparse = partitionScene({ box3f(vec3f(0.f),vec3f(1.f)) },{ 100 },3);
+  CHECK(sparse.deviceBytes[0]+sparse.deviceBytes[1]+sparse.deviceBytes[2] == 100);
+  int numEmpty = 0;
+  for (auto &b : sparse.deviceBounds) numEmpty += b.empty();
+  CHECK(numEmpty == 2);
+
+  bool threw = false;
+  try {
+    partitionScene(scene.groupBounds,{ 1, 2, 3 },4);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  CHECK(threw);
+}
+
+void testRouting()
+{
+  // three regions in a row along x, the middle one overlapping the
+  // last one, and an empty one
+  const std::vector<box3f> regions = {
+    box3f(vec3f( 0.f,0.f,0.f),vec3f(10.f,10.f,10.f)),
+    box3f(vec3f(10.f,0.f,0.f),vec3f(22.f,10.f,10.f)),
+    box3f(),
+    box3f(vec3f(20.f,0.f,0.f),vec3f(30.f,10.f,10.f)),
+  };
+  RayRouter router(regions);
+  std::vector<RayRouter::Hop> hops;
+  
+  RoutedRay ray{vec3f(-5.f,5.f,5.f),0.f,vec3f(1.f,0.f,0.f),1e20f};
+  router.route(ray,hops);
+  CHECK(hops.size() == 3);
+  CHECK(hops[0].deviceID == 0 && hops[0].t == 5.f);
+  CHECK(hops[1].deviceID == 1 && hops[1].t == 15.f);
+  CHECK(hops[2].deviceID == 3 && hops[2].t == 25.f);
+  CHECK(router.nextHop(hops,-1,1e20f) == 0);
+  // hit in the first region: done
+  CHECK(router.nextHop(hops,0,9.f) == -1);
+  // nothing found in the first region: on to the next one
+  CHECK(router.nextHop(hops,0,1e20f) == 1);
+  // a hit in the overlap of the 2nd and 3rd region still needs the
+  // 3rd region, which may have something closer
+  CHECK(router.nextHop(hops,1,26.f) == 2);
+  CHECK(router.nextHop(hops,2,1e20f) == -1);
+
+  // backwards, starting inside the last region
+  ray = RoutedRay{vec3f(25.f,5.f,5.f),0.f,vec3f(-1.f,0.f,0.f),1e20f};
+  router.route(ray,hops);
+  CHECK(hops.size() == 3);
+  CHECK(hops[0].deviceID == 3 && hops[0].t == 0.f);
+  CHECK(hops[1].deviceID == 1 && hops[1].t == 3.f);
+  CHECK(hops[2].deviceID == 0 && hops[2].t == 15.f);
+  // (ties go by device ID)
+  ray = RoutedRay{vec3f(21.f,5.f,5.f),0.f,vec3f(-1.f,0.f,0.f),1e20f};
+  router.route(ray,hops);
+  CHECK(hops[0].deviceID == 1 && hops[0].t == 0.f);
+  CHECK(hops[1].deviceID == 3 && hops[1].t == 0.f);
+
+  // too short to reach anything, and missing everything
+  ray = RoutedRay{vec3f(-5.f,5.f,5.f),0.f,vec3f(1.f,0.f,0.f),4.f};
+  router.route(ray,hops);
+  CHECK(hops.empty());
+  ray = RoutedRay{vec3f(-5.f,50.f,5.f),0.f,vec3f(1.f,0.f,0.f),1e20f};
+  router.route(ray,hops);
+  CHECK(hops.empty());
+}
+
+void testQueues()
+{
+  RayQueues<int> queues(3);
+  CHECK(queues.empty());
+  queues.push(2,0,20);
+  queues.push(0,0,1);
+  queues.push(1,0,10);
+  queues.push(0,0,2);
+  queues.push(0,2,3);
+  CHECK(queues.empty());
+  CHECK(queues.exchange() == 5);
+  CHECK(!queues.empty());
+  CHECK(queues.inbox(0) == std::vector<int>({ 1, 2, 10, 20 }));
+  CHECK(queues.inbox(1).empty());
+  CHECK(queues.inbox(2) == std::vector<int>({ 3 }));
+  CHECK(queues.exchange() == 0);
+  CHECK(queues.empty());
+}
+
+void testTracing(int numDevices)
+{
+  Scene scene(300,10,0x4567+numDevices);
+  ScenePartition partition
+    = partitionScene(scene.groupBounds,scene.groupBytes,numDevices);
+
+  // what each 'device' holds: only the spheres of its groups
+  std::vector<std::vector<int>> deviceSpheres(numDevices);
+  for (int i=0;i<(int)scene.spheres.size();i++)
+    deviceSpheres[partition.owner[scene.groupOf[i]]].push_back(i);
+  std::vector<int> allSpheres(scene.spheres.size());
+  for (int i=0;i<(int)allSpheres.size();i++) allSpheres[i] = i;
+
+  const std::vector<RoutedRay> rays = makeRays(20000,0x89ab);
+  RayRouter router(partition.deviceBounds);
+  std::vector<RoutedHit> hits;
+  RayExchangeStats stats;
+  traceDataParallel(router,rays,hits,
+                    [&](int deviceID,
+                        const std::vector<QueuedRay> &queue,
+                        std::vector<RoutedHit> &local) {
+                      CHECK(local.size() == queue.size());
+                      for (size_t i=0;i<queue.size();i++)
+                        local[i] = traceSpheres(scene,queue[i].ray,
+                                                deviceSpheres[deviceID]);
+                    },
+                    &stats);
+  CHECK(hits.size() == rays.size());
+
+  int numHits = 0;
+  for (size_t i=0;i<rays.size();i++) {
+    const RoutedHit reference = traceSpheres(scene,rays[i],allSpheres);
+    CHECK(hits[i].primID == reference.primID);
+    if (reference.hit()) {
+      numHits++;
+      CHECK(hits[i].t == reference.t);
+      CHECK(hits[i].deviceID == partition.owner[scene.groupOf[reference.primID]]);
+    }
+  }
+  // (make sure this actually tested something)
+  CHECK(numHits > 1000);
+  // rays only visit the devices they have to, not all of them
+  CHECK(stats.numRayTraces < rays.size()*numDevices);
+  CHECK(stats.numRounds <= size_t(numDevices));
+  std::cout << "#owl.test(t21): " << numDevices << " devices: "
+            << numHits << " hits for " << rays.size() << " rays, "
+            << stats.numRayTraces << " ray traces in "
+            << stats.numRounds << " rounds" << std::endl;
+}
+
+int main()
+{
+  testPartition();
+  testRouting();
+  testQueues();
+  for (int numDevices : { 1, 2, 3, 8 })
+    testTracing(numDevices);
+  
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t21): all data parallel tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
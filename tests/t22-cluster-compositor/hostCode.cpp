@@ -0,0 +1,404 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of the samples' cluster library (owlCluster/): the
+// tile codec, parameter deltas, both transports, and that frames
+// rendered by multiple workers - threads over local connections in
+// sort-first mode, and forked processes over unix sockets (with
+// shared memory for large messages) in sort-last mode - come out
+// exactly as if rendered by a single process. CPU renderers stand
+// in for OWL, so this does not need a GPU.
+
+#include "owlCluster/Cluster.h"
+#include <iostream>
+#include <random>
+#include <thread>
+#include <cmath>
+
+#define OWL_TEST_NAME "t22"
+#include "../owlTestCheck.h"
+#ifndef _WIN32
+# include <sys/socket.h>
+# include <sys/un.h>
+# include <sys/wait.h>
+# include <unistd.h>
+#endif
+
+using namespace owl;
+using namespace owl::cluster;
+
+inline uint32_t hash(uint32_t x)
+{
+  x ^= x >> 16; x *= 0x7feb352d;
+  x ^= x >> 15; x *= 0x846ca68b;
+  x ^= x >> 16;
+  return x;
+}
+
+// ------------------------------------------------------------------
+// sort-first: a procedural image, part flat (compressible) and part
+// noise; "seed" changes it every frame
+// ------------------------------------------------------------------
+
+uint32_t imagePixel(const vec2i &pixel, uint32_t seed)
+{
+  if (pixel.x < pixel.y) return 0xff000000u | seed;
+  return hash(pixel.x*7919u + pixel.y*104729u + seed);
+}
+
+void renderImageTile(const RenderJob &job, const box2i &tile,
+                     uint32_t *color, float *depth)
+{
+  CHECK(job.mode == COMPOSITE_SORT_FIRST);
+  CHECK(depth == nullptr);
+  const uint32_t seed = job.params.get<uint32_t>("seed");
+  const vec2i size = tile.size();
+  for (int iy=0;iy<size.y;iy++)
+    for (int ix=0;ix<size.x;ix++)
+      color[iy*size.x+ix] = imagePixel(tile.lower+vec2i(ix,iy),seed);
+}
+
+// ------------------------------------------------------------------
+// sort-last: spheres seen from above (orthographic, looking down -z),
+// each worker has every numWorkers'th one
+// ------------------------------------------------------------------
+
+struct Sphere {
+  vec3f center;
+  float radius;
+};
+
+std::vector<Sphere> makeSpheres(int numSpheres, const vec2i &fbSize)
+{
+  std::mt19937 rng(0x1234);
+  std::uniform_real_distribution<float> x(0.f,float(fbSize.x)), y(0.f,float(fbSize.y));
+  std::uniform_real_distribution<float> z(0.f,100.f), r(4.f,30.f);
+  std::vector<Sphere> spheres;
+  for (int i=0;i<numSpheres;i++)
+    spheres.push_back({vec3f(x(rng),y(rng),z(rng)),r(rng)});
+  // two that are at exactly the same depth, overlapping, and owned
+  // by different workers: the lower-ranked one has to win
+  spheres[0] = { vec3f(40.f,40.f,200.f), 20.f };
+  spheres[1] = { vec3f(50.f,40.f,200.f), 20.f };
+  return spheres;
+}
+
+/*! closest hit (as depth below z=1000) of the pixel's ray with the
+    spheres owned by 'workerID' (or all of them, for workerID -1) */
+void traceSpheres(const std::vector<Sphere> &spheres,
+                  int workerID, int numWorkers,
+                  const vec2i &pixel, uint32_t &color, float &depth)
+{
+  const vec2f p(pixel.x+.5f,pixel.y+.5f);
+  depth = INFINITY;
+  color = 0xff202020u;
+  int hitOwner = numWorkers;
+  for (int i=0;i<(int)spheres.size();i++) {
+    const int owner = i % numWorkers;
+    if (workerID >= 0 && owner != workerID) continue;
+    const Sphere &s = spheres[i];
+    const vec2f d = p-vec2f(s.center.x,s.center.y);
+    const float h2 = s.radius*s.radius - dot(d,d);
+    if (h2 < 0.f) continue;
+    const float t = 1000.f - (s.center.z + sqrtf(h2));
+    if (t < depth || (t == depth && owner < hitOwner)) {
+      depth = t;
+      hitOwner = owner;
+      color = 0xff000000u | (hash(i) & 0xffffff);
+    }
+  }
+}
+
+struct SphereRenderer {
+  void operator()(const RenderJob &job, const box2i &tile,
+                  uint32_t *color, float *depth) const
+  {
+    CHECK(job.mode == COMPOSITE_SORT_LAST);
+    CHECK(depth != nullptr);
+    const int numSpheres = job.params.get<int>("numSpheres");
+    if ((int)spheres.size() != numSpheres)
+      spheres = makeSpheres(numSpheres,job.fbSize);
+    const vec2i size = tile.size();
+    for (int iy=0;iy<size.y;iy++)
+      for (int ix=0;ix<size.x;ix++)
+        traceSpheres(spheres,job.workerID,job.numWorkers,
+                     tile.lower+vec2i(ix,iy),
+                     color[iy*size.x+ix],depth[iy*size.x+ix]);
+  }
+  mutable std::vector<Sphere> spheres;
+};
+
+// ------------------------------------------------------------------
+
+void testCodec()
+{
+  std::mt19937 rng(42);
+  for (int pass=0;pass<200;pass++) {
+    const size_t n = pass < 5 ? pass : rng() % 5000;
+    std::vector<uint32_t> words(n);
+    // mix of noise, and runs of all lengths
+    for (size_t i=0;i<n;) {
+      const uint32_t word = rng() % 4;
+      size_t len = rng() % 2 ? 1 : 1+rng() % 300;
+      for (;len && i<n;len--) words[i++] = word;
+    }
+    std::vector<uint8_t> packed;
+    compressWords(words.data(),n,packed);
+    std::vector<uint32_t> unpacked(n,0xdeadbeef);
+    decompressWords(packed.data(),packed.size(),unpacked.data(),n);
+    CHECK(unpacked == words);
+    // never much worse than raw
+    CHECK(packed.size() <= n*4 + n/8 + 8);
+
+    if (!packed.empty()) {
+      bool threw = false;
+      try {
+        decompressWords(packed.data(),packed.size()-1,unpacked.data(),n);
+      } catch (const std::runtime_error &) { threw = true; }
+      CHECK(threw);
+    }
+  }
+  // a flat tile is just a few bytes
+  std::vector<uint32_t> flat(64*64,0xff336699u);
+  std::vector<uint8_t> packed;
+  compressWords(flat.data(),flat.size(),packed);
+  CHECK(packed.size() < 16);
+}
+
+void testParamSet()
+{
+  ParamSet a, b;
+  a.set("camera",vec3f(1.f,2.f,3.f));
+  a.set("frame",int(7));
+  std::vector<float> big(1000,1.f);
+  a.set("big",big.data(),big.size()*sizeof(float));
+
+  MessageWriter full;
+  a.writeDelta(full,ParamSet());
+  MessageReader in(full.data);
+  b.applyDelta(in);
+  CHECK(in.atEnd());
+  CHECK(b.values == a.values);
+  CHECK(b.get<vec3f>("camera") == vec3f(1.f,2.f,3.f));
+
+  // only what changed goes out again
+  ParamSet c = a;
+  c.set("frame",int(8));
+  MessageWriter delta;
+  c.writeDelta(delta,a);
+  CHECK(delta.data.size() < 64);
+  MessageReader deltaIn(delta.data);
+  b.applyDelta(deltaIn);
+  CHECK(b.get<int>("frame") == 8);
+  CHECK(b.values == c.values);
+
+  bool threw = false;
+  try { b.get<double>("frame"); } catch (const std::runtime_error &) { threw = true; }
+  CHECK(threw);
+}
+
+void testConnection(Connection::SP a, Connection::SP b)
+{
+  std::vector<std::vector<uint8_t>> messages;
+  for (size_t size : { size_t(0), size_t(1), size_t(100), size_t(5000), size_t(3<<20) }) {
+    std::vector<uint8_t> m(size);
+    for (size_t i=0;i<size;i++) m[i] = uint8_t(hash(uint32_t(i+size)));
+    messages.push_back(m);
+  }
+  // send from another thread, so large inline messages can't block
+  std::thread sender([&](){
+      for (auto &m : messages) a->send(m);
+      a->close();
+    });
+  std::vector<uint8_t> m;
+  for (auto &expected : messages) {
+    CHECK(b->recv(m));
+    CHECK(m == expected);
+  }
+  CHECK(!b->recv(m));
+  sender.join();
+  // and back the other way
+  b->send(messages[2]);
+  CHECK(a->recv(m));
+  CHECK(m == messages[2]);
+}
+
+void testSortFirstLocal()
+{
+  const int numWorkers = 3;
+  std::vector<Connection::SP> toWorkers;
+  std::vector<std::thread> threads;
+  for (int i=0;i<numWorkers;i++) {
+    auto pair = createLocalConnectionPair();
+    toWorkers.push_back(pair.first);
+    Connection::SP toLead = pair.second;
+    threads.push_back(std::thread([toLead](){
+          ClusterWorker(toLead,renderImageTile).run();
+        }));
+  }
+  ClusterLead::Config config;
+  config.tileSize = vec2i(32,16);
+  {
+    ClusterLead lead(toWorkers,config);
+    const vec2i fbSize(200,150);
+    std::vector<float> big(10000,1.f);
+    ParamSet params;
+    params.set("big",big.data(),big.size()*sizeof(float));
+    size_t firstSent = 0;
+    for (int frame=0;frame<5;frame++) {
+      params.set("seed",uint32_t(frame*17));
+      std::vector<uint32_t> color;
+      const FrameStats stats = lead.renderFrame(params,fbSize,color);
+      CHECK(stats.frameID == frame);
+      CHECK(color.size() == size_t(fbSize.x)*fbSize.y);
+      for (int y=0;y<fbSize.y;y++)
+        for (int x=0;x<fbSize.x;x++)
+          CHECK(color[y*fbSize.x+x] == imagePixel(vec2i(x,y),frame*17));
+      CHECK(stats.numTiles == 7*10);
+      CHECK(stats.bytesUncompressed == color.size()*sizeof(uint32_t));
+      CHECK(stats.compressionRatio() > 1.3);
+      CHECK((int)stats.workerRenderTime.size() == numWorkers);
+      CHECK(stats.latency > 0. && stats.throughput() > 0.);
+      // the big parameter only gets sent once
+      if (frame == 0) firstSent = stats.bytesSent;
+      else CHECK(stats.bytesSent < firstSent/10);
+      std::cout << "#owl.test(t22): sort-first " << stats << std::endl;
+    }
+  }
+  for (auto &thread : threads) thread.join();
+}
+
+#ifndef _WIN32
+void testSortLastProcesses()
+{
+  const int numWorkers = 3;
+  const std::string path = "/tmp/owl-t22-"+std::to_string(getpid())+".sock";
+  // small enough that every tile goes through shared memory
+  const size_t shmThreshold = 1024;
+  std::vector<pid_t> children;
+  {
+    UnixSocketListener listener(path,shmThreshold);
+    for (int i=0;i<numWorkers;i++) {
+      const pid_t pid = fork();
+      CHECK(pid >= 0);
+      if (pid == 0) {
+        try {
+          ClusterWorker(connectUnixSocket(path,10.,shmThreshold),SphereRenderer()).run();
+        } catch (const std::exception &e) {
+          std::cerr << "#owl.test(t22): worker failed: " << e.what() << std::endl;
+          _exit(1);
+        }
+        _exit(0);
+      }
+      children.push_back(pid);
+    }
+    
+    std::vector<Connection::SP> toWorkers;
+    for (int i=0;i<numWorkers;i++)
+      toWorkers.push_back(listener.accept());
+    
+    ClusterLead::Config config;
+    config.mode = COMPOSITE_SORT_LAST;
+    config.tileSize = vec2i(48,40);
+    ClusterLead lead(toWorkers,config);
+    const vec2i fbSize(160,120);
+    ParamSet params;
+    for (int numSpheres : { 50, 50, 200 }) {
+      params.set("numSpheres",numSpheres);
+      std::vector<uint32_t> color;
+      const FrameStats stats = lead.renderFrame(params,fbSize,color);
+      const std::vector<Sphere> spheres = makeSpheres(numSpheres,fbSize);
+      for (int y=0;y<fbSize.y;y++)
+        for (int x=0;x<fbSize.x;x++) {
+          uint32_t expected; float depth;
+          traceSpheres(spheres,-1,numWorkers,vec2i(x,y),expected,depth);
+          CHECK(color[y*fbSize.x+x] == expected);
+        }
+      // every worker renders every tile
+      CHECK(stats.numTiles == numWorkers*4*3);
+      CHECK(stats.bytesUncompressed == numWorkers*color.size()*8);
+      std::cout << "#owl.test(t22): sort-last " << stats << std::endl;
+    }
+    // shutting down the lead ends the workers
+  }
+  for (auto pid : children) {
+    int status = 0;
+    CHECK(waitpid(pid,&status,0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+}
+
+void testUnixSocket()
+{
+  const std::string path = "/tmp/owl-t22-"+std::to_string(getpid())+"-raw.sock";
+  UnixSocketListener listener(path,4096);
+  Connection::SP a = connectUnixSocket(path,10.,4096);
+  Connection::SP b = listener.accept();
+  testConnection(a,b);
+}
+
+/*! a peer announcing an absurd message size must fail the
+    connection, not have us allocate it */
+void testOversizedMessage()
+{
+  const std::string path = "/tmp/owl-t22-"+std::to_string(getpid())+"-big.sock";
+  UnixSocketListener listener(path,4096);
+  int fd = ::socket(AF_UNIX,SOCK_STREAM,0);
+  CHECK(fd >= 0);
+  struct sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path,path.c_str(),sizeof(addr.sun_path)-1);
+  CHECK(::connect(fd,(struct sockaddr *)&addr,sizeof(addr)) == 0);
+  Connection::SP b = listener.accept();
+  // size, inSharedMemory, pad
+  const uint64_t header[2] = { ~0ull, 0 };
+  CHECK(::send(fd,header,sizeof(header),0) == sizeof(header));
+  std::vector<uint8_t> message;
+  bool threw = false;
+  try { b->recv(message); } catch (const std::runtime_error &) { threw = true; }
+  CHECK(threw);
+  ::close(fd);
+}
+
+void testTcpSocket()
+{
+  TcpListener listener;
+  CHECK(listener.port > 0);
+  Connection::SP a = connectTcp("localhost",listener.port);
+  Connection::SP b = listener.accept();
+  testConnection(a,b);
+}
+#endif
+
+int main()
+{
+#ifndef _WIN32
+  // fork before anything starts threads
+  testSortLastProcesses();
+  testUnixSocket();
+  testOversizedMessage();
+  testTcpSocket();
+#endif
+  testCodec();
+  testParamSet();
+  auto pair = createLocalConnectionPair();
+  testConnection(pair.first,pair.second);
+  testSortFirstLocal();
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t22): all cluster compositor tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
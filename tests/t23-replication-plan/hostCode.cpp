@@ -0,0 +1,241 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of owl::common's ReplicationPlan.h: plans for
+// synthetic multi-GPU topologies (NVLink meshes, PCIe islands without
+// peer access between them, no peer access at all, random ones) have
+// to reach every device exactly once, in a valid order, within the
+// fanout limit, with one host upload per island - and be faster than
+// uploading to every device from the host. Does not need a GPU.
+
+#include "owl/common/parallel/ReplicationPlan.h"
+#include <iostream>
+#include <random>
+
+#define OWL_TEST_NAME "t23"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+const size_t MB = size_t(1) << 20;
+
+/*! checks everything a plan has to satisfy, whatever the topology */
+void checkValid(const ReplicationPlan &plan, const DeviceTopology &topology,
+                const ReplicationPlan::Config &config)
+{
+  const int n = topology.numDevices();
+  CHECK(plan.numDevices() == n);
+  CHECK((int)plan.order.size() == n);
+  std::vector<int> position(n,-1);
+  for (int i=0;i<n;i++) {
+    const int d = plan.order[i];
+    CHECK(d >= 0 && d < n);
+    CHECK(position[d] == -1);
+    position[d] = i;
+  }
+  std::vector<int> fanout(n,0);
+  for (int d=0;d<n;d++) {
+    const int src = plan.source[d];
+    if (src < 0) {
+      CHECK(plan.depth[d] == 1);
+      CHECK(topology.hostBandwidth[d] > 0.);
+      continue;
+    }
+    CHECK(src != d);
+    CHECK(position[src] < position[d]);
+    CHECK(topology.peer(src,d) > 0.);
+    CHECK(plan.depth[d] == plan.depth[src]+1);
+    fanout[src]++;
+  }
+  for (int d=0;d<n;d++)
+    CHECK(fanout[d] <= config.maxFanout);
+}
+
+/*! number of groups of devices connected by (symmetric) peer
+    links */
+int numIslands(const DeviceTopology &topology)
+{
+  const int n = topology.numDevices();
+  std::vector<int> island(n,-1);
+  int count = 0;
+  for (int d=0;d<n;d++) {
+    if (island[d] >= 0) continue;
+    std::vector<int> stack = { d };
+    island[d] = count;
+    while (!stack.empty()) {
+      const int u = stack.back(); stack.pop_back();
+      for (int v=0;v<n;v++)
+        if (island[v] < 0 && topology.peer(u,v) > 0.) {
+          island[v] = count;
+          stack.push_back(v);
+        }
+    }
+    count++;
+  }
+  return count;
+}
+
+/*! DGX-1 style hybrid cube mesh: two fully NVLink-connected quads,
+    plus links from each GPU to its counterpart in the other quad;
+    everything else goes over PCIe */
+DeviceTopology hybridCubeMesh()
+{
+  DeviceTopology t(8,12.,8.);
+  for (int i=0;i<8;i++)
+    for (int j=0;j<8;j++) {
+      if (i == j) t.peer(i,j) = 0.;
+      else if (i/4 == j/4 || i%4 == j%4) t.peer(i,j) = 48.;
+    }
+  // GPU 5 sits on the host bridge, so it's the closest to the host
+  t.hostBandwidth[5] = 13.;
+  return t;
+}
+
+void testHybridCubeMesh()
+{
+  const DeviceTopology topology = hybridCubeMesh();
+  ReplicationPlan::Config config;
+  const ReplicationPlan plan = planReplication(topology,config);
+  checkValid(plan,topology,config);
+  CHECK(plan.numHostUploads() == 1);
+  CHECK(plan.source[5] == -1);
+  // only NVLink edges get used
+  for (int d=0;d<8;d++)
+    if (plan.source[d] >= 0) CHECK(topology.peer(plan.source[d],d) == 48.);
+  // binary tree of 8 devices
+  CHECK(*std::max_element(plan.depth.begin(),plan.depth.end()) <= 4);
+
+  const size_t bytes = 2048*MB;
+  const double tPlan = plan.estimateTime(topology,bytes);
+  const double tHost = hostUploadPlan(8,config.chunkSize).estimateTime(topology,bytes);
+  const double tOnce = bytes/13.;
+  std::cout << "#owl.test(t23): hybrid cube mesh, 2GB: host uploads " << tHost/tOnce
+            << "x a single upload, replication " << tPlan/tOnce << "x" << std::endl;
+  // close to a single upload, and far better than eight
+  CHECK(tPlan < 1.05*tOnce);
+  CHECK(tPlan < tHost/7.);
+  
+  // wider fanout is allowed, never required
+  ReplicationPlan::Config wide;
+  wide.maxFanout = 7;
+  const ReplicationPlan flat = planReplication(topology,wide);
+  checkValid(flat,topology,wide);
+  CHECK(flat.numHostUploads() == 1);
+}
+
+void testIslands()
+{
+  // two PCIe switches with four GPUs each: peer access within a
+  // switch, none across
+  DeviceTopology topology(8,10.,0.);
+  for (int i=0;i<8;i++)
+    for (int j=0;j<8;j++)
+      if (i != j && i/4 == j/4) topology.peer(i,j) = 10.;
+  ReplicationPlan::Config config;
+  const ReplicationPlan plan = planReplication(topology,config);
+  checkValid(plan,topology,config);
+  CHECK(plan.numHostUploads() == 2);
+  CHECK(plan.source[0] == -1 || plan.source[0]/4 == 0);
+  for (int d=0;d<8;d++)
+    if (plan.source[d] >= 0) CHECK(plan.source[d]/4 == d/4);
+  const size_t bytes = 512*MB;
+  CHECK(plan.estimateTime(topology,bytes)
+        < .3*hostUploadPlan(8).estimateTime(topology,bytes));
+}
+
+void testNoPeers()
+{
+  DeviceTopology topology(4,10.,0.);
+  const ReplicationPlan plan = planReplication(topology);
+  checkValid(plan,topology,ReplicationPlan::Config());
+  CHECK(plan.numHostUploads() == 4);
+  CHECK(plan.estimateTime(topology,100*MB)
+        == hostUploadPlan(4).estimateTime(topology,100*MB));
+
+  // and the trivial cases
+  const ReplicationPlan one = planReplication(DeviceTopology(1,10.));
+  CHECK(one.numHostUploads() == 1 && one.order.size() == 1);
+  const ReplicationPlan none = planReplication(DeviceTopology(0));
+  CHECK(none.order.empty());
+  CHECK(none.estimateTime(DeviceTopology(0),MB) == 0.);
+}
+
+void testChunks()
+{
+  DeviceTopology topology(2,10.,10.);
+  topology.peer(0,0) = topology.peer(1,1) = 0.;
+  ReplicationPlan::Config config;
+  config.chunkSize = MB;
+  const ReplicationPlan plan = planReplication(topology,config);
+  CHECK(plan.numChunks(0) == 0);
+  CHECK(plan.numChunks(1) == 1);
+  CHECK(plan.numChunks(MB) == 1);
+  CHECK(plan.numChunks(MB+1) == 2);
+  // pipelined: the second device trails by just one chunk
+  const double t = plan.estimateTime(topology,64*MB);
+  CHECK(fabs(t - (64*MB+MB)/10.) < 1e-6*t);
+  // odd sizes: the last chunk is partial
+  const double tOdd = plan.estimateTime(topology,64*MB+5);
+  CHECK(tOdd > t && tOdd < t + 1.);
+}
+
+void testRandom()
+{
+  std::mt19937 rng(23);
+  std::uniform_real_distribution<double> bw(.5,2.);
+  for (int pass=0;pass<500;pass++) {
+    const int n = 1+rng()%16;
+    DeviceTopology topology(n);
+    for (int d=0;d<n;d++) topology.hostBandwidth[d] = bw(rng);
+    const double density = (rng()%5)/4.;
+    // every other pass, peer links are all faster than the host's
+    const double peerScale = pass%2 ? 1. : 2.;
+    for (int i=0;i<n;i++)
+      for (int j=0;j<i;j++)
+        if (std::uniform_real_distribution<double>(0.,1.)(rng) < density)
+          topology.peer(i,j) = topology.peer(j,i) = peerScale*bw(rng);
+    ReplicationPlan::Config config;
+    config.maxFanout = pass%2 ? 1+rng()%4 : 16;
+    config.chunkSize = MB;
+    const ReplicationPlan plan = planReplication(topology,config);
+    checkValid(plan,topology,config);
+    // at least one upload per island (more if the fanout limit keeps
+    // a tree from reaching all of its island, or a peer link is
+    // slower than another upload)
+    CHECK(plan.numHostUploads() >= numIslands(topology));
+    if (!(pass%2))
+      CHECK(plan.numHostUploads() == numIslands(topology));
+    const size_t bytes = 64*MB;
+    CHECK(plan.estimateTime(topology,bytes)
+          <= hostUploadPlan(n,MB).estimateTime(topology,bytes)*(1.+1e-9));
+    // deterministic
+    const ReplicationPlan again = planReplication(topology,config);
+    CHECK(again.source == plan.source && again.order == plan.order);
+  }
+}
+
+int main()
+{
+  testHybridCubeMesh();
+  testIslands();
+  testNoPeers();
+  testChunks();
+  testRandom();
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t23): all replication plan tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
@@ -0,0 +1,213 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of owl::common's motion key math (motion.h): key
+// lookup and interpolation for any number of keys, that more keys
+// follow a rotation's arc more closely, that motion bounds contain
+// every interpolated position (for transforms and objects that both
+// move, with different numbers of keys), and how tight they are; plus
+// per-key vertex bounds the way triangle meshes with N keys compute
+// them (GeomBoundsBatch). Does not need a GPU.
+
+#include "owl/common/math/motion.h"
+#include "owl/GeomBoundsBatch.h"
+#include <iostream>
+#include <random>
+
+#define OWL_TEST_NAME "t24"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+inline float volume(const box3f &b)
+{ const vec3f s = b.size(); return s.x*s.y*s.z; }
+
+inline bool contains(const box3f &b, const vec3f &p, float eps = 1e-5f)
+{
+  return p.x >= b.lower.x-eps && p.y >= b.lower.y-eps && p.z >= b.lower.z-eps
+    &&   p.x <= b.upper.x+eps && p.y <= b.upper.y+eps && p.z <= b.upper.z+eps;
+}
+
+/*! 'numKeys' keys of a rotation about z by 'angle' (over t=0..1), and
+    a translation along x */
+std::vector<affine3f> rotationKeys(int numKeys, float angle, float shift)
+{
+  std::vector<affine3f> keys;
+  for (int k=0;k<numKeys;k++) {
+    const float t = motionKeyTime(k,numKeys);
+    keys.push_back(affine3f::translate(vec3f(shift*t,0.f,0.f))
+                   * affine3f::rotate(vec3f(0.f,0.f,1.f),angle*t));
+  }
+  return keys;
+}
+
+void testKeyLookup()
+{
+  float frac;
+  CHECK(motionKeySegment(1,.5f,frac) == 0 && frac == 0.f);
+  CHECK(motionKeySegment(2,.25f,frac) == 0 && frac == .25f);
+  CHECK(motionKeySegment(5,0.f,frac) == 0 && frac == 0.f);
+  CHECK(motionKeySegment(5,.25f,frac) == 1 && frac == 0.f);
+  CHECK(motionKeySegment(5,.375f,frac) == 1 && fabsf(frac-.5f) < 1e-6f);
+  // the last key is the end of the last segment, not a segment of its own
+  CHECK(motionKeySegment(5,1.f,frac) == 3 && frac == 1.f);
+  // clamped
+  CHECK(motionKeySegment(5,-1.f,frac) == 0 && frac == 0.f);
+  CHECK(motionKeySegment(5,2.f,frac) == 3 && frac == 1.f);
+  CHECK(motionKeyTime(0,1) == 0.f);
+  CHECK(motionKeyTime(2,5) == .5f);
+  
+  std::vector<vec3f> keys = { vec3f(0.f), vec3f(1.f,0.f,0.f), vec3f(1.f,2.f,0.f) };
+  for (int k=0;k<3;k++)
+    CHECK(interpolateMotionKeys(keys.data(),3,motionKeyTime(k,3)) == keys[k]);
+  CHECK(interpolateMotionKeys(keys.data(),3,.75f) == vec3f(1.f,1.f,0.f));
+  CHECK(interpolateMotionKeys(keys.data(),1,.75f) == keys[0]);
+
+  const std::vector<affine3f> xfms = rotationKeys(3,2.f,4.f);
+  const affine3f mid = interpolateMotionKeys(xfms.data(),3,.5f);
+  CHECK(length(mid.p-xfms[1].p) < 1e-6f);
+  CHECK(length(mid.l.vx-xfms[1].l.vx) < 1e-6f);
+}
+
+/*! more keys follow a rotation's arc (which linear interpolation
+    between matrices cuts short) more closely */
+void testArcs()
+{
+  const float angle = float(M_PI);
+  const vec3f p(1.f,0.f,0.f);
+  float lastError = 2.f;
+  for (int numKeys : { 2, 3, 5, 9, 17 }) {
+    const std::vector<affine3f> keys = rotationKeys(numKeys,angle,0.f);
+    float maxError = 0.f;
+    for (int i=0;i<=1000;i++) {
+      const float t = i/1000.f;
+      const vec3f interpolated = xfmPoint(interpolateMotionKeys(keys.data(),numKeys,t),p);
+      const vec3f exact(cosf(angle*t),sinf(angle*t),0.f);
+      maxError = std::max(maxError,length(interpolated-exact));
+    }
+    std::cout << "#owl.test(t24): half turn with " << numKeys
+              << " keys: max distance from the arc " << maxError << std::endl;
+    CHECK(maxError < lastError);
+    lastError = maxError;
+  }
+  CHECK(lastError < .01f);
+}
+
+void testMotionBounds()
+{
+  std::mt19937 rng(24);
+  std::uniform_real_distribution<float> u(-1.f,1.f);
+  for (int numXfmKeys : { 1, 2, 3, 5, 9 })
+    for (int numBoundsKeys : { 1, 2, 4 }) {
+      const std::vector<affine3f> xfms = rotationKeys(numXfmKeys,2.5f,3.f);
+      // an object that moves (and grows) on its own, as a set of
+      // points per key, with per-key bounds
+      const int numPoints = 64;
+      std::vector<std::vector<vec3f>> points(numBoundsKeys);
+      std::vector<box3f> keyBounds(numBoundsKeys);
+      for (int i=0;i<numPoints;i++) {
+        const vec3f p(u(rng),u(rng),u(rng));
+        for (int k=0;k<numBoundsKeys;k++) {
+          const vec3f q = p*(1.f+k) + vec3f(2.f*k,-1.f*k,.5f*k);
+          points[k].push_back(q);
+          keyBounds[k].extend(q);
+        }
+      }
+      box3f sampled;
+      for (int step=0;step<=2000;step++) {
+        const float t = step/2000.f;
+        const affine3f xfm = interpolateMotionKeys(xfms.data(),numXfmKeys,t);
+        float frac;
+        const int k = motionKeySegment(numBoundsKeys,t,frac);
+        for (int i=0;i<numPoints;i++) {
+          const vec3f p = numBoundsKeys < 2
+            ? points[0][i]
+            : motionLerp(points[k][i],points[k+1][i],frac);
+          sampled.extend(xfmPoint(xfm,p));
+        }
+      }
+      float lastVolume = INFINITY;
+      for (int numSubSteps : { 1, 4, 16 }) {
+        const box3f bounds = motionBounds(xfms.data(),numXfmKeys,
+                                          keyBounds.data(),numBoundsKeys,
+                                          numSubSteps);
+        CHECK(contains(bounds,sampled.lower) && contains(bounds,sampled.upper));
+        CHECK(volume(bounds) <= lastVolume*(1.f+1e-5f));
+        lastVolume = volume(bounds);
+      }
+      if (numXfmKeys >= 5)
+        // rotation per key interval is small enough for tight bounds
+        CHECK(lastVolume < 1.6f*volume(sampled));
+    }
+
+  // static: same as transforming the box's corners
+  const affine3f xfm = rotationKeys(2,.7f,1.f)[1];
+  const box3f box(vec3f(-1.f,0.f,2.f),vec3f(1.f,3.f,2.5f));
+  const box3f a = motionBounds(&xfm,1,&box,1);
+  const box3f b = xfmBounds(xfm,box);
+  CHECK(length(a.lower-b.lower) < 1e-5f && length(a.upper-b.upper) < 1e-5f);
+  CHECK(motionBounds(&xfm,1,&box,0).empty());
+}
+
+void testVertexKeyBounds()
+{
+  // a mesh with 5 keys of vertices: once as one single-key bounds
+  // job per key, and once as TrianglesGeom does it, two keys per job
+  // (plus a single-key one for the odd last key)
+  const int numKeys = 5, numVertices = 10000;
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> u(0.f,1.f);
+  std::vector<std::vector<vec3f>> keys(numKeys);
+  std::vector<box3f> expected(numKeys);
+  for (int k=0;k<numKeys;k++)
+    for (int i=0;i<numVertices;i++) {
+      keys[k].push_back(vec3f(u(rng),u(rng),u(rng))+vec3f(float(k)));
+      expected[k].extend(keys[k].back());
+    }
+  owl::GeomBoundsBatch batch;
+  for (int k=0;k<numKeys;k++)
+    batch.addVertices(keys[k].data(),nullptr,numVertices,sizeof(vec3f),0);
+  std::vector<box3f> results(2*batch.numJobs());
+  batch.computeOnHost(results.data());
+  for (int k=0;k<numKeys;k++) {
+    CHECK(results[2*k] == expected[k]);
+    CHECK(results[2*k+1] == expected[k]);
+  }
+
+  owl::GeomBoundsBatch paired;
+  for (int k=0;k<numKeys;k+=2)
+    paired.addVertices(keys[k].data(),k+1<numKeys ? keys[k+1].data() : nullptr,
+                       numVertices,sizeof(vec3f),0);
+  CHECK(paired.numJobs() == (numKeys+1)/2);
+  std::vector<box3f> pairedResults(2*paired.numJobs());
+  paired.computeOnHost(pairedResults.data());
+  // key k's bounds are box k
+  for (int k=0;k<numKeys;k++)
+    CHECK(pairedResults[k] == expected[k]);
+  CHECK(pairedResults[numKeys] == expected[numKeys-1]);
+}
+
+int main()
+{
+  testKeyLookup();
+  testArcs();
+  testMotionBounds();
+  testVertexKeyBounds();
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t24): all motion key tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
@@ -0,0 +1,208 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of SRT motion transforms (SRTTransform.h): that
+// decomposing an affine3f into an SRT and converting back gives the
+// same transform, that interpolating SRT keys keeps rotating objects
+// rigid (where interpolating matrices shrinks them), and that SRT
+// motion bounds contain every sampled position. Does not need a GPU.
+
+#include "owl/common/math/SRTTransform.h"
+#include <iostream>
+#include <random>
+
+#define OWL_TEST_NAME "t25"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+std::mt19937 rng(25);
+std::uniform_real_distribution<float> uniform(-1.f,1.f);
+
+inline vec3f randomVec() { return vec3f(uniform(rng),uniform(rng),uniform(rng)); }
+inline vec3f randomDir()
+{
+  vec3f v;
+  do { v = randomVec(); } while (dot(v,v) > 1.f || dot(v,v) < 1e-3f);
+  return normalize(v);
+}
+
+inline float volume(const box3f &b)
+{ const vec3f s = b.size(); return s.x*s.y*s.z; }
+
+inline bool contains(const box3f &b, const box3f &inner, float eps = 1e-4f)
+{
+  return inner.lower.x >= b.lower.x-eps && inner.upper.x <= b.upper.x+eps
+    &&   inner.lower.y >= b.lower.y-eps && inner.upper.y <= b.upper.y+eps
+    &&   inner.lower.z >= b.lower.z-eps && inner.upper.z <= b.upper.z+eps;
+}
+
+inline float maxDifference(const affine3f &a, const affine3f &b)
+{
+  return max(max(length(a.l.vx-b.l.vx),length(a.l.vy-b.l.vy)),
+             max(length(a.l.vz-b.l.vz),length(a.p-b.p)));
+}
+
+void testDecomposition()
+{
+  for (int i=0;i<1000;i++) {
+    // rotation * scale * shear, sometimes mirrored, sometimes flat
+    linear3f l = linear3f(Quaternion3f::rotate(randomDir(),3.f*uniform(rng)))
+      * linear3f::scale(vec3f(.1f)+2.f*abs(randomVec()));
+    if (i % 3 == 0) l = l * linear3f(vec3f(1.f,0.f,0.f),
+                                     vec3f(uniform(rng),1.f,0.f),
+                                     vec3f(uniform(rng),uniform(rng),1.f));
+    if (i % 5 == 0) l.vz = -l.vz;
+    if (i % 7 == 0) l.vy = 2.f*l.vx;
+    if (i % 11 == 0) l.vx = vec3f(0.f);
+    const affine3f xfm(l,3.f*randomVec());
+    const vec3f center = randomVec();
+    const SRTTransform srt = decomposeSRT(xfm,center);
+    CHECK(fabsf(dot(srt.rotation,srt.rotation)-1.f) < 1e-5f);
+    CHECK(srt.scale.x >= 0.f && srt.scale.y >= 0.f);
+    CHECK(maxDifference(toAffine(srt),xfm) < 1e-4f);
+    // the center is what the rotation and scale are about
+    CHECK(length(srt.translation-xfmPoint(xfm,center)) < 1e-5f);
+    CHECK(length(srt.scaleShear()*center+srt.pivot) < 1e-5f);
+  }
+  // rigid transforms have no scale or shear
+  for (int i=0;i<100;i++) {
+    const affine3f xfm(linear3f(Quaternion3f::rotate(randomDir(),3.f*uniform(rng))),
+                       randomVec());
+    const SRTTransform srt = decomposeSRT(xfm);
+    CHECK(length(srt.scale-vec3f(1.f)) < 1e-5f);
+    CHECK(length(srt.shear) < 1e-5f);
+    CHECK(length(srt.pivot) == 0.f);
+  }
+}
+
+/*! two keys of a rigid rotation by 'angle' about 'axis', plus a
+    translation; matrix interpolation shrinks the object halfway, SRT
+    interpolation keeps it rigid and on the rotation's arc */
+void testInterpolation()
+{
+  for (float angle : { .5f, 1.5f, 2.5f, 3.f }) {
+    const vec3f axis = randomDir();
+    const affine3f xfm0(linear3f(1.f),vec3f(0.f));
+    const affine3f xfm1(linear3f::rotate(axis,angle),vec3f(1.f,2.f,3.f));
+    SRTTransform keys[2] = { decomposeSRT(xfm0), decomposeSRT(xfm1) };
+    alignSRTRotations(keys,2);
+    CHECK(dot(keys[0].rotation,keys[1].rotation) >= 0.f);
+
+    const affine3f lerped = motionLerp(xfm0,xfm1,.5f);
+    const affine3f srt    = toAffine(motionLerp(keys[0],keys[1],.5f));
+    const vec3f v = anyPerpendicular(axis);
+    const float matrixLength = length(xfmVector(lerped,v));
+    const float srtLength    = length(xfmVector(srt,v));
+    std::cout << "#owl.test(t25): rotation by " << angle
+              << ": length halfway is " << matrixLength
+              << " with matrix keys, " << srtLength << " with SRT keys"
+              << std::endl;
+    CHECK(fabsf(srtLength-1.f) < 1e-5f);
+    CHECK(matrixLength < cosf(.5f*angle)+1e-5f);
+    // by symmetry, halfway of the rotation is exactly half the angle
+    CHECK(maxDifference(srt,affine3f(linear3f::rotate(axis,.5f*angle),
+                                     vec3f(.5f,1.f,1.5f))) < 1e-5f);
+    // rotations that go the long way still stay rigid
+    SRTTransform longWay = keys[1];
+    longWay.rotation = -longWay.rotation;
+    for (int i=0;i<=10;i++) {
+      const affine3f xfm = toAffine(motionLerp(keys[0],longWay,i/10.f));
+      CHECK(fabsf(length(xfmVector(xfm,v))-1.f) < 1e-5f);
+    }
+  }
+}
+
+/*! random SRT keys - with scale, shear, pivots, and rotations of up
+    to (and sometimes more than) half a turn between keys - on
+    objects that move along their own keys; every sampled position
+    has to be inside the motion bounds */
+void testBounds()
+{
+  for (int iter=0;iter<200;iter++) {
+    const int numKeys = 2+iter%4;
+    const int numBoundsKeys = 1+iter%3;
+    std::vector<SRTTransform> keys(numKeys);
+    const vec3f axis = randomDir();
+    for (int k=0;k<numKeys;k++) {
+      const vec3f center = randomVec();
+      affine3f xfm = affine3f(linear3f::rotate(iter%2 ? axis : randomDir(),
+                                               1.5f*iter/200.f*k*3.f),
+                              2.f*randomVec());
+      if (iter % 3 == 0) xfm.l = xfm.l*linear3f::scale(vec3f(.5f)+abs(randomVec()));
+      if (iter % 5 == 0) xfm.l.vz += .5f*xfm.l.vx;
+      keys[k] = decomposeSRT(xfm,center);
+    }
+    if (iter % 4 != 0) alignSRTRotations(keys.data(),numKeys);
+    std::vector<box3f> boundsKeys(numBoundsKeys);
+    for (auto &b : boundsKeys) {
+      b.extend(randomVec());
+      b.extend(randomVec()+vec3f(.2f));
+    }
+
+    box3f sampled;
+    for (int step=0;step<=2000;step++) {
+      const float t = step/2000.f;
+      const affine3f xfm = toAffine(interpolateMotionKeys(keys.data(),numKeys,t));
+      const box3f b = interpolateMotionKeys(boundsKeys.data(),numBoundsKeys,t);
+      sampled.extend(xfmBounds(xfm,b));
+    }
+    float lastVolume = INFINITY;
+    for (int numSubSteps : { 1, 4, 16 }) {
+      const box3f bounds = motionBounds(keys.data(),numKeys,
+                                        boundsKeys.data(),numBoundsKeys,
+                                        numSubSteps);
+      CHECK(contains(bounds,sampled));
+      CHECK(volume(bounds) <= lastVolume*(1.f+1e-4f));
+      lastVolume = volume(bounds);
+    }
+    // shear gets bounded by interval arithmetic before rotating,
+    // which doesn't get any tighter with more sub-steps
+    CHECK(lastVolume < (iter % 5 == 0 ? 2.f : 1.6f)*volume(sampled));
+  }
+  
+  // a box spinning by a full turn about its own center, in five
+  // keys: SRT bounds have to cover the cylinder it sweeps, and not
+  // much more (bounds of the same keys as matrices are smaller,
+  // since with those the box really does shrink in between keys)
+  const box3f box(vec3f(-1.f),vec3f(1.f));
+  std::vector<SRTTransform> srtKeys;
+  std::vector<affine3f>     xfmKeys;
+  for (int k=0;k<5;k++) {
+    xfmKeys.push_back(affine3f(linear3f::rotate(vec3f(0.f,0.f,1.f),k*1.5707964f),
+                               vec3f(0.f)));
+    srtKeys.push_back(decomposeSRT(xfmKeys.back()));
+  }
+  alignSRTRotations(srtKeys.data(),5);
+  const box3f srtBounds = motionBounds(srtKeys.data(),5,&box,1,4);
+  const box3f xfmBounds = motionBounds(xfmKeys.data(),5,&box,1,4);
+  std::cout << "#owl.test(t25): spinning box: SRT bounds " << srtBounds
+            << ", matrix bounds " << xfmBounds << std::endl;
+  CHECK(contains(srtBounds,box3f(vec3f(-sqrtf(2.f),-sqrtf(2.f),-1.f),
+                                 vec3f(+sqrtf(2.f),+sqrtf(2.f),+1.f))));
+  CHECK(srtBounds.upper.x < 1.5f && srtBounds.upper.z < 1.f+1e-5f);
+}
+
+int main()
+{
+  testDecomposition();
+  testInterpolation();
+  testBounds();
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t25): all SRT motion tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
@@ -0,0 +1,296 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of triangle mesh preprocessing
+// (owl/common/geometry/triangleMeshPreprocessing.h), on a grid of
+// quads the way DCC exports tend to look: every quad with its own
+// (slightly jittered) copies of its vertices, some degenerate
+// triangles, and everything in random order. Checks that welding,
+// clean-up and re-ordering keep the surface the same, that the remap
+// tables are consistent, that results don't depend on the number of
+// threads, and reports throughput. Does not need a GPU.
+
+#include "owl/common/geometry/triangleMeshPreprocessing.h"
+#include <iostream>
+#include <random>
+#include <algorithm>
+
+#define OWL_TEST_NAME "t26"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+struct Mesh {
+  std::vector<vec3f> vertices;
+  std::vector<vec3i> indices;
+  /*! per-vertex attribute, to check permuting them with the remap
+      tables: the vertex's grid coordinates */
+  std::vector<vec2i> gridCoords;
+  int numDegenerates = 0;
+};
+
+/*! n x n quads, each with its own four vertices, jittered by up to
+    'jitter'; plus some degenerate triangles; triangles shuffled */
+Mesh makeSoup(int n, float jitter, int seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> u(-jitter,jitter);
+  Mesh mesh;
+  auto vertex = [&](int x, int y) {
+    mesh.vertices.push_back(vec3f(float(x)+u(rng),float(y)+u(rng),
+                                  .1f*sinf(float(x+y))));
+    mesh.gridCoords.push_back(vec2i(x,y));
+    return int(mesh.vertices.size()-1);
+  };
+  for (int y=0;y<n;y++)
+    for (int x=0;x<n;x++) {
+      const int v00 = vertex(x,y),   v10 = vertex(x+1,y);
+      const int v01 = vertex(x,y+1), v11 = vertex(x+1,y+1);
+      mesh.indices.push_back(vec3i(v00,v10,v11));
+      mesh.indices.push_back(vec3i(v00,v11,v01));
+      if ((x+y) % 17 == 0) {
+        // one triangle that uses a vertex twice, one without area
+        mesh.indices.push_back(vec3i(v00,v10,v00));
+        const int a = vertex(x,y), b = vertex(x,y), c = vertex(x,y);
+        mesh.vertices[a] = vec3f(x+.25f,y+.5f,1.f);
+        mesh.vertices[b] = vec3f(x+.5f,y+.5f,1.f);
+        mesh.vertices[c] = vec3f(x+.75f,y+.5f,1.f);
+        mesh.indices.push_back(vec3i(a,b,c));
+        mesh.numDegenerates += 2;
+      }
+    }
+  std::shuffle(mesh.indices.begin(),mesh.indices.end(),rng);
+  return mesh;
+}
+
+/*! average distance between the centroids of subsequent triangles */
+float centroidStep(const std::vector<vec3f> &v, const std::vector<vec3i> &idx)
+{
+  double sum = 0.;
+  for (size_t i=1;i<idx.size();i++) {
+    const vec3f c0 = (v[idx[i-1].x]+v[idx[i-1].y]+v[idx[i-1].z])/3.f;
+    const vec3f c1 = (v[idx[i].x]+v[idx[i].y]+v[idx[i].z])/3.f;
+    sum += length(c1-c0);
+  }
+  return float(sum/(idx.size()-1));
+}
+
+/*! checks everything that has to hold for any config */
+void checkConsistency(const Mesh &in,
+                      const std::vector<std::vector<vec3f>> &inKeys,
+                      const TriangleMeshPreprocessResult &out,
+                      float tolerance)
+{
+  const uint32_t invalid = TriangleMeshPreprocessResult::invalidIndex;
+  CHECK(out.vertices.size() == inKeys.size());
+  CHECK(out.newToOldTriangle.size() == out.indices.size());
+  CHECK(out.oldToNewVertex.size() == in.vertices.size());
+  std::vector<int> used(out.newToOldVertex.size(),0);
+  for (size_t i=0;i<out.indices.size();i++) {
+    const vec3i t   = out.indices[i];
+    const vec3i old = in.indices[out.newToOldTriangle[i]];
+    for (int c=0;c<3;c++) {
+      CHECK(t[c] >= 0 && t[c] < (int)out.newToOldVertex.size());
+      used[t[c]] = 1;
+      // each corner got merged into a vertex close to where it was
+      CHECK(out.oldToNewVertex[old[c]] == uint32_t(t[c]));
+      for (size_t k=0;k<inKeys.size();k++) {
+        CHECK(out.vertices[k][t[c]] == inKeys[k][out.newToOldVertex[t[c]]]);
+        // welding chains can merge vertices up to a few tolerances apart
+        const vec3f d = abs(out.vertices[k][t[c]]-inKeys[k][old[c]]);
+        CHECK(reduce_max(d) <= 4.f*max(tolerance,0.f));
+      }
+    }
+    CHECK(t.x != t.y && t.y != t.z && t.x != t.z);
+  }
+  // no unused vertices
+  for (auto u : used) CHECK(u);
+  for (size_t i=0;i<out.newToOldVertex.size();i++)
+    CHECK(out.oldToNewVertex[out.newToOldVertex[i]] == uint32_t(i));
+  for (auto v : out.oldToNewVertex)
+    CHECK(v == invalid || v < out.newToOldVertex.size());
+}
+
+void testWelding()
+{
+  const int n = 64;
+  const float jitter = 1e-4f, tolerance = 1e-3f;
+  const Mesh in = makeSoup(n,jitter,1);
+  const std::vector<StridedVec3fs> keys = { in.vertices };
+  const size_t numRealTriangles = 2*n*n;
+  CHECK(in.indices.size() == numRealTriangles+in.numDegenerates);
+
+  TriangleMeshPreprocessConfig config;
+  config.weldTolerance = tolerance;
+  const TriangleMeshPreprocessResult out
+    = preprocessTriangleMesh(keys,in.indices,config);
+  std::cout << "#owl.test(t26): welded " << in.vertices.size() << " vertices into "
+            << out.newToOldVertex.size() << ", " << in.indices.size()
+            << " triangles down to " << out.indices.size() << std::endl;
+  CHECK(out.newToOldVertex.size() == size_t((n+1)*(n+1)));
+  CHECK(out.indices.size() == numRealTriangles);
+  checkConsistency(in,{ in.vertices },out,tolerance);
+
+  // attributes get permuted along: every output vertex has a unique
+  // grid position
+  const std::vector<vec2i> coords = applyRemap(in.gridCoords.data(),out.newToOldVertex);
+  std::vector<int> seen((n+1)*(n+1),0);
+  for (auto c : coords) seen[c.y*(n+1)+c.x]++;
+  for (auto s : seen) CHECK(s == 1);
+
+  // exact welding doesn't merge the jittered copies (but still gets
+  // rid of the vertices only used by degenerate triangles)
+  config.weldTolerance = 0.f;
+  const TriangleMeshPreprocessResult exact
+    = preprocessTriangleMesh(keys,in.indices,config);
+  checkConsistency(in,{ in.vertices },exact,0.f);
+  CHECK(exact.newToOldVertex.size() > out.newToOldVertex.size());
+  
+  // exact duplicates do get merged exactly
+  std::vector<vec3f> snapped = in.vertices;
+  for (auto &v : snapped) v = vec3f(roundf(v.x),roundf(v.y),v.z);
+  const TriangleMeshPreprocessResult snappedOut
+    = preprocessTriangleMesh({ snapped },in.indices,config);
+  CHECK(snappedOut.newToOldVertex.size() == size_t((n+1)*(n+1)));
+
+  // no welding, no clean-up: only unused vertices go
+  config.weldTolerance = -1.f;
+  config.removeDegenerates = false;
+  const TriangleMeshPreprocessResult none
+    = preprocessTriangleMesh(keys,in.indices,config);
+  CHECK(none.indices.size() == in.indices.size());
+  CHECK(none.newToOldVertex.size() == in.vertices.size());
+}
+
+/*! vertices only get welded if they're close in every motion key */
+void testMotionKeys()
+{
+  const int n = 16;
+  const Mesh in = makeSoup(n,0.f,2);
+  std::vector<vec3f> key1 = in.vertices;
+  // in the second key, the copies of the left half's vertices drift apart
+  for (size_t i=0;i<key1.size();i++)
+    if (in.gridCoords[i].x < n/2)
+      key1[i] += vec3f(0.f,0.f,.01f*float(i%4));
+  TriangleMeshPreprocessConfig config;
+  config.weldTolerance = 1e-3f;
+  const TriangleMeshPreprocessResult out
+    = preprocessTriangleMesh({ in.vertices, key1 },in.indices,config);
+  checkConsistency(in,{ in.vertices, key1 },out,config.weldTolerance);
+  const TriangleMeshPreprocessResult staticOut
+    = preprocessTriangleMesh({ in.vertices },in.indices,config);
+  CHECK(out.newToOldVertex.size() > staticOut.newToOldVertex.size());
+  // right half (and the column where the halves meet) still welds
+  CHECK(out.newToOldVertex.size() < in.vertices.size()/2+(n+1)*(n+1));
+}
+
+void testReorder()
+{
+  const int n = 256;
+  const Mesh in = makeSoup(n,1e-4f,3);
+  TriangleMeshPreprocessConfig config;
+  config.weldTolerance = 1e-3f;
+  config.reorder = false;
+  const TriangleMeshPreprocessResult unordered
+    = preprocessTriangleMesh({ in.vertices },in.indices,config);
+  config.reorder = true;
+  const TriangleMeshPreprocessResult ordered
+    = preprocessTriangleMesh({ in.vertices },in.indices,config);
+  checkConsistency(in,{ in.vertices },ordered,config.weldTolerance);
+  CHECK(ordered.indices.size() == unordered.indices.size());
+
+  const float before = centroidStep(unordered.vertices[0],unordered.indices);
+  const float after  = centroidStep(ordered.vertices[0],ordered.indices);
+  // and vertex fetches, going through the triangles in order: misses
+  // in a small LRU cache of 64-byte lines
+  auto missRate = [](const std::vector<vec3i> &idx) {
+    std::vector<size_t> cache;
+    size_t numMisses = 0;
+    for (auto t : idx)
+      for (int c=0;c<3;c++) {
+        const size_t line = t[c]*sizeof(vec3f)/64;
+        auto it = std::find(cache.begin(),cache.end(),line);
+        if (it == cache.end()) {
+          numMisses++;
+          if (cache.size() == 32) cache.pop_back();
+        } else
+          cache.erase(it);
+        cache.insert(cache.begin(),line);
+      }
+    return numMisses/(3.f*idx.size());
+  };
+  std::cout << "#owl.test(t26): avg. distance between subsequent triangles "
+            << before << " -> " << after
+            << ", vertex fetch miss rate " << missRate(unordered.indices)
+            << " -> " << missRate(ordered.indices) << std::endl;
+  CHECK(after < .1f*before);
+  CHECK(missRate(ordered.indices) < .2f*missRate(unordered.indices));
+
+  // same results no matter how many threads
+  setNumThreads(1);
+  const TriangleMeshPreprocessResult serial
+    = preprocessTriangleMesh({ in.vertices },in.indices,config);
+  setNumThreads(0);
+  CHECK(serial.indices == ordered.indices);
+  CHECK(serial.newToOldVertex == ordered.newToOldVertex);
+  CHECK(serial.newToOldTriangle == ordered.newToOldTriangle);
+}
+
+void testStrips()
+{
+  const uint32_t restart = uint32_t(-1);
+  // two strips, the second one with a stitching (degenerate) triangle;
+  // (8,9,10) is that strip's fourth triangle, so it gets flipped
+  const std::vector<uint32_t> strip
+    = { 0,1,2,3,4,5, restart, 6,7,8,8,9,10 };
+  const std::vector<vec3i> list
+    = triangleStripToList(strip.data(),strip.size(),restart);
+  const std::vector<vec3i> expected
+    = { vec3i(0,1,2), vec3i(2,1,3), vec3i(2,3,4), vec3i(4,3,5),
+        vec3i(6,7,8), vec3i(9,8,10) };
+  CHECK(list == expected);
+  CHECK(triangleStripToList(strip.data(),2,restart).empty());
+}
+
+void testThroughput()
+{
+  const int n = 512;
+  const Mesh in = makeSoup(n,1e-4f,4);
+  TriangleMeshPreprocessConfig config;
+  config.weldTolerance = 1e-3f;
+  const double t0 = getCurrentTime();
+  const TriangleMeshPreprocessResult out
+    = preprocessTriangleMesh({ in.vertices },in.indices,config);
+  const double t1 = getCurrentTime();
+  CHECK(out.indices.size() == size_t(2*n*n));
+  std::cout << "#owl.test(t26): preprocessed " << prettyNumber(in.indices.size())
+            << " triangles in " << prettyDouble(t1-t0) << "s ("
+            << prettyDouble(in.indices.size()/(t1-t0)) << " triangles/s, "
+            << getNumThreads() << " threads)" << std::endl;
+}
+
+int main()
+{
+  testWelding();
+  testMotionKeys();
+  testReorder();
+  testStrips();
+  testThroughput();
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t26): all mesh preprocessing tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
@@ -0,0 +1,405 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of curve preprocessing
+// (owl/common/geometry/curvePreprocessing.h), on strands of curly
+// fur: coarse cubic b-splines along helices. Checks that basis
+// conversions don't change the curves, that splitting keeps them the
+// same while meeting the configured limits, that results don't
+// depend on the number of threads, and reports how much the summed
+// volume of the segments' bounding boxes goes down, and throughput.
+// Does not need a GPU.
+
+#include "owl/common/geometry/curvePreprocessing.h"
+#include <iostream>
+#include <random>
+#include <algorithm>
+
+#define OWL_TEST_NAME "t27"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+using namespace owl::common::curvePreprocessing;
+
+const CurveBasis allBases[] = {
+  CURVE_BASIS_LINEAR, CURVE_BASIS_QUADRATIC_BSPLINE, CURVE_BASIS_CUBIC_BSPLINE,
+  CURVE_BASIS_CATMULL_ROM, CURVE_BASIS_CUBIC_BEZIER
+};
+
+/*! reference evaluation, straight from each basis' basis functions */
+vec4f evaluate(CurveBasis basis, const vec4f *p, float t)
+{
+  const float s = 1.f-t, t2 = t*t, t3 = t2*t;
+  switch (basis) {
+  case CURVE_BASIS_LINEAR:
+    return s*p[0] + t*p[1];
+  case CURVE_BASIS_QUADRATIC_BSPLINE:
+    return (.5f*s*s)*p[0] + (.5f+t-t2)*p[1] + (.5f*t2)*p[2];
+  case CURVE_BASIS_CUBIC_BSPLINE:
+    return (1.f/6.f)*((s*s*s)*p[0] + (3.f*t3-6.f*t2+4.f)*p[1]
+                      + (-3.f*t3+3.f*t2+3.f*t+1.f)*p[2] + t3*p[3]);
+  case CURVE_BASIS_CATMULL_ROM:
+    return .5f*((-t3+2.f*t2-t)*p[0] + (3.f*t3-5.f*t2+2.f)*p[1]
+                + (-3.f*t3+4.f*t2+t)*p[2] + (t3-t2)*p[3]);
+  default:
+    return (s*s*s)*p[0] + (3.f*s*s*t)*p[1] + (3.f*s*t2)*p[2] + t3*p[3];
+  }
+}
+
+struct Curves {
+  CurveBasis basis;
+  std::vector<vec3f>    points;
+  std::vector<float>    widths;
+  std::vector<uint32_t> indices;
+
+  vec4f controlPoint(size_t i) const { return vec4f(points[i],widths[i]); }
+  vec4f evaluate(size_t segID, float t) const
+  {
+    vec4f p[4];
+    for (int i=0;i<curveBasisNumControlPoints(basis);i++)
+      p[i] = controlPoint(indices[segID]+i);
+    return ::evaluate(basis,p,t);
+  }
+};
+
+Curves run(const Curves &in, const CurvePreprocessConfig &_config,
+           CurvePreprocessResult *_result = nullptr)
+{
+  CurvePreprocessConfig config = _config;
+  config.inputBasis = in.basis;
+  CurvePreprocessResult result
+    = preprocessCurves({ in.points },{ in.widths },in.indices,config);
+  CHECK(result.controlPoints.size() == 1);
+  CHECK(result.widths.size() == 1);
+  CHECK(result.newToOldSegment.size() == result.segmentIndices.size());
+  Curves out;
+  out.basis   = config.outputBasis;
+  out.points  = result.controlPoints[0];
+  out.widths  = result.widths[0];
+  out.indices = result.segmentIndices;
+  if (_result) *_result = std::move(result);
+  return out;
+}
+
+/*! curly fur: 'numStrands' helices next to each other, each with
+    'numPoints' control points, 'pointsPerTurn' of those per turn */
+Curves makeFur(int numStrands, int numPoints, float pointsPerTurn,
+               CurveBasis basis, int seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> u(0.f,1.f);
+  Curves fur;
+  fur.basis = basis;
+  std::vector<uint32_t> strandSizes;
+  const int side = int(ceilf(sqrtf(float(numStrands))));
+  for (int s=0;s<numStrands;s++) {
+    const vec3f root(float(s % side),float(s / side),0.f);
+    const float phase = 2.f*float(M_PI)*u(rng);
+    const float radius = .3f+.2f*u(rng);
+    for (int i=0;i<numPoints;i++) {
+      const float angle = phase + 2.f*float(M_PI)*i/pointsPerTurn;
+      fur.points.push_back(root+vec3f(radius*cosf(angle),radius*sinf(angle),
+                                      .1f*i));
+      // slightly tapered towards the tip
+      fur.widths.push_back(.02f*(1.f-.5f*i/numPoints));
+    }
+    strandSizes.push_back(numPoints);
+  }
+  fur.indices = curveSegmentIndices(strandSizes.data(),numStrands,basis);
+  return fur;
+}
+
+CurvePreprocessConfig noSplitting()
+{
+  CurvePreprocessConfig config;
+  config.maxTurnAngle     = 0.f;
+  config.maxWidthRatio    = 0.f;
+  config.maxLengthToWidth = 0.f;
+  return config;
+}
+
+double sumOfBoundsVolumes(const Curves &curves)
+{
+  double sum = 0.;
+  for (auto index : curves.indices)
+    sum += curveSegmentBounds(curves.points,curves.widths,index,curves.basis).volume();
+  return sum;
+}
+
+float distance(const vec4f &a, const vec4f &b)
+{
+  return length(vec3f(a.x-b.x,a.y-b.y,a.z-b.z)) + fabsf(a.w-b.w);
+}
+
+/*! every conversion to a basis of at least the same degree describes
+    the same curve, including the widths */
+void testConversions()
+{
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> u(-1.f,1.f);
+  for (auto inBasis : allBases)
+    for (auto outBasis : allBases) {
+      if (curveBasisNumControlPoints(outBasis) < curveBasisNumControlPoints(inBasis))
+        continue;
+      Curves in;
+      in.basis = inBasis;
+      for (int i=0;i<curveBasisNumControlPoints(inBasis);i++) {
+        in.points.push_back(vec3f(u(rng),u(rng),u(rng)));
+        in.widths.push_back(.1f+.01f*u(rng));
+      }
+      in.indices = { 0 };
+      CurvePreprocessConfig config = noSplitting();
+      config.outputBasis = outBasis;
+      const Curves out = run(in,config);
+      CHECK(out.indices.size() == 1);
+      CHECK(out.points.size() == size_t(curveBasisNumControlPoints(outBasis)));
+      for (int i=0;i<=16;i++) {
+        const float t = i/16.f;
+        CHECK(distance(in.evaluate(0,t),out.evaluate(0,t)) < 1e-5f);
+      }
+    }
+
+  // lower degrees can only approximate, but still go through the
+  // end points
+  Curves in = makeFur(1,4,4.f,CURVE_BASIS_CUBIC_BSPLINE,0);
+  for (auto outBasis : { CURVE_BASIS_LINEAR, CURVE_BASIS_QUADRATIC_BSPLINE }) {
+    CurvePreprocessConfig config = noSplitting();
+    config.outputBasis = outBasis;
+    const Curves out = run(in,config);
+    CHECK(distance(in.evaluate(0,0.f),out.evaluate(0,0.f)) < 1e-5f);
+    CHECK(distance(in.evaluate(0,1.f),out.evaluate(0,1.f)) < 1e-5f);
+  }
+}
+
+/*! segments that don't need anything done get copied as they are,
+    sharing control points the same way as before */
+void testPassThrough()
+{
+  for (auto basis : allBases) {
+    Curves in = makeFur(16,13,1000.f,basis,1);
+    CurvePreprocessConfig config;
+    config.outputBasis = basis;
+    config.maxWidthRatio = 4.f;
+    CurvePreprocessResult result;
+    const Curves out = run(in,config,&result);
+    CHECK(out.points  == in.points);
+    CHECK(out.widths  == in.widths);
+    CHECK(out.indices == in.indices);
+    for (size_t i=0;i<result.newToOldSegment.size();i++)
+      CHECK(result.newToOldSegment[i] == i);
+  }
+}
+
+/*! curly strands get split until every piece turns by at most the
+    configured angle, without changing the curve */
+void testSplitting()
+{
+  const Curves in = makeFur(64,16,4.f,CURVE_BASIS_CUBIC_BSPLINE,2);
+  CurvePreprocessConfig config;
+  config.maxTurnAngle = .5f;
+  config.maxSplitDepth = 8;
+  CurvePreprocessResult result;
+  const Curves out = run(in,config,&result);
+  CHECK(out.indices.size() >= 4*in.indices.size());
+
+  size_t piece = 0;
+  for (size_t seg=0;seg<in.indices.size();seg++) {
+    size_t end = piece;
+    while (end < out.indices.size() && result.newToOldSegment[end] == seg) end++;
+    CHECK(end > piece);
+    // pieces are contiguous, and start and end where the segment does
+    CHECK(distance(out.evaluate(piece,0.f),in.evaluate(seg,0.f)) < 1e-4f);
+    CHECK(distance(out.evaluate(end-1,1.f),in.evaluate(seg,1.f)) < 1e-4f);
+    for (size_t i=piece;i+1<end;i++)
+      CHECK(distance(out.evaluate(i,1.f),out.evaluate(i+1,0.f)) < 1e-4f);
+    // pieces are on the original curve
+    for (size_t i=piece;i<end;i++) {
+      const vec4f mid = out.evaluate(i,.37f);
+      float closest = 1e30f;
+      for (int j=0;j<=4096;j++)
+        closest = min(closest,distance(mid,in.evaluate(seg,j/4096.f)));
+      CHECK(closest < 1e-3f);
+      // and don't turn too much
+      vec4f p[4], b[4];
+      for (int j=0;j<4;j++) p[j] = out.controlPoint(out.indices[i]+j);
+      toBezier(CURVE_BASIS_CUBIC_BSPLINE,p,b);
+      CHECK(!needsSplit(b,1.f,config));
+    }
+    piece = end;
+  }
+  CHECK(piece == out.indices.size());
+
+  // how much tighter do boxes get?
+  const double before = sumOfBoundsVolumes(in);
+  const double after  = sumOfBoundsVolumes(out);
+  std::cout << "#owl.test(t27): curly fur, turn angle split: "
+            << in.indices.size() << " -> " << out.indices.size()
+            << " segments, sum of box volumes "
+            << before << " -> " << after
+            << " (" << (before/after) << "x smaller)" << std::endl;
+  CHECK(after < .25*before);
+
+  // long straight-ish strands, split by length to width
+  const Curves straight = makeFur(64,16,64.f,CURVE_BASIS_CUBIC_BSPLINE,3);
+  config.maxLengthToWidth = 4.f;
+  const Curves split = run(straight,config);
+  const double straightBefore = sumOfBoundsVolumes(straight);
+  const double straightAfter  = sumOfBoundsVolumes(split);
+  std::cout << "#owl.test(t27): straight fur, length to width split: "
+            << straight.indices.size() << " -> " << split.indices.size()
+            << " segments, sum of box volumes "
+            << straightBefore << " -> " << straightAfter
+            << " (" << (straightBefore/straightAfter) << "x smaller)" << std::endl;
+  CHECK(straightAfter < .5*straightBefore);
+}
+
+/*! converting to linear tessellates: all points are on the curve,
+    and there's more of them where it turns */
+void testTessellation()
+{
+  const Curves in = makeFur(4,16,4.f,CURVE_BASIS_CATMULL_ROM,4);
+  CurvePreprocessConfig config;
+  config.outputBasis  = CURVE_BASIS_LINEAR;
+  config.maxTurnAngle = .2f;
+  config.maxSplitDepth = 8;
+  CurvePreprocessResult result;
+  const Curves out = run(in,config,&result);
+  CHECK(out.indices.size() > 8*in.indices.size());
+  // neighboring pieces share their end points
+  CHECK(out.points.size() == out.indices.size()+in.indices.size());
+  for (size_t i=0;i<out.indices.size();i++) {
+    const vec4f p = out.controlPoint(out.indices[i]);
+    float closest = 1e30f;
+    const uint32_t seg = result.newToOldSegment[i];
+    for (int j=0;j<=4096;j++)
+      closest = min(closest,distance(p,in.evaluate(seg,j/4096.f)));
+    CHECK(closest < 1e-3f);
+  }
+}
+
+/*! a strand tapering to zero width gets split where the width changes
+    most, but not down to the maximum depth at its tip */
+void testWidthRatio()
+{
+  Curves in;
+  in.basis = CURVE_BASIS_LINEAR;
+  in.points = { vec3f(0.f), vec3f(1.f,0.f,0.f) };
+  in.widths = { .1f, 0.f };
+  in.indices = { 0 };
+  CurvePreprocessConfig config;
+  config.maxWidthRatio = 2.f;
+  config.maxSplitDepth = 16;
+  const Curves out = run(in,config);
+  CHECK(out.indices.size() > 2);
+  CHECK(out.indices.size() <= 8);
+  for (size_t i=0;i+1<out.indices.size();i++) {
+    const float w0 = out.widths[out.indices[i]], w1 = out.widths[out.indices[i]+1];
+    CHECK(w0 <= 2.f*w1 + 1e-6f);
+  }
+}
+
+/*! all motion keys get split the same way, as much as the one that
+    needs it most */
+void testMotionKeys()
+{
+  const Curves curly    = makeFur(8,16,4.f,CURVE_BASIS_CUBIC_BSPLINE,5);
+  const Curves straight = makeFur(8,16,1000.f,CURVE_BASIS_CUBIC_BSPLINE,5);
+  CurvePreprocessConfig config;
+  const CurvePreprocessResult curlyOnly
+    = preprocessCurves({ curly.points },{ curly.widths },curly.indices,config);
+  const CurvePreprocessResult both
+    = preprocessCurves({ straight.points, curly.points },{ curly.widths },
+                       curly.indices,config);
+  CHECK(both.controlPoints.size() == 2);
+  CHECK(both.widths.size() == 1);
+  CHECK(both.controlPoints[0].size() == both.controlPoints[1].size());
+  CHECK(both.segmentIndices == curlyOnly.segmentIndices);
+  CHECK(both.controlPoints[1] == curlyOnly.controlPoints[0]);
+
+  // mismatching keys, and bad indices
+  bool threw = false;
+  try {
+    preprocessCurves({ curly.points },{ curly.widths, curly.widths },
+                     curly.indices,config);
+  } catch (const std::runtime_error &) { threw = true; }
+  CHECK(threw);
+  std::vector<uint32_t> badIndices = curly.indices;
+  badIndices.back() = uint32_t(curly.points.size()-2);
+  threw = false;
+  try {
+    preprocessCurves({ curly.points },{ curly.widths },badIndices,config);
+  } catch (const std::runtime_error &) { threw = true; }
+  CHECK(threw);
+}
+
+void testSegmentIndices()
+{
+  const uint32_t sizes[] = { 4, 1, 7 };
+  CHECK(curveSegmentIndices(sizes,3,CURVE_BASIS_LINEAR)
+        == std::vector<uint32_t>({ 0,1,2, 5,6,7,8,9,10 }));
+  CHECK(curveSegmentIndices(sizes,3,CURVE_BASIS_CUBIC_BSPLINE)
+        == std::vector<uint32_t>({ 0, 5,6,7,8 }));
+  CHECK(curveSegmentIndices(sizes,3,CURVE_BASIS_CUBIC_BEZIER)
+        == std::vector<uint32_t>({ 0, 5,8 }));
+}
+
+void testDeterminism()
+{
+  const Curves in = makeFur(256,32,5.f,CURVE_BASIS_CUBIC_BSPLINE,6);
+  CurvePreprocessConfig config;
+  config.maxLengthToWidth = 8.f;
+  setNumThreads(1);
+  const Curves serial = run(in,config);
+  setNumThreads(4);
+  const Curves parallel = run(in,config);
+  setNumThreads(0);
+  CHECK(serial.points  == parallel.points);
+  CHECK(serial.widths  == parallel.widths);
+  CHECK(serial.indices == parallel.indices);
+}
+
+void testThroughput()
+{
+  const Curves in = makeFur(64*1024,16,6.f,CURVE_BASIS_CUBIC_BSPLINE,7);
+  CurvePreprocessConfig config;
+  config.inputBasis = in.basis;
+  const double t0 = getCurrentTime();
+  const CurvePreprocessResult out
+    = preprocessCurves({ in.points },{ in.widths },in.indices,config);
+  const double t1 = getCurrentTime();
+  std::cout << "#owl.test(t27): preprocessed " << prettyNumber(in.indices.size())
+            << " segments (into " << prettyNumber(out.segmentIndices.size())
+            << ") in " << prettyDouble(t1-t0) << "s ("
+            << prettyDouble(in.indices.size()/(t1-t0)) << " segments/s, "
+            << getNumThreads() << " threads)" << std::endl;
+}
+
+int main()
+{
+  testConversions();
+  testPassThrough();
+  testSplitting();
+  testTessellation();
+  testWidthRatio();
+  testMotionKeys();
+  testSegmentIndices();
+  testDeterminism();
+  testThroughput();
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t27): all curve preprocessing tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}
@@ -0,0 +1,259 @@
+// ======================================================================== //
+// Copyright 2019-2021 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// Host-only test of sphere levels of detail
+// (owl/common/geometry/sphereClustering.h), on a t01-style cube of
+// spheres and on random clusters of points: checks that every level's
+// spheres enclose the input spheres they stand for (and are about as
+// large as their octree cells), that levels get selected by cell
+// size and by budget as expected, that results don't depend on the
+// number of threads, and reports throughput. Does not need a GPU.
+
+#include "owl/common/geometry/sphereClustering.h"
+#include <iostream>
+#include <random>
+#include <algorithm>
+
+#define OWL_TEST_NAME "t28"
+#include "../owlTestCheck.h"
+
+using namespace owl::common;
+
+struct Spheres {
+  std::vector<vec3f> centers;
+  std::vector<float> radii;
+};
+
+/*! n^3 spheres of radius .5 on a grid, in random order */
+Spheres makeCube(int n, int seed)
+{
+  Spheres spheres;
+  for (int iz=0;iz<n;iz++)
+    for (int iy=0;iy<n;iy++)
+      for (int ix=0;ix<n;ix++)
+        spheres.centers.push_back(vec3f(float(ix),float(iy),float(iz)));
+  std::shuffle(spheres.centers.begin(),spheres.centers.end(),std::mt19937(seed));
+  spheres.radii.resize(spheres.centers.size(),.5f);
+  return spheres;
+}
+
+/*! 'numPoints' points with random radii, in gaussian clusters */
+Spheres makeClusters(size_t numPoints, int numClusters, int seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> u(0.f,100.f);
+  std::normal_distribution<float> g(0.f,1.f);
+  std::vector<vec3f> clusterCenters(numClusters);
+  for (auto &c : clusterCenters) c = vec3f(u(rng),u(rng),u(rng));
+  Spheres spheres;
+  for (size_t i=0;i<numPoints;i++) {
+    const vec3f c = clusterCenters[rng() % numClusters];
+    spheres.centers.push_back(c + vec3f(g(rng),g(rng),g(rng)));
+    spheres.radii.push_back(.001f+.01f*u(rng)/100.f);
+  }
+  return spheres;
+}
+
+/*! every level's sphere encloses the input spheres (and the finer
+    level's spheres) it stands for, and isn't much larger than its
+    cell */
+void checkHierarchy(const Spheres &in, const SphereLODHierarchy &h)
+{
+  const size_t numPoints = in.centers.size();
+  std::vector<uint32_t> sortedOrder = h.pointOrder;
+  std::sort(sortedOrder.begin(),sortedOrder.end());
+  for (size_t i=0;i<numPoints;i++)
+    CHECK(sortedOrder[i] == i);
+  const float maxInputRadius
+    = *std::max_element(in.radii.begin(),in.radii.end());
+  
+  for (size_t lod=0;lod<h.levels.size();lod++) {
+    const SphereLOD &level = h.levels[lod];
+    const size_t numSpheres = level.centers.size();
+    CHECK(level.radii.size() == numSpheres);
+    CHECK(level.firstPoint.size() == numSpheres+1);
+    CHECK(level.firstPoint.front() == 0);
+    CHECK(level.firstPoint.back() == numPoints);
+    CHECK(numSpheres < numPoints);
+    CHECK(level.cellSize == h.levels[0].cellSize/float(1<<lod));
+    if (lod > 0) CHECK(numSpheres >= h.levels[lod-1].centers.size());
+    for (size_t i=0;i<numSpheres;i++) {
+      CHECK(level.firstPoint[i] < level.firstPoint[i+1]);
+      CHECK(level.radii[i] <= sqrtf(3.f)*level.cellSize + maxInputRadius);
+      for (uint32_t p=level.firstPoint[i];p<level.firstPoint[i+1];p++) {
+        const uint32_t id = h.pointOrder[p];
+        CHECK(length(in.centers[id]-level.centers[i]) + in.radii[id]
+              <= level.radii[i]*(1.f+1e-5f));
+      }
+    }
+  }
+}
+
+void testCube()
+{
+  const int n = 32;
+  const Spheres in = makeCube(n,0);
+  SphereClusteringConfig config;
+  const SphereLODHierarchy h = buildSphereLODs(in.centers,in.radii,config);
+  checkHierarchy(in,h);
+  // cells of 31/32 (level 5) would have one sphere each
+  CHECK(h.levels.size() == 5);
+  CHECK(h.numLODs() == 6);
+  for (int lod=0;lod<5;lod++)
+    CHECK(h.numSpheres(lod) == size_t(1) << (3*lod));
+  CHECK(h.numSpheres(5) == size_t(n*n*n));
+  std::cout << "#owl.test(t28): cube of " << prettyNumber(n*n*n)
+            << " spheres, levels of";
+  for (int lod=0;lod<h.numLODs();lod++)
+    std::cout << " " << prettyNumber(h.numSpheres(lod));
+  std::cout << " spheres" << std::endl;
+
+  // all spheres the same radius: stride 0 does the same
+  const float radius = .5f;
+  const SphereLODHierarchy h0
+    = buildSphereLODs(in.centers,StridedArray<float>(&radius,in.centers.size(),0),
+                      config);
+  CHECK(h0.pointOrder == h.pointOrder);
+  for (size_t lod=0;lod<h.levels.size();lod++) {
+    CHECK(h0.levels[lod].centers == h.levels[lod].centers);
+    CHECK(h0.levels[lod].radii   == h.levels[lod].radii);
+  }
+
+  // a shallower hierarchy is the same, only shorter
+  config.maxDepth = 2;
+  const SphereLODHierarchy h2 = buildSphereLODs(in.centers,in.radii,config);
+  CHECK(h2.levels.size() == 3);
+  for (size_t lod=0;lod<h2.levels.size();lod++)
+    CHECK(h2.levels[lod].centers == h.levels[lod].centers);
+}
+
+void testSelection()
+{
+  const Spheres in = makeCube(32,1);
+  const SphereLODHierarchy h = buildSphereLODs(in.centers,in.radii);
+  const int input = int(h.levels.size());
+  // by cell size
+  CHECK(selectSphereLOD(h,0.f,0) == input);
+  CHECK(selectSphereLOD(h,1e30f,0) == 0);
+  CHECK(selectSphereLOD(h,h.levels[2].cellSize,0) == 2);
+  CHECK(selectSphereLOD(h,1.01f*h.levels[2].cellSize,0) == 2);
+  CHECK(selectSphereLOD(h,.99f*h.levels[2].cellSize,0) == 3);
+  CHECK(selectSphereLOD(h,1e-3f,0) == input);
+  // by budget
+  CHECK(selectSphereLOD(h,0.f,h.numSpheres(3)) == 3);
+  CHECK(selectSphereLOD(h,0.f,h.numSpheres(3)-1) == 2);
+  CHECK(selectSphereLOD(h,0.f,1) == 0);
+  CHECK(selectSphereLOD(h,0.f,in.centers.size()) == input);
+  // both: budget wins where it is tighter
+  CHECK(selectSphereLOD(h,1e-3f,h.numSpheres(2)) == 2);
+  CHECK(selectSphereLOD(h,h.levels[1].cellSize,h.numSpheres(2)) == 1);
+  // a 90 degree field of view is two units high at distance 1
+  CHECK(fabsf(worldSizeOfPixels(1.f,1.f,float(M_PI/2),2)-1.f) < 1e-6f);
+  CHECK(fabsf(worldSizeOfPixels(4.f,10.f,float(M_PI/2),100)-.8f) < 1e-5f);
+
+  std::vector<vec3f> centers;
+  std::vector<float> radii;
+  getSphereLOD(h,2,in.centers,in.radii,centers,radii);
+  CHECK(centers == h.levels[2].centers);
+  CHECK(radii == h.levels[2].radii);
+  getSphereLOD(h,input,in.centers,in.radii,centers,radii);
+  CHECK(centers.size() == in.centers.size());
+  for (size_t i=0;i<centers.size();i++)
+    CHECK(centers[i] == in.centers[h.pointOrder[i]]);
+  bool threw = false;
+  try { getSphereLOD(h,input+1,in.centers,in.radii,centers,radii); }
+  catch (const std::runtime_error &) { threw = true; }
+  CHECK(threw);
+}
+
+void testDegenerate()
+{
+  // nothing
+  const SphereLODHierarchy none
+    = buildSphereLODs(std::vector<vec3f>(),std::vector<float>());
+  CHECK(none.numLODs() == 1);
+  CHECK(none.numSpheres(0) == 0);
+  // a single sphere is its own (and only) level of detail
+  const std::vector<vec3f> one = { vec3f(1.f,2.f,3.f) };
+  const std::vector<float> oneRadius = { .5f };
+  CHECK(buildSphereLODs(one,oneRadius).numLODs() == 1);
+  // all on top of each other: no level ever separates them
+  Spheres same;
+  same.centers.resize(100,vec3f(1.f));
+  same.radii.resize(100,1.f);
+  SphereClusteringConfig config;
+  config.maxDepth = 3;
+  const SphereLODHierarchy h = buildSphereLODs(same.centers,same.radii,config);
+  checkHierarchy(same,h);
+  CHECK(h.levels.size() == 4);
+  for (auto &level : h.levels) {
+    CHECK(level.centers.size() == 1);
+    CHECK(level.radii[0] == 1.f);
+  }
+  // mismatching radii
+  bool threw = false;
+  try { buildSphereLODs(same.centers,oneRadius); }
+  catch (const std::runtime_error &) { threw = true; }
+  CHECK(threw);
+}
+
+void testClusters()
+{
+  const Spheres in = makeClusters(200000,16,2);
+  setNumThreads(1);
+  const SphereLODHierarchy serial = buildSphereLODs(in.centers,in.radii);
+  setNumThreads(4);
+  const SphereLODHierarchy parallel = buildSphereLODs(in.centers,in.radii);
+  setNumThreads(0);
+  checkHierarchy(in,parallel);
+  CHECK(serial.pointOrder == parallel.pointOrder);
+  CHECK(serial.levels.size() == parallel.levels.size());
+  for (size_t lod=0;lod<serial.levels.size();lod++) {
+    CHECK(serial.levels[lod].centers    == parallel.levels[lod].centers);
+    CHECK(serial.levels[lod].radii      == parallel.levels[lod].radii);
+    CHECK(serial.levels[lod].firstPoint == parallel.levels[lod].firstPoint);
+  }
+}
+
+void testThroughput()
+{
+  const Spheres in = makeClusters(4*1000*1000,64,3);
+  const double t0 = getCurrentTime();
+  const SphereLODHierarchy h = buildSphereLODs(in.centers,in.radii);
+  const double t1 = getCurrentTime();
+  const int lod = selectSphereLOD(h,0.f,in.centers.size()/100);
+  std::cout << "#owl.test(t28): clustered " << prettyNumber(in.centers.size())
+            << " points into " << h.levels.size() << " levels in "
+            << prettyDouble(t1-t0) << "s ("
+            << prettyDouble(in.centers.size()/(t1-t0)) << " points/s, "
+            << getNumThreads() << " threads); 1% budget gets level "
+            << lod << " with " << prettyNumber(h.numSpheres(lod))
+            << " spheres" << std::endl;
+  CHECK(h.numSpheres(lod) <= in.centers.size()/100);
+}
+
+int main()
+{
+  testCube();
+  testSelection();
+  testDegenerate();
+  testClusters();
+  testThroughput();
+  std::cout << OWL_TERMINAL_GREEN
+            << "#owl.test(t28): all sphere LOD tests passed"
+            << OWL_TERMINAL_DEFAULT << std::endl;
+  return 0;
+}